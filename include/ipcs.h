@@ -19,10 +19,15 @@
 #ifndef __IPCS_H__
 #define __IPCS_H__
 
+#include <stddef.h>
+
 /******************************************************************************/
 /* 发送或接收消息的最大长度（字节数） */
 #define IPCS_MESSAGE_MAX_LEN    (32*1024)
 
+/* 同步调用的默认超时时间（毫秒） */
+#define IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS   3000
+
 typedef struct {
     unsigned int msgType;
     unsigned int msgLen;
@@ -52,6 +57,7 @@ typedef enum {
 
     IPCS_READ_FAIL,
     IPCS_WRITE_FAIL,
+    IPCS_PEER_CLOSED,
 
     IPCS_SERVER_HOOK_FAIL,
     IPCS_CLIENT_HOOK_FAIL,
@@ -68,6 +74,23 @@ typedef enum {
     IPCS_PARAM_NULL,
     IPCS_PARAM_LEN,
 
+    IPCS_FILE_FAIL,
+    IPCS_MMAP_FAIL,
+    IPCS_EXIST,
+
+    IPCS_TIMEOUT,
+    IPCS_STREAM_INCOMPLETE,
+
+    IPCS_URING_FAIL,
+    IPCS_TOO_MANY_TOPICS,
+    IPCS_PRIO_TABLE_FULL,
+    IPCS_AFFINITY_FAIL,
+    IPCS_OVERLOADED,    /* 服务端过载，请求被拒绝 */
+    IPCS_CACHE_TABLE_FULL,
+    IPCS_HANDOFF_FAIL,  /* 热重启交接失败，服务端仍由本进程服务 */
+    IPCS_CHECKSUM_FAIL, /* 帧的校验和不对，数据在传输或缓冲中被破坏 */
+    IPCS_FRAME_BAD,     /* 帧格式错误：长度越界、压缩的负载无法解压或带连接上没有协商的帧选项 */
+
     IPCS_ERROR_BUTT
 } IPCS_ReturnValue;
 
@@ -78,33 +101,422 @@ typedef int (*ServerCallback)(int fd, IPCS_Message *msg);
 /* 客户端响应的回调函数，仅用于异步调用时 */
 typedef int (*ClientCallback)(IPCS_Message *msg);
 
+/* 异步调用超时的回调函数，callId为IPCS_ClientAsynCallTimeout返回的调用ID */
+typedef int (*ClientTimeoutCallback)(unsigned int callId);
+
+/* 异步调用被服务端拒绝的回调函数，msgType为请求的消息类型，error为拒绝的原因（IPCS_OVERLOADED）；
+ * IPCS_ClientAsynCall发出的请求callId为0 */
+typedef int (*ClientRejectCallback)(unsigned int callId, unsigned int msgType, int error);
+
+/* I/O引擎：epoll + read/write，或io_uring（multishot accept/recv、批量发送）；
+ * 内核不支持io_uring时自动使用epoll。io_uring服务端的响应在一轮完成事件处理完后统一发送，
+ * 回调函数不应长时间阻塞 */
+typedef enum {
+    IPCS_ENGINE_EPOLL = 0,
+    IPCS_ENGINE_URING
+} IPCS_Engine;
+
+/* 消息优先级：高优先级的消息（健康检查、控制面消息等）在接收方先于同一批收到的普通消息处理，
+ * 在服务端连接的发送队列中排在尚未发送的普通消息之前 */
+typedef enum {
+    IPCS_PRIO_NORMAL = 0,
+    IPCS_PRIO_HIGH
+} IPCS_Priority;
+
+/* 订阅所有主题 */
+#define IPCS_TOPIC_ALL              0xFFFFFFFFU
+
+/* 每个订阅者发送队列中发布消息的默认上限 */
+#define IPCS_PUB_QUEUE_DEFAULT_LEN  64
+
+/* 订阅者发送队列满（慢订阅者）时的策略 */
+typedef enum {
+    IPCS_PUB_DROP_NEWEST = 0,   /* 丢弃新发布的消息 */
+    IPCS_PUB_CONFLATE           /* 用新消息替换队列中同一主题尚未发送的消息，没有时丢弃新消息 */
+} IPCS_PubPolicy;
+
+/* 线程名的最大长度（含结尾的'\0'），Linux限制为16 */
+#define IPCS_THREAD_NAME_MAX_LEN    16
+
+#define IPCS_CPU_LIST_MAX_LEN       64
+
+/* 库内部线程（服务端线程、异步客户端线程）的放置，全为空串时不绑定CPU、使用默认线程名 */
+typedef struct {
+    char cpuList[IPCS_CPU_LIST_MAX_LEN];    /* 绑定的CPU，格式与taskset -c相同，例如"2"、"0-3,8" */
+    char name[IPCS_THREAD_NAME_MAX_LEN];    /* 线程名，默认为"ipcs-server"、"ipcs-client" */
+} IPCS_ThreadAttr;
+
+/* 忙等：阻塞等待之前先忙等最多spinUs微秒，用CPU换时延，适合独占CPU的线程；
+ * adaptive不为0时按最近的等待时间调整，平均等待时间超过spinUs时不忙等，直接阻塞 */
+typedef struct {
+    unsigned int spinUs;        /* 0表示不忙等（默认） */
+    int adaptive;
+} IPCS_BusyPollAttr;
+
+/* 服务端每个连接默认的积压上限（字节），最小为IPCS_CONN_CREDIT_MIN。客户端在接收回调中
+ * 阻塞发送新请求时，同时未完成的请求和响应应小于上限加上内核socket缓冲区，否则双方互相等待 */
+#define IPCS_CONN_CREDIT_DEFAULT    (4 * 1024 * 1024)
+#define IPCS_CONN_CREDIT_MIN        (64 * 1024)
+
+/* 过载保护：请求的排队时间从客户端发出请求算起，到服务端线程取出请求为止 */
+typedef enum {
+    IPCS_SHED_NONE = 0,
+    IPCS_SHED_CODEL,            /* 一个观察窗口内的最小排队时间超过目标时进入过载，过载期间拒绝
+                                 * 排队时间超过两倍目标的请求，窗口内最小排队时间回到目标以下后恢复 */
+    IPCS_SHED_TOKEN_BUCKET      /* 每个连接的令牌桶，请求速率超过rate（允许burst个突发）时拒绝 */
+} IPCS_ShedPolicy;
+
+#define IPCS_SHED_TARGET_DEFAULT_US     5000
+#define IPCS_SHED_INTERVAL_DEFAULT_US   100000
+
+/* 被拒绝的请求不交给回调函数，服务端回复错误帧（同步调用返回IPCS_OVERLOADED，
+ * 异步调用交给拒绝回调）；高优先级请求总是接受 */
+typedef struct {
+    IPCS_ShedPolicy policy;
+    unsigned int targetUs;      /* CoDel：排队时间目标，0表示IPCS_SHED_TARGET_DEFAULT_US */
+    unsigned int intervalUs;    /* CoDel：观察窗口，0表示IPCS_SHED_INTERVAL_DEFAULT_US */
+    unsigned int rate;          /* 令牌桶：每个连接每秒的请求数，0表示不限制 */
+    unsigned int burst;         /* 令牌桶：允许的突发请求数，0表示等于rate */
+    int silent;                 /* 非0时直接丢弃被拒绝的请求，不回复错误帧 */
+} IPCS_ShedAttr;
+
+/* 响应缓存：按消息类型开启（IPCS_ServerSetCache），键为请求的msgType和负载，值为回调函数对该请求
+ * 发出的唯一一条响应。命中时服务端线程直接回复缓存的响应，不调用回调函数 */
+#define IPCS_CACHE_DEFAULT_BYTES    (4 * 1024 * 1024)
+#define IPCS_CACHE_ALL_TYPES        0xFFFFFFFFU
+
+/**
+ * 多进程服务端（prefork）：workers大于1时，创建服务端的进程建立监听socket后fork出workers个工作进程，
+ * 每个工作进程运行自己的事件循环和回调函数，共用监听socket，新连接由一个空闲的工作进程accept
+ * （epoll引擎使用EPOLLEXCLUSIVE）。工作进程异常退出时重新创建，不影响其他工作进程的连接；
+ * 创建服务端的进程退出时工作进程也退出。回调函数运行在工作进程中，不能访问创建进程的内存，
+ * 缓存、发布、统计等按服务端名字操作的接口对多进程服务端返回IPCS_NOT_FOUND。
+ * 应在创建其他线程和连接之前创建，工作进程会继承创建进程当时打开的fd。
+ **/
+#define IPCS_PREFORK_MAX_WORKERS    64
+
+/**
+ * 负载压缩：服务端和客户端都开启compress时，连接上不小于IPCS_COMPRESS_MIN_LEN字节的负载用LZ压缩后发送，
+ * 压缩后没有变小的按原样发送，接收方解压后交给回调函数。适合JSON、文本等冗余较多的负载，
+ * 不可压缩的负载只扫描开头一段就放弃，每帧多一次很短的压缩尝试（见compress_bench）。
+ **/
+#define IPCS_COMPRESS_MIN_LEN       512
+
+/* 服务端属性，使用前调用IPCS_InitServerAttr设置默认值 */
+typedef struct {
+    IPCS_Engine engine;
+    IPCS_PubPolicy pubPolicy;
+    unsigned int pubQueueLen;   /* 每个订阅者排队的发布消息上限，0表示IPCS_PUB_QUEUE_DEFAULT_LEN */
+    unsigned int reactor;       /* 0表示独立的服务端线程；非0时reactor相同的服务端共用一个线程和
+                                 * epoll/io_uring实例，engine、thread、busyPoll以创建该线程的服务端为准 */
+    IPCS_ThreadAttr thread;     /* 服务端线程（回调函数在其中运行）绑定的CPU和线程名 */
+    IPCS_BusyPollAttr busyPoll; /* 服务端线程等待事件时的忙等 */
+    unsigned int connCredit;    /* 每个连接未处理的请求和未发出的响应最多占用的字节数，超过时暂停接收
+                                 * 该连接的请求，积压降到一半以下后恢复；0表示IPCS_CONN_CREDIT_DEFAULT */
+    IPCS_ShedAttr shed;         /* 过载保护，默认不拒绝请求 */
+    unsigned int cacheBytes;    /* 响应缓存的上限（字节，含请求和响应），0表示IPCS_CACHE_DEFAULT_BYTES */
+    unsigned int workers;       /* 大于1时为多进程服务端的工作进程数，最多IPCS_PREFORK_MAX_WORKERS；
+                                 * 工作进程中不使用reactor和thread的CPU */
+    unsigned int readyTimeoutMs;/* 非0时创建函数等待服务端线程开始监听（最多readyTimeoutMs毫秒）后返回，
+                                 * 返回IPCS_OK时客户端可以立即连接；超时返回IPCS_TIMEOUT，服务端仍继续创建 */
+    int checksum;               /* 非0时同意客户端的帧校验和请求，协商成功的连接上双向的帧都带CRC32C */
+    int compress;               /* 非0时同意客户端的负载压缩请求 */
+} IPCS_ServerAttr;
+
+/* 客户端属性，使用前调用IPCS_InitClientAttr设置默认值 */
+typedef struct {
+    IPCS_Engine engine;         /* 异步客户端 */
+    IPCS_ThreadAttr thread;     /* 异步客户端：接收线程（回调函数在其中运行）绑定的CPU和线程名 */
+    IPCS_BusyPollAttr busyPoll; /* 同步客户端：同步调用等待响应时的忙等 */
+    unsigned int connectTimeoutMs;  /* 非0时服务端还没有开始监听（连接被拒绝）时按指数退避重试连接，
+                                     * 最多等待connectTimeoutMs毫秒；0表示只连接一次 */
+    int checksum;               /* 非0时连接后请求帧校验和（CRC32C），服务端不同意时不带校验和；
+                                 * 收到校验失败的帧返回IPCS_CHECKSUM_FAIL。收发两端对每个字节各算一次CRC，
+                                 * 开销随消息长度增加：两端在同一CPU上回显时1KB约5%，4KB约10%，
+                                 * 最大消息约25%~30%（-O2，见test/README.md中的crc_bench） */
+    int compress;               /* 非0时连接后请求负载压缩，服务端同意时双向的大负载压缩后发送 */
+} IPCS_ClientAttr;
+
+/* 服务端统计，由服务端线程更新；共用线程的服务端syscalls、wakeups和spinHits是整个线程的 */
+typedef struct {
+    unsigned long long syscalls;    /* 服务端线程的I/O系统调用次数 */
+    unsigned long long wakeups;     /* 事件循环的唤醒次数 */
+    unsigned long long messages;    /* 处理的请求数 */
+    unsigned long long publishes;   /* 发布的消息数 */
+    unsigned long long pubDrops;    /* 订阅者发送队列满（或超过内存预算）时丢弃或合并的发布消息数（按订阅者计），
+                                     * 发布速率超过订阅者处理能力时所有订阅者都会计入 */
+    unsigned long long spinHits;    /* 忙等期间等到事件的次数，忙等的系统调用计入syscalls */
+    unsigned long long recvPauses;  /* 因连接积压超过connCredit或超出内存预算暂停接收的次数 */
+    unsigned long long sheds;       /* 因过载被拒绝的请求数，不计入messages */
+    unsigned long long queueNs;     /* 带发送时间的请求的排队时间之和（纳秒），含被拒绝的请求 */
+    unsigned long long cacheHits;   /* 由响应缓存直接回复、没有调用回调函数的请求数（计入messages） */
+    unsigned long long cacheMisses; /* 开启了缓存的消息类型没有命中的请求数 */
+    unsigned long long cacheBytes;  /* 响应缓存当前占用的字节数 */
+    unsigned long long coalesced;   /* 与相同的并发请求合并、没有调用回调函数的请求数（计入messages） */
+} IPCS_ServerStats;
+
+/**
+ * 同步客户端连接池：管理到一个或多个服务端（同一服务的多个副本）的连接，每次调用取出一个
+ * 空闲连接，多个线程可以同时调用。调用按未完成的调用数最少的服务端分配；连接失败或者连接
+ * 断开的服务端在retryMs内不再分配，之后再尝试连接。
+ **/
+#define IPCS_POOL_MAX_SERVERS       16
+#define IPCS_POOL_CONNS_DEFAULT     8
+#define IPCS_POOL_RETRY_DEFAULT_MS  1000
+
+/**
+ * 对冲请求：调用在对冲延迟内没有返回时，向另一个服务端再发一次相同的请求，取先到的响应，
+ * 另一个响应到达后被丢弃。对冲延迟取最近调用时延的hedgePercentile百分位（积累到
+ * IPCS_HEDGE_MIN_SAMPLES个样本之前使用hedgeDelayUs），对冲请求最多占调用的IPCS_HEDGE_MAX_PERCENT%。
+ * 只应对幂等的请求开启
+ **/
+#define IPCS_HEDGE_MIN_SAMPLES      100
+#define IPCS_HEDGE_MAX_PERCENT      10
+
+typedef struct IPCS_ClientPool IPCS_ClientPool;
+
+/* 连接池属性，使用前调用IPCS_InitPoolAttr设置默认值 */
+typedef struct {
+    unsigned int connsPerServer;    /* 每个服务端最多的连接数（同时进行的调用数），0表示IPCS_POOL_CONNS_DEFAULT */
+    unsigned int retryMs;           /* 失败的服务端暂停分配的时间，0表示IPCS_POOL_RETRY_DEFAULT_MS */
+    IPCS_ClientAttr client;         /* 创建连接的属性，只使用busyPoll（对冲的调用不忙等） */
+    unsigned int hedgePercentile;   /* 按最近调用时延的百分位（1~99）对冲，0表示使用固定的hedgeDelayUs */
+    unsigned int hedgeDelayUs;      /* 固定的对冲延迟（微秒），与hedgePercentile都为0时不对冲 */
+} IPCS_PoolAttr;
+
+/* 连接池中一个服务端的统计 */
+typedef struct {
+    unsigned long long calls;       /* 分配到该服务端的调用数 */
+    unsigned long long failures;    /* 连接失败或连接断开的次数 */
+    unsigned int outstanding;       /* 正在进行的调用数 */
+    unsigned int conns;             /* 已建立的连接数 */
+    int down;                       /* 非0表示暂停分配 */
+} IPCS_PoolServerStats;
+
+/* 连接池的对冲统计 */
+typedef struct {
+    unsigned long long calls;       /* 开启对冲后的调用数 */
+    unsigned long long hedges;      /* 发出的对冲请求数 */
+    unsigned long long hedgeWins;   /* 对冲请求的响应先到达的次数 */
+    unsigned long long hedgeDelayUs;    /* 当前的对冲延迟，0表示还不对冲 */
+} IPCS_PoolHedgeStats;
+
+/**
+ * 分散-聚合调用：向多个服务端的同步客户端连接同时发出请求，在调用线程中用一个poll等待所有
+ * 连接的响应，总时延取决于最慢的连接，而不是各个调用的时延之和。
+ **/
+#define IPCS_FANOUT_MAX_CALLS       64
+
+typedef struct {
+    int fd;                         /* 同步客户端，不能重复 */
+    IPCS_Message *sendMsg;          /* 发给该连接的请求，NULL表示使用IPCS_ClientFanoutCall的sendMsg */
+    IPCS_Message *recvMsg;          /* 响应缓冲区，msgLen为缓冲区长度，返回时为响应的长度 */
+    int result;                     /* 出参：该连接的调用结果，返回时还没有等到响应的为IPCS_TIMEOUT */
+} IPCS_FanoutCall;
+
+/* 多进程服务端的工作进程 */
+typedef struct {
+    unsigned int workers;
+    unsigned long long restarts;    /* 工作进程异常退出后重新创建的次数 */
+    int pids[IPCS_PREFORK_MAX_WORKERS]; /* 工作进程的pid，0表示正在重新创建 */
+} IPCS_WorkerStats;
+
+/**
+ * 服务端线程的任务和定时器：回调函数需要延迟响应或定期执行的工作时不必另建线程，交给运行该服务端
+ * 回调函数的服务端线程执行，与回调函数之间不需要加锁。任务和定时器中可以调用IPCS_ServerSendMessage
+ * （不带调用ID）、IPCS_ServerReply、IPCS_ServerPublish，以及添加和取消定时器。
+ * 任务和定时器属于提交它的服务端，服务端销毁时还没有执行的任务和定时器被丢弃（不执行）。
+ **/
+typedef void (*IPCS_TaskCallback)(void *arg);
+
+/* 延迟响应：回调函数中保存的请求 */
+typedef struct {
+    int fd;
+    unsigned int callId;
+    IPCS_Priority prio;
+    unsigned long long connId;      /* 区分fd被新连接重用 */
+} IPCS_ServerCall;
+
+/* 进程内所有服务端连接的收发缓冲区和待发送消息占用的内存（字节） */
+typedef struct {
+    size_t used;
+    size_t peak;
+    size_t budget;
+} IPCS_MemStats;
+
 /******************************************************************************/
-/* 创建服务端，参数都是必须的入参 */
+/* 创建服务端，参数都是必须的入参；serverName以'@'开头时使用Linux抽象命名空间地址，不创建socket文件 */
 int IPCS_CreateServer(const char *serverName, ServerCallback serverHook);
 
-/* 销毁服务端 */
+void IPCS_InitServerAttr(IPCS_ServerAttr *attr);
+
+/* 按属性创建服务端，attr为NULL时与IPCS_CreateServer相同 */
+int IPCS_CreateServerEx(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr);
+
+int IPCS_GetServerStats(const char *serverName, IPCS_ServerStats *stats);
+
+/* 销毁服务端；共用线程的其他服务端不受影响，最后一个服务端销毁时线程退出。
+ * 多进程服务端结束所有工作进程（SIGTERM）并等待其退出 */
 int IPCS_DestroyServer(const char *serverName);
 
-/* 服务端响应消息，服务端响应请求的回调函数中使用 */
+/* 多进程服务端的工作进程，不是多进程服务端时返回IPCS_NOT_FOUND */
+int IPCS_GetServerWorkers(const char *serverName, IPCS_WorkerStats *stats);
+
+/**
+ * 热重启：旧进程调用IPCS_HandoffServer，把服务端的监听socket和已建立的连接（连同已收到未处理的
+ * 请求、未发出的响应和订阅的主题）通过SCM_RIGHTS交给在handoffName上等待的新进程，新进程确认后
+ * 旧进程销毁该服务端（不关闭连接、不删除socket文件），返回后不再调用其回调函数；失败时服务端照常
+ * 服务。新进程调用IPCS_TakeoverServer在handoffName上等待旧进程最多timeoutMs毫秒，接管后按attr
+ * 创建服务端。交接期间客户端的连接和请求留在内核中，不会连接失败，也不需要重新连接。
+ * 旧进程只支持epoll引擎的服务端，不支持多进程服务端，不能在该服务端的回调函数中调用；交接时旧进程
+ * 的服务端线程阻塞，共用该线程的其他服务端暂停处理。响应缓存等服务端的状态不交接。
+ * 新进程还没有开始等待时IPCS_HandoffServer返回IPCS_CONNECT_FAIL，可以稍后重试。
+ **/
+int IPCS_HandoffServer(const char *serverName, const char *handoffName, unsigned int timeoutMs);
+
+int IPCS_TakeoverServer(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr,
+        const char *handoffName, unsigned int timeoutMs);
+
+/* 开启或关闭msgType的响应缓存，缓存项ttlMs毫秒后过期；ttlMs为0时关闭并删除该类型的缓存项。
+ * 每个服务端最多开启64个类型。只应对幂等的查询开启：回调函数对请求只发出一条响应、
+ * 且没有修改请求时才缓存，回调函数失败时不缓存 */
+int IPCS_ServerSetCache(const char *serverName, unsigned int msgType, unsigned int ttlMs);
+
+/* 使缓存失效：request不为NULL时删除与之相同的请求的缓存项，否则删除msgType的所有缓存项
+ * （IPCS_CACHE_ALL_TYPES表示所有类型）。失效之前开始执行的回调函数的结果不会被缓存 */
+int IPCS_ServerInvalidateCache(const char *serverName, unsigned int msgType, const IPCS_Message *request);
+
+/* 开启或关闭msgType的请求合并：相同（msgType和负载都相同）的请求在前一个请求的回调函数返回之前
+ * 发出时，不再调用回调函数，直接回复前一个请求的响应。与响应缓存的条件相同，只合并回调函数成功、
+ * 只有一条响应的结果；只应对幂等的查询开启，每个服务端最多开启64个类型 */
+int IPCS_ServerSetCoalesce(const char *serverName, unsigned int msgType, int enable);
+
+/* 回调函数中使用：正在处理的请求的排队时间（纳秒），请求没有带发送时间时为0 */
+unsigned long long IPCS_ServerGetQueueNs(int fd);
+
+/* 服务端响应消息，服务端响应请求的回调函数中使用；高优先级请求的响应也是高优先级。
+ * 在其他线程中调用时复制消息，交给连接所属的服务端线程发送，返回时消息还没有发出 */
 int IPCS_ServerSendMessage(int fd, IPCS_Message *msg);
 
+/* 按指定优先级响应消息，实际优先级取prio、请求和消息类型登记的优先级中最高的 */
+int IPCS_ServerSendMessageEx(int fd, IPCS_Message *msg, IPCS_Priority prio);
+
+/* 向订阅了msg->msgType的所有客户端发布消息，可在任意线程调用；消息只编码一次，
+ * 各订阅者共享同一个缓冲区，慢订阅者按IPCS_ServerAttr的pubPolicy丢弃或合并 */
+int IPCS_ServerPublish(const char *serverName, IPCS_Message *msg);
+
+/* 可在任意线程调用：把task交给serverName的服务端线程执行，按提交的顺序执行 */
+int IPCS_ServerPostTask(const char *serverName, IPCS_TaskCallback task, void *arg);
+
+/* 只能在服务端线程中（回调函数、任务或定时器中）调用：delayMs毫秒后在服务端线程中执行callback，
+ * intervalMs不为0时之后每intervalMs毫秒执行一次直到取消。精度为1ms，timerId为出参（可为NULL） */
+int IPCS_ServerAddTimer(unsigned int delayMs, unsigned int intervalMs, IPCS_TaskCallback callback, void *arg,
+        unsigned long long *timerId);
+
+/* 只能在服务端线程中调用：取消定时器，已执行的一次性定时器返回IPCS_NOT_FOUND */
+int IPCS_ServerCancelTimer(unsigned long long timerId);
+
+/* 回调函数中使用：保存正在处理的请求，回调函数返回时不响应，之后在任务或定时器中用IPCS_ServerReply响应 */
+int IPCS_ServerSaveCall(int fd, IPCS_ServerCall *call);
+
+/* 只能在服务端线程中调用：响应保存的请求（带上其调用ID和优先级）；连接已关闭时返回IPCS_NOT_FOUND */
+int IPCS_ServerReply(const IPCS_ServerCall *call, IPCS_Message *msg);
+
 /******************************************************************************/
-/* 创建同步客户端 */
+/* 创建同步客户端；clientName为NULL或空串时由内核分配抽象命名空间地址（autobind） */
 int IPCS_CreateSyncClient(const char *clientName, const char *serverName, int *fd);
 
-/* 创建异步客户端 */
+/* 创建异步客户端；clientName的规则与同步客户端相同 */
 int IPCS_CreateAsynClient(const char *clientName, const char *serverName, ClientCallback clientHook, int *fd);
 
+void IPCS_InitClientAttr(IPCS_ClientAttr *attr);
+
+/* 按属性创建同步客户端，只使用attr->busyPoll；attr为NULL时与IPCS_CreateSyncClient相同 */
+int IPCS_CreateSyncClientEx(const char *clientName, const char *serverName, const IPCS_ClientAttr *attr, int *fd);
+
+/* 按属性创建异步客户端，attr为NULL时与IPCS_CreateAsynClient相同 */
+int IPCS_CreateAsynClientEx(const char *clientName, const char *serverName, ClientCallback clientHook,
+        const IPCS_ClientAttr *attr, int *fd);
+
 /* 销毁客户端 */
 int IPCS_DestroyClient(int fd);
 
 /******************************************************************************/
-/* 同步调用 */
+void IPCS_InitPoolAttr(IPCS_PoolAttr *attr);
+
+/* 创建连接池，serverNames为serverNum个（最多IPCS_POOL_MAX_SERVERS）服务端的名字；连接在调用时按需建立 */
+int IPCS_CreateClientPool(const char * const *serverNames, unsigned int serverNum, const IPCS_PoolAttr *attr,
+        IPCS_ClientPool **pool);
+
+/* 从连接池取出一个连接进行同步调用，可在多个线程中同时调用；所有服务端的连接都在使用时等待，
+ * 等待时间计入timeoutMs。只有连接失败（请求没有发出）时才换一个服务端重试 */
+int IPCS_PoolSyncCall(IPCS_ClientPool *pool, IPCS_Message *sendMsg, IPCS_Message *recvMsg);
+
+int IPCS_PoolSyncCallTimeout(IPCS_ClientPool *pool, IPCS_Message *sendMsg, IPCS_Message *recvMsg,
+        unsigned int timeoutMs);
+
+/* index为创建时serverNames中的下标 */
+int IPCS_GetPoolStats(IPCS_ClientPool *pool, unsigned int index, IPCS_PoolServerStats *stats);
+
+int IPCS_GetPoolHedgeStats(IPCS_ClientPool *pool, IPCS_PoolHedgeStats *stats);
+
+/* 等待正在进行的调用返回后关闭所有连接 */
+int IPCS_DestroyClientPool(IPCS_ClientPool *pool);
+
+/******************************************************************************/
+/* 同步调用，超时时间为IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS */
 int IPCS_ClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg);
 
-/* 异步调用 */
+/* 带超时的同步调用，timeoutMs为0时一直等待；超时返回IPCS_TIMEOUT，之后迟到的响应被丢弃 */
+int IPCS_ClientSyncCallTimeout(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg, unsigned int timeoutMs);
+
+/* 分散-聚合调用：向calls中callNum个连接（最多IPCS_FANOUT_MAX_CALLS）同时发出请求。needNum为0时
+ * 等待所有调用完成，否则needNum个调用成功、或者失败的调用多到不可能再有needNum个成功时返回；
+ * 最多等待timeoutMs（0表示一直等待）。成功的调用数达到要求时返回IPCS_OK，否则返回第一个失败的结果，
+ * 没有失败时返回IPCS_TIMEOUT。每个调用的结果在calls[i].result中，没有等到的响应之后到达时被丢弃 */
+int IPCS_ClientFanoutCall(IPCS_FanoutCall *calls, unsigned int callNum, IPCS_Message *sendMsg, unsigned int needNum,
+        unsigned int timeoutMs);
+
+/* 异步调用；多个线程可以同时在同一个异步客户端上调用，各线程的请求合并发送，帧不会交错 */
 int IPCS_ClientAsynCall(int fd, IPCS_Message *sendMsg);
 
+/* 带超时的异步调用，callId为出参（可为NULL）；超时前收到的第一个响应交给clientHook，
+ * 超时后调用超时回调，之后迟到的响应和同一调用的其他响应被丢弃，不再调用clientHook。
+ * timeoutMs为0时与IPCS_ClientAsynCall相同：不记录调用，callId返回0，所有响应都交给clientHook */
+int IPCS_ClientAsynCallTimeout(int fd, IPCS_Message *sendMsg, unsigned int timeoutMs, unsigned int *callId);
+
+/* 设置异步客户端的超时回调函数，可为NULL */
+int IPCS_SetClientTimeoutHook(int fd, ClientTimeoutCallback timeoutHook);
+
+/* 设置异步客户端的拒绝回调函数，可为NULL；被拒绝的带超时的调用不再超时，也不调用clientHook */
+int IPCS_SetClientRejectHook(int fd, ClientRejectCallback rejectHook);
+
+/* 异步客户端订阅或取消订阅主题（发布消息的msgType），发布的消息交给clientHook；
+ * topic为IPCS_TOPIC_ALL时订阅所有主题 */
+int IPCS_ClientSubscribe(int fd, unsigned int topic);
+
+int IPCS_ClientUnsubscribe(int fd, unsigned int topic);
+
+/******************************************************************************/
+/* 登记消息类型的优先级（进程内全局，服务端和客户端共用），发送该类型的消息时在帧头标记优先级；
+ * 最多登记64个高优先级类型，应在收发消息之前设置 */
+int IPCS_SetMsgPriority(unsigned int msgType, IPCS_Priority prio);
+
+/* 设置服务端连接的内存预算（字节），0表示不限制（默认）。超出预算时服务端暂停接收请求、
+ * 丢弃新的发布消息（计入pubDrops），待发送的数据发出、占用回落到预算以下后恢复 */
+void IPCS_SetMemBudget(size_t budget);
+
+void IPCS_GetMemStats(IPCS_MemStats *stats);
+
+/* 打开或关闭库内部日志（默认打开） */
+void IPCS_EnableLog(int enable);
+
+/* 开始抓包：收发的每一帧追加到内存映射的抓包文件，capacity为文件的最大字节数 */
+int IPCS_StartCapture(const char *fileName, size_t capacity);
+
+/* 停止抓包，抓包文件截断到最后一条完整记录 */
+int IPCS_StopCapture(void);
+
 /******************************************************************************/
 
 #endif /* __IPCS_H__ */
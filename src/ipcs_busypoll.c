@@ -0,0 +1,114 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_busypoll.c
+ *
+ *    Description:  IPC socket busy polling (spin-then-block)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:12:40 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_busypoll.h"
+#include "ipcs_common.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/******************************************************************************/
+void IPCS_BusyPollInit(IPCS_BusyPoll *busyPoll, const IPCS_BusyPollAttr *attr)
+{
+    (void)memset(busyPoll, 0, sizeof(IPCS_BusyPoll));
+
+    if (attr != NULL) {
+        busyPoll->spinNs = (uint64_t)attr->spinUs * 1000ULL;
+        busyPoll->adaptive = attr->adaptive;
+    }
+
+    return;
+}
+
+uint64_t IPCS_BusyPollBudget(IPCS_BusyPoll *busyPoll)
+{
+    if (!busyPoll->adaptive) {
+        return busyPoll->spinNs;
+    }
+
+    if (busyPoll->skipWaits != 0) {
+        busyPoll->skipWaits--;
+        return 0;
+    }
+
+    if (busyPoll->avgWaitNs > busyPoll->spinNs) {
+        return 0;
+    }
+
+    return busyPoll->spinNs;
+}
+
+void IPCS_BusyPollRecord(IPCS_BusyPoll *busyPoll, uint64_t budgetNs, uint64_t waitNs)
+{
+    uint64_t maxWaitNs = busyPoll->spinNs * IPCS_BUSY_POLL_WAIT_CLAMP;
+
+    if (!busyPoll->adaptive) {
+        return;
+    }
+
+    if (budgetNs != 0) {
+        if (waitNs <= budgetNs) {
+            busyPoll->missStreak = 0;
+        } else {
+            if (busyPoll->missStreak < IPCS_BUSY_POLL_MAX_BACKOFF) {
+                busyPoll->missStreak++;
+            }
+            busyPoll->skipWaits = (1U << busyPoll->missStreak) - 1;
+        }
+    }
+
+    if (waitNs > maxWaitNs) {
+        waitNs = maxWaitNs;
+    }
+
+    busyPoll->avgWaitNs = busyPoll->avgWaitNs - (busyPoll->avgWaitNs >> IPCS_BUSY_POLL_EWMA_SHIFT) +
+            (waitNs >> IPCS_BUSY_POLL_EWMA_SHIFT);
+
+    return;
+}
+
+/* AF_UNIX不支持SO_BUSY_POLL，用不阻塞的MSG_PEEK查询，不取走数据 */
+int IPCS_BusyPollFd(int fd, uint64_t budgetNs, uint64_t deadlineNs)
+{
+    uint64_t endNs = 0;
+    ssize_t peekLen = 0;
+    char byte = 0;
+
+    if (budgetNs == 0) {
+        return 0;
+    }
+
+    endNs = IPCS_GetNowNs() + budgetNs;
+    if ((deadlineNs != 0) && (deadlineNs < endNs)) {
+        endNs = deadlineNs;
+    }
+
+    do {
+        peekLen = recv(fd, &byte, sizeof(byte), MSG_PEEK | MSG_DONTWAIT);
+        if ((peekLen >= 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+            /* 有数据、对端关闭或出错，都交给随后的read处理 */
+            return 1;
+        }
+    } while (IPCS_GetNowNs() < endNs);
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,64 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_busypoll.h
+ *
+ *    Description:  IPC socket busy polling (spin-then-block)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:12:40 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_BUSYPOLL_H__
+#define __IPCS_BUSYPOLL_H__
+
+#include "ipcs.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 阻塞等待之前先忙等一段时间：事件在忙等期间到达时省掉一次睡眠和唤醒。
+ * 自适应模式：
+ * 1. 记录每次等待的时长（指数加权平均，新样本权重1/8），平均等待时间超过忙等时间时直接阻塞，
+ *    流量变密后自动恢复忙等。单个样本最多记为IPCS_BUSY_POLL_WAIT_CLAMP倍的忙等时间，
+ *    长时间空闲之后几个快速的往返就能恢复忙等；
+ * 2. 忙等落空（等满忙等时间仍要阻塞）时，之后的1、3、7……次等待不忙等，最多跳过
+ *    2^IPCS_BUSY_POLL_MAX_BACKOFF - 1次，忙等命中后恢复。对端和本线程在同一个CPU上时
+ *    忙等只会推迟对端运行，退避避免平均等待时间在阈值附近来回摆动。
+ **/
+#define IPCS_BUSY_POLL_EWMA_SHIFT   3
+#define IPCS_BUSY_POLL_WAIT_CLAMP   4
+#define IPCS_BUSY_POLL_MAX_BACKOFF  6
+
+/* 忙等状态，只由等待的线程使用，不加锁 */
+typedef struct {
+    uint64_t spinNs;        /* 0表示不忙等 */
+    uint64_t avgWaitNs;
+    unsigned int missStreak;
+    unsigned int skipWaits;
+    int adaptive;
+} IPCS_BusyPoll;
+
+/******************************************************************************/
+void IPCS_BusyPollInit(IPCS_BusyPoll *busyPoll, const IPCS_BusyPollAttr *attr);
+
+/* 本次等待应忙等的时间，0表示直接阻塞 */
+uint64_t IPCS_BusyPollBudget(IPCS_BusyPoll *busyPoll);
+
+/* 记录一次等待（从开始等待到事件到达）的时长，budgetNs为本次忙等的时间 */
+void IPCS_BusyPollRecord(IPCS_BusyPoll *busyPoll, uint64_t budgetNs, uint64_t waitNs);
+
+/* 忙等阻塞fd可读（或对端关闭、出错），最多budgetNs，deadlineNs不为0时不超过deadlineNs；返回是否等到 */
+int IPCS_BusyPollFd(int fd, uint64_t budgetNs, uint64_t deadlineNs);
+
+/******************************************************************************/
+
+#endif /* __IPCS_BUSYPOLL_H__ */
@@ -0,0 +1,377 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_cache.c
+ *
+ *    Description:  IPC socket server response cache
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:36:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+#define IPCS_CACHE_HASH_MUL     0x9E3779B97F4A7C15ULL
+
+#define IPCS_CacheEntrySize(entry)  (sizeof(IPCS_CacheEntry) + (entry)->keyLen + (entry)->respLen)
+
+void IPCS_CacheInit(IPCS_Cache *cache, size_t maxBytes)
+{
+    (void)memset(cache, 0, sizeof(IPCS_Cache));
+    (void)pthread_mutex_init(&cache->mutex, NULL);
+    cache->lru.lruPrev = &cache->lru;
+    cache->lru.lruNext = &cache->lru;
+    cache->maxBytes = maxBytes;
+
+    return;
+}
+
+void IPCS_CacheDestroy(IPCS_Cache *cache)
+{
+    IPCS_CacheInvalidate(cache, IPCS_CACHE_ALL_TYPES, NULL);
+    free(cache->buckets);
+    cache->buckets = NULL;
+    (void)pthread_mutex_destroy(&cache->mutex);
+
+    return;
+}
+
+int IPCS_CacheSetType(IPCS_Cache *cache, unsigned int msgType, unsigned int ttlMs)
+{
+    unsigned int num = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    (void)pthread_mutex_lock(&cache->mutex);
+    num = cache->typeNum;
+    for (i = 0; i < num; i++) {
+        if (cache->types[i].msgType == msgType) {
+            break;
+        }
+    }
+
+    if (ttlMs != 0) {
+        if (i < num) {
+            cache->types[i].ttlNs = (uint64_t)ttlMs * 1000000ULL;
+        } else if (num >= IPCS_CACHE_MAX_TYPES) {
+            result = IPCS_CACHE_TABLE_FULL;
+        } else {
+            cache->types[num].msgType = msgType;
+            cache->types[num].ttlNs = (uint64_t)ttlMs * 1000000ULL;
+            __atomic_store_n(&cache->typeNum, num + 1, __ATOMIC_RELEASE);
+        }
+    } else if (i < num) {
+        cache->types[i] = cache->types[num - 1];
+        __atomic_store_n(&cache->typeNum, num - 1, __ATOMIC_RELEASE);
+    }
+    (void)pthread_mutex_unlock(&cache->mutex);
+
+    if (ttlMs == 0) {
+        IPCS_CacheInvalidate(cache, msgType, NULL);
+    }
+
+    return result;
+}
+
+uint64_t IPCS_CacheTypeTtl(IPCS_Cache *cache, unsigned int msgType)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < cache->typeNum; i++) {
+        if (cache->types[i].msgType == msgType) {
+            return cache->types[i].ttlNs;
+        }
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+int IPCS_CacheLookup(IPCS_Cache *cache, const IPCS_Message *request, uint64_t nowNs, IPCS_Message *response,
+        uint64_t *ttlNs, uint64_t *generation)
+{
+    IPCS_CacheEntry **link = NULL;
+    IPCS_CacheEntry *entry = NULL;
+    uint64_t hash = 0;
+    int result = IPCS_NOT_FOUND;
+
+    *ttlNs = 0;
+    if (__atomic_load_n(&cache->typeNum, __ATOMIC_ACQUIRE) == 0) {
+        return IPCS_NOT_FOUND;
+    }
+
+    hash = IPCS_CacheHash(request->msgType, request->msgValue, request->msgLen);
+
+    (void)pthread_mutex_lock(&cache->mutex);
+    do {
+        *ttlNs = IPCS_CacheTypeTtl(cache, request->msgType);
+        *generation = cache->generation;
+        if (*ttlNs == 0) {
+            break;
+        }
+
+        link = IPCS_CacheFind(cache, hash, request->msgType, request->msgValue, request->msgLen);
+        if ((link == NULL) || (*link == NULL)) {
+            cache->misses++;
+            break;
+        }
+
+        entry = *link;
+        if ((nowNs >= entry->expireNs) || (entry->respLen > response->msgLen)) {
+            IPCS_CacheRemove(cache, link);
+            cache->misses++;
+            break;
+        }
+
+        response->msgType = entry->respType;
+        response->msgLen = entry->respLen;
+        (void)memcpy(response->msgValue, entry->data + entry->keyLen, entry->respLen);
+
+        /* 移到LRU链表头 */
+        entry->lruPrev->lruNext = entry->lruNext;
+        entry->lruNext->lruPrev = entry->lruPrev;
+        entry->lruNext = cache->lru.lruNext;
+        entry->lruPrev = &cache->lru;
+        cache->lru.lruNext->lruPrev = entry;
+        cache->lru.lruNext = entry;
+
+        cache->hits++;
+        result = IPCS_OK;
+    } while (0);
+    (void)pthread_mutex_unlock(&cache->mutex);
+
+    return result;
+}
+
+IPCS_CacheEntry *IPCS_CacheNewEntry(const IPCS_Message *request, const IPCS_Message *response, uint64_t expireNs)
+{
+    IPCS_CacheEntry *entry = NULL;
+
+    entry = (IPCS_CacheEntry *)malloc(sizeof(IPCS_CacheEntry) + request->msgLen + response->msgLen);
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    entry->hashNext = NULL;
+    entry->lruPrev = NULL;
+    entry->lruNext = NULL;
+    entry->hash = IPCS_CacheHash(request->msgType, request->msgValue, request->msgLen);
+    entry->expireNs = expireNs;
+    entry->msgType = request->msgType;
+    entry->keyLen = request->msgLen;
+    entry->respType = response->msgType;
+    entry->respLen = response->msgLen;
+    if (request->msgLen != 0) {
+        (void)memcpy(entry->data, request->msgValue, request->msgLen);
+    }
+    if (response->msgLen != 0) {
+        (void)memcpy(entry->data + request->msgLen, response->msgValue, response->msgLen);
+    }
+
+    return entry;
+}
+
+void IPCS_CacheInsert(IPCS_Cache *cache, IPCS_CacheEntry *entry, uint64_t generation, uint64_t nowNs)
+{
+    IPCS_CacheEntry **link = NULL;
+    size_t size = IPCS_CacheEntrySize(entry);
+
+    (void)pthread_mutex_lock(&cache->mutex);
+    do {
+        if ((generation != cache->generation) || (size > cache->maxBytes) ||
+            (IPCS_CacheTypeTtl(cache, entry->msgType) == 0)) {
+            break;
+        }
+
+        if ((cache->count >= cache->bucketNum) && (IPCS_CacheGrow(cache) != IPCS_OK)) {
+            break;
+        }
+
+        link = IPCS_CacheFind(cache, entry->hash, entry->msgType, entry->data, entry->keyLen);
+        if (*link != NULL) {
+            IPCS_CacheRemove(cache, link);
+        }
+
+        entry->hashNext = cache->buckets[entry->hash & (cache->bucketNum - 1)];
+        cache->buckets[entry->hash & (cache->bucketNum - 1)] = entry;
+        entry->lruNext = cache->lru.lruNext;
+        entry->lruPrev = &cache->lru;
+        cache->lru.lruNext->lruPrev = entry;
+        cache->lru.lruNext = entry;
+        cache->count++;
+        cache->bytes += size;
+
+        IPCS_CacheEvict(cache, nowNs);
+        entry = NULL;
+    } while (0);
+    (void)pthread_mutex_unlock(&cache->mutex);
+
+    free(entry);
+
+    return;
+}
+
+void IPCS_CacheInvalidate(IPCS_Cache *cache, unsigned int msgType, const IPCS_Message *request)
+{
+    IPCS_CacheEntry **link = NULL;
+    unsigned int i = 0;
+    uint64_t hash = 0;
+
+    if (request != NULL) {
+        hash = IPCS_CacheHash(request->msgType, request->msgValue, request->msgLen);
+    }
+
+    (void)pthread_mutex_lock(&cache->mutex);
+    cache->generation++;
+
+    if (request != NULL) {
+        link = IPCS_CacheFind(cache, hash, request->msgType, request->msgValue, request->msgLen);
+        if ((link != NULL) && (*link != NULL)) {
+            IPCS_CacheRemove(cache, link);
+        }
+    } else {
+        for (i = 0; i < cache->bucketNum; i++) {
+            link = &cache->buckets[i];
+            while (*link != NULL) {
+                if ((msgType == IPCS_CACHE_ALL_TYPES) || ((*link)->msgType == msgType)) {
+                    IPCS_CacheRemove(cache, link);
+                } else {
+                    link = &(*link)->hashNext;
+                }
+            }
+        }
+    }
+    (void)pthread_mutex_unlock(&cache->mutex);
+
+    return;
+}
+
+size_t IPCS_CacheBytes(IPCS_Cache *cache)
+{
+    return __atomic_load_n(&cache->bytes, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************/
+/* 每次取8字节做乘法和移位混合，最后用murmur3的fmix64打散，短的请求只需要几次乘法 */
+uint64_t IPCS_CacheHash(unsigned int msgType, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t hash = ((uint64_t)msgType << 32) ^ (len * IPCS_CACHE_HASH_MUL);
+    uint64_t word = 0;
+
+    while (len >= sizeof(word)) {
+        (void)memcpy(&word, p, sizeof(word));
+        word *= IPCS_CACHE_HASH_MUL;
+        hash = (hash ^ (word ^ (word >> 29))) * IPCS_CACHE_HASH_MUL;
+        p += sizeof(word);
+        len -= sizeof(word);
+    }
+
+    if (len != 0) {
+        word = 0;
+        (void)memcpy(&word, p, len);
+        word *= IPCS_CACHE_HASH_MUL;
+        hash = (hash ^ (word ^ (word >> 29))) * IPCS_CACHE_HASH_MUL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/* 返回指向匹配缓存项的指针的地址，没有匹配时*link为NULL；还没有分配桶时返回NULL */
+IPCS_CacheEntry **IPCS_CacheFind(IPCS_Cache *cache, uint64_t hash, unsigned int msgType, const void *key,
+        unsigned int keyLen)
+{
+    IPCS_CacheEntry **link = NULL;
+    IPCS_CacheEntry *entry = NULL;
+
+    if (cache->buckets == NULL) {
+        return NULL;
+    }
+
+    link = &cache->buckets[hash & (cache->bucketNum - 1)];
+    while ((entry = *link) != NULL) {
+        if ((entry->hash == hash) && (entry->msgType == msgType) && (entry->keyLen == keyLen) &&
+            ((keyLen == 0) || (memcmp(entry->data, key, keyLen) == 0))) {
+            break;
+        }
+        link = &entry->hashNext;
+    }
+
+    return link;
+}
+
+void IPCS_CacheRemove(IPCS_Cache *cache, IPCS_CacheEntry **link)
+{
+    IPCS_CacheEntry *entry = *link;
+
+    *link = entry->hashNext;
+    entry->lruPrev->lruNext = entry->lruNext;
+    entry->lruNext->lruPrev = entry->lruPrev;
+    cache->count--;
+    __atomic_store_n(&cache->bytes, cache->bytes - IPCS_CacheEntrySize(entry), __ATOMIC_RELAXED);
+    free(entry);
+
+    return;
+}
+
+/* 缓存项个数达到桶数时桶数加倍 */
+int IPCS_CacheGrow(IPCS_Cache *cache)
+{
+    unsigned int newNum = (cache->bucketNum != 0) ? cache->bucketNum * 2 : IPCS_CACHE_MIN_BUCKETS;
+    IPCS_CacheEntry **buckets = NULL;
+    IPCS_CacheEntry *entry = NULL;
+    unsigned int i = 0;
+
+    buckets = (IPCS_CacheEntry **)calloc(newNum, sizeof(IPCS_CacheEntry *));
+    if (buckets == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    for (i = 0; i < cache->bucketNum; i++) {
+        while ((entry = cache->buckets[i]) != NULL) {
+            cache->buckets[i] = entry->hashNext;
+            entry->hashNext = buckets[entry->hash & (newNum - 1)];
+            buckets[entry->hash & (newNum - 1)] = entry;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucketNum = newNum;
+
+    return IPCS_OK;
+}
+
+/* 超过上限时从LRU链表尾淘汰；nowNs之前过期的缓存项在链表尾时一并删除 */
+void IPCS_CacheEvict(IPCS_Cache *cache, uint64_t nowNs)
+{
+    IPCS_CacheEntry *entry = NULL;
+
+    while ((entry = cache->lru.lruPrev) != &cache->lru) {
+        if ((cache->bytes <= cache->maxBytes) && (entry->expireNs > nowNs)) {
+            break;
+        }
+        IPCS_CacheRemove(cache, IPCS_CacheFind(cache, entry->hash, entry->msgType, entry->data, entry->keyLen));
+    }
+
+    return;
+}
+
+/******************************************************************************/
@@ -0,0 +1,117 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_cache.h
+ *
+ *    Description:  IPC socket server response cache
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:36:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_CACHE_H__
+#define __IPCS_CACHE_H__
+
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 服务端的响应缓存：键为请求的msgType和负载，值为回调函数对该请求发出的唯一一条响应。
+ * 服务端线程查找和插入，其他线程开启缓存的消息类型、使缓存失效，都在mutex保护下进行。
+ * 缓存项按最近使用的顺序挂在LRU链表上，总字节数超过上限时从最久未使用的一端淘汰；
+ * 过期的缓存项在查找到时删除，或者在淘汰时优先被淘汰（最久未使用的通常也是最早过期的）。
+ * 失效时增加generation：回调函数执行期间发生的失效使其结果不再插入，避免缓存旧的响应。
+ **/
+#define IPCS_CACHE_MAX_TYPES        64
+#define IPCS_CACHE_MIN_BUCKETS      256
+
+typedef struct IPCS_CacheEntry {
+    struct IPCS_CacheEntry *hashNext;
+    struct IPCS_CacheEntry *lruPrev;
+    struct IPCS_CacheEntry *lruNext;
+    uint64_t hash;
+    uint64_t expireNs;
+    unsigned int msgType;
+    unsigned int keyLen;
+    unsigned int respType;
+    unsigned int respLen;
+    char data[];                    /* 请求的负载，之后是响应的负载 */
+} IPCS_CacheEntry;
+
+typedef struct {
+    unsigned int msgType;
+    uint64_t ttlNs;
+} IPCS_CacheType;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    IPCS_CacheType types[IPCS_CACHE_MAX_TYPES];
+    unsigned int typeNum;           /* 服务端线程不加锁读，为0时不查找缓存 */
+
+    IPCS_CacheEntry **buckets;
+    unsigned int bucketNum;         /* 2的幂，第一次插入时分配 */
+    IPCS_CacheEntry lru;            /* 哨兵，lru.lruNext为最近使用的 */
+    unsigned int count;
+    size_t bytes;
+    size_t maxBytes;
+    uint64_t generation;
+
+    unsigned long long hits;
+    unsigned long long misses;
+} IPCS_Cache;
+
+/******************************************************************************/
+void IPCS_CacheInit(IPCS_Cache *cache, size_t maxBytes);
+
+void IPCS_CacheDestroy(IPCS_Cache *cache);
+
+/* ttlMs为0时关闭该消息类型的缓存并删除其缓存项 */
+int IPCS_CacheSetType(IPCS_Cache *cache, unsigned int msgType, unsigned int ttlMs);
+
+/**
+ * 查找请求的响应，命中时复制到response（msgLen为入参时的缓冲区长度）并返回IPCS_OK。
+ * 未命中时返回IPCS_NOT_FOUND，消息类型开启了缓存时ttlNs、generation用于之后插入，
+ * 否则ttlNs为0。
+ **/
+int IPCS_CacheLookup(IPCS_Cache *cache, const IPCS_Message *request, uint64_t nowNs, IPCS_Message *response,
+        uint64_t *ttlNs, uint64_t *generation);
+
+IPCS_CacheEntry *IPCS_CacheNewEntry(const IPCS_Message *request, const IPCS_Message *response, uint64_t expireNs);
+
+/* 插入后entry归缓存所有；查找之后发生过失效或者entry超过上限时直接释放 */
+void IPCS_CacheInsert(IPCS_Cache *cache, IPCS_CacheEntry *entry, uint64_t generation, uint64_t nowNs);
+
+/* request不为NULL时只删除该请求的缓存项，否则删除msgType的所有缓存项，
+ * msgType为IPCS_CACHE_ALL_TYPES时删除所有缓存项 */
+void IPCS_CacheInvalidate(IPCS_Cache *cache, unsigned int msgType, const IPCS_Message *request);
+
+size_t IPCS_CacheBytes(IPCS_Cache *cache);
+
+uint64_t IPCS_CacheHash(unsigned int msgType, const void *data, size_t len);
+
+/* 以下持有mutex时调用 */
+IPCS_CacheEntry **IPCS_CacheFind(IPCS_Cache *cache, uint64_t hash, unsigned int msgType, const void *key,
+        unsigned int keyLen);
+
+void IPCS_CacheRemove(IPCS_Cache *cache, IPCS_CacheEntry **link);
+
+int IPCS_CacheGrow(IPCS_Cache *cache);
+
+void IPCS_CacheEvict(IPCS_Cache *cache, uint64_t nowNs);
+
+uint64_t IPCS_CacheTypeTtl(IPCS_Cache *cache, unsigned int msgType);
+
+/******************************************************************************/
+
+#endif /* __IPCS_CACHE_H__ */
@@ -0,0 +1,251 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_capture.c
+ *
+ *    Description:  IPC socket traffic capture (mmap'd append-only capture file)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:25:16 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define IPCS_CAPTURE_ROUND_UP(len)  (((len) + IPCS_CAPTURE_ALIGN - 1) & ~((uint64_t)IPCS_CAPTURE_ALIGN - 1))
+
+/**
+ * g_IpcsCaptureHeader非空表示正在抓包。
+ * 写入者先增加g_IpcsCaptureUsers再读取g_IpcsCaptureHeader，停止抓包时先清空指针，
+ * 再等待g_IpcsCaptureUsers归零后才解除映射，所以写入者不会访问已解除映射的内存。
+ **/
+static IPCS_CaptureFileHeader *g_IpcsCaptureHeader = NULL;
+static int g_IpcsCaptureUsers = 0;
+static int g_IpcsCaptureFd = -1;
+static pthread_mutex_t g_IpcsCaptureMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/******************************************************************************/
+uint64_t IPCS_CaptureRealNs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void IPCS_CaptureFrame(int direction, int itemType, int fd, IPCS_Message *msg)
+{
+    IPCS_CaptureFileHeader *header = NULL;
+    IPCS_CaptureRecord *record = NULL;
+    uint64_t recordLen = 0;
+    uint64_t offset = 0;
+
+    if (__atomic_load_n(&g_IpcsCaptureHeader, __ATOMIC_ACQUIRE) == NULL) {
+        return;
+    }
+
+    (void)__atomic_add_fetch(&g_IpcsCaptureUsers, 1, __ATOMIC_SEQ_CST);
+
+    do {
+        header = __atomic_load_n(&g_IpcsCaptureHeader, __ATOMIC_SEQ_CST);
+        if (header == NULL) {
+            break;
+        }
+
+        recordLen = IPCS_CAPTURE_ROUND_UP(sizeof(IPCS_CaptureRecord) + msg->msgLen);
+        offset = __atomic_fetch_add(&header->writeOffset, recordLen, __ATOMIC_RELAXED);
+        if (offset + recordLen > header->capacity) {
+            (void)__atomic_add_fetch(&header->droppedFrames, 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+        record = (IPCS_CaptureRecord *)((char *)header + offset);
+        record->direction = (uint8_t)direction;
+        record->itemType = (uint8_t)itemType;
+        record->fd = fd;
+        record->msgType = msg->msgType;
+        record->timestampNs = IPCS_GetNowNs();
+        record->msgLen = msg->msgLen;
+
+        if (msg->msgLen > 0) {
+            (void)memcpy(record + 1, msg->msgValue, msg->msgLen);
+        }
+
+        /* recordLen最后写入，读者据此判断记录是否完整 */
+        __atomic_store_n(&record->recordLen, (uint32_t)recordLen, __ATOMIC_RELEASE);
+    } while (0);
+
+    (void)__atomic_sub_fetch(&g_IpcsCaptureUsers, 1, __ATOMIC_SEQ_CST);
+
+    return;
+}
+
+/******************************************************************************/
+int IPCS_OpenCaptureFile(const char *fileName, size_t capacity, IPCS_CaptureFileHeader **header, int *fd)
+{
+    void *base = NULL;
+    int tempFd = -1;
+
+    tempFd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (tempFd < 0) {
+        perror("open capture file error");
+        IPCS_WriteLog("Start capture: open %s fail, errno: %d", fileName, errno);
+        return IPCS_FILE_FAIL;
+    }
+
+    if (ftruncate(tempFd, (off_t)capacity) != 0) {
+        (void)close(tempFd);
+        perror("ftruncate capture file error");
+        IPCS_WriteLog("Start capture: ftruncate %s to %zu fail, errno: %d", fileName, capacity, errno);
+        return IPCS_FILE_FAIL;
+    }
+
+    base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, tempFd, 0);
+    if (base == MAP_FAILED) {
+        (void)close(tempFd);
+        perror("mmap capture file error");
+        IPCS_WriteLog("Start capture: mmap %s fail, errno: %d", fileName, errno);
+        return IPCS_MMAP_FAIL;
+    }
+
+    *header = (IPCS_CaptureFileHeader *)base;
+    (*header)->magic = IPCS_CAPTURE_MAGIC;
+    (*header)->version = IPCS_CAPTURE_VERSION;
+    (*header)->headerLen = sizeof(IPCS_CaptureFileHeader);
+    (*header)->capacity = capacity;
+    (*header)->writeOffset = IPCS_CAPTURE_ROUND_UP(sizeof(IPCS_CaptureFileHeader));
+    (*header)->droppedFrames = 0;
+    (*header)->startMonoNs = IPCS_GetNowNs();
+    (*header)->startRealNs = IPCS_CaptureRealNs();
+    *fd = tempFd;
+
+    return IPCS_OK;
+}
+
+/* 开始抓包 */
+int IPCS_StartCapture(const char *fileName, size_t capacity)
+{
+    IPCS_CaptureFileHeader *header = NULL;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    if (fileName == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    if (capacity < IPCS_CAPTURE_MIN_SIZE) {
+        IPCS_WriteLog("Start capture: %s capacity %zu too small.", fileName, capacity);
+        return IPCS_PARAM_LEN;
+    }
+
+    (void)pthread_mutex_lock(&g_IpcsCaptureMutex);
+
+    do {
+        if (g_IpcsCaptureHeader != NULL) {
+            IPCS_WriteLog("Start capture: %s: capture already running.", fileName);
+            result = IPCS_EXIST;
+            break;
+        }
+
+        result = IPCS_OpenCaptureFile(fileName, capacity, &header, &fd);
+        if (result != IPCS_OK) {
+            break;
+        }
+
+        g_IpcsCaptureFd = fd;
+        __atomic_store_n(&g_IpcsCaptureHeader, header, __ATOMIC_SEQ_CST);
+    } while (0);
+
+    (void)pthread_mutex_unlock(&g_IpcsCaptureMutex);
+
+    if (result == IPCS_OK) {
+        IPCS_WriteLog("Start capture: %s, capacity: %zu.", fileName, capacity);
+    }
+
+    return result;
+}
+
+/* 找到最后一条完整记录的结尾，文件按此截断 */
+uint64_t IPCS_CaptureValidEnd(IPCS_CaptureFileHeader *header)
+{
+    uint64_t offset = IPCS_CAPTURE_ROUND_UP(sizeof(IPCS_CaptureFileHeader));
+    uint64_t limit = header->writeOffset;
+    IPCS_CaptureRecord *record = NULL;
+
+    if (limit > header->capacity) {
+        limit = header->capacity;
+    }
+
+    while (offset + sizeof(IPCS_CaptureRecord) <= limit) {
+        record = (IPCS_CaptureRecord *)((char *)header + offset);
+        if ((record->recordLen == 0) || (offset + record->recordLen > limit)) {
+            break;
+        }
+        offset += record->recordLen;
+    }
+
+    return offset;
+}
+
+/* 停止抓包 */
+int IPCS_StopCapture(void)
+{
+    IPCS_CaptureFileHeader *header = NULL;
+    uint64_t validEnd = 0;
+    uint64_t capacity = 0;
+
+    (void)pthread_mutex_lock(&g_IpcsCaptureMutex);
+
+    header = g_IpcsCaptureHeader;
+    if (header == NULL) {
+        (void)pthread_mutex_unlock(&g_IpcsCaptureMutex);
+        return IPCS_OK;
+    }
+
+    __atomic_store_n(&g_IpcsCaptureHeader, NULL, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&g_IpcsCaptureUsers, __ATOMIC_SEQ_CST) != 0) {
+        (void)sched_yield();
+    }
+
+    capacity = header->capacity;
+    validEnd = IPCS_CaptureValidEnd(header);
+    header->writeOffset = validEnd;
+
+    IPCS_WriteLog("Stop capture: %llu bytes captured, %llu frames dropped.",
+            (unsigned long long)validEnd, (unsigned long long)header->droppedFrames);
+
+    (void)munmap(header, capacity);
+    if (ftruncate(g_IpcsCaptureFd, (off_t)validEnd) != 0) {
+        perror("ftruncate capture file error");
+        IPCS_WriteLog("Stop capture: ftruncate to %llu fail, errno: %d", (unsigned long long)validEnd, errno);
+    }
+    (void)close(g_IpcsCaptureFd);
+    g_IpcsCaptureFd = -1;
+
+    (void)pthread_mutex_unlock(&g_IpcsCaptureMutex);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
@@ -0,0 +1,83 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_capture.h
+ *
+ *    Description:  IPC socket traffic capture (mmap'd append-only capture file)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:25:16 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_CAPTURE_H__
+#define __IPCS_CAPTURE_H__
+
+#include "ipcs.h"
+#include "ipcs_common.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 抓包文件格式：
+ *
+ *   IPCS_CaptureFileHeader | IPCS_CaptureRecord + payload | IPCS_CaptureRecord + payload | ...
+ *
+ * 写入者用原子加法预留空间，然后填充记录，最后写入recordLen表示记录完整。
+ * 每条记录按IPCS_CAPTURE_ALIGN字节对齐；recordLen为0表示后面没有完整的记录。
+ * 文件空间用完后新的帧被丢弃并计入droppedFrames，不会覆盖已有记录。
+ **/
+#define IPCS_CAPTURE_MAGIC          0x43435049  /* "IPCC" */
+#define IPCS_CAPTURE_VERSION        1
+#define IPCS_CAPTURE_ALIGN          8
+#define IPCS_CAPTURE_MIN_SIZE       (64 * 1024)
+
+typedef enum {
+    IPCS_CAPTURE_RX = 0,
+    IPCS_CAPTURE_TX
+} IPCS_CaptureDirection;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerLen;
+    uint64_t capacity;
+    uint64_t writeOffset;       /* 已使用的字节数，包括文件头 */
+    uint64_t droppedFrames;
+    uint64_t startMonoNs;       /* CLOCK_MONOTONIC，与记录的timestampNs同一时钟 */
+    uint64_t startRealNs;       /* CLOCK_REALTIME，仅用于显示 */
+    uint64_t reserved[2];
+} IPCS_CaptureFileHeader;
+
+typedef struct {
+    uint32_t recordLen;         /* 包括记录头、负载和对齐填充 */
+    uint8_t direction;          /* IPCS_CaptureDirection */
+    uint8_t itemType;           /* IPCS_ItemType */
+    uint16_t reserved;
+    int32_t fd;
+    uint32_t msgType;
+    uint64_t timestampNs;
+    uint32_t msgLen;
+    uint32_t reserved2;
+} IPCS_CaptureRecord;
+
+/******************************************************************************/
+/* 抓包开关关闭时只有一次原子读，开销可以忽略 */
+void IPCS_CaptureFrame(int direction, int itemType, int fd, IPCS_Message *msg);
+
+uint64_t IPCS_CaptureRealNs(void);
+
+int IPCS_OpenCaptureFile(const char *fileName, size_t capacity, IPCS_CaptureFileHeader **header, int *fd);
+
+/* 返回最后一条完整记录的结尾偏移，回放工具也用它确定可读范围 */
+uint64_t IPCS_CaptureValidEnd(IPCS_CaptureFileHeader *header);
+
+/******************************************************************************/
+#endif /* __IPCS_CAPTURE_H__ */
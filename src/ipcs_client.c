@@ -1,380 +1,1504 @@
-/*
- * =====================================================================================
- *
- *       Filename:  ipcs_client.h
- *
- *    Description:  IPC socket client
- *
- *        Version:  1.0
- *        Created:  12/28/2018 10:33:49 PM
- *       Revision:  none
- *       Compiler:  gcc
- *
- *         Author:  Dercury (Jim), dercury@qq.com
- *   Organization:  Perfect World
- *
- * =====================================================================================
- */
-
-#include "ipcs_client.h"
-
-#include <errno.h>
-#include <pthread.h>
-#include <stddef.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/epoll.h>
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <sys/un.h>
-#include <unistd.h>
-
-/******************************************************************************/
-/* 创建同步客户端 */
-int IPCS_CreateSyncClient(const char *clientName, const char *serverName, int *fd)
-{
-    int result = IPCS_OK;
-    struct timeval timeout = {3, 0};    /* 3s */
-    
-    result = IPCS_CheckCreatingClient(clientName, serverName, fd);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Check creating sync client with bad params. Error: %d", result);
-        return result;
-    }
-    
-    result = IPCS_CreateClientSocket(clientName, serverName, fd);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Create sync client: %s, server: %s: create socket fail: %d.", clientName, serverName, result);
-        return result;
-    }
-
-    result = setsockopt(*fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(struct timeval));
-    if (result != 0) {
-        (void)close(*fd);
-        perror("sync client setsockopt error");
-        IPCS_WriteLog("Create sync client: %s, server: %s: set socket %d opt fail: %d, errno: %d.", clientName, serverName, *fd, result, errno);
-        return result;
-    }
-
-    result = IPCS_AddSyncClientInfo(clientName, serverName, *fd);
-    if (result != IPCS_OK) {
-        (void)close(*fd);
-        return result;
-    }
-
-    IPCS_WriteLog("Create sync client: %s, server: %s, socket: %d success.", clientName, serverName, *fd);
-
-    return result;
-}
-
-int IPCS_CheckCreatingClient(const char *clientName, const char *serverName, int *fd)
-{
-    int result = IPCS_OK;
-
-    if (fd == NULL) {
-        IPCS_WriteLog("Check creating client with null fd.");
-        return IPCS_PARAM_NULL;
-    }
-
-    result = IPCS_CheckItemName(clientName);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Check creating client with bad clientName. Error: %d", result);
-        return result;
-    }
-
-    result = IPCS_CheckItemName(serverName);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Check creating client with bad serverName. Error: %d", result);
-        return result;
-    }
-
-    return result;
-}
-
-int IPCS_CreateClientSocket(const char *clientName, const char *serverName, int *clientFd)
-{
-    struct sockaddr_un serverAddr;
-    struct sockaddr_un clientAddr;
-    int connectFd = 0;
-    int result = 0;
-
-    connectFd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (connectFd < 0) {
-        perror("client socket error");
-        IPCS_WriteLog("Create client: %s server: %s socket fail: %d, errno: %d", clientName, serverName, connectFd, errno);
-        return IPCS_SOCKET_FAIL;
-    }
-
-    memset(&clientAddr, 0, sizeof(clientAddr));
-    clientAddr.sun_family = AF_UNIX;
-    snprintf(clientAddr.sun_path, sizeof(clientAddr.sun_path), "%s", clientName);
-    unlink(clientAddr.sun_path);
-    result = bind(connectFd, (struct sockaddr *)&clientAddr, sizeof(clientAddr));
-    if (result < 0) {
-        (void)close(connectFd);
-        perror("client bind error");
-        IPCS_WriteLog("Bind client: %s server: %s socket: %d fail: %d, errno: %d", clientName, serverName, connectFd, result, errno);
-        return IPCS_BIND_FAIL;
-    }
-
-    memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sun_family = AF_UNIX;
-    snprintf(serverAddr.sun_path, sizeof(serverAddr.sun_path), "%s", serverName);
-
-    result = connect(connectFd, (struct sockaddr *)&serverAddr, sizeof(serverAddr));
-    if (result < 0) {
-        (void)close(connectFd);
-        perror("client connect error");
-        IPCS_WriteLog("Connect client: %s server: %s socket: %d fail: %d, errno: %d", clientName, serverName, connectFd, result, errno);
-        return IPCS_CONNECT_FAIL;
-    }
-
-    *clientFd = connectFd;
-    IPCS_WriteLog("IPC socket client: %s server: %s socket: %d created.", clientName, serverName, *clientFd);
-
-    return IPCS_OK;
-}
-
-/******************************************************************************/
-/* 同步调用 */
-int IPCS_ClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg)
-{
-    int result = 0;
-
-    result = IPCS_CheckClientSyncCall(fd, sendMsg, recvMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d sync call with bad params: %d", fd, result);
-        return result;
-    }
-
-    result = IPCS_SendMessage(fd, sendMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d sync call: send msg fail: %d", fd, result);
-        return result;
-    }
-
-    result = IPCS_RecvSingleMsg(fd, recvMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d sync call: resv single msg fail: %d", fd, result);
-        return result;
-    }
-
-    return result;
-}
-
-int IPCS_CheckClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg)
-{
-    int result = IPCS_OK;
-
-    result = IPCS_IsItemExist(IPCS_SYNC_CLIENT, NULL, fd);
-    if (result == 0) {
-        IPCS_WriteLog("Client sync call with not exist fd: %d", fd);
-        return IPCS_NOT_FOUND;
-    }
-
-    result = IPCS_CheckMessage(sendMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d sync call with bad send msg: %d", fd, sendMsg);
-        return result;
-    }
-
-    result = IPCS_CheckMessage(recvMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d sync call with bad recv msg: %d", fd, recvMsg);
-        return result;
-    }
-
-    return result;
-}
-
-/******************************************************************************/
-/* 创建异步客户端 */
-int IPCS_CreateAsynClient(const char *clientName, const char *serverName, ClientCallback clientHook, int *fd)
-{
-    pthread_t threadId;
-    IPCS_AsynClientThreadArg *threadArg = NULL;
-    int result = 0;
-    
-    /* NULL asyn client hook is allowed. */
-    result = IPCS_CheckCreatingClient(clientName, serverName, fd);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Check creating asyn client with bad params. Error: %d", result);
-        return result;
-    }
-    
-    result = IPCS_CreateClientSocket(clientName, serverName, fd);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Create asyn client: %s, server: %s: create socket fail: %d.", clientName, serverName, result);
-        return result;
-    }
-
-    threadArg = (IPCS_AsynClientThreadArg *)malloc(sizeof(IPCS_AsynClientThreadArg));
-    if (threadArg == NULL) {
-        (void)close(*fd);
-        IPCS_WriteLog("Create asyn client: %s, server: %s, socket: %d: malloc fail.", clientName, serverName, *fd);
-        return IPCS_MALLOC_FAIL;
-    }
-    (void)memset(threadArg, 0, sizeof(IPCS_AsynClientThreadArg));
-
-    threadArg->fd = *fd;
-    threadArg->clientHook = clientHook;
-    result = IPCS_CreateThread(IPCS_AsynClientRun, threadArg, &threadId);
-    if (result != IPCS_OK) {
-        (void)close(*fd);
-        free(threadArg);
-        IPCS_WriteLog("Create asyn client: %s, server: %s, socket: %d: create thread fail: %d.", clientName, serverName, *fd, result);
-        return result;
-    }
-
-    result = IPCS_AddAsynClientInfo(clientName, serverName, *fd, threadId, clientHook);
-    if (result != IPCS_OK) {
-        (void)close(*fd);
-        free(threadArg);
-        return result;
-    }
-
-    IPCS_WriteLog("Create asyn client: %s, server: %s, socket: %d: at thread %p success.", clientName, serverName, *fd, threadId);
-
-    return result;
-}
-
-void *IPCS_AsynClientRun(void *arg)
-{
-    IPCS_AsynClientThreadArg *threadArg = (IPCS_AsynClientThreadArg *)arg;
-    int result = 0;
-
-    for (; ; ) {
-        result = IPCS_RecvMultiMsg(IPCS_ASYN_CLIENT, threadArg->fd, threadArg);
-        if (result != IPCS_OK) {
-            break;
-        }
-    }
-
-    free(threadArg);
-
-    return NULL;
-}
-
-/******************************************************************************/
-/* 异步调用 */
-int IPCS_ClientAsynCall(int fd, IPCS_Message *sendMsg)
-{
-    int result = IPCS_OK;
-
-    result = IPCS_CheckClientAsynCall(fd, sendMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d asyn call with bad params: %d", fd, result);
-        return result;
-    }
-
-    result = IPCS_SendMessage(fd, sendMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d asyn call: send msg fail: %d", fd, result);
-        return result;
-    }
-
-    return result;
-}
-
-int IPCS_CheckClientAsynCall(int fd, IPCS_Message *sendMsg)
-{
-    int result = IPCS_OK;
-
-    result = IPCS_IsItemExist(IPCS_ASYN_CLIENT, NULL, fd);
-    if (result == 0) {
-        IPCS_WriteLog("Client asyn call with not exist fd: %d", fd);
-        return IPCS_NOT_FOUND;
-    }
-
-    result = IPCS_CheckMessage(sendMsg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Client: %d asyn call with bad send msg: %d", fd, sendMsg);
-        return result;
-    }
-
-    return IPCS_OK;
-}
-
-/******************************************************************************/
-/* 销毁客户端 */
-int IPCS_DestroyClient(int fd)
-{
-    int result = 0;
-    IPCS_ItemInfo itemInfo;
-
-    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
-    result = IPCS_FindItemsInfo(IPCS_SYNC_CLIENT, NULL, fd, &itemInfo);
-    if (result != IPCS_OK) {
-        result = IPCS_FindItemsInfo(IPCS_ASYN_CLIENT, NULL, fd, &itemInfo);
-        if (result != IPCS_OK) {
-            IPCS_WriteLog("Destroy client: %d not exist.", fd);
-            return IPCS_OK;
-        }
-    }
-
-    if (itemInfo.type == IPCS_ASYN_CLIENT) {
-        result = pthread_cancel(itemInfo.pid);
-        if (result != 0) {
-            perror("pthread_cancel error");
-            IPCS_WriteLog("Destroy asyn client: %d pthread_cancel: %p fail, errno: %d", fd, itemInfo.pid, errno);
-            return result;
-        }
-    }
-
-    result = close(fd);
-    if (result != 0) {
-        perror("close error");
-        IPCS_WriteLog("Destroy client: %d close fail, errno: %d", fd, errno);
-    } else {
-        IPCS_WriteLog("Destroy client: %d success", fd);
-    }
-
-    return result;
-}
-
-/******************************************************************************/
-int IPCS_AddSyncClientInfo(const char *clientName, const char *serverName, int fd)
-{
-    IPCS_ItemInfo info;
-    int result = IPCS_OK;
-
-    (void)memset(&info, 0, sizeof(IPCS_ItemInfo));
-
-    info.type = IPCS_SYNC_CLIENT;
-    (void)strcpy(info.name, clientName);
-    (void)strcpy(info.peerName, serverName);
-    info.fd = fd;
-
-    result = IPCS_AddItemsInfo(&info);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Add sync client: %s, server: %s: socket: %d info fail: %d.", clientName, serverName, fd, result);
-    }
-
-    return result;
-}
-
-int IPCS_AddAsynClientInfo(const char *clientName, const char *serverName, int fd, pthread_t pid, ClientCallback hook)
-{
-    IPCS_ItemInfo info;
-    int result = IPCS_OK;
-
-    (void)memset(&info, 0, sizeof(IPCS_ItemInfo));
-
-    info.type = IPCS_ASYN_CLIENT;
-    (void)strcpy(info.name, clientName);
-    (void)strcpy(info.peerName, serverName);
-    info.fd = fd;
-    info.pid = pid;
-    info.hook = hook;
-
-    result = IPCS_AddItemsInfo(&info);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Add asyn client: %s, server: %s: socket: %d info fail: %d.", clientName, serverName, fd, result);
-    }
-
-    return result;
-}
-
-/******************************************************************************/
-
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_client.h
+ *
+ *    Description:  IPC socket client
+ *
+ *        Version:  1.0
+ *        Created:  12/28/2018 10:33:49 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_client.h"
+#include "ipcs_thread.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+/* 创建同步客户端 */
+int IPCS_CreateSyncClient(const char *clientName, const char *serverName, int *fd)
+{
+    return IPCS_CreateSyncClientEx(clientName, serverName, NULL, fd);
+}
+
+int IPCS_CreateSyncClientEx(const char *clientName, const char *serverName, const IPCS_ClientAttr *attr, int *fd)
+{
+    IPCS_BusyPoll *busyPoll = NULL;
+    unsigned int frameFlags = 0;
+    int result = IPCS_OK;
+    
+    result = IPCS_CheckCreatingClient(clientName, serverName, fd);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Check creating sync client with bad params. Error: %d", result);
+        return result;
+    }
+
+    /* 忙等状态随客户端登记，在同步调用的线程中更新 */
+    if ((attr != NULL) && (attr->busyPoll.spinUs != 0)) {
+        busyPoll = (IPCS_BusyPoll *)malloc(sizeof(IPCS_BusyPoll));
+        if (busyPoll == NULL) {
+            IPCS_WriteLog("Create sync client: %s, server: %s: malloc fail.", clientName, serverName);
+            return IPCS_MALLOC_FAIL;
+        }
+        IPCS_BusyPollInit(busyPoll, &attr->busyPoll);
+    }
+    
+    result = IPCS_CreateClientSocketRetry(clientName, serverName, (attr != NULL) ? attr->connectTimeoutMs : 0, fd);
+    if (result != IPCS_OK) {
+        free(busyPoll);
+        IPCS_WriteLog("Create sync client: %s, server: %s: create socket fail: %d.", clientName, serverName, result);
+        return result;
+    }
+
+    result = IPCS_ClientNegotiate(*fd, attr, &frameFlags);
+    if (result != IPCS_OK) {
+        free(busyPoll);
+        (void)close(*fd);
+        return result;
+    }
+
+    /* 不再设置固定的SO_RCVTIMEO，超时时间由每次同步调用指定 */
+    result = IPCS_AddSyncClientInfo(clientName, serverName, *fd, busyPoll, frameFlags);
+    if (result != IPCS_OK) {
+        free(busyPoll);
+        (void)close(*fd);
+        return result;
+    }
+
+    IPCS_WriteLog("Create sync client: %s, server: %s, socket: %d success.", clientName, serverName, *fd);
+
+    return result;
+}
+
+int IPCS_CheckCreatingClient(const char *clientName, const char *serverName, int *fd)
+{
+    int result = IPCS_OK;
+
+    if (fd == NULL) {
+        IPCS_WriteLog("Check creating client with null fd.");
+        return IPCS_PARAM_NULL;
+    }
+
+    /* NULL or empty clientName means autobind. */
+    if (clientName != NULL) {
+        result = IPCS_CheckItemName(clientName);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Check creating client with bad clientName. Error: %d", result);
+            return result;
+        }
+    }
+
+    result = IPCS_CheckItemName(serverName);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Check creating client with bad serverName. Error: %d", result);
+        return result;
+    }
+
+    return result;
+}
+
+int IPCS_BindClientSocket(const char *clientName, int connectFd)
+{
+    struct sockaddr_un clientAddr;
+    socklen_t clientAddrLen = sizeof(sa_family_t);
+    int result = 0;
+
+    (void)memset(&clientAddr, 0, sizeof(clientAddr));
+    clientAddr.sun_family = AF_UNIX;
+
+    /* 没有客户端名字时只传入sun_family，由内核在抽象命名空间分配唯一的名字（autobind），
+     * 不涉及文件系统操作 */
+    if ((clientName != NULL) && (clientName[0] != '\0')) {
+        result = IPCS_FillSockAddr(clientName, &clientAddr, &clientAddrLen);
+        if (result != IPCS_OK) {
+            return result;
+        }
+
+        IPCS_UnlinkSockName(clientName);
+    }
+
+    result = bind(connectFd, (struct sockaddr *)&clientAddr, clientAddrLen);
+    if (result < 0) {
+        perror("client bind error");
+        IPCS_WriteLog("Bind client: %s socket: %d fail: %d, errno: %d", clientName, connectFd, result, errno);
+        return IPCS_BIND_FAIL;
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_CreateClientSocket(const char *clientName, const char *serverName, int *clientFd)
+{
+    return IPCS_CreateClientSocketRetry(clientName, serverName, 0, clientFd);
+}
+
+/**
+ * 集群启动时客户端可能先于服务端运行：socket文件还不存在（ENOENT）或者还没有listen（ECONNREFUSED）
+ * 时重试，其他错误直接返回。每次重试都重新创建socket，只在最后一次失败时输出错误。
+ **/
+int IPCS_CreateClientSocketRetry(const char *clientName, const char *serverName, unsigned int timeoutMs,
+        int *clientFd)
+{
+    uint64_t deadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    uint64_t nowNs = 0;
+    unsigned int backoffUs = IPCS_CONNECT_RETRY_MIN_US;
+    unsigned int sleepUs = 0;
+    unsigned int tries = 0;
+    int connErrno = 0;
+    int result = IPCS_OK;
+
+    for (; ; ) {
+        tries++;
+        result = IPCS_ConnectClientSocket(clientName, serverName, clientFd, &connErrno);
+        if ((result != IPCS_CONNECT_FAIL) || (timeoutMs == 0) ||
+                ((connErrno != ECONNREFUSED) && (connErrno != ENOENT))) {
+            break;
+        }
+
+        nowNs = IPCS_GetNowNs();
+        if (nowNs >= deadlineNs) {
+            break;
+        }
+        sleepUs = backoffUs;
+        if ((uint64_t)sleepUs * 1000ULL > deadlineNs - nowNs) {
+            sleepUs = (unsigned int)((deadlineNs - nowNs) / 1000ULL) + 1;
+        }
+        (void)usleep(sleepUs);
+
+        backoffUs = (backoffUs * 2 > IPCS_CONNECT_RETRY_MAX_US) ? IPCS_CONNECT_RETRY_MAX_US : backoffUs * 2;
+    }
+
+    if (result == IPCS_CONNECT_FAIL) {
+        errno = connErrno;
+        perror("client connect error");
+        IPCS_WriteLog("Connect client: %s server: %s fail after %u tries, errno: %d", clientName, serverName, tries,
+                connErrno);
+    } else if ((result == IPCS_OK) && (tries > 1)) {
+        IPCS_WriteLog("Connect client: %s server: %s success after %u tries.", clientName, serverName, tries);
+    }
+
+    return result;
+}
+
+int IPCS_ConnectClientSocket(const char *clientName, const char *serverName, int *clientFd, int *connErrno)
+{
+    struct sockaddr_un serverAddr;
+    socklen_t serverAddrLen = 0;
+    int connectFd = 0;
+    int result = 0;
+
+    connectFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connectFd < 0) {
+        perror("client socket error");
+        IPCS_WriteLog("Create client: %s server: %s socket fail: %d, errno: %d", clientName, serverName, connectFd, errno);
+        return IPCS_SOCKET_FAIL;
+    }
+
+    result = IPCS_BindClientSocket(clientName, connectFd);
+    if (result != IPCS_OK) {
+        (void)close(connectFd);
+        IPCS_WriteLog("Bind client: %s server: %s socket: %d fail: %d", clientName, serverName, connectFd, result);
+        return result;
+    }
+
+    (void)IPCS_FillSockAddr(serverName, &serverAddr, &serverAddrLen);
+    result = connect(connectFd, (struct sockaddr *)&serverAddr, serverAddrLen);
+    if (result < 0) {
+        *connErrno = errno;
+        (void)close(connectFd);
+        return IPCS_CONNECT_FAIL;
+    }
+
+    *clientFd = connectFd;
+    IPCS_WriteLog("IPC socket client: %s server: %s socket: %d created.", clientName, serverName, *clientFd);
+
+    return IPCS_OK;
+}
+
+/**
+ * 连接选项的协商：连接后、发出其他帧之前发送控制帧，参数为请求的帧选项，同步读出服务端的回复
+ * （回复帧不带选项），之后双向的帧按回复中同意的选项编码。此时连接上还没有其他帧，回复一定是第一帧。
+ **/
+int IPCS_ClientNegotiate(int fd, const IPCS_ClientAttr *attr, unsigned int *frameFlags)
+{
+    unsigned int request = 0;
+    unsigned int reply[3];
+    int result = IPCS_OK;
+
+    *frameFlags = 0;
+
+    if (attr != NULL) {
+        request = (attr->checksum ? IPCS_MSG_FLAG_CHECKSUM : 0) | (attr->compress ? IPCS_MSG_FLAG_COMPRESSED : 0);
+    }
+    if (request == 0) {
+        return IPCS_OK;
+    }
+
+    result = IPCS_SendControl(fd, IPCS_CTRL_OPTIONS, request);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    result = IPCS_ReadFull(fd, reply, sizeof(reply), IPCS_GetNowNs() + IPCS_OPTIONS_NEGOTIATE_MS * 1000000ULL);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d negotiate options: read reply fail: %d", fd, result);
+        return result;
+    }
+
+    if ((reply[0] != IPCS_CTRL_OPTIONS) || (reply[1] != ((unsigned int)sizeof(reply[2]) | IPCS_MSG_FLAG_CONTROL)) ||
+            ((reply[2] & ~request) != 0)) {
+        IPCS_WriteLog("Client: %d negotiate options: bad reply: %u, %#x, %#x", fd, reply[0], reply[1], reply[2]);
+        return IPCS_STREAM_BUF_BAD;
+    }
+    *frameFlags = reply[2];
+
+    IPCS_WriteLog("Client: %d negotiate options: request %#x, accepted %#x", fd, request, *frameFlags);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+/* 同步调用 */
+int IPCS_ClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg)
+{
+    return IPCS_ClientSyncCallTimeout(fd, sendMsg, recvMsg, IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS);
+}
+
+/**
+ * 请求带上新的调用ID，只接受ID相同的响应。之前超时的调用的响应迟到时仍在socket中，
+ * 按ID识别后丢弃，不会被当作本次调用的响应。
+ **/
+int IPCS_ClientSyncCallTimeout(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg, unsigned int timeoutMs)
+{
+    IPCS_BusyPoll *busyPoll = NULL;
+    unsigned int callId = IPCS_NewCallId();
+    unsigned int recvBufLen = 0;
+    uint64_t deadlineNs = 0;
+    uint64_t budgetNs = 0;
+    uint64_t sendNs = 0;
+    unsigned int sendFlags = 0;
+    int matched = 0;
+    int result = 0;
+
+    result = IPCS_CheckClientSyncCall(fd, sendMsg, recvMsg, &busyPoll, &sendFlags);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d sync call with bad params: %d", fd, result);
+        return result;
+    }
+
+    if (timeoutMs != 0) {
+        deadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    }
+
+    result = IPCS_SendFrame(IPCS_SYNC_CLIENT, fd, sendMsg, callId, IPCS_PRIO_NORMAL, sendFlags);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d sync call: send msg fail: %d", fd, result);
+        return result;
+    }
+
+    /* 响应通常在忙等期间到达，之后的read不会阻塞 */
+    if (busyPoll != NULL) {
+        sendNs = IPCS_GetNowNs();
+        budgetNs = IPCS_BusyPollBudget(busyPoll);
+        (void)IPCS_BusyPollFd(fd, budgetNs, deadlineNs);
+    }
+
+    recvBufLen = recvMsg->msgLen;
+    do {
+        result = IPCS_ClientSyncRecvFrame(fd, callId, deadlineNs, sendFlags & IPCS_FRAME_OPTIONS, recvMsg, recvBufLen,
+                &matched);
+    } while (!matched);
+
+    if ((busyPoll != NULL) && (result == IPCS_OK)) {
+        IPCS_BusyPollRecord(busyPoll, budgetNs, IPCS_GetNowNs() - sendNs);
+    }
+
+    return result;
+}
+
+/**
+ * 先在所有连接上发出请求，再用一个poll等待。每个调用有自己的调用ID，提前返回时没有等到的响应
+ * 留在socket中，由该连接的下一次同步调用按ID丢弃。
+ * 每个连接不阻塞地读进自己的缓冲区，一个服务端只发来半帧时不会阻塞其他连接或越过超时；
+ * 返回时读了半帧的连接已对不上帧边界，shutdown之后由调用方关闭。
+ **/
+int IPCS_ClientFanoutCall(IPCS_FanoutCall *calls, unsigned int callNum, IPCS_Message *sendMsg, unsigned int needNum,
+        unsigned int timeoutMs)
+{
+    struct pollfd pfds[IPCS_FANOUT_MAX_CALLS];
+    IPCS_FrameReader readers[IPCS_FANOUT_MAX_CALLS];
+    unsigned int callIds[IPCS_FANOUT_MAX_CALLS];
+    unsigned int recvBufLens[IPCS_FANOUT_MAX_CALLS];
+    unsigned int sendFlags[IPCS_FANOUT_MAX_CALLS];
+    unsigned int pending = 0;
+    unsigned int succeeded = 0;
+    unsigned int recvCallId = IPCS_NO_CALL_ID;
+    unsigned int i = 0;
+    uint64_t deadlineNs = 0;
+    uint64_t nowNs = 0;
+    int firstError = IPCS_OK;
+    int waitMs = -1;
+    int matched = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckClientFanoutCall(calls, callNum, sendMsg, sendFlags);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client fanout call with bad params: %d", result);
+        return result;
+    }
+
+    if ((needNum == 0) || (needNum > callNum)) {
+        needNum = callNum;
+    }
+    if (timeoutMs != 0) {
+        deadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    }
+
+    for (i = 0; i < callNum; i++) {
+        callIds[i] = IPCS_NewCallId();
+        recvBufLens[i] = calls[i].recvMsg->msgLen;
+        IPCS_FrameReaderInit(&readers[i]);
+        pfds[i].fd = -1;
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+
+        /* 积压的服务端不能阻塞其他连接的发送和整个调用的超时 */
+        calls[i].result = IPCS_SendFrame(IPCS_SYNC_CLIENT, calls[i].fd,
+                (calls[i].sendMsg != NULL) ? calls[i].sendMsg : sendMsg, callIds[i], IPCS_PRIO_NORMAL,
+                sendFlags[i] | IPCS_SEND_NO_WAIT);
+        if (calls[i].result != IPCS_OK) {
+            IPCS_WriteLog("Client: %d fanout call: send msg fail: %d", calls[i].fd, calls[i].result);
+            firstError = (firstError == IPCS_OK) ? calls[i].result : firstError;
+            continue;
+        }
+        calls[i].result = IPCS_TIMEOUT;
+        pfds[i].fd = calls[i].fd;
+        pending++;
+    }
+
+    /* 全部等待时等到所有调用完成；否则成功数达到needNum，或者剩下的调用都成功也不够时返回 */
+    while ((pending != 0) && (succeeded < needNum) && ((needNum == callNum) || (succeeded + pending >= needNum))) {
+        if (deadlineNs != 0) {
+            nowNs = IPCS_GetNowNs();
+            if (nowNs >= deadlineNs) {
+                break;
+            }
+            waitMs = (int)((deadlineNs - nowNs + 999999ULL) / 1000000ULL);
+        }
+
+        if (poll(pfds, callNum, waitMs) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            IPCS_WriteLog("Client fanout call poll fail, errno: %d", errno);
+            firstError = (firstError == IPCS_OK) ? IPCS_READ_FAIL : firstError;
+            break;
+        }
+
+        for (i = 0; i < callNum; i++) {
+            if ((pfds[i].fd < 0) || (pfds[i].revents == 0)) {
+                continue;
+            }
+
+            result = IPCS_FrameReaderRead(&readers[i], pfds[i].fd);
+            if (result == IPCS_STREAM_INCOMPLETE) {
+                continue;
+            }
+
+            recvCallId = IPCS_NO_CALL_ID;
+            calls[i].recvMsg->msgLen = recvBufLens[i];
+            if (result == IPCS_OK) {
+                result = IPCS_ParseSingleMsg(pfds[i].fd, readers[i].buf, readers[i].frameLen,
+                        sendFlags[i] & IPCS_FRAME_OPTIONS, calls[i].recvMsg, &recvCallId);
+                IPCS_FrameReaderNext(&readers[i]);
+            }
+            result = IPCS_ClientSyncMatchFrame(pfds[i].fd, callIds[i], result, recvCallId, calls[i].recvMsg,
+                    recvBufLens[i], &matched);
+            if (!matched) {
+                continue;
+            }
+
+            calls[i].result = result;
+            pfds[i].fd = -1;
+            pending--;
+            if (result == IPCS_OK) {
+                succeeded++;
+            } else {
+                firstError = (firstError == IPCS_OK) ? result : firstError;
+            }
+        }
+    }
+
+    for (i = 0; i < callNum; i++) {
+        if ((pfds[i].fd >= 0) && (readers[i].readLen != 0)) {
+            IPCS_WriteLog("Client: %d fanout call: return in the middle of a frame, shutdown", pfds[i].fd);
+            (void)shutdown(pfds[i].fd, SHUT_RDWR);
+        }
+        IPCS_FrameReaderFree(&readers[i]);
+    }
+
+    if (succeeded >= needNum) {
+        return IPCS_OK;
+    }
+
+    return (firstError != IPCS_OK) ? firstError : IPCS_TIMEOUT;
+}
+
+int IPCS_CheckClientFanoutCall(IPCS_FanoutCall *calls, unsigned int callNum, IPCS_Message *sendMsg,
+        unsigned int *sendFlags)
+{
+    IPCS_BusyPoll *busyPoll = NULL;
+    unsigned int i = 0;
+    unsigned int j = 0;
+    int result = IPCS_OK;
+
+    if (calls == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    if ((callNum == 0) || (callNum > IPCS_FANOUT_MAX_CALLS)) {
+        IPCS_WriteLog("Client fanout call with bad call num: %u", callNum);
+        return IPCS_PARAM_LEN;
+    }
+
+    for (i = 0; i < callNum; i++) {
+        result = IPCS_CheckClientSyncCall(calls[i].fd, (calls[i].sendMsg != NULL) ? calls[i].sendMsg : sendMsg,
+                calls[i].recvMsg, &busyPoll, &sendFlags[i]);
+        if (result != IPCS_OK) {
+            return result;
+        }
+
+        /* 同一连接上两个调用的响应会被互相当作迟到的响应丢弃 */
+        for (j = 0; j < i; j++) {
+            if (calls[j].fd == calls[i].fd) {
+                IPCS_WriteLog("Client fanout call with duplicate fd: %d", calls[i].fd);
+                return IPCS_EXIST;
+            }
+        }
+    }
+
+    return IPCS_OK;
+}
+
+/**
+ * 读出一帧：是本次调用的响应、错误帧或者读失败时*matched为1，返回调用的结果；
+ * 之前的调用迟到的响应或错误帧被丢弃，*matched为0，需要继续读。
+ **/
+int IPCS_ClientSyncRecvFrame(int fd, unsigned int callId, uint64_t deadlineNs, unsigned int frameOptions,
+        IPCS_Message *recvMsg, unsigned int recvBufLen, int *matched)
+{
+    unsigned int recvCallId = IPCS_NO_CALL_ID;
+    int result = IPCS_OK;
+
+    recvMsg->msgLen = recvBufLen;
+    result = IPCS_RecvSingleMsg(fd, deadlineNs, frameOptions, recvMsg, &recvCallId);
+
+    return IPCS_ClientSyncMatchFrame(fd, callId, result, recvCallId, recvMsg, recvBufLen, matched);
+}
+
+int IPCS_ClientSyncMatchFrame(int fd, unsigned int callId, int result, unsigned int recvCallId,
+        IPCS_Message *recvMsg, unsigned int recvBufLen, int *matched)
+{
+    *matched = 1;
+    if (((result == IPCS_BUF_TOO_SMALL) || (result == IPCS_OVERLOADED)) && (recvCallId != callId) &&
+            (recvCallId != IPCS_NO_CALL_ID)) {
+        /* 放不下的迟到响应、之前的调用迟到的错误帧已整帧读出，直接丢弃 */
+        *matched = 0;
+        return result;
+    }
+
+    if (result == IPCS_OVERLOADED) {
+        recvMsg->msgLen = recvBufLen;
+        IPCS_WriteLog("Client: %d sync call: %u rejected by server", fd, callId);
+        return result;
+    }
+
+    if (result != IPCS_OK) {
+        recvMsg->msgLen = recvBufLen;
+        IPCS_WriteLog("Client: %d sync call: resv single msg fail: %d", fd, result);
+        return result;
+    }
+
+    /* 不回显调用ID的服务端按原来的一问一答处理 */
+    if ((recvCallId != callId) && (recvCallId != IPCS_NO_CALL_ID)) {
+        IPCS_WriteLog("Client: %d sync call: %u discard late response: %u", fd, callId, recvCallId);
+        *matched = 0;
+    }
+
+    return result;
+}
+
+unsigned int IPCS_GetClientSendFlags(int fd)
+{
+    IPCS_ItemInfo itemInfo;
+
+    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
+    if (IPCS_FindItemsInfo(IPCS_SYNC_CLIENT, NULL, fd, &itemInfo) != IPCS_OK) {
+        return 0;
+    }
+
+    return itemInfo.frameFlags;
+}
+
+int IPCS_CheckClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg, IPCS_BusyPoll **busyPoll,
+        unsigned int *sendFlags)
+{
+    IPCS_ItemInfo itemInfo;
+    int result = IPCS_OK;
+
+    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
+    result = IPCS_FindItemsInfo(IPCS_SYNC_CLIENT, NULL, fd, &itemInfo);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client sync call with not exist fd: %d", fd);
+        return IPCS_NOT_FOUND;
+    }
+    *busyPoll = (IPCS_BusyPoll *)itemInfo.context;
+    *sendFlags = itemInfo.frameFlags;
+
+    result = IPCS_CheckMessage(sendMsg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d sync call with bad send msg: %d", fd, sendMsg);
+        return result;
+    }
+
+    result = IPCS_CheckMessage(recvMsg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d sync call with bad recv msg: %d", fd, recvMsg);
+        return result;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+/* 创建异步客户端 */
+int IPCS_CreateAsynClient(const char *clientName, const char *serverName, ClientCallback clientHook, int *fd)
+{
+    return IPCS_CreateAsynClientEx(clientName, serverName, clientHook, NULL, fd);
+}
+
+void IPCS_InitClientAttr(IPCS_ClientAttr *attr)
+{
+    if (attr == NULL) {
+        return;
+    }
+
+    (void)memset(attr, 0, sizeof(IPCS_ClientAttr));
+    attr->engine = IPCS_ENGINE_EPOLL;
+
+    return;
+}
+
+int IPCS_CreateAsynClientEx(const char *clientName, const char *serverName, ClientCallback clientHook,
+        const IPCS_ClientAttr *attr, int *fd)
+{
+    pthread_t threadId;
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+    int result = 0;
+    
+    /* NULL asyn client hook is allowed. */
+    result = IPCS_CheckCreatingClient(clientName, serverName, fd);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Check creating asyn client with bad params. Error: %d", result);
+        return result;
+    }
+
+    result = IPCS_CheckThreadAttr((attr != NULL) ? &attr->thread : NULL);
+    if (result != IPCS_OK) {
+        return result;
+    }
+    
+    result = IPCS_CreateClientSocketRetry(clientName, serverName, (attr != NULL) ? attr->connectTimeoutMs : 0, fd);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Create asyn client: %s, server: %s: create socket fail: %d.", clientName, serverName, result);
+        return result;
+    }
+
+    threadArg = IPCS_MallocAsynClientThreadArg(*fd, clientHook, attr);
+    if (threadArg == NULL) {
+        (void)close(*fd);
+        IPCS_WriteLog("Create asyn client: %s, server: %s, socket: %d: malloc fail.", clientName, serverName, *fd);
+        return IPCS_MALLOC_FAIL;
+    }
+
+    /* 接收线程启动之前协商，回复由本线程读出 */
+    result = IPCS_ClientNegotiate(*fd, attr, &threadArg->sendQueue.frameFlags);
+    if (result != IPCS_OK) {
+        (void)close(*fd);
+        IPCS_FreeAsynClientThreadArg(threadArg);
+        return result;
+    }
+
+    result = IPCS_CreateThreadEx(IPCS_AsynClientRun, threadArg, (attr != NULL) ? &attr->thread : NULL,
+            IPCS_CLIENT_THREAD_NAME, &threadId);
+    if (result != IPCS_OK) {
+        (void)close(*fd);
+        IPCS_FreeAsynClientThreadArg(threadArg);
+        IPCS_WriteLog("Create asyn client: %s, server: %s, socket: %d: create thread fail: %d.", clientName, serverName, *fd, result);
+        return result;
+    }
+
+    result = IPCS_AddAsynClientInfo(clientName, serverName, *fd, threadId, clientHook, threadArg);
+    if (result != IPCS_OK) {
+        IPCS_StopAsynClientThread(threadArg, threadId);
+        (void)close(*fd);
+        return result;
+    }
+
+    IPCS_WriteLog("Create asyn client: %s, server: %s, socket: %d: at thread %p success.", clientName, serverName, *fd, threadId);
+
+    return result;
+}
+
+IPCS_AsynClientThreadArg *IPCS_MallocAsynClientThreadArg(int fd, ClientCallback clientHook,
+        const IPCS_ClientAttr *attr)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+
+    threadArg = (IPCS_AsynClientThreadArg *)malloc(sizeof(IPCS_AsynClientThreadArg));
+    if (threadArg == NULL) {
+        return NULL;
+    }
+    (void)memset(threadArg, 0, sizeof(IPCS_AsynClientThreadArg));
+
+    threadArg->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (threadArg->wakeFd < 0) {
+        perror("eventfd error");
+        free(threadArg);
+        return NULL;
+    }
+
+    threadArg->fd = fd;
+    threadArg->engine = (attr != NULL) ? attr->engine : IPCS_ENGINE_EPOLL;
+    threadArg->clientHook = clientHook;
+    (void)pthread_mutex_init(&threadArg->mutex, NULL);
+    (void)pthread_cond_init(&threadArg->exitCond, NULL);
+    IPCS_TimerWheelInit(&threadArg->wheel, IPCS_TIMER_DEFAULT_TICK_NS, IPCS_GetNowNs());
+    IPCS_SendQueueInit(&threadArg->sendQueue);
+
+    return threadArg;
+}
+
+void IPCS_FreeAsynClientThreadArg(IPCS_AsynClientThreadArg *threadArg)
+{
+    IPCS_AsynCall *call = NULL;
+    unsigned int i = 0;
+
+    /* 销毁时未完成的调用直接释放，不调用超时回调 */
+    for (i = 0; i < IPCS_ASYN_CALL_HASH_SIZE; i++) {
+        while ((call = threadArg->calls[i]) != NULL) {
+            threadArg->calls[i] = call->next;
+            free(call);
+        }
+    }
+
+    while ((call = threadArg->expired) != NULL) {
+        threadArg->expired = call->next;
+        free(call);
+    }
+
+    (void)close(threadArg->wakeFd);
+    (void)pthread_mutex_destroy(&threadArg->mutex);
+    (void)pthread_cond_destroy(&threadArg->exitCond);
+    IPCS_SendQueueDestroy(&threadArg->sendQueue);
+    free(threadArg->recvBuf);
+    free(threadArg);
+
+    return;
+}
+
+/**
+ * 接收线程：等待客户端fd和wakeFd，等待时间取时间轮中最近的超时；
+ * 每轮先处理收到的响应，再推进时间轮，到期的调用在锁外调用超时回调。
+ * io_uring在接收线程内创建（只由一个线程提交请求），不可用时使用poll。
+ **/
+void *IPCS_AsynClientRun(void *arg)
+{
+    IPCS_AsynClientThreadArg *threadArg = (IPCS_AsynClientThreadArg *)arg;
+    int selfFree = 0;
+    int result = IPCS_URING_FAIL;
+
+    /* 接收缓冲区由接收线程分配，绑定CPU时按首次访问分配在本地NUMA节点 */
+    threadArg->recvBuf = (char *)malloc(IPCS_ASYN_RECV_BUF_LEN);
+    if (threadArg->recvBuf == NULL) {
+        IPCS_WriteLog("Asyn client: %d malloc recv buffer fail.", threadArg->fd);
+        result = IPCS_MALLOC_FAIL;
+    }
+
+    if ((threadArg->recvBuf != NULL) && (threadArg->engine == IPCS_ENGINE_URING)) {
+        result = IPCS_AsynClientUringLoop(threadArg);
+        if (result == IPCS_URING_FAIL) {
+            IPCS_WriteLog("Asyn client: %d io_uring fail, use poll.", threadArg->fd);
+        }
+    }
+
+    if (result == IPCS_URING_FAIL) {
+        (void)IPCS_AsynClientPollLoop(threadArg);
+    }
+
+    /* 连接断开后不再接受新的调用，未完成的调用立即按超时处理 */
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->closed = 1;
+    if (!threadArg->stopping) {
+        IPCS_AsynClientExpireAll(threadArg);
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    IPCS_AsynClientAdvance(threadArg);
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->exited = 1;
+    selfFree = threadArg->selfFree;
+    (void)pthread_cond_broadcast(&threadArg->exitCond);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (selfFree) {
+        IPCS_FreeAsynClientThreadArg(threadArg);
+    }
+
+    return NULL;
+}
+
+/* 计算本次等待的时间（毫秒），-1表示无限等待 */
+int IPCS_AsynClientNextWaitMs(IPCS_AsynClientThreadArg *threadArg)
+{
+    uint64_t nowNs = 0;
+    int waitMs = 0;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    nowNs = IPCS_GetNowNs();
+    waitMs = IPCS_TimerWheelNextTimeoutMs(&threadArg->wheel, nowNs);
+    threadArg->waitDeadlineNs = (waitMs < 0) ? 0 : (nowNs + (uint64_t)waitMs * 1000000ULL);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    return waitMs;
+}
+
+int IPCS_AsynClientPollLoop(IPCS_AsynClientThreadArg *threadArg)
+{
+    struct pollfd pfds[2];
+    uint64_t wakeValue = 0;
+    int waitMs = 0;
+    int result = IPCS_OK;
+
+    while (!threadArg->stopping) {
+        waitMs = IPCS_AsynClientNextWaitMs(threadArg);
+
+        pfds[0].fd = threadArg->fd;
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        pfds[1].fd = threadArg->wakeFd;
+        pfds[1].events = POLLIN;
+        pfds[1].revents = 0;
+
+        result = poll(pfds, 2, waitMs);
+        if ((result < 0) && (errno != EINTR)) {
+            IPCS_WriteLog("Asyn client: %d poll fail, errno: %d", threadArg->fd, errno);
+            return IPCS_EPOLL_WAIT_FAIL;
+        }
+        result = IPCS_OK;
+
+        if (pfds[1].revents & POLLIN) {
+            (void)read(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+        }
+
+        if (threadArg->stopping) {
+            break;
+        }
+
+        if (pfds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            result = IPCS_AsynClientRecv(threadArg);
+            if (result != IPCS_OK) {
+                break;
+            }
+        }
+
+        IPCS_AsynClientAdvance(threadArg);
+    }
+
+    return result;
+}
+
+/**
+ * io_uring接收循环：客户端fd上一个multishot recv（数据放在provided buffer ring中），
+ * wakeFd上一个multishot poll，超时通过io_uring_enter的等待时间实现。
+ * 创建失败时返回IPCS_URING_FAIL，由调用者改用poll。
+ **/
+int IPCS_AsynClientUringLoop(IPCS_AsynClientThreadArg *threadArg)
+{
+    IPCS_Uring ring;
+    IPCS_UringBufRing bufRing;
+    struct io_uring_cqe *cqe = NULL;
+    uint64_t userData = 0;
+    uint64_t wakeValue = 0;
+    unsigned int flags = 0;
+    int waitMs = 0;
+    int res = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_UringInit(&ring, IPCS_URING_ENTRIES);
+    if (result != IPCS_OK) {
+        return IPCS_URING_FAIL;
+    }
+
+    result = IPCS_UringBufRingInit(&ring, &bufRing, IPCS_ASYN_URING_BGID, IPCS_ASYN_URING_BUF_NUM,
+            IPCS_ASYN_URING_BUF_LEN);
+    if (result != IPCS_OK) {
+        IPCS_UringExit(&ring);
+        return IPCS_URING_FAIL;
+    }
+
+    result = IPCS_AsynClientUringArm(&ring, threadArg->fd, IPCS_URING_OP_RECV);
+    if (result == IPCS_OK) {
+        result = IPCS_AsynClientUringArm(&ring, threadArg->wakeFd, IPCS_URING_OP_WAKE);
+    }
+
+    while ((result == IPCS_OK) && !threadArg->stopping) {
+        waitMs = IPCS_AsynClientNextWaitMs(threadArg);
+
+        result = IPCS_UringSubmitAndWait(&ring, (waitMs != 0) ? 1 : 0,
+                (waitMs > 0) ? ((uint64_t)waitMs * 1000000ULL) : 0);
+        if (result != IPCS_OK) {
+            break;
+        }
+
+        while ((cqe = IPCS_UringPeekCqe(&ring)) != NULL) {
+            userData = cqe->user_data;
+            res = cqe->res;
+            flags = cqe->flags;
+            IPCS_UringCqAdvance(&ring, 1);
+
+            if (IPCS_URING_USER_OP(userData) == IPCS_URING_OP_WAKE) {
+                (void)read(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+                if (!(flags & IORING_CQE_F_MORE)) {
+                    result = IPCS_AsynClientUringArm(&ring, threadArg->wakeFd, IPCS_URING_OP_WAKE);
+                }
+            } else {
+                result = IPCS_AsynClientUringRecv(threadArg, &ring, &bufRing, res, flags);
+            }
+
+            if ((result != IPCS_OK) || threadArg->stopping) {
+                break;
+            }
+        }
+
+        if ((result != IPCS_OK) || threadArg->stopping) {
+            break;
+        }
+
+        IPCS_AsynClientAdvance(threadArg);
+    }
+
+    /* 先关闭ring，取消仍在使用provided buffer的请求 */
+    IPCS_UringExit(&ring);
+    IPCS_UringBufRingExit(&bufRing);
+
+    /* 运行中的错误不能再改用poll */
+    return (result == IPCS_URING_FAIL) ? IPCS_READ_FAIL : result;
+}
+
+int IPCS_AsynClientUringArm(IPCS_Uring *ring, int fd, unsigned int op)
+{
+    struct io_uring_sqe *sqe = IPCS_UringGetSqe(ring);
+
+    if (sqe == NULL) {
+        return IPCS_URING_FAIL;
+    }
+
+    if (op == IPCS_URING_OP_RECV) {
+        IPCS_UringPrepRecvMulti(sqe, fd, IPCS_ASYN_URING_BGID, IPCS_URING_USER_DATA(fd, op));
+    } else {
+        IPCS_UringPrepPollMulti(sqe, fd, POLLIN, IPCS_URING_USER_DATA(fd, op));
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_AsynClientUringRecv(IPCS_AsynClientThreadArg *threadArg, IPCS_Uring *ring, IPCS_UringBufRing *bufRing,
+        int res, unsigned int flags)
+{
+    unsigned int bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    int result = IPCS_OK;
+
+    if (res == -ENOBUFS) {
+        /* provided buffer暂时用完，重新提交recv */
+        return IPCS_AsynClientUringArm(ring, threadArg->fd, IPCS_URING_OP_RECV);
+    }
+
+    if (res == 0) {
+        /* 对端已关闭连接 */
+        return IPCS_PEER_CLOSED;
+    }
+
+    if (res < 0) {
+        IPCS_WriteLog("Asyn client: %d uring recv fail: %d", threadArg->fd, res);
+        return IPCS_READ_FAIL;
+    }
+
+    /* 接收缓冲区中剩余的不完整帧小于一帧，总能放下一个provided buffer */
+    (void)memcpy(threadArg->recvBuf + threadArg->recvLen, IPCS_UringBufRingGet(bufRing, bid), (size_t)res);
+    threadArg->recvLen += (size_t)res;
+    IPCS_UringBufRingRecycle(bufRing, bid);
+
+    result = IPCS_AsynClientHandleRecvData(threadArg);
+    if ((result == IPCS_OK) && !(flags & IORING_CQE_F_MORE)) {
+        result = IPCS_AsynClientUringArm(ring, threadArg->fd, IPCS_URING_OP_RECV);
+    }
+
+    return result;
+}
+
+int IPCS_AsynClientRecv(IPCS_AsynClientThreadArg *threadArg)
+{
+    ssize_t readLen = 0;
+
+    readLen = read(threadArg->fd, threadArg->recvBuf + threadArg->recvLen,
+            IPCS_ASYN_RECV_BUF_LEN - threadArg->recvLen);
+    if (readLen < 0) {
+        if ((errno == EAGAIN) || (errno == EINTR)) {
+            return IPCS_OK;
+        }
+        IPCS_WriteLog("Asyn client: %d read fail: %d, errno: %d", threadArg->fd, readLen, errno);
+        return IPCS_READ_FAIL;
+    }
+
+    if (readLen == 0) {
+        /* 对端已关闭连接 */
+        return IPCS_PEER_CLOSED;
+    }
+
+    threadArg->recvLen += (size_t)readLen;
+
+    return IPCS_AsynClientHandleRecvData(threadArg);
+}
+
+/* 一次读到的不完整的尾帧留在接收缓冲区，下次读到剩余部分后再处理 */
+int IPCS_AsynClientHandleRecvData(IPCS_AsynClientThreadArg *threadArg)
+{
+    size_t handledLen = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_HandleRecvDataEx(threadArg->recvBuf, threadArg->recvLen, IPCS_ASYN_CLIENT, threadArg->fd,
+            threadArg, &handledLen);
+    if (handledLen != 0) {
+        threadArg->recvLen -= handledLen;
+        (void)memmove(threadArg->recvBuf, threadArg->recvBuf + handledLen, threadArg->recvLen);
+    }
+
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Asyn client: %d handle recv data fail: %d", threadArg->fd, result);
+    }
+
+    return result;
+}
+
+void IPCS_AsynClientAdvance(IPCS_AsynClientThreadArg *threadArg)
+{
+    IPCS_AsynCall *list = NULL;
+    IPCS_AsynCall *call = NULL;
+    ClientTimeoutCallback timeoutHook = NULL;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    (void)IPCS_TimerWheelAdvance(&threadArg->wheel, IPCS_GetNowNs());
+    list = threadArg->expired;
+    threadArg->expired = NULL;
+    timeoutHook = threadArg->timeoutHook;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    while (list != NULL) {
+        call = list;
+        list = call->next;
+
+        if (timeoutHook != NULL) {
+            (void)timeoutHook(call->callId);
+        }
+        free(call);
+    }
+
+    return;
+}
+
+/* 持有mutex时调用，所有未完成的调用移到到期链表 */
+void IPCS_AsynClientExpireAll(IPCS_AsynClientThreadArg *threadArg)
+{
+    IPCS_AsynCall *call = NULL;
+    unsigned int i = 0;
+
+    for (i = 0; i < IPCS_ASYN_CALL_HASH_SIZE; i++) {
+        while ((call = threadArg->calls[i]) != NULL) {
+            threadArg->calls[i] = call->next;
+            IPCS_TimerWheelCancel(&threadArg->wheel, &call->timer);
+            call->next = threadArg->expired;
+            threadArg->expired = call;
+        }
+    }
+
+    return;
+}
+
+int IPCS_AsynClientHandleMsg(IPCS_AsynClientThreadArg *threadArg, IPCS_Message *msg, unsigned int callId)
+{
+    IPCS_AsynCall *call = NULL;
+    int result = IPCS_OK;
+
+    if (callId != IPCS_NO_CALL_ID) {
+        (void)pthread_mutex_lock(&threadArg->mutex);
+        call = IPCS_AsynCallUnlink(threadArg, callId);
+        if (call != NULL) {
+            IPCS_TimerWheelCancel(&threadArg->wheel, &call->timer);
+        }
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+
+        /* 已超时的调用的响应迟到，直接丢弃，不调用clientHook */
+        if (call == NULL) {
+            IPCS_WriteLog("Asyn client: %d discard late response: %u", threadArg->fd, callId);
+            return IPCS_OK;
+        }
+        free(call);
+    }
+
+    /* NULL asyn client hook is allowed. */
+    if (threadArg->clientHook != NULL) {
+        result = threadArg->clientHook(msg);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Asyn client: %d handle message: client hook fail: %d.", threadArg->fd, result);
+            result = IPCS_CLIENT_HOOK_FAIL;
+        }
+    }
+
+    return result;
+}
+
+/* 被拒绝的调用与收到响应一样结束，取消超时，之后交给拒绝回调而不是clientHook */
+int IPCS_AsynClientHandleReject(IPCS_AsynClientThreadArg *threadArg, IPCS_Message *msg, unsigned int callId,
+        int error)
+{
+    IPCS_AsynCall *call = NULL;
+    ClientRejectCallback rejectHook = NULL;
+    int result = IPCS_OK;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    if (callId != IPCS_NO_CALL_ID) {
+        call = IPCS_AsynCallUnlink(threadArg, callId);
+        if (call != NULL) {
+            IPCS_TimerWheelCancel(&threadArg->wheel, &call->timer);
+        }
+    }
+    rejectHook = threadArg->rejectHook;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if ((callId != IPCS_NO_CALL_ID) && (call == NULL)) {
+        IPCS_WriteLog("Asyn client: %d discard late reject: %u", threadArg->fd, callId);
+        return IPCS_OK;
+    }
+    free(call);
+
+    if (rejectHook != NULL) {
+        result = rejectHook(callId, msg->msgType, error);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Asyn client: %d handle reject: reject hook fail: %d.", threadArg->fd, result);
+            result = IPCS_CLIENT_HOOK_FAIL;
+        }
+    }
+
+    return result;
+}
+
+/* 在接收线程之外调用时等待接收线程退出后释放；在接收线程内（回调函数中）调用时由接收线程退出时释放 */
+void IPCS_StopAsynClientThread(IPCS_AsynClientThreadArg *threadArg, pthread_t pid)
+{
+    uint64_t wakeValue = 1;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->stopping = 1;
+    if (pthread_equal(pid, pthread_self())) {
+        threadArg->selfFree = 1;
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+        return;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    while (!threadArg->exited) {
+        (void)pthread_cond_wait(&threadArg->exitCond, &threadArg->mutex);
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    IPCS_FreeAsynClientThreadArg(threadArg);
+
+    return;
+}
+
+/******************************************************************************/
+/* 异步调用 */
+int IPCS_ClientAsynCall(int fd, IPCS_Message *sendMsg)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckClientAsynCall(fd, sendMsg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d asyn call with bad params: %d", fd, result);
+        return result;
+    }
+
+    result = IPCS_FindAsynClientArg(fd, &threadArg);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    result = IPCS_SendQueueMessage(&threadArg->sendQueue, IPCS_ASYN_CLIENT, fd, sendMsg, IPCS_NO_CALL_ID);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d asyn call: send msg fail: %d", fd, result);
+        return result;
+    }
+
+    return result;
+}
+
+/**
+ * 调用记录先加入哈希表和时间轮再发送，响应不会早于调用记录到达。
+ * 时间轮由接收线程驱动，新的超时早于接收线程本次的唤醒时间时通过wakeFd唤醒接收线程。
+ * 没有超时的调用不会被时间轮释放，服务端不回复时调用记录会一直留在哈希表中，所以不记录。
+ **/
+int IPCS_ClientAsynCallTimeout(int fd, IPCS_Message *sendMsg, unsigned int timeoutMs, unsigned int *callId)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+    IPCS_AsynCall *call = NULL;
+    uint64_t expireNs = 0;
+    uint64_t wakeValue = 1;
+    unsigned int id = 0;
+    int needWake = 0;
+    int result = IPCS_OK;
+
+    if (timeoutMs == 0) {
+        if (callId != NULL) {
+            *callId = IPCS_NO_CALL_ID;
+        }
+        return IPCS_ClientAsynCall(fd, sendMsg);
+    }
+
+    result = IPCS_CheckClientAsynCall(fd, sendMsg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d asyn call with bad params: %d", fd, result);
+        return result;
+    }
+
+    result = IPCS_FindAsynClientArg(fd, &threadArg);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    call = (IPCS_AsynCall *)malloc(sizeof(IPCS_AsynCall));
+    if (call == NULL) {
+        IPCS_WriteLog("Client: %d asyn call: malloc fail.", fd);
+        return IPCS_MALLOC_FAIL;
+    }
+    id = IPCS_NewCallId();
+    call->callId = id;
+    call->next = NULL;
+    IPCS_TimerNodeInit(&call->timer, IPCS_AsynCallExpire, threadArg);
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    if (threadArg->closed) {
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+        free(call);
+        IPCS_WriteLog("Client: %d asyn call: connection closed.", fd);
+        return IPCS_PEER_CLOSED;
+    }
+
+    IPCS_AsynCallLink(threadArg, call);
+    expireNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    /* 时间轮为空时接收线程可能长时间没有推进时间轮，先对齐到当前时间 */
+    if (threadArg->wheel.count == 0) {
+        (void)IPCS_TimerWheelAdvance(&threadArg->wheel, IPCS_GetNowNs());
+    }
+    IPCS_TimerWheelAdd(&threadArg->wheel, &call->timer, expireNs);
+    needWake = (threadArg->waitDeadlineNs == 0) || (expireNs < threadArg->waitDeadlineNs);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (needWake) {
+        (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    }
+
+    if (callId != NULL) {
+        *callId = id;
+    }
+
+    result = IPCS_SendQueueMessage(&threadArg->sendQueue, IPCS_ASYN_CLIENT, fd, sendMsg, id);
+    if (result != IPCS_OK) {
+        (void)pthread_mutex_lock(&threadArg->mutex);
+        call = IPCS_AsynCallUnlink(threadArg, id);
+        if (call != NULL) {
+            IPCS_TimerWheelCancel(&threadArg->wheel, &call->timer);
+        }
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+        free(call);
+
+        IPCS_WriteLog("Client: %d asyn call: send msg fail: %d", fd, result);
+        return result;
+    }
+
+    return result;
+}
+
+int IPCS_SetClientTimeoutHook(int fd, ClientTimeoutCallback timeoutHook)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+    int result = IPCS_OK;
+
+    result = IPCS_FindAsynClientArg(fd, &threadArg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Set timeout hook with not exist asyn client fd: %d", fd);
+        return result;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->timeoutHook = timeoutHook;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    return IPCS_OK;
+}
+
+int IPCS_SetClientRejectHook(int fd, ClientRejectCallback rejectHook)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+    int result = IPCS_OK;
+
+    result = IPCS_FindAsynClientArg(fd, &threadArg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Set reject hook with not exist asyn client fd: %d", fd);
+        return result;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->rejectHook = rejectHook;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    return IPCS_OK;
+}
+
+/* 订阅、取消订阅：向服务端发送控制帧，服务端发布的消息由接收线程交给clientHook */
+int IPCS_ClientSubscribe(int fd, unsigned int topic)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+
+    if (IPCS_FindAsynClientArg(fd, &threadArg) != IPCS_OK) {
+        IPCS_WriteLog("Subscribe with not exist asyn client fd: %d", fd);
+        return IPCS_NOT_FOUND;
+    }
+
+    return IPCS_SendQueueControl(&threadArg->sendQueue, fd, IPCS_CTRL_SUBSCRIBE, topic);
+}
+
+int IPCS_ClientUnsubscribe(int fd, unsigned int topic)
+{
+    IPCS_AsynClientThreadArg *threadArg = NULL;
+
+    if (IPCS_FindAsynClientArg(fd, &threadArg) != IPCS_OK) {
+        IPCS_WriteLog("Unsubscribe with not exist asyn client fd: %d", fd);
+        return IPCS_NOT_FOUND;
+    }
+
+    return IPCS_SendQueueControl(&threadArg->sendQueue, fd, IPCS_CTRL_UNSUBSCRIBE, topic);
+}
+
+int IPCS_CheckClientAsynCall(int fd, IPCS_Message *sendMsg)
+{
+    int result = IPCS_OK;
+
+    result = IPCS_IsItemExist(IPCS_ASYN_CLIENT, NULL, fd);
+    if (result == 0) {
+        IPCS_WriteLog("Client asyn call with not exist fd: %d", fd);
+        return IPCS_NOT_FOUND;
+    }
+
+    result = IPCS_CheckMessage(sendMsg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client: %d asyn call with bad send msg: %d", fd, sendMsg);
+        return result;
+    }
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+/* 销毁客户端 */
+int IPCS_DestroyClient(int fd)
+{
+    int result = 0;
+    IPCS_ItemInfo itemInfo;
+
+    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
+    result = IPCS_FindItemsInfo(IPCS_SYNC_CLIENT, NULL, fd, &itemInfo);
+    if (result != IPCS_OK) {
+        result = IPCS_FindItemsInfo(IPCS_ASYN_CLIENT, NULL, fd, &itemInfo);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Destroy client: %d not exist.", fd);
+            return IPCS_OK;
+        }
+    }
+
+    /* 先删除记录，之后的异步调用找不到该客户端；销毁时不能有其他线程正在使用该客户端 */
+    (void)IPCS_DelItemsInfo(itemInfo.type, NULL, fd);
+    IPCS_UnlinkSockName(itemInfo.name);
+
+    /* 通知接收线程退出，不使用pthread_cancel，避免线程在持有锁或回调函数中被取消 */
+    if (itemInfo.type == IPCS_ASYN_CLIENT) {
+        IPCS_StopAsynClientThread((IPCS_AsynClientThreadArg *)itemInfo.context, itemInfo.pid);
+    } else {
+        free(itemInfo.context);
+    }
+
+    result = close(fd);
+    if (result != 0) {
+        perror("close error");
+        IPCS_WriteLog("Destroy client: %d close fail, errno: %d", fd, errno);
+    } else {
+        IPCS_WriteLog("Destroy client: %d success", fd);
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+static unsigned int g_IpcsNextCallId = IPCS_NO_CALL_ID;
+
+unsigned int IPCS_NewCallId(void)
+{
+    unsigned int callId = IPCS_NO_CALL_ID;
+
+    do {
+        callId = __atomic_add_fetch(&g_IpcsNextCallId, 1, __ATOMIC_RELAXED);
+    } while (callId == IPCS_NO_CALL_ID);
+
+    return callId;
+}
+
+/* 时间轮回调，在接收线程中持有mutex时调用 */
+void IPCS_AsynCallExpire(IPCS_TimerNode *node, void *arg)
+{
+    IPCS_AsynClientThreadArg *threadArg = (IPCS_AsynClientThreadArg *)arg;
+    IPCS_AsynCall *call = (IPCS_AsynCall *)((char *)node - offsetof(IPCS_AsynCall, timer));
+
+    (void)IPCS_AsynCallUnlink(threadArg, call->callId);
+    call->next = threadArg->expired;
+    threadArg->expired = call;
+
+    return;
+}
+
+void IPCS_AsynCallLink(IPCS_AsynClientThreadArg *threadArg, IPCS_AsynCall *call)
+{
+    IPCS_AsynCall **head = &threadArg->calls[call->callId & (IPCS_ASYN_CALL_HASH_SIZE - 1)];
+
+    call->next = *head;
+    *head = call;
+
+    return;
+}
+
+IPCS_AsynCall *IPCS_AsynCallUnlink(IPCS_AsynClientThreadArg *threadArg, unsigned int callId)
+{
+    IPCS_AsynCall **pos = &threadArg->calls[callId & (IPCS_ASYN_CALL_HASH_SIZE - 1)];
+    IPCS_AsynCall *call = NULL;
+
+    for (; *pos != NULL; pos = &(*pos)->next) {
+        if ((*pos)->callId == callId) {
+            call = *pos;
+            *pos = call->next;
+            call->next = NULL;
+            break;
+        }
+    }
+
+    return call;
+}
+
+int IPCS_FindAsynClientArg(int fd, IPCS_AsynClientThreadArg **threadArg)
+{
+    IPCS_ItemInfo itemInfo;
+    int result = IPCS_OK;
+
+    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
+    result = IPCS_FindItemsInfo(IPCS_ASYN_CLIENT, NULL, fd, &itemInfo);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    *threadArg = (IPCS_AsynClientThreadArg *)itemInfo.context;
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+int IPCS_AddSyncClientInfo(const char *clientName, const char *serverName, int fd, IPCS_BusyPoll *busyPoll,
+        unsigned int frameFlags)
+{
+    IPCS_ItemInfo info;
+    int result = IPCS_OK;
+
+    (void)memset(&info, 0, sizeof(IPCS_ItemInfo));
+
+    info.type = IPCS_SYNC_CLIENT;
+    (void)IPCS_GetSockName(fd, info.name, sizeof(info.name));
+    (void)strcpy(info.peerName, serverName);
+    info.fd = fd;
+    info.context = busyPoll;
+    info.frameFlags = frameFlags;
+
+    result = IPCS_AddItemsInfo(&info);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Add sync client: %s, server: %s: socket: %d info fail: %d.", clientName, serverName, fd, result);
+    }
+
+    return result;
+}
+
+int IPCS_AddAsynClientInfo(const char *clientName, const char *serverName, int fd, pthread_t pid, ClientCallback hook,
+        IPCS_AsynClientThreadArg *threadArg)
+{
+    IPCS_ItemInfo info;
+    int result = IPCS_OK;
+
+    (void)memset(&info, 0, sizeof(IPCS_ItemInfo));
+
+    info.type = IPCS_ASYN_CLIENT;
+    (void)IPCS_GetSockName(fd, info.name, sizeof(info.name));
+    (void)strcpy(info.peerName, serverName);
+    info.fd = fd;
+    info.pid = pid;
+    info.hook = hook;
+    info.context = threadArg;
+
+    result = IPCS_AddItemsInfo(&info);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Add asyn client: %s, server: %s: socket: %d info fail: %d.", clientName, serverName, fd, result);
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
@@ -20,28 +20,157 @@
 #define __IPCS_CLIENT_H__
 
 #include "ipcs.h"
+#include "ipcs_busypoll.h"
 #include "ipcs_common.h"
+#include "ipcs_sendq.h"
+#include "ipcs_timer.h"
+#include "ipcs_uring.h"
+
+#include <pthread.h>
+#include <stdint.h>
 
 /******************************************************************************/
+#define IPCS_ASYN_CALL_HASH_SIZE    1024    /* 2的幂 */
+#define IPCS_ASYN_RECV_BUF_LEN      (2 * IPCS_FRAME_MAX_LEN)
+
+/* io_uring引擎：接收线程的provided buffer个数（2的幂）和大小 */
+#define IPCS_ASYN_URING_BUF_NUM     16
+#define IPCS_ASYN_URING_BUF_LEN     (16 * 1024)
+#define IPCS_ASYN_URING_BGID        0
+
+/* attr.connectTimeoutMs：连接失败后第一次等待的时间，之后每次加倍，不超过上限 */
+#define IPCS_CONNECT_RETRY_MIN_US   1000
+#define IPCS_CONNECT_RETRY_MAX_US   100000
+
+/* 等待服务端回复连接选项协商的时间 */
+#define IPCS_OPTIONS_NEGOTIATE_MS   1000
+
+/* 正在等待响应的异步调用，超时定时器挂在接收线程的时间轮上 */
+typedef struct IPCS_AsynCall {
+    unsigned int callId;
+    IPCS_TimerNode timer;
+    struct IPCS_AsynCall *next;
+} IPCS_AsynCall;
+
+/**
+ * 异步客户端的接收线程参数。
+ * 接收线程同时驱动时间轮：poll的等待时间取时间轮中最近的超时，调用方添加更早的超时时
+ * 通过eventfd唤醒接收线程。calls、wheel、waitDeadlineNs由mutex保护。
+ * 多个线程可以同时在一个异步客户端上调用，请求经sendQueue合并发送，不占用mutex。
+ **/
 typedef struct {
     int fd;
+    int wakeFd;
+    IPCS_Engine engine;
     ClientCallback clientHook;
+    ClientTimeoutCallback timeoutHook;
+    ClientRejectCallback rejectHook;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t exitCond;
+    IPCS_TimerWheel wheel;
+    IPCS_AsynCall *calls[IPCS_ASYN_CALL_HASH_SIZE];
+    IPCS_AsynCall *expired;         /* 本轮到期的调用，释放锁之后调用超时回调 */
+    uint64_t waitDeadlineNs;        /* 接收线程本次poll的唤醒时间，0表示无限等待 */
+    volatile int stopping;
+    int closed;                     /* 接收线程已退出循环，不再接受新的调用 */
+    int exited;
+    int selfFree;                   /* 在接收线程内销毁时，由接收线程退出时释放 */
+    IPCS_SendQueue sendQueue;
+
+    char *recvBuf;
+    size_t recvLen;
 } IPCS_AsynClientThreadArg;
 
 /******************************************************************************/
 int IPCS_CheckCreatingClient(const char *clientName, const char *serverName, int *fd);
 
+int IPCS_BindClientSocket(const char *clientName, int connectFd);
+
 int IPCS_CreateClientSocket(const char *clientName, const char *serverName, int *clientFd);
 
+/* timeoutMs不为0时，服务端还没有开始监听时按指数退避重试，最多等待timeoutMs毫秒 */
+int IPCS_CreateClientSocketRetry(const char *clientName, const char *serverName, unsigned int timeoutMs,
+        int *clientFd);
+
+/* 连接失败时返回IPCS_CONNECT_FAIL，*connErrno为connect的errno */
+int IPCS_ConnectClientSocket(const char *clientName, const char *serverName, int *clientFd, int *connErrno);
+
 void *IPCS_AsynClientRun(void *arg);
 
-int IPCS_CheckClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg);
+int IPCS_AsynClientPollLoop(IPCS_AsynClientThreadArg *threadArg);
+
+int IPCS_AsynClientUringLoop(IPCS_AsynClientThreadArg *threadArg);
+
+int IPCS_AsynClientUringArm(IPCS_Uring *ring, int fd, unsigned int op);
+
+int IPCS_AsynClientUringRecv(IPCS_AsynClientThreadArg *threadArg, IPCS_Uring *ring, IPCS_UringBufRing *bufRing,
+        int res, unsigned int flags);
+
+int IPCS_AsynClientRecv(IPCS_AsynClientThreadArg *threadArg);
+
+int IPCS_AsynClientHandleRecvData(IPCS_AsynClientThreadArg *threadArg);
+
+int IPCS_AsynClientNextWaitMs(IPCS_AsynClientThreadArg *threadArg);
+
+void IPCS_AsynClientAdvance(IPCS_AsynClientThreadArg *threadArg);
+
+void IPCS_AsynClientExpireAll(IPCS_AsynClientThreadArg *threadArg);
+
+int IPCS_AsynClientHandleMsg(IPCS_AsynClientThreadArg *threadArg, IPCS_Message *msg, unsigned int callId);
+
+int IPCS_AsynClientHandleReject(IPCS_AsynClientThreadArg *threadArg, IPCS_Message *msg, unsigned int callId,
+        int error);
+
+IPCS_AsynClientThreadArg *IPCS_MallocAsynClientThreadArg(int fd, ClientCallback clientHook,
+        const IPCS_ClientAttr *attr);
+
+void IPCS_FreeAsynClientThreadArg(IPCS_AsynClientThreadArg *threadArg);
+
+void IPCS_StopAsynClientThread(IPCS_AsynClientThreadArg *threadArg, pthread_t pid);
+
+/******************************************************************************/
+unsigned int IPCS_NewCallId(void);
+
+void IPCS_AsynCallExpire(IPCS_TimerNode *node, void *arg);
+
+void IPCS_AsynCallLink(IPCS_AsynClientThreadArg *threadArg, IPCS_AsynCall *call);
+
+IPCS_AsynCall *IPCS_AsynCallUnlink(IPCS_AsynClientThreadArg *threadArg, unsigned int callId);
+
+int IPCS_FindAsynClientArg(int fd, IPCS_AsynClientThreadArg **threadArg);
+
+/* 连接后按attr请求帧选项（校验和、压缩），*frameFlags返回服务端同意的选项；attr没有请求时不发送 */
+int IPCS_ClientNegotiate(int fd, const IPCS_ClientAttr *attr, unsigned int *frameFlags);
+
+/* 检查分散-聚合调用的参数：每个连接是同步客户端，请求和响应缓冲区有效，连接不重复 */
+int IPCS_CheckClientFanoutCall(IPCS_FanoutCall *calls, unsigned int callNum, IPCS_Message *sendMsg,
+        unsigned int *sendFlags);
+
+/* 同步调用读出一帧，*matched为0时读到的是之前的调用迟到的帧，需要继续读；
+ * frameOptions为连接上协商的帧选项（IPCS_GetClientSendFlags） */
+int IPCS_ClientSyncRecvFrame(int fd, unsigned int callId, uint64_t deadlineNs, unsigned int frameOptions,
+        IPCS_Message *recvMsg, unsigned int recvBufLen, int *matched);
+
+/* 按读出的帧的调用ID判断是否为本次调用的结果，result和recvCallId为读帧的结果 */
+int IPCS_ClientSyncMatchFrame(int fd, unsigned int callId, int result, unsigned int recvCallId,
+        IPCS_Message *recvMsg, unsigned int recvBufLen, int *matched);
+
+/* busyPoll返回同步客户端的忙等状态，没有配置忙等时为NULL；sendFlags返回发送请求时用的IPCS_SendFrame标志 */
+int IPCS_CheckClientSyncCall(int fd, IPCS_Message *sendMsg, IPCS_Message *recvMsg, IPCS_BusyPoll **busyPoll,
+        unsigned int *sendFlags);
+
+/* 同步客户端发送请求时用的IPCS_SendFrame标志 */
+unsigned int IPCS_GetClientSendFlags(int fd);
+
 int IPCS_CheckClientAsynCall(int fd, IPCS_Message *sendMsg);
 
 /******************************************************************************/
-int IPCS_AddSyncClientInfo(const char *clientName, const char *serverName, int fd);
+int IPCS_AddSyncClientInfo(const char *clientName, const char *serverName, int fd, IPCS_BusyPoll *busyPoll,
+        unsigned int frameFlags);
 
-int IPCS_AddAsynClientInfo(const char *clientName, const char *serverName, int fd, pthread_t pid, ClientCallback hook);
+int IPCS_AddAsynClientInfo(const char *clientName, const char *serverName, int fd, pthread_t pid, ClientCallback hook,
+        IPCS_AsynClientThreadArg *threadArg);
 
 /******************************************************************************/
 
@@ -19,8 +19,13 @@
 #include "ipcs_common.h"
 #include "ipcs_server.h"
 #include "ipcs_client.h"
+#include "ipcs_capture.h"
+#include "ipcs_crc.h"
+#include "ipcs_lz.h"
+#include "ipcs_thread.h"
 
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdarg.h>
 #include <stddef.h>
@@ -31,12 +36,23 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 
 /******************************************************************************/
 #define IPCS_LOG_LINE_MAX_LEN   1024
 #define IPCS_PRINT_LOG_LINE     printf
 
+/* 日志默认打开；压测时关闭，避免每条消息的日志输出影响测量结果 */
+static volatile int g_IpcsLogEnable = 1;
+
+void IPCS_EnableLog(int enable)
+{
+    g_IpcsLogEnable = enable;
+
+    return;
+}
+
 void IPCS_WriteLogImpl(const char *filename, unsigned int lineNum, const char *format, ...)
 {
     char *buf = NULL;
@@ -44,6 +60,10 @@ void IPCS_WriteLogImpl(const char *filename, unsigned int lineNum, const char *f
     int result = 0;
     va_list ap;
 
+    if (!g_IpcsLogEnable) {
+        return;
+    }
+
     buf = (char *)malloc(bufLen);
     if (buf == NULL) {
         perror("malloc log buf fail");
@@ -73,8 +93,25 @@ void IPCS_WriteLogImpl(const char *filename, unsigned int lineNum, const char *f
     return;
 }
 
+/******************************************************************************/
+uint64_t IPCS_GetNowNs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
 /******************************************************************************/
 int IPCS_CreateThread(void *(threadRunFunc)(void *), void *threadArg, pthread_t *threadId)
+{
+    return IPCS_CreateThreadEx(threadRunFunc, threadArg, NULL, NULL, threadId);
+}
+
+/* 按attr绑定CPU、设置线程名；attr为NULL时不绑定，defaultName为NULL时不设置线程名 */
+int IPCS_CreateThreadEx(void *(threadRunFunc)(void *), void *threadArg, const IPCS_ThreadAttr *attr,
+        const char *defaultName, pthread_t *threadId)
 {
     pthread_attr_t threadAttr;
     int result = 0;
@@ -96,6 +133,12 @@ int IPCS_CreateThread(void *(threadRunFunc)(void *), void *threadArg, pthread_t
         return IPCS_PTHREAD_ATTR_SET_FAIL;
     }
 
+    result = IPCS_ThreadAttrSetAffinity(&threadAttr, attr);
+    if (result != IPCS_OK) {
+        (void)pthread_attr_destroy(&threadAttr);
+        return result;
+    }
+
     result = pthread_create(threadId, &threadAttr, threadRunFunc, threadArg);
     if (result != 0) {
         (void)pthread_attr_destroy(&threadAttr);
@@ -112,27 +155,121 @@ int IPCS_CreateThread(void *(threadRunFunc)(void *), void *threadArg, pthread_t
         return IPCS_PTHREAD_ATTR_SET_FAIL;
     }
 
+    IPCS_ThreadSetName(*threadId, attr, defaultName);
+
     return IPCS_OK;
 }
 
+/******************************************************************************/
+/* 登记的高优先级消息类型；编码每一帧时都要查找，读取不加锁，新元素写入后才增加个数 */
+#define IPCS_PRIO_MAX_TYPES     64
+
+static unsigned int g_IpcsHighPrioTypes[IPCS_PRIO_MAX_TYPES];
+static unsigned int g_IpcsHighPrioNum = 0;
+static pthread_mutex_t g_IpcsPrioMutex = PTHREAD_MUTEX_INITIALIZER;
+
+int IPCS_SetMsgPriority(unsigned int msgType, IPCS_Priority prio)
+{
+    unsigned int num = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    (void)pthread_mutex_lock(&g_IpcsPrioMutex);
+    num = g_IpcsHighPrioNum;
+    for (i = 0; i < num; i++) {
+        if (g_IpcsHighPrioTypes[i] == msgType) {
+            break;
+        }
+    }
+
+    if (prio == IPCS_PRIO_HIGH) {
+        if (i < num) {
+            /* 已登记 */
+        } else if (num >= IPCS_PRIO_MAX_TYPES) {
+            result = IPCS_PRIO_TABLE_FULL;
+        } else {
+            g_IpcsHighPrioTypes[num] = msgType;
+            __atomic_store_n(&g_IpcsHighPrioNum, num + 1, __ATOMIC_RELEASE);
+        }
+    } else if (i < num) {
+        g_IpcsHighPrioTypes[i] = g_IpcsHighPrioTypes[num - 1];
+        __atomic_store_n(&g_IpcsHighPrioNum, num - 1, __ATOMIC_RELEASE);
+    }
+    (void)pthread_mutex_unlock(&g_IpcsPrioMutex);
+
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Set msg type: %u priority: %d fail: %d", msgType, prio, result);
+    }
+
+    return result;
+}
+
+IPCS_Priority IPCS_GetMsgPriority(unsigned int msgType)
+{
+    unsigned int num = __atomic_load_n(&g_IpcsHighPrioNum, __ATOMIC_ACQUIRE);
+    unsigned int i = 0;
+
+    for (i = 0; i < num; i++) {
+        if (g_IpcsHighPrioTypes[i] == msgType) {
+            return IPCS_PRIO_HIGH;
+        }
+    }
+
+    return IPCS_PRIO_NORMAL;
+}
+
 /******************************************************************************/
 int IPCS_MsgToStream(IPCS_Message *msg, void *streamBuf, unsigned int *bufLen)
 {
-    size_t msgHeaderLen = offsetof(IPCS_Message, msgValue);
-    unsigned int msgLen = msgHeaderLen + msg->msgLen;
+    return IPCS_MsgToStreamEx(msg, IPCS_NO_CALL_ID, streamBuf, bufLen);
+}
 
-    if (msgHeaderLen > *bufLen) {
+int IPCS_MsgToStreamEx(IPCS_Message *msg, unsigned int callId, void *streamBuf, unsigned int *bufLen)
+{
+    return IPCS_MsgToStreamPrio(msg, callId, IPCS_PRIO_NORMAL, streamBuf, bufLen);
+}
+
+int IPCS_MsgToStreamPrio(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio, void *streamBuf,
+        unsigned int *bufLen)
+{
+    return IPCS_MsgToStreamTime(msg, callId, prio, 0, streamBuf, bufLen);
+}
+
+int IPCS_MsgToStreamTime(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio, uint64_t sendNs,
+        void *streamBuf, unsigned int *bufLen)
+{
+    size_t msgHeaderLen = IPCS_MSG_HEADER_LEN;
+    size_t idLen = (callId != IPCS_NO_CALL_ID) ? IPCS_CALL_ID_LEN : 0;
+    size_t extLen = idLen + ((sendNs != 0) ? IPCS_SEND_TIME_LEN : 0);
+    unsigned int msgLen = msgHeaderLen + extLen + msg->msgLen;
+    IPCS_Message *header = (IPCS_Message *)streamBuf;
+
+    if (msgHeaderLen + extLen > *bufLen) {
         return IPCS_STREAM_BUF_BAD;
     }
 
-    if (msgLen > *bufLen) {
+    if ((msgLen > *bufLen) || ((msg->msgLen & IPCS_MSG_FLAGS_MASK) != 0)) {
         return IPCS_MSG_TOO_LONG;
     }
 
     (void)memcpy(streamBuf, msg, msgHeaderLen);
 
+    if ((prio == IPCS_PRIO_HIGH) || (IPCS_GetMsgPriority(msg->msgType) == IPCS_PRIO_HIGH)) {
+        header->msgLen |= IPCS_MSG_FLAG_PRIORITY;
+    }
+
+    if (idLen != 0) {
+        header->msgLen |= IPCS_MSG_FLAG_CALL_ID;
+        (void)memcpy((char *)streamBuf + msgHeaderLen, &callId, IPCS_CALL_ID_LEN);
+    }
+
+    if (sendNs != 0) {
+        header->msgLen |= IPCS_MSG_FLAG_SEND_TIME;
+        (void)memcpy((char *)streamBuf + msgHeaderLen + idLen, &sendNs, IPCS_SEND_TIME_LEN);
+    }
+
     if (msg->msgLen > 0) {
-        (void)memcpy((char *)streamBuf + msgHeaderLen, msg->msgValue, msg->msgLen);
+        (void)memcpy((char *)streamBuf + msgHeaderLen + extLen, msg->msgValue, msg->msgLen);
     }
 
     *bufLen = msgLen;
@@ -140,32 +277,285 @@ int IPCS_MsgToStream(IPCS_Message *msg, void *streamBuf, unsigned int *bufLen)
     return IPCS_OK;
 }
 
+int IPCS_MsgToStreamFlags(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio, uint64_t sendNs,
+        unsigned int frameFlags, void *streamBuf, unsigned int *bufLen)
+{
+    IPCS_Message *header = (IPCS_Message *)streamBuf;
+    IPCS_Message head;
+    unsigned int headLen = *bufLen;
+    unsigned int compLen = 0;
+    uint32_t rawLen = 0;
+    int result = IPCS_OK;
+
+    /* 先编码不带负载的帧头得到扩展字段的长度，压缩结果直接写在帧头之后；
+     * 要求缓冲区放得下未压缩的帧，压缩后的负载（含原始长度）必须比原负载小 */
+    if ((frameFlags & IPCS_MSG_FLAG_COMPRESSED) && (msg->msgLen >= IPCS_COMPRESS_MIN_LEN) &&
+            (msg->msgLen <= IPCS_MESSAGE_MAX_LEN)) {
+        head.msgType = msg->msgType;
+        head.msgLen = 0;
+        head.msgValue = NULL;
+        result = IPCS_MsgToStreamTime(&head, callId, prio, sendNs, streamBuf, &headLen);
+        if ((result == IPCS_OK) && (headLen + msg->msgLen <= *bufLen)) {
+            compLen = IPCS_LzCompress(msg->msgValue, msg->msgLen, (char *)streamBuf + headLen + IPCS_COMPRESS_RAW_LEN,
+                    msg->msgLen - IPCS_COMPRESS_RAW_LEN - 1);
+        }
+    }
+
+    if (compLen != 0) {
+        rawLen = msg->msgLen;
+        (void)memcpy((char *)streamBuf + headLen, &rawLen, IPCS_COMPRESS_RAW_LEN);
+        header->msgLen |= (IPCS_COMPRESS_RAW_LEN + compLen) | IPCS_MSG_FLAG_COMPRESSED;
+        *bufLen = headLen + IPCS_COMPRESS_RAW_LEN + compLen;
+    } else {
+        result = IPCS_MsgToStreamTime(msg, callId, prio, sendNs, streamBuf, bufLen);
+        if (result != IPCS_OK) {
+            return result;
+        }
+    }
+
+    header->msgLen |= frameFlags & IPCS_MSG_FLAGS_MASK & ~IPCS_FRAME_OPTIONS;
+    if (frameFlags & IPCS_MSG_FLAG_CHECKSUM) {
+        IPCS_FrameAddChecksum(streamBuf, bufLen);
+    }
+
+    return IPCS_OK;
+}
+
+IPCS_Priority IPCS_GetFramePriority(const void *streamBuf)
+{
+    return (((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAG_PRIORITY) ? IPCS_PRIO_HIGH : IPCS_PRIO_NORMAL;
+}
+
+unsigned int IPCS_GetFrameHeadLen(const void *streamBuf)
+{
+    unsigned int flags = ((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAGS_MASK;
+
+    return IPCS_MSG_HEADER_LEN + ((flags & IPCS_MSG_FLAG_CALL_ID) ? IPCS_CALL_ID_LEN : 0) +
+            ((flags & IPCS_MSG_FLAG_SEND_TIME) ? IPCS_SEND_TIME_LEN : 0);
+}
+
+uint64_t IPCS_GetFrameSendNs(const void *streamBuf)
+{
+    unsigned int flags = ((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAGS_MASK;
+    uint64_t sendNs = 0;
+
+    if (flags & IPCS_MSG_FLAG_SEND_TIME) {
+        (void)memcpy(&sendNs, (const char *)streamBuf + IPCS_MSG_HEADER_LEN +
+                ((flags & IPCS_MSG_FLAG_CALL_ID) ? IPCS_CALL_ID_LEN : 0), IPCS_SEND_TIME_LEN);
+    }
+
+    return sendNs;
+}
+
+int IPCS_GetFrameError(const void *streamBuf, unsigned int frameLen)
+{
+    unsigned int headLen = IPCS_GetFrameHeadLen(streamBuf);
+    int error = IPCS_OVERLOADED;
+
+    if (!(((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAG_ERROR)) {
+        return IPCS_OK;
+    }
+
+    /* 错误码缺失或为IPCS_OK的错误帧也按拒绝处理 */
+    if (frameLen >= headLen + sizeof(error)) {
+        (void)memcpy(&error, (const char *)streamBuf + headLen, sizeof(error));
+    }
+
+    return (error != IPCS_OK) ? error : IPCS_OVERLOADED;
+}
+
+unsigned int IPCS_GetFrameTailLen(const void *streamBuf)
+{
+    return (((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAG_CHECKSUM) ? IPCS_CHECKSUM_LEN : 0;
+}
+
+/* 接收方处理高优先级帧时会在帧头打上IPCS_MSG_FLAG_HANDLED，校验和不覆盖该标志 */
+static uint32_t IPCS_FrameChecksum(const void *streamBuf, unsigned int len)
+{
+    IPCS_Message header;
+    uint32_t crc = 0;
+
+    (void)memcpy(&header, streamBuf, IPCS_MSG_HEADER_LEN);
+    header.msgLen &= ~IPCS_MSG_FLAG_HANDLED;
+    crc = IPCS_Crc32c(0, &header, IPCS_MSG_HEADER_LEN);
+
+    return IPCS_Crc32c(crc, (const char *)streamBuf + IPCS_MSG_HEADER_LEN, len - IPCS_MSG_HEADER_LEN);
+}
+
+void IPCS_FrameAddChecksum(void *streamBuf, unsigned int *frameLen)
+{
+    uint32_t crc = 0;
+
+    ((IPCS_Message *)streamBuf)->msgLen |= IPCS_MSG_FLAG_CHECKSUM;
+    crc = IPCS_FrameChecksum(streamBuf, *frameLen);
+    (void)memcpy((char *)streamBuf + *frameLen, &crc, IPCS_CHECKSUM_LEN);
+    *frameLen += IPCS_CHECKSUM_LEN;
+
+    return;
+}
+
+int IPCS_FrameCheckChecksum(const void *streamBuf, unsigned int frameLen)
+{
+    uint32_t crc = 0;
+
+    if (!(((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAG_CHECKSUM)) {
+        return IPCS_OK;
+    }
+
+    if (frameLen < IPCS_MSG_HEADER_LEN + IPCS_CHECKSUM_LEN) {
+        return IPCS_CHECKSUM_FAIL;
+    }
+
+    (void)memcpy(&crc, (const char *)streamBuf + frameLen - IPCS_CHECKSUM_LEN, IPCS_CHECKSUM_LEN);
+    if (crc != IPCS_FrameChecksum(streamBuf, frameLen - IPCS_CHECKSUM_LEN)) {
+        return IPCS_CHECKSUM_FAIL;
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_GetFrameLen(const void *streamBuf, size_t bufLen, unsigned int *frameLen)
+{
+    unsigned int payloadLen = 0;
+
+    if (bufLen < IPCS_MSG_HEADER_LEN) {
+        return IPCS_STREAM_INCOMPLETE;
+    }
+
+    payloadLen = ((const IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_LEN_MASK;
+    if (payloadLen > IPCS_MESSAGE_MAX_LEN) {
+        return IPCS_MSG_TOO_LONG;
+    }
+
+    *frameLen = IPCS_GetFrameHeadLen(streamBuf) + payloadLen + IPCS_GetFrameTailLen(streamBuf);
+    if (bufLen < *frameLen) {
+        return IPCS_STREAM_INCOMPLETE;
+    }
+
+    return IPCS_OK;
+}
+
+/* 负载为4字节的原始长度加压缩数据；原始长度超过接收缓冲区时与未压缩的帧一样返回IPCS_BUF_TOO_SMALL */
+static int IPCS_FrameDecompress(const void *payload, unsigned int payloadLen, IPCS_Message *msg)
+{
+    uint32_t rawLen = 0;
+
+    if (payloadLen < IPCS_COMPRESS_RAW_LEN) {
+        return IPCS_STREAM_BUF_BAD;
+    }
+
+    (void)memcpy(&rawLen, payload, IPCS_COMPRESS_RAW_LEN);
+    if (rawLen > IPCS_MESSAGE_MAX_LEN) {
+        return IPCS_STREAM_BUF_BAD;
+    }
+
+    if (msg->msgLen < rawLen) {
+        return IPCS_BUF_TOO_SMALL;
+    }
+
+    if (IPCS_LzDecompress((const char *)payload + IPCS_COMPRESS_RAW_LEN, payloadLen - IPCS_COMPRESS_RAW_LEN,
+            msg->msgValue, rawLen) != (int)rawLen) {
+        return IPCS_STREAM_BUF_BAD;
+    }
+    msg->msgLen = rawLen;
+
+    return IPCS_OK;
+}
+
 int IPCS_StreamToMsg(void *streamBuf, unsigned int bufLen, IPCS_Message *msg)
 {
-    size_t msgHeaderLen = offsetof(IPCS_Message, msgValue);
+    return IPCS_StreamToMsgEx(streamBuf, bufLen, msg, NULL, NULL);
+}
+
+int IPCS_StreamToMsgEx(void *streamBuf, unsigned int bufLen, IPCS_Message *msg, unsigned int *callId,
+        unsigned int *frameLen)
+{
+    size_t msgHeaderLen = IPCS_MSG_HEADER_LEN;
+    const IPCS_Message *header = (const IPCS_Message *)streamBuf;
+    unsigned int headLen = 0;
+    unsigned int payloadLen = 0;
+    unsigned int tailLen = 0;
+    unsigned int id = IPCS_NO_CALL_ID;
+    int result = IPCS_OK;
 
     if (bufLen < msgHeaderLen) {
         return IPCS_STREAM_BUF_BAD;
     }
 
-    if (msg->msgLen < ((IPCS_Message *)streamBuf)->msgLen) {
+    /* 帧头中的长度来自对端，先检查上限和缓冲区中的数据是否够一帧，再按校验和检查内容 */
+    headLen = IPCS_GetFrameHeadLen(streamBuf);
+    payloadLen = header->msgLen & IPCS_MSG_LEN_MASK;
+    tailLen = IPCS_GetFrameTailLen(streamBuf);
+    if ((payloadLen > IPCS_MESSAGE_MAX_LEN) || (bufLen < headLen + payloadLen + tailLen)) {
+        return IPCS_STREAM_BUF_BAD;
+    }
+
+    result = IPCS_FrameCheckChecksum(streamBuf, headLen + payloadLen + tailLen);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    if (header->msgLen & IPCS_MSG_FLAG_CALL_ID) {
+        (void)memcpy(&id, (const char *)streamBuf + msgHeaderLen, IPCS_CALL_ID_LEN);
+    }
+
+    /* 调用ID和帧长在检查接收缓冲区之前返回，调用者据此跳过放不下的帧 */
+    if (callId != NULL) {
+        *callId = id;
+    }
+    if (frameLen != NULL) {
+        *frameLen = headLen + payloadLen + tailLen;
+    }
+
+    if (header->msgLen & IPCS_MSG_FLAG_COMPRESSED) {
+        result = IPCS_FrameDecompress((const char *)streamBuf + headLen, payloadLen, msg);
+        if (result == IPCS_OK) {
+            msg->msgType = header->msgType;
+        }
+        return result;
+    }
+
+    if (msg->msgLen < payloadLen) {
         return IPCS_BUF_TOO_SMALL;
     }
 
-    (void)memcpy(msg, streamBuf, msgHeaderLen);
+    msg->msgType = header->msgType;
+    msg->msgLen = payloadLen;
 
     if (msg->msgLen != 0) {
-        (void)memcpy(msg->msgValue, (char *)streamBuf + msgHeaderLen, msg->msgLen);
+        (void)memcpy(msg->msgValue, (const char *)streamBuf + headLen, msg->msgLen);
     }
 
     return IPCS_OK;
 }
 
 /******************************************************************************/
-int IPCS_SendMessage(int fd, IPCS_Message *msg)
+int IPCS_SendMessage(int itemType, int fd, IPCS_Message *msg)
+{
+    return IPCS_SendMessageEx(itemType, fd, msg, IPCS_NO_CALL_ID);
+}
+
+int IPCS_SendMessageEx(int itemType, int fd, IPCS_Message *msg, unsigned int callId)
+{
+    return IPCS_SendMessagePrio(itemType, fd, msg, callId, IPCS_PRIO_NORMAL);
+}
+
+int IPCS_SendMessagePrio(int itemType, int fd, IPCS_Message *msg, unsigned int callId, IPCS_Priority prio)
+{
+    return IPCS_SendFrame(itemType, fd, msg, callId, prio, 0);
+}
+
+/**
+ * 客户端的请求带上发送时间，服务端据此计算排队时间；同一台主机上两端的CLOCK_MONOTONIC相同。
+ * 不阻塞时一个字节都没有发出才返回IPCS_OVERLOADED，已经发出一部分时阻塞发完，保证帧完整。
+ **/
+int IPCS_SendFrame(int itemType, int fd, IPCS_Message *msg, unsigned int callId, IPCS_Priority prio,
+        unsigned int sendFlags)
 {
-    unsigned int streamBufLen = IPCS_MESSAGE_MAX_LEN;
+    int noWait = ((sendFlags & IPCS_SEND_NO_WAIT) != 0);
+    unsigned int streamBufLen = IPCS_FRAME_MAX_LEN;
     void *streamBuf = NULL;
+    uint64_t sendNs = 0;
     int result = IPCS_OK;
     ssize_t writeLen = 0;
 
@@ -176,20 +566,36 @@ int IPCS_SendMessage(int fd, IPCS_Message *msg)
         return IPCS_MALLOC_FAIL;
     }
 
+    if (itemType != IPCS_SERVER) {
+        sendNs = IPCS_GetNowNs();
+    }
+
     do {
-        result = IPCS_MsgToStream(msg, streamBuf, &streamBufLen);
+        result = IPCS_MsgToStreamFlags(msg, callId, prio, sendNs, sendFlags & IPCS_FRAME_OPTIONS, streamBuf,
+                &streamBufLen);
         if (result != IPCS_OK) {
             IPCS_WriteLog("Send message: msg to stream fail: %d, fd: %d.", result, fd);
             break;
         }
 
-        writeLen = write(fd, streamBuf, streamBufLen);
+        /* 对端已关闭时返回错误而不是触发SIGPIPE，连接池据此换用其他服务端 */
+        writeLen = send(fd, streamBuf, streamBufLen, MSG_NOSIGNAL | (noWait ? MSG_DONTWAIT : 0));
+        if (noWait && (writeLen < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+            IPCS_WriteLog("Send message: fd: %d send buffer full", fd);
+            result = IPCS_OVERLOADED;
+            break;
+        }
+        if (noWait && (writeLen > 0) && ((unsigned int)writeLen < streamBufLen)) {
+            writeLen = send(fd, (char *)streamBuf + writeLen, streamBufLen - (unsigned int)writeLen, MSG_NOSIGNAL);
+        }
         if (writeLen <= 0) {
             perror("write error");
             IPCS_WriteLog("Send message: write fd: %d fail: %d, errno: %d", fd, writeLen, errno);
             result = IPCS_WRITE_FAIL;
             break;
         }
+
+        IPCS_CaptureFrame(IPCS_CAPTURE_TX, itemType, fd, msg);
     } while (0);
 
     free(streamBuf);
@@ -197,12 +603,97 @@ int IPCS_SendMessage(int fd, IPCS_Message *msg)
     return result;
 }
 
-int IPCS_RecvSingleMsg(int fd, IPCS_Message *recvMsg)
+int IPCS_SendControl(int fd, unsigned int ctrlType, unsigned int value)
+{
+    unsigned int frame[3];
+    size_t sentLen = 0;
+    ssize_t writeLen = 0;
+
+    /* msgType + msgLen（带控制标志）+ 4字节参数 */
+    frame[0] = ctrlType;
+    frame[1] = (unsigned int)sizeof(value) | IPCS_MSG_FLAG_CONTROL;
+    frame[2] = value;
+
+    /* 对端已关闭时返回错误而不是触发SIGPIPE；少发时从中断处接着发 */
+    while (sentLen < sizeof(frame)) {
+        writeLen = send(fd, (char *)frame + sentLen, sizeof(frame) - sentLen, MSG_NOSIGNAL);
+        if (writeLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            IPCS_WriteLog("Send control: %u to fd: %d fail, errno: %d", ctrlType, fd, errno);
+            return IPCS_WRITE_FAIL;
+        }
+        sentLen += (size_t)writeLen;
+    }
+
+    return IPCS_OK;
+}
+
+/* 阻塞读满len字节；deadlineNs不为0时最多等到deadlineNs，包括读了一部分之后 */
+int IPCS_ReadFull(int fd, void *buf, size_t len, uint64_t deadlineNs)
+{
+    struct pollfd pfd;
+    size_t done = 0;
+    ssize_t readLen = 0;
+    uint64_t nowNs = 0;
+    int waitMs = 0;
+    int result = 0;
+
+    while (done < len) {
+        /* 有期限时先不阻塞地读，读不到再poll等到期限，帧的后半段迟迟不到也不会越过期限 */
+        if (deadlineNs != 0) {
+            readLen = recv(fd, (char *)buf + done, len - done, MSG_DONTWAIT);
+        } else {
+            readLen = read(fd, (char *)buf + done, len - done);
+        }
+        if (readLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN) && (deadlineNs != 0)) {
+                nowNs = IPCS_GetNowNs();
+                if (nowNs >= deadlineNs) {
+                    return (done == 0) ? IPCS_TIMEOUT : IPCS_STREAM_INCOMPLETE;
+                }
+                waitMs = (int)((deadlineNs - nowNs + 999999ULL) / 1000000ULL);
+
+                pfd.fd = fd;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+                result = poll(&pfd, 1, waitMs);
+                if ((result < 0) && (errno != EINTR)) {
+                    IPCS_WriteLog("Fd: %d read full: poll fail, errno: %d", fd, errno);
+                    return IPCS_READ_FAIL;
+                }
+                continue;
+            }
+            if (errno == EAGAIN) {
+                continue;
+            }
+            IPCS_WriteLog("Fd: %d read full: read fail: %d, errno: %d", fd, readLen, errno);
+            return IPCS_READ_FAIL;
+        }
+
+        if (readLen == 0) {
+            return IPCS_PEER_CLOSED;
+        }
+
+        done += (size_t)readLen;
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_RecvSingleMsg(int fd, uint64_t deadlineNs, unsigned int frameOptions, IPCS_Message *recvMsg,
+        unsigned int *callId)
 {
     int result = 0;
     void *streamBuf = NULL;
-    unsigned int bufLen = IPCS_MESSAGE_MAX_LEN;
-    ssize_t readLen = 0;
+    unsigned int bufLen = IPCS_FRAME_MAX_LEN;
+    unsigned int headLen = 0;
+    unsigned int payloadLen = 0;
+    unsigned int frameLen = 0;
 
     streamBuf = malloc(bufLen);
     if (streamBuf == NULL) {
@@ -210,30 +701,154 @@ int IPCS_RecvSingleMsg(int fd, IPCS_Message *recvMsg)
         IPCS_WriteLog("Fd: %d recv single msg: malloc fail.", fd);
         return IPCS_MALLOC_FAIL;
     }
-    (void)memset(streamBuf, 0, bufLen);
 
+    /* 按帧头中的长度读，一次只读一帧，不会把下一帧（例如迟到的响应之后的响应）读走 */
     do {
-        (void)memset(streamBuf, 0, bufLen);
-        readLen = read(fd, streamBuf, bufLen);
-        if (readLen <= 0) {
-            perror("read error");
-            IPCS_WriteLog("Fd: %d recv single msg: read fail: %d, errno: %d", fd, readLen, errno);
-            result = IPCS_READ_FAIL;
+        result = IPCS_ReadFull(fd, streamBuf, IPCS_MSG_HEADER_LEN, deadlineNs);
+        if (result != IPCS_OK) {
+            if ((result != IPCS_TIMEOUT) && (result != IPCS_STREAM_INCOMPLETE)) {
+                IPCS_WriteLog("Fd: %d recv single msg: read header fail: %d", fd, result);
+            }
             break;
         }
 
-        result = IPCS_StreamToMsg(streamBuf, readLen, recvMsg);
+        headLen = IPCS_GetFrameHeadLen(streamBuf);
+        payloadLen = ((IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_LEN_MASK;
+        if (payloadLen > IPCS_MESSAGE_MAX_LEN) {
+            IPCS_WriteLog("Fd: %d recv single msg: bad msg len: %u", fd, payloadLen);
+            result = IPCS_FRAME_BAD;
+            break;
+        }
+
+        frameLen = headLen + payloadLen + IPCS_GetFrameTailLen(streamBuf);
+        result = IPCS_ReadFull(fd, (char *)streamBuf + IPCS_MSG_HEADER_LEN, frameLen - IPCS_MSG_HEADER_LEN,
+                deadlineNs);
+        if (result == IPCS_TIMEOUT) {
+            result = IPCS_STREAM_INCOMPLETE;
+        }
         if (result != IPCS_OK) {
-            IPCS_WriteLog("Fd: %d recv single msg: stream to msg fail: %d", fd, result);
+            IPCS_WriteLog("Fd: %d recv single msg: read body fail: %d", fd, result);
             break;
         }
+
+        result = IPCS_ParseSingleMsg(fd, streamBuf, frameLen, frameOptions, recvMsg, callId);
     } while (0);
 
     free(streamBuf);
 
+    /* 读了半帧时到期，剩下的半帧以后才到，流已经对不上帧边界；关闭读写两端，之后的调用失败，
+     * 由调用方关闭连接（连接池按写失败重新连接） */
+    if (result == IPCS_STREAM_INCOMPLETE) {
+        IPCS_WriteLog("Fd: %d recv single msg: deadline in the middle of a frame, shutdown", fd);
+        (void)shutdown(fd, SHUT_RDWR);
+        result = IPCS_TIMEOUT;
+    }
+
     return result;
 }
 
+int IPCS_ParseSingleMsg(int fd, void *streamBuf, unsigned int frameLen, unsigned int frameOptions,
+        IPCS_Message *recvMsg, unsigned int *callId)
+{
+    int result = IPCS_OK;
+
+    if ((((IPCS_Message *)streamBuf)->msgLen & IPCS_FRAME_OPTIONS) & ~frameOptions) {
+        IPCS_WriteLog("Fd: %d recv single msg: frame options not negotiated: %#x", fd,
+                ((IPCS_Message *)streamBuf)->msgLen & IPCS_FRAME_OPTIONS);
+        return IPCS_FRAME_BAD;
+    }
+
+    result = IPCS_StreamToMsgEx(streamBuf, frameLen, recvMsg, callId, NULL);
+    if ((result != IPCS_CHECKSUM_FAIL) && (((IPCS_Message *)streamBuf)->msgLen & IPCS_MSG_FLAG_ERROR)) {
+        /* 请求被拒绝，返回错误帧中的错误码，callId用于识别迟到的错误帧 */
+        return IPCS_GetFrameError(streamBuf, frameLen);
+    }
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Fd: %d recv single msg: stream to msg fail: %d", fd, result);
+        /* 与服务端、异步客户端相同：校验和与缓冲区大小以外的解析错误都是对端发来的帧格式不对 */
+        return (result == IPCS_STREAM_BUF_BAD) ? IPCS_FRAME_BAD : result;
+    }
+
+    IPCS_CaptureFrame(IPCS_CAPTURE_RX, IPCS_SYNC_CLIENT, fd, recvMsg);
+
+    return result;
+}
+
+/******************************************************************************/
+void IPCS_FrameReaderInit(IPCS_FrameReader *reader)
+{
+    (void)memset(reader, 0, sizeof(IPCS_FrameReader));
+
+    return;
+}
+
+void IPCS_FrameReaderFree(IPCS_FrameReader *reader)
+{
+    free(reader->buf);
+    reader->buf = NULL;
+    reader->readLen = 0;
+    reader->frameLen = 0;
+
+    return;
+}
+
+/* 先读帧头，知道帧长后只读到帧尾，不会把下一帧读走 */
+int IPCS_FrameReaderRead(IPCS_FrameReader *reader, int fd)
+{
+    unsigned int wantLen = 0;
+    unsigned int payloadLen = 0;
+    ssize_t readLen = 0;
+
+    if (reader->buf == NULL) {
+        reader->buf = malloc(IPCS_FRAME_MAX_LEN);
+        if (reader->buf == NULL) {
+            IPCS_WriteLog("Fd: %d frame reader: malloc fail.", fd);
+            return IPCS_MALLOC_FAIL;
+        }
+    }
+
+    for (;;) {
+        wantLen = (reader->frameLen == 0) ? (unsigned int)IPCS_MSG_HEADER_LEN : reader->frameLen;
+        if ((reader->frameLen != 0) && (reader->readLen == wantLen)) {
+            return IPCS_OK;
+        }
+
+        readLen = recv(fd, (char *)reader->buf + reader->readLen, wantLen - reader->readLen, MSG_DONTWAIT);
+        if (readLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return IPCS_STREAM_INCOMPLETE;
+            }
+            IPCS_WriteLog("Fd: %d frame reader: recv fail, errno: %d", fd, errno);
+            return IPCS_READ_FAIL;
+        }
+        if (readLen == 0) {
+            return IPCS_PEER_CLOSED;
+        }
+        reader->readLen += (unsigned int)readLen;
+
+        if ((reader->frameLen == 0) && (reader->readLen == IPCS_MSG_HEADER_LEN)) {
+            payloadLen = ((IPCS_Message *)reader->buf)->msgLen & IPCS_MSG_LEN_MASK;
+            if (payloadLen > IPCS_MESSAGE_MAX_LEN) {
+                IPCS_WriteLog("Fd: %d frame reader: bad msg len: %u", fd, payloadLen);
+                return IPCS_FRAME_BAD;
+            }
+            reader->frameLen = IPCS_GetFrameHeadLen(reader->buf) + payloadLen + IPCS_GetFrameTailLen(reader->buf);
+        }
+    }
+}
+
+void IPCS_FrameReaderNext(IPCS_FrameReader *reader)
+{
+    reader->readLen = 0;
+    reader->frameLen = 0;
+
+    return;
+}
+
+/******************************************************************************/
 int IPCS_RecvMultiMsg(int itemType, int fd, void *threadArg)
 {
     void *recvBuf = NULL;
@@ -252,12 +867,17 @@ int IPCS_RecvMultiMsg(int itemType, int fd, void *threadArg)
         (void)memset(recvBuf, 0, recvBufLen);
         recvLen = read(fd, recvBuf, recvBufLen);
         if (recvLen < 0) {
-            if (errno != EAGAIN) {
+            if ((errno != EAGAIN) && (errno != EINTR)) {
                 IPCS_WriteLog("Fd: %d recv multi msg: read fail: %d, errno: %d", fd, recvLen, errno);
-                break;
+                result = IPCS_READ_FAIL;
             }
-        } else if (recvLen == 0) {
-            continue;
+            break;
+        }
+
+        if (recvLen == 0) {
+            /* 对端已关闭连接 */
+            result = IPCS_PEER_CLOSED;
+            break;
         }
 
         result = IPCS_HandleRecvData(recvBuf, recvLen, itemType, fd, threadArg);
@@ -273,56 +893,160 @@ int IPCS_RecvMultiMsg(int itemType, int fd, void *threadArg)
 }
 
 int IPCS_HandleRecvData(void *recvData, size_t recvDataLen, int itemType, int fd, void *threadArg)
+{
+    size_t handledLen = 0;
+
+    return IPCS_HandleRecvDataEx(recvData, recvDataLen, itemType, fd, threadArg, &handledLen);
+}
+
+int IPCS_HandleRecvDataEx(void *recvData, size_t recvDataLen, int itemType, int fd, void *threadArg,
+        size_t *handledLen)
 {
     char *leftData = recvData;
     size_t leftDataLen = recvDataLen;
-    size_t msgHeaderLen = offsetof(IPCS_Message, msgValue);
-    int result = 0;
-    IPCS_Message msg;
-    unsigned int offset = 0;
+    int result = IPCS_OK;
+    unsigned int frameLen = 0;
     void *msgBuf = NULL;
-    unsigned int msgBufLen = IPCS_MESSAGE_MAX_LEN;
 
-    msgBuf = malloc(msgBufLen);
+    *handledLen = 0;
+
+    result = IPCS_HandleHighPrioFrames(recvData, recvDataLen, itemType, fd, threadArg);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    msgBuf = malloc(IPCS_MESSAGE_MAX_LEN);
     if (msgBuf == NULL) {
         IPCS_WriteLog("Handle recv data: malloc fail.");
         return IPCS_MALLOC_FAIL;
     }
 
-    while (leftDataLen > msgHeaderLen) {
-        msg.msgType = 0;
-        msg.msgLen = msgBufLen;
-        msg.msgValue = msgBuf;
-
-        result = IPCS_StreamToMsg(leftData, leftDataLen, &msg);
-        if (result != IPCS_OK) {
-            IPCS_WriteLog("Handle recv data: stream to msg fail: %d.", result);
+    while (leftDataLen >= IPCS_MSG_HEADER_LEN) {
+        result = IPCS_GetFrameLen(leftData, leftDataLen, &frameLen);
+        if (result == IPCS_STREAM_INCOMPLETE) {
+            result = IPCS_OK;
             break;
         }
-
-        result = IPCS_ItemHandleMsg(itemType, fd, threadArg, &msg);
         if (result != IPCS_OK) {
+            IPCS_WriteLog("Handle recv data: bad frame: %d.", result);
+            result = IPCS_FRAME_BAD;
             break;
         }
 
-        offset = msgHeaderLen + msg.msgLen;
-        leftData += offset;
-        leftDataLen -= offset;
+        /* 已提前处理的高优先级帧只需要跳过 */
+        if (!(((IPCS_Message *)leftData)->msgLen & IPCS_MSG_FLAG_HANDLED)) {
+            result = IPCS_DispatchFrame(leftData, frameLen, itemType, fd, threadArg, msgBuf);
+            if (result != IPCS_OK) {
+                break;
+            }
+        }
+
+        leftData += frameLen;
+        leftDataLen -= frameLen;
     }
 
+    *handledLen = recvDataLen - leftDataLen;
     free(msgBuf);
 
     return result;
 }
 
-int IPCS_ItemHandleMsg(int itemType, int fd, void *threadArg, IPCS_Message *msg)
+/**
+ * 同一个缓冲区中的高优先级帧先于排在它前面的普通帧处理。处理前先打上已处理标记，
+ * 回调函数失败时也不会再处理一次；帧仍留在缓冲区中，由IPCS_HandleRecvDataEx按顺序删除。
+ **/
+int IPCS_HandleHighPrioFrames(void *recvData, size_t recvDataLen, int itemType, int fd, void *threadArg)
 {
+    char *leftData = recvData;
+    size_t leftDataLen = recvDataLen;
+    IPCS_Message *header = NULL;
+    unsigned int frameLen = 0;
+    void *msgBuf = NULL;
+    int result = IPCS_OK;
+
+    while (IPCS_GetFrameLen(leftData, leftDataLen, &frameLen) == IPCS_OK) {
+        header = (IPCS_Message *)leftData;
+        if ((header->msgLen & (IPCS_MSG_FLAG_PRIORITY | IPCS_MSG_FLAG_HANDLED)) == IPCS_MSG_FLAG_PRIORITY) {
+            if (msgBuf == NULL) {
+                msgBuf = malloc(IPCS_MESSAGE_MAX_LEN);
+                if (msgBuf == NULL) {
+                    IPCS_WriteLog("Handle high priority frames: malloc fail.");
+                    return IPCS_MALLOC_FAIL;
+                }
+            }
+
+            header->msgLen |= IPCS_MSG_FLAG_HANDLED;
+            result = IPCS_DispatchFrame(leftData, frameLen, itemType, fd, threadArg, msgBuf);
+            if (result != IPCS_OK) {
+                break;
+            }
+        }
+
+        leftData += frameLen;
+        leftDataLen -= frameLen;
+    }
+
+    free(msgBuf);
+
+    return result;
+}
+
+int IPCS_DispatchFrame(void *frame, unsigned int frameLen, int itemType, int fd, void *threadArg, void *msgBuf)
+{
+    IPCS_Message msg;
+    unsigned int callId = IPCS_NO_CALL_ID;
+    int result = IPCS_OK;
+
+    msg.msgType = 0;
+    msg.msgLen = IPCS_MESSAGE_MAX_LEN;
+    msg.msgValue = msgBuf;
+
+    /* 没有协商的选项不解析，未协商压缩的对端不能让本端解压 */
+    if ((((IPCS_Message *)frame)->msgLen & IPCS_FRAME_OPTIONS) & ~IPCS_ItemFrameOptions(itemType, fd, threadArg)) {
+        IPCS_WriteLog("Handle recv data: fd: %d frame options not negotiated: %#x.", fd,
+                ((IPCS_Message *)frame)->msgLen & IPCS_FRAME_OPTIONS);
+        return IPCS_FRAME_BAD;
+    }
+
+    /* 校验和以外的解析错误都是对端发来的帧格式不对 */
+    result = IPCS_StreamToMsgEx(frame, frameLen, &msg, &callId, NULL);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Handle recv data: stream to msg fail: %d.", result);
+        return (result == IPCS_CHECKSUM_FAIL) ? result : IPCS_FRAME_BAD;
+    }
+
+    if (((IPCS_Message *)frame)->msgLen & IPCS_MSG_FLAG_CONTROL) {
+        return IPCS_ItemHandleControl(itemType, fd, threadArg, &msg);
+    }
+
+    if (((IPCS_Message *)frame)->msgLen & IPCS_MSG_FLAG_ERROR) {
+        return IPCS_ItemHandleError(itemType, fd, threadArg, &msg, callId, IPCS_GetFrameError(frame, frameLen));
+    }
+
+    IPCS_CaptureFrame(IPCS_CAPTURE_RX, itemType, fd, &msg);
+
+    return IPCS_ItemHandleMsg(itemType, fd, threadArg, &msg, callId, IPCS_GetFramePriority(frame),
+            IPCS_GetFrameSendNs(frame));
+}
+
+int IPCS_ItemHandleMsg(int itemType, int fd, void *threadArg, IPCS_Message *msg, unsigned int callId,
+        IPCS_Priority prio, uint64_t sendNs)
+{
+    uint64_t queueNs = 0;
     int result = IPCS_OK;
-    IPCS_AsynClientThreadArg *asynClientArg = NULL;
 
     switch (itemType) {
         case IPCS_SERVER:
-            result = ((IPCS_ServerThreadArg *)threadArg)->serverHook(fd, msg);
+            /* 过载时被拒绝的请求不交给回调函数 */
+            if (IPCS_ServerAdmit((IPCS_ServerThreadArg *)threadArg, fd, msg, callId, prio, sendNs,
+                    &queueNs) != IPCS_OK) {
+                break;
+            }
+
+            /* 回调函数中对同一个fd的响应带上请求的调用ID和优先级 */
+            IPCS_ServerSetCurrentCall(fd, callId, prio, queueNs);
+            result = IPCS_ServerCallHook((IPCS_ServerThreadArg *)threadArg, fd, msg, sendNs);
+            IPCS_ServerSetCurrentCall(-1, IPCS_NO_CALL_ID, IPCS_PRIO_NORMAL, 0);
             if (result != IPCS_OK) {
                 IPCS_WriteLog("Server: %d handle message: server hook fail: %d.", fd, result);
                 result = IPCS_SERVER_HOOK_FAIL;
@@ -332,21 +1056,47 @@ int IPCS_ItemHandleMsg(int itemType, int fd, void *threadArg, IPCS_Message *msg)
             result = IPCS_UNREACHABLE;
             break;
         case IPCS_ASYN_CLIENT:
-            asynClientArg = (IPCS_AsynClientThreadArg *)threadArg;
-            /* NULL asyn client hook is allowed. */
-            if (asynClientArg->clientHook != NULL) {
-                result = asynClientArg->clientHook(msg);
-                if (result != IPCS_OK) {
-                    IPCS_WriteLog("Asyn client: %d handle message: client hook fail: %d.", fd, result);
-                    result = IPCS_CLIENT_HOOK_FAIL;
-                }
-            }
+            result = IPCS_AsynClientHandleMsg((IPCS_AsynClientThreadArg *)threadArg, msg, callId);
             break;
     }
 
     return result;
 }
 
+int IPCS_ItemHandleError(int itemType, int fd, void *threadArg, IPCS_Message *msg, unsigned int callId, int error)
+{
+    if (itemType == IPCS_ASYN_CLIENT) {
+        return IPCS_AsynClientHandleReject((IPCS_AsynClientThreadArg *)threadArg, msg, callId, error);
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_ItemHandleControl(int itemType, int fd, void *threadArg, IPCS_Message *msg)
+{
+    /* 目前只有客户端发给服务端的控制帧 */
+    if (itemType == IPCS_SERVER) {
+        return IPCS_ServerHandleControl((IPCS_ServerThreadArg *)threadArg, fd, msg);
+    }
+
+    return IPCS_OK;
+}
+
+unsigned int IPCS_ItemFrameOptions(int itemType, int fd, void *threadArg)
+{
+    IPCS_Conn *conn = NULL;
+
+    switch (itemType) {
+        case IPCS_SERVER:
+            conn = IPCS_ConnTableGet(&((IPCS_ServerThreadArg *)threadArg)->conns, fd);
+            return (conn != NULL) ? conn->frameFlags : 0;
+        case IPCS_ASYN_CLIENT:
+            return ((IPCS_AsynClientThreadArg *)threadArg)->sendQueue.frameFlags;
+        default:
+            return 0;
+    }
+}
+
 /******************************************************************************/
 /** 
  * 增加全局变量保存信息的做法是不推荐的，因为它通常导致线程不安全、模块间耦合等问题。
@@ -360,6 +1110,20 @@ static IPCS_ItemInfo *g_IpcsItems = NULL;
 static unsigned int g_IpcsItemsNum = 0;
 static pthread_mutex_t g_IpcsItemsMutex = PTHREAD_MUTEX_INITIALIZER;
 
+/* 持有锁fork，子进程中的锁是解开的 */
+void IPCS_ItemsForkLock(int lock)
+{
+    if (lock) {
+        (void)pthread_mutex_lock(&g_IpcsItemsMutex);
+        (void)pthread_mutex_lock(&g_IpcsPrioMutex);
+    } else {
+        (void)pthread_mutex_unlock(&g_IpcsPrioMutex);
+        (void)pthread_mutex_unlock(&g_IpcsItemsMutex);
+    }
+
+    return;
+}
+
 int IPCS_MallocImemsInfo(void)
 {
     void *buf = NULL;
@@ -606,6 +1370,80 @@ int IPCS_DelItemsInfo(IPCS_ItemType type, const char *name, int fd)
     return IPCS_FindDelItemsInfo(type, name, fd, 1, NULL);
 }
 
+/******************************************************************************/
+int IPCS_IsAbstractName(const char *name)
+{
+    return (name != NULL) && (name[0] == IPCS_ABSTRACT_NAME_PREFIX);
+}
+
+int IPCS_FillSockAddr(const char *name, struct sockaddr_un *addr, socklen_t *addrLen)
+{
+    size_t nameLen = strlen(name);
+
+    (void)memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+
+    if (nameLen >= sizeof(addr->sun_path)) {
+        return IPCS_PARAM_LEN;
+    }
+
+    if (IPCS_IsAbstractName(name)) {
+        /* 抽象地址的长度必须精确，sun_path中'\0'之后的所有字节都属于名字 */
+        (void)memcpy(addr->sun_path + 1, name + 1, nameLen - 1);
+        *addrLen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + nameLen);
+    } else {
+        (void)memcpy(addr->sun_path, name, nameLen);
+        *addrLen = (socklen_t)sizeof(struct sockaddr_un);
+    }
+
+    return IPCS_OK;
+}
+
+/* 获取fd绑定的地址，抽象地址转换为'@'开头的名字（例如autobind分配的"@0001f"） */
+int IPCS_GetSockName(int fd, char *name, size_t nameLen)
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen = sizeof(addr);
+    size_t pathLen = 0;
+
+    (void)memset(&addr, 0, sizeof(addr));
+    if (getsockname(fd, (struct sockaddr *)&addr, &addrLen) != 0) {
+        return IPCS_SOCKET_FAIL;
+    }
+
+    if (addrLen <= offsetof(struct sockaddr_un, sun_path)) {
+        name[0] = '\0';
+        return IPCS_OK;
+    }
+
+    pathLen = addrLen - offsetof(struct sockaddr_un, sun_path);
+    if (pathLen >= nameLen) {
+        return IPCS_PARAM_LEN;
+    }
+
+    if (addr.sun_path[0] == '\0') {
+        name[0] = IPCS_ABSTRACT_NAME_PREFIX;
+        (void)memcpy(name + 1, addr.sun_path + 1, pathLen - 1);
+        name[pathLen] = '\0';
+    } else {
+        (void)snprintf(name, nameLen, "%s", addr.sun_path);
+    }
+
+    return IPCS_OK;
+}
+
+/* 抽象地址随最后一个fd关闭自动释放，只有文件系统地址需要删除文件 */
+void IPCS_UnlinkSockName(const char *name)
+{
+    if ((name == NULL) || (name[0] == '\0') || IPCS_IsAbstractName(name)) {
+        return;
+    }
+
+    (void)unlink(name);
+
+    return;
+}
+
 /******************************************************************************/
 int IPCS_CheckItemName(const char *name)
 {
@@ -21,40 +21,204 @@
 
 #include "ipcs.h"
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
 #include <sys/un.h>
 
 /******************************************************************************/
 #define IPCS_ITEM_NAME_MAX_LEN      sizeof(((struct sockaddr_un *)0)->sun_path)
 
+/* 以'@'开头的名字表示Linux抽象命名空间的地址，sun_path[0]为'\0'，不在文件系统中创建文件 */
+#define IPCS_ABSTRACT_NAME_PREFIX   '@'
+
+/**
+ * 帧格式：msgType(4) + msgLen(4) + [扩展字段] + 负载。
+ * msgLen的低24位为负载长度，高8位为标志位，标志位表示帧头之后跟随的扩展字段；
+ * 负载长度不超过IPCS_MESSAGE_MAX_LEN，所以旧的帧（标志位全0）格式不变。
+ **/
+#define IPCS_MSG_HEADER_LEN         offsetof(IPCS_Message, msgValue)
+#define IPCS_MSG_LEN_MASK           0x00FFFFFFU
+#define IPCS_MSG_FLAGS_MASK         0xFF000000U
+#define IPCS_MSG_FLAG_CALL_ID       0x80000000U     /* 帧头之后跟4字节的调用ID */
+#define IPCS_MSG_FLAG_CONTROL       0x40000000U     /* 库内部的控制帧，不交给回调函数 */
+#define IPCS_MSG_FLAG_PRIORITY      0x20000000U     /* 高优先级帧 */
+#define IPCS_MSG_FLAG_HANDLED       0x10000000U     /* 只在接收缓冲区中使用：已提前处理的高优先级帧 */
+#define IPCS_MSG_FLAG_SEND_TIME     0x08000000U     /* 调用ID之后跟8字节的发送时间（CLOCK_MONOTONIC纳秒） */
+#define IPCS_MSG_FLAG_ERROR         0x04000000U     /* 错误帧：请求被拒绝，msgType为请求的类型，负载为4字节错误码 */
+#define IPCS_MSG_FLAG_CHECKSUM      0x02000000U     /* 负载之后跟4字节的CRC32C，覆盖帧头（不含HANDLED标志）到负载 */
+#define IPCS_MSG_FLAG_COMPRESSED    0x01000000U     /* 负载为4字节的原始长度加LZ压缩的数据，解析时解压 */
+
+/* 控制帧的msgType，负载为4字节的参数 */
+#define IPCS_CTRL_SUBSCRIBE         1
+#define IPCS_CTRL_UNSUBSCRIBE       2
+#define IPCS_CTRL_OPTIONS           3       /* 连接选项：参数为请求的帧标志（校验和、压缩），
+                                             * 服务端以同类型的控制帧回复同意的部分 */
+
+#define IPCS_CALL_ID_LEN            sizeof(unsigned int)
+#define IPCS_NO_CALL_ID             0
+
+#define IPCS_SEND_TIME_LEN          sizeof(uint64_t)
+
+#define IPCS_CHECKSUM_LEN           sizeof(uint32_t)
+
+#define IPCS_COMPRESS_RAW_LEN       sizeof(uint32_t)
+
+/* IPCS_SendFrame的sendFlags，帧选项与帧标志的位相同 */
+#define IPCS_SEND_NO_WAIT           0x1U
+#define IPCS_SEND_CHECKSUM          IPCS_MSG_FLAG_CHECKSUM
+#define IPCS_SEND_COMPRESS          IPCS_MSG_FLAG_COMPRESSED
+#define IPCS_FRAME_OPTIONS          (IPCS_MSG_FLAG_CHECKSUM | IPCS_MSG_FLAG_COMPRESSED)
+#define IPCS_FRAME_OPTIONS_NUM      4       /* 帧选项的组合数，IPCS_FRAME_OPTIONS_INDEX为组合的下标 */
+#define IPCS_FRAME_OPTIONS_INDEX(frameFlags)    (((frameFlags) & IPCS_FRAME_OPTIONS) >> 24)
+
+/* 一帧的最大长度：最大消息长度加上帧头、扩展字段和校验和 */
+#define IPCS_FRAME_EXT_MAX_LEN      64
+#define IPCS_FRAME_MAX_LEN          (IPCS_MESSAGE_MAX_LEN + IPCS_FRAME_EXT_MAX_LEN)
+
 typedef enum {
     IPCS_SERVER = 0,
     IPCS_SYNC_CLIENT,
     IPCS_ASYN_CLIENT
 } IPCS_ItemType;
 
+/* 不阻塞地读一帧，在多个连接上poll时一个连接上的半帧不会阻塞其他连接 */
+typedef struct {
+    void *buf;                  /* IPCS_FRAME_MAX_LEN字节，第一次读时分配 */
+    unsigned int readLen;       /* 已读出的字节数 */
+    unsigned int frameLen;      /* 读完帧头之前为0 */
+} IPCS_FrameReader;
+
 /******************************************************************************/
 void IPCS_WriteLogImpl(const char *filename, unsigned int lineNum, const char *format, ...);
 
 #define IPCS_WriteLog(format, ...)      IPCS_WriteLogImpl(__FILE__, __LINE__, (format), ##__VA_ARGS__)
 
+/******************************************************************************/
+/* CLOCK_MONOTONIC，单位纳秒 */
+uint64_t IPCS_GetNowNs(void);
+
 /******************************************************************************/
 int IPCS_CreateThread(void *(threadRunFunc)(void *), void *threadArg, pthread_t *threadId);
 
+int IPCS_CreateThreadEx(void *(threadRunFunc)(void *), void *threadArg, const IPCS_ThreadAttr *attr,
+        const char *defaultName, pthread_t *threadId);
+
 /******************************************************************************/
 int IPCS_MsgToStream(IPCS_Message *msg, void *streamBuf, unsigned int *bufLen);
 
+int IPCS_MsgToStreamEx(IPCS_Message *msg, unsigned int callId, void *streamBuf, unsigned int *bufLen);
+
+/* 优先级取prio和消息类型登记的优先级中较高的，高优先级时在帧头打上IPCS_MSG_FLAG_PRIORITY */
+int IPCS_MsgToStreamPrio(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio, void *streamBuf,
+        unsigned int *bufLen);
+
+/* sendNs不为0时帧中带上发送时间，服务端据此计算请求的排队时间 */
+int IPCS_MsgToStreamTime(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio, uint64_t sendNs,
+        void *streamBuf, unsigned int *bufLen);
+
+/**
+ * 按连接选项编码：frameFlags带IPCS_MSG_FLAG_COMPRESSED时，不小于IPCS_COMPRESS_MIN_LEN且压缩后
+ * 变小的负载压缩后发送；带IPCS_MSG_FLAG_CHECKSUM时追加校验和；其他标志直接加到帧头。
+ * streamBuf的大小与IPCS_MsgToStreamTime相同。
+ **/
+int IPCS_MsgToStreamFlags(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio, uint64_t sendNs,
+        unsigned int frameFlags, void *streamBuf, unsigned int *bufLen);
+
+IPCS_Priority IPCS_GetMsgPriority(unsigned int msgType);
+
+IPCS_Priority IPCS_GetFramePriority(const void *streamBuf);
+
 int IPCS_StreamToMsg(void *streamBuf, unsigned int bufLen, IPCS_Message *msg);
 
+/* callId、frameLen为出参，可为NULL */
+int IPCS_StreamToMsgEx(void *streamBuf, unsigned int bufLen, IPCS_Message *msg, unsigned int *callId,
+        unsigned int *frameLen);
+
+/* 根据帧头计算整帧长度（含校验和），数据不足一帧时返回IPCS_STREAM_INCOMPLETE */
+int IPCS_GetFrameLen(const void *streamBuf, size_t bufLen, unsigned int *frameLen);
+
+unsigned int IPCS_GetFrameHeadLen(const void *streamBuf);
+
+/* 负载之后的校验和长度 */
+unsigned int IPCS_GetFrameTailLen(const void *streamBuf);
+
+/* 在编码好的帧后追加校验和，frameLen增加IPCS_CHECKSUM_LEN；streamBuf中帧之后要有足够的空间 */
+void IPCS_FrameAddChecksum(void *streamBuf, unsigned int *frameLen);
+
+/* 没有校验和的帧返回IPCS_OK，校验和不符返回IPCS_CHECKSUM_FAIL；frameLen为含校验和的整帧长度 */
+int IPCS_FrameCheckChecksum(const void *streamBuf, unsigned int frameLen);
+
+/* 帧中的发送时间，没有时返回0 */
+uint64_t IPCS_GetFrameSendNs(const void *streamBuf);
+
+/* 错误帧中的错误码，不是错误帧时返回IPCS_OK；frameLen为整帧长度 */
+int IPCS_GetFrameError(const void *streamBuf, unsigned int frameLen);
+
 /******************************************************************************/
-int IPCS_SendMessage(int fd, IPCS_Message *msg);
+int IPCS_SendMessage(int itemType, int fd, IPCS_Message *msg);
+
+int IPCS_SendMessageEx(int itemType, int fd, IPCS_Message *msg, unsigned int callId);
+
+int IPCS_SendMessagePrio(int itemType, int fd, IPCS_Message *msg, unsigned int callId, IPCS_Priority prio);
+
+/* sendFlags：IPCS_SEND_NO_WAIT时对端积压、发送缓冲区满时不阻塞，返回IPCS_OVERLOADED（请求没有发出）；
+ * IPCS_SEND_CHECKSUM、IPCS_SEND_COMPRESS为连接上协商的帧选项 */
+int IPCS_SendFrame(int itemType, int fd, IPCS_Message *msg, unsigned int callId, IPCS_Priority prio,
+        unsigned int sendFlags);
+
+/* 在阻塞的fd上发送一个控制帧 */
+int IPCS_SendControl(int fd, unsigned int ctrlType, unsigned int value);
+
+/* 读满len字节；deadlineNs不为0时最多等到deadlineNs，一个字节都没读到时返回IPCS_TIMEOUT，
+ * 读了一部分时返回IPCS_STREAM_INCOMPLETE */
+int IPCS_ReadFull(int fd, void *buf, size_t len, uint64_t deadlineNs);
+
+/* deadlineNs为0时一直等待，否则整帧最多等到deadlineNs，到期返回IPCS_TIMEOUT；读了半帧时到期，
+ * 连接被shutdown，之后在它上面的读写都失败。frameOptions为连接上协商的帧选项，
+ * 帧带其他选项时整帧读出后返回IPCS_FRAME_BAD */
+int IPCS_RecvSingleMsg(int fd, uint64_t deadlineNs, unsigned int frameOptions, IPCS_Message *recvMsg,
+        unsigned int *callId);
+
+/* 解码同步客户端读出的一个完整的帧，错误帧返回其中的错误码 */
+int IPCS_ParseSingleMsg(int fd, void *streamBuf, unsigned int frameLen, unsigned int frameOptions,
+        IPCS_Message *recvMsg, unsigned int *callId);
+
+void IPCS_FrameReaderInit(IPCS_FrameReader *reader);
+
+void IPCS_FrameReaderFree(IPCS_FrameReader *reader);
+
+/* 不阻塞地读，读完一帧返回IPCS_OK，帧在buf中、长度为frameLen；还没读完返回IPCS_STREAM_INCOMPLETE */
+int IPCS_FrameReaderRead(IPCS_FrameReader *reader, int fd);
 
-int IPCS_RecvSingleMsg(int fd, IPCS_Message *recvMsg);
+/* 处理完一帧后调用，开始读下一帧 */
+void IPCS_FrameReaderNext(IPCS_FrameReader *reader);
 
 int IPCS_RecvMultiMsg(int itemType, int fd, void *threadArg);
 
 int IPCS_HandleRecvData(void *recvData, size_t recvDataLen, int itemType, int fd, void *threadArg);
 
-int IPCS_ItemHandleMsg(int itemType, int fd, void *threadArg, IPCS_Message *msg);
+/* 先处理高优先级帧，再按顺序处理其余的帧；不完整的尾帧不处理，handledLen返回已处理的字节数 */
+int IPCS_HandleRecvDataEx(void *recvData, size_t recvDataLen, int itemType, int fd, void *threadArg,
+        size_t *handledLen);
+
+/* 只处理缓冲区中完整的高优先级帧，处理过的帧打上IPCS_MSG_FLAG_HANDLED，不从缓冲区删除 */
+int IPCS_HandleHighPrioFrames(void *recvData, size_t recvDataLen, int itemType, int fd, void *threadArg);
+
+/* 解码一个完整的帧并交给控制帧处理或回调函数，msgBuf至少IPCS_MESSAGE_MAX_LEN字节 */
+int IPCS_DispatchFrame(void *frame, unsigned int frameLen, int itemType, int fd, void *threadArg, void *msgBuf);
+
+/* sendNs为请求中的发送时间，0表示没有 */
+int IPCS_ItemHandleMsg(int itemType, int fd, void *threadArg, IPCS_Message *msg, unsigned int callId,
+        IPCS_Priority prio, uint64_t sendNs);
+
+/* 错误帧：目前只有服务端拒绝请求时回复给客户端 */
+int IPCS_ItemHandleError(int itemType, int fd, void *threadArg, IPCS_Message *msg, unsigned int callId, int error);
+
+int IPCS_ItemHandleControl(int itemType, int fd, void *threadArg, IPCS_Message *msg);
+
+/* 连接上协商的帧选项，对端发来的帧带其他选项时是协议错误 */
+unsigned int IPCS_ItemFrameOptions(int itemType, int fd, void *threadArg);
 
 /******************************************************************************/
 typedef struct {
@@ -65,6 +229,9 @@ typedef struct {
     int epollFd;
     pthread_t pid;
     void *hook;
+    void *context;      /* 异步客户端：IPCS_AsynClientThreadArg；同步客户端：IPCS_BusyPoll，可为NULL；
+                         * 服务端：IPCS_ServerListener */
+    unsigned int frameFlags;    /* 同步客户端：连接上协商的帧选项（IPCS_FRAME_OPTIONS） */
 } IPCS_ItemInfo;
 
 int IPCS_AddItemsInfo(IPCS_ItemInfo *itemInfo);
@@ -72,6 +239,18 @@ int IPCS_FindItemsInfo(IPCS_ItemType type, const char *name, int fd, IPCS_ItemIn
 int IPCS_IsItemExist(IPCS_ItemType type, const char *name, int fd);
 int IPCS_DelItemsInfo(IPCS_ItemType type, const char *name, int fd);
 
+/* lock非0时加锁登记信息和优先级表，fork之后在两个进程中以0调用解锁 */
+void IPCS_ItemsForkLock(int lock);
+
+/******************************************************************************/
+int IPCS_IsAbstractName(const char *name);
+
+int IPCS_FillSockAddr(const char *name, struct sockaddr_un *addr, socklen_t *addrLen);
+
+int IPCS_GetSockName(int fd, char *name, size_t nameLen);
+
+void IPCS_UnlinkSockName(const char *name);
+
 /******************************************************************************/
 int IPCS_CheckItemName(const char *name);
 int IPCS_CheckMessage(IPCS_Message *msg);
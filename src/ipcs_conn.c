@@ -0,0 +1,706 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_conn.c
+ *
+ *    Description:  IPC socket server side connection table
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:40:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_common.h"
+#include "ipcs_conn.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define IPCS_CONN_TABLE_INIT_CAP    64
+#define IPCS_CONN_SEND_INIT_CAP     (4 * 1024)
+
+static pthread_mutex_t g_IpcsConnOwnersMutex = PTHREAD_MUTEX_INITIALIZER;
+static IPCS_ConnOwner *g_IpcsConnOwners = NULL;
+static unsigned int g_IpcsConnOwnerCap = 0;
+
+/* 连接缓冲区和共享帧占用的内存，预算为0表示不限制 */
+static size_t g_IpcsMemBudget = 0;
+static size_t g_IpcsMemUsed = 0;
+static size_t g_IpcsMemPeak = 0;
+
+void IPCS_SetMemBudget(size_t budget)
+{
+    __atomic_store_n(&g_IpcsMemBudget, budget, __ATOMIC_RELAXED);
+
+    return;
+}
+
+void IPCS_GetMemStats(IPCS_MemStats *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+
+    stats->used = __atomic_load_n(&g_IpcsMemUsed, __ATOMIC_RELAXED);
+    stats->peak = __atomic_load_n(&g_IpcsMemPeak, __ATOMIC_RELAXED);
+    stats->budget = __atomic_load_n(&g_IpcsMemBudget, __ATOMIC_RELAXED);
+
+    return;
+}
+
+void IPCS_MemCharge(size_t len)
+{
+    size_t used = __atomic_add_fetch(&g_IpcsMemUsed, len, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&g_IpcsMemPeak, __ATOMIC_RELAXED);
+
+    while ((used > peak) &&
+           !__atomic_compare_exchange_n(&g_IpcsMemPeak, &peak, used, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    return;
+}
+
+void IPCS_MemUncharge(size_t len)
+{
+    (void)__atomic_sub_fetch(&g_IpcsMemUsed, len, __ATOMIC_RELAXED);
+
+    return;
+}
+
+int IPCS_MemOverBudget(void)
+{
+    size_t budget = __atomic_load_n(&g_IpcsMemBudget, __ATOMIC_RELAXED);
+
+    return (budget != 0) && (__atomic_load_n(&g_IpcsMemUsed, __ATOMIC_RELAXED) > budget);
+}
+
+/******************************************************************************/
+void IPCS_ConnTableInit(IPCS_ConnTable *table)
+{
+    (void)memset(table, 0, sizeof(IPCS_ConnTable));
+
+    return;
+}
+
+void IPCS_ConnFree(IPCS_Conn *conn)
+{
+    IPCS_ConnClearOut(conn);
+    IPCS_MemUncharge(conn->recvCap + conn->sendCap + conn->pendCap);
+    free(conn->recvBuf);
+    free(conn->sendBuf);
+    free(conn->pendBuf);
+    free(conn);
+
+    return;
+}
+
+void IPCS_ConnTableDestroy(IPCS_ConnTable *table)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < table->cap; i++) {
+        if (table->conns[i] != NULL) {
+            if (table->owner != NULL) {
+                IPCS_ConnOwnerClear(table->conns[i]->fd, table->owner);
+            }
+            (void)close(table->conns[i]->fd);
+            IPCS_ConnFree(table->conns[i]);
+        }
+    }
+
+    free(table->conns);
+    (void)memset(table, 0, sizeof(IPCS_ConnTable));
+
+    return;
+}
+
+int IPCS_ConnTableGrow(IPCS_ConnTable *table, int fd)
+{
+    unsigned int newCap = (table->cap == 0) ? IPCS_CONN_TABLE_INIT_CAP : table->cap;
+    IPCS_Conn **conns = NULL;
+
+    while (newCap <= (unsigned int)fd) {
+        newCap *= 2;
+    }
+
+    conns = (IPCS_Conn **)realloc(table->conns, newCap * sizeof(IPCS_Conn *));
+    if (conns == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    (void)memset(conns + table->cap, 0, (newCap - table->cap) * sizeof(IPCS_Conn *));
+
+    table->conns = conns;
+    table->cap = newCap;
+
+    return IPCS_OK;
+}
+
+IPCS_Conn *IPCS_ConnTableAdd(IPCS_ConnTable *table, int fd)
+{
+    IPCS_Conn *conn = NULL;
+
+    if ((fd < 0) || (IPCS_ConnTableGet(table, fd) != NULL)) {
+        return NULL;
+    }
+
+    if (((unsigned int)fd >= table->cap) && (IPCS_ConnTableGrow(table, fd) != IPCS_OK)) {
+        return NULL;
+    }
+
+    conn = (IPCS_Conn *)calloc(1, sizeof(IPCS_Conn));
+    if (conn == NULL) {
+        return NULL;
+    }
+
+    conn->recvBuf = (char *)malloc(IPCS_CONN_RECV_MIN_LEN);
+    if (conn->recvBuf == NULL) {
+        free(conn);
+        return NULL;
+    }
+    conn->recvCap = IPCS_CONN_RECV_MIN_LEN;
+    IPCS_MemCharge(conn->recvCap);
+
+    conn->fd = fd;
+    conn->serial = ++table->serial;
+    conn->recvActive = 1;
+    table->conns[fd] = conn;
+    table->num++;
+
+    if (table->owner != NULL) {
+        IPCS_ConnOwnerSet(fd, table->owner, conn->serial);
+    }
+
+    return conn;
+}
+
+IPCS_Conn *IPCS_ConnTableGet(const IPCS_ConnTable *table, int fd)
+{
+    if ((fd < 0) || ((unsigned int)fd >= table->cap)) {
+        return NULL;
+    }
+
+    return table->conns[fd];
+}
+
+void IPCS_ConnTableDel(IPCS_ConnTable *table, int fd)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(table, fd);
+
+    if (conn == NULL) {
+        return;
+    }
+
+    table->conns[fd] = NULL;
+    table->num--;
+    if (table->owner != NULL) {
+        IPCS_ConnOwnerClear(fd, table->owner);
+    }
+    (void)close(fd);
+    IPCS_ConnFree(conn);
+
+    return;
+}
+
+void IPCS_ConnOwnersLock(void)
+{
+    (void)pthread_mutex_lock(&g_IpcsConnOwnersMutex);
+
+    return;
+}
+
+void IPCS_ConnOwnersUnlock(void)
+{
+    (void)pthread_mutex_unlock(&g_IpcsConnOwnersMutex);
+
+    return;
+}
+
+void *IPCS_ConnOwnerGet(int fd, unsigned long long *serial)
+{
+    if ((fd < 0) || ((unsigned int)fd >= g_IpcsConnOwnerCap)) {
+        return NULL;
+    }
+
+    *serial = g_IpcsConnOwners[fd].serial;
+
+    return g_IpcsConnOwners[fd].owner;
+}
+
+void IPCS_ConnOwnerSet(int fd, void *owner, unsigned long long serial)
+{
+    unsigned int newCap = 0;
+    IPCS_ConnOwner *owners = NULL;
+
+    (void)pthread_mutex_lock(&g_IpcsConnOwnersMutex);
+    if ((unsigned int)fd >= g_IpcsConnOwnerCap) {
+        newCap = (g_IpcsConnOwnerCap == 0) ? IPCS_CONN_TABLE_INIT_CAP : g_IpcsConnOwnerCap;
+        while (newCap <= (unsigned int)fd) {
+            newCap *= 2;
+        }
+
+        owners = (IPCS_ConnOwner *)realloc(g_IpcsConnOwners, newCap * sizeof(IPCS_ConnOwner));
+        if (owners == NULL) {
+            (void)pthread_mutex_unlock(&g_IpcsConnOwnersMutex);
+            IPCS_WriteLog("Conn owner: fd: %d malloc fail.", fd);
+            return;
+        }
+        (void)memset(owners + g_IpcsConnOwnerCap, 0, (newCap - g_IpcsConnOwnerCap) * sizeof(IPCS_ConnOwner));
+        g_IpcsConnOwners = owners;
+        g_IpcsConnOwnerCap = newCap;
+    }
+
+    g_IpcsConnOwners[fd].owner = owner;
+    g_IpcsConnOwners[fd].serial = serial;
+    (void)pthread_mutex_unlock(&g_IpcsConnOwnersMutex);
+
+    return;
+}
+
+void IPCS_ConnOwnerClear(int fd, void *owner)
+{
+    (void)pthread_mutex_lock(&g_IpcsConnOwnersMutex);
+    if (((unsigned int)fd < g_IpcsConnOwnerCap) && (g_IpcsConnOwners[fd].owner == owner)) {
+        g_IpcsConnOwners[fd].owner = NULL;
+        g_IpcsConnOwners[fd].serial = 0;
+    }
+    (void)pthread_mutex_unlock(&g_IpcsConnOwnersMutex);
+
+    return;
+}
+
+void IPCS_ConnOwnersClearAll(void)
+{
+    if (g_IpcsConnOwners != NULL) {
+        (void)memset(g_IpcsConnOwners, 0, g_IpcsConnOwnerCap * sizeof(IPCS_ConnOwner));
+    }
+
+    return;
+}
+
+/******************************************************************************/
+void IPCS_ConnConsumeRecv(IPCS_Conn *conn, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+
+    conn->recvLen -= len;
+    if (conn->recvLen != 0) {
+        (void)memmove(conn->recvBuf, conn->recvBuf + len, conn->recvLen);
+    }
+
+    return;
+}
+
+int IPCS_ConnReserveRecv(IPCS_Conn *conn, size_t len)
+{
+    size_t newCap = conn->recvCap;
+    char *buf = NULL;
+
+    if (conn->recvLen + len <= conn->recvCap) {
+        return IPCS_OK;
+    }
+
+    while ((newCap < conn->recvLen + len) && (newCap < IPCS_CONN_RECV_BUF_LEN)) {
+        newCap *= 2;
+    }
+    if (newCap > IPCS_CONN_RECV_BUF_LEN) {
+        newCap = IPCS_CONN_RECV_BUF_LEN;
+    }
+
+    if (newCap != conn->recvCap) {
+        buf = (char *)realloc(conn->recvBuf, newCap);
+        if (buf == NULL) {
+            return IPCS_MALLOC_FAIL;
+        }
+
+        IPCS_MemCharge(newCap - conn->recvCap);
+        conn->recvBuf = buf;
+        conn->recvCap = newCap;
+    }
+
+    return (conn->recvLen + len <= conn->recvCap) ? IPCS_OK : IPCS_BUF_TOO_SMALL;
+}
+
+int IPCS_ConnReservePend(IPCS_Conn *conn, size_t len)
+{
+    size_t newCap = (conn->pendCap == 0) ? IPCS_CONN_SEND_INIT_CAP : conn->pendCap;
+    char *buf = NULL;
+
+    if (conn->pendLen + len <= conn->pendCap) {
+        return IPCS_OK;
+    }
+
+    while (newCap < conn->pendLen + len) {
+        newCap *= 2;
+    }
+
+    buf = (char *)realloc(conn->pendBuf, newCap);
+    if (buf == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    IPCS_MemCharge(newCap - conn->pendCap);
+    conn->pendBuf = buf;
+    conn->pendCap = newCap;
+
+    return IPCS_OK;
+}
+
+int IPCS_ConnSwapPend(IPCS_Conn *conn)
+{
+    char *buf = conn->sendBuf;
+    size_t cap = conn->sendCap;
+
+    if (conn->sendInFlight || (conn->pendLen == 0)) {
+        return 0;
+    }
+
+    conn->sendBuf = conn->pendBuf;
+    conn->sendCap = conn->pendCap;
+    conn->sendLen = conn->pendLen;
+    conn->sendOff = 0;
+
+    conn->pendBuf = buf;
+    conn->pendCap = cap;
+    conn->pendLen = 0;
+
+    return 1;
+}
+
+size_t IPCS_ConnBacklog(const IPCS_Conn *conn)
+{
+    return conn->recvLen + conn->pendLen + (conn->sendLen - conn->sendOff) + (conn->outBytes - conn->outOff);
+}
+
+int IPCS_ConnTrim(IPCS_Conn *conn)
+{
+    char *buf = NULL;
+
+    if ((conn->recvLen == 0) && (conn->recvCap > IPCS_CONN_RECV_MIN_LEN)) {
+        buf = (char *)realloc(conn->recvBuf, IPCS_CONN_RECV_MIN_LEN);
+        if (buf != NULL) {
+            IPCS_MemUncharge(conn->recvCap - IPCS_CONN_RECV_MIN_LEN);
+            conn->recvBuf = buf;
+            conn->recvCap = IPCS_CONN_RECV_MIN_LEN;
+        }
+    }
+
+    if ((conn->pendLen == 0) && (conn->pendBuf != NULL)) {
+        IPCS_MemUncharge(conn->pendCap);
+        free(conn->pendBuf);
+        conn->pendBuf = NULL;
+        conn->pendCap = 0;
+    }
+
+    /* 内核可能还在读正在发送的数据 */
+    if (!conn->sendInFlight && (conn->sendOff >= conn->sendLen) && (conn->sendBuf != NULL)) {
+        IPCS_MemUncharge(conn->sendCap);
+        free(conn->sendBuf);
+        conn->sendBuf = NULL;
+        conn->sendCap = 0;
+        conn->sendLen = 0;
+        conn->sendOff = 0;
+    }
+
+    return (conn->recvCap > IPCS_CONN_RECV_MIN_LEN) || (conn->pendBuf != NULL) || (conn->sendBuf != NULL);
+}
+
+/******************************************************************************/
+IPCS_SharedFrame *IPCS_SharedFrameNew(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio,
+        unsigned int frameFlags)
+{
+    IPCS_SharedFrame *frame = NULL;
+    unsigned int frameLen = IPCS_MSG_HEADER_LEN + IPCS_FRAME_EXT_MAX_LEN + (msg->msgLen & IPCS_MSG_LEN_MASK);
+
+    frame = (IPCS_SharedFrame *)malloc(sizeof(IPCS_SharedFrame) + frameLen);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    if (IPCS_MsgToStreamFlags(msg, callId, prio, 0, frameFlags, frame->data, &frameLen) != IPCS_OK) {
+        free(frame);
+        return NULL;
+    }
+
+    frame->refCount = 1;
+    frame->topic = msg->msgType;
+    frame->len = frameLen;
+    IPCS_MemCharge(sizeof(IPCS_SharedFrame) + frameLen);
+
+    return frame;
+}
+
+IPCS_SharedFrame *IPCS_SharedFrameCopy(const void *data, unsigned int len)
+{
+    IPCS_SharedFrame *frame = NULL;
+
+    frame = (IPCS_SharedFrame *)malloc(sizeof(IPCS_SharedFrame) + len);
+    if (frame == NULL) {
+        return NULL;
+    }
+
+    (void)memcpy(frame->data, data, len);
+    frame->refCount = 1;
+    frame->topic = 0;
+    frame->len = len;
+    IPCS_MemCharge(sizeof(IPCS_SharedFrame) + len);
+
+    return frame;
+}
+
+IPCS_SharedFrame *IPCS_SharedFrameWithFlags(const IPCS_SharedFrame *plain, unsigned int frameFlags)
+{
+    const IPCS_Message *header = (const IPCS_Message *)plain->data;
+    unsigned int flags = header->msgLen & IPCS_MSG_FLAGS_MASK;
+    unsigned int callId = IPCS_NO_CALL_ID;
+    IPCS_SharedFrame *frame = NULL;
+    IPCS_Message msg;
+
+    if (flags & IPCS_MSG_FLAG_CALL_ID) {
+        (void)memcpy(&callId, plain->data + IPCS_MSG_HEADER_LEN, IPCS_CALL_ID_LEN);
+    }
+
+    /* 调用ID和优先级由编码重新生成，其他标志（控制帧、错误帧）原样保留 */
+    msg.msgType = header->msgType;
+    msg.msgLen = header->msgLen & IPCS_MSG_LEN_MASK;
+    msg.msgValue = (char *)plain->data + IPCS_GetFrameHeadLen(plain->data);
+    flags &= ~(IPCS_MSG_FLAG_CALL_ID | IPCS_MSG_FLAG_PRIORITY | IPCS_MSG_FLAG_SEND_TIME);
+
+    frame = IPCS_SharedFrameNew(&msg, callId, IPCS_GetFramePriority(plain->data), flags | frameFlags);
+    if (frame != NULL) {
+        frame->topic = plain->topic;
+    }
+
+    return frame;
+}
+
+void IPCS_SharedFrameRef(IPCS_SharedFrame *frame)
+{
+    (void)__atomic_add_fetch(&frame->refCount, 1, __ATOMIC_RELAXED);
+
+    return;
+}
+
+void IPCS_SharedFrameUnref(IPCS_SharedFrame *frame)
+{
+    if (__atomic_sub_fetch(&frame->refCount, 1, __ATOMIC_ACQ_REL) == 0) {
+        IPCS_MemUncharge(sizeof(IPCS_SharedFrame) + frame->len);
+        free(frame);
+    }
+
+    return;
+}
+
+/* 高优先级帧的插入位置：跳过正在发送或已发送了一部分的帧，以及其后已排队的高优先级帧 */
+static IPCS_OutFrame *IPCS_ConnHighInsertPos(const IPCS_Conn *conn)
+{
+    IPCS_OutFrame *prev = NULL;
+    IPCS_OutFrame *node = conn->outHead;
+    unsigned int skip = conn->sendFromQueue;
+
+    if ((skip == 0) && (conn->outOff != 0)) {
+        skip = 1;
+    }
+    while ((node != NULL) && (skip != 0)) {
+        prev = node;
+        node = node->next;
+        skip--;
+    }
+
+    while ((node != NULL) && node->isHigh) {
+        prev = node;
+        node = node->next;
+    }
+
+    return prev;
+}
+
+int IPCS_ConnPushOut(IPCS_Conn *conn, IPCS_SharedFrame *frame, int isPub)
+{
+    IPCS_OutFrame *node = NULL;
+    IPCS_OutFrame *prev = NULL;
+
+    node = (IPCS_OutFrame *)malloc(sizeof(IPCS_OutFrame));
+    if (node == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    IPCS_SharedFrameRef(frame);
+    node->frame = frame;
+    node->isPub = isPub;
+    node->isHigh = (IPCS_GetFramePriority(frame->data) == IPCS_PRIO_HIGH);
+    node->next = NULL;
+
+    prev = node->isHigh ? IPCS_ConnHighInsertPos(conn) : conn->outTail;
+    if (prev == NULL) {
+        node->next = conn->outHead;
+        conn->outHead = node;
+    } else {
+        node->next = prev->next;
+        prev->next = node;
+    }
+    if (node->next == NULL) {
+        conn->outTail = node;
+    }
+
+    if (isPub) {
+        conn->outPubNum++;
+    }
+    conn->outBytes += frame->len;
+
+    return IPCS_OK;
+}
+
+void IPCS_ConnPopOut(IPCS_Conn *conn)
+{
+    IPCS_OutFrame *node = conn->outHead;
+
+    if (node == NULL) {
+        return;
+    }
+
+    conn->outHead = node->next;
+    if (conn->outHead == NULL) {
+        conn->outTail = NULL;
+    }
+    conn->outOff = 0;
+
+    if (node->isPub) {
+        conn->outPubNum--;
+    }
+    conn->outBytes -= node->frame->len;
+
+    IPCS_SharedFrameUnref(node->frame);
+    free(node);
+
+    return;
+}
+
+void IPCS_ConnClearOut(IPCS_Conn *conn)
+{
+    while (conn->outHead != NULL) {
+        IPCS_ConnPopOut(conn);
+    }
+
+    return;
+}
+
+unsigned int IPCS_ConnFillOutIov(const IPCS_Conn *conn, struct iovec *iov, unsigned int maxIov, int highOnly)
+{
+    const IPCS_OutFrame *node = conn->outHead;
+    size_t off = conn->outOff;
+    unsigned int num = 0;
+
+    while ((node != NULL) && (num < maxIov) && (!highOnly || node->isHigh)) {
+        iov[num].iov_base = node->frame->data + off;
+        iov[num].iov_len = node->frame->len - off;
+        off = 0;
+        num++;
+        node = node->next;
+    }
+
+    return num;
+}
+
+void IPCS_ConnAdvanceOut(IPCS_Conn *conn, size_t len)
+{
+    size_t left = 0;
+
+    while ((len != 0) && (conn->outHead != NULL)) {
+        left = conn->outHead->frame->len - conn->outOff;
+        if (len < left) {
+            conn->outOff += len;
+            return;
+        }
+
+        len -= left;
+        IPCS_ConnPopOut(conn);
+    }
+
+    return;
+}
+
+int IPCS_ConnConflateOut(IPCS_Conn *conn, IPCS_SharedFrame *frame)
+{
+    IPCS_OutFrame *node = conn->outHead;
+    unsigned int skip = conn->sendFromQueue;
+
+    /* 正在发送或已发送了一部分的帧不能替换 */
+    if ((skip == 0) && (conn->outOff != 0)) {
+        skip = 1;
+    }
+    while ((node != NULL) && (skip != 0)) {
+        node = node->next;
+        skip--;
+    }
+
+    for (; node != NULL; node = node->next) {
+        if (node->isPub && (node->frame->topic == frame->topic)) {
+            IPCS_SharedFrameRef(frame);
+            conn->outBytes = conn->outBytes - node->frame->len + frame->len;
+            IPCS_SharedFrameUnref(node->frame);
+            node->frame = frame;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int IPCS_ConnHasTopic(const IPCS_Conn *conn, unsigned int topic)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < conn->topicNum; i++) {
+        if ((conn->topics[i] == topic) || (conn->topics[i] == IPCS_TOPIC_ALL)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int IPCS_ConnAddTopic(IPCS_Conn *conn, unsigned int topic)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < conn->topicNum; i++) {
+        if (conn->topics[i] == topic) {
+            return IPCS_OK;
+        }
+    }
+
+    if (conn->topicNum >= IPCS_CONN_MAX_TOPICS) {
+        return IPCS_TOO_MANY_TOPICS;
+    }
+
+    conn->topics[conn->topicNum++] = topic;
+
+    return IPCS_OK;
+}
+
+void IPCS_ConnDelTopic(IPCS_Conn *conn, unsigned int topic)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < conn->topicNum; i++) {
+        if (conn->topics[i] == topic) {
+            conn->topics[i] = conn->topics[--conn->topicNum];
+            return;
+        }
+    }
+
+    return;
+}
+
+/******************************************************************************/
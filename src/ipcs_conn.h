@@ -0,0 +1,233 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_conn.h
+ *
+ *    Description:  IPC socket server side connection table
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:40:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_CONN_H__
+#define __IPCS_CONN_H__
+
+#include "ipcs_common.h"
+#include "ipcs_shed.h"
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/******************************************************************************/
+/* 接收缓冲区最大能放下一个不完整的帧加上一次读到的数据；新连接和空闲连接只保留最小的缓冲区 */
+#define IPCS_CONN_RECV_BUF_LEN      (2 * IPCS_FRAME_MAX_LEN)
+#define IPCS_CONN_RECV_MIN_LEN      (4 * 1024)
+
+/* 一个连接最多订阅的主题数 */
+#define IPCS_CONN_MAX_TOPICS        32
+
+/* 发送队列一次最多合并发送的帧数 */
+#define IPCS_CONN_SEND_IOV          64
+
+/**
+ * 编码后的帧，发布时只编码一次，按引用计数挂到每个订阅者的发送队列上，
+ * 最后一个引用释放时释放。
+ **/
+typedef struct {
+    unsigned int refCount;
+    unsigned int topic;
+    unsigned int len;
+    char data[];
+} IPCS_SharedFrame;
+
+/* 发送队列的节点，isPub为0表示排在发布消息之后的响应，不会被丢弃或合并 */
+typedef struct IPCS_OutFrame {
+    IPCS_SharedFrame *frame;
+    int isPub;
+    int isHigh;
+    struct IPCS_OutFrame *next;
+} IPCS_OutFrame;
+
+/**
+ * 服务端的每个连接。
+ * recvBuf保存一次读到的不完整的尾帧，读到剩余部分后再交给回调函数。
+ * io_uring引擎的发送：sendBuf是正在发送的数据，pendBuf累积本轮事件中回调函数发出的响应，
+ * 上一次发送完成后两者交换，一个连接同时只有一个发送请求，保证数据顺序。
+ * 发送队列outHead：发布的消息，以及队列不为空时回调函数发出的响应（保持顺序）；
+ * pendBuf只在队列为空时追加，所以pendBuf中的数据总是先于队列中的普通帧发送。
+ * 优先级：高优先级帧插在队列中已有的高优先级帧之后、尚未开始发送的普通帧之前，
+ * io_uring引擎中还可以先于pendBuf发送。接收到的数据在一轮事件中先处理所有连接的
+ * 高优先级帧，有剩余数据的连接挂在recvList上，本轮最后再处理普通帧。
+ * 流量控制：接收缓冲区、pendBuf、sendBuf和发送队列中尚未处理或发出的字节数（积压）超过
+ * 服务端的connCredit时暂停接收（recvPaused），请求留在内核的socket缓冲区中，客户端写满后阻塞。
+ **/
+typedef struct IPCS_Conn {
+    int fd;
+    unsigned long long serial;      /* 连接表中递增的序号，fd被新连接重用后可以区分 */
+    struct IPCS_ServerListener *listener;   /* 接受该连接的服务端，共享反应器时用于找到回调函数 */
+    char *recvBuf;
+    size_t recvLen;
+    size_t recvCap;
+    int recvFilled;                 /* 上次读满了接收缓冲区的空闲空间，下次加倍 */
+    int recvPaused;
+    int recvArmed;                  /* io_uring引擎：multishot recv尚未结束 */
+    int active;                     /* 上次空闲检查之后收到过数据 */
+
+    char *sendBuf;
+    size_t sendLen;
+    size_t sendOff;
+    size_t sendCap;
+    char *pendBuf;
+    size_t pendLen;
+    size_t pendCap;
+    int sendInFlight;
+    int sendBroken;
+    int recvActive;
+    int flushQueued;
+    struct IPCS_Conn *nextFlush;
+    int recvQueued;
+    struct IPCS_Conn *nextRecv;
+
+    IPCS_OutFrame *outHead;
+    IPCS_OutFrame *outTail;
+    size_t outOff;                  /* 队首帧已发送的字节数 */
+    size_t outBytes;                /* 队列中帧的总字节数 */
+    unsigned int outPubNum;         /* 队列中发布消息的个数 */
+    int outWatch;                   /* epoll引擎：已注册EPOLLOUT */
+    unsigned int sendFromQueue;     /* io_uring引擎：正在发送的队首帧数 */
+    struct iovec sendIov[IPCS_CONN_SEND_IOV];
+    struct msghdr sendHdr;
+
+    unsigned int topics[IPCS_CONN_MAX_TOPICS];
+    unsigned int topicNum;
+
+    IPCS_TokenBucket shedBucket;    /* 过载保护：令牌桶策略下该连接的请求速率 */
+    unsigned int frameFlags;        /* 客户端协商的帧选项（校验和、压缩），发给它的帧按选项编码 */
+} IPCS_Conn;
+
+/* 按fd索引的连接表，只由所属服务端线程访问 */
+typedef struct {
+    IPCS_Conn **conns;
+    unsigned int cap;
+    unsigned int num;
+    unsigned long long serial;
+    void *owner;                    /* 所属的服务端线程，不为NULL时连接登记在全局的连接归属表中 */
+} IPCS_ConnTable;
+
+/**
+ * 连接归属表：按fd索引，记录连接所属的服务端线程和连接的序号，由一个全局锁保护。
+ * 其他线程向连接发送时持有锁查找所属线程并把发送交给它；服务端线程删除连接（关闭fd之前）
+ * 时清除登记，所以持有锁时查到的线程不会被释放。
+ **/
+typedef struct {
+    void *owner;
+    unsigned long long serial;
+} IPCS_ConnOwner;
+
+/******************************************************************************/
+void IPCS_ConnTableInit(IPCS_ConnTable *table);
+
+void IPCS_ConnFree(IPCS_Conn *conn);
+
+int IPCS_ConnTableGrow(IPCS_ConnTable *table, int fd);
+
+/* 关闭并释放所有连接 */
+void IPCS_ConnTableDestroy(IPCS_ConnTable *table);
+
+IPCS_Conn *IPCS_ConnTableAdd(IPCS_ConnTable *table, int fd);
+
+IPCS_Conn *IPCS_ConnTableGet(const IPCS_ConnTable *table, int fd);
+
+/* 从表中删除，关闭fd */
+void IPCS_ConnTableDel(IPCS_ConnTable *table, int fd);
+
+void IPCS_ConnOwnersLock(void);
+
+void IPCS_ConnOwnersUnlock(void);
+
+/* 持有锁时调用：fd所属的服务端线程，serial返回连接的序号；不是服务端的连接时返回NULL */
+void *IPCS_ConnOwnerGet(int fd, unsigned long long *serial);
+
+/* 登记失败（内存不足）时其他线程找不到该连接，不影响服务端线程自己发送 */
+void IPCS_ConnOwnerSet(int fd, void *owner, unsigned long long serial);
+
+void IPCS_ConnOwnerClear(int fd, void *owner);
+
+/* 持有锁时在fork出的子进程中调用：子进程中没有父进程的服务端线程 */
+void IPCS_ConnOwnersClearAll(void);
+
+/******************************************************************************/
+/* 服务端连接占用内存的统计，所有服务端线程共用 */
+void IPCS_MemCharge(size_t len);
+
+void IPCS_MemUncharge(size_t len);
+
+int IPCS_MemOverBudget(void);
+
+/******************************************************************************/
+/* 从recvBuf头部删除已处理的数据 */
+void IPCS_ConnConsumeRecv(IPCS_Conn *conn, size_t len);
+
+/* 保证recvBuf还能追加len字节，最大扩大到IPCS_CONN_RECV_BUF_LEN，仍放不下时返回IPCS_BUF_TOO_SMALL */
+int IPCS_ConnReserveRecv(IPCS_Conn *conn, size_t len);
+
+/* 保证pendBuf还能追加len字节 */
+int IPCS_ConnReservePend(IPCS_Conn *conn, size_t len);
+
+/* pendBuf中的数据转为正在发送，返回是否有数据需要发送 */
+int IPCS_ConnSwapPend(IPCS_Conn *conn);
+
+/* 尚未处理的请求和尚未发出的响应、发布消息的字节数 */
+size_t IPCS_ConnBacklog(const IPCS_Conn *conn);
+
+/* 空闲连接：接收缓冲区缩回最小，释放空的发送缓冲区；返回是否还占用多于最小的缓冲区 */
+int IPCS_ConnTrim(IPCS_Conn *conn);
+
+/******************************************************************************/
+/* 编码一次，引用计数为1；frameFlags为要加上的帧标志，其中的帧选项按IPCS_MsgToStreamFlags处理 */
+IPCS_SharedFrame *IPCS_SharedFrameNew(IPCS_Message *msg, unsigned int callId, IPCS_Priority prio,
+        unsigned int frameFlags);
+
+/* 复制已编码的数据，引用计数为1 */
+IPCS_SharedFrame *IPCS_SharedFrameCopy(const void *data, unsigned int len);
+
+/* 按帧选项重新编码不带选项的帧，给协商了校验和或压缩的订阅者 */
+IPCS_SharedFrame *IPCS_SharedFrameWithFlags(const IPCS_SharedFrame *plain, unsigned int frameFlags);
+
+void IPCS_SharedFrameRef(IPCS_SharedFrame *frame);
+
+void IPCS_SharedFrameUnref(IPCS_SharedFrame *frame);
+
+/* 追加到发送队列（高优先级帧插到普通帧之前），增加引用计数 */
+int IPCS_ConnPushOut(IPCS_Conn *conn, IPCS_SharedFrame *frame, int isPub);
+
+/* 删除队首帧 */
+void IPCS_ConnPopOut(IPCS_Conn *conn);
+
+void IPCS_ConnClearOut(IPCS_Conn *conn);
+
+/* 从队首开始填充iovec（队首帧跳过已发送的部分），highOnly时遇到普通帧为止，返回帧数 */
+unsigned int IPCS_ConnFillOutIov(const IPCS_Conn *conn, struct iovec *iov, unsigned int maxIov, int highOnly);
+
+/* 已发送len字节：删除发送完的帧，记录队首帧已发送的部分 */
+void IPCS_ConnAdvanceOut(IPCS_Conn *conn, size_t len);
+
+/* 合并：用frame替换队列中同一主题、尚未开始发送的发布消息，返回是否替换 */
+int IPCS_ConnConflateOut(IPCS_Conn *conn, IPCS_SharedFrame *frame);
+
+int IPCS_ConnHasTopic(const IPCS_Conn *conn, unsigned int topic);
+
+int IPCS_ConnAddTopic(IPCS_Conn *conn, unsigned int topic);
+
+void IPCS_ConnDelTopic(IPCS_Conn *conn, unsigned int topic);
+
+/******************************************************************************/
+#endif /* __IPCS_CONN_H__ */
@@ -0,0 +1,295 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_crc.c
+ *
+ *    Description:  IPC socket CRC32C
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:38:46 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_crc.h"
+
+#include <pthread.h>
+#include <string.h>
+
+/******************************************************************************/
+typedef uint32_t (*IPCS_Crc32cFunc)(uint32_t crc, const void *data, size_t len);
+
+/**
+ * crc32指令的延迟是3个周期、每周期可以发出一条，单独一路计算只用到三分之一的吞吐。
+ * 硬件实现把一段数据分成相邻的三块同时计算，再把前面块的CRC移过后面块的长度（乘以
+ * 对应长度的0字节的算子，按字节查表）后合并。长块用于大消息，短块用于剩余部分。
+ **/
+#define IPCS_CRC32C_LONG            8192
+#define IPCS_CRC32C_SHORT           256
+
+static uint32_t g_IpcsCrc32cTable[8][256];
+static uint32_t g_IpcsCrc32cLong[4][256];
+static uint32_t g_IpcsCrc32cShort[4][256];
+static IPCS_Crc32cFunc g_IpcsCrc32cImpl = IPCS_Crc32cSw;
+static pthread_once_t g_IpcsCrc32cOnce = PTHREAD_ONCE_INIT;
+
+/* GF(2)上的32x32矩阵乘以向量，mat[n]是第n位对应的列 */
+static uint32_t IPCS_Gf2MatrixTimes(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+
+    while (vec != 0) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+
+    return sum;
+}
+
+static void IPCS_Gf2MatrixSquare(uint32_t *square, const uint32_t *mat)
+{
+    unsigned int n = 0;
+
+    for (n = 0; n < 32; n++) {
+        square[n] = IPCS_Gf2MatrixTimes(mat, mat[n]);
+    }
+
+    return;
+}
+
+/* len个0字节的算子，len为2的幂：从1个0位的算子开始反复平方 */
+static void IPCS_Crc32cZerosOp(uint32_t *even, size_t len)
+{
+    uint32_t odd[32];
+    uint32_t row = 1;
+    unsigned int n = 0;
+
+    odd[0] = IPCS_CRC32C_POLY;
+    for (n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    IPCS_Gf2MatrixSquare(even, odd);    /* 2个0位 */
+    IPCS_Gf2MatrixSquare(odd, even);    /* 4个0位 */
+
+    /* 第一次平方得到1个0字节的算子，之后每次长度加倍 */
+    do {
+        IPCS_Gf2MatrixSquare(even, odd);
+        len >>= 1;
+        if (len == 0) {
+            return;
+        }
+        IPCS_Gf2MatrixSquare(odd, even);
+        len >>= 1;
+    } while (len != 0);
+
+    (void)memcpy(even, odd, sizeof(odd));
+
+    return;
+}
+
+static void IPCS_Crc32cZeros(uint32_t zeros[][256], size_t len)
+{
+    uint32_t op[32];
+    unsigned int n = 0;
+
+    IPCS_Crc32cZerosOp(op, len);
+    for (n = 0; n < 256; n++) {
+        zeros[0][n] = IPCS_Gf2MatrixTimes(op, n);
+        zeros[1][n] = IPCS_Gf2MatrixTimes(op, n << 8);
+        zeros[2][n] = IPCS_Gf2MatrixTimes(op, n << 16);
+        zeros[3][n] = IPCS_Gf2MatrixTimes(op, n << 24);
+    }
+
+    return;
+}
+
+/* crc后面再跟表对应长度的0字节 */
+static uint32_t IPCS_Crc32cShift(uint32_t zeros[][256], uint32_t crc)
+{
+    return zeros[0][crc & 0xFF] ^ zeros[1][(crc >> 8) & 0xFF] ^ zeros[2][(crc >> 16) & 0xFF] ^ zeros[3][crc >> 24];
+}
+
+/* 查表和实现的选择只做一次 */
+static void IPCS_Crc32cInit(void)
+{
+    uint32_t crc = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ IPCS_CRC32C_POLY) : (crc >> 1);
+        }
+        g_IpcsCrc32cTable[0][i] = crc;
+    }
+
+    /* table[k][i]：字节i后面再跟k个0字节的CRC */
+    for (i = 0; i < 256; i++) {
+        crc = g_IpcsCrc32cTable[0][i];
+        for (j = 1; j < 8; j++) {
+            crc = (crc >> 8) ^ g_IpcsCrc32cTable[0][crc & 0xFF];
+            g_IpcsCrc32cTable[j][i] = crc;
+        }
+    }
+
+    IPCS_Crc32cZeros(g_IpcsCrc32cLong, IPCS_CRC32C_LONG);
+    IPCS_Crc32cZeros(g_IpcsCrc32cShort, IPCS_CRC32C_SHORT);
+
+    if (IPCS_Crc32cHwSupported()) {
+        g_IpcsCrc32cImpl = IPCS_Crc32cHw;
+    }
+
+    return;
+}
+
+uint32_t IPCS_Crc32c(uint32_t crc, const void *data, size_t len)
+{
+    (void)pthread_once(&g_IpcsCrc32cOnce, IPCS_Crc32cInit);
+
+    return g_IpcsCrc32cImpl(crc, data, len);
+}
+
+/******************************************************************************/
+uint32_t IPCS_Crc32cSw(uint32_t crc, const void *data, size_t len)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+
+    (void)pthread_once(&g_IpcsCrc32cOnce, IPCS_Crc32cInit);
+
+    crc = ~crc;
+    while ((len != 0) && (((uintptr_t)buf & 7) != 0)) {
+        crc = (crc >> 8) ^ g_IpcsCrc32cTable[0][(crc ^ *buf++) & 0xFF];
+        len--;
+    }
+
+    /* 小端：一次处理8字节，低4字节与crc异或 */
+    while (len >= 8) {
+        (void)memcpy(&lo, buf, sizeof(lo));
+        (void)memcpy(&hi, buf + 4, sizeof(hi));
+        lo ^= crc;
+        crc = g_IpcsCrc32cTable[7][lo & 0xFF] ^ g_IpcsCrc32cTable[6][(lo >> 8) & 0xFF] ^
+              g_IpcsCrc32cTable[5][(lo >> 16) & 0xFF] ^ g_IpcsCrc32cTable[4][lo >> 24] ^
+              g_IpcsCrc32cTable[3][hi & 0xFF] ^ g_IpcsCrc32cTable[2][(hi >> 8) & 0xFF] ^
+              g_IpcsCrc32cTable[1][(hi >> 16) & 0xFF] ^ g_IpcsCrc32cTable[0][hi >> 24];
+        buf += 8;
+        len -= 8;
+    }
+
+    while (len != 0) {
+        crc = (crc >> 8) ^ g_IpcsCrc32cTable[0][(crc ^ *buf++) & 0xFF];
+        len--;
+    }
+
+    return ~crc;
+}
+
+/******************************************************************************/
+#if defined(__x86_64__)
+
+/* 三块同时计算，每块blockLen字节，zeros为blockLen个0字节的移位表 */
+__attribute__((target("sse4.2")))
+static const unsigned char *IPCS_Crc32cHw3(uint64_t *crc, const unsigned char *buf, size_t blockLen,
+        uint32_t zeros[][256])
+{
+    const unsigned char *end = buf + blockLen;
+    uint64_t crc0 = *crc;
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    uint64_t word0 = 0;
+    uint64_t word1 = 0;
+    uint64_t word2 = 0;
+
+    do {
+        (void)memcpy(&word0, buf, sizeof(word0));
+        (void)memcpy(&word1, buf + blockLen, sizeof(word1));
+        (void)memcpy(&word2, buf + 2 * blockLen, sizeof(word2));
+        crc0 = __builtin_ia32_crc32di(crc0, word0);
+        crc1 = __builtin_ia32_crc32di(crc1, word1);
+        crc2 = __builtin_ia32_crc32di(crc2, word2);
+        buf += 8;
+    } while (buf < end);
+
+    crc0 = IPCS_Crc32cShift(zeros, (uint32_t)crc0) ^ crc1;
+    crc0 = IPCS_Crc32cShift(zeros, (uint32_t)crc0) ^ crc2;
+    *crc = crc0;
+
+    return buf + 2 * blockLen;
+}
+
+__attribute__((target("sse4.2")))
+uint32_t IPCS_Crc32cHw(uint32_t crc, const void *data, size_t len)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+    uint64_t crc64 = 0;
+    uint64_t word = 0;
+
+    (void)pthread_once(&g_IpcsCrc32cOnce, IPCS_Crc32cInit);
+
+    crc = ~crc;
+    while ((len != 0) && (((uintptr_t)buf & 7) != 0)) {
+        crc = __builtin_ia32_crc32qi(crc, *buf++);
+        len--;
+    }
+
+    crc64 = crc;
+    while (len >= 3 * IPCS_CRC32C_LONG) {
+        buf = IPCS_Crc32cHw3(&crc64, buf, IPCS_CRC32C_LONG, g_IpcsCrc32cLong);
+        len -= 3 * IPCS_CRC32C_LONG;
+    }
+    while (len >= 3 * IPCS_CRC32C_SHORT) {
+        buf = IPCS_Crc32cHw3(&crc64, buf, IPCS_CRC32C_SHORT, g_IpcsCrc32cShort);
+        len -= 3 * IPCS_CRC32C_SHORT;
+    }
+
+    while (len >= 8) {
+        (void)memcpy(&word, buf, sizeof(word));
+        crc64 = __builtin_ia32_crc32di(crc64, word);
+        buf += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)crc64;
+
+    while (len != 0) {
+        crc = __builtin_ia32_crc32qi(crc, *buf++);
+        len--;
+    }
+
+    return ~crc;
+}
+
+int IPCS_Crc32cHwSupported(void)
+{
+    __builtin_cpu_init();
+
+    return (__builtin_cpu_supports("sse4.2") != 0);
+}
+
+#else
+
+/* 其他架构只用查表实现 */
+uint32_t IPCS_Crc32cHw(uint32_t crc, const void *data, size_t len)
+{
+    return IPCS_Crc32cSw(crc, data, len);
+}
+
+int IPCS_Crc32cHwSupported(void)
+{
+    return 0;
+}
+
+#endif
+
+/******************************************************************************/
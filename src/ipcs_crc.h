@@ -0,0 +1,46 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_crc.h
+ *
+ *    Description:  IPC socket CRC32C
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:38:46 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_CRC_H__
+#define __IPCS_CRC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * CRC32C（Castagnoli，反射多项式0x82F63B78），用于帧尾的校验和。
+ * x86上CPU支持SSE4.2时用crc32指令，每次处理8字节；否则用slicing-by-8查表。
+ * 第一次计算时检测CPU选择实现，之后不再判断。
+ **/
+#define IPCS_CRC32C_POLY            0x82F63B78U
+
+/* crc为上一段的结果，第一段传0；结果已取反，可直接比较 */
+uint32_t IPCS_Crc32c(uint32_t crc, const void *data, size_t len);
+
+/* 两种实现，测试和基准测试中直接比较 */
+uint32_t IPCS_Crc32cSw(uint32_t crc, const void *data, size_t len);
+
+uint32_t IPCS_Crc32cHw(uint32_t crc, const void *data, size_t len);
+
+/* CPU是否支持crc32指令 */
+int IPCS_Crc32cHwSupported(void);
+
+/******************************************************************************/
+
+#endif /* __IPCS_CRC_H__ */
@@ -0,0 +1,586 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_handoff.c
+ *
+ *    Description:  IPC socket server hot restart (listening socket and connection handoff)
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:47:31 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE                 /* accept4 */
+
+#include "ipcs_handoff.h"
+#include "ipcs_server.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+/* 等待fd可读或可写，最多等到deadlineNs */
+static int IPCS_HandoffWait(int fd, short events, uint64_t deadlineNs)
+{
+    struct pollfd pfd;
+    uint64_t nowNs = 0;
+    int result = 0;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    for (; ; ) {
+        nowNs = IPCS_GetNowNs();
+        if (nowNs >= deadlineNs) {
+            return IPCS_TIMEOUT;
+        }
+
+        pfd.revents = 0;
+        result = poll(&pfd, 1, (int)((deadlineNs - nowNs + 999999ULL) / 1000000ULL));
+        if (result > 0) {
+            return IPCS_OK;
+        }
+        if ((result < 0) && (errno != EINTR)) {
+            return IPCS_READ_FAIL;
+        }
+    }
+}
+
+int IPCS_HandoffConnect(const char *handoffName, int *ctrlFd)
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen = 0;
+    int fd = -1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket error");
+        return IPCS_SOCKET_FAIL;
+    }
+
+    (void)IPCS_FillSockAddr(handoffName, &addr, &addrLen);
+    if (connect(fd, (struct sockaddr *)&addr, addrLen) < 0) {
+        IPCS_WriteLog("Handoff: connect %s fail, errno: %d", handoffName, errno);
+        (void)close(fd);
+        return IPCS_CONNECT_FAIL;
+    }
+
+    *ctrlFd = fd;
+
+    return IPCS_OK;
+}
+
+int IPCS_HandoffAccept(const char *handoffName, uint64_t deadlineNs, int *ctrlFd)
+{
+    int listenFd = -1;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    result = IPCS_CreateServerSocket(handoffName, &listenFd);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    do {
+        result = IPCS_HandoffWait(listenFd, POLLIN, deadlineNs);
+        if (result != IPCS_OK) {
+            break;
+        }
+        fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+    } while ((fd < 0) && ((errno == EAGAIN) || (errno == EINTR)));
+
+    /* 只接管一次，控制socket用完即删除 */
+    (void)close(listenFd);
+    IPCS_UnlinkSockName(handoffName);
+
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Handoff: wait on %s fail: %d", handoffName, result);
+        return result;
+    }
+    if (fd < 0) {
+        perror("accept error");
+        return IPCS_ACCEPT_FAIL;
+    }
+
+    *ctrlFd = fd;
+
+    return IPCS_OK;
+}
+
+int IPCS_HandoffSendAll(int ctrlFd, const void *buf, size_t len, uint64_t deadlineNs)
+{
+    const char *data = (const char *)buf;
+    ssize_t sendLen = 0;
+    int result = IPCS_OK;
+
+    while (len != 0) {
+        sendLen = send(ctrlFd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sendLen < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+                return IPCS_WRITE_FAIL;
+            }
+            result = IPCS_HandoffWait(ctrlFd, POLLOUT, deadlineNs);
+            if (result != IPCS_OK) {
+                return result;
+            }
+            continue;
+        }
+
+        data += sendLen;
+        len -= (size_t)sendLen;
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_HandoffRecvAll(int ctrlFd, void *buf, size_t len, uint64_t deadlineNs)
+{
+    char *data = (char *)buf;
+    ssize_t recvLen = 0;
+    int result = IPCS_OK;
+
+    while (len != 0) {
+        recvLen = recv(ctrlFd, data, len, MSG_DONTWAIT);
+        if (recvLen == 0) {
+            return IPCS_PEER_CLOSED;
+        }
+        if (recvLen < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+                return IPCS_READ_FAIL;
+            }
+            result = IPCS_HandoffWait(ctrlFd, POLLIN, deadlineNs);
+            if (result != IPCS_OK) {
+                return result;
+            }
+            continue;
+        }
+
+        data += recvLen;
+        len -= (size_t)recvLen;
+    }
+
+    return IPCS_OK;
+}
+
+/* fd附在记录的第一个字节上，记录没有一次发完时剩余部分普通发送 */
+int IPCS_HandoffSendRecord(int ctrlFd, const IPCS_HandoffRecord *record, int fd, uint64_t deadlineNs)
+{
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct cmsghdr *cmsg = NULL;
+    struct msghdr hdr;
+    struct iovec iov;
+    ssize_t sendLen = 0;
+    int result = IPCS_OK;
+
+    (void)memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = (void *)record;
+    iov.iov_len = sizeof(IPCS_HandoffRecord);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    if (fd >= 0) {
+        (void)memset(&control, 0, sizeof(control));
+        hdr.msg_control = control.buf;
+        hdr.msg_controllen = sizeof(control.buf);
+        cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        (void)memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    for (; ; ) {
+        sendLen = sendmsg(ctrlFd, &hdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sendLen >= 0) {
+            break;
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+            IPCS_WriteLog("Handoff: send record fail, errno: %d", errno);
+            return IPCS_WRITE_FAIL;
+        }
+        result = IPCS_HandoffWait(ctrlFd, POLLOUT, deadlineNs);
+        if (result != IPCS_OK) {
+            return result;
+        }
+    }
+
+    return IPCS_HandoffSendAll(ctrlFd, (const char *)record + sendLen, sizeof(IPCS_HandoffRecord) - (size_t)sendLen,
+            deadlineNs);
+}
+
+int IPCS_HandoffRecvRecord(int ctrlFd, IPCS_HandoffRecord *record, int *fd, uint64_t deadlineNs)
+{
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct cmsghdr *cmsg = NULL;
+    struct msghdr hdr;
+    struct iovec iov;
+    ssize_t recvLen = 0;
+    int result = IPCS_OK;
+
+    *fd = -1;
+    (void)memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = record;
+    iov.iov_len = sizeof(IPCS_HandoffRecord);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control.buf;
+    hdr.msg_controllen = sizeof(control.buf);
+
+    for (; ; ) {
+        recvLen = recvmsg(ctrlFd, &hdr, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+        if (recvLen > 0) {
+            break;
+        }
+        if (recvLen == 0) {
+            return IPCS_PEER_CLOSED;
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+            return IPCS_READ_FAIL;
+        }
+        result = IPCS_HandoffWait(ctrlFd, POLLIN, deadlineNs);
+        if (result != IPCS_OK) {
+            return result;
+        }
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS) &&
+            (cmsg->cmsg_len == CMSG_LEN(sizeof(int)))) {
+            (void)memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    result = IPCS_HandoffRecvAll(ctrlFd, (char *)record + recvLen, sizeof(IPCS_HandoffRecord) - (size_t)recvLen,
+            deadlineNs);
+    if ((result == IPCS_OK) && (record->magic != IPCS_HANDOFF_MAGIC)) {
+        result = IPCS_STREAM_BUF_BAD;
+    }
+    if ((result != IPCS_OK) && (*fd >= 0)) {
+        (void)close(*fd);
+        *fd = -1;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+static int IPCS_HandoffRecvConn(int ctrlFd, const IPCS_HandoffRecord *record, int fd, uint64_t deadlineNs,
+        IPCS_HandoffConn **conns)
+{
+    IPCS_HandoffConn *node = NULL;
+    int result = IPCS_OK;
+
+    if ((record->recvLen > IPCS_CONN_RECV_BUF_LEN) || (record->outLen > IPCS_HANDOFF_MAX_OUT) ||
+        (record->topicNum > IPCS_CONN_MAX_TOPICS) || (fd < 0)) {
+        IPCS_WriteLog("Handoff: bad conn record, recv: %u, out: %u, topics: %u, fd: %d", record->recvLen,
+                record->outLen, record->topicNum, fd);
+        return IPCS_STREAM_BUF_BAD;
+    }
+
+    node = (IPCS_HandoffConn *)calloc(1, sizeof(IPCS_HandoffConn));
+    if (node == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    node->fd = fd;
+    node->record = *record;
+    node->next = *conns;
+    *conns = node;
+
+    if (record->recvLen + record->outLen == 0) {
+        return IPCS_OK;
+    }
+
+    node->data = (char *)malloc(record->recvLen + record->outLen);
+    if (node->data == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    result = IPCS_HandoffRecvAll(ctrlFd, node->data, record->recvLen + record->outLen, deadlineNs);
+
+    return result;
+}
+
+int IPCS_HandoffRecvServer(int ctrlFd, uint64_t deadlineNs, int *listenFd, IPCS_HandoffConn **conns)
+{
+    IPCS_HandoffRecord record;
+    unsigned int connNum = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    *listenFd = -1;
+    *conns = NULL;
+    for (; ; ) {
+        result = IPCS_HandoffRecvRecord(ctrlFd, &record, &fd, deadlineNs);
+        if (result != IPCS_OK) {
+            break;
+        }
+
+        if ((record.type == IPCS_HANDOFF_LISTENER) && (fd >= 0) && (*listenFd < 0)) {
+            *listenFd = fd;
+        } else if (record.type == IPCS_HANDOFF_CONN) {
+            /* 记录已挂到列表上时fd随列表释放 */
+            result = IPCS_HandoffRecvConn(ctrlFd, &record, fd, deadlineNs, conns);
+            if ((result != IPCS_OK) && ((*conns == NULL) || ((*conns)->fd != fd))) {
+                (void)close(fd);
+            }
+            connNum++;
+        } else if ((record.type == IPCS_HANDOFF_END) && (*listenFd >= 0)) {
+            break;
+        } else {
+            if (fd >= 0) {
+                (void)close(fd);
+            }
+            result = IPCS_STREAM_BUF_BAD;
+        }
+
+        if (result != IPCS_OK) {
+            break;
+        }
+    }
+
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Handoff: recv server fail: %d after %u conns", result, connNum);
+        if (*listenFd >= 0) {
+            (void)close(*listenFd);
+            *listenFd = -1;
+        }
+        IPCS_HandoffFreeConns(*conns, 1);
+        *conns = NULL;
+        return result;
+    }
+
+    IPCS_WriteLog("Handoff: recv listen socket %d and %u conns.", *listenFd, connNum);
+
+    return IPCS_OK;
+}
+
+void IPCS_HandoffFreeConns(IPCS_HandoffConn *conns, int closeFd)
+{
+    IPCS_HandoffConn *node = NULL;
+
+    while ((node = conns) != NULL) {
+        conns = node->next;
+        if (closeFd && (node->fd >= 0)) {
+            (void)close(node->fd);
+        }
+        free(node->data);
+        free(node);
+    }
+
+    return;
+}
+
+/******************************************************************************/
+/* 连接的记录和数据：接收缓冲区中的数据原样发送（已处理的高优先级帧带有标记），发送队列从队首帧未发出的部分开始 */
+static int IPCS_HandoffSendConn(int ctrlFd, const IPCS_Conn *conn, uint64_t deadlineNs)
+{
+    IPCS_HandoffRecord record;
+    const IPCS_OutFrame *node = NULL;
+    size_t off = conn->outOff;
+    int result = IPCS_OK;
+
+    (void)memset(&record, 0, sizeof(record));
+    record.magic = IPCS_HANDOFF_MAGIC;
+    record.type = IPCS_HANDOFF_CONN;
+    record.recvLen = (unsigned int)conn->recvLen;
+    record.outLen = (unsigned int)(conn->outBytes - conn->outOff);
+    record.topicNum = conn->topicNum;
+    record.frameFlags = conn->frameFlags;
+    (void)memcpy(record.topics, conn->topics, sizeof(record.topics));
+    if (record.outLen > IPCS_HANDOFF_MAX_OUT) {
+        return IPCS_MSG_TOO_LONG;
+    }
+
+    result = IPCS_HandoffSendRecord(ctrlFd, &record, conn->fd, deadlineNs);
+    if ((result == IPCS_OK) && (conn->recvLen != 0)) {
+        result = IPCS_HandoffSendAll(ctrlFd, conn->recvBuf, conn->recvLen, deadlineNs);
+    }
+    for (node = conn->outHead; (node != NULL) && (result == IPCS_OK); node = node->next) {
+        result = IPCS_HandoffSendAll(ctrlFd, node->frame->data + off, node->frame->len - off, deadlineNs);
+        off = 0;
+    }
+
+    return result;
+}
+
+int IPCS_ServerHandoffListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener)
+{
+    IPCS_HandoffRecord record;
+    IPCS_Conn *conn = NULL;
+    unsigned int connNum = 0;
+    unsigned int i = 0;
+    int ack = IPCS_OK;
+    int result = IPCS_OK;
+
+    /* io_uring引擎中连接上有进行中的recv，不能在不丢数据的情况下停下 */
+    if ((threadArg->ring != NULL) || (listener->listenFd < 0) || (listener->closing)) {
+        IPCS_WriteLog("Handoff server: %s not supported on this server.", listener->name);
+        return IPCS_HANDOFF_FAIL;
+    }
+
+    (void)memset(&record, 0, sizeof(record));
+    record.magic = IPCS_HANDOFF_MAGIC;
+    record.type = IPCS_HANDOFF_LISTENER;
+    result = IPCS_HandoffSendRecord(listener->handoffFd, &record, listener->listenFd, listener->handoffDeadlineNs);
+
+    for (i = 0; (i < threadArg->conns.cap) && (result == IPCS_OK); i++) {
+        conn = threadArg->conns.conns[i];
+        if ((conn != NULL) && (conn->listener == listener)) {
+            result = IPCS_HandoffSendConn(listener->handoffFd, conn, listener->handoffDeadlineNs);
+            connNum++;
+        }
+    }
+
+    if (result == IPCS_OK) {
+        record.type = IPCS_HANDOFF_END;
+        result = IPCS_HandoffSendRecord(listener->handoffFd, &record, -1, listener->handoffDeadlineNs);
+    }
+    if (result == IPCS_OK) {
+        result = IPCS_HandoffRecvAll(listener->handoffFd, &ack, sizeof(ack), listener->handoffDeadlineNs);
+    }
+    if ((result == IPCS_OK) && (ack != IPCS_OK)) {
+        result = IPCS_HANDOFF_FAIL;
+    }
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Handoff server: %s fail: %d, keep serving.", listener->name, result);
+        return result;
+    }
+
+    /* 新进程已接管：fd仍被新进程引用，关闭前先从epoll中删除，否则还会收到事件 */
+    (void)epoll_ctl(threadArg->epollFd, EPOLL_CTL_DEL, listener->listenFd, NULL);
+    (void)close(listener->listenFd);
+    listener->listenFd = -1;
+    for (i = 0; i < threadArg->conns.cap; i++) {
+        conn = threadArg->conns.conns[i];
+        if ((conn != NULL) && (conn->listener == listener)) {
+            (void)epoll_ctl(threadArg->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+            (void)IPCS_ServerCloseClient(threadArg, conn->fd);
+        }
+    }
+
+    IPCS_WriteLog("Handoff server: %s with %u conns success.", listener->name, connNum);
+
+    return IPCS_OK;
+}
+
+void IPCS_ServerHandleHandoffs(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerListener *listener = NULL;
+    int result = IPCS_OK;
+
+    for (listener = threadArg->listeners; listener != NULL; listener = listener->next) {
+        (void)pthread_mutex_lock(&threadArg->mutex);
+        if ((listener->handoffFd < 0) || listener->handoffDone) {
+            (void)pthread_mutex_unlock(&threadArg->mutex);
+            continue;
+        }
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+
+        result = IPCS_ServerHandoffListener(threadArg, listener);
+
+        (void)pthread_mutex_lock(&threadArg->mutex);
+        listener->handoffResult = result;
+        listener->handoffDone = 1;
+        (void)pthread_cond_broadcast(&threadArg->exitCond);
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+    }
+
+    return;
+}
+
+/******************************************************************************/
+static int IPCS_ServerAdoptConn(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener,
+        IPCS_HandoffConn *node)
+{
+    struct epoll_event epollEvent;
+    IPCS_SharedFrame *frame = NULL;
+    IPCS_Conn *conn = NULL;
+    int result = IPCS_OK;
+
+    conn = IPCS_ConnTableAdd(&threadArg->conns, node->fd);
+    if (conn == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    conn->listener = listener;
+    listener->connNum++;
+    conn->topicNum = node->record.topicNum;
+    conn->frameFlags = node->record.frameFlags & IPCS_FRAME_OPTIONS;
+    (void)memcpy(conn->topics, node->record.topics, sizeof(conn->topics));
+
+    if (threadArg->ring != NULL) {
+        result = IPCS_UringServerArmRecv(threadArg, conn);
+    } else {
+        epollEvent.events = EPOLLIN | EPOLLRDHUP;
+        epollEvent.data.fd = conn->fd;
+        if (epoll_ctl(threadArg->epollFd, EPOLL_CTL_ADD, conn->fd, &epollEvent) < 0) {
+            result = IPCS_EPOLL_CTL_FAIL;
+        }
+    }
+
+    if ((result == IPCS_OK) && (node->record.recvLen != 0)) {
+        result = IPCS_ConnReserveRecv(conn, node->record.recvLen);
+        if (result == IPCS_OK) {
+            (void)memcpy(conn->recvBuf, node->data, node->record.recvLen);
+            conn->recvLen = node->record.recvLen;
+            IPCS_ServerQueueRecv(threadArg, conn);
+        }
+    }
+
+    /* 未发出的数据作为一个普通帧放到发送队列中，不会被丢弃或合并 */
+    if ((result == IPCS_OK) && (node->record.outLen != 0)) {
+        frame = IPCS_SharedFrameCopy(node->data + node->record.recvLen, node->record.outLen);
+        result = (frame != NULL) ? IPCS_ConnPushOut(conn, frame, 0) : IPCS_MALLOC_FAIL;
+        if (frame != NULL) {
+            IPCS_SharedFrameUnref(frame);
+        }
+        if (result == IPCS_OK) {
+            IPCS_ServerKickConn(threadArg, conn);
+        }
+    }
+
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server: %s adopt client %d fail: %d", listener->name, node->fd, result);
+        (void)IPCS_ServerCloseClient(threadArg, node->fd);
+    }
+    node->fd = -1;
+
+    return result;
+}
+
+void IPCS_ServerAdoptConns(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener)
+{
+    IPCS_HandoffConn *node = NULL;
+    unsigned int adoptNum = 0;
+    uint64_t wakeValue = 1;
+
+    for (node = listener->adopted; node != NULL; node = node->next) {
+        if (IPCS_ServerAdoptConn(threadArg, listener, node) == IPCS_OK) {
+            adoptNum++;
+        }
+    }
+    IPCS_HandoffFreeConns(listener->adopted, 1);
+    listener->adopted = NULL;
+
+    /* 接收缓冲区中已有的请求和待发送的数据在本轮最后处理，唤醒一次以免阻塞在等待上 */
+    (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    IPCS_WriteLog("Server: %s adopt %u conns.", listener->name, adoptNum);
+
+    return;
+}
+
+/******************************************************************************/
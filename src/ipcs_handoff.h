@@ -0,0 +1,100 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_handoff.h
+ *
+ *    Description:  IPC socket server hot restart (listening socket and connection handoff)
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:47:31 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_HANDOFF_H__
+#define __IPCS_HANDOFF_H__
+
+#include "ipcs.h"
+#include "ipcs_common.h"
+#include "ipcs_conn.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 交接协议：旧进程连接新进程在handoffName上的控制socket，依次发送监听socket、每个连接、结束
+ * 三种记录，监听socket和连接的记录通过SCM_RIGHTS带一个fd；连接的记录之后是recvLen字节已收到
+ * 未处理的数据和outLen字节未发出的数据。新进程收完后回复一个int（IPCS_OK），旧进程收到后
+ * 才删除自己的fd，之前失败时照常服务。
+ **/
+#define IPCS_HANDOFF_MAGIC          0x49504348U     /* "IPCH" */
+#define IPCS_HANDOFF_MAX_OUT        (64 * 1024 * 1024)
+
+typedef enum {
+    IPCS_HANDOFF_LISTENER = 1,
+    IPCS_HANDOFF_CONN,
+    IPCS_HANDOFF_END,
+} IPCS_HandoffType;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int type;
+    unsigned int recvLen;
+    unsigned int outLen;
+    unsigned int topicNum;
+    unsigned int frameFlags;        /* 连接上协商的帧选项 */
+    unsigned int topics[IPCS_CONN_MAX_TOPICS];
+} IPCS_HandoffRecord;
+
+/* 新进程收到的连接，创建服务端后由服务端线程加入连接表；data中依次是recvLen和outLen字节 */
+typedef struct IPCS_HandoffConn {
+    int fd;
+    IPCS_HandoffRecord record;
+    char *data;
+    struct IPCS_HandoffConn *next;
+} IPCS_HandoffConn;
+
+struct IPCS_ServerThreadArg;
+struct IPCS_ServerListener;
+
+/******************************************************************************/
+/* 旧进程：连接新进程的控制socket，新进程还没有开始等待时返回IPCS_CONNECT_FAIL */
+int IPCS_HandoffConnect(const char *handoffName, int *ctrlFd);
+
+/* 新进程：在handoffName上等待旧进程连接，最多等到deadlineNs */
+int IPCS_HandoffAccept(const char *handoffName, uint64_t deadlineNs, int *ctrlFd);
+
+/* 发送一条记录，fd为-1时不带fd */
+int IPCS_HandoffSendRecord(int ctrlFd, const IPCS_HandoffRecord *record, int fd, uint64_t deadlineNs);
+
+/* 接收一条记录，没有带fd时*fd为-1 */
+int IPCS_HandoffRecvRecord(int ctrlFd, IPCS_HandoffRecord *record, int *fd, uint64_t deadlineNs);
+
+int IPCS_HandoffSendAll(int ctrlFd, const void *buf, size_t len, uint64_t deadlineNs);
+
+int IPCS_HandoffRecvAll(int ctrlFd, void *buf, size_t len, uint64_t deadlineNs);
+
+/* 新进程：收到结束记录为止，得到监听socket和连接 */
+int IPCS_HandoffRecvServer(int ctrlFd, uint64_t deadlineNs, int *listenFd, IPCS_HandoffConn **conns);
+
+/* closeFd为1时同时关闭连接的fd */
+void IPCS_HandoffFreeConns(IPCS_HandoffConn *conns, int closeFd);
+
+/******************************************************************************/
+/* 旧进程的服务端线程：发送监听socket和该服务端的所有连接，新进程确认后从本进程删除 */
+int IPCS_ServerHandoffListener(struct IPCS_ServerThreadArg *threadArg, struct IPCS_ServerListener *listener);
+
+/* 旧进程的服务端线程：处理其他线程提交的交接请求 */
+void IPCS_ServerHandleHandoffs(struct IPCS_ServerThreadArg *threadArg);
+
+/* 新进程的服务端线程：打开监听socket后加入接管的连接 */
+void IPCS_ServerAdoptConns(struct IPCS_ServerThreadArg *threadArg, struct IPCS_ServerListener *listener);
+
+/******************************************************************************/
+
+#endif /* __IPCS_HANDOFF_H__ */
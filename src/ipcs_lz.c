@@ -0,0 +1,279 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_lz.c
+ *
+ *    Description:  IPC socket LZ payload compression
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:12:40 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_lz.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/* 解压时短的字面量和匹配按固定长度复制，多写的字节在输出缓冲区内，由之后的数据覆盖 */
+#define IPCS_LZ_COPY_LEN            16
+
+/******************************************************************************/
+static uint32_t IPCS_LzRead32(const unsigned char *p)
+{
+    uint32_t value = 0;
+
+    (void)memcpy(&value, p, sizeof(value));
+
+    return value;
+}
+
+static unsigned int IPCS_LzHash(uint32_t seq)
+{
+    return (seq * 2654435761U) >> (32 - IPCS_LZ_HASH_BITS);
+}
+
+/* 从p和ref开始相同的字节数，p不超过limit；一次比较8字节，不同时按最低的不同位所在的字节计算（小端） */
+static unsigned int IPCS_LzMatchLen(const unsigned char *p, const unsigned char *ref, const unsigned char *limit)
+{
+    const unsigned char *start = p;
+    uint64_t diff = 0;
+    uint64_t a = 0;
+    uint64_t b = 0;
+
+    while (p + sizeof(uint64_t) <= limit) {
+        (void)memcpy(&a, p, sizeof(a));
+        (void)memcpy(&b, ref, sizeof(b));
+        diff = a ^ b;
+        if (diff != 0) {
+            return (unsigned int)(p - start) + ((unsigned int)__builtin_ctzll(diff) >> 3);
+        }
+        p += sizeof(uint64_t);
+        ref += sizeof(uint64_t);
+    }
+
+    while ((p < limit) && (*p == *ref)) {
+        p++;
+        ref++;
+    }
+
+    return (unsigned int)(p - start);
+}
+
+/* 长度的扩展字节：先减去token中的15，之后每个255表示还有后续字节 */
+static unsigned char *IPCS_LzPutLen(unsigned char *op, unsigned int len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+
+    return op;
+}
+
+/* 写一个序列，matchLen为0时是最后一个只有字面量的序列；放不下时返回NULL */
+static unsigned char *IPCS_LzPutSeq(unsigned char *op, unsigned char *oend, const unsigned char *lit,
+        unsigned int litLen, unsigned int offset, unsigned int matchLen)
+{
+    unsigned char *token = op;
+    unsigned int code = (matchLen != 0) ? matchLen - IPCS_LZ_MIN_MATCH : 0;
+
+    /* token、长度扩展字节（每255字节一个）、字面量、距离 */
+    if ((size_t)(oend - op) < 1 + litLen / 255 + 1 + litLen + 2 + code / 255 + 1) {
+        return NULL;
+    }
+
+    op++;
+    *token = (unsigned char)(((litLen >= 15) ? 15 : litLen) << 4);
+    if (litLen >= 15) {
+        op = IPCS_LzPutLen(op, litLen - 15);
+    }
+    (void)memcpy(op, lit, litLen);
+    op += litLen;
+
+    if (matchLen == 0) {
+        return op;
+    }
+
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+    *token |= (unsigned char)((code >= 15) ? 15 : code);
+    if (code >= 15) {
+        op = IPCS_LzPutLen(op, code - 15);
+    }
+
+    return op;
+}
+
+unsigned int IPCS_LzCompress(const void *src, unsigned int srcLen, void *dst, unsigned int dstCap)
+{
+    uint16_t table[1 << IPCS_LZ_HASH_BITS];
+    const unsigned char *base = (const unsigned char *)src;
+    const unsigned char *ip = base;
+    const unsigned char *anchor = base;
+    const unsigned char *end = base + srcLen;
+    const unsigned char *matchLimit = end - IPCS_LZ_LAST_LITERALS;
+    const unsigned char *ref = NULL;
+    unsigned char *op = (unsigned char *)dst;
+    unsigned char *oend = op + dstCap;
+    unsigned int matchLen = 0;
+    unsigned int h = 0;
+    size_t seen = 0;
+    int probed = 0;
+    uint32_t seq = 0;
+
+    if (srcLen > IPCS_LZ_MAX_OFFSET) {
+        return 0;
+    }
+
+    (void)memset(table, 0, sizeof(table));
+
+    /* 太短的数据只有字面量；表中的0也是合法位置，匹配前比较内容 */
+    if (srcLen > IPCS_LZ_MIN_MATCH + IPCS_LZ_LAST_LITERALS) {
+        ip++;
+        while (ip + IPCS_LZ_MIN_MATCH <= matchLimit) {
+            seq = IPCS_LzRead32(ip);
+            h = IPCS_LzHash(seq);
+            ref = base + table[h];
+            table[h] = (uint16_t)(ip - base);
+
+            if ((ref >= ip) || (IPCS_LzRead32(ref) != seq)) {
+                ip += 1 + ((size_t)(ip - anchor) >> IPCS_LZ_SKIP_SHIFT);
+                seen = (size_t)(ip - base);
+                if (!probed && (seen >= IPCS_LZ_PROBE_LEN)) {
+                    probed = 1;
+                    if ((size_t)(op - (unsigned char *)dst) + (size_t)(ip - anchor) >
+                            seen - (seen >> IPCS_LZ_PROBE_SAVE_SHIFT)) {
+                        return 0;
+                    }
+                }
+                continue;
+            }
+
+            matchLen = IPCS_LZ_MIN_MATCH;
+            matchLen += IPCS_LzMatchLen(ip + IPCS_LZ_MIN_MATCH, ref + IPCS_LZ_MIN_MATCH, matchLimit);
+
+            op = IPCS_LzPutSeq(op, oend, anchor, (unsigned int)(ip - anchor), (unsigned int)(ip - ref), matchLen);
+            if (op == NULL) {
+                return 0;
+            }
+            ip += matchLen;
+            anchor = ip;
+        }
+    }
+
+    op = IPCS_LzPutSeq(op, oend, anchor, (unsigned int)(end - anchor), 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+
+    return (unsigned int)(op - (unsigned char *)dst);
+}
+
+/******************************************************************************/
+/* 读长度的扩展字节，越过输入末尾时返回-1 */
+static int IPCS_LzGetLen(const unsigned char **ip, const unsigned char *iend, unsigned int *len)
+{
+    unsigned char byte = 0;
+
+    do {
+        if (*ip >= iend) {
+            return -1;
+        }
+        byte = *(*ip)++;
+        *len += byte;
+    } while (byte == 255);
+
+    return 0;
+}
+
+int IPCS_LzDecompress(const void *src, unsigned int srcLen, void *dst, unsigned int dstCap)
+{
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *iend = ip + srcLen;
+    unsigned char *op = (unsigned char *)dst;
+    unsigned char *oend = op + dstCap;
+    unsigned char *mend = NULL;
+    const unsigned char *ref = NULL;
+    unsigned int token = 0;
+    unsigned int litLen = 0;
+    unsigned int matchLen = 0;
+    unsigned int offset = 0;
+    unsigned int copyLen = 0;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        litLen = token >> 4;
+        if ((litLen < 15) && (iend - ip >= IPCS_LZ_COPY_LEN) && (oend - op >= IPCS_LZ_COPY_LEN)) {
+            (void)memcpy(op, ip, IPCS_LZ_COPY_LEN);
+        } else {
+            if ((litLen == 15) && (IPCS_LzGetLen(&ip, iend, &litLen) != 0)) {
+                return -1;
+            }
+            if ((litLen > (size_t)(iend - ip)) || (litLen > (size_t)(oend - op))) {
+                return -1;
+            }
+            (void)memcpy(op, ip, litLen);
+        }
+        op += litLen;
+        ip += litLen;
+
+        /* 最后一个序列只有字面量 */
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        offset = (unsigned int)ip[0] | ((unsigned int)ip[1] << 8);
+        ip += 2;
+        if ((offset == 0) || (offset > (size_t)(op - (unsigned char *)dst))) {
+            return -1;
+        }
+
+        matchLen = token & 15;
+        if ((matchLen == 15) && (IPCS_LzGetLen(&ip, iend, &matchLen) != 0)) {
+            return -1;
+        }
+        matchLen += IPCS_LZ_MIN_MATCH;
+        if (matchLen > (size_t)(oend - op)) {
+            return -1;
+        }
+
+        /* 距离不小于复制长度时每次复制的源都已写好 */
+        ref = op - offset;
+        if ((offset >= IPCS_LZ_COPY_LEN) && ((size_t)(oend - op) >= matchLen + IPCS_LZ_COPY_LEN - 1)) {
+            mend = op + matchLen;
+            do {
+                (void)memcpy(op, ref, IPCS_LZ_COPY_LEN);
+                op += IPCS_LZ_COPY_LEN;
+                ref += IPCS_LZ_COPY_LEN;
+            } while (op < mend);
+            op = mend;
+            continue;
+        }
+
+        /* 距离小于长度时源和目的重叠，分段复制，每段的源都已写好；重复的内容以距离为周期，
+         * 从ref起已写好的长度每段加倍，距离为1（连续相同的字节）时也只需几次复制 */
+        while (matchLen != 0) {
+            copyLen = (unsigned int)(op - ref);
+            copyLen = (matchLen < copyLen) ? matchLen : copyLen;
+            (void)memcpy(op, ref, copyLen);
+            op += copyLen;
+            matchLen -= copyLen;
+        }
+    }
+
+    return (int)(op - (unsigned char *)dst);
+}
+
+/******************************************************************************/
@@ -0,0 +1,48 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_lz.h
+ *
+ *    Description:  IPC socket LZ payload compression
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:12:40 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_LZ_H__
+#define __IPCS_LZ_H__
+
+/******************************************************************************/
+/**
+ * LZ77压缩，块格式与LZ4相同：每个序列为一个token（高4位字面量长度，低4位匹配长度减4，
+ * 等于15时后面跟255结尾的扩展字节）、字面量、2字节小端的匹配距离；最后一个序列只有字面量。
+ * 压缩用一个按4字节哈希的表查找上一次出现的位置，不搜索更长的匹配；连续找不到匹配时
+ * 跳过的步长逐渐增大，不可压缩的数据很快结束。一次压缩的数据不超过64KB（匹配距离）。
+ **/
+#define IPCS_LZ_MIN_MATCH           4
+#define IPCS_LZ_LAST_LITERALS       5       /* 最后几个字节总是字面量，匹配不会延伸到末尾 */
+#define IPCS_LZ_HASH_BITS           12
+#define IPCS_LZ_MAX_OFFSET          65535
+#define IPCS_LZ_SKIP_SHIFT          6       /* 每连续64个位置没有匹配，步长加1 */
+
+/* 提前放弃：看过前IPCS_LZ_PROBE_LEN字节后，输出（含还没写出的字面量）省不到1/8时按不可压缩处理，
+ * 随机数据只扫描开头的一段，不必扫完整个负载 */
+#define IPCS_LZ_PROBE_LEN           256
+#define IPCS_LZ_PROBE_SAVE_SHIFT    3
+
+/* 压缩到dst，返回压缩后的长度；结果超过dstCap或开头一段省不到1/8时返回0（数据不可压缩） */
+unsigned int IPCS_LzCompress(const void *src, unsigned int srcLen, void *dst, unsigned int dstCap);
+
+/* 解压到dst，返回解压后的长度；数据不完整、距离越界或超过dstCap时返回-1 */
+int IPCS_LzDecompress(const void *src, unsigned int srcLen, void *dst, unsigned int dstCap);
+
+/******************************************************************************/
+
+#endif /* __IPCS_LZ_H__ */
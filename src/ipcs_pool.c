@@ -0,0 +1,681 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_pool.c
+ *
+ *    Description:  IPC socket sync client pool
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:05:31 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_pool.h"
+#include "ipcs_client.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/******************************************************************************/
+void IPCS_InitPoolAttr(IPCS_PoolAttr *attr)
+{
+    if (attr == NULL) {
+        return;
+    }
+
+    (void)memset(attr, 0, sizeof(IPCS_PoolAttr));
+    attr->connsPerServer = IPCS_POOL_CONNS_DEFAULT;
+    attr->retryMs = IPCS_POOL_RETRY_DEFAULT_MS;
+    IPCS_InitClientAttr(&attr->client);
+
+    return;
+}
+
+int IPCS_CreateClientPool(const char * const *serverNames, unsigned int serverNum, const IPCS_PoolAttr *attr,
+        IPCS_ClientPool **pool)
+{
+    IPCS_ClientPool *newPool = NULL;
+    pthread_condattr_t condAttr;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    if ((serverNames == NULL) || (pool == NULL)) {
+        return IPCS_PARAM_NULL;
+    }
+
+    if ((serverNum == 0) || (serverNum > IPCS_POOL_MAX_SERVERS)) {
+        IPCS_WriteLog("Create client pool with bad server num: %u", serverNum);
+        return IPCS_PARAM_LEN;
+    }
+
+    for (i = 0; i < serverNum; i++) {
+        result = IPCS_CheckItemName(serverNames[i]);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Create client pool with bad server name, index: %u", i);
+            return result;
+        }
+    }
+
+    newPool = (IPCS_ClientPool *)calloc(1, sizeof(IPCS_ClientPool) + serverNum * sizeof(IPCS_PoolServer));
+    if (newPool == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    if (attr != NULL) {
+        newPool->attr = *attr;
+    } else {
+        IPCS_InitPoolAttr(&newPool->attr);
+    }
+    if (newPool->attr.connsPerServer == 0) {
+        newPool->attr.connsPerServer = IPCS_POOL_CONNS_DEFAULT;
+    }
+    if (newPool->attr.retryMs == 0) {
+        newPool->attr.retryMs = IPCS_POOL_RETRY_DEFAULT_MS;
+    }
+    if (newPool->attr.hedgePercentile > 99) {
+        newPool->attr.hedgePercentile = 99;
+    }
+    /* 连接失败的服务端由retryMs控制重试，调用中不等待服务端启动 */
+    newPool->attr.client.connectTimeoutMs = 0;
+
+    newPool->serverNum = serverNum;
+    for (i = 0; i < serverNum; i++) {
+        snprintf(newPool->servers[i].name, sizeof(newPool->servers[i].name), "%s", serverNames[i]);
+        newPool->servers[i].idle = (int *)calloc(newPool->attr.connsPerServer, sizeof(int));
+        if (newPool->servers[i].idle == NULL) {
+            result = IPCS_MALLOC_FAIL;
+            break;
+        }
+    }
+
+    if (result != IPCS_OK) {
+        for (i = 0; i < serverNum; i++) {
+            free(newPool->servers[i].idle);
+        }
+        free(newPool);
+        return result;
+    }
+
+    /* 等待连接的超时按CLOCK_MONOTONIC计算，与IPCS_GetNowNs一致 */
+    (void)pthread_mutex_init(&newPool->mutex, NULL);
+    (void)pthread_condattr_init(&condAttr);
+    (void)pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    (void)pthread_cond_init(&newPool->cond, &condAttr);
+    (void)pthread_condattr_destroy(&condAttr);
+
+    *pool = newPool;
+    IPCS_WriteLog("Create client pool with %u servers success.", serverNum);
+
+    return IPCS_OK;
+}
+
+int IPCS_DestroyClientPool(IPCS_ClientPool *pool)
+{
+    IPCS_PoolServer *server = NULL;
+    unsigned int i = 0;
+
+    if (pool == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    pool->destroying = 1;
+    (void)pthread_cond_broadcast(&pool->cond);
+    while (pool->users != 0) {
+        (void)pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->serverNum; i++) {
+        server = &pool->servers[i];
+        while (server->idleNum != 0) {
+            (void)IPCS_DestroyClient(server->idle[--server->idleNum]);
+        }
+        free(server->idle);
+    }
+
+    (void)pthread_cond_destroy(&pool->cond);
+    (void)pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+int IPCS_PoolSyncCall(IPCS_ClientPool *pool, IPCS_Message *sendMsg, IPCS_Message *recvMsg)
+{
+    return IPCS_PoolSyncCallTimeout(pool, sendMsg, recvMsg, IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS);
+}
+
+/**
+ * 建立连接失败，或者空闲的连接已被对端关闭、请求没有写出时，换一个连接重试，
+ * 最多尝试服务端个数加一次；请求写出之后失败不重试，避免非幂等的请求被执行两次。
+ **/
+int IPCS_PoolSyncCallTimeout(IPCS_ClientPool *pool, IPCS_Message *sendMsg, IPCS_Message *recvMsg,
+        unsigned int timeoutMs)
+{
+    uint64_t deadlineNs = 0;
+    uint64_t nowNs = 0;
+    unsigned int callMs = timeoutMs;
+    unsigned int index = 0;
+    unsigned int attempt = 0;
+    uint64_t hedgeNs = 0;
+    int connResult = IPCS_OK;
+    int reused = 0;
+    int broken = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    if (pool == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    if (timeoutMs != 0) {
+        deadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    if (pool->destroying) {
+        (void)pthread_mutex_unlock(&pool->mutex);
+        return IPCS_NOT_FOUND;
+    }
+    pool->users++;
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    hedgeNs = IPCS_PoolHedgeNs(pool);
+
+    for (attempt = 0; attempt <= pool->serverNum; attempt++) {
+        result = IPCS_PoolAcquire(pool, deadlineNs, &index, &fd);
+        if (result != IPCS_OK) {
+            break;
+        }
+
+        reused = (fd >= 0);
+        if (!reused) {
+            result = IPCS_CreateSyncClientEx(NULL, pool->servers[index].name, &pool->attr.client, &fd);
+            if (result != IPCS_OK) {
+                IPCS_PoolRelease(pool, index, -1, 1, 1);
+                continue;
+            }
+        }
+
+        /* 等待连接的时间计入超时 */
+        if (deadlineNs != 0) {
+            nowNs = IPCS_GetNowNs();
+            if (nowNs >= deadlineNs) {
+                IPCS_PoolRelease(pool, index, fd, 0, 0);
+                result = IPCS_TIMEOUT;
+                break;
+            }
+            callMs = (unsigned int)((deadlineNs - nowNs + 999999ULL) / 1000000ULL);
+        }
+
+        if (hedgeNs != 0) {
+            result = IPCS_PoolHedgedCall(pool, index, fd, sendMsg, recvMsg, deadlineNs, hedgeNs, &connResult);
+        } else {
+            /* 按百分位对冲时，样本不够之前不对冲，但时延仍计入估计 */
+            nowNs = IPCS_GetNowNs();
+            result = IPCS_ClientSyncCallTimeout(fd, sendMsg, recvMsg, callMs);
+            connResult = result;
+            if (pool->attr.hedgePercentile != 0) {
+                IPCS_PoolHedgeRecord(pool, IPCS_GetNowNs() - nowNs, result == IPCS_OK, 0);
+            }
+        }
+
+        /* 复用的空闲连接写失败通常是服务端重启过，关闭旧连接后重新连接，不暂停该服务端 */
+        broken = IPCS_PoolConnBroken(connResult);
+        IPCS_PoolRelease(pool, index, fd, broken, broken && !(reused && (connResult == IPCS_WRITE_FAIL)));
+        if (connResult != IPCS_WRITE_FAIL) {
+            break;
+        }
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    pool->users--;
+    if (pool->destroying && (pool->users == 0)) {
+        (void)pthread_cond_broadcast(&pool->cond);
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return result;
+}
+
+int IPCS_GetPoolStats(IPCS_ClientPool *pool, unsigned int index, IPCS_PoolServerStats *stats)
+{
+    IPCS_PoolServer *server = NULL;
+
+    if ((pool == NULL) || (stats == NULL)) {
+        return IPCS_PARAM_NULL;
+    }
+
+    if (index >= pool->serverNum) {
+        return IPCS_NOT_FOUND;
+    }
+
+    server = &pool->servers[index];
+    (void)pthread_mutex_lock(&pool->mutex);
+    stats->calls = server->calls;
+    stats->failures = server->failures;
+    stats->outstanding = server->outstanding;
+    stats->conns = server->conns;
+    stats->down = (server->downUntilNs > IPCS_GetNowNs());
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return IPCS_OK;
+}
+
+int IPCS_GetPoolHedgeStats(IPCS_ClientPool *pool, IPCS_PoolHedgeStats *stats)
+{
+    if ((pool == NULL) || (stats == NULL)) {
+        return IPCS_PARAM_NULL;
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    stats->calls = pool->hedge.calls;
+    stats->hedges = pool->hedge.hedges;
+    stats->hedgeWins = pool->hedge.hedgeWins;
+    stats->hedgeDelayUs = pool->hedge.delayNs / 1000ULL;
+    if ((pool->attr.hedgePercentile == 0) || (pool->hedge.samples < IPCS_HEDGE_MIN_SAMPLES)) {
+        stats->hedgeDelayUs = pool->attr.hedgeDelayUs;
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+int IPCS_PoolAcquire(IPCS_ClientPool *pool, uint64_t deadlineNs, unsigned int *index, int *fd)
+{
+    int pick = -1;
+    int full = 0;
+    int result = IPCS_OK;
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    for (; ; ) {
+        if (pool->destroying) {
+            result = IPCS_NOT_FOUND;
+            break;
+        }
+
+        full = 0;
+        pick = IPCS_PoolPick(pool, IPCS_GetNowNs(), -1, &full);
+        if (pick >= 0) {
+            break;
+        }
+
+        if (!full) {
+            result = IPCS_CONNECT_FAIL;
+            break;
+        }
+
+        result = IPCS_PoolWait(pool, deadlineNs);
+        if (result != IPCS_OK) {
+            break;
+        }
+    }
+
+    if (pick >= 0) {
+        IPCS_PoolTake(pool, (unsigned int)pick, fd);
+        *index = (unsigned int)pick;
+        pool->next = ((unsigned int)pick + 1) % pool->serverNum;
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return result;
+}
+
+void IPCS_PoolTake(IPCS_ClientPool *pool, unsigned int index, int *fd)
+{
+    IPCS_PoolServer *server = &pool->servers[index];
+
+    server->outstanding++;
+    server->calls++;
+    if (server->idleNum != 0) {
+        *fd = server->idle[--server->idleNum];
+    } else {
+        *fd = -1;
+        server->conns++;
+    }
+
+    return;
+}
+
+/* 在可用的服务端中选未完成的调用数最少的，相同时从pool->next开始轮转；没有可用的返回-1 */
+int IPCS_PoolPick(IPCS_ClientPool *pool, uint64_t nowNs, int exclude, int *full)
+{
+    IPCS_PoolServer *server = NULL;
+    unsigned int i = 0;
+    unsigned int j = 0;
+    int pick = -1;
+
+    for (i = 0; i < pool->serverNum; i++) {
+        j = (pool->next + i) % pool->serverNum;
+        server = &pool->servers[j];
+        if (((int)j == exclude) || (server->downUntilNs > nowNs)) {
+            continue;
+        }
+
+        if ((server->idleNum == 0) && (server->conns >= pool->attr.connsPerServer)) {
+            *full = 1;
+            continue;
+        }
+
+        if ((pick < 0) || (server->outstanding < pool->servers[pick].outstanding)) {
+            pick = (int)j;
+        }
+    }
+
+    return pick;
+}
+
+/* 持有mutex时调用 */
+int IPCS_PoolWait(IPCS_ClientPool *pool, uint64_t deadlineNs)
+{
+    struct timespec ts;
+    int ret = 0;
+
+    if (deadlineNs == 0) {
+        (void)pthread_cond_wait(&pool->cond, &pool->mutex);
+        return IPCS_OK;
+    }
+
+    ts.tv_sec = (time_t)(deadlineNs / 1000000000ULL);
+    ts.tv_nsec = (long)(deadlineNs % 1000000000ULL);
+    ret = pthread_cond_timedwait(&pool->cond, &pool->mutex, &ts);
+
+    return (ret == ETIMEDOUT) ? IPCS_TIMEOUT : IPCS_OK;
+}
+
+void IPCS_PoolRelease(IPCS_ClientPool *pool, unsigned int index, int fd, int broken, int down)
+{
+    IPCS_PoolServer *server = &pool->servers[index];
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    server->outstanding--;
+    if (!broken) {
+        server->idle[server->idleNum++] = fd;
+    } else {
+        /* 服务端退出或重启后，其他空闲连接通常也已断开 */
+        if (fd >= 0) {
+            (void)IPCS_DestroyClient(fd);
+        }
+        server->conns--;
+        while (server->idleNum != 0) {
+            (void)IPCS_DestroyClient(server->idle[--server->idleNum]);
+            server->conns--;
+        }
+    }
+    if (down) {
+        server->failures++;
+        server->downUntilNs = IPCS_GetNowNs() + (uint64_t)pool->attr.retryMs * 1000000ULL;
+        IPCS_WriteLog("Client pool: server %s down for %u ms.", server->name, pool->attr.retryMs);
+    }
+    (void)pthread_cond_broadcast(&pool->cond);
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return;
+}
+
+int IPCS_PoolConnBroken(int result)
+{
+    return (result == IPCS_READ_FAIL) || (result == IPCS_WRITE_FAIL) || (result == IPCS_PEER_CLOSED) ||
+        (result == IPCS_STREAM_BUF_BAD) || (result == IPCS_FRAME_BAD) || (result == IPCS_CHECKSUM_FAIL);
+}
+
+/******************************************************************************/
+uint64_t IPCS_PoolHedgeNs(IPCS_ClientPool *pool)
+{
+    uint64_t hedgeNs = 0;
+
+    if ((pool->serverNum < 2) || ((pool->attr.hedgePercentile == 0) && (pool->attr.hedgeDelayUs == 0))) {
+        return 0;
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    pool->hedge.calls++;
+    hedgeNs = (uint64_t)pool->attr.hedgeDelayUs * 1000ULL;
+    if ((pool->attr.hedgePercentile != 0) && (pool->hedge.samples >= IPCS_HEDGE_MIN_SAMPLES)) {
+        hedgeNs = pool->hedge.delayNs;
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return hedgeNs;
+}
+
+/**
+ * 两个连接上的请求带相同的调用ID，同时等待两个连接；输掉的连接归还后仍可使用，
+ * 迟到的响应由下一次调用按调用ID丢弃。一个连接失败（如被拒绝、连接断开）时继续等待另一个。
+ * 对冲的调用不使用忙等。
+ **/
+int IPCS_PoolHedgedCall(IPCS_ClientPool *pool, unsigned int index, int fd, IPCS_Message *sendMsg,
+        IPCS_Message *recvMsg, uint64_t deadlineNs, uint64_t hedgeNs, int *connResult)
+{
+    IPCS_BusyPoll *busyPoll = NULL;
+    unsigned int sendFlags = 0;
+    unsigned int frameOptions[2] = {0, 0};
+    struct pollfd pfds[2];
+    int results[2] = {IPCS_OK, IPCS_OK};
+    unsigned int callId = IPCS_NewCallId();
+    unsigned int recvBufLen = recvMsg->msgLen;
+    unsigned int hedgeIndex = 0;
+    uint64_t startNs = 0;
+    uint64_t nowNs = 0;
+    uint64_t waitNs = 0;
+    int hedgeFd = -1;
+    int fdNum = 1;
+    int winner = -1;
+    int matched = 0;
+    int broken = 0;
+    int i = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckClientSyncCall(fd, sendMsg, recvMsg, &busyPoll, &sendFlags);
+    if (result == IPCS_OK) {
+        result = IPCS_SendFrame(IPCS_SYNC_CLIENT, fd, sendMsg, callId, IPCS_PRIO_NORMAL, sendFlags);
+    }
+    *connResult = result;
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Client pool: hedged call send on %d fail: %d", fd, result);
+        return result;
+    }
+    frameOptions[0] = sendFlags & IPCS_FRAME_OPTIONS;
+
+    startNs = IPCS_GetNowNs();
+    pfds[0].fd = fd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = -1;
+    pfds[1].events = POLLIN;
+
+    while (winner < 0) {
+        nowNs = IPCS_GetNowNs();
+        if ((hedgeNs != 0) && (nowNs >= startNs + hedgeNs)) {
+            hedgeNs = 0;
+            if (IPCS_PoolHedgeSend(pool, index, sendMsg, callId, &hedgeIndex, &hedgeFd) == IPCS_OK) {
+                pfds[1].fd = hedgeFd;
+                frameOptions[1] = IPCS_GetClientSendFlags(hedgeFd) & IPCS_FRAME_OPTIONS;
+                fdNum = 2;
+            }
+            continue;
+        }
+
+        if ((deadlineNs != 0) && (nowNs >= deadlineNs)) {
+            result = IPCS_TIMEOUT;
+            break;
+        }
+
+        /* 等到对冲时间或者超时，取较早的 */
+        waitNs = deadlineNs;
+        if ((hedgeNs != 0) && ((waitNs == 0) || (startNs + hedgeNs < waitNs))) {
+            waitNs = startNs + hedgeNs;
+        }
+
+        if (poll(pfds, (nfds_t)fdNum, (waitNs == 0) ? -1 : (int)((waitNs - nowNs + 999999ULL) / 1000000ULL)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = IPCS_READ_FAIL;
+            break;
+        }
+
+        for (i = 0; i < fdNum; i++) {
+            if ((pfds[i].fd < 0) || (pfds[i].revents == 0)) {
+                continue;
+            }
+
+            results[i] = IPCS_ClientSyncRecvFrame(pfds[i].fd, callId, deadlineNs, frameOptions[i], recvMsg, recvBufLen,
+                    &matched);
+            if (!matched) {
+                continue;
+            }
+            pfds[i].fd = -1;
+
+            /* 失败时还有另一个请求在等待，则继续等待 */
+            if ((results[i] == IPCS_OK) || (pfds[1 - i].fd < 0)) {
+                winner = i;
+                result = results[i];
+                break;
+            }
+        }
+    }
+
+    *connResult = results[0];
+    if (hedgeFd >= 0) {
+        broken = IPCS_PoolConnBroken(results[1]);
+        IPCS_PoolRelease(pool, hedgeIndex, hedgeFd, broken, broken);
+    }
+
+    IPCS_PoolHedgeRecord(pool, IPCS_GetNowNs() - startNs, result == IPCS_OK, (winner == 1) && (result == IPCS_OK));
+
+    return result;
+}
+
+int IPCS_PoolHedgeSend(IPCS_ClientPool *pool, unsigned int primary, IPCS_Message *sendMsg, unsigned int callId,
+        unsigned int *index, int *fd)
+{
+    int pick = -1;
+    int full = 0;
+    int result = IPCS_OK;
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    if (pool->hedge.hedges * 100ULL < pool->hedge.calls * IPCS_HEDGE_MAX_PERCENT) {
+        pick = IPCS_PoolPick(pool, IPCS_GetNowNs(), (int)primary, &full);
+    }
+    if (pick >= 0) {
+        IPCS_PoolTake(pool, (unsigned int)pick, fd);
+        *index = (unsigned int)pick;
+        pool->hedge.hedges++;
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    if (pick < 0) {
+        return IPCS_NOT_FOUND;
+    }
+
+    if (*fd < 0) {
+        result = IPCS_CreateSyncClientEx(NULL, pool->servers[pick].name, &pool->attr.client, fd);
+        if (result != IPCS_OK) {
+            IPCS_PoolRelease(pool, *index, -1, 1, 1);
+            *fd = -1;
+            return result;
+        }
+    }
+
+    result = IPCS_SendFrame(IPCS_SYNC_CLIENT, *fd, sendMsg, callId, IPCS_PRIO_NORMAL, IPCS_GetClientSendFlags(*fd));
+    if (result != IPCS_OK) {
+        IPCS_PoolRelease(pool, *index, *fd, 1, 0);
+        *fd = -1;
+        return result;
+    }
+
+    return IPCS_OK;
+}
+
+void IPCS_PoolHedgeRecord(IPCS_ClientPool *pool, uint64_t latencyNs, int ok, int hedgeWon)
+{
+    IPCS_PoolHedge *hedge = &pool->hedge;
+    unsigned int target = 0;
+    unsigned int sum = 0;
+    unsigned int i = 0;
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    if (hedgeWon) {
+        hedge->hedgeWins++;
+    }
+
+    if (ok && (pool->attr.hedgePercentile != 0)) {
+        hedge->counts[IPCS_PoolHedgeBucket(latencyNs / 1000ULL)]++;
+        hedge->total++;
+        hedge->samples++;
+        hedge->sinceUpdate++;
+
+        if (hedge->total >= IPCS_HEDGE_DECAY_SAMPLES) {
+            hedge->total = 0;
+            for (i = 0; i < IPCS_HEDGE_BUCKETS; i++) {
+                hedge->counts[i] /= 2;
+                hedge->total += hedge->counts[i];
+            }
+        }
+
+        if ((hedge->sinceUpdate >= IPCS_HEDGE_UPDATE_SAMPLES) && (hedge->total != 0)) {
+            hedge->sinceUpdate = 0;
+            target = (unsigned int)(((unsigned long long)hedge->total * pool->attr.hedgePercentile + 99) / 100);
+            for (i = 0; i < IPCS_HEDGE_BUCKETS; i++) {
+                sum += hedge->counts[i];
+                if (sum >= target) {
+                    break;
+                }
+            }
+            hedge->delayNs = IPCS_PoolHedgeBucketUs((i < IPCS_HEDGE_BUCKETS) ? i : IPCS_HEDGE_BUCKETS - 1) * 1000ULL;
+        }
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    return;
+}
+
+/* 4微秒以下每微秒一个桶，之后每个2的幂区间4个桶 */
+unsigned int IPCS_PoolHedgeBucket(uint64_t us)
+{
+    unsigned int mag = 0;
+
+    if (us < (1U << IPCS_HEDGE_SUB_BITS)) {
+        return (unsigned int)us;
+    }
+
+    if (us > 0xFFFFFFFFULL) {
+        return IPCS_HEDGE_BUCKETS - 1;
+    }
+
+    mag = 63 - (unsigned int)__builtin_clzll(us);
+
+    return ((mag - IPCS_HEDGE_SUB_BITS + 1) << IPCS_HEDGE_SUB_BITS) +
+        (unsigned int)((us >> (mag - IPCS_HEDGE_SUB_BITS)) & ((1U << IPCS_HEDGE_SUB_BITS) - 1));
+}
+
+/* 桶的上界（微秒） */
+uint64_t IPCS_PoolHedgeBucketUs(unsigned int bucket)
+{
+    unsigned int mag = 0;
+    unsigned int sub = 0;
+
+    if (bucket < (1U << IPCS_HEDGE_SUB_BITS)) {
+        return bucket + 1;
+    }
+
+    mag = (bucket >> IPCS_HEDGE_SUB_BITS) + IPCS_HEDGE_SUB_BITS - 1;
+    sub = bucket & ((1U << IPCS_HEDGE_SUB_BITS) - 1);
+
+    return ((uint64_t)((1U << IPCS_HEDGE_SUB_BITS) + sub + 1)) << (mag - IPCS_HEDGE_SUB_BITS);
+}
+
+/******************************************************************************/
@@ -0,0 +1,124 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_pool.h
+ *
+ *    Description:  IPC socket sync client pool
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:05:31 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_POOL_H__
+#define __IPCS_POOL_H__
+
+#include "ipcs.h"
+#include "ipcs_common.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 对冲延迟的估计：调用时延按微秒的log2分组，每组再等分为4个子桶，取子桶的上界；
+ * 每IPCS_HEDGE_DECAY_SAMPLES个样本所有计数减半，使估计跟随最近的时延，
+ * 每IPCS_HEDGE_UPDATE_SAMPLES个样本重新计算一次百分位。
+ **/
+#define IPCS_HEDGE_SUB_BITS         2
+#define IPCS_HEDGE_BUCKETS          (32 << IPCS_HEDGE_SUB_BITS)
+#define IPCS_HEDGE_DECAY_SAMPLES    1024
+#define IPCS_HEDGE_UPDATE_SAMPLES   64
+
+typedef struct {
+    unsigned int counts[IPCS_HEDGE_BUCKETS];
+    unsigned int total;
+    unsigned int sinceUpdate;
+    unsigned long long samples;
+    uint64_t delayNs;               /* 按百分位估计的对冲延迟，样本不够时为0 */
+    unsigned long long calls;
+    unsigned long long hedges;
+    unsigned long long hedgeWins;
+} IPCS_PoolHedge;
+
+/**
+ * 连接池中的一个服务端。idle是空闲连接的栈，conns包括正在使用和正在建立的连接，
+ * 不超过attr.connsPerServer；downUntilNs之前不再分配调用。都由连接池的mutex保护。
+ **/
+typedef struct {
+    char name[IPCS_ITEM_NAME_MAX_LEN];
+    int *idle;
+    unsigned int idleNum;
+    unsigned int conns;
+    unsigned int outstanding;
+    uint64_t downUntilNs;
+    unsigned long long calls;
+    unsigned long long failures;
+} IPCS_PoolServer;
+
+struct IPCS_ClientPool {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            /* 连接归还、服务端恢复或者调用者全部返回时通知 */
+    IPCS_PoolAttr attr;
+    unsigned int next;              /* 未完成的调用数相同时从这里开始轮转 */
+    unsigned int users;             /* 正在调用的线程数，销毁时等待其返回 */
+    int destroying;
+    IPCS_PoolHedge hedge;
+    unsigned int serverNum;
+    IPCS_PoolServer servers[];
+};
+
+/******************************************************************************/
+/**
+ * 在mutex保护下选择服务端并取出连接：*fd为-1时需要调用者建立新连接（已计入conns）。
+ * 可用的服务端的连接都在使用时等待到deadlineNs（0表示一直等待），超时返回IPCS_TIMEOUT；
+ * 所有服务端都暂停分配时返回IPCS_CONNECT_FAIL。
+ **/
+int IPCS_PoolAcquire(IPCS_ClientPool *pool, uint64_t deadlineNs, unsigned int *index, int *fd);
+
+/* 持有mutex时调用：从选中的服务端取出一个空闲连接，没有时*fd为-1并计入conns */
+void IPCS_PoolTake(IPCS_ClientPool *pool, unsigned int index, int *fd);
+
+/* 归还连接；broken非0时关闭该连接（fd为-1表示没有建立）和该服务端所有空闲的连接，
+ * down非0时该服务端暂停分配retryMs */
+void IPCS_PoolRelease(IPCS_ClientPool *pool, unsigned int index, int fd, int broken, int down);
+
+/* exclude为不参与选择的服务端，-1表示都参与 */
+int IPCS_PoolPick(IPCS_ClientPool *pool, uint64_t nowNs, int exclude, int *full);
+
+int IPCS_PoolWait(IPCS_ClientPool *pool, uint64_t deadlineNs);
+
+/* 调用结果表示连接已不可用；收到坏帧的连接与服务端一样关闭，不再放回空闲连接 */
+int IPCS_PoolConnBroken(int result);
+
+/******************************************************************************/
+/* 本次调用的对冲延迟，0表示不对冲 */
+uint64_t IPCS_PoolHedgeNs(IPCS_ClientPool *pool);
+
+/**
+ * 在index的连接fd上发出请求，超过hedgeNs没有响应时向另一个服务端发出对冲请求，取先到的响应。
+ * connResult为fd上的结果，用于判断该连接是否还可用；对冲请求的连接在这里归还。
+ **/
+int IPCS_PoolHedgedCall(IPCS_ClientPool *pool, unsigned int index, int fd, IPCS_Message *sendMsg,
+        IPCS_Message *recvMsg, uint64_t deadlineNs, uint64_t hedgeNs, int *connResult);
+
+/* 选择primary以外的服务端发出对冲请求，超过对冲比例上限或者没有可用的服务端时返回IPCS_NOT_FOUND */
+int IPCS_PoolHedgeSend(IPCS_ClientPool *pool, unsigned int primary, IPCS_Message *sendMsg, unsigned int callId,
+        unsigned int *index, int *fd);
+
+/* 记录调用结果：ok时时延计入对冲延迟的估计，hedgeWon表示对冲请求先返回 */
+void IPCS_PoolHedgeRecord(IPCS_ClientPool *pool, uint64_t latencyNs, int ok, int hedgeWon);
+
+unsigned int IPCS_PoolHedgeBucket(uint64_t us);
+
+uint64_t IPCS_PoolHedgeBucketUs(unsigned int bucket);
+
+/******************************************************************************/
+
+#endif /* __IPCS_POOL_H__ */
@@ -0,0 +1,294 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_prefork.c
+ *
+ *    Description:  IPC socket prefork multi-process server
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:24:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_prefork.h"
+#include "ipcs_server.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/******************************************************************************/
+static IPCS_PreforkServer *g_IpcsPreforks = NULL;
+static pthread_mutex_t g_IpcsPreforkMutex = PTHREAD_MUTEX_INITIALIZER;
+
+int IPCS_CreatePreforkServer(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr)
+{
+    IPCS_PreforkServer *server = NULL;
+    int result = IPCS_OK;
+
+    if (attr->workers > IPCS_PREFORK_MAX_WORKERS) {
+        IPCS_WriteLog("Create prefork server: %s with bad workers: %u", serverName, attr->workers);
+        return IPCS_PARAM_LEN;
+    }
+
+    /* 建立监听socket会删除已存在的socket文件，先检查同名的服务端 */
+    if (IPCS_IsItemExist(IPCS_SERVER, serverName, 0)) {
+        IPCS_WriteLog("Create prefork server: %s exist.", serverName);
+        return IPCS_EXIST;
+    }
+
+    server = (IPCS_PreforkServer *)calloc(1, sizeof(IPCS_PreforkServer));
+    if (server == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    snprintf(server->name, sizeof(server->name), "%s", serverName);
+    server->serverHook = serverHook;
+    server->attr = *attr;
+    server->listenFd = -1;
+    server->parentPid = getpid();
+
+    do {
+        server->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (server->stopFd < 0) {
+            perror("eventfd error");
+            result = IPCS_SOCKET_FAIL;
+            break;
+        }
+
+        result = IPCS_CreateServerSocket(serverName, &server->listenFd);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Create prefork server: %s socket fail: %d", serverName, result);
+            break;
+        }
+
+        (void)pthread_mutex_lock(&g_IpcsPreforkMutex);
+        server->next = g_IpcsPreforks;
+        g_IpcsPreforks = server;
+        (void)pthread_mutex_unlock(&g_IpcsPreforkMutex);
+
+        /* 工作进程都由监视线程fork，PR_SET_PDEATHSIG跟随的是fork它的线程 */
+        result = IPCS_CreateThread(IPCS_PreforkMonitor, server, &server->monitor);
+        if (result != IPCS_OK) {
+            (void)IPCS_DestroyPreforkServer(serverName);
+            return result;
+        }
+
+        IPCS_WriteLog("Create prefork server: %s with %u workers success.", serverName, attr->workers);
+    } while (0);
+
+    if (result != IPCS_OK) {
+        if (server->listenFd >= 0) {
+            (void)close(server->listenFd);
+            IPCS_UnlinkSockName(serverName);
+        }
+        if (server->stopFd >= 0) {
+            (void)close(server->stopFd);
+        }
+        free(server);
+    }
+
+    return result;
+}
+
+int IPCS_DestroyPreforkServer(const char *serverName)
+{
+    IPCS_PreforkServer **link = &g_IpcsPreforks;
+    IPCS_PreforkServer *server = NULL;
+    uint64_t wakeValue = 1;
+
+    (void)pthread_mutex_lock(&g_IpcsPreforkMutex);
+    while (*link != NULL) {
+        if (strcmp((*link)->name, serverName) == 0) {
+            server = *link;
+            *link = server->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+    (void)pthread_mutex_unlock(&g_IpcsPreforkMutex);
+
+    if (server == NULL) {
+        return IPCS_NOT_FOUND;
+    }
+
+    /* 创建监视线程失败时没有线程需要等待 */
+    if (server->monitor != 0) {
+        (void)write(server->stopFd, &wakeValue, sizeof(wakeValue));
+        (void)pthread_join(server->monitor, NULL);
+    }
+
+    (void)close(server->stopFd);
+    (void)close(server->listenFd);
+    IPCS_UnlinkSockName(server->name);
+    IPCS_WriteLog("Destroy prefork server: %s, restarts: %llu", server->name, server->restarts);
+    free(server);
+
+    return IPCS_OK;
+}
+
+int IPCS_FindPreforkServer(const char *serverName)
+{
+    IPCS_PreforkServer *server = NULL;
+
+    (void)pthread_mutex_lock(&g_IpcsPreforkMutex);
+    for (server = g_IpcsPreforks; server != NULL; server = server->next) {
+        if (strcmp(server->name, serverName) == 0) {
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&g_IpcsPreforkMutex);
+
+    return (server != NULL);
+}
+
+int IPCS_GetServerWorkers(const char *serverName, IPCS_WorkerStats *stats)
+{
+    IPCS_PreforkServer *server = NULL;
+    unsigned int i = 0;
+    int result = IPCS_NOT_FOUND;
+
+    if ((serverName == NULL) || (stats == NULL)) {
+        return IPCS_PARAM_NULL;
+    }
+
+    (void)memset(stats, 0, sizeof(IPCS_WorkerStats));
+    (void)pthread_mutex_lock(&g_IpcsPreforkMutex);
+    for (server = g_IpcsPreforks; server != NULL; server = server->next) {
+        if (strcmp(server->name, serverName) != 0) {
+            continue;
+        }
+
+        stats->workers = server->attr.workers;
+        stats->restarts = server->restarts;
+        for (i = 0; i < server->attr.workers; i++) {
+            stats->pids[i] = (int)server->pids[i];
+        }
+        result = IPCS_OK;
+        break;
+    }
+    (void)pthread_mutex_unlock(&g_IpcsPreforkMutex);
+
+    return result;
+}
+
+/******************************************************************************/
+void *IPCS_PreforkMonitor(void *arg)
+{
+    IPCS_PreforkServer *server = (IPCS_PreforkServer *)arg;
+    struct pollfd pfd;
+    unsigned int i = 0;
+
+    pfd.fd = server->stopFd;
+    pfd.events = POLLIN;
+
+    /* 创建之后和每次检查时补齐工作进程，fork失败的下次再试 */
+    for (; ; ) {
+        IPCS_PreforkReap(server);
+        for (i = 0; i < server->attr.workers; i++) {
+            if (server->pids[i] == 0) {
+                IPCS_PreforkSpawn(server, i);
+            }
+        }
+
+        pfd.revents = 0;
+        if (poll(&pfd, 1, IPCS_PREFORK_CHECK_MS) > 0) {
+            break;
+        }
+    }
+
+    IPCS_PreforkStopWorkers(server);
+
+    return NULL;
+}
+
+/* pids只由监视线程修改，修改时加锁，其他线程在锁中读取 */
+void IPCS_PreforkSpawn(IPCS_PreforkServer *server, unsigned int index)
+{
+    sigset_t sigSet;
+    pid_t pid = 0;
+
+    pid = IPCS_ServerFork();
+    if (pid < 0) {
+        perror("fork error");
+        IPCS_WriteLog("Prefork server: %s fork worker %u fail, errno: %d", server->name, index, errno);
+        return;
+    }
+
+    if (pid == 0) {
+        /* 创建进程在fork之后、设置之前退出时，不会再收到信号 */
+        (void)prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != server->parentPid) {
+            _exit(IPCS_OK);
+        }
+        (void)sigemptyset(&sigSet);
+        (void)pthread_sigmask(SIG_SETMASK, &sigSet, NULL);
+        (void)close(server->stopFd);
+
+        IPCS_ServerRunWorker(server->name, server->serverHook, &server->attr, server->listenFd);
+    }
+
+    (void)pthread_mutex_lock(&g_IpcsPreforkMutex);
+    server->pids[index] = pid;
+    (void)pthread_mutex_unlock(&g_IpcsPreforkMutex);
+    IPCS_WriteLog("Prefork server: %s worker %u pid: %d started.", server->name, index, (int)pid);
+
+    return;
+}
+
+void IPCS_PreforkReap(IPCS_PreforkServer *server)
+{
+    unsigned int i = 0;
+    int status = 0;
+
+    for (i = 0; i < server->attr.workers; i++) {
+        if ((server->pids[i] == 0) || (waitpid(server->pids[i], &status, WNOHANG) != server->pids[i])) {
+            continue;
+        }
+
+        IPCS_WriteLog("Prefork server: %s worker %u pid: %d exited, status: 0x%x, restart.", server->name, i,
+                (int)server->pids[i], status);
+        (void)pthread_mutex_lock(&g_IpcsPreforkMutex);
+        server->pids[i] = 0;
+        server->restarts++;
+        (void)pthread_mutex_unlock(&g_IpcsPreforkMutex);
+    }
+
+    return;
+}
+
+void IPCS_PreforkStopWorkers(IPCS_PreforkServer *server)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < server->attr.workers; i++) {
+        if (server->pids[i] != 0) {
+            (void)kill(server->pids[i], SIGTERM);
+        }
+    }
+
+    for (i = 0; i < server->attr.workers; i++) {
+        if (server->pids[i] != 0) {
+            (void)waitpid(server->pids[i], NULL, 0);
+            server->pids[i] = 0;
+        }
+    }
+
+    return;
+}
+
+/******************************************************************************/
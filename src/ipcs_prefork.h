@@ -0,0 +1,71 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_prefork.h
+ *
+ *    Description:  IPC socket prefork multi-process server
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:24:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_PREFORK_H__
+#define __IPCS_PREFORK_H__
+
+#include "ipcs.h"
+#include "ipcs_common.h"
+
+#include <pthread.h>
+#include <sys/types.h>
+
+/******************************************************************************/
+/**
+ * 多进程服务端：创建进程建立监听socket，由一个监视线程fork出工作进程，并定期检查工作进程
+ * 是否退出，异常退出的重新创建。工作进程设置PR_SET_PDEATHSIG，fork它的监视线程退出
+ * （服务端销毁或创建进程退出）时收到SIGTERM。
+ **/
+#define IPCS_PREFORK_CHECK_MS       100
+
+typedef struct IPCS_PreforkServer {
+    char name[IPCS_ITEM_NAME_MAX_LEN];
+    ServerCallback serverHook;
+    IPCS_ServerAttr attr;
+    int listenFd;
+    int stopFd;                     /* eventfd，销毁时唤醒监视线程 */
+    pthread_t monitor;
+    pid_t parentPid;
+
+    /* 由全局列表的锁保护 */
+    unsigned long long restarts;
+    pid_t pids[IPCS_PREFORK_MAX_WORKERS];
+    struct IPCS_PreforkServer *next;
+} IPCS_PreforkServer;
+
+/******************************************************************************/
+int IPCS_CreatePreforkServer(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr);
+
+/* 不是多进程服务端时返回IPCS_NOT_FOUND */
+int IPCS_DestroyPreforkServer(const char *serverName);
+
+int IPCS_FindPreforkServer(const char *serverName);
+
+void *IPCS_PreforkMonitor(void *arg);
+
+/* 在监视线程中创建第index个工作进程，子进程不返回 */
+void IPCS_PreforkSpawn(IPCS_PreforkServer *server, unsigned int index);
+
+/* 检查退出的工作进程，退出的下一轮重新创建 */
+void IPCS_PreforkReap(IPCS_PreforkServer *server);
+
+void IPCS_PreforkStopWorkers(IPCS_PreforkServer *server);
+
+/******************************************************************************/
+
+#endif /* __IPCS_PREFORK_H__ */
@@ -0,0 +1,265 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_sendq.c
+ *
+ *    Description:  IPC socket multi-producer send queue with flat combining
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:05:33 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_sendq.h"
+#include "ipcs_capture.h"
+#include "ipcs_common.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/******************************************************************************/
+void IPCS_SendQueueInit(IPCS_SendQueue *queue)
+{
+    (void)memset(queue, 0, sizeof(IPCS_SendQueue));
+    (void)pthread_mutex_init(&queue->mutex, NULL);
+    (void)pthread_cond_init(&queue->cond, NULL);
+
+    return;
+}
+
+void IPCS_SendQueueDestroy(IPCS_SendQueue *queue)
+{
+    (void)pthread_mutex_destroy(&queue->mutex);
+    (void)pthread_cond_destroy(&queue->cond);
+
+    return;
+}
+
+int IPCS_SendQueueSubmit(IPCS_SendQueue *queue, int fd, const void *frame, unsigned int frameLen)
+{
+    IPCS_SendReq req;
+    IPCS_SendReq *head = NULL;
+    unsigned int spin = 0;
+
+    req.frame = frame;
+    req.frameLen = frameLen;
+    req.result = IPCS_OK;
+    req.done = 0;
+
+    head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    do {
+        req.next = head;
+    } while (!__atomic_compare_exchange_n(&queue->head, &head, &req, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    /* 自己的帧被发出之前，合并权空闲时就去合并发送；抢不到时等待，自旋一段时间后睡眠 */
+    while (!__atomic_load_n(&req.done, __ATOMIC_ACQUIRE)) {
+        if (!__atomic_load_n(&queue->combining, __ATOMIC_RELAXED) &&
+            !__atomic_exchange_n(&queue->combining, 1, __ATOMIC_ACQUIRE)) {
+            IPCS_SendQueueCombine(queue, fd);
+            __atomic_store_n(&queue->combining, 0, __ATOMIC_SEQ_CST);
+            /* 在最后一次取栈之后压栈的线程可能已经睡眠，交出合并权时唤醒它们来合并 */
+            IPCS_SendQueueWake(queue);
+            continue;
+        }
+
+        if (++spin >= IPCS_SENDQ_SPIN) {
+            spin = 0;
+            IPCS_SendQueueSleep(queue, &req);
+        }
+    }
+
+    return req.result;
+}
+
+int IPCS_SendQueueMessage(IPCS_SendQueue *queue, int itemType, int fd, IPCS_Message *msg, unsigned int callId)
+{
+    char inlineBuf[IPCS_SENDQ_INLINE_LEN];
+    unsigned int streamBufLen = IPCS_FRAME_EXT_MAX_LEN + msg->msgLen;
+    void *streamBuf = inlineBuf;
+    int result = IPCS_OK;
+
+    if (streamBufLen > sizeof(inlineBuf)) {
+        streamBuf = malloc(streamBufLen);
+        if (streamBuf == NULL) {
+            IPCS_WriteLog("Send queue: malloc fail, fd: %d.", fd);
+            return IPCS_MALLOC_FAIL;
+        }
+    }
+
+    do {
+        result = IPCS_MsgToStreamFlags(msg, callId, IPCS_PRIO_NORMAL, IPCS_GetNowNs(), queue->frameFlags, streamBuf,
+                &streamBufLen);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Send queue: msg to stream fail: %d, fd: %d.", result, fd);
+            break;
+        }
+
+        result = IPCS_SendQueueSubmit(queue, fd, streamBuf, streamBufLen);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Send queue: send fd: %d fail: %d", fd, result);
+            break;
+        }
+
+        IPCS_CaptureFrame(IPCS_CAPTURE_TX, itemType, fd, msg);
+    } while (0);
+
+    if (streamBuf != inlineBuf) {
+        free(streamBuf);
+    }
+
+    return result;
+}
+
+int IPCS_SendQueueControl(IPCS_SendQueue *queue, int fd, unsigned int ctrlType, unsigned int value)
+{
+    unsigned int frame[4];
+    unsigned int frameLen = 3 * sizeof(unsigned int);
+
+    /* 与IPCS_SendControl相同的帧：msgType + msgLen（带控制标志）+ 4字节参数，留出校验和的位置 */
+    frame[0] = ctrlType;
+    frame[1] = (unsigned int)sizeof(value) | IPCS_MSG_FLAG_CONTROL;
+    frame[2] = value;
+    if (queue->frameFlags & IPCS_MSG_FLAG_CHECKSUM) {
+        IPCS_FrameAddChecksum(frame, &frameLen);
+    }
+
+    return IPCS_SendQueueSubmit(queue, fd, frame, frameLen);
+}
+
+/******************************************************************************/
+/* 栈中是后进先出的，反转后按提交顺序发送，同一个线程先后提交的帧不会乱序 */
+void IPCS_SendQueueCombine(IPCS_SendQueue *queue, int fd)
+{
+    IPCS_SendReq *list = NULL;
+    IPCS_SendReq *ordered = NULL;
+    IPCS_SendReq *req = NULL;
+    unsigned int round = 0;
+
+    for (round = 0; round < IPCS_SENDQ_MAX_ROUNDS; round++) {
+        list = __atomic_exchange_n(&queue->head, NULL, __ATOMIC_ACQUIRE);
+        if (list == NULL) {
+            break;
+        }
+
+        ordered = NULL;
+        while ((req = list) != NULL) {
+            list = req->next;
+            req->next = ordered;
+            ordered = req;
+        }
+
+        while (ordered != NULL) {
+            ordered = IPCS_SendQueueFlush(fd, ordered);
+            IPCS_SendQueueWake(queue);
+        }
+    }
+
+    return;
+}
+
+/**
+ * 睡眠方先登记sleepers再检查条件，唤醒方先标记完成（或交出合并权）再检查sleepers，
+ * 两边都是顺序一致的原子操作，至少有一方看到另一方的修改：要么睡眠方不睡，要么唤醒方广播；
+ * 检查条件和进入cond_wait都在mutex内，广播也要先取mutex，不会漏掉唤醒。
+ **/
+void IPCS_SendQueueWake(IPCS_SendQueue *queue)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->sleepers, __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&queue->mutex);
+    (void)pthread_cond_broadcast(&queue->cond);
+    (void)pthread_mutex_unlock(&queue->mutex);
+
+    return;
+}
+
+void IPCS_SendQueueSleep(IPCS_SendQueue *queue, IPCS_SendReq *req)
+{
+    (void)pthread_mutex_lock(&queue->mutex);
+    (void)__atomic_add_fetch(&queue->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&req->done, __ATOMIC_SEQ_CST) &&
+           __atomic_load_n(&queue->combining, __ATOMIC_SEQ_CST)) {
+        (void)pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+    (void)__atomic_sub_fetch(&queue->sleepers, 1, __ATOMIC_SEQ_CST);
+    (void)pthread_mutex_unlock(&queue->mutex);
+
+    return;
+}
+
+/* 阻塞的fd上sendmsg只在被信号中断时少发，从中断处接着发；出错时没有发完的帧都失败 */
+IPCS_SendReq *IPCS_SendQueueFlush(int fd, IPCS_SendReq *list)
+{
+    struct iovec iov[IPCS_SENDQ_IOV_MAX];
+    struct msghdr msgHdr;
+    IPCS_SendReq *req = list;
+    IPCS_SendReq *next = NULL;
+    IPCS_SendReq *rest = NULL;
+    size_t totalLen = 0;
+    size_t sentLen = 0;
+    size_t frameEnd = 0;
+    ssize_t writeLen = 0;
+    unsigned int iovNum = 0;
+    unsigned int first = 0;
+    int result = IPCS_OK;
+
+    for (; (req != NULL) && (iovNum < IPCS_SENDQ_IOV_MAX); req = req->next) {
+        iov[iovNum].iov_base = (void *)req->frame;
+        iov[iovNum].iov_len = req->frameLen;
+        totalLen += req->frameLen;
+        iovNum++;
+    }
+    rest = req;
+
+    while (sentLen < totalLen) {
+        (void)memset(&msgHdr, 0, sizeof(msgHdr));
+        msgHdr.msg_iov = &iov[first];
+        msgHdr.msg_iovlen = iovNum - first;
+
+        /* 对端已关闭时返回错误而不是触发SIGPIPE */
+        writeLen = sendmsg(fd, &msgHdr, MSG_NOSIGNAL);
+        if (writeLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            IPCS_WriteLog("Send queue: sendmsg fd: %d fail, errno: %d", fd, errno);
+            result = IPCS_WRITE_FAIL;
+            break;
+        }
+
+        sentLen += (size_t)writeLen;
+        while ((first < iovNum) && ((size_t)writeLen >= iov[first].iov_len)) {
+            writeLen -= (ssize_t)iov[first].iov_len;
+            first++;
+        }
+        if (first < iovNum) {
+            iov[first].iov_base = (char *)iov[first].iov_base + writeLen;
+            iov[first].iov_len -= (size_t)writeLen;
+        }
+    }
+
+    /* 标记完成之后提交线程可能立即返回，请求所在的栈失效，先取出next */
+    for (req = list; req != rest; req = next) {
+        next = req->next;
+        frameEnd += req->frameLen;
+        req->result = (frameEnd <= sentLen) ? IPCS_OK : result;
+        __atomic_store_n(&req->done, 1, __ATOMIC_RELEASE);
+    }
+
+    return rest;
+}
+
+/******************************************************************************/
@@ -0,0 +1,84 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_sendq.h
+ *
+ *    Description:  IPC socket multi-producer send queue with flat combining
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:05:33 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_SENDQ_H__
+#define __IPCS_SENDQ_H__
+
+#include "ipcs.h"
+
+#include <pthread.h>
+
+/******************************************************************************/
+/**
+ * 多个线程向同一个fd发送：各线程把编码好的帧压入无锁栈（CAS），然后争抢合并发送的权利，
+ * 抢到的线程一次取走栈中所有的帧，按提交顺序用一次sendmsg（多个iovec）发出，逐个标记完成；
+ * 没抢到的线程等待自己的帧被其他线程发出：先自旋IPCS_SENDQ_SPIN次，之后在条件变量上睡眠，
+ * 合并线程每发完一批帧、交出合并权时唤醒睡眠的线程。同一时刻只有一个线程写fd，帧不会交错；
+ * 竞争越激烈，一次系统调用合并的帧越多。
+ * 请求放在提交线程的栈上，合并线程标记完成之后不再访问它。
+ **/
+#define IPCS_SENDQ_IOV_MAX          64      /* 一次sendmsg最多合并的帧数 */
+#define IPCS_SENDQ_MAX_ROUNDS       4       /* 合并线程最多连续取几次栈，避免一个调用长时间替别人发送 */
+#define IPCS_SENDQ_SPIN             64      /* 等待时睡眠之前自旋检查的次数 */
+#define IPCS_SENDQ_INLINE_LEN       256     /* 不超过此长度的帧编码在请求内，不分配内存 */
+
+typedef struct IPCS_SendReq {
+    struct IPCS_SendReq *next;
+    const void *frame;
+    unsigned int frameLen;
+    int result;
+    int done;
+} IPCS_SendReq;
+
+typedef struct {
+    IPCS_SendReq *head;             /* 无锁栈，最新提交的在栈顶 */
+    int combining;                  /* 是否有线程正在合并发送 */
+    unsigned int frameFlags;        /* 连接时协商好的帧选项（校验和、压缩），每帧按选项编码 */
+    unsigned int sleepers;          /* 在cond上睡眠（或正要睡眠）的线程数，为0时合并线程不唤醒 */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} IPCS_SendQueue;
+
+/******************************************************************************/
+void IPCS_SendQueueInit(IPCS_SendQueue *queue);
+
+void IPCS_SendQueueDestroy(IPCS_SendQueue *queue);
+
+/* 提交一帧并等待它被发出（由本线程或其他线程），返回发送结果 */
+int IPCS_SendQueueSubmit(IPCS_SendQueue *queue, int fd, const void *frame, unsigned int frameLen);
+
+/* 编码客户端的请求（带发送时间）后提交 */
+int IPCS_SendQueueMessage(IPCS_SendQueue *queue, int itemType, int fd, IPCS_Message *msg, unsigned int callId);
+
+int IPCS_SendQueueControl(IPCS_SendQueue *queue, int fd, unsigned int ctrlType, unsigned int value);
+
+/* 取走栈中的帧发送，持有合并权时调用 */
+void IPCS_SendQueueCombine(IPCS_SendQueue *queue, int fd);
+
+/* 唤醒睡眠的提交线程，让它们检查自己的帧是否已发出或去争抢合并权 */
+void IPCS_SendQueueWake(IPCS_SendQueue *queue);
+
+/* 自旋之后睡眠，直到自己的帧被发出或合并权空闲 */
+void IPCS_SendQueueSleep(IPCS_SendQueue *queue, IPCS_SendReq *req);
+
+/* 按顺序发送list中的帧，设置每帧的结果并标记完成；返回下一批的第一帧 */
+IPCS_SendReq *IPCS_SendQueueFlush(int fd, IPCS_SendReq *list);
+
+/******************************************************************************/
+
+#endif /* __IPCS_SENDQ_H__ */
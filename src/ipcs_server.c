@@ -1,378 +1,3107 @@
-/*
- * =====================================================================================
- *
- *       Filename:  ipcs_server.h
- *
- *    Description:  IPC socket server
- *
- *        Version:  1.0
- *        Created:  12/28/2018 10:33:49 PM
- *       Revision:  none
- *       Compiler:  gcc
- *
- *         Author:  Dercury (Jim), dercury@qq.com
- *   Organization:  Perfect World
- *
- * =====================================================================================
- */
-
-#include "ipcs_server.h"
-
-#include <errno.h>
-#include <pthread.h>
-#include <stddef.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/epoll.h>
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <sys/un.h>
-#include <unistd.h>
-
-/******************************************************************************/
-int IPCS_CreateServer(const char *serverName, ServerCallback serverHook)
-{
-    pthread_t threadId;
-    IPCS_ServerThreadArg *threadArg = NULL;
-    int result = 0;
-
-    result = IPCS_CheckCreatingServer(serverName, serverHook);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Check create server with bad params. Error: %d", result);
-        return result;
-    }
-
-    threadArg = (IPCS_ServerThreadArg *)malloc(sizeof(IPCS_ServerThreadArg));
-    if (threadArg == NULL) {
-        perror("malloc error");
-        IPCS_WriteLog("Create Server: %s: malloc fail.", serverName);
-        return IPCS_MALLOC_FAIL;
-    }
-
-    (void)memset(threadArg, 0, sizeof(IPCS_ServerThreadArg));
-    snprintf(threadArg->name, sizeof(threadArg->name), "%s", serverName);
-    threadArg->serverHook = serverHook;
-
-    result = IPCS_CreateThread(IPCS_ServerRun, threadArg, &threadId);
-    if (result != IPCS_OK) {
-        free(threadArg);
-        IPCS_WriteLog("Create Server: %s: create thread fail: %d.", serverName, result);
-        return result;
-    }
-
-    IPCS_WriteLog("Create Server: %s: at thread %p success.", serverName, threadId);
-
-    return IPCS_OK;
-}
-
-int IPCS_CheckCreatingServer(const char *serverName, ServerCallback serverHook)
-{
-    if (serverHook == NULL) {
-        IPCS_WriteLog("Check creating server with null hook.");
-        return IPCS_PARAM_NULL;
-    }
-
-    return IPCS_CheckItemName(serverName);
-}
-
-void *IPCS_ServerRun(void *arg)
-{
-    IPCS_ServerThreadArg *threadArg = (IPCS_ServerThreadArg *)arg;
-	int serverFd = 0;
-    int epollFd = 0;
-    int result = 0;
-
-    do {
-        result = IPCS_CreateServerSocket(threadArg->name, &serverFd);
-        if (result != IPCS_OK) {
-            IPCS_WriteLog("Create server: %s socket fail: %d", threadArg->name, result);
-            break;
-        }
-    
-        result = IPCS_CreateServerEpoll(serverFd, &epollFd);
-        if (result != IPCS_OK) {
-            (void)close(serverFd);
-            IPCS_WriteLog("Create server: %s fd: %d epoll fail: %d", threadArg->name, serverFd, result);
-            break;
-        }
-
-        result = IPCS_AddServerInfo(threadArg->name, serverFd, epollFd, pthread_self(), threadArg->serverHook);
-        if (result != IPCS_OK) {
-            (void)close(serverFd);
-            (void)close(epollFd);
-            break;
-        }
-    
-        result = IPCS_HandleServerEpollEvents(serverFd, epollFd, threadArg);
-        if (result != IPCS_OK) {
-            (void)close(serverFd);
-            (void)close(epollFd);
-            IPCS_WriteLog("Handle server: %s fd: %d epoll fd %d events fail: %d",
-                    threadArg->name, serverFd, epollFd, result);
-            break;
-        }
-    
-        (void)close(serverFd);
-        (void)close(epollFd);
-    } while (0);
-
-    free(threadArg);
-
-    return NULL;
-}
-
-int IPCS_CreateServerSocket(const char *serverName, int *serverFd)
-{
-    struct sockaddr_un serverAddr;
-	int listenFd = 0;
-    int result = 0;
-
-    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (listenFd < 0) {
-        perror("socket error");
-        IPCS_WriteLog("Create server: %s socket fail: %d, errno: %d", serverName, listenFd, errno);
-        return IPCS_SOCKET_FAIL;
-    }
-
-    (void)memset(&serverAddr, 0, sizeof(serverAddr));
-    serverAddr.sun_family = AF_UNIX;
-    snprintf(serverAddr.sun_path, sizeof(serverAddr.sun_path), "%s", serverName);
-
-    /* 如果调用bind时文件已存在，则bind返回错误，所以先删除文件 */
-    unlink(serverName);
-    result = bind(listenFd, (struct sockaddr *)&serverAddr, sizeof(serverAddr));
-    if (result < 0) {
-        (void)close(listenFd);
-        perror("bind error");
-        IPCS_WriteLog("Bind server: %s socket: %d fail: %d, errno: %d", serverName, listenFd, result, errno);
-        return IPCS_BIND_FAIL;
-    }
-
-    result = listen(listenFd, MAX_CLIENT_NUM);
-    if (result < 0) {
-        (void)close(listenFd);
-        perror("listen error");
-        IPCS_WriteLog("Listen server: %s socket %d fail: %d, errno: %d", serverName, listenFd, result, errno);
-        return IPCS_BIND_FAIL;
-    }
-
-    *serverFd = listenFd;
-    IPCS_WriteLog("IPC socket server: %s socket: %d created.", serverName, *serverFd);
-
-    return IPCS_OK;
-}
-
-int IPCS_CreateServerEpoll(int serverFd, int *epollFd)
-{
-    struct epoll_event epollEvent;
-    int tempFd = 0;
-    int result = 0;
-
-    tempFd = epoll_create(EPOLL_SIZE);
-    if (tempFd < 0) {
-        perror("epoll create error");
-        IPCS_WriteLog("Create server: %d epoll fail: %d, errno: %d", serverFd, tempFd, errno);
-        return IPCS_EPOLL_CREATE_FAIL;
-    }
-
-    epollEvent.events = EPOLLIN | EPOLLET;
-    epollEvent.data.fd = serverFd;
-    result = epoll_ctl(tempFd, EPOLL_CTL_ADD, serverFd, &epollEvent);
-    if (result < 0) {
-        (void)close(tempFd);
-        perror("epoll ctl error");
-        IPCS_WriteLog("Ctl server: %d epoll fail: %d, errno: %d", serverFd, result, errno);
-        return IPCS_EPOLL_CTL_FAIL;
-    }
-
-    *epollFd = tempFd;
-    IPCS_WriteLog("IPC socket server: %d epoll: %d created.", serverFd, *epollFd);
-
-    return IPCS_OK;
-}
-
-int IPCS_HandleServerEpollEvents(int serverFd, int epollFd, IPCS_ServerThreadArg *threadArg)
-{
-    int events_num = 0;
-    int i = 0;
-    struct epoll_event events[EPOLL_SIZE];
-    int result = IPCS_OK;
-
-    for (; ; ) {
-        events_num = epoll_wait(epollFd, events, EPOLL_SIZE, EPOLL_RUN_TIMEOUT);
-        if (events_num < 0) {
-            perror("epoll wait error");
-            IPCS_WriteLog("Handle server: %d epoll: %d wait fail: %d, errno: %d",
-                    serverFd, epollFd, events_num, errno);
-            return IPCS_EPOLL_WAIT_FAIL;
-        }
-
-        for (i = 0; i < events_num; i++) {
-            if (events[i].data.fd == serverFd) { 
-                /* 有新的连接 */
-                result = IPCS_ServerAcceptClient(serverFd, epollFd);
-            } else if ((events[i].events & EPOLLIN) || 
-                (events[i].events & EPOLLPRI) || 
-                (events[i].events & EPOLLOUT)) {
-                IPCS_WriteLog("Server: %d epoll: %d handling events: %p from fd: %d ...", 
-                               serverFd, epollFd, events[i].events, events[i].data.fd);
-                /* 有数据待接收或待发送 */
-                result = IPCS_ServerHandleMessage(events[i].data.fd, threadArg);
-            } else {
-                /* 错误处理 */
-                perror("epoll wait bad event");
-                result = IPCS_EPOLL_BAD_EVENT;
-            }
-
-            if (result != IPCS_OK) {
-                IPCS_WriteLog("Server: %d epoll: %d got bad events: %p from fd: %d, errno: %d",
-                        serverFd, epollFd, events[i].events, events[i].data.fd, errno);
-                return result;
-            }
-        }
-    }
-
-    return IPCS_OK;
-}
-
-int IPCS_ServerAcceptClient(int serverFd, int epollFd)
-{
-    struct sockaddr_un clientAddr;
-	socklen_t clientAddrLen;
-    int acceptFd = 0;
-    struct epoll_event epollEvent;
-    int result = 0;
-
-    clientAddrLen = sizeof(clientAddr);
-    acceptFd = accept(serverFd, (struct sockaddr *)&clientAddr, &clientAddrLen);
-    if (acceptFd < 0) {
-        perror("accept error");
-        IPCS_WriteLog("Server: %d epoll: %d accept client fail: %d, errno: %d", serverFd, epollFd, acceptFd, errno);
-        return IPCS_ACCEPT_FAIL;
-    }
-
-    epollEvent.events = EPOLLIN | EPOLLET;
-    epollEvent.data.fd = acceptFd;
-    result = epoll_ctl(epollFd, EPOLL_CTL_ADD, acceptFd, &epollEvent);
-    if (result < 0) {
-        perror("epoll ctl error");
-        IPCS_WriteLog("Ctl server: %d epoll: %d add %d fail: %d, errno: %d", serverFd, epollFd, acceptFd, result, errno);
-        return IPCS_EPOLL_CTL_FAIL;
-    }
-
-    IPCS_WriteLog("Server: %d epoll: %d accept client %d success.", serverFd, epollFd, acceptFd);
-
-    return IPCS_OK;
-}
-
-int IPCS_ServerHandleMessage(int clientFd, IPCS_ServerThreadArg *threadArg)
-{
-    return IPCS_RecvMultiMsg(IPCS_SERVER, clientFd, threadArg);
-}
-
-/******************************************************************************/
-/* 销毁服务端 */
-int IPCS_DestroyServer(const char *serverName)
-{
-    int result = 0;
-    IPCS_ItemInfo itemInfo;
-    
-    result = IPCS_CheckItemName(serverName);
-    if (result != IPCS_OK) {
-        return result;
-    }
-
-    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
-    result = IPCS_FindItemsInfo(IPCS_SERVER, serverName, 0, &itemInfo);
-    if (result != IPCS_OK) {
-        return IPCS_OK;
-    }
-
-    result = pthread_cancel(itemInfo.pid);
-    if (result != 0) {
-        perror("pthread_cancel error");
-        IPCS_WriteLog("Destroy server: %s pthread_cancel: %p fail, errno: %d", serverName, itemInfo.pid, errno);
-        return result;
-    }
-
-    result = close(itemInfo.epollFd);
-    if (result != 0) {
-        perror("close error");
-        IPCS_WriteLog("Destroy server: %s epollFd: %d close fail, errno: %d", serverName, itemInfo.epollFd, errno);
-        return result;
-    } 
-    
-    result = close(itemInfo.fd);
-    if (result != 0) {
-        perror("close error");
-        IPCS_WriteLog("Destroy server: %s sockfd: %d close fail, errno: %d", serverName, itemInfo.fd, errno);
-    } else {
-        IPCS_WriteLog("Destroy server: %s success", serverName);
-    }
-
-    return result;
-}
-
-/******************************************************************************/
-/* 服务端响应消息，服务端响应请求的回调函数中使用 */
-int IPCS_ServerSendMessage(int fd, IPCS_Message *msg)
-{
-    int result = IPCS_OK;
-
-    result = IPCS_CheckSeverSendMsg(fd, msg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Server send mgs to client: %d with bad params: %d", fd, result);
-        return result;
-    }
-
-    result = IPCS_SendMessage(fd, msg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Server send msg to client: %d fail: %d", fd, result);
-        return result;
-    }
-
-    return result;
-}
-
-int IPCS_CheckSeverSendMsg(int fd, IPCS_Message *msg)
-{
-    int result = IPCS_OK;
-
-    /* The input fd is not client fd, it's acceptFd. 
-     * So it can't be checked by IPCS_IsItemExist. */
-
-    result = IPCS_CheckMessage(msg);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Server send to client: %d with bad msg: %d", fd, result);
-        return result;
-    }
-
-    return IPCS_OK;
-}
-
-/******************************************************************************/
-int IPCS_AddServerInfo(const char *serverName, int fd, int epollFd, pthread_t pid, ServerCallback hook)
-{
-    IPCS_ItemInfo info;
-    int result = IPCS_OK;
-
-    (void)memset(&info, 0, sizeof(IPCS_ItemInfo));
-
-    info.type = IPCS_SERVER;
-    (void)strcpy(info.name, serverName);
-    info.fd = fd;
-    info.epollFd = epollFd;
-    info.pid = pid;
-    info.hook = hook;
-
-    result = IPCS_AddItemsInfo(&info);
-    if (result != IPCS_OK) {
-        IPCS_WriteLog("Add server: %s: socket: %d info fail: %d.", serverName, fd, result);
-    }
-
-    return result;
-}
-
-/******************************************************************************/
-
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_server.h
+ *
+ *    Description:  IPC socket server
+ *
+ *        Version:  1.0
+ *        Created:  12/28/2018 10:33:49 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_server.h"
+#include "ipcs_capture.h"
+#include "ipcs_thread.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+/* 当前线程运行的服务端，回调函数中发送响应时据此找到连接；其他线程为NULL */
+static __thread IPCS_ServerThreadArg *g_IpcsCurServer = NULL;
+
+/* 共享反应器（attr.reactor非0的服务端线程）列表，创建服务端时按reactor查找 */
+static IPCS_ServerThreadArg *g_IpcsReactors = NULL;
+static pthread_mutex_t g_IpcsReactorsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* 保护所有listener->ready，服务端线程通知和创建线程超时放弃都在锁中进行 */
+static pthread_mutex_t g_IpcsReadyMutex = PTHREAD_MUTEX_INITIALIZER;
+
+int IPCS_CreateServer(const char *serverName, ServerCallback serverHook)
+{
+    return IPCS_CreateServerEx(serverName, serverHook, NULL);
+}
+
+void IPCS_InitServerAttr(IPCS_ServerAttr *attr)
+{
+    if (attr == NULL) {
+        return;
+    }
+
+    (void)memset(attr, 0, sizeof(IPCS_ServerAttr));
+    attr->engine = IPCS_ENGINE_EPOLL;
+    attr->pubPolicy = IPCS_PUB_DROP_NEWEST;
+    attr->pubQueueLen = IPCS_PUB_QUEUE_DEFAULT_LEN;
+    attr->reactor = 0;
+
+    return;
+}
+
+int IPCS_CreateServerEx(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr)
+{
+    IPCS_ServerListener *listener = NULL;
+    int result = 0;
+
+    result = IPCS_CheckCreatingServer(serverName, serverHook);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Check create server with bad params. Error: %d", result);
+        return result;
+    }
+
+    if (IPCS_FindPreforkServer(serverName)) {
+        IPCS_WriteLog("Create Server: %s: exist as prefork server.", serverName);
+        return IPCS_EXIST;
+    }
+
+    if ((attr != NULL) && (attr->workers > 1)) {
+        return IPCS_CreatePreforkServer(serverName, serverHook, attr);
+    }
+
+    listener = IPCS_MallocServerListener(serverName, serverHook, attr);
+    if (listener == NULL) {
+        perror("malloc error");
+        IPCS_WriteLog("Create Server: %s: malloc fail.", serverName);
+        return IPCS_MALLOC_FAIL;
+    }
+
+    return IPCS_StartServerListener(listener);
+}
+
+int IPCS_StartServerListener(IPCS_ServerListener *listener)
+{
+    char serverName[IPCS_ITEM_NAME_MAX_LEN];
+    pthread_t threadId;
+    pthread_condattr_t condAttr;
+    IPCS_ServerReady ready;
+    IPCS_ServerThreadArg *threadArg = NULL;
+    unsigned int readyTimeoutMs = listener->attr.readyTimeoutMs;
+    int result = 0;
+
+    /* 服务端线程开始运行后listener可能被释放 */
+    snprintf(serverName, sizeof(serverName), "%s", listener->name);
+
+    /* 在初始化ready之前检查，失败时不用销毁条件变量 */
+    result = IPCS_CheckThreadAttr(&listener->attr.thread);
+    if (result != IPCS_OK) {
+        IPCS_FreeServerListener(listener);
+        return result;
+    }
+
+    /* 在交给服务端线程之前设置，失败时释放listener也会通知 */
+    if (readyTimeoutMs != 0) {
+        (void)memset(&ready, 0, sizeof(ready));
+        (void)pthread_condattr_init(&condAttr);
+        (void)pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+        (void)pthread_cond_init(&ready.cond, &condAttr);
+        (void)pthread_condattr_destroy(&condAttr);
+        listener->ready = &ready;
+    }
+
+    /* 全局锁保证同一个reactor只有一个服务端线程 */
+    (void)pthread_mutex_lock(&g_IpcsReactorsMutex);
+    do {
+        if ((listener->attr.reactor != 0) && (IPCS_AttachServerListener(listener) == IPCS_OK)) {
+            IPCS_WriteLog("Create Server: %s: on reactor %u success.", serverName, listener->attr.reactor);
+            break;
+        }
+
+        threadArg = IPCS_MallocServerThreadArg(listener);
+        if (threadArg == NULL) {
+            perror("malloc error");
+            IPCS_WriteLog("Create Server: %s: malloc fail.", serverName);
+            IPCS_FreeServerListener(listener);
+            result = IPCS_MALLOC_FAIL;
+            break;
+        }
+
+        result = IPCS_CreateThreadEx(IPCS_ServerRun, threadArg, &threadArg->attr.thread, IPCS_SERVER_THREAD_NAME,
+                &threadId);
+        if (result != IPCS_OK) {
+            IPCS_FreeServerThreadArg(threadArg);
+            IPCS_WriteLog("Create Server: %s: create thread fail: %d.", serverName, result);
+            break;
+        }
+
+        if (threadArg->reactorId != 0) {
+            threadArg->nextReactor = g_IpcsReactors;
+            g_IpcsReactors = threadArg;
+        }
+
+        IPCS_WriteLog("Create Server: %s: at thread %p success.", serverName, threadId);
+    } while (0);
+    (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+
+    if (readyTimeoutMs != 0) {
+        if (result == IPCS_OK) {
+            result = IPCS_ServerWaitReady(listener, &ready, readyTimeoutMs);
+            IPCS_WriteLog("Create Server: %s: ready result: %d.", serverName, result);
+        }
+        (void)pthread_cond_destroy(&ready.cond);
+    }
+
+    return result;
+}
+
+void IPCS_ServerReportReady(IPCS_ServerListener *listener, int result)
+{
+    (void)pthread_mutex_lock(&g_IpcsReadyMutex);
+    if (listener->ready != NULL) {
+        listener->ready->result = result;
+        listener->ready->done = 1;
+        (void)pthread_cond_broadcast(&listener->ready->cond);
+        listener->ready = NULL;
+    }
+    (void)pthread_mutex_unlock(&g_IpcsReadyMutex);
+
+    return;
+}
+
+/* 没有通知之前listener不会被释放，超时时可以在锁中清除listener->ready */
+int IPCS_ServerWaitReady(IPCS_ServerListener *listener, IPCS_ServerReady *ready, unsigned int timeoutMs)
+{
+    struct timespec ts;
+    uint64_t deadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    int result = IPCS_OK;
+
+    ts.tv_sec = (time_t)(deadlineNs / 1000000000ULL);
+    ts.tv_nsec = (long)(deadlineNs % 1000000000ULL);
+
+    (void)pthread_mutex_lock(&g_IpcsReadyMutex);
+    while (!ready->done) {
+        if (pthread_cond_timedwait(&ready->cond, &g_IpcsReadyMutex, &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    if (ready->done) {
+        result = ready->result;
+    } else {
+        listener->ready = NULL;
+        result = IPCS_TIMEOUT;
+    }
+    (void)pthread_mutex_unlock(&g_IpcsReadyMutex);
+
+    return result;
+}
+
+/**
+ * 多进程服务端的工作进程：在fork出的子进程中调用，不返回。子进程中只有fork的线程，
+ * 回调函数直接在这个线程中运行；监听socket由创建进程建立，多个工作进程共用。
+ **/
+void IPCS_ServerRunWorker(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr, int listenFd)
+{
+    IPCS_ServerListener *listener = NULL;
+    IPCS_ServerThreadArg *threadArg = NULL;
+    IPCS_ServerAttr workerAttr = *attr;
+
+    workerAttr.workers = 0;
+    workerAttr.reactor = 0;
+    listener = IPCS_MallocServerListener(serverName, serverHook, &workerAttr);
+    if (listener == NULL) {
+        _exit(IPCS_MALLOC_FAIL);
+    }
+    listener->listenFd = listenFd;
+    listener->shared = 1;
+
+    threadArg = IPCS_MallocServerThreadArg(listener);
+    if (threadArg == NULL) {
+        _exit(IPCS_MALLOC_FAIL);
+    }
+    IPCS_ThreadSetName(pthread_self(), &workerAttr.thread, IPCS_WORKER_PROCESS_NAME);
+
+    (void)IPCS_ServerRun(threadArg);
+
+    _exit(IPCS_OK);
+}
+
+/* 持有库的全局锁fork，避免子进程继承其他线程持有的锁；先刷新stdio缓冲区，避免子进程重复输出 */
+pid_t IPCS_ServerFork(void)
+{
+    pid_t pid = 0;
+    int savedErrno = 0;
+
+    (void)fflush(NULL);
+    (void)pthread_mutex_lock(&g_IpcsReactorsMutex);
+    IPCS_ItemsForkLock(1);
+    IPCS_ConnOwnersLock();
+    pid = fork();
+    savedErrno = errno;
+    if (pid == 0) {
+        IPCS_ConnOwnersClearAll();
+    }
+    IPCS_ConnOwnersUnlock();
+    IPCS_ItemsForkLock(0);
+    (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+    errno = savedErrno;
+
+    return pid;
+}
+
+int IPCS_CheckCreatingServer(const char *serverName, ServerCallback serverHook)
+{
+    if (serverHook == NULL) {
+        IPCS_WriteLog("Check creating server with null hook.");
+        return IPCS_PARAM_NULL;
+    }
+
+    return IPCS_CheckItemName(serverName);
+}
+
+IPCS_ServerListener *IPCS_MallocServerListener(const char *serverName, ServerCallback serverHook,
+        const IPCS_ServerAttr *attr)
+{
+    IPCS_ServerListener *listener = NULL;
+
+    listener = (IPCS_ServerListener *)malloc(sizeof(IPCS_ServerListener));
+    if (listener == NULL) {
+        return NULL;
+    }
+    (void)memset(listener, 0, sizeof(IPCS_ServerListener));
+
+    snprintf(listener->name, sizeof(listener->name), "%s", serverName);
+    listener->serverHook = serverHook;
+    if (attr != NULL) {
+        listener->attr = *attr;
+    } else {
+        IPCS_InitServerAttr(&listener->attr);
+    }
+    if (listener->attr.pubQueueLen == 0) {
+        listener->attr.pubQueueLen = IPCS_PUB_QUEUE_DEFAULT_LEN;
+    }
+    if (listener->attr.connCredit == 0) {
+        listener->attr.connCredit = IPCS_CONN_CREDIT_DEFAULT;
+    } else if (listener->attr.connCredit < IPCS_CONN_CREDIT_MIN) {
+        listener->attr.connCredit = IPCS_CONN_CREDIT_MIN;
+    }
+    IPCS_CodelInit(&listener->codel, &listener->attr.shed);
+    IPCS_CacheInit(&listener->cache, (listener->attr.cacheBytes != 0) ? listener->attr.cacheBytes :
+            IPCS_CACHE_DEFAULT_BYTES);
+    IPCS_CacheInit(&listener->flights, IPCS_FLIGHT_MAX_BYTES);
+    listener->listenFd = -1;
+    listener->handoffFd = -1;
+
+    return listener;
+}
+
+void IPCS_FreeServerListener(IPCS_ServerListener *listener)
+{
+    /* 还没有打开监听socket就被释放（服务端线程创建epoll失败等） */
+    IPCS_ServerReportReady(listener, IPCS_LISTEN_FAIL);
+    /* 关闭监听fd后都置为-1，这里只剩接管时交给服务端、还没有打开的监听fd */
+    if (listener->listenFd >= 0) {
+        (void)close(listener->listenFd);
+        listener->listenFd = -1;
+    }
+    IPCS_HandoffFreeConns(listener->adopted, 1);
+    IPCS_CacheDestroy(&listener->cache);
+    IPCS_CacheDestroy(&listener->flights);
+    free(listener);
+
+    return;
+}
+
+/**
+ * 销毁服务端时先删除登记信息，再持有全局反应器锁设置closing，所以持有该锁查到的服务端还没有关闭。
+ * 固定期间服务端线程关闭服务端后不释放它，服务端线程本身也要等publishers为0才释放。
+ **/
+int IPCS_ServerPinListener(const char *serverName, IPCS_ServerListener **listener)
+{
+    IPCS_ServerThreadArg *threadArg = NULL;
+    IPCS_ItemInfo itemInfo;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckItemName(serverName);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
+    (void)pthread_mutex_lock(&g_IpcsReactorsMutex);
+    result = IPCS_FindItemsInfo(IPCS_SERVER, serverName, 0, &itemInfo);
+    if (result != IPCS_OK) {
+        (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+        return result;
+    }
+
+    *listener = (IPCS_ServerListener *)itemInfo.context;
+    threadArg = (*listener)->reactor;
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    if (threadArg->stopping || threadArg->exited || (*listener)->closing) {
+        result = IPCS_NOT_FOUND;
+    } else {
+        (*listener)->pins++;
+        threadArg->publishers++;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+    (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+
+    return result;
+}
+
+/* 服务端已关闭时通知服务端线程释放它 */
+void IPCS_ServerUnpinListener(IPCS_ServerListener *listener)
+{
+    IPCS_ServerThreadArg *threadArg = listener->reactor;
+    uint64_t wakeValue = 1;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    listener->pins--;
+    if ((listener->pins == 0) && (listener->closeState == IPCS_LISTENER_CLOSED)) {
+        (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    }
+    threadArg->publishers--;
+    (void)pthread_cond_broadcast(&threadArg->exitCond);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    return;
+}
+
+/* 服务端线程的属性（I/O引擎等）取自创建线程的服务端 */
+IPCS_ServerThreadArg *IPCS_MallocServerThreadArg(IPCS_ServerListener *listener)
+{
+    IPCS_ServerThreadArg *threadArg = NULL;
+
+    threadArg = (IPCS_ServerThreadArg *)malloc(sizeof(IPCS_ServerThreadArg));
+    if (threadArg == NULL) {
+        return NULL;
+    }
+    (void)memset(threadArg, 0, sizeof(IPCS_ServerThreadArg));
+
+    threadArg->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (threadArg->wakeFd < 0) {
+        perror("eventfd error");
+        free(threadArg);
+        return NULL;
+    }
+
+    snprintf(threadArg->name, sizeof(threadArg->name), "%s", listener->name);
+    threadArg->attr = listener->attr;
+    threadArg->reactorId = listener->attr.reactor;
+    threadArg->epollFd = -1;
+    IPCS_BusyPollInit(&threadArg->busyPoll, &listener->attr.busyPoll);
+
+    listener->reactor = threadArg;
+    threadArg->addList = listener;
+    threadArg->listenerNum = 1;
+
+    (void)pthread_mutex_init(&threadArg->mutex, NULL);
+    (void)pthread_cond_init(&threadArg->exitCond, NULL);
+    (void)pthread_cond_init(&threadArg->pubCond, NULL);
+    IPCS_ConnTableInit(&threadArg->conns);
+    threadArg->conns.owner = threadArg;
+    IPCS_ServerTimersInit(&threadArg->timers, IPCS_GetNowNs());
+
+    return threadArg;
+}
+
+void IPCS_FreeServerThreadArg(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerListener *listener = NULL;
+    IPCS_PubItem *node = NULL;
+
+    /* 服务端线程退出后还没有分发的发布消息 */
+    while ((node = threadArg->pubInbox) != NULL) {
+        threadArg->pubInbox = node->next;
+        IPCS_SharedFrameUnref(node->frame);
+        free(node);
+    }
+
+    /* 已打开的监听fd已由服务端线程关闭，没有打开的由释放listener关闭 */
+    while ((listener = threadArg->listeners) != NULL) {
+        threadArg->listeners = listener->next;
+        IPCS_FreeServerListener(listener);
+    }
+    while ((listener = threadArg->addList) != NULL) {
+        threadArg->addList = listener->next;
+        IPCS_FreeServerListener(listener);
+    }
+
+    IPCS_ServerFreeTasks(threadArg);
+    IPCS_ServerTimersDestroy(&threadArg->timers);
+
+    (void)close(threadArg->wakeFd);
+    (void)pthread_mutex_destroy(&threadArg->mutex);
+    (void)pthread_cond_destroy(&threadArg->exitCond);
+    (void)pthread_cond_destroy(&threadArg->pubCond);
+    free(threadArg->cacheBuf);
+    free(threadArg);
+
+    return;
+}
+
+/* 在全局反应器列表的锁中调用：加入reactor相同的服务端线程，由该线程打开监听socket */
+int IPCS_AttachServerListener(IPCS_ServerListener *listener)
+{
+    IPCS_ServerThreadArg *threadArg = g_IpcsReactors;
+    uint64_t wakeValue = 1;
+    int result = IPCS_OK;
+
+    while ((threadArg != NULL) && (threadArg->reactorId != listener->attr.reactor)) {
+        threadArg = threadArg->nextReactor;
+    }
+    if (threadArg == NULL) {
+        return IPCS_NOT_FOUND;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    if (threadArg->stopping || threadArg->exited) {
+        result = IPCS_NOT_FOUND;
+    } else {
+        listener->reactor = threadArg;
+        listener->next = threadArg->addList;
+        threadArg->addList = listener;
+        threadArg->listenerNum++;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (result == IPCS_OK) {
+        (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    }
+
+    return result;
+}
+
+/* 在全局反应器列表的锁中调用 */
+void IPCS_UnlinkReactor(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerThreadArg **link = &g_IpcsReactors;
+
+    while (*link != NULL) {
+        if (*link == threadArg) {
+            *link = threadArg->nextReactor;
+            break;
+        }
+        link = &(*link)->nextReactor;
+    }
+
+    return;
+}
+
+void *IPCS_ServerRun(void *arg)
+{
+    IPCS_ServerThreadArg *threadArg = (IPCS_ServerThreadArg *)arg;
+    IPCS_ServerListener *listener = NULL;
+    int epollFd = -1;
+    int result = 0;
+
+    g_IpcsCurServer = threadArg;
+
+    do {
+        if (threadArg->attr.engine == IPCS_ENGINE_URING) {
+            result = IPCS_CreateServerUring(threadArg);
+            if (result != IPCS_OK) {
+                IPCS_WriteLog("Create server: %s io_uring fail: %d, use epoll.", threadArg->name, result);
+            }
+        }
+
+        if (threadArg->ring == NULL) {
+            result = IPCS_CreateServerEpoll(threadArg->wakeFd, &epollFd);
+            if (result != IPCS_OK) {
+                IPCS_WriteLog("Create server: %s epoll fail: %d", threadArg->name, result);
+                break;
+            }
+            threadArg->epollFd = epollFd;
+        }
+
+        /* 创建线程的服务端在这里打开监听socket，之后加入的服务端在事件循环中打开 */
+        IPCS_ServerOpenListeners(threadArg);
+        if (threadArg->listeners == NULL) {
+            break;
+        }
+
+        if (threadArg->ring != NULL) {
+            result = IPCS_HandleServerUringEvents(threadArg);
+        } else {
+            result = IPCS_HandleServerEpollEvents(epollFd, threadArg);
+        }
+
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Handle server: %s events fail: %d", threadArg->name, result);
+            break;
+        }
+    } while (0);
+
+    /* 先关闭ring，取消所有引用连接缓冲区的请求，再关闭连接 */
+    IPCS_UringServerCancelAccepts(threadArg);
+    IPCS_DestroyServerUring(threadArg);
+    IPCS_ConnTableDestroy(&threadArg->conns);
+
+    if (epollFd >= 0) {
+        (void)close(epollFd);
+    }
+
+    for (listener = threadArg->listeners; listener != NULL; listener = listener->next) {
+        if (listener->listenFd >= 0) {
+            (void)close(listener->listenFd);
+            listener->listenFd = -1;
+        }
+    }
+
+    g_IpcsCurServer = NULL;
+    IPCS_ServerThreadExit(threadArg);
+
+    return NULL;
+}
+
+/**
+ * 没有登记（创建失败）或者在自己的回调函数中被销毁时，由服务端线程释放参数；
+ * 释放前等待阻塞在收件箱上的发布者和等待关闭服务端的线程返回。
+ **/
+void IPCS_ServerThreadExit(IPCS_ServerThreadArg *threadArg)
+{
+    int selfFree = 0;
+
+    /* 不再接受新加入的服务端 */
+    (void)pthread_mutex_lock(&g_IpcsReactorsMutex);
+    IPCS_UnlinkReactor(threadArg);
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->exited = 1;
+    selfFree = threadArg->selfFree || !threadArg->registered;
+    (void)pthread_cond_broadcast(&threadArg->exitCond);
+    (void)pthread_cond_broadcast(&threadArg->pubCond);
+    (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+    while (selfFree && ((threadArg->publishers != 0) || (threadArg->closeWaiters != 0))) {
+        (void)pthread_cond_wait(&threadArg->exitCond, &threadArg->mutex);
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (selfFree) {
+        IPCS_FreeServerThreadArg(threadArg);
+    }
+
+    return;
+}
+
+/* 在服务端线程之外调用时等待服务端线程退出后释放；在回调函数中调用时由服务端线程退出时释放 */
+void IPCS_StopServerThread(IPCS_ServerThreadArg *threadArg, pthread_t pid)
+{
+    uint64_t wakeValue = 1;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->stopping = 1;
+    if (pthread_equal(pid, pthread_self())) {
+        threadArg->selfFree = 1;
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+        return;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+
+    /* 还要等待阻塞在收件箱上的发布者和等待关闭服务端的线程返回 */
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    (void)pthread_cond_broadcast(&threadArg->pubCond);
+    while (!threadArg->exited || (threadArg->publishers != 0) || (threadArg->closeWaiters != 0)) {
+        (void)pthread_cond_wait(&threadArg->exitCond, &threadArg->mutex);
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    IPCS_FreeServerThreadArg(threadArg);
+
+    return;
+}
+
+int IPCS_CreateServerSocket(const char *serverName, int *serverFd)
+{
+    struct sockaddr_un serverAddr;
+    socklen_t serverAddrLen = 0;
+	int listenFd = 0;
+    int result = 0;
+
+    /* 监听fd设置为非阻塞，边沿触发时循环accept直到EAGAIN */
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (listenFd < 0) {
+        perror("socket error");
+        IPCS_WriteLog("Create server: %s socket fail: %d, errno: %d", serverName, listenFd, errno);
+        return IPCS_SOCKET_FAIL;
+    }
+
+    (void)IPCS_FillSockAddr(serverName, &serverAddr, &serverAddrLen);
+
+    /* 如果调用bind时文件已存在，则bind返回错误，所以先删除文件；抽象地址没有文件 */
+    IPCS_UnlinkSockName(serverName);
+    result = bind(listenFd, (struct sockaddr *)&serverAddr, serverAddrLen);
+    if (result < 0) {
+        (void)close(listenFd);
+        perror("bind error");
+        IPCS_WriteLog("Bind server: %s socket: %d fail: %d, errno: %d", serverName, listenFd, result, errno);
+        return IPCS_BIND_FAIL;
+    }
+
+    result = listen(listenFd, MAX_CLIENT_NUM);
+    if (result < 0) {
+        (void)close(listenFd);
+        perror("listen error");
+        IPCS_WriteLog("Listen server: %s socket %d fail: %d, errno: %d", serverName, listenFd, result, errno);
+        return IPCS_BIND_FAIL;
+    }
+
+    *serverFd = listenFd;
+    IPCS_WriteLog("IPC socket server: %s socket: %d created.", serverName, *serverFd);
+
+    return IPCS_OK;
+}
+
+/* 监听fd由IPCS_ServerOpenListener加入 */
+int IPCS_CreateServerEpoll(int wakeFd, int *epollFd)
+{
+    struct epoll_event epollEvent;
+    int tempFd = 0;
+    int result = 0;
+
+    tempFd = epoll_create(EPOLL_SIZE);
+    if (tempFd < 0) {
+        perror("epoll create error");
+        IPCS_WriteLog("Create server epoll fail: %d, errno: %d", tempFd, errno);
+        return IPCS_EPOLL_CREATE_FAIL;
+    }
+
+    epollEvent.events = EPOLLIN;
+    epollEvent.data.fd = wakeFd;
+    result = epoll_ctl(tempFd, EPOLL_CTL_ADD, wakeFd, &epollEvent);
+    if (result < 0) {
+        (void)close(tempFd);
+        perror("epoll ctl error");
+        IPCS_WriteLog("Ctl server epoll: %d fail: %d, errno: %d", tempFd, result, errno);
+        return IPCS_EPOLL_CTL_FAIL;
+    }
+
+    *epollFd = tempFd;
+    IPCS_WriteLog("IPC socket server epoll: %d created.", *epollFd);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+/**
+ * 共享反应器：attr.reactor相同的服务端共用一个服务端线程，每个服务端一个监听socket。
+ * 新加入的服务端放在addList中，由服务端线程打开；销毁的服务端设置closing后唤醒服务端线程，
+ * 由服务端线程停止accept、关闭其连接，连接全部关闭后释放。最后一个服务端销毁时线程退出。
+ **/
+void IPCS_ServerOpenListeners(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerListener *list = NULL;
+    IPCS_ServerListener *listener = NULL;
+    int result = IPCS_OK;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    list = threadArg->addList;
+    threadArg->addList = NULL;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    while ((listener = list) != NULL) {
+        list = listener->next;
+        result = IPCS_ServerOpenListener(threadArg, listener);
+        IPCS_ServerReportReady(listener, result);
+        if (result == IPCS_OK) {
+            listener->next = threadArg->listeners;
+            threadArg->listeners = listener;
+            continue;
+        }
+
+        /* 创建失败的服务端没有登记，不会被销毁，在这里减少计数；都失败时线程退出后自己释放 */
+        (void)pthread_mutex_lock(&g_IpcsReactorsMutex);
+        (void)pthread_mutex_lock(&threadArg->mutex);
+        threadArg->listenerNum--;
+        if (threadArg->listenerNum == 0) {
+            threadArg->stopping = 1;
+            threadArg->selfFree = 1;
+            IPCS_UnlinkReactor(threadArg);
+        }
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+        (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+        IPCS_FreeServerListener(listener);
+    }
+
+    return;
+}
+
+int IPCS_ServerOpenListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener)
+{
+    struct epoll_event epollEvent;
+    int result = IPCS_OK;
+
+    /* 多进程服务端的工作进程使用创建进程建立的监听socket */
+    if (listener->listenFd < 0) {
+        result = IPCS_CreateServerSocket(listener->name, &listener->listenFd);
+        if (result != IPCS_OK) {
+            IPCS_WriteLog("Create server: %s socket fail: %d", listener->name, result);
+            return result;
+        }
+    }
+
+    result = IPCS_AddServerInfo(listener->name, listener->listenFd, threadArg->epollFd, pthread_self(),
+            listener->serverHook, listener);
+    if (result != IPCS_OK) {
+        (void)close(listener->listenFd);
+        listener->listenFd = -1;
+        return result;
+    }
+
+    /* 登记成功后才开始accept，io_uring中不会留下引用已关闭fd的请求 */
+    if (threadArg->ring != NULL) {
+        result = IPCS_UringServerArmAccept(threadArg, listener);
+    } else {
+        /* 共用的监听socket每个新连接只唤醒一个工作进程，水平触发，每次唤醒只accept一个 */
+        epollEvent.events = listener->shared ? (EPOLLIN | EPOLLEXCLUSIVE) : (EPOLLIN | EPOLLET);
+        epollEvent.data.fd = listener->listenFd;
+        if (epoll_ctl(threadArg->epollFd, EPOLL_CTL_ADD, listener->listenFd, &epollEvent) < 0) {
+            perror("epoll ctl error");
+            IPCS_WriteLog("Ctl server: %s epoll: %d add fail, errno: %d", listener->name, threadArg->epollFd, errno);
+            result = IPCS_EPOLL_CTL_FAIL;
+        }
+    }
+
+    if (result != IPCS_OK) {
+        (void)IPCS_DelItemsInfo(IPCS_SERVER, listener->name, 0);
+        (void)close(listener->listenFd);
+        listener->listenFd = -1;
+        return result;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->registered = 1;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (listener->adopted != NULL) {
+        IPCS_ServerAdoptConns(threadArg, listener);
+    }
+
+    return IPCS_OK;
+}
+
+IPCS_ServerListener *IPCS_ServerFindListener(IPCS_ServerThreadArg *threadArg, int listenFd)
+{
+    IPCS_ServerListener *listener = threadArg->listeners;
+
+    while ((listener != NULL) && (listener->listenFd != listenFd)) {
+        listener = listener->next;
+    }
+
+    return listener;
+}
+
+/* 服务端线程被唤醒时：打开新加入的服务端，关闭已销毁的服务端 */
+void IPCS_ServerHandleListenerChanges(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerListener *listener = NULL;
+    IPCS_ServerListener *next = NULL;
+    unsigned int closeNum = 0;
+
+    IPCS_ServerOpenListeners(threadArg);
+    IPCS_ServerHandleHandoffs(threadArg);
+
+    /* 关闭时还被其他线程固定的服务端，解除固定后在这里释放 */
+    for (listener = threadArg->listeners; listener != NULL; listener = next) {
+        next = listener->next;
+        if (listener->closeState == IPCS_LISTENER_CLOSED) {
+            IPCS_ServerReleaseListener(threadArg, listener);
+        }
+    }
+
+    /* 先记下本次关闭的服务端：设置closing之后发布的消息不会再进入收件箱，
+     * 之前的消息在下面分发完，之后收件箱不再引用这些服务端 */
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    for (listener = threadArg->listeners; listener != NULL; listener = listener->next) {
+        if (listener->closing && (listener->closeState == IPCS_LISTENER_OPEN)) {
+            listener->closeState = IPCS_LISTENER_CLOSING;
+            closeNum++;
+        }
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (closeNum == 0) {
+        return;
+    }
+
+    IPCS_ServerDrainPubInbox(threadArg);
+    IPCS_ServerRunTasks(threadArg);
+
+    for (listener = threadArg->listeners; listener != NULL; listener = next) {
+        next = listener->next;
+        if (listener->closeState != IPCS_LISTENER_CLOSING) {
+            continue;
+        }
+
+        IPCS_ServerCancelListenerTimers(&threadArg->timers, listener);
+        IPCS_ServerCloseListener(threadArg, listener);
+
+        (void)pthread_mutex_lock(&threadArg->mutex);
+        listener->closeState = IPCS_LISTENER_CLOSED;
+        threadArg->closingNum--;
+        (void)pthread_cond_broadcast(&threadArg->exitCond);
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+
+        IPCS_ServerReleaseListener(threadArg, listener);
+    }
+
+    return;
+}
+
+/* 停止accept，关闭该服务端的连接；连接上已收到的数据处理完后由接收侧关闭 */
+void IPCS_ServerCloseListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener)
+{
+    struct io_uring_sqe *sqe = NULL;
+    IPCS_Conn *conn = NULL;
+    unsigned int i = 0;
+
+    /* io_uring中取消multishot accept，最后一个accept完成事件到达后再关闭监听fd */
+    sqe = (threadArg->ring != NULL) ? IPCS_UringGetSqe(threadArg->ring) : NULL;
+    if (sqe != NULL) {
+        IPCS_UringPrepCancel(sqe, IPCS_URING_USER_DATA(listener->listenFd, IPCS_URING_OP_ACCEPT),
+                IPCS_URING_USER_DATA(listener->listenFd, IPCS_URING_OP_CANCEL));
+    } else if (threadArg->ring != NULL) {
+        (void)shutdown(listener->listenFd, SHUT_RDWR);
+    } else {
+        (void)close(listener->listenFd);
+        listener->listenFd = -1;
+    }
+
+    for (i = 0; i < threadArg->conns.cap; i++) {
+        conn = threadArg->conns.conns[i];
+        if ((conn != NULL) && (conn->listener == listener)) {
+            (void)shutdown(conn->fd, SHUT_RDWR);
+            /* 暂停接收的连接要恢复接收才能读到对端关闭 */
+            if (conn->recvPaused) {
+                IPCS_ServerPauseRecv(threadArg, conn, 0);
+            }
+        }
+    }
+
+    IPCS_WriteLog("Server: %s closed on thread of %s.", listener->name, threadArg->name);
+
+    return;
+}
+
+/* 已关闭、监听fd已关闭并且没有连接的服务端从列表中删除并释放 */
+void IPCS_ServerReleaseListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener)
+{
+    IPCS_ServerListener **link = &threadArg->listeners;
+    unsigned int pins = 0;
+
+    if ((listener->closeState != IPCS_LISTENER_CLOSED) || (listener->listenFd >= 0) || (listener->connNum != 0)) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    pins = listener->pins;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+    if (pins != 0) {
+        return;
+    }
+
+    while (*link != NULL) {
+        if (*link == listener) {
+            *link = listener->next;
+            IPCS_FreeServerListener(listener);
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    return;
+}
+
+/**
+ * 销毁服务端（已从登记信息中删除）：最后一个服务端销毁时停止服务端线程；否则通知服务端线程
+ * 关闭该服务端，在服务端线程之外调用时等待关闭完成，返回后不再调用该服务端的回调函数。
+ **/
+void IPCS_ServerRemoveListener(IPCS_ServerListener *listener, pthread_t pid)
+{
+    IPCS_ServerThreadArg *threadArg = listener->reactor;
+    uint64_t wakeValue = 1;
+    int last = 0;
+
+    (void)pthread_mutex_lock(&g_IpcsReactorsMutex);
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    __atomic_store_n(&listener->closing, 1, __ATOMIC_RELAXED);
+    threadArg->listenerNum--;
+    last = (threadArg->listenerNum == 0);
+    if (last) {
+        IPCS_UnlinkReactor(threadArg);
+    } else {
+        threadArg->closingNum++;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+    (void)pthread_mutex_unlock(&g_IpcsReactorsMutex);
+
+    if (last) {
+        IPCS_StopServerThread(threadArg, pid);
+        return;
+    }
+
+    (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    if (pthread_equal(pid, pthread_self())) {
+        return;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->closeWaiters++;
+    while ((threadArg->closingNum != 0) && !threadArg->exited) {
+        (void)pthread_cond_wait(&threadArg->exitCond, &threadArg->mutex);
+    }
+    threadArg->closeWaiters--;
+    (void)pthread_cond_broadcast(&threadArg->exitCond);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    return;
+}
+
+/* 调用连接所属服务端的回调函数，已销毁的服务端不再调用 */
+int IPCS_ServerCallHook(IPCS_ServerThreadArg *threadArg, int fd, IPCS_Message *msg, uint64_t sendNs)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, fd);
+    IPCS_ServerListener *listener = (conn != NULL) ? conn->listener : threadArg->listeners;
+
+    if ((listener == NULL) || __atomic_load_n(&listener->closing, __ATOMIC_RELAXED)) {
+        return IPCS_OK;
+    }
+
+    if ((__atomic_load_n(&listener->cache.typeNum, __ATOMIC_ACQUIRE) != 0) ||
+        (__atomic_load_n(&listener->flights.typeNum, __ATOMIC_ACQUIRE) != 0)) {
+        return IPCS_ServerCallHookCached(threadArg, listener, fd, msg, sendNs);
+    }
+
+    IPCS_STAT_ADD(listener->stats.messages, 1);
+
+    return listener->serverHook(fd, msg);
+}
+
+/******************************************************************************/
+/* 回调函数正在为可缓存的请求生成响应（线程私有），fd为-1时不记录 */
+typedef struct {
+    int fd;
+    const IPCS_Message *request;
+    uint64_t expireNs;
+    IPCS_CacheEntry *entry;
+    unsigned int responses;
+} IPCS_CacheFill;
+
+static __thread IPCS_CacheFill g_IpcsCacheFill = {-1, NULL, 0, NULL, 0};
+
+/**
+ * 请求合并复用响应缓存的结构：回调函数返回时把响应记录在flights中，expireNs为返回的时间。
+ * 服务端线程同步地执行回调函数，之后才读取其他连接上的请求，因此"并发"的相同请求是
+ * 在前一个请求的回调函数返回之前发出的请求：用请求的发送时间（sendNs < expireNs）查找，
+ * 查找到之后发出的请求时删除该项，之后的请求重新调用回调函数。没有发送时间的请求不合并。
+ **/
+int IPCS_ServerCallHookCached(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener, int fd,
+        IPCS_Message *msg, uint64_t sendNs)
+{
+    IPCS_Message response;
+    IPCS_CacheEntry *entry = NULL;
+    uint64_t nowNs = IPCS_GetNowNs();
+    uint64_t ttlNs = 0;
+    uint64_t generation = 0;
+    uint64_t flightNs = 0;
+    uint64_t flightGeneration = 0;
+    unsigned int responses = 0;
+    int result = IPCS_OK;
+
+    IPCS_STAT_ADD(listener->stats.messages, 1);
+
+    if (threadArg->cacheBuf == NULL) {
+        threadArg->cacheBuf = malloc(IPCS_MESSAGE_MAX_LEN);
+        if (threadArg->cacheBuf == NULL) {
+            return listener->serverHook(fd, msg);
+        }
+    }
+
+    /* 命中时直接回复，响应同样带上请求的调用ID和优先级 */
+    response.msgType = 0;
+    response.msgLen = IPCS_MESSAGE_MAX_LEN;
+    response.msgValue = threadArg->cacheBuf;
+    if (IPCS_CacheLookup(&listener->cache, msg, nowNs, &response, &ttlNs, &generation) == IPCS_OK) {
+        return IPCS_ServerSendMessage(fd, &response);
+    }
+
+    if ((sendNs != 0) &&
+        (IPCS_CacheLookup(&listener->flights, msg, sendNs, &response, &flightNs, &flightGeneration) == IPCS_OK)) {
+        IPCS_STAT_ADD(listener->stats.coalesced, 1);
+        return IPCS_ServerSendMessage(fd, &response);
+    }
+
+    if ((ttlNs == 0) && (flightNs == 0)) {
+        return listener->serverHook(fd, msg);
+    }
+
+    g_IpcsCacheFill.fd = fd;
+    g_IpcsCacheFill.request = msg;
+    g_IpcsCacheFill.expireNs = nowNs + ttlNs;
+    g_IpcsCacheFill.entry = NULL;
+    g_IpcsCacheFill.responses = 0;
+
+    result = listener->serverHook(fd, msg);
+
+    entry = g_IpcsCacheFill.entry;
+    responses = g_IpcsCacheFill.responses;
+    g_IpcsCacheFill.fd = -1;
+    g_IpcsCacheFill.request = NULL;
+    g_IpcsCacheFill.entry = NULL;
+
+    /* 只缓存成功且只有一条响应的结果；没有响应、多条响应或者发给其他fd的不缓存 */
+    if ((result != IPCS_OK) || (responses != 1) || (entry == NULL)) {
+        free(entry);
+        return result;
+    }
+
+    if (flightNs != 0) {
+        IPCS_ServerFlightDone(listener, entry, flightGeneration, sendNs);
+    }
+
+    if (ttlNs != 0) {
+        IPCS_CacheInsert(&listener->cache, entry, generation, IPCS_GetNowNs());
+    } else {
+        free(entry);
+    }
+
+    return result;
+}
+
+void IPCS_ServerFlightDone(IPCS_ServerListener *listener, IPCS_CacheEntry *entry, uint64_t generation,
+        uint64_t sendNs)
+{
+    IPCS_CacheEntry *flight = NULL;
+    size_t size = sizeof(IPCS_CacheEntry) + entry->keyLen + entry->respLen;
+    uint64_t doneNs = IPCS_GetNowNs();
+
+    flight = (IPCS_CacheEntry *)malloc(size);
+    if (flight == NULL) {
+        return;
+    }
+    (void)memcpy(flight, entry, size);
+    flight->expireNs = doneNs;
+
+    /**
+     * 插入时淘汰在这个请求发出之前IPCS_FLIGHT_KEEP_NS以上就已返回的项。不按返回时间淘汰：其他请求的
+     * 回调函数执行很久时，排在后面的相同请求在前一个请求返回之前就已发出，仍然可以合并
+     **/
+    IPCS_CacheInsert(&listener->flights, flight, generation, sendNs - IPCS_FLIGHT_KEEP_NS);
+
+    return;
+}
+
+void IPCS_ServerCacheCapture(IPCS_Message *msg)
+{
+    g_IpcsCacheFill.responses++;
+    if (g_IpcsCacheFill.responses == 1) {
+        g_IpcsCacheFill.entry = IPCS_CacheNewEntry(g_IpcsCacheFill.request, msg, g_IpcsCacheFill.expireNs);
+    }
+
+    return;
+}
+
+int IPCS_ServerSetCache(const char *serverName, unsigned int msgType, unsigned int ttlMs)
+{
+    IPCS_ServerListener *listener = NULL;
+    int result = IPCS_OK;
+
+    result = IPCS_ServerPinListener(serverName, &listener);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Set cache with not exist server: %s", (serverName != NULL) ? serverName : "");
+        return result;
+    }
+
+    result = IPCS_CacheSetType(&listener->cache, msgType, ttlMs);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server: %s set cache msg type: %u ttl: %u fail: %d", serverName, msgType, ttlMs, result);
+    }
+    IPCS_ServerUnpinListener(listener);
+
+    return result;
+}
+
+int IPCS_ServerSetCoalesce(const char *serverName, unsigned int msgType, int enable)
+{
+    IPCS_ServerListener *listener = NULL;
+    int result = IPCS_OK;
+
+    result = IPCS_ServerPinListener(serverName, &listener);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Set coalesce with not exist server: %s", (serverName != NULL) ? serverName : "");
+        return result;
+    }
+
+    /* 合并表不使用过期时间，非0表示开启 */
+    result = IPCS_CacheSetType(&listener->flights, msgType, enable ? 1 : 0);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server: %s set coalesce msg type: %u fail: %d", serverName, msgType, result);
+    }
+    IPCS_ServerUnpinListener(listener);
+
+    return result;
+}
+
+int IPCS_ServerInvalidateCache(const char *serverName, unsigned int msgType, const IPCS_Message *request)
+{
+    IPCS_ServerListener *listener = NULL;
+    int result = IPCS_OK;
+
+    if ((request != NULL) && (IPCS_CheckMessage((IPCS_Message *)request) != IPCS_OK)) {
+        return IPCS_PARAM_NULL;
+    }
+
+    result = IPCS_ServerPinListener(serverName, &listener);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Invalidate cache with not exist server: %s", (serverName != NULL) ? serverName : "");
+        return result;
+    }
+
+    IPCS_CacheInvalidate(&listener->cache, msgType, request);
+    IPCS_CacheInvalidate(&listener->flights, msgType, request);
+    IPCS_ServerUnpinListener(listener);
+
+    return IPCS_OK;
+}
+
+/**
+ * 排队时间为客户端写入请求到服务端线程取出请求的时间，包括在内核socket缓冲区、
+ * 连接接收缓冲区中等待的时间。被拒绝的请求不执行回调函数，回复一个很小的错误帧，
+ * 客户端可以立即重试其他服务端或放弃，而不是等到超时。
+ **/
+int IPCS_ServerAdmit(IPCS_ServerThreadArg *threadArg, int fd, IPCS_Message *msg, unsigned int callId,
+        IPCS_Priority prio, uint64_t sendNs, uint64_t *queueNs)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, fd);
+    IPCS_ServerListener *listener = (conn != NULL) ? conn->listener : threadArg->listeners;
+    const IPCS_ShedAttr *shedAttr = NULL;
+    uint64_t nowNs = 0;
+    int shed = 0;
+
+    *queueNs = 0;
+    if (listener == NULL) {
+        return IPCS_OK;
+    }
+    shedAttr = &listener->attr.shed;
+
+    if ((sendNs == 0) && (shedAttr->policy != IPCS_SHED_TOKEN_BUCKET)) {
+        return IPCS_OK;
+    }
+
+    nowNs = IPCS_GetNowNs();
+    if ((sendNs != 0) && (nowNs > sendNs)) {
+        *queueNs = nowNs - sendNs;
+        IPCS_STAT_ADD(listener->stats.queueNs, *queueNs);
+    }
+
+    if (prio == IPCS_PRIO_HIGH) {
+        return IPCS_OK;
+    }
+
+    if ((shedAttr->policy == IPCS_SHED_CODEL) && (sendNs != 0)) {
+        shed = IPCS_CodelShed(&listener->codel, nowNs, *queueNs);
+    } else if ((shedAttr->policy == IPCS_SHED_TOKEN_BUCKET) && (conn != NULL)) {
+        shed = IPCS_TokenBucketShed(&conn->shedBucket, shedAttr, nowNs);
+    }
+
+    if (!shed) {
+        return IPCS_OK;
+    }
+
+    IPCS_STAT_ADD(listener->stats.sheds, 1);
+    if (!shedAttr->silent && (conn != NULL)) {
+        (void)IPCS_ServerReject(threadArg, conn, msg->msgType, callId, IPCS_OVERLOADED);
+    }
+
+    return IPCS_OVERLOADED;
+}
+
+/* 错误帧带上请求的msgType和调用ID，负载为错误码，按发布消息同样的方式排入发送队列 */
+int IPCS_ServerReject(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, unsigned int msgType, unsigned int callId,
+        int error)
+{
+    IPCS_SharedFrame *frame = NULL;
+    IPCS_Message reply;
+    int result = IPCS_OK;
+
+    reply.msgType = msgType;
+    reply.msgLen = sizeof(error);
+    reply.msgValue = &error;
+
+    frame = IPCS_SharedFrameNew(&reply, callId, IPCS_PRIO_NORMAL,
+            IPCS_MSG_FLAG_ERROR | conn->frameFlags);
+    if (frame == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    result = IPCS_ServerQueueFrame(threadArg, conn, frame, 0);
+    IPCS_SharedFrameUnref(frame);
+
+    return result;
+}
+
+/******************************************************************************/
+int IPCS_HandleServerEpollEvents(int epollFd, IPCS_ServerThreadArg *threadArg)
+{
+    int events_num = 0;
+    int i = 0;
+    struct epoll_event events[EPOLL_SIZE];
+    IPCS_ServerListener *listener = NULL;
+    uint64_t wakeValue = 0;
+    int result = IPCS_OK;
+
+    while (!threadArg->stopping) {
+        events_num = IPCS_ServerEpollWait(threadArg, epollFd, events);
+        if (events_num < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll wait error");
+            IPCS_WriteLog("Handle server: %s epoll: %d wait fail: %d, errno: %d",
+                    threadArg->name, epollFd, events_num, errno);
+            return IPCS_EPOLL_WAIT_FAIL;
+        }
+
+        for (i = 0; (i < events_num) && !threadArg->stopping; i++) {
+            if (events[i].data.fd == threadArg->wakeFd) {
+                (void)read(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+                IPCS_ServerDrainPubInbox(threadArg);
+                IPCS_ServerRunTasks(threadArg);
+                IPCS_ServerHandleListenerChanges(threadArg);
+                continue;
+            } else if ((listener = IPCS_ServerFindListener(threadArg, events[i].data.fd)) != NULL) {
+                /* 有新的连接 */
+                result = IPCS_ServerAcceptClient(listener, epollFd, threadArg);
+            } else if (IPCS_ConnTableGet(&threadArg->conns, events[i].data.fd) == NULL) {
+                /* 本轮中已关闭的fd */
+                continue;
+            } else if ((events[i].events & EPOLLIN) || 
+                (events[i].events & EPOLLPRI) || 
+                (events[i].events & EPOLLOUT)) {
+                IPCS_WriteLog("Server: %s epoll: %d handling events: %p from fd: %d ...", 
+                               threadArg->name, epollFd, events[i].events, events[i].data.fd);
+                /* 发送队列可写 */
+                if (events[i].events & EPOLLOUT) {
+                    IPCS_ServerFlushOut(threadArg, IPCS_ConnTableGet(&threadArg->conns, events[i].data.fd));
+                }
+
+                /* 有数据待接收 */
+                if (events[i].events & (EPOLLIN | EPOLLPRI)) {
+                    result = IPCS_ServerHandleMessage(events[i].data.fd, threadArg);
+                } else if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    result = IPCS_PEER_CLOSED;
+                }
+
+                if (result == IPCS_PEER_CLOSED) {
+                    /* 客户端已关闭，数据处理完后关闭连接，关闭fd时自动从epoll中删除 */
+                    result = IPCS_ServerCloseClient(threadArg, events[i].data.fd);
+                }
+            } else if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                result = IPCS_ServerCloseClient(threadArg, events[i].data.fd);
+            } else {
+                /* 错误处理 */
+                perror("epoll wait bad event");
+                result = IPCS_EPOLL_BAD_EVENT;
+            }
+
+            if (result != IPCS_OK) {
+                IPCS_WriteLog("Server: %s epoll: %d got bad events: %p from fd: %d, errno: %d",
+                        threadArg->name, epollFd, events[i].events, events[i].data.fd, errno);
+                return result;
+            }
+        }
+
+        /* 所有连接的高优先级帧处理完后再处理普通帧 */
+        result = IPCS_ServerHandleRecvList(threadArg);
+        if (result != IPCS_OK) {
+            return result;
+        }
+
+        /* 定时器中的响应和本轮的响应一起发送 */
+        IPCS_ServerRunTimers(threadArg);
+        IPCS_ServerFlushOutList(threadArg);
+        IPCS_ServerMaintain(threadArg);
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_ServerEpollWait(IPCS_ServerThreadArg *threadArg, int epollFd, struct epoll_event *events)
+{
+    IPCS_BusyPoll *busyPoll = &threadArg->busyPoll;
+    uint64_t budgetNs = IPCS_BusyPollBudget(busyPoll);
+    uint64_t timerNs = IPCS_ServerNextTimer(threadArg);
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int timeoutMs = EPOLL_RUN_TIMEOUT;
+    int events_num = 0;
+
+    if (busyPoll->spinNs != 0) {
+        startNs = IPCS_GetNowNs();
+    }
+
+    if (budgetNs != 0) {
+        endNs = startNs + budgetNs;
+        do {
+            events_num = epoll_wait(epollFd, events, EPOLL_SIZE, 0);
+            IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+        } while ((events_num == 0) && !threadArg->stopping && (IPCS_GetNowNs() < endNs));
+
+        if (events_num > 0) {
+            IPCS_STAT_ADD(threadArg->stats.spinHits, 1);
+        }
+    }
+
+    if (events_num == 0) {
+        if (timerNs != 0) {
+            timeoutMs = (int)((timerNs + 999999ULL) / 1000000ULL);
+        }
+        events_num = epoll_wait(epollFd, events, EPOLL_SIZE, timeoutMs);
+        IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+    }
+    IPCS_STAT_ADD(threadArg->stats.wakeups, 1);
+
+    if ((busyPoll->spinNs != 0) && (events_num > 0)) {
+        IPCS_BusyPollRecord(busyPoll, budgetNs, IPCS_GetNowNs() - startNs);
+    }
+
+    return events_num;
+}
+
+int IPCS_ServerAcceptClient(IPCS_ServerListener *listener, int epollFd, IPCS_ServerThreadArg *threadArg)
+{
+    struct sockaddr_un clientAddr;
+	socklen_t clientAddrLen;
+    int acceptFd = 0;
+    struct epoll_event epollEvent;
+    IPCS_Conn *conn = NULL;
+    int result = 0;
+
+    /* 边沿触发只通知一次，需要把已完成的连接全部accept；共用的监听socket是水平触发，
+     * 只accept一个，剩下的连接唤醒其他工作进程 */
+    for (; ; ) {
+        clientAddrLen = sizeof(clientAddr);
+        acceptFd = accept(listener->listenFd, (struct sockaddr *)&clientAddr, &clientAddrLen);
+        IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+        if (acceptFd < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+                break;
+            }
+            perror("accept error");
+            IPCS_WriteLog("Server: %s epoll: %d accept client fail: %d, errno: %d", listener->name, epollFd,
+                    acceptFd, errno);
+            return IPCS_ACCEPT_FAIL;
+        }
+
+        conn = IPCS_ConnTableAdd(&threadArg->conns, acceptFd);
+        if (conn == NULL) {
+            (void)close(acceptFd);
+            IPCS_WriteLog("Server: %s add client %d fail.", listener->name, acceptFd);
+            continue;
+        }
+        conn->listener = listener;
+        listener->connNum++;
+
+        /* 连接fd使用水平触发：每次事件只读一次，没读完的数据下次epoll_wait继续通知 */
+        epollEvent.events = EPOLLIN | EPOLLRDHUP;
+        epollEvent.data.fd = acceptFd;
+        result = epoll_ctl(epollFd, EPOLL_CTL_ADD, acceptFd, &epollEvent);
+        if (result < 0) {
+            listener->connNum--;
+            IPCS_ConnTableDel(&threadArg->conns, acceptFd);
+            perror("epoll ctl error");
+            IPCS_WriteLog("Ctl server: %s epoll: %d add %d fail: %d, errno: %d", listener->name, epollFd, acceptFd,
+                    result, errno);
+            return IPCS_EPOLL_CTL_FAIL;
+        }
+
+        IPCS_WriteLog("Server: %s epoll: %d accept client %d success.", listener->name, epollFd, acceptFd);
+        if (listener->shared) {
+            break;
+        }
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_ServerCloseClient(IPCS_ServerThreadArg *threadArg, int clientFd)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, clientFd);
+    IPCS_Conn **link = &threadArg->flushList;
+    IPCS_ServerListener *listener = NULL;
+
+    if (conn != NULL) {
+        /* 从待发送列表和待接收处理列表中删除 */
+        while ((conn->flushQueued) && (*link != NULL)) {
+            if (*link == conn) {
+                *link = conn->nextFlush;
+                break;
+            }
+            link = &(*link)->nextFlush;
+        }
+        link = &threadArg->recvList;
+        while ((conn->recvQueued) && (*link != NULL)) {
+            if (*link == conn) {
+                *link = conn->nextRecv;
+                break;
+            }
+            link = &(*link)->nextRecv;
+        }
+        if (conn->recvPaused) {
+            threadArg->pausedNum--;
+        }
+        listener = conn->listener;
+        IPCS_ConnTableDel(&threadArg->conns, clientFd);
+
+        /* 已销毁的服务端在最后一个连接关闭后释放 */
+        if (listener != NULL) {
+            listener->connNum--;
+            IPCS_ServerReleaseListener(threadArg, listener);
+        }
+    } else if (close(clientFd) != 0) {
+        perror("close error");
+        IPCS_WriteLog("Server: %s close client %d fail, errno: %d", threadArg->name, clientFd, errno);
+        return IPCS_OK;
+    }
+
+    IPCS_WriteLog("Server: %s close client %d.", threadArg->name, clientFd);
+
+    return IPCS_OK;
+}
+
+int IPCS_ServerHandleMessage(int clientFd, IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, clientFd);
+    ssize_t recvLen = 0;
+
+    if (conn == NULL) {
+        return IPCS_RecvMultiMsg(IPCS_SERVER, clientFd, threadArg);
+    }
+
+    /* 接收缓冲区从最小开始，上次读满时加倍，最大到IPCS_CONN_RECV_BUF_LEN */
+    (void)IPCS_ConnReserveRecv(conn, conn->recvFilled ? conn->recvCap : IPCS_CONN_RECV_MIN_LEN);
+    if (conn->recvLen >= conn->recvCap) {
+        return IPCS_OK;
+    }
+
+    recvLen = read(clientFd, conn->recvBuf + conn->recvLen, conn->recvCap - conn->recvLen);
+    IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+    if (recvLen < 0) {
+        if ((errno == EAGAIN) || (errno == EINTR)) {
+            return IPCS_OK;
+        }
+        IPCS_WriteLog("Server: %s read client %d fail: %d, errno: %d", threadArg->name, clientFd, recvLen, errno);
+        return IPCS_PEER_CLOSED;
+    }
+
+    if (recvLen == 0) {
+        /* 对端已关闭连接 */
+        return IPCS_PEER_CLOSED;
+    }
+
+    conn->recvFilled = ((size_t)recvLen == conn->recvCap - conn->recvLen);
+    conn->recvLen += (size_t)recvLen;
+    conn->active = 1;
+    threadArg->trimPending = 1;
+
+    return IPCS_ServerHandleConnHigh(threadArg, conn);
+}
+
+/* 处理接收缓冲区中的完整帧，不完整的尾帧留到下次 */
+int IPCS_ServerHandleConnData(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    size_t handledLen = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_HandleRecvDataEx(conn->recvBuf, conn->recvLen, IPCS_SERVER, conn->fd, threadArg, &handledLen);
+    IPCS_ConnConsumeRecv(conn, handledLen);
+
+    if ((result == IPCS_CHECKSUM_FAIL) || (result == IPCS_FRAME_BAD)) {
+        return IPCS_ServerCorruptConn(threadArg, conn);
+    }
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server: %s client: %d handle recv data fail: %d", threadArg->name, conn->fd, result);
+        return result;
+    }
+
+    IPCS_ServerUpdateRecv(threadArg, conn);
+
+    return IPCS_OK;
+}
+
+/* 先处理新收到的高优先级帧，普通帧留到本轮所有连接的高优先级帧处理完之后 */
+int IPCS_ServerHandleConnHigh(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    int result = IPCS_OK;
+
+    result = IPCS_HandleHighPrioFrames(conn->recvBuf, conn->recvLen, IPCS_SERVER, conn->fd, threadArg);
+    if ((result == IPCS_CHECKSUM_FAIL) || (result == IPCS_FRAME_BAD)) {
+        return IPCS_ServerCorruptConn(threadArg, conn);
+    }
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server: %s client: %d handle high priority data fail: %d", threadArg->name, conn->fd,
+                result);
+        return result;
+    }
+
+    IPCS_ServerQueueRecv(threadArg, conn);
+
+    return IPCS_OK;
+}
+
+/**
+ * 帧的校验和不对或格式错误：之后的数据无法可靠地分帧，丢弃接收缓冲区中的数据，不再发送，
+ * 关闭socket的读写两端，由正常的关闭流程（读到对端关闭）释放连接；其他连接不受影响。
+ **/
+int IPCS_ServerCorruptConn(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    IPCS_WriteLog("Server: %s client: %d bad frame, close connection", threadArg->name, conn->fd);
+
+    IPCS_ConnConsumeRecv(conn, conn->recvLen);
+    conn->sendBroken = 1;
+    (void)shutdown(conn->fd, SHUT_RDWR);
+
+    return IPCS_OK;
+}
+
+void IPCS_ServerQueueRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    if (!conn->recvQueued) {
+        conn->recvQueued = 1;
+        conn->nextRecv = threadArg->recvList;
+        threadArg->recvList = conn;
+    }
+
+    return;
+}
+
+int IPCS_ServerHandleRecvList(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Conn *conn = NULL;
+    int result = IPCS_OK;
+
+    while (((conn = threadArg->recvList) != NULL) && !threadArg->stopping) {
+        threadArg->recvList = conn->nextRecv;
+        conn->nextRecv = NULL;
+        conn->recvQueued = 0;
+
+        result = IPCS_ServerHandleConnData(threadArg, conn);
+        if (result != IPCS_OK) {
+            return result;
+        }
+
+        /* io_uring引擎中接收已结束的连接等到数据处理完才关闭 */
+        if ((threadArg->ring != NULL) && !conn->recvActive) {
+            IPCS_UringServerMaybeClose(threadArg, conn);
+        }
+    }
+
+    return IPCS_OK;
+}
+
+/**
+ * 流量控制：连接的积压超过所属服务端的connCredit，或者超出进程的内存预算时暂停接收，
+ * 积压降到connCredit的一半以下并且没有超出预算后恢复。积压不超过一帧的连接不因内存预算
+ * 暂停：预算设得过小时一问一答的连接仍能收发，也不会每次调用都暂停、恢复一次。
+ * 已关闭的服务端的连接不再暂停，以便读到对端关闭。
+ **/
+void IPCS_ServerUpdateRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    size_t backlog = IPCS_ConnBacklog(conn);
+    size_t credit = conn->listener->attr.connCredit;
+    int overBudget = (backlog > IPCS_FRAME_MAX_LEN) && IPCS_MemOverBudget();
+
+    if (!conn->recvActive) {
+        return;
+    }
+
+    if (!conn->recvPaused) {
+        if (((backlog > credit) || overBudget) && (conn->listener->closeState == IPCS_LISTENER_OPEN)) {
+            IPCS_ServerPauseRecv(threadArg, conn, 1);
+        }
+    } else if ((backlog <= credit / 2) && !overBudget) {
+        IPCS_ServerPauseRecv(threadArg, conn, 0);
+    }
+
+    return;
+}
+
+/**
+ * epoll引擎：不再关注EPOLLIN；io_uring引擎：取消multishot recv，已完成的数据照常处理，
+ * 取消完成后恢复时重新提交。
+ **/
+void IPCS_ServerPauseRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, int pause)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    if (conn->recvPaused == pause) {
+        return;
+    }
+
+    if (threadArg->ring != NULL) {
+        conn->recvPaused = pause;
+        if (pause && conn->recvArmed && ((sqe = IPCS_UringGetSqe(threadArg->ring)) != NULL)) {
+            IPCS_UringPrepCancel(sqe, IPCS_URING_USER_DATA(conn->fd, IPCS_URING_OP_RECV),
+                    IPCS_URING_USER_DATA(conn->fd, IPCS_URING_OP_RECV_CANCEL));
+        } else if (!pause) {
+            (void)IPCS_UringServerArmRecv(threadArg, conn);
+        }
+    } else if (IPCS_ServerSetEvents(threadArg, conn, pause, conn->outWatch) != IPCS_OK) {
+        return;
+    }
+
+    if (pause) {
+        threadArg->pausedNum++;
+        IPCS_STAT_ADD(conn->listener->stats.recvPauses, 1);
+    } else {
+        threadArg->pausedNum--;
+    }
+
+    return;
+}
+
+void IPCS_ServerMaintain(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Conn *conn = NULL;
+    uint64_t nowNs = 0;
+    unsigned int i = 0;
+    int pending = 0;
+
+    if ((threadArg->pausedNum == 0) && !threadArg->trimPending) {
+        return;
+    }
+
+    nowNs = IPCS_GetNowNs();
+
+    /* 因内存预算暂停的连接在其他连接释放内存后恢复 */
+    if ((threadArg->pausedNum != 0) && (nowNs >= threadArg->resumeScanNs)) {
+        threadArg->resumeScanNs = nowNs + IPCS_RESUME_SCAN_NS;
+        for (i = 0; (i < threadArg->conns.cap) && (threadArg->pausedNum != 0); i++) {
+            conn = threadArg->conns.conns[i];
+            if ((conn != NULL) && conn->recvPaused) {
+                IPCS_ServerUpdateRecv(threadArg, conn);
+            }
+        }
+    }
+
+    /* 一个检查间隔内没有收到数据的连接收缩缓冲区，还有连接没有收缩时继续检查 */
+    if (threadArg->trimPending && (nowNs >= threadArg->trimSweepNs)) {
+        threadArg->trimSweepNs = nowNs + IPCS_TRIM_SWEEP_NS;
+        for (i = 0; i < threadArg->conns.cap; i++) {
+            conn = threadArg->conns.conns[i];
+            if (conn == NULL) {
+                continue;
+            }
+            if (conn->active) {
+                conn->active = 0;
+                pending = 1;
+            } else if (IPCS_ConnTrim(conn)) {
+                pending = 1;
+            }
+        }
+        threadArg->trimPending = pending;
+    }
+
+    return;
+}
+
+uint64_t IPCS_ServerNextTimer(IPCS_ServerThreadArg *threadArg)
+{
+    uint64_t nowNs = 0;
+    uint64_t nextNs = 0;
+    uint64_t timerNs = 0;
+
+    if ((threadArg->pausedNum == 0) && !threadArg->trimPending && (threadArg->timers.wheel.count == 0)) {
+        return 0;
+    }
+
+    nowNs = IPCS_GetNowNs();
+    timerNs = IPCS_ServerTimersNextNs(&threadArg->timers, nowNs);
+    if ((threadArg->pausedNum == 0) && !threadArg->trimPending) {
+        return timerNs;
+    }
+
+    if (threadArg->trimPending) {
+        if (threadArg->trimSweepNs == 0) {
+            threadArg->trimSweepNs = nowNs + IPCS_TRIM_SWEEP_NS;
+        }
+        nextNs = threadArg->trimSweepNs;
+    }
+    if ((threadArg->pausedNum != 0) && ((nextNs == 0) || (threadArg->resumeScanNs < nextNs))) {
+        if (threadArg->resumeScanNs == 0) {
+            threadArg->resumeScanNs = nowNs + IPCS_RESUME_SCAN_NS;
+        }
+        nextNs = threadArg->resumeScanNs;
+    }
+
+    /* 已到时间时不阻塞（至少1ns，0表示不定时） */
+    nextNs = (nextNs > nowNs) ? (nextNs - nowNs) : 1;
+
+    return ((timerNs != 0) && (timerNs < nextNs)) ? timerNs : nextNs;
+}
+
+/******************************************************************************/
+/**
+ * io_uring引擎：监听fd上一个multishot accept，每个连接一个multishot recv（数据放在provided
+ * buffer ring中，拷贝到连接的接收缓冲区后立即归还），wakeFd上一个multishot poll。
+ * 回调函数中的响应追加到连接的pendBuf，一轮完成事件处理完后统一生成send请求，
+ * 和下一次等待合并为一次io_uring_enter。
+ **/
+int IPCS_CreateServerUring(IPCS_ServerThreadArg *threadArg)
+{
+    int result = IPCS_OK;
+
+    threadArg->ring = (IPCS_Uring *)malloc(sizeof(IPCS_Uring));
+    if (threadArg->ring == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    result = IPCS_UringInit(threadArg->ring, IPCS_URING_ENTRIES);
+    if (result != IPCS_OK) {
+        free(threadArg->ring);
+        threadArg->ring = NULL;
+        return result;
+    }
+
+    result = IPCS_UringBufRingInit(threadArg->ring, &threadArg->bufRing, IPCS_URING_BGID,
+            IPCS_URING_BUF_NUM, IPCS_URING_BUF_LEN);
+    if (result != IPCS_OK) {
+        IPCS_UringExit(threadArg->ring);
+        free(threadArg->ring);
+        threadArg->ring = NULL;
+        return result;
+    }
+
+    return IPCS_OK;
+}
+
+void IPCS_DestroyServerUring(IPCS_ServerThreadArg *threadArg)
+{
+    if (threadArg->ring == NULL) {
+        return;
+    }
+
+    IPCS_UringExit(threadArg->ring);
+    IPCS_UringBufRingExit(&threadArg->bufRing);
+    free(threadArg->ring);
+    threadArg->ring = NULL;
+
+    return;
+}
+
+/**
+ * 退出前取消监听fd上的multishot accept并等待取消完成：ring关闭后内核异步释放请求，
+ * 请求持有的监听socket会晚于close释放，同名服务端立即重新创建时bind失败。
+ **/
+void IPCS_UringServerCancelAccepts(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerListener *listener = NULL;
+    struct io_uring_sqe *sqe = NULL;
+    struct io_uring_cqe *cqe = NULL;
+    unsigned int cancelNum = 0;
+    unsigned int tries = 0;
+
+    if (threadArg->ring == NULL) {
+        return;
+    }
+
+    for (listener = threadArg->listeners; listener != NULL; listener = listener->next) {
+        if ((listener->listenFd < 0) || ((sqe = IPCS_UringGetSqe(threadArg->ring)) == NULL)) {
+            continue;
+        }
+        IPCS_UringPrepCancel(sqe, IPCS_URING_USER_DATA(listener->listenFd, IPCS_URING_OP_ACCEPT),
+                IPCS_URING_USER_DATA(listener->listenFd, IPCS_URING_OP_CANCEL));
+        cancelNum++;
+    }
+
+    for (tries = 0; (cancelNum != 0) && (tries < IPCS_URING_CANCEL_TRIES); tries++) {
+        if (IPCS_UringSubmitAndWait(threadArg->ring, 1, IPCS_URING_CANCEL_WAIT_NS) != IPCS_OK) {
+            break;
+        }
+        while ((cqe = IPCS_UringPeekCqe(threadArg->ring)) != NULL) {
+            if ((IPCS_URING_USER_OP(cqe->user_data) == IPCS_URING_OP_CANCEL) && (cancelNum != 0)) {
+                cancelNum--;
+            }
+            IPCS_UringCqAdvance(threadArg->ring, 1);
+        }
+    }
+
+    return;
+}
+
+int IPCS_HandleServerUringEvents(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Uring *ring = threadArg->ring;
+    struct io_uring_cqe *cqe = NULL;
+    uint64_t userData = 0;
+    unsigned int flags = 0;
+    unsigned int ready = 0;
+    int res = 0;
+    int result = IPCS_OK;
+
+    /* 监听fd上的accept在打开服务端时提交 */
+    result = IPCS_UringServerArm(threadArg, threadArg->wakeFd, IPCS_URING_OP_WAKE);
+
+    while ((result == IPCS_OK) && !threadArg->stopping) {
+        IPCS_UringServerFlush(threadArg);
+
+        result = IPCS_UringServerWait(threadArg);
+        if (result != IPCS_OK) {
+            break;
+        }
+
+        /* 只处理本轮已有的完成事件：发布线程持续唤醒时multishot poll不断产生新事件，
+         * 不限制个数会一直处理不到发送 */
+        ready = IPCS_UringCqReady(ring);
+        while ((ready-- != 0) && ((cqe = IPCS_UringPeekCqe(ring)) != NULL) && !threadArg->stopping) {
+            userData = cqe->user_data;
+            res = cqe->res;
+            flags = cqe->flags;
+            IPCS_UringCqAdvance(ring, 1);
+
+            result = IPCS_UringServerHandleCqe(threadArg, userData, res, flags);
+            if (result != IPCS_OK) {
+                break;
+            }
+        }
+
+        if (result == IPCS_OK) {
+            result = IPCS_ServerHandleRecvList(threadArg);
+        }
+
+        IPCS_ServerRunTimers(threadArg);
+        IPCS_ServerMaintain(threadArg);
+    }
+
+    return result;
+}
+
+/* 完成队列在共享内存中，忙等时只在内核提示有待处理的task work时进入内核 */
+int IPCS_UringServerWait(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Uring *ring = threadArg->ring;
+    IPCS_BusyPoll *busyPoll = &threadArg->busyPoll;
+    uint64_t budgetNs = IPCS_BusyPollBudget(busyPoll);
+    uint64_t timerNs = IPCS_ServerNextTimer(threadArg);
+    uint64_t enterCalls = ring->enterCalls;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int result = IPCS_OK;
+
+    if (busyPoll->spinNs != 0) {
+        startNs = IPCS_GetNowNs();
+    }
+
+    if ((budgetNs != 0) && (IPCS_UringCqReady(ring) == 0)) {
+        /* 先提交本轮的发送和重新提交的接收，再忙等 */
+        result = IPCS_UringSubmitAndWait(ring, 0, 0);
+        endNs = startNs + budgetNs;
+        while ((result == IPCS_OK) && (IPCS_UringCqReady(ring) == 0) && !threadArg->stopping &&
+               (IPCS_GetNowNs() < endNs)) {
+            result = IPCS_UringReapNoWait(ring);
+        }
+
+        if (IPCS_UringCqReady(ring) != 0) {
+            IPCS_STAT_ADD(threadArg->stats.spinHits, 1);
+        }
+    }
+
+    if (result == IPCS_OK) {
+        result = IPCS_UringSubmitAndWait(ring, 1, timerNs);
+    }
+    IPCS_STAT_ADD(threadArg->stats.syscalls, ring->enterCalls - enterCalls);
+    IPCS_STAT_ADD(threadArg->stats.wakeups, 1);
+
+    if ((busyPoll->spinNs != 0) && (result == IPCS_OK) && (IPCS_UringCqReady(ring) != 0)) {
+        IPCS_BusyPollRecord(busyPoll, budgetNs, IPCS_GetNowNs() - startNs);
+    }
+
+    return result;
+}
+
+int IPCS_UringServerHandleCqe(IPCS_ServerThreadArg *threadArg, uint64_t userData, int res, unsigned int flags)
+{
+    int fd = IPCS_URING_USER_FD(userData);
+    uint64_t wakeValue = 0;
+    int result = IPCS_OK;
+
+    switch (IPCS_URING_USER_OP(userData)) {
+        case IPCS_URING_OP_ACCEPT:
+            result = IPCS_UringServerAccept(threadArg, fd, res, flags);
+            break;
+        case IPCS_URING_OP_RECV:
+            result = IPCS_UringServerRecv(threadArg, fd, res, flags);
+            break;
+        case IPCS_URING_OP_SEND:
+            IPCS_UringServerSendDone(threadArg, fd, res);
+            break;
+        case IPCS_URING_OP_WAKE:
+            (void)read(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+            IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+            IPCS_ServerDrainPubInbox(threadArg);
+            IPCS_ServerRunTasks(threadArg);
+            IPCS_ServerHandleListenerChanges(threadArg);
+            if (!(flags & IORING_CQE_F_MORE)) {
+                result = IPCS_UringServerArm(threadArg, threadArg->wakeFd, IPCS_URING_OP_WAKE);
+            }
+            break;
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/* 已销毁的服务端：关闭新连接，accept结束（被取消）后关闭监听fd */
+int IPCS_UringServerAccept(IPCS_ServerThreadArg *threadArg, int listenFd, int res, unsigned int flags)
+{
+    IPCS_ServerListener *listener = IPCS_ServerFindListener(threadArg, listenFd);
+    IPCS_Conn *conn = NULL;
+    int result = IPCS_OK;
+
+    if ((listener == NULL) || (listener->closeState != IPCS_LISTENER_OPEN)) {
+        if (res >= 0) {
+            (void)close(res);
+        }
+        if ((listener != NULL) && !(flags & IORING_CQE_F_MORE)) {
+            (void)close(listener->listenFd);
+            listener->listenFd = -1;
+            IPCS_ServerReleaseListener(threadArg, listener);
+        }
+        return IPCS_OK;
+    }
+
+    if (res >= 0) {
+        conn = IPCS_ConnTableAdd(&threadArg->conns, res);
+        if (conn == NULL) {
+            (void)close(res);
+            IPCS_WriteLog("Server: %s add client %d fail.", listener->name, res);
+        } else {
+            conn->listener = listener;
+            listener->connNum++;
+            IPCS_WriteLog("Server: %s accept client %d success.", listener->name, res);
+            result = IPCS_UringServerArmRecv(threadArg, conn);
+        }
+    }
+    if (!(flags & IORING_CQE_F_MORE) && (result == IPCS_OK)) {
+        result = IPCS_UringServerArmAccept(threadArg, listener);
+    }
+
+    return result;
+}
+
+int IPCS_UringServerArm(IPCS_ServerThreadArg *threadArg, int fd, unsigned int op)
+{
+    struct io_uring_sqe *sqe = IPCS_UringGetSqe(threadArg->ring);
+
+    if (sqe == NULL) {
+        IPCS_WriteLog("Server: %s get sqe fail.", threadArg->name);
+        return IPCS_URING_FAIL;
+    }
+
+    switch (op) {
+        case IPCS_URING_OP_ACCEPT:
+            IPCS_UringPrepAcceptMulti(sqe, fd, IPCS_URING_USER_DATA(fd, op));
+            break;
+        case IPCS_URING_OP_RECV:
+            IPCS_UringPrepRecvMulti(sqe, fd, IPCS_URING_BGID, IPCS_URING_USER_DATA(fd, op));
+            break;
+        case IPCS_URING_OP_WAKE:
+            IPCS_UringPrepPollMulti(sqe, fd, POLLIN, IPCS_URING_USER_DATA(fd, op));
+            break;
+        default:
+            return IPCS_UNREACHABLE;
+    }
+
+    return IPCS_OK;
+}
+
+/* 多进程共用的监听fd每次只accept一个连接，重新提交后排到等待队列末尾，连接轮流分给工作进程 */
+int IPCS_UringServerArmAccept(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener)
+{
+    struct io_uring_sqe *sqe = NULL;
+
+    if (!listener->shared) {
+        return IPCS_UringServerArm(threadArg, listener->listenFd, IPCS_URING_OP_ACCEPT);
+    }
+
+    sqe = IPCS_UringGetSqe(threadArg->ring);
+    if (sqe == NULL) {
+        IPCS_WriteLog("Server: %s get sqe fail.", threadArg->name);
+        return IPCS_URING_FAIL;
+    }
+    IPCS_UringPrepAccept(sqe, listener->listenFd, IPCS_URING_USER_DATA(listener->listenFd, IPCS_URING_OP_ACCEPT));
+
+    return IPCS_OK;
+}
+
+int IPCS_UringServerArmRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    int result = IPCS_OK;
+
+    if (conn->recvPaused || conn->recvArmed || !conn->recvActive) {
+        return IPCS_OK;
+    }
+
+    result = IPCS_UringServerArm(threadArg, conn->fd, IPCS_URING_OP_RECV);
+    if (result == IPCS_OK) {
+        conn->recvArmed = 1;
+    }
+
+    return result;
+}
+
+int IPCS_UringServerRecv(IPCS_ServerThreadArg *threadArg, int fd, int res, unsigned int flags)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, fd);
+    unsigned int bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    int result = IPCS_OK;
+
+    if ((conn != NULL) && !(flags & IORING_CQE_F_MORE)) {
+        conn->recvArmed = 0;
+    }
+
+    if (res > 0) {
+        /* 接收缓冲区放不下时先扩大；已到上限时先处理本轮还没处理的普通帧，处理后剩余的
+         * 不完整帧小于一帧，总能放下一个provided buffer */
+        if ((conn != NULL) && (IPCS_ConnReserveRecv(conn, (size_t)res) != IPCS_OK)) {
+            result = IPCS_ServerHandleConnData(threadArg, conn);
+            if (result == IPCS_OK) {
+                result = IPCS_ConnReserveRecv(conn, (size_t)res);
+            }
+        }
+        if ((conn != NULL) && (result == IPCS_OK)) {
+            (void)memcpy(conn->recvBuf + conn->recvLen, IPCS_UringBufRingGet(&threadArg->bufRing, bid), (size_t)res);
+            conn->recvLen += (size_t)res;
+            conn->active = 1;
+            threadArg->trimPending = 1;
+        }
+        IPCS_UringBufRingRecycle(&threadArg->bufRing, bid);
+
+        if ((conn == NULL) || (result != IPCS_OK)) {
+            return result;
+        }
+
+        result = IPCS_ServerHandleConnHigh(threadArg, conn);
+        if (result == IPCS_OK) {
+            result = IPCS_UringServerArmRecv(threadArg, conn);
+        }
+
+        return result;
+    }
+
+    if (conn == NULL) {
+        return IPCS_OK;
+    }
+
+    if ((res == -ENOBUFS) || (res == -ECANCELED)) {
+        /* provided buffer暂时用完，或者暂停接收时被取消：没有暂停时重新提交recv */
+        return IPCS_UringServerArmRecv(threadArg, conn);
+    }
+
+    /* 对端关闭或出错，待发送的数据发完后关闭连接 */
+    conn->recvActive = 0;
+    IPCS_UringServerMaybeClose(threadArg, conn);
+
+    return IPCS_OK;
+}
+
+
+void IPCS_UringServerSendDone(IPCS_ServerThreadArg *threadArg, int fd, int res)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, fd);
+
+    if (conn == NULL) {
+        return;
+    }
+
+    conn->sendInFlight = 0;
+
+    if (res < 0) {
+        IPCS_WriteLog("Server: %s send to client %d fail: %d", threadArg->name, fd, res);
+        conn->sendBroken = 1;
+        conn->sendLen = 0;
+        conn->sendOff = 0;
+        conn->pendLen = 0;
+        conn->sendFromQueue = 0;
+        IPCS_ConnClearOut(conn);
+        IPCS_ServerUpdateRecv(threadArg, conn);
+        IPCS_UringServerMaybeClose(threadArg, conn);
+        return;
+    }
+
+    if (conn->sendFromQueue != 0) {
+        conn->sendFromQueue = 0;
+        IPCS_ConnAdvanceOut(conn, (size_t)res);
+    } else {
+        conn->sendOff += (size_t)res;
+        if (conn->sendOff >= conn->sendLen) {
+            conn->sendLen = 0;
+            conn->sendOff = 0;
+        }
+    }
+    IPCS_ServerUpdateRecv(threadArg, conn);
+
+    /* 部分发送的剩余部分和新的数据在下一轮统一提交 */
+    if ((conn->sendOff < conn->sendLen) || (conn->pendLen != 0) || (conn->outHead != NULL)) {
+        IPCS_ServerKickConn(threadArg, conn);
+        return;
+    }
+
+    IPCS_UringServerMaybeClose(threadArg, conn);
+
+    return;
+}
+
+/* 在服务端线程的回调函数中调用：响应追加到pendBuf，本轮事件处理完后统一发送 */
+int IPCS_UringServerQueueSend(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_Message *msg,
+        unsigned int callId, IPCS_Priority prio)
+{
+    unsigned int frameLen = IPCS_MSG_HEADER_LEN + IPCS_FRAME_EXT_MAX_LEN + (msg->msgLen & IPCS_MSG_LEN_MASK);
+    int result = IPCS_OK;
+
+    if (conn->sendBroken) {
+        return IPCS_WRITE_FAIL;
+    }
+
+    /* 发送队列中有发布消息时，响应排在其后；高优先级的响应经发送队列先于pendBuf发送 */
+    if ((conn->outHead != NULL) || ((prio == IPCS_PRIO_HIGH) && (conn->pendLen != 0))) {
+        return IPCS_ServerQueueMessage(threadArg, conn, msg, callId, prio);
+    }
+
+    result = IPCS_ConnReservePend(conn, frameLen);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    result = IPCS_MsgToStreamFlags(msg, callId, prio, 0, conn->frameFlags, conn->pendBuf + conn->pendLen, &frameLen);
+    if (result != IPCS_OK) {
+        return result;
+    }
+    conn->pendLen += frameLen;
+
+    IPCS_CaptureFrame(IPCS_CAPTURE_TX, IPCS_SERVER, conn->fd, msg);
+
+    IPCS_ServerKickConn(threadArg, conn);
+
+    return IPCS_OK;
+}
+
+/**
+ * 选择下一段要发送的数据：先发完部分发送的sendBuf，再发队首的高优先级帧，然后是pendBuf，
+ * 最后是发送队列（多个共享帧用一个sendmsg发送）。pendBuf只在队列为空时追加，
+ * 所以普通帧的顺序不变。返回1表示已提交发送，0表示没有数据，-1表示提交队列已满。
+ **/
+int IPCS_UringServerPrepSend(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    struct io_uring_sqe *sqe = NULL;
+    uint64_t userData = IPCS_URING_USER_DATA(conn->fd, IPCS_URING_OP_SEND);
+
+    if (conn->sendBroken || conn->sendInFlight) {
+        return 0;
+    }
+
+    if ((conn->sendOff >= conn->sendLen) && (conn->pendLen == 0) && (conn->outHead == NULL)) {
+        return 0;
+    }
+
+    sqe = IPCS_UringGetSqe(threadArg->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    if ((conn->sendOff >= conn->sendLen) && (conn->outHead != NULL) &&
+        ((conn->pendLen == 0) || conn->outHead->isHigh)) {
+        conn->sendFromQueue = IPCS_ConnFillOutIov(conn, conn->sendIov, IPCS_CONN_SEND_IOV, conn->pendLen != 0);
+        (void)memset(&conn->sendHdr, 0, sizeof(conn->sendHdr));
+        conn->sendHdr.msg_iov = conn->sendIov;
+        conn->sendHdr.msg_iovlen = conn->sendFromQueue;
+        IPCS_UringPrepSendMsg(sqe, conn->fd, &conn->sendHdr, userData);
+    } else {
+        if (conn->sendOff >= conn->sendLen) {
+            (void)IPCS_ConnSwapPend(conn);
+        }
+        IPCS_UringPrepSend(sqe, conn->fd, conn->sendBuf + conn->sendOff, conn->sendLen - conn->sendOff, userData);
+    }
+    conn->sendInFlight = 1;
+
+    return 1;
+}
+
+void IPCS_UringServerFlush(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Conn *conn = NULL;
+    int result = 0;
+
+    while ((conn = threadArg->flushList) != NULL) {
+        result = IPCS_UringServerPrepSend(threadArg, conn);
+        if (result < 0) {
+            /* 提交队列满，留在列表中下一轮再发送 */
+            return;
+        }
+
+        threadArg->flushList = conn->nextFlush;
+        conn->nextFlush = NULL;
+        conn->flushQueued = 0;
+
+        if (result == 0) {
+            IPCS_UringServerMaybeClose(threadArg, conn);
+        }
+    }
+
+    return;
+}
+
+/* 接收已结束、没有正在发送和待发送的数据时关闭连接 */
+void IPCS_UringServerMaybeClose(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    if (conn->recvActive || conn->recvQueued || conn->sendInFlight || conn->flushQueued) {
+        return;
+    }
+
+    if (((conn->pendLen != 0) || (conn->outHead != NULL) || (conn->sendOff < conn->sendLen)) &&
+        !conn->sendBroken) {
+        return;
+    }
+
+    (void)IPCS_ServerCloseClient(threadArg, conn->fd);
+
+    return;
+}
+
+/******************************************************************************/
+/**
+ * 发布订阅：客户端通过控制帧订阅主题（消息类型），订阅关系保存在服务端线程的连接上。
+ * 发布时消息只编码一次，共享帧按引用计数挂到每个订阅者的发送队列上；其他线程发布时
+ * 先放入pubInbox，再通过wakeFd通知服务端线程分发。
+ **/
+int IPCS_ServerPublish(const char *serverName, IPCS_Message *msg)
+{
+    IPCS_ServerThreadArg *threadArg = NULL;
+    IPCS_ServerListener *listener = NULL;
+    IPCS_SharedFrame *frame = NULL;
+    IPCS_PubItem *node = NULL;
+    uint64_t wakeValue = 1;
+    int wake = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckMessage(msg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server: %s publish with bad msg: %d", (serverName != NULL) ? serverName : "", result);
+        return result;
+    }
+
+    /* 固定服务端，发布期间并发销毁服务端不会释放服务端和服务端线程 */
+    result = IPCS_ServerPinListener(serverName, &listener);
+    if (result != IPCS_OK) {
+        return result;
+    }
+    threadArg = listener->reactor;
+
+    frame = IPCS_SharedFrameNew(msg, IPCS_NO_CALL_ID, IPCS_PRIO_NORMAL, 0);
+    if (frame == NULL) {
+        IPCS_WriteLog("Server: %s publish: encode fail.", serverName);
+        IPCS_ServerUnpinListener(listener);
+        return IPCS_MALLOC_FAIL;
+    }
+
+    /* 在服务端线程中（例如回调函数中）直接分发 */
+    if (g_IpcsCurServer == threadArg) {
+        IPCS_ServerFanOut(threadArg, listener, frame);
+        IPCS_SharedFrameUnref(frame);
+        IPCS_ServerUnpinListener(listener);
+        return IPCS_OK;
+    }
+
+    node = (IPCS_PubItem *)malloc(sizeof(IPCS_PubItem));
+    if (node == NULL) {
+        IPCS_SharedFrameUnref(frame);
+        IPCS_ServerUnpinListener(listener);
+        return IPCS_MALLOC_FAIL;
+    }
+    node->frame = frame;
+    node->listener = listener;
+    node->next = NULL;
+
+    /* 收件箱满时等待服务端线程分发，发布者不会无限积压内存 */
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    while ((threadArg->pubInboxNum >= IPCS_PUB_INBOX_MAX) && !threadArg->stopping && !threadArg->exited) {
+        (void)pthread_cond_wait(&threadArg->pubCond, &threadArg->mutex);
+    }
+
+    /* 服务端已销毁时不再放入收件箱，服务端线程关闭服务端后收件箱中不会再引用它 */
+    if (threadArg->stopping || threadArg->exited || listener->closing) {
+        result = IPCS_NOT_FOUND;
+    } else {
+        /* 收件箱从空变为非空时才需要唤醒服务端线程 */
+        wake = (threadArg->pubInboxNum == 0);
+        if (threadArg->pubInboxTail == NULL) {
+            threadArg->pubInbox = node;
+        } else {
+            threadArg->pubInboxTail->next = node;
+        }
+        threadArg->pubInboxTail = node;
+        threadArg->pubInboxNum++;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (result != IPCS_OK) {
+        IPCS_SharedFrameUnref(frame);
+        free(node);
+    } else if (wake) {
+        (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    }
+    IPCS_ServerUnpinListener(listener);
+
+    return result;
+}
+
+void IPCS_ServerDrainPubInbox(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_PubItem *list = NULL;
+    IPCS_PubItem *node = NULL;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    list = threadArg->pubInbox;
+    threadArg->pubInbox = NULL;
+    threadArg->pubInboxTail = NULL;
+    threadArg->pubInboxNum = 0;
+    (void)pthread_cond_broadcast(&threadArg->pubCond);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    while ((node = list) != NULL) {
+        list = node->next;
+        IPCS_ServerFanOut(threadArg, node->listener, node->frame);
+        IPCS_SharedFrameUnref(node->frame);
+        free(node);
+    }
+
+    return;
+}
+
+/* 只发给同一个服务端的订阅者 */
+void IPCS_ServerFanOut(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener, IPCS_SharedFrame *frame)
+{
+    IPCS_SharedFrame *encoded[IPCS_FRAME_OPTIONS_NUM] = { NULL };
+    IPCS_Conn *conn = NULL;
+    unsigned int option = 0;
+    unsigned int i = 0;
+
+    for (i = 0; i < threadArg->conns.cap; i++) {
+        conn = threadArg->conns.conns[i];
+        if ((conn == NULL) || (conn->listener != listener) || (conn->topicNum == 0) ||
+            !IPCS_ConnHasTopic(conn, frame->topic)) {
+            continue;
+        }
+
+        /* 帧选项相同的订阅者共用一份按选项编码的帧，第一次需要时生成；生成失败时发不带选项的帧 */
+        option = IPCS_FRAME_OPTIONS_INDEX(conn->frameFlags);
+        if ((option != 0) && (encoded[option] == NULL)) {
+            encoded[option] = IPCS_SharedFrameWithFlags(frame, conn->frameFlags);
+        }
+        (void)IPCS_ServerQueueFrame(threadArg, conn, (encoded[option] != NULL) ? encoded[option] : frame, 1);
+    }
+
+    for (option = 0; option < IPCS_FRAME_OPTIONS_NUM; option++) {
+        if (encoded[option] != NULL) {
+            IPCS_SharedFrameUnref(encoded[option]);
+        }
+    }
+
+    IPCS_STAT_ADD(listener->stats.publishes, 1);
+
+    return;
+}
+
+/* 发布消息在订阅者积压或超出内存预算时按所属服务端的策略合并或丢弃；响应不受限制 */
+int IPCS_ServerQueueFrame(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_SharedFrame *frame, int isPub)
+{
+    int result = IPCS_OK;
+
+    if (conn->sendBroken) {
+        return IPCS_WRITE_FAIL;
+    }
+
+    if (isPub && ((conn->outPubNum >= conn->listener->attr.pubQueueLen) || IPCS_MemOverBudget())) {
+        if (conn->listener->attr.pubPolicy == IPCS_PUB_CONFLATE) {
+            (void)IPCS_ConnConflateOut(conn, frame);
+        }
+        IPCS_STAT_ADD(conn->listener->stats.pubDrops, 1);
+        return IPCS_OK;
+    }
+
+    result = IPCS_ConnPushOut(conn, frame, isPub);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    IPCS_ServerKickConn(threadArg, conn);
+
+    return IPCS_OK;
+}
+
+/* 响应编码为共享帧后排在发送队列中 */
+int IPCS_ServerQueueMessage(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_Message *msg,
+        unsigned int callId, IPCS_Priority prio)
+{
+    IPCS_SharedFrame *frame = NULL;
+    int result = IPCS_OK;
+
+    frame = IPCS_SharedFrameNew(msg, callId, prio, conn->frameFlags);
+    if (frame == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    result = IPCS_ServerQueueFrame(threadArg, conn, frame, 0);
+    IPCS_SharedFrameUnref(frame);
+
+    if (result == IPCS_OK) {
+        IPCS_CaptureFrame(IPCS_CAPTURE_TX, IPCS_SERVER, conn->fd, msg);
+    }
+
+    return result;
+}
+
+/**
+ * epoll引擎：发送队列为空时不阻塞地直接发送，发不完的部分排入发送队列等EPOLLOUT，
+ * 不读响应的客户端不会阻塞服务端线程，积压计入连接的流量控制。
+ **/
+int IPCS_ServerSendNow(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_Message *msg,
+        unsigned int callId, IPCS_Priority prio)
+{
+    IPCS_SharedFrame *frame = NULL;
+    ssize_t sendLen = 0;
+    int result = IPCS_OK;
+
+    if (conn->sendBroken) {
+        return IPCS_WRITE_FAIL;
+    }
+
+    frame = IPCS_SharedFrameNew(msg, callId, prio, conn->frameFlags);
+    if (frame == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    do {
+        sendLen = send(conn->fd, frame->data, frame->len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+    } while ((sendLen < 0) && (errno == EINTR));
+
+    if ((sendLen < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        IPCS_WriteLog("Server: %s send to client %d fail, errno: %d", threadArg->name, conn->fd, errno);
+        conn->sendBroken = 1;
+        IPCS_SharedFrameUnref(frame);
+        return IPCS_WRITE_FAIL;
+    }
+    if (sendLen < 0) {
+        sendLen = 0;
+    }
+
+    if ((size_t)sendLen < frame->len) {
+        result = IPCS_ConnPushOut(conn, frame, 0);
+        if (result == IPCS_OK) {
+            conn->outOff = (size_t)sendLen;
+            IPCS_ServerWatchOut(threadArg, conn, 1);
+        } else if (sendLen != 0) {
+            /* 已发出半帧，后续数据无法对齐 */
+            conn->sendBroken = 1;
+        }
+    }
+    IPCS_SharedFrameUnref(frame);
+
+    if (result == IPCS_OK) {
+        IPCS_CaptureFrame(IPCS_CAPTURE_TX, IPCS_SERVER, conn->fd, msg);
+    }
+
+    return result;
+}
+
+/* 加入待发送列表，本轮事件处理完后统一发送，同一连接上的多条消息合并发送 */
+void IPCS_ServerKickConn(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    if (!conn->flushQueued) {
+        conn->flushQueued = 1;
+        conn->nextFlush = threadArg->flushList;
+        threadArg->flushList = conn;
+    }
+
+    return;
+}
+
+/* epoll引擎：发送待发送列表中各连接的队列 */
+void IPCS_ServerFlushOutList(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_Conn *conn = NULL;
+
+    while ((conn = threadArg->flushList) != NULL) {
+        threadArg->flushList = conn->nextFlush;
+        conn->nextFlush = NULL;
+        conn->flushQueued = 0;
+        IPCS_ServerFlushOut(threadArg, conn);
+    }
+
+    return;
+}
+
+/* epoll引擎：发送队列写到socket满为止，剩余部分等EPOLLOUT */
+void IPCS_ServerFlushOut(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn)
+{
+    struct msghdr sendHdr;
+    ssize_t sendLen = 0;
+
+    if (conn == NULL) {
+        return;
+    }
+
+    while (conn->outHead != NULL) {
+        (void)memset(&sendHdr, 0, sizeof(sendHdr));
+        sendHdr.msg_iov = conn->sendIov;
+        sendHdr.msg_iovlen = IPCS_ConnFillOutIov(conn, conn->sendIov, IPCS_CONN_SEND_IOV, 0);
+        sendLen = sendmsg(conn->fd, &sendHdr, MSG_DONTWAIT | MSG_NOSIGNAL);
+        IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+        if (sendLen < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                IPCS_ServerWatchOut(threadArg, conn, 1);
+                IPCS_ServerUpdateRecv(threadArg, conn);
+                return;
+            }
+
+            /* 连接已断开，丢弃待发送的数据，由接收侧关闭连接 */
+            IPCS_WriteLog("Server: %s send to client %d fail, errno: %d", threadArg->name, conn->fd, errno);
+            conn->sendBroken = 1;
+            IPCS_ConnClearOut(conn);
+            break;
+        }
+
+        IPCS_ConnAdvanceOut(conn, (size_t)sendLen);
+    }
+
+    IPCS_ServerWatchOut(threadArg, conn, 0);
+    IPCS_ServerUpdateRecv(threadArg, conn);
+
+    return;
+}
+
+void IPCS_ServerWatchOut(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, int watch)
+{
+    if ((conn->outWatch == watch) || (threadArg->epollFd < 0)) {
+        return;
+    }
+
+    (void)IPCS_ServerSetEvents(threadArg, conn, conn->recvPaused, watch);
+
+    return;
+}
+
+/* epoll引擎：按是否暂停接收、是否等待可写修改连接fd关注的事件，成功后记录状态 */
+int IPCS_ServerSetEvents(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, int recvPaused, int outWatch)
+{
+    struct epoll_event epollEvent;
+    int result = 0;
+
+    epollEvent.events = (recvPaused ? 0 : (EPOLLIN | EPOLLRDHUP)) | (outWatch ? EPOLLOUT : 0);
+    epollEvent.data.fd = conn->fd;
+    result = epoll_ctl(threadArg->epollFd, EPOLL_CTL_MOD, conn->fd, &epollEvent);
+    IPCS_STAT_ADD(threadArg->stats.syscalls, 1);
+    if (result != 0) {
+        IPCS_WriteLog("Ctl server: %s epoll: %d mod %d fail: %d, errno: %d", threadArg->name, threadArg->epollFd,
+                conn->fd, result, errno);
+        return IPCS_EPOLL_CTL_FAIL;
+    }
+
+    conn->recvPaused = recvPaused;
+    conn->outWatch = outWatch;
+
+    return IPCS_OK;
+}
+
+/* 控制帧：订阅、取消订阅，负载为4字节的主题 */
+int IPCS_ServerHandleControl(IPCS_ServerThreadArg *threadArg, int fd, IPCS_Message *msg)
+{
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, fd);
+    IPCS_SharedFrame *frame = NULL;
+    unsigned int reply[3];
+    unsigned int topic = 0;
+    int result = IPCS_OK;
+
+    if ((conn == NULL) || (msg->msgLen < sizeof(topic))) {
+        return IPCS_OK;
+    }
+    (void)memcpy(&topic, msg->msgValue, sizeof(topic));
+
+    switch (msg->msgType) {
+        case IPCS_CTRL_SUBSCRIBE:
+            result = IPCS_ConnAddTopic(conn, topic);
+            if (result != IPCS_OK) {
+                IPCS_WriteLog("Server: %s client %d subscribe %u fail: %d", threadArg->name, fd, topic, result);
+            }
+            break;
+        case IPCS_CTRL_UNSUBSCRIBE:
+            IPCS_ConnDelTopic(conn, topic);
+            break;
+        case IPCS_CTRL_OPTIONS:
+            /* 打开服务端同意的选项，回复协商结果；回复帧本身不带选项，之后发给该客户端的帧按选项编码 */
+            conn->frameFlags = topic & ((conn->listener->attr.checksum ? IPCS_MSG_FLAG_CHECKSUM : 0) |
+                    (conn->listener->attr.compress ? IPCS_MSG_FLAG_COMPRESSED : 0));
+            reply[0] = IPCS_CTRL_OPTIONS;
+            reply[1] = (unsigned int)sizeof(reply[2]) | IPCS_MSG_FLAG_CONTROL;
+            reply[2] = conn->frameFlags;
+            frame = IPCS_SharedFrameCopy(reply, sizeof(reply));
+            if (frame == NULL) {
+                result = IPCS_MALLOC_FAIL;
+            } else {
+                result = IPCS_ServerQueueFrame(threadArg, conn, frame, 0);
+                IPCS_SharedFrameUnref(frame);
+            }
+            if (result != IPCS_OK) {
+                IPCS_WriteLog("Server: %s client %d options reply fail: %d", threadArg->name, fd, result);
+            }
+            break;
+        default:
+            IPCS_WriteLog("Server: %s client %d unknown control: %u", threadArg->name, fd, msg->msgType);
+            break;
+    }
+
+    /* 控制帧的错误不影响连接上的其他请求 */
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+/* 销毁服务端 */
+int IPCS_DestroyServer(const char *serverName)
+{
+    int result = 0;
+
+    result = IPCS_CheckItemName(serverName);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    if (IPCS_DestroyPreforkServer(serverName) == IPCS_OK) {
+        return IPCS_OK;
+    }
+
+    return IPCS_RemoveServer(serverName, 1);
+}
+
+int IPCS_RemoveServer(const char *serverName, int unlinkName)
+{
+    IPCS_ItemInfo itemInfo;
+    int result = 0;
+
+    (void)memset(&itemInfo, 0, sizeof(IPCS_ItemInfo));
+    result = IPCS_FindItemsInfo(IPCS_SERVER, serverName, 0, &itemInfo);
+    if (result != IPCS_OK) {
+        return IPCS_OK;
+    }
+
+    (void)IPCS_DelItemsInfo(IPCS_SERVER, serverName, 0);
+    if (unlinkName) {
+        IPCS_UnlinkSockName(serverName);
+    }
+
+    /* 通知服务端线程关闭监听fd和该服务端的连接，最后一个服务端销毁时服务端线程退出 */
+    IPCS_ServerRemoveListener((IPCS_ServerListener *)itemInfo.context, itemInfo.pid);
+
+    IPCS_WriteLog("Destroy server: %s success", serverName);
+
+    return IPCS_OK;
+}
+
+/* 由服务端线程交接，等待其完成；交接成功后删除服务端，保留socket文件 */
+int IPCS_HandoffServer(const char *serverName, const char *handoffName, unsigned int timeoutMs)
+{
+    IPCS_ServerListener *listener = NULL;
+    IPCS_ServerThreadArg *threadArg = NULL;
+    uint64_t wakeValue = 1;
+    int ctrlFd = -1;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckItemName(serverName);
+    if (result == IPCS_OK) {
+        result = IPCS_CheckItemName(handoffName);
+    }
+    if (result == IPCS_OK) {
+        result = IPCS_ServerPinListener(serverName, &listener);
+    }
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    threadArg = listener->reactor;
+    if (g_IpcsCurServer == threadArg) {
+        IPCS_WriteLog("Handoff server: %s in its own callback.", serverName);
+        IPCS_ServerUnpinListener(listener);
+        return IPCS_HANDOFF_FAIL;
+    }
+
+    result = IPCS_HandoffConnect(handoffName, &ctrlFd);
+    if (result != IPCS_OK) {
+        IPCS_ServerUnpinListener(listener);
+        return result;
+    }
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    if (threadArg->exited || (listener->handoffFd >= 0)) {
+        (void)pthread_mutex_unlock(&threadArg->mutex);
+        (void)close(ctrlFd);
+        IPCS_ServerUnpinListener(listener);
+        return IPCS_HANDOFF_FAIL;
+    }
+    listener->handoffDeadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    listener->handoffDone = 0;
+    listener->handoffFd = ctrlFd;
+    threadArg->closeWaiters++;
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    while (!listener->handoffDone && !threadArg->exited) {
+        (void)pthread_cond_wait(&threadArg->exitCond, &threadArg->mutex);
+    }
+    result = listener->handoffDone ? listener->handoffResult : IPCS_HANDOFF_FAIL;
+    listener->handoffFd = -1;
+    threadArg->closeWaiters--;
+    (void)pthread_cond_broadcast(&threadArg->exitCond);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+    (void)close(ctrlFd);
+
+    /* 销毁最后一个服务端时要等待固定解除，先解除 */
+    IPCS_ServerUnpinListener(listener);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    return IPCS_RemoveServer(serverName, 0);
+}
+
+/* 先确认再创建服务端：确认之后旧进程不再读写这些连接，不会两个进程同时处理 */
+int IPCS_TakeoverServer(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr,
+        const char *handoffName, unsigned int timeoutMs)
+{
+    IPCS_ServerListener *listener = NULL;
+    IPCS_HandoffConn *conns = NULL;
+    uint64_t deadlineNs = IPCS_GetNowNs() + (uint64_t)timeoutMs * 1000000ULL;
+    int listenFd = -1;
+    int ctrlFd = -1;
+    int ack = IPCS_OK;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckCreatingServer(serverName, serverHook);
+    if (result == IPCS_OK) {
+        result = IPCS_CheckItemName(handoffName);
+    }
+    if (result != IPCS_OK) {
+        return result;
+    }
+    if ((attr != NULL) && (attr->workers > 1)) {
+        IPCS_WriteLog("Takeover server: %s as prefork server not supported.", serverName);
+        return IPCS_HANDOFF_FAIL;
+    }
+    if (IPCS_IsItemExist(IPCS_SERVER, serverName, 0) || IPCS_FindPreforkServer(serverName)) {
+        return IPCS_EXIST;
+    }
+
+    listener = IPCS_MallocServerListener(serverName, serverHook, attr);
+    if (listener == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    result = IPCS_HandoffAccept(handoffName, deadlineNs, &ctrlFd);
+    if (result == IPCS_OK) {
+        result = IPCS_HandoffRecvServer(ctrlFd, deadlineNs, &listenFd, &conns);
+    }
+    if (result == IPCS_OK) {
+        result = IPCS_HandoffSendAll(ctrlFd, &ack, sizeof(ack), deadlineNs);
+    }
+    if (ctrlFd >= 0) {
+        (void)close(ctrlFd);
+    }
+    if (result != IPCS_OK) {
+        if (listenFd >= 0) {
+            (void)close(listenFd);
+        }
+        IPCS_HandoffFreeConns(conns, 1);
+        IPCS_FreeServerListener(listener);
+        IPCS_WriteLog("Takeover server: %s from %s fail: %d", serverName, handoffName, result);
+        return result;
+    }
+
+    /* 之后监听fd属于listener：启动失败时随listener释放关闭，超时时服务端线程仍在使用，由销毁服务端关闭 */
+    listener->listenFd = listenFd;
+    listener->adopted = conns;
+
+    return IPCS_StartServerListener(listener);
+}
+
+int IPCS_GetServerStats(const char *serverName, IPCS_ServerStats *stats)
+{
+    IPCS_ServerThreadArg *threadArg = NULL;
+    IPCS_ServerListener *listener = NULL;
+    int result = IPCS_OK;
+
+    if (stats == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    result = IPCS_ServerPinListener(serverName, &listener);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    /* 系统调用、唤醒和忙等次数是服务端线程的，共用线程的服务端相同 */
+    threadArg = listener->reactor;
+    stats->syscalls = __atomic_load_n(&threadArg->stats.syscalls, __ATOMIC_RELAXED);
+    stats->wakeups = __atomic_load_n(&threadArg->stats.wakeups, __ATOMIC_RELAXED);
+    stats->messages = __atomic_load_n(&listener->stats.messages, __ATOMIC_RELAXED);
+    stats->publishes = __atomic_load_n(&listener->stats.publishes, __ATOMIC_RELAXED);
+    stats->pubDrops = __atomic_load_n(&listener->stats.pubDrops, __ATOMIC_RELAXED);
+    stats->spinHits = __atomic_load_n(&threadArg->stats.spinHits, __ATOMIC_RELAXED);
+    stats->recvPauses = __atomic_load_n(&listener->stats.recvPauses, __ATOMIC_RELAXED);
+    stats->sheds = __atomic_load_n(&listener->stats.sheds, __ATOMIC_RELAXED);
+    stats->queueNs = __atomic_load_n(&listener->stats.queueNs, __ATOMIC_RELAXED);
+    stats->cacheHits = __atomic_load_n(&listener->cache.hits, __ATOMIC_RELAXED);
+    stats->cacheMisses = __atomic_load_n(&listener->cache.misses, __ATOMIC_RELAXED);
+    stats->cacheBytes = IPCS_CacheBytes(&listener->cache);
+    stats->coalesced = __atomic_load_n(&listener->stats.coalesced, __ATOMIC_RELAXED);
+    IPCS_ServerUnpinListener(listener);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+/**
+ * 回调函数正在处理的请求（线程私有）。请求带有调用ID时，回调函数中对同一个fd发送的消息
+ * 带上该ID，客户端据此匹配响应；回调函数之外或者向其他fd发送的消息不带调用ID。
+ * 高优先级请求的响应同样是高优先级。
+ **/
+static __thread int g_IpcsCurCallFd = -1;
+static __thread unsigned int g_IpcsCurCallId = IPCS_NO_CALL_ID;
+static __thread IPCS_Priority g_IpcsCurCallPrio = IPCS_PRIO_NORMAL;
+static __thread uint64_t g_IpcsCurCallQueueNs = 0;
+
+void IPCS_ServerSetCurrentCall(int fd, unsigned int callId, IPCS_Priority prio, uint64_t queueNs)
+{
+    g_IpcsCurCallFd = fd;
+    g_IpcsCurCallId = callId;
+    g_IpcsCurCallPrio = prio;
+    g_IpcsCurCallQueueNs = queueNs;
+
+    return;
+}
+
+unsigned int IPCS_ServerGetCallId(int fd)
+{
+    return (fd == g_IpcsCurCallFd) ? g_IpcsCurCallId : IPCS_NO_CALL_ID;
+}
+
+IPCS_Priority IPCS_ServerGetCallPrio(int fd)
+{
+    return (fd == g_IpcsCurCallFd) ? g_IpcsCurCallPrio : IPCS_PRIO_NORMAL;
+}
+
+unsigned long long IPCS_ServerGetQueueNs(int fd)
+{
+    return (fd == g_IpcsCurCallFd) ? g_IpcsCurCallQueueNs : 0;
+}
+
+/* 任务和定时器执行时所属的服务端（线程私有）；回调函数中为连接所属的服务端 */
+static __thread IPCS_ServerListener *g_IpcsCurListener = NULL;
+
+IPCS_ServerThreadArg *IPCS_ServerCurrentThread(void)
+{
+    return g_IpcsCurServer;
+}
+
+IPCS_ServerListener *IPCS_ServerCurrentListener(void)
+{
+    IPCS_Conn *conn = NULL;
+
+    if ((g_IpcsCurListener != NULL) || (g_IpcsCurServer == NULL) || (g_IpcsCurCallFd < 0)) {
+        return g_IpcsCurListener;
+    }
+
+    conn = IPCS_ConnTableGet(&g_IpcsCurServer->conns, g_IpcsCurCallFd);
+
+    return (conn != NULL) ? conn->listener : g_IpcsCurServer->listeners;
+}
+
+void IPCS_ServerSetCurrentListener(IPCS_ServerListener *listener)
+{
+    g_IpcsCurListener = listener;
+
+    return;
+}
+
+int IPCS_ServerSaveCall(int fd, IPCS_ServerCall *call)
+{
+    IPCS_Conn *conn = NULL;
+
+    if (call == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    if ((fd != g_IpcsCurCallFd) || (g_IpcsCurServer == NULL) ||
+        ((conn = IPCS_ConnTableGet(&g_IpcsCurServer->conns, fd)) == NULL)) {
+        return IPCS_NOT_FOUND;
+    }
+
+    call->fd = fd;
+    call->callId = g_IpcsCurCallId;
+    call->prio = g_IpcsCurCallPrio;
+    call->connId = conn->serial;
+
+    return IPCS_OK;
+}
+
+/* 暂时把保存的请求设为正在处理的请求，响应带上其调用ID和优先级 */
+int IPCS_ServerReply(const IPCS_ServerCall *call, IPCS_Message *msg)
+{
+    IPCS_Conn *conn = NULL;
+    int savedFd = g_IpcsCurCallFd;
+    unsigned int savedCallId = g_IpcsCurCallId;
+    IPCS_Priority savedPrio = g_IpcsCurCallPrio;
+    uint64_t savedQueueNs = g_IpcsCurCallQueueNs;
+    int savedFillFd = -1;
+    int result = IPCS_OK;
+
+    if (call == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    /* 连接已关闭，或者fd已被新连接重用 */
+    if ((g_IpcsCurServer == NULL) || ((conn = IPCS_ConnTableGet(&g_IpcsCurServer->conns, call->fd)) == NULL) ||
+        (conn->serial != call->connId)) {
+        return IPCS_NOT_FOUND;
+    }
+
+    /* 在可缓存请求的回调函数中响应同一个连接上之前的请求时，不能当作本次请求的响应缓存 */
+    savedFillFd = g_IpcsCacheFill.fd;
+    g_IpcsCacheFill.fd = -1;
+    IPCS_ServerSetCurrentCall(call->fd, call->callId, call->prio, 0);
+    result = IPCS_ServerSendMessageEx(call->fd, msg, call->prio);
+    IPCS_ServerSetCurrentCall(savedFd, savedCallId, savedPrio, savedQueueNs);
+    g_IpcsCacheFill.fd = savedFillFd;
+
+    return result;
+}
+
+/******************************************************************************/
+/* 服务端响应消息，服务端响应请求的回调函数中使用 */
+int IPCS_ServerSendMessage(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessageEx(fd, msg, IPCS_PRIO_NORMAL);
+}
+
+int IPCS_ServerSendMessageEx(int fd, IPCS_Message *msg, IPCS_Priority prio)
+{
+    IPCS_Conn *conn = NULL;
+    int result = IPCS_OK;
+
+    result = IPCS_CheckSeverSendMsg(fd, msg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server send mgs to client: %d with bad params: %d", fd, result);
+        return result;
+    }
+
+    if (fd == g_IpcsCacheFill.fd) {
+        IPCS_ServerCacheCapture(msg);
+    }
+
+    if ((IPCS_ServerGetCallPrio(fd) == IPCS_PRIO_HIGH) || (IPCS_GetMsgPriority(msg->msgType) == IPCS_PRIO_HIGH)) {
+        prio = IPCS_PRIO_HIGH;
+    }
+
+    /* io_uring引擎的服务端线程中，响应加入连接的发送缓冲区批量发送；
+     * epoll引擎中发送队列不为空时，响应排在队列中的发布消息之后，否则不阻塞地直接发送；
+     * 不在连接所属的服务端线程中时交给该线程发送，不与它正在发送的帧交错 */
+    conn = (g_IpcsCurServer != NULL) ? IPCS_ConnTableGet(&g_IpcsCurServer->conns, fd) : NULL;
+    if ((conn != NULL) && (g_IpcsCurServer->ring != NULL)) {
+        result = IPCS_UringServerQueueSend(g_IpcsCurServer, conn, msg, IPCS_ServerGetCallId(fd), prio);
+    } else if ((conn != NULL) && (conn->outHead != NULL)) {
+        result = IPCS_ServerQueueMessage(g_IpcsCurServer, conn, msg, IPCS_ServerGetCallId(fd), prio);
+    } else if (conn != NULL) {
+        result = IPCS_ServerSendNow(g_IpcsCurServer, conn, msg, IPCS_ServerGetCallId(fd), prio);
+    } else {
+        result = IPCS_ServerPostSend(fd, msg, prio);
+        if (result == IPCS_NOT_FOUND) {
+            /* 不是本进程服务端的连接（例如调用方自己管理的fd），直接发送 */
+            result = IPCS_SendMessagePrio(IPCS_SERVER, fd, msg, IPCS_ServerGetCallId(fd), prio);
+            if (g_IpcsCurServer != NULL) {
+                IPCS_STAT_ADD(g_IpcsCurServer->stats.syscalls, 1);
+            }
+        }
+    }
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server send msg to client: %d fail: %d", fd, result);
+        return result;
+    }
+
+    return result;
+}
+
+int IPCS_CheckSeverSendMsg(int fd, IPCS_Message *msg)
+{
+    int result = IPCS_OK;
+
+    /* The input fd is not client fd, it's acceptFd. 
+     * So it can't be checked by IPCS_IsItemExist. */
+
+    result = IPCS_CheckMessage(msg);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Server send to client: %d with bad msg: %d", fd, result);
+        return result;
+    }
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+int IPCS_AddServerInfo(const char *serverName, int fd, int epollFd, pthread_t pid, ServerCallback hook,
+        IPCS_ServerListener *listener)
+{
+    IPCS_ItemInfo info;
+    int result = IPCS_OK;
+
+    (void)memset(&info, 0, sizeof(IPCS_ItemInfo));
+
+    info.type = IPCS_SERVER;
+    (void)strcpy(info.name, serverName);
+    info.fd = fd;
+    info.epollFd = epollFd;
+    info.pid = pid;
+    info.hook = hook;
+    info.context = listener;
+
+    result = IPCS_AddItemsInfo(&info);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Add server: %s: socket: %d info fail: %d.", serverName, fd, result);
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+
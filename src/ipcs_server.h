@@ -20,7 +20,19 @@
 #define __IPCS_SERVER_H__
 
 #include "ipcs.h"
+#include "ipcs_busypoll.h"
+#include "ipcs_cache.h"
 #include "ipcs_common.h"
+#include "ipcs_conn.h"
+#include "ipcs_handoff.h"
+#include "ipcs_prefork.h"
+#include "ipcs_shed.h"
+#include "ipcs_task.h"
+#include "ipcs_uring.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/epoll.h>
 
 /******************************************************************************/
 #define MAX_CLIENT_NUM      20
@@ -28,33 +40,344 @@
 #define EPOLL_SIZE          20
 #define EPOLL_RUN_TIMEOUT   -1
 
+/* io_uring引擎：provided buffer的个数（2的幂）和大小 */
+#define IPCS_URING_BUF_NUM      64
+#define IPCS_URING_BUF_LEN      (16 * 1024)
+#define IPCS_URING_BGID         0
+
+/* 服务端线程退出时等待取消accept完成的次数和每次的时间 */
+#define IPCS_URING_CANCEL_TRIES     10
+#define IPCS_URING_CANCEL_WAIT_NS   (10 * 1000 * 1000ULL)
+
+/* 暂停接收的连接检查能否恢复的间隔（因内存预算暂停时没有其他事件触发），空闲连接收缩缓冲区的间隔 */
+#define IPCS_RESUME_SCAN_NS     (10 * 1000 * 1000ULL)
+#define IPCS_TRIM_SWEEP_NS      (200 * 1000 * 1000ULL)
+
+/* 请求合并：已完成的请求的响应保留到比之后完成的请求的发送时间早IPCS_FLIGHT_KEEP_NS（超过时不再合并，
+ * 只是多调用一次回调函数），以及占用的内存上限 */
+#define IPCS_FLIGHT_KEEP_NS     (10 * 1000 * 1000ULL)
+#define IPCS_FLIGHT_MAX_BYTES   (1024 * 1024)
+
+/* 其他线程发布、尚未分发的消息上限，超过时发布者等待 */
+#define IPCS_PUB_INBOX_MAX      1024
+
+/* 其他线程向连接发送、尚未交给服务端线程的消息上限，超过时发送者等待 */
+#define IPCS_SEND_INBOX_MAX     1024
+
+/* 共享反应器上服务端的关闭状态，只由服务端线程修改 */
+#define IPCS_LISTENER_OPEN      0
+#define IPCS_LISTENER_CLOSING   1
+#define IPCS_LISTENER_CLOSED    2
+
+/* 统计只由服务端线程写，其他线程读，不需要原子加 */
+#define IPCS_STAT_ADD(field, n)         __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
 /******************************************************************************/
+struct IPCS_ServerThreadArg;
+
+/**
+ * 一个服务端名字对应的监听socket。独立的服务端线程上只有一个；attr.reactor相同的服务端
+ * 共用一个服务端线程（反应器），各自的监听socket、回调函数、发布策略和统计保存在这里，
+ * 连接通过conn->listener找到所属的服务端。
+ **/
+/* 等待服务端开始accept的创建线程（attr.readyTimeoutMs），由全局的锁保护 */
 typedef struct {
+    int done;
+    int result;
+    pthread_cond_t cond;
+} IPCS_ServerReady;
+
+typedef struct IPCS_ServerListener {
     char name[IPCS_ITEM_NAME_MAX_LEN];
     ServerCallback serverHook;
+    IPCS_ServerAttr attr;
+    struct IPCS_ServerThreadArg *reactor;
+    int listenFd;
+    int shared;                     /* 多进程服务端的工作进程共用的监听socket */
+
+    /* 销毁时在mutex保护下设置closing，服务端线程关闭监听socket和连接后closeState为CLOSED */
+    int closing;
+    int closeState;
+    unsigned int connNum;
+    unsigned int pins;              /* 其他线程正在使用的次数，mutex保护，为0时才能释放 */
+
+    IPCS_Codel codel;               /* 过载保护：服务端所有连接共用，只由服务端线程访问 */
+    IPCS_Cache cache;
+    IPCS_Cache flights;             /* 请求合并，缓存项的expireNs为回调函数返回的时间 */
+    IPCS_ServerStats stats;         /* 只使用messages、publishes、pubDrops、recvPauses、sheds、queueNs、coalesced */
+
+    /* 热重启：IPCS_HandoffServer在mutex保护下设置handoffFd，服务端线程交接后设置handoffDone并通知；
+     * 接管的服务端打开监听socket后加入adopted中的连接 */
+    int handoffFd;
+    int handoffDone;
+    int handoffResult;
+    uint64_t handoffDeadlineNs;
+    IPCS_HandoffConn *adopted;
+    IPCS_ServerReady *ready;        /* 打开监听socket（或失败释放）时通知，之后为NULL */
+    struct IPCS_ServerListener *next;
+} IPCS_ServerListener;
+
+/* 其他线程发布、尚未分发的消息 */
+typedef struct IPCS_PubItem {
+    IPCS_SharedFrame *frame;
+    IPCS_ServerListener *listener;
+    struct IPCS_PubItem *next;
+} IPCS_PubItem;
+
+typedef struct IPCS_ServerThreadArg {
+    char name[IPCS_ITEM_NAME_MAX_LEN];  /* 创建线程的服务端的名字，用于日志 */
+    IPCS_ServerAttr attr;
+
+    /* 共享反应器：reactorId非0时挂在全局反应器列表上，由全局列表的锁保护 */
+    unsigned int reactorId;
+    struct IPCS_ServerThreadArg *nextReactor;
+
+    /* 服务端线程的监听socket；其他线程新加入的放在addList中，由mutex保护 */
+    IPCS_ServerListener *listeners;
+    IPCS_ServerListener *addList;
+    unsigned int listenerNum;       /* 没有被销毁的服务端个数，由mutex保护 */
+    unsigned int closingNum;        /* 已销毁、服务端线程还没有关闭的服务端个数，由mutex保护 */
+    unsigned int closeWaiters;      /* 正在等待服务端线程关闭服务端的线程，释放时等待其返回 */
+
+    /* 销毁服务端时设置stopping并通过wakeFd唤醒服务端线程，服务端线程退出时设置exited */
+    int wakeFd;
+    pthread_mutex_t mutex;
+    pthread_cond_t exitCond;
+    volatile int stopping;
+    int exited;
+    int selfFree;
+    int registered;
+
+    int epollFd;
+    IPCS_ConnTable conns;
+    IPCS_Uring *ring;
+    IPCS_UringBufRing bufRing;
+    IPCS_Conn *flushList;
+    IPCS_Conn *recvList;            /* 本轮已处理高优先级帧、还有普通帧待处理的连接 */
+
+    /* 其他线程发布的消息，由mutex保护 */
+    pthread_cond_t pubCond;
+    IPCS_PubItem *pubInbox;
+    IPCS_PubItem *pubInboxTail;
+    unsigned int pubInboxNum;
+    unsigned int publishers;        /* 正在等待收件箱的发布者，销毁时等待其返回 */
+
+    /* 其他线程提交的任务，由mutex保护；定时器只由服务端线程访问 */
+    IPCS_ServerTask *taskInbox;
+    IPCS_ServerTask *taskInboxTail;
+    unsigned int sendTaskNum;       /* 收件箱中其他线程的发送，见IPCS_ServerPostSend */
+    IPCS_ServerTimers timers;
+
+    /* 流量控制和空闲连接收缩缓冲区的定时检查，只由服务端线程访问 */
+    unsigned int pausedNum;
+    int trimPending;
+    uint64_t resumeScanNs;
+    uint64_t trimSweepNs;
+
+    void *cacheBuf;                 /* 响应缓存命中时复制响应，第一次命中时分配 */
+
+    IPCS_BusyPoll busyPoll;
+    IPCS_ServerStats stats;         /* 只使用syscalls、wakeups、spinHits */
 } IPCS_ServerThreadArg;
 
 /******************************************************************************/
 int IPCS_CheckCreatingServer(const char *serverName, ServerCallback serverHook);
 
+void IPCS_ServerRunWorker(const char *serverName, ServerCallback serverHook, const IPCS_ServerAttr *attr, int listenFd);
+
+pid_t IPCS_ServerFork(void);
+
+/* 由已有的服务端线程或新的服务端线程打开监听socket，失败时释放listener；
+ * attr.readyTimeoutMs不为0时等待打开的结果 */
+int IPCS_StartServerListener(IPCS_ServerListener *listener);
+
+/* 通知等待的创建线程，listener->ready为NULL时什么也不做 */
+void IPCS_ServerReportReady(IPCS_ServerListener *listener, int result);
+
+/* 等待到服务端打开监听socket或超时，超时后不再通知 */
+int IPCS_ServerWaitReady(IPCS_ServerListener *listener, IPCS_ServerReady *ready, unsigned int timeoutMs);
+
+/* 删除登记信息，通知服务端线程关闭；unlinkName为0时保留socket文件（已交给新进程） */
+int IPCS_RemoveServer(const char *serverName, int unlinkName);
+
+IPCS_ServerListener *IPCS_MallocServerListener(const char *serverName, ServerCallback serverHook,
+        const IPCS_ServerAttr *attr);
+
+void IPCS_FreeServerListener(IPCS_ServerListener *listener);
+
+/* 当前线程运行的服务端线程，不是服务端线程时为NULL */
+IPCS_ServerThreadArg *IPCS_ServerCurrentThread(void);
+
+/* 正在执行的回调函数、任务或定时器所属的服务端，其他时候为NULL */
+IPCS_ServerListener *IPCS_ServerCurrentListener(void);
+
+void IPCS_ServerSetCurrentListener(IPCS_ServerListener *listener);
+
+/* 按名字查找并固定服务端，其他线程调用的接口使用，用完后调用IPCS_ServerUnpinListener */
+int IPCS_ServerPinListener(const char *serverName, IPCS_ServerListener **listener);
+
+void IPCS_ServerUnpinListener(IPCS_ServerListener *listener);
+
+IPCS_ServerThreadArg *IPCS_MallocServerThreadArg(IPCS_ServerListener *listener);
+
+void IPCS_FreeServerThreadArg(IPCS_ServerThreadArg *threadArg);
+
+int IPCS_AttachServerListener(IPCS_ServerListener *listener);
+
+void IPCS_UnlinkReactor(IPCS_ServerThreadArg *threadArg);
+
 void *IPCS_ServerRun(void *arg);
 
+void IPCS_ServerThreadExit(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_StopServerThread(IPCS_ServerThreadArg *threadArg, pthread_t pid);
+
 int IPCS_CreateServerSocket(const char *serverName, int *serverFd);
 
-int IPCS_CreateServerEpoll(int serverFd, int *epollFd);
+int IPCS_CreateServerEpoll(int wakeFd, int *epollFd);
+
+void IPCS_ServerOpenListeners(IPCS_ServerThreadArg *threadArg);
+
+int IPCS_ServerOpenListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener);
+
+IPCS_ServerListener *IPCS_ServerFindListener(IPCS_ServerThreadArg *threadArg, int listenFd);
+
+void IPCS_ServerHandleListenerChanges(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_ServerCloseListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener);
+
+void IPCS_ServerReleaseListener(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener);
+
+void IPCS_ServerRemoveListener(IPCS_ServerListener *listener, pthread_t pid);
 
-int IPCS_HandleServerEpollEvents(int serverFd, int epollFd, IPCS_ServerThreadArg *threadArg);
+/* sendNs为请求的发送时间，没有时为0 */
+int IPCS_ServerCallHook(IPCS_ServerThreadArg *threadArg, int fd, IPCS_Message *msg, uint64_t sendNs);
 
-int IPCS_ServerAcceptClient(int serverFd, int epollFd);
+/* 开启了缓存或请求合并的服务端：命中时直接回复，否则调用回调函数并记录其响应 */
+int IPCS_ServerCallHookCached(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener, int fd,
+        IPCS_Message *msg, uint64_t sendNs);
+
+/* 记录可合并的请求的响应，entry的expireNs为回调函数返回的时间，sendNs为该请求的发送时间 */
+void IPCS_ServerFlightDone(IPCS_ServerListener *listener, IPCS_CacheEntry *entry, uint64_t generation,
+        uint64_t sendNs);
+
+/* 回调函数为可缓存的请求发出响应时调用 */
+void IPCS_ServerCacheCapture(IPCS_Message *msg);
+
+/* 准入控制：计算请求的排队时间（queueNs为出参），按服务端的过载保护策略决定是否接受；
+ * 拒绝时回复错误帧（或直接丢弃）并返回IPCS_OVERLOADED */
+int IPCS_ServerAdmit(IPCS_ServerThreadArg *threadArg, int fd, IPCS_Message *msg, unsigned int callId,
+        IPCS_Priority prio, uint64_t sendNs, uint64_t *queueNs);
+
+int IPCS_ServerReject(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, unsigned int msgType, unsigned int callId,
+        int error);
+
+int IPCS_HandleServerEpollEvents(int epollFd, IPCS_ServerThreadArg *threadArg);
+
+/* 配置了忙等时先用不阻塞的epoll_wait忙等，没有事件再阻塞等待 */
+int IPCS_ServerEpollWait(IPCS_ServerThreadArg *threadArg, int epollFd, struct epoll_event *events);
+
+int IPCS_ServerAcceptClient(IPCS_ServerListener *listener, int epollFd, IPCS_ServerThreadArg *threadArg);
+
+int IPCS_ServerCloseClient(IPCS_ServerThreadArg *threadArg, int clientFd);
 
 int IPCS_ServerHandleMessage(int clientFd, IPCS_ServerThreadArg *threadArg);
 
+int IPCS_ServerHandleConnData(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+int IPCS_ServerHandleConnHigh(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+/* 收到校验和不对或格式错误的帧，只关闭该连接 */
+int IPCS_ServerCorruptConn(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+void IPCS_ServerQueueRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+int IPCS_ServerHandleRecvList(IPCS_ServerThreadArg *threadArg);
+
+/* 按连接的积压和内存预算暂停或恢复接收 */
+void IPCS_ServerUpdateRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+void IPCS_ServerPauseRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, int pause);
+
+/* 每轮事件处理完后调用：到时间时检查暂停的连接、收缩空闲连接的缓冲区 */
+void IPCS_ServerMaintain(IPCS_ServerThreadArg *threadArg);
+
+/* 距离下一次检查的时间，0表示没有需要定时检查的连接 */
+uint64_t IPCS_ServerNextTimer(IPCS_ServerThreadArg *threadArg);
+
+/******************************************************************************/
+int IPCS_CreateServerUring(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_DestroyServerUring(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_UringServerCancelAccepts(IPCS_ServerThreadArg *threadArg);
+
+int IPCS_HandleServerUringEvents(IPCS_ServerThreadArg *threadArg);
+
+/* 提交请求并等待完成事件，配置了忙等时先忙等完成队列 */
+int IPCS_UringServerWait(IPCS_ServerThreadArg *threadArg);
+
+int IPCS_UringServerHandleCqe(IPCS_ServerThreadArg *threadArg, uint64_t userData, int res, unsigned int flags);
+
+int IPCS_UringServerAccept(IPCS_ServerThreadArg *threadArg, int listenFd, int res, unsigned int flags);
+
+int IPCS_UringServerArm(IPCS_ServerThreadArg *threadArg, int fd, unsigned int op);
+
+int IPCS_UringServerArmAccept(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener);
+
+/* 没有暂停、没有正在进行的recv时提交multishot recv */
+int IPCS_UringServerArmRecv(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+int IPCS_UringServerRecv(IPCS_ServerThreadArg *threadArg, int fd, int res, unsigned int flags);
+
+void IPCS_UringServerSendDone(IPCS_ServerThreadArg *threadArg, int fd, int res);
+
+int IPCS_UringServerQueueSend(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_Message *msg,
+        unsigned int callId, IPCS_Priority prio);
+
+int IPCS_UringServerPrepSend(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+void IPCS_UringServerFlush(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_UringServerMaybeClose(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
 /******************************************************************************/
-int IPCS_AddServerInfo(const char *serverName, int fd, int epollFd, pthread_t pid, ServerCallback hook);
+void IPCS_ServerDrainPubInbox(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_ServerFanOut(IPCS_ServerThreadArg *threadArg, IPCS_ServerListener *listener, IPCS_SharedFrame *frame);
+
+int IPCS_ServerQueueFrame(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_SharedFrame *frame, int isPub);
+
+int IPCS_ServerQueueMessage(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_Message *msg,
+        unsigned int callId, IPCS_Priority prio);
+
+int IPCS_ServerSendNow(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, IPCS_Message *msg,
+        unsigned int callId, IPCS_Priority prio);
+
+void IPCS_ServerKickConn(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+void IPCS_ServerFlushOutList(IPCS_ServerThreadArg *threadArg);
+
+void IPCS_ServerFlushOut(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn);
+
+void IPCS_ServerWatchOut(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, int watch);
+
+int IPCS_ServerSetEvents(IPCS_ServerThreadArg *threadArg, IPCS_Conn *conn, int recvPaused, int outWatch);
+
+int IPCS_ServerHandleControl(IPCS_ServerThreadArg *threadArg, int fd, IPCS_Message *msg);
+
+/******************************************************************************/
+int IPCS_AddServerInfo(const char *serverName, int fd, int epollFd, pthread_t pid, ServerCallback hook,
+        IPCS_ServerListener *listener);
 
 int IPCS_CheckSeverSendMsg(int fd, IPCS_Message *msg);
 
+void IPCS_ServerSetCurrentCall(int fd, unsigned int callId, IPCS_Priority prio, uint64_t queueNs);
+
+unsigned int IPCS_ServerGetCallId(int fd);
+
+IPCS_Priority IPCS_ServerGetCallPrio(int fd);
+
 /******************************************************************************/
 
 #endif /* __IPCS_SERVER_H__ */
-
@@ -0,0 +1,82 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_shed.c
+ *
+ *    Description:  IPC socket server load shedding (CoDel, token bucket)
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 11:47:18 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_shed.h"
+
+#include <string.h>
+
+/******************************************************************************/
+void IPCS_CodelInit(IPCS_Codel *codel, const IPCS_ShedAttr *attr)
+{
+    unsigned int targetUs = (attr->targetUs != 0) ? attr->targetUs : IPCS_SHED_TARGET_DEFAULT_US;
+    unsigned int intervalUs = (attr->intervalUs != 0) ? attr->intervalUs : IPCS_SHED_INTERVAL_DEFAULT_US;
+
+    (void)memset(codel, 0, sizeof(IPCS_Codel));
+    codel->targetNs = (uint64_t)targetUs * 1000ULL;
+    codel->intervalNs = (uint64_t)intervalUs * 1000ULL;
+
+    return;
+}
+
+int IPCS_CodelShed(IPCS_Codel *codel, uint64_t nowNs, uint64_t queueNs)
+{
+    if (nowNs >= codel->windowEndNs) {
+        if (codel->windowEndNs != 0) {
+            codel->overloaded = (codel->minQueueNs > codel->targetNs);
+        }
+        codel->windowEndNs = nowNs + codel->intervalNs;
+        codel->minQueueNs = queueNs;
+    } else if (queueNs < codel->minQueueNs) {
+        codel->minQueueNs = queueNs;
+    }
+
+    return codel->overloaded && (queueNs > IPCS_CODEL_SHED_FACTOR * codel->targetNs);
+}
+
+/******************************************************************************/
+int IPCS_TokenBucketShed(IPCS_TokenBucket *bucket, const IPCS_ShedAttr *attr, uint64_t nowNs)
+{
+    uint64_t burst = (attr->burst != 0) ? attr->burst : attr->rate;
+    uint64_t capacity = burst * IPCS_TOKEN_SCALE;
+    uint64_t elapsedNs = 0;
+
+    if (attr->rate == 0) {
+        return 0;
+    }
+
+    /* 经过的时间足够填满桶时直接填满，避免乘法溢出 */
+    elapsedNs = nowNs - bucket->lastNs;
+    if ((bucket->lastNs == 0) || (elapsedNs >= capacity / attr->rate)) {
+        bucket->tokens = capacity;
+    } else {
+        bucket->tokens += elapsedNs * attr->rate;
+        if (bucket->tokens > capacity) {
+            bucket->tokens = capacity;
+        }
+    }
+    bucket->lastNs = nowNs;
+
+    if (bucket->tokens < IPCS_TOKEN_SCALE) {
+        return 1;
+    }
+    bucket->tokens -= IPCS_TOKEN_SCALE;
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,62 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_shed.h
+ *
+ *    Description:  IPC socket server load shedding (CoDel, token bucket)
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 11:47:18 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_SHED_H__
+#define __IPCS_SHED_H__
+
+#include "ipcs.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * CoDel用于请求队列：每个观察窗口结束时，窗口内的最小排队时间超过目标说明队列一直没有排空，
+ * 是持续的积压而不是突发，进入过载；突发的请求在一个窗口内总有排队时间低于目标的时候，不会被拒绝。
+ * 过载期间拒绝排队时间超过两倍目标的请求，被拒绝的请求不执行回调函数，排队时间保持在目标和
+ * 两倍目标之间，窗口内的最小排队时间仍高于目标，一直处于过载；负载下降、队列排空后退出过载。
+ **/
+#define IPCS_CODEL_SHED_FACTOR  2
+
+typedef struct {
+    uint64_t targetNs;
+    uint64_t intervalNs;
+    uint64_t windowEndNs;       /* 0表示还没有开始第一个窗口 */
+    uint64_t minQueueNs;        /* 当前窗口内的最小排队时间 */
+    int overloaded;
+} IPCS_Codel;
+
+/* 令牌桶，令牌以1/IPCS_TOKEN_SCALE个为单位，一个请求消耗IPCS_TOKEN_SCALE */
+#define IPCS_TOKEN_SCALE        1000000000ULL
+
+typedef struct {
+    uint64_t tokens;
+    uint64_t lastNs;            /* 0表示还没有请求，桶是满的 */
+} IPCS_TokenBucket;
+
+/******************************************************************************/
+void IPCS_CodelInit(IPCS_Codel *codel, const IPCS_ShedAttr *attr);
+
+/* 记录一个请求的排队时间，返回是否拒绝该请求 */
+int IPCS_CodelShed(IPCS_Codel *codel, uint64_t nowNs, uint64_t queueNs);
+
+/* 取一个令牌，返回是否因令牌不足拒绝该请求；rate为0时不限制 */
+int IPCS_TokenBucketShed(IPCS_TokenBucket *bucket, const IPCS_ShedAttr *attr, uint64_t nowNs);
+
+/******************************************************************************/
+
+#endif /* __IPCS_SHED_H__ */
@@ -0,0 +1,451 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_task.c
+ *
+ *    Description:  IPC socket server thread tasks and timers
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:31:52 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_task.h"
+#include "ipcs_server.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+int IPCS_ServerPostTask(const char *serverName, IPCS_TaskCallback task, void *arg)
+{
+    IPCS_ServerThreadArg *threadArg = NULL;
+    IPCS_ServerListener *listener = NULL;
+    IPCS_ServerTask *node = NULL;
+    uint64_t wakeValue = 1;
+    int wake = 0;
+    int result = IPCS_OK;
+
+    if (task == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    /* 固定服务端，并发销毁服务端不会释放服务端和服务端线程 */
+    result = IPCS_ServerPinListener(serverName, &listener);
+    if (result != IPCS_OK) {
+        return result;
+    }
+    threadArg = listener->reactor;
+
+    node = (IPCS_ServerTask *)malloc(sizeof(IPCS_ServerTask));
+    if (node == NULL) {
+        IPCS_ServerUnpinListener(listener);
+        return IPCS_MALLOC_FAIL;
+    }
+    node->task = task;
+    node->arg = arg;
+    node->listener = listener;
+    node->next = NULL;
+
+    /* 与发布消息相同：服务端已销毁时不再放入收件箱，服务端线程关闭服务端后收件箱中不会再引用它 */
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    if (threadArg->stopping || threadArg->exited || listener->closing) {
+        result = IPCS_NOT_FOUND;
+    } else {
+        wake = (threadArg->taskInbox == NULL);
+        if (threadArg->taskInboxTail == NULL) {
+            threadArg->taskInbox = node;
+        } else {
+            threadArg->taskInboxTail->next = node;
+        }
+        threadArg->taskInboxTail = node;
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (result != IPCS_OK) {
+        free(node);
+    } else if (wake) {
+        (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+    }
+    IPCS_ServerUnpinListener(listener);
+
+    return result;
+}
+
+/**
+ * 服务端线程删除连接时要先取连接归属表的锁，持有锁时查到的线程不会被释放；
+ * 加上publishers计数之后释放锁，等待收件箱时线程也不会被释放。
+ * 收件箱满时等待服务端线程取走，服务端线程中（发给其他服务端线程的连接）不等待，返回IPCS_OVERLOADED。
+ **/
+int IPCS_ServerPostSend(int fd, IPCS_Message *msg, IPCS_Priority prio)
+{
+    IPCS_ServerThreadArg *threadArg = NULL;
+    IPCS_ServerSendTask *send = NULL;
+    IPCS_ServerTask *node = NULL;
+    unsigned long long serial = 0;
+    uint64_t wakeValue = 1;
+    int wake = 0;
+    int result = IPCS_OK;
+
+    node = (IPCS_ServerTask *)malloc(sizeof(IPCS_ServerTask) + sizeof(IPCS_ServerSendTask) + msg->msgLen);
+    if (node == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    send = (IPCS_ServerSendTask *)(node + 1);
+    send->fd = fd;
+    send->prio = prio;
+    send->msg.msgType = msg->msgType;
+    send->msg.msgLen = msg->msgLen;
+    send->msg.msgValue = send + 1;
+    (void)memcpy(send + 1, msg->msgValue, msg->msgLen);
+    node->task = IPCS_ServerRunSendTask;
+    node->arg = send;
+    node->listener = NULL;
+    node->next = NULL;
+
+    IPCS_ConnOwnersLock();
+    threadArg = (IPCS_ServerThreadArg *)IPCS_ConnOwnerGet(fd, &serial);
+    if (threadArg == NULL) {
+        IPCS_ConnOwnersUnlock();
+        free(node);
+        return IPCS_NOT_FOUND;
+    }
+    send->serial = serial;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    threadArg->publishers++;
+    IPCS_ConnOwnersUnlock();
+
+    while ((threadArg->sendTaskNum >= IPCS_SEND_INBOX_MAX) && !threadArg->stopping && !threadArg->exited &&
+           (IPCS_ServerCurrentThread() == NULL)) {
+        (void)pthread_cond_wait(&threadArg->pubCond, &threadArg->mutex);
+    }
+
+    if (threadArg->stopping || threadArg->exited) {
+        result = IPCS_PEER_CLOSED;
+    } else if (threadArg->sendTaskNum >= IPCS_SEND_INBOX_MAX) {
+        result = IPCS_OVERLOADED;
+    } else {
+        wake = (threadArg->taskInbox == NULL);
+        if (threadArg->taskInboxTail == NULL) {
+            threadArg->taskInbox = node;
+        } else {
+            threadArg->taskInboxTail->next = node;
+        }
+        threadArg->taskInboxTail = node;
+        threadArg->sendTaskNum++;
+        if (wake) {
+            (void)write(threadArg->wakeFd, &wakeValue, sizeof(wakeValue));
+        }
+    }
+
+    threadArg->publishers--;
+    (void)pthread_cond_broadcast(&threadArg->exitCond);
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    if (result != IPCS_OK) {
+        free(node);
+    }
+
+    return result;
+}
+
+/* 在所属的服务端线程中执行，按该线程自己的发送路径（发送队列、io_uring、帧选项）发出 */
+void IPCS_ServerRunSendTask(void *arg)
+{
+    IPCS_ServerSendTask *send = (IPCS_ServerSendTask *)arg;
+    IPCS_ServerThreadArg *threadArg = IPCS_ServerCurrentThread();
+    IPCS_Conn *conn = IPCS_ConnTableGet(&threadArg->conns, send->fd);
+
+    if ((conn == NULL) || (conn->serial != send->serial)) {
+        IPCS_WriteLog("Server: %s drop send to closed client: %d", threadArg->name, send->fd);
+        return;
+    }
+
+    (void)IPCS_ServerSendMessageEx(send->fd, &send->msg, send->prio);
+
+    return;
+}
+
+void IPCS_ServerRunTasks(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerListener *saved = IPCS_ServerCurrentListener();
+    IPCS_ServerTask *list = NULL;
+    IPCS_ServerTask *node = NULL;
+
+    (void)pthread_mutex_lock(&threadArg->mutex);
+    list = threadArg->taskInbox;
+    threadArg->taskInbox = NULL;
+    threadArg->taskInboxTail = NULL;
+    if (threadArg->sendTaskNum != 0) {
+        threadArg->sendTaskNum = 0;
+        (void)pthread_cond_broadcast(&threadArg->pubCond);
+    }
+    (void)pthread_mutex_unlock(&threadArg->mutex);
+
+    while ((node = list) != NULL) {
+        list = node->next;
+        if (node->listener == NULL) {
+            node->task(node->arg);
+        } else if (!__atomic_load_n(&node->listener->closing, __ATOMIC_RELAXED)) {
+            IPCS_ServerSetCurrentListener(node->listener);
+            node->task(node->arg);
+        }
+        free(node);
+    }
+    IPCS_ServerSetCurrentListener(saved);
+
+    return;
+}
+
+void IPCS_ServerFreeTasks(IPCS_ServerThreadArg *threadArg)
+{
+    IPCS_ServerTask *node = NULL;
+
+    while ((node = threadArg->taskInbox) != NULL) {
+        threadArg->taskInbox = node->next;
+        free(node);
+    }
+    threadArg->taskInboxTail = NULL;
+
+    return;
+}
+
+/******************************************************************************/
+int IPCS_ServerAddTimer(unsigned int delayMs, unsigned int intervalMs, IPCS_TaskCallback callback, void *arg,
+        unsigned long long *timerId)
+{
+    IPCS_ServerThreadArg *threadArg = IPCS_ServerCurrentThread();
+    IPCS_ServerListener *listener = IPCS_ServerCurrentListener();
+    IPCS_ServerTimer *timer = NULL;
+    int result = IPCS_OK;
+
+    if (callback == NULL) {
+        return IPCS_PARAM_NULL;
+    }
+
+    /* 只能在服务端线程中、属于某个服务端的回调函数、任务或定时器中调用 */
+    if ((threadArg == NULL) || (listener == NULL)) {
+        return IPCS_NOT_FOUND;
+    }
+
+    timer = (IPCS_ServerTimer *)calloc(1, sizeof(IPCS_ServerTimer));
+    if (timer == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    result = IPCS_ServerTimerAlloc(&threadArg->timers, timer);
+    if (result != IPCS_OK) {
+        free(timer);
+        return result;
+    }
+
+    timer->threadArg = threadArg;
+    timer->listener = listener;
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->intervalNs = (uint64_t)intervalMs * 1000000ULL;
+    IPCS_TimerNodeInit(&timer->node, IPCS_ServerTimerExpire, timer);
+
+    /* 时间轮可能很久没有推进（之前没有定时器），先推进到当前时间 */
+    if (threadArg->timers.wheel.count == 0) {
+        (void)IPCS_TimerWheelAdvance(&threadArg->timers.wheel, IPCS_GetNowNs());
+    }
+    timer->expireNs = IPCS_GetNowNs() + (uint64_t)delayMs * 1000000ULL;
+    IPCS_TimerWheelAdd(&threadArg->timers.wheel, &timer->node, timer->expireNs);
+
+    if (timerId != NULL) {
+        *timerId = timer->timerId;
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_ServerCancelTimer(unsigned long long timerId)
+{
+    IPCS_ServerThreadArg *threadArg = IPCS_ServerCurrentThread();
+    IPCS_ServerTimers *timers = NULL;
+    IPCS_ServerTimer *timer = NULL;
+    unsigned int index = (unsigned int)(timerId & 0xFFFFFFFFULL);
+
+    if (threadArg == NULL) {
+        return IPCS_NOT_FOUND;
+    }
+
+    timers = &threadArg->timers;
+    if (index >= timers->cap) {
+        return IPCS_NOT_FOUND;
+    }
+    timer = timers->timers[index];
+    if ((timer == NULL) || (timer->timerId != timerId)) {
+        return IPCS_NOT_FOUND;
+    }
+
+    if (IPCS_TimerNodeIsPending(&timer->node)) {
+        IPCS_TimerWheelCancel(&timers->wheel, &timer->node);
+    }
+    IPCS_ServerTimerFree(timers, timer);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+void IPCS_ServerTimersInit(IPCS_ServerTimers *timers, uint64_t nowNs)
+{
+    (void)memset(timers, 0, sizeof(IPCS_ServerTimers));
+    IPCS_TimerWheelInit(&timers->wheel, IPCS_TIMER_DEFAULT_TICK_NS, nowNs);
+
+    return;
+}
+
+void IPCS_ServerTimersDestroy(IPCS_ServerTimers *timers)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < timers->cap; i++) {
+        free(timers->timers[i]);
+    }
+    free(timers->timers);
+    free(timers->freeIdx);
+    (void)memset(timers, 0, sizeof(IPCS_ServerTimers));
+
+    return;
+}
+
+int IPCS_ServerTimerAlloc(IPCS_ServerTimers *timers, IPCS_ServerTimer *timer)
+{
+    IPCS_ServerTimer **newTimers = NULL;
+    unsigned int *newFree = NULL;
+    unsigned int newCap = 0;
+    unsigned int index = 0;
+    unsigned int i = 0;
+
+    if (timers->freeNum == 0) {
+        newCap = (timers->cap == 0) ? IPCS_TIMER_TABLE_MIN : timers->cap * 2;
+        newTimers = (IPCS_ServerTimer **)realloc(timers->timers, newCap * sizeof(IPCS_ServerTimer *));
+        if (newTimers == NULL) {
+            return IPCS_MALLOC_FAIL;
+        }
+        timers->timers = newTimers;
+
+        newFree = (unsigned int *)realloc(timers->freeIdx, newCap * sizeof(unsigned int));
+        if (newFree == NULL) {
+            return IPCS_MALLOC_FAIL;
+        }
+        timers->freeIdx = newFree;
+
+        /* 小的下标放在栈顶，先被使用 */
+        for (i = newCap; i > timers->cap; i--) {
+            timers->timers[i - 1] = NULL;
+            timers->freeIdx[timers->freeNum++] = i - 1;
+        }
+        timers->cap = newCap;
+    }
+
+    index = timers->freeIdx[--timers->freeNum];
+    timers->seq++;
+    if (timers->seq == 0) {
+        timers->seq = 1;
+    }
+    timer->timerId = ((unsigned long long)timers->seq << 32) | index;
+    timers->timers[index] = timer;
+
+    return IPCS_OK;
+}
+
+void IPCS_ServerTimerFree(IPCS_ServerTimers *timers, IPCS_ServerTimer *timer)
+{
+    unsigned int index = (unsigned int)(timer->timerId & 0xFFFFFFFFULL);
+
+    timers->timers[index] = NULL;
+    timers->freeIdx[timers->freeNum++] = index;
+    free(timer);
+
+    return;
+}
+
+/* 周期定时器在回调之前重新加入时间轮，回调中可以取消自己；回调之后不再访问定时器 */
+void IPCS_ServerTimerExpire(IPCS_TimerNode *node, void *arg)
+{
+    IPCS_ServerTimer *timer = (IPCS_ServerTimer *)arg;
+    IPCS_ServerTimers *timers = &timer->threadArg->timers;
+    IPCS_ServerListener *saved = IPCS_ServerCurrentListener();
+    IPCS_TaskCallback callback = timer->callback;
+    void *callbackArg = timer->arg;
+    uint64_t nowNs = 0;
+
+    (void)node;
+
+    IPCS_ServerSetCurrentListener(timer->listener);
+    if (timer->intervalNs != 0) {
+        /* 落后超过一个间隔时（服务端线程被回调函数阻塞）不补执行，从现在开始计算 */
+        nowNs = IPCS_GetNowNs();
+        timer->expireNs += timer->intervalNs;
+        if (timer->expireNs <= nowNs) {
+            timer->expireNs = nowNs + timer->intervalNs;
+        }
+        IPCS_TimerWheelAdd(&timers->wheel, &timer->node, timer->expireNs);
+        callback(callbackArg);
+    } else {
+        /* 先从表中删除，回调中取消自己时返回IPCS_NOT_FOUND */
+        timers->timers[timer->timerId & 0xFFFFFFFFULL] = NULL;
+        timers->freeIdx[timers->freeNum++] = (unsigned int)(timer->timerId & 0xFFFFFFFFULL);
+        callback(callbackArg);
+        free(timer);
+    }
+    IPCS_ServerSetCurrentListener(saved);
+
+    return;
+}
+
+void IPCS_ServerRunTimers(IPCS_ServerThreadArg *threadArg)
+{
+    if (threadArg->timers.wheel.count == 0) {
+        return;
+    }
+
+    (void)IPCS_TimerWheelAdvance(&threadArg->timers.wheel, IPCS_GetNowNs());
+
+    return;
+}
+
+uint64_t IPCS_ServerTimersNextNs(const IPCS_ServerTimers *timers, uint64_t nowNs)
+{
+    int waitMs = IPCS_TimerWheelNextTimeoutMs(&timers->wheel, nowNs);
+
+    if (waitMs < 0) {
+        return 0;
+    }
+
+    return (waitMs == 0) ? 1 : (uint64_t)waitMs * 1000000ULL;
+}
+
+void IPCS_ServerCancelListenerTimers(IPCS_ServerTimers *timers, IPCS_ServerListener *listener)
+{
+    IPCS_ServerTimer *timer = NULL;
+    unsigned int i = 0;
+
+    for (i = 0; i < timers->cap; i++) {
+        timer = timers->timers[i];
+        if ((timer == NULL) || (timer->listener != listener)) {
+            continue;
+        }
+        if (IPCS_TimerNodeIsPending(&timer->node)) {
+            IPCS_TimerWheelCancel(&timers->wheel, &timer->node);
+        }
+        IPCS_ServerTimerFree(timers, timer);
+    }
+
+    return;
+}
+
+/******************************************************************************/
@@ -0,0 +1,113 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_task.h
+ *
+ *    Description:  IPC socket server thread tasks and timers
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:31:52 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_TASK_H__
+#define __IPCS_TASK_H__
+
+#include "ipcs.h"
+#include "ipcs_timer.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 服务端线程的任务和定时器。任务由其他线程放入服务端线程的任务收件箱（mutex保护），
+ * 通过wakeFd唤醒服务端线程执行；定时器挂在服务端线程自己的时间轮上，只由服务端线程访问，
+ * 每轮事件处理完、发送之前推进。定时器按id在定时器表中查找：低32位为表中的下标，
+ * 高32位为序号，下标被重用后旧的id不会匹配。
+ * 任务和定时器属于提交它的服务端，服务端关闭时未执行的任务和定时器被丢弃。
+ **/
+#define IPCS_TIMER_TABLE_MIN        16
+
+struct IPCS_ServerThreadArg;
+struct IPCS_ServerListener;
+
+typedef struct IPCS_ServerTask {
+    IPCS_TaskCallback task;
+    void *arg;
+    struct IPCS_ServerListener *listener;   /* NULL表示不属于某个服务端（其他线程的发送） */
+    struct IPCS_ServerTask *next;
+} IPCS_ServerTask;
+
+/* 其他线程向连接发送的消息，与任务节点在同一块内存中，负载紧跟其后 */
+typedef struct {
+    int fd;
+    unsigned long long serial;      /* 连接的序号，fd在任务执行之前被新连接重用时丢弃 */
+    IPCS_Priority prio;
+    IPCS_Message msg;
+} IPCS_ServerSendTask;
+
+typedef struct IPCS_ServerTimer {
+    IPCS_TimerNode node;
+    struct IPCS_ServerThreadArg *threadArg;
+    struct IPCS_ServerListener *listener;
+    IPCS_TaskCallback callback;
+    void *arg;
+    uint64_t intervalNs;            /* 0表示只执行一次 */
+    uint64_t expireNs;              /* 本次应到期的时间，周期定时器据此计算下一次，不累积误差 */
+    unsigned long long timerId;
+} IPCS_ServerTimer;
+
+/* 服务端线程的定时器表，空闲的下标放在freeIdx中 */
+typedef struct {
+    IPCS_TimerWheel wheel;
+    IPCS_ServerTimer **timers;
+    unsigned int *freeIdx;
+    unsigned int freeNum;
+    unsigned int cap;
+    unsigned int seq;
+} IPCS_ServerTimers;
+
+/******************************************************************************/
+void IPCS_ServerTimersInit(IPCS_ServerTimers *timers, uint64_t nowNs);
+
+void IPCS_ServerTimersDestroy(IPCS_ServerTimers *timers);
+
+/* 推进时间轮，执行到期的定时器 */
+void IPCS_ServerRunTimers(struct IPCS_ServerThreadArg *threadArg);
+
+/* 距下一个定时器到期的纳秒数，没有定时器时返回0，已到期时返回1 */
+uint64_t IPCS_ServerTimersNextNs(const IPCS_ServerTimers *timers, uint64_t nowNs);
+
+/* 服务端关闭时删除其定时器 */
+void IPCS_ServerCancelListenerTimers(IPCS_ServerTimers *timers, struct IPCS_ServerListener *listener);
+
+void IPCS_ServerTimerExpire(IPCS_TimerNode *node, void *arg);
+
+int IPCS_ServerTimerAlloc(IPCS_ServerTimers *timers, IPCS_ServerTimer *timer);
+
+void IPCS_ServerTimerFree(IPCS_ServerTimers *timers, IPCS_ServerTimer *timer);
+
+/* 取出任务收件箱，依次执行；已关闭的服务端的任务被丢弃 */
+void IPCS_ServerRunTasks(struct IPCS_ServerThreadArg *threadArg);
+
+/* 服务端线程退出时丢弃还没有执行的任务 */
+void IPCS_ServerFreeTasks(struct IPCS_ServerThreadArg *threadArg);
+
+/**
+ * 在服务端线程之外向连接发送：复制消息，交给连接所属的服务端线程发送，与该线程自己的发送
+ * 不会交错；返回时消息还没有发出。fd不是服务端的连接时返回IPCS_NOT_FOUND，
+ * 服务端线程正在停止时返回IPCS_PEER_CLOSED。
+ **/
+int IPCS_ServerPostSend(int fd, IPCS_Message *msg, IPCS_Priority prio);
+
+void IPCS_ServerRunSendTask(void *arg);
+
+/******************************************************************************/
+
+#endif /* __IPCS_TASK_H__ */
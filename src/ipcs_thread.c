@@ -0,0 +1,138 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_thread.c
+ *
+ *    Description:  IPC socket thread placement (CPU affinity, thread name)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:05:17 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+/* cpu_set_t、pthread_attr_setaffinity_np、pthread_setname_np */
+#define _GNU_SOURCE
+
+#include "ipcs_thread.h"
+#include "ipcs_common.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/******************************************************************************/
+/* 解析taskset -c格式的CPU列表，例如"2"、"0-3,8" */
+static int IPCS_ParseCpuList(const char *cpuList, cpu_set_t *cpuSet)
+{
+    const char *pos = cpuList;
+    char *end = NULL;
+    unsigned long first = 0;
+    unsigned long last = 0;
+    unsigned long cpu = 0;
+
+    CPU_ZERO(cpuSet);
+
+    while (*pos != '\0') {
+        if (!isdigit((unsigned char)*pos)) {
+            return IPCS_AFFINITY_FAIL;
+        }
+        first = strtoul(pos, &end, 10);
+        last = first;
+        pos = end;
+
+        if (*pos == '-') {
+            pos++;
+            if (!isdigit((unsigned char)*pos)) {
+                return IPCS_AFFINITY_FAIL;
+            }
+            last = strtoul(pos, &end, 10);
+            pos = end;
+        }
+
+        if ((last < first) || (last >= CPU_SETSIZE)) {
+            return IPCS_AFFINITY_FAIL;
+        }
+        for (cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, cpuSet);
+        }
+
+        if (*pos == ',') {
+            pos++;
+            if (*pos == '\0') {
+                return IPCS_AFFINITY_FAIL;
+            }
+        } else if (*pos != '\0') {
+            return IPCS_AFFINITY_FAIL;
+        }
+    }
+
+    return (CPU_COUNT(cpuSet) != 0) ? IPCS_OK : IPCS_AFFINITY_FAIL;
+}
+
+int IPCS_CheckThreadAttr(const IPCS_ThreadAttr *attr)
+{
+    cpu_set_t cpuSet;
+
+    if ((attr == NULL) || (attr->cpuList[0] == '\0')) {
+        return IPCS_OK;
+    }
+
+    if (IPCS_ParseCpuList(attr->cpuList, &cpuSet) != IPCS_OK) {
+        IPCS_WriteLog("Check thread attr: bad cpu list: %s", attr->cpuList);
+        return IPCS_AFFINITY_FAIL;
+    }
+
+    return IPCS_OK;
+}
+
+int IPCS_ThreadAttrSetAffinity(pthread_attr_t *threadAttr, const IPCS_ThreadAttr *attr)
+{
+    cpu_set_t cpuSet;
+    int result = 0;
+
+    if ((attr == NULL) || (attr->cpuList[0] == '\0')) {
+        return IPCS_OK;
+    }
+
+    result = IPCS_ParseCpuList(attr->cpuList, &cpuSet);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Set thread affinity: bad cpu list: %s", attr->cpuList);
+        return result;
+    }
+
+    result = pthread_attr_setaffinity_np(threadAttr, sizeof(cpuSet), &cpuSet);
+    if (result != 0) {
+        IPCS_WriteLog("Set thread affinity: %s fail: %d", attr->cpuList, result);
+        return IPCS_AFFINITY_FAIL;
+    }
+
+    return IPCS_OK;
+}
+
+void IPCS_ThreadSetName(pthread_t threadId, const IPCS_ThreadAttr *attr, const char *defaultName)
+{
+    char name[IPCS_THREAD_NAME_MAX_LEN];
+
+    if ((attr != NULL) && (attr->name[0] != '\0')) {
+        (void)snprintf(name, sizeof(name), "%s", attr->name);
+    } else if (defaultName != NULL) {
+        (void)snprintf(name, sizeof(name), "%s", defaultName);
+    } else {
+        return;
+    }
+
+    /* 线程名只用于ps、top、perf等工具，设置失败不影响线程运行 */
+    (void)pthread_setname_np(threadId, name);
+
+    return;
+}
+
+/******************************************************************************/
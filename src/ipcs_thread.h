@@ -0,0 +1,47 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_thread.h
+ *
+ *    Description:  IPC socket thread placement (CPU affinity, thread name)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:05:17 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_THREAD_H__
+#define __IPCS_THREAD_H__
+
+#include "ipcs.h"
+
+#include <pthread.h>
+
+/******************************************************************************/
+/**
+ * 库内部线程的放置。线程创建属性中设置CPU亲和性，新线程从第一条指令起就运行在指定的CPU上；
+ * 线程自己分配的缓冲区（连接的收发缓冲区、io_uring的ring和provided buffer等）按Linux默认的
+ * 首次访问策略分配在该CPU所在的NUMA节点上。
+ **/
+#define IPCS_SERVER_THREAD_NAME     "ipcs-server"
+#define IPCS_CLIENT_THREAD_NAME     "ipcs-client"
+#define IPCS_WORKER_PROCESS_NAME    "ipcs-worker"
+
+/******************************************************************************/
+/* 检查CPU列表的格式，空串表示不绑定 */
+int IPCS_CheckThreadAttr(const IPCS_ThreadAttr *attr);
+
+int IPCS_ThreadAttrSetAffinity(pthread_attr_t *threadAttr, const IPCS_ThreadAttr *attr);
+
+/* attr中没有线程名时使用defaultName，都为空时不设置 */
+void IPCS_ThreadSetName(pthread_t threadId, const IPCS_ThreadAttr *attr, const char *defaultName);
+
+/******************************************************************************/
+
+#endif /* __IPCS_THREAD_H__ */
@@ -0,0 +1,238 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_timer.c
+ *
+ *    Description:  IPC socket hierarchical timing wheel
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 03:30:51 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_timer.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/******************************************************************************/
+#define IPCS_TIMER_MAX_DELTA    ((1ULL << (IPCS_TIMER_LEVEL_BITS * IPCS_TIMER_LEVELS)) - 1)
+
+void IPCS_TimerWheelInit(IPCS_TimerWheel *wheel, uint64_t tickNs, uint64_t nowNs)
+{
+    (void)memset(wheel, 0, sizeof(IPCS_TimerWheel));
+    wheel->tickNs = (tickNs == 0) ? IPCS_TIMER_DEFAULT_TICK_NS : tickNs;
+    wheel->curTick = nowNs / wheel->tickNs;
+
+    return;
+}
+
+void IPCS_TimerNodeInit(IPCS_TimerNode *node, IPCS_TimerCallback func, void *arg)
+{
+    (void)memset(node, 0, sizeof(IPCS_TimerNode));
+    node->func = func;
+    node->arg = arg;
+
+    return;
+}
+
+int IPCS_TimerNodeIsPending(const IPCS_TimerNode *node)
+{
+    return (node->pprev != NULL);
+}
+
+/******************************************************************************/
+void IPCS_TimerSlotLink(IPCS_TimerWheel *wheel, unsigned int level, unsigned int slot, IPCS_TimerNode *node)
+{
+    IPCS_TimerNode **head = &wheel->slots[level][slot];
+
+    node->next = *head;
+    if (*head != NULL) {
+        (*head)->pprev = &node->next;
+    }
+    *head = node;
+    node->pprev = head;
+
+    wheel->bitmap[level] |= (1ULL << slot);
+
+    return;
+}
+
+void IPCS_TimerSlotUnlink(IPCS_TimerWheel *wheel, IPCS_TimerNode *node)
+{
+    unsigned int level = 0;
+    unsigned int slot = 0;
+    IPCS_TimerNode **head = NULL;
+
+    *node->pprev = node->next;
+    if (node->next != NULL) {
+        node->next->pprev = node->pprev;
+    }
+
+    /* 槽变空时清除位图，pprev指向槽头时可以直接算出槽的位置 */
+    if ((node->next == NULL) && (node->pprev >= &wheel->slots[0][0]) &&
+        (node->pprev <= &wheel->slots[IPCS_TIMER_LEVELS - 1][IPCS_TIMER_SLOTS - 1])) {
+        head = node->pprev;
+        level = (unsigned int)((head - &wheel->slots[0][0]) / IPCS_TIMER_SLOTS);
+        slot = (unsigned int)((head - &wheel->slots[0][0]) % IPCS_TIMER_SLOTS);
+        if (*head == NULL) {
+            wheel->bitmap[level] &= ~(1ULL << slot);
+        }
+    }
+
+    node->next = NULL;
+    node->pprev = NULL;
+
+    return;
+}
+
+/* expireTick可以等于curTick（重新分配时），此时放入当前槽，随后立即到期 */
+void IPCS_TimerWheelPlace(IPCS_TimerWheel *wheel, IPCS_TimerNode *node)
+{
+    uint64_t delta = node->expireTick - wheel->curTick;
+    unsigned int level = 0;
+    unsigned int slot = 0;
+
+    for (level = 0; level < IPCS_TIMER_LEVELS - 1; level++) {
+        if (delta < (1ULL << (IPCS_TIMER_LEVEL_BITS * (level + 1)))) {
+            break;
+        }
+    }
+
+    slot = (unsigned int)((node->expireTick >> (IPCS_TIMER_LEVEL_BITS * level)) & IPCS_TIMER_SLOT_MASK);
+    IPCS_TimerSlotLink(wheel, level, slot, node);
+
+    return;
+}
+
+void IPCS_TimerWheelAdd(IPCS_TimerWheel *wheel, IPCS_TimerNode *node, uint64_t expireNs)
+{
+    uint64_t expireTick = (expireNs + wheel->tickNs - 1) / wheel->tickNs;
+
+    if (IPCS_TimerNodeIsPending(node)) {
+        IPCS_TimerWheelCancel(wheel, node);
+    }
+
+    /* 已经到期的定时器在下一个tick触发 */
+    if (expireTick <= wheel->curTick) {
+        expireTick = wheel->curTick + 1;
+    }
+
+    if (expireTick - wheel->curTick > IPCS_TIMER_MAX_DELTA) {
+        expireTick = wheel->curTick + IPCS_TIMER_MAX_DELTA;
+    }
+
+    node->expireTick = expireTick;
+    IPCS_TimerWheelPlace(wheel, node);
+    wheel->count++;
+
+    return;
+}
+
+void IPCS_TimerWheelCancel(IPCS_TimerWheel *wheel, IPCS_TimerNode *node)
+{
+    if (!IPCS_TimerNodeIsPending(node)) {
+        return;
+    }
+
+    IPCS_TimerSlotUnlink(wheel, node);
+    wheel->count--;
+
+    return;
+}
+
+/******************************************************************************/
+/* 把第level层当前槽的定时器重新分配到下层 */
+void IPCS_TimerWheelCascade(IPCS_TimerWheel *wheel, unsigned int level)
+{
+    unsigned int slot = (unsigned int)((wheel->curTick >> (IPCS_TIMER_LEVEL_BITS * level)) & IPCS_TIMER_SLOT_MASK);
+    IPCS_TimerNode *list = wheel->slots[level][slot];
+    IPCS_TimerNode *node = NULL;
+
+    wheel->slots[level][slot] = NULL;
+    wheel->bitmap[level] &= ~(1ULL << slot);
+
+    while (list != NULL) {
+        node = list;
+        list = node->next;
+        node->next = NULL;
+        node->pprev = NULL;
+        IPCS_TimerWheelPlace(wheel, node);
+    }
+
+    return;
+}
+
+unsigned int IPCS_TimerWheelAdvance(IPCS_TimerWheel *wheel, uint64_t nowNs)
+{
+    uint64_t targetTick = nowNs / wheel->tickNs;
+    unsigned int expired = 0;
+    unsigned int level = 0;
+    unsigned int slot = 0;
+    IPCS_TimerNode *node = NULL;
+
+    while (wheel->curTick < targetTick) {
+        /* 没有定时器时直接跳到目标时间 */
+        if (wheel->count == 0) {
+            wheel->curTick = targetTick;
+            break;
+        }
+
+        wheel->curTick++;
+
+        /* 下层转完一圈时重新分配上层的当前槽，从高层到低层，保证重新分配的定时器不会落入已处理的槽 */
+        for (level = 1; level < IPCS_TIMER_LEVELS; level++) {
+            if (((wheel->curTick >> (IPCS_TIMER_LEVEL_BITS * (level - 1))) & IPCS_TIMER_SLOT_MASK) != 0) {
+                break;
+            }
+        }
+        while (--level > 0) {
+            IPCS_TimerWheelCascade(wheel, level);
+        }
+
+        slot = (unsigned int)(wheel->curTick & IPCS_TIMER_SLOT_MASK);
+        while ((node = wheel->slots[0][slot]) != NULL) {
+            IPCS_TimerSlotUnlink(wheel, node);
+            wheel->count--;
+            expired++;
+            node->func(node, node->arg);
+        }
+    }
+
+    return expired;
+}
+
+int IPCS_TimerWheelNextTimeoutMs(const IPCS_TimerWheel *wheel, uint64_t nowNs)
+{
+    unsigned int curSlot = (unsigned int)(wheel->curTick & IPCS_TIMER_SLOT_MASK);
+    uint64_t pending = 0;
+    uint64_t ticks = 0;
+    uint64_t wakeNs = 0;
+
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    /* 第0层当前槽之后、本圈结束之前最近的非空槽；没有时在本圈结束时醒来重新分配上层的槽 */
+    pending = (curSlot == IPCS_TIMER_SLOT_MASK) ? 0 : (wheel->bitmap[0] & (~0ULL << (curSlot + 1)));
+    if (pending != 0) {
+        ticks = (uint64_t)__builtin_ctzll(pending) - curSlot;
+    } else {
+        ticks = IPCS_TIMER_SLOTS - curSlot;
+    }
+
+    wakeNs = (wheel->curTick + ticks) * wheel->tickNs;
+    if (wakeNs <= nowNs) {
+        return 0;
+    }
+
+    return (int)((wakeNs - nowNs + 999999ULL) / 1000000ULL);
+}
+
+/******************************************************************************/
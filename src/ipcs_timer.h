@@ -0,0 +1,84 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_timer.h
+ *
+ *    Description:  IPC socket hierarchical timing wheel
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 03:30:51 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_TIMER_H__
+#define __IPCS_TIMER_H__
+
+#include <stdint.h>
+
+/******************************************************************************/
+/**
+ * 分层时间轮：IPCS_TIMER_LEVELS层，每层IPCS_TIMER_SLOTS个槽。
+ * 第0层每个槽为1个tick，第n层每个槽为64^n个tick，超时时间最长为64^6个tick
+ * （tick为1ms时约795天，更长的超时被截断到最大值）。
+ * 添加、删除定时器都是O(1)；推进时间时，只有低层转完一圈才把上一层的一个槽重新分配到下层。
+ *
+ * 时间轮本身不加锁，由使用者（驱动时间轮的reactor线程）保证互斥。
+ **/
+#define IPCS_TIMER_LEVEL_BITS   6
+#define IPCS_TIMER_SLOTS        (1 << IPCS_TIMER_LEVEL_BITS)
+#define IPCS_TIMER_SLOT_MASK    (IPCS_TIMER_SLOTS - 1)
+#define IPCS_TIMER_LEVELS       6
+
+#define IPCS_TIMER_DEFAULT_TICK_NS  1000000ULL   /* 1ms */
+
+struct IPCS_TimerNode;
+typedef void (*IPCS_TimerCallback)(struct IPCS_TimerNode *node, void *arg);
+
+typedef struct IPCS_TimerNode {
+    struct IPCS_TimerNode *next;
+    struct IPCS_TimerNode **pprev;  /* 为NULL表示不在时间轮中 */
+    uint64_t expireTick;
+    IPCS_TimerCallback func;
+    void *arg;
+} IPCS_TimerNode;
+
+typedef struct {
+    uint64_t tickNs;
+    uint64_t curTick;
+    unsigned int count;
+    uint64_t bitmap[IPCS_TIMER_LEVELS];    /* 非空槽的位图 */
+    IPCS_TimerNode *slots[IPCS_TIMER_LEVELS][IPCS_TIMER_SLOTS];
+} IPCS_TimerWheel;
+
+/******************************************************************************/
+void IPCS_TimerWheelInit(IPCS_TimerWheel *wheel, uint64_t tickNs, uint64_t nowNs);
+
+void IPCS_TimerNodeInit(IPCS_TimerNode *node, IPCS_TimerCallback func, void *arg);
+
+int IPCS_TimerNodeIsPending(const IPCS_TimerNode *node);
+
+/* 添加定时器，expireNs为CLOCK_MONOTONIC的绝对时间；已在时间轮中的定时器先被删除 */
+void IPCS_TimerWheelAdd(IPCS_TimerWheel *wheel, IPCS_TimerNode *node, uint64_t expireNs);
+
+void IPCS_TimerWheelCancel(IPCS_TimerWheel *wheel, IPCS_TimerNode *node);
+
+/* 推进到nowNs，依次调用到期定时器的回调函数，回调中可以添加或删除定时器；返回到期的个数 */
+unsigned int IPCS_TimerWheelAdvance(IPCS_TimerWheel *wheel, uint64_t nowNs);
+
+/* 返回下一次需要推进时间轮的等待时间（毫秒，向上取整），没有定时器时返回-1，可直接用于poll/epoll_wait */
+int IPCS_TimerWheelNextTimeoutMs(const IPCS_TimerWheel *wheel, uint64_t nowNs);
+
+/******************************************************************************/
+void IPCS_TimerSlotLink(IPCS_TimerWheel *wheel, unsigned int level, unsigned int slot, IPCS_TimerNode *node);
+void IPCS_TimerSlotUnlink(IPCS_TimerWheel *wheel, IPCS_TimerNode *node);
+void IPCS_TimerWheelPlace(IPCS_TimerWheel *wheel, IPCS_TimerNode *node);
+void IPCS_TimerWheelCascade(IPCS_TimerWheel *wheel, unsigned int level);
+
+/******************************************************************************/
+#endif /* __IPCS_TIMER_H__ */
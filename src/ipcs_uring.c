@@ -0,0 +1,452 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_uring.c
+ *
+ *    Description:  IPC socket io_uring wrapper (raw syscalls, no liburing)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:12:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "ipcs_uring.h"
+#include "ipcs_common.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/******************************************************************************/
+static int IPCS_SysUringSetup(unsigned int entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IPCS_SysUringEnter(int ringFd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags,
+        const void *arg, size_t argLen)
+{
+    return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, arg, argLen);
+}
+
+static int IPCS_SysUringRegister(int ringFd, unsigned int opcode, const void *arg, unsigned int argNum)
+{
+    return (int)syscall(__NR_io_uring_register, ringFd, opcode, arg, argNum);
+}
+
+/******************************************************************************/
+int IPCS_UringMapRings(IPCS_Uring *ring, const struct io_uring_params *params)
+{
+    unsigned int *sqArray = NULL;
+    unsigned int i = 0;
+
+    ring->sqRingLen = params->sq_off.array + params->sq_entries * sizeof(unsigned int);
+    ring->cqRingLen = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cqRingLen > ring->sqRingLen) {
+            ring->sqRingLen = ring->cqRingLen;
+        }
+        ring->cqRingLen = ring->sqRingLen;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring->ringFd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        ring->sqRing = NULL;
+        return IPCS_MMAP_FAIL;
+    }
+
+    if (ring->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cqRing = ring->sqRing;
+    } else {
+        ring->cqRing = mmap(NULL, ring->cqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring->ringFd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) {
+            ring->cqRing = NULL;
+            return IPCS_MMAP_FAIL;
+        }
+    }
+
+    ring->sqesLen = params->sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring->ringFd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        return IPCS_MMAP_FAIL;
+    }
+
+    ring->sqHead = (unsigned int *)((char *)ring->sqRing + params->sq_off.head);
+    ring->sqTail = (unsigned int *)((char *)ring->sqRing + params->sq_off.tail);
+    ring->sqFlags = (unsigned int *)((char *)ring->sqRing + params->sq_off.flags);
+    ring->sqMask = *(unsigned int *)((char *)ring->sqRing + params->sq_off.ring_mask);
+    ring->sqEntries = params->sq_entries;
+    ring->cqHead = (unsigned int *)((char *)ring->cqRing + params->cq_off.head);
+    ring->cqTail = (unsigned int *)((char *)ring->cqRing + params->cq_off.tail);
+    ring->cqMask = *(unsigned int *)((char *)ring->cqRing + params->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cqRing + params->cq_off.cqes);
+
+    /* SQ数组固定为恒等映射，提交时只需要移动尾部 */
+    sqArray = (unsigned int *)((char *)ring->sqRing + params->sq_off.array);
+    for (i = 0; i < params->sq_entries; i++) {
+        sqArray[i] = i;
+    }
+
+    ring->sqeTail = *ring->sqTail;
+    ring->sqeHead = ring->sqeTail;
+
+    return IPCS_OK;
+}
+
+int IPCS_UringInit(IPCS_Uring *ring, unsigned int entries)
+{
+    struct io_uring_params params;
+    int result = IPCS_OK;
+
+    (void)memset(ring, 0, sizeof(IPCS_Uring));
+
+    /* 每个ring只由创建它的线程使用，完成事件在该线程下次进入内核时处理，减少跨核中断；
+     * 有待处理的完成事件时内核在SQ flags中设置IORING_SQ_TASKRUN，忙等时据此决定是否进入内核。
+     * 老内核不支持这些标志时退回默认参数 */
+    (void)memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_TASKRUN_FLAG;
+    ring->ringFd = IPCS_SysUringSetup(entries, &params);
+    if ((ring->ringFd < 0) && (errno == EINVAL)) {
+        (void)memset(&params, 0, sizeof(params));
+        ring->ringFd = IPCS_SysUringSetup(entries, &params);
+    }
+
+    if (ring->ringFd < 0) {
+        IPCS_WriteLog("Uring setup fail, errno: %d", errno);
+        return IPCS_URING_FAIL;
+    }
+    ring->features = params.features;
+
+    result = IPCS_UringMapRings(ring, &params);
+    if (result != IPCS_OK) {
+        IPCS_WriteLog("Uring: %d mmap rings fail, errno: %d", ring->ringFd, errno);
+        IPCS_UringExit(ring);
+        return result;
+    }
+
+    return IPCS_OK;
+}
+
+void IPCS_UringExit(IPCS_Uring *ring)
+{
+    if (ring->sqes != NULL) {
+        (void)munmap(ring->sqes, ring->sqesLen);
+    }
+
+    if ((ring->cqRing != NULL) && (ring->cqRing != ring->sqRing)) {
+        (void)munmap(ring->cqRing, ring->cqRingLen);
+    }
+
+    if (ring->sqRing != NULL) {
+        (void)munmap(ring->sqRing, ring->sqRingLen);
+    }
+
+    if (ring->ringFd >= 0) {
+        (void)close(ring->ringFd);
+    }
+
+    (void)memset(ring, 0, sizeof(IPCS_Uring));
+    ring->ringFd = -1;
+
+    return;
+}
+
+/******************************************************************************/
+struct io_uring_sqe *IPCS_UringGetSqe(IPCS_Uring *ring)
+{
+    struct io_uring_sqe *sqe = NULL;
+    unsigned int head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+
+    if (ring->sqeTail - head >= ring->sqEntries) {
+        (void)IPCS_UringSubmitAndWait(ring, 0, 0);
+        head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        if (ring->sqeTail - head >= ring->sqEntries) {
+            return NULL;
+        }
+    }
+
+    sqe = &ring->sqes[ring->sqeTail & ring->sqMask];
+    ring->sqeTail++;
+    (void)memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+int IPCS_UringSubmitAndWait(IPCS_Uring *ring, unsigned int waitNr, uint64_t timeoutNs)
+{
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    unsigned int toSubmit = ring->sqeTail - ring->sqeHead;
+    unsigned int flags = 0;
+    int result = 0;
+
+    /* 已有完成事件时不等待 */
+    if ((waitNr != 0) && (__atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE) != *ring->cqHead)) {
+        waitNr = 0;
+    }
+
+    if ((toSubmit == 0) && (waitNr == 0)) {
+        return IPCS_OK;
+    }
+
+    __atomic_store_n(ring->sqTail, ring->sqeTail, __ATOMIC_RELEASE);
+
+    if (waitNr != 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+
+    for (; ; ) {
+        ring->enterCalls++;
+        if ((waitNr != 0) && (timeoutNs != 0)) {
+            ts.tv_sec = (long long)(timeoutNs / 1000000000ULL);
+            ts.tv_nsec = (long long)(timeoutNs % 1000000000ULL);
+            (void)memset(&arg, 0, sizeof(arg));
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            result = IPCS_SysUringEnter(ring->ringFd, toSubmit, waitNr, flags | IORING_ENTER_EXT_ARG,
+                    &arg, sizeof(arg));
+        } else {
+            result = IPCS_SysUringEnter(ring->ringFd, toSubmit, waitNr, flags, NULL, 0);
+        }
+
+        if (result >= 0) {
+            ring->sqeHead += (unsigned int)result;
+            if (ring->sqeHead == ring->sqeTail) {
+                break;
+            }
+            /* 没有提交完时继续提交，不再等待 */
+            toSubmit = ring->sqeTail - ring->sqeHead;
+            waitNr = 0;
+            flags = 0;
+            continue;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if ((errno == ETIME) || (errno == EBUSY) || (errno == EAGAIN)) {
+            /* 超时或完成队列满：先处理已有的完成事件 */
+            ring->sqeHead = ring->sqeTail - (*ring->sqTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE));
+            break;
+        }
+
+        IPCS_WriteLog("Uring: %d enter fail, errno: %d", ring->ringFd, errno);
+        return IPCS_URING_FAIL;
+    }
+
+    return IPCS_OK;
+}
+
+struct io_uring_cqe *IPCS_UringPeekCqe(IPCS_Uring *ring)
+{
+    unsigned int head = *ring->cqHead;
+
+    if (head == __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    return &ring->cqes[head & ring->cqMask];
+}
+
+/* COOP_TASKRUN时完成事件要等本线程进入内核才写入完成队列，不需要时不进入内核 */
+int IPCS_UringReapNoWait(IPCS_Uring *ring)
+{
+    int result = 0;
+
+    if (!(__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN)) {
+        return IPCS_OK;
+    }
+
+    ring->enterCalls++;
+    result = IPCS_SysUringEnter(ring->ringFd, 0, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+    if ((result < 0) && (errno != EINTR) && (errno != EBUSY) && (errno != EAGAIN)) {
+        IPCS_WriteLog("Uring: %d reap fail, errno: %d", ring->ringFd, errno);
+        return IPCS_URING_FAIL;
+    }
+
+    return IPCS_OK;
+}
+
+unsigned int IPCS_UringCqReady(const IPCS_Uring *ring)
+{
+    return __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE) - *ring->cqHead;
+}
+
+void IPCS_UringCqAdvance(IPCS_Uring *ring, unsigned int num)
+{
+    __atomic_store_n(ring->cqHead, *ring->cqHead + num, __ATOMIC_RELEASE);
+
+    return;
+}
+
+/******************************************************************************/
+void IPCS_UringPrepAcceptMulti(struct io_uring_sqe *sqe, int fd, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = userData;
+
+    return;
+}
+
+void IPCS_UringPrepAccept(struct io_uring_sqe *sqe, int fd, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->user_data = userData;
+
+    return;
+}
+
+void IPCS_UringPrepRecvMulti(struct io_uring_sqe *sqe, int fd, unsigned short bgid, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = bgid;
+    sqe->user_data = userData;
+
+    return;
+}
+
+void IPCS_UringPrepSend(struct io_uring_sqe *sqe, int fd, const void *buf, size_t len, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (unsigned int)len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData;
+
+    return;
+}
+
+void IPCS_UringPrepSendMsg(struct io_uring_sqe *sqe, int fd, const struct msghdr *msg, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData;
+
+    return;
+}
+
+void IPCS_UringPrepPollMulti(struct io_uring_sqe *sqe, int fd, unsigned int events, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = userData;
+
+    return;
+}
+
+void IPCS_UringPrepCancel(struct io_uring_sqe *sqe, uint64_t targetData, uint64_t userData)
+{
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = targetData;
+    sqe->user_data = userData;
+
+    return;
+}
+
+/******************************************************************************/
+int IPCS_UringBufRingInit(IPCS_Uring *ring, IPCS_UringBufRing *bufRing, unsigned short bgid,
+        unsigned int bufNum, unsigned int bufLen)
+{
+    struct io_uring_buf_reg reg;
+    unsigned int i = 0;
+    int result = 0;
+
+    (void)memset(bufRing, 0, sizeof(IPCS_UringBufRing));
+    bufRing->bufNum = bufNum;
+    bufRing->bufLen = bufLen;
+    bufRing->bgid = bgid;
+
+    bufRing->ringLen = bufNum * sizeof(struct io_uring_buf);
+    bufRing->ring = mmap(NULL, bufRing->ringLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRing->ring == MAP_FAILED) {
+        bufRing->ring = NULL;
+        return IPCS_MMAP_FAIL;
+    }
+
+    bufRing->bufs = (char *)malloc((size_t)bufNum * bufLen);
+    if (bufRing->bufs == NULL) {
+        IPCS_UringBufRingExit(bufRing);
+        return IPCS_MALLOC_FAIL;
+    }
+
+    (void)memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)bufRing->ring;
+    reg.ring_entries = bufNum;
+    reg.bgid = bgid;
+    result = IPCS_SysUringRegister(ring->ringFd, IORING_REGISTER_PBUF_RING, &reg, 1);
+    if (result != 0) {
+        IPCS_WriteLog("Uring: %d register buffer ring fail, errno: %d", ring->ringFd, errno);
+        IPCS_UringBufRingExit(bufRing);
+        return IPCS_URING_FAIL;
+    }
+
+    for (i = 0; i < bufNum; i++) {
+        bufRing->ring->bufs[i].addr = (uint64_t)(uintptr_t)(bufRing->bufs + (size_t)i * bufLen);
+        bufRing->ring->bufs[i].len = bufLen;
+        bufRing->ring->bufs[i].bid = (unsigned short)i;
+    }
+    __atomic_store_n(&bufRing->ring->tail, (unsigned short)bufNum, __ATOMIC_RELEASE);
+
+    return IPCS_OK;
+}
+
+/* 缓冲区随ring关闭自动注销，只释放内存 */
+void IPCS_UringBufRingExit(IPCS_UringBufRing *bufRing)
+{
+    if (bufRing->ring != NULL) {
+        (void)munmap(bufRing->ring, bufRing->ringLen);
+    }
+
+    free(bufRing->bufs);
+    (void)memset(bufRing, 0, sizeof(IPCS_UringBufRing));
+
+    return;
+}
+
+char *IPCS_UringBufRingGet(IPCS_UringBufRing *bufRing, unsigned int bid)
+{
+    return bufRing->bufs + (size_t)bid * bufRing->bufLen;
+}
+
+void IPCS_UringBufRingRecycle(IPCS_UringBufRing *bufRing, unsigned int bid)
+{
+    unsigned short tail = bufRing->ring->tail;
+    struct io_uring_buf *buf = &bufRing->ring->bufs[tail & (bufRing->bufNum - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)IPCS_UringBufRingGet(bufRing, bid);
+    buf->len = bufRing->bufLen;
+    buf->bid = (unsigned short)bid;
+    __atomic_store_n(&bufRing->ring->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+
+    return;
+}
+
+/******************************************************************************/
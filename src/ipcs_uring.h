@@ -0,0 +1,138 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ipcs_uring.h
+ *
+ *    Description:  IPC socket io_uring wrapper (raw syscalls, no liburing)
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:12:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __IPCS_URING_H__
+#define __IPCS_URING_H__
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/******************************************************************************/
+/**
+ * 只封装本库用到的部分：提交队列、完成队列、provided buffer ring，以及accept、recv、send、
+ * poll几种请求。直接使用io_uring_setup/io_uring_enter/io_uring_register系统调用，不依赖liburing。
+ * 一个IPCS_Uring只能由一个线程使用。
+ **/
+#define IPCS_URING_ENTRIES          256
+
+/* io_uring请求的user_data：高位为fd，低8位为请求类型 */
+#define IPCS_URING_OP_ACCEPT    1
+#define IPCS_URING_OP_RECV      2
+#define IPCS_URING_OP_SEND      3
+#define IPCS_URING_OP_WAKE      4
+#define IPCS_URING_OP_CANCEL    5
+#define IPCS_URING_OP_RECV_CANCEL   6   /* 暂停接收时取消recv，和退出时取消accept区分 */
+
+#define IPCS_URING_USER_DATA(fd, op)    (((uint64_t)(uint32_t)(fd) << 8) | (op))
+#define IPCS_URING_USER_FD(data)        ((int)(uint32_t)((data) >> 8))
+#define IPCS_URING_USER_OP(data)        ((unsigned int)((data) & 0xFF))
+
+typedef struct {
+    int ringFd;
+    unsigned int features;
+
+    /* 提交队列 */
+    unsigned int *sqHead;
+    unsigned int *sqTail;
+    unsigned int *sqFlags;          /* IORING_SQ_TASKRUN等，由内核设置 */
+    unsigned int sqMask;
+    unsigned int sqEntries;
+    struct io_uring_sqe *sqes;
+    unsigned int sqeTail;           /* 本地已填写的尾部，提交时写回sqTail */
+    unsigned int sqeHead;           /* 已提交的位置 */
+
+    /* 完成队列 */
+    unsigned int *cqHead;
+    unsigned int *cqTail;
+    unsigned int cqMask;
+    struct io_uring_cqe *cqes;
+
+    void *sqRing;
+    size_t sqRingLen;
+    void *cqRing;
+    size_t cqRingLen;
+    size_t sqesLen;
+
+    uint64_t enterCalls;            /* io_uring_enter的调用次数 */
+} IPCS_Uring;
+
+/* provided buffer ring：内核收到数据时从中取一个缓冲区，CQE中返回缓冲区ID */
+typedef struct {
+    struct io_uring_buf_ring *ring;
+    size_t ringLen;
+    char *bufs;
+    unsigned int bufNum;            /* 2的幂 */
+    unsigned int bufLen;
+    unsigned short bgid;
+} IPCS_UringBufRing;
+
+/******************************************************************************/
+int IPCS_UringInit(IPCS_Uring *ring, unsigned int entries);
+
+void IPCS_UringExit(IPCS_Uring *ring);
+
+int IPCS_UringMapRings(IPCS_Uring *ring, const struct io_uring_params *params);
+
+/* 提交队列满时先提交已填写的请求 */
+struct io_uring_sqe *IPCS_UringGetSqe(IPCS_Uring *ring);
+
+/* 提交所有已填写的请求，waitNr不为0时等待至少waitNr个完成事件；timeoutNs为0表示不超时 */
+int IPCS_UringSubmitAndWait(IPCS_Uring *ring, unsigned int waitNr, uint64_t timeoutNs);
+
+/* 不阻塞地收割完成事件，有待处理的task work时进入内核，用于忙等 */
+int IPCS_UringReapNoWait(IPCS_Uring *ring);
+
+/* 当前可取的完成事件个数 */
+unsigned int IPCS_UringCqReady(const IPCS_Uring *ring);
+
+/* 取下一个完成事件，没有时返回NULL；处理完后调用IPCS_UringCqAdvance */
+struct io_uring_cqe *IPCS_UringPeekCqe(IPCS_Uring *ring);
+
+void IPCS_UringCqAdvance(IPCS_Uring *ring, unsigned int num);
+
+/******************************************************************************/
+void IPCS_UringPrepAcceptMulti(struct io_uring_sqe *sqe, int fd, uint64_t userData);
+
+void IPCS_UringPrepAccept(struct io_uring_sqe *sqe, int fd, uint64_t userData);
+
+void IPCS_UringPrepRecvMulti(struct io_uring_sqe *sqe, int fd, unsigned short bgid, uint64_t userData);
+
+void IPCS_UringPrepSend(struct io_uring_sqe *sqe, int fd, const void *buf, size_t len, uint64_t userData);
+
+void IPCS_UringPrepSendMsg(struct io_uring_sqe *sqe, int fd, const struct msghdr *msg, uint64_t userData);
+
+void IPCS_UringPrepPollMulti(struct io_uring_sqe *sqe, int fd, unsigned int events, uint64_t userData);
+
+/* 取消user_data为targetData的请求 */
+void IPCS_UringPrepCancel(struct io_uring_sqe *sqe, uint64_t targetData, uint64_t userData);
+
+/******************************************************************************/
+int IPCS_UringBufRingInit(IPCS_Uring *ring, IPCS_UringBufRing *bufRing, unsigned short bgid,
+        unsigned int bufNum, unsigned int bufLen);
+
+void IPCS_UringBufRingExit(IPCS_UringBufRing *bufRing);
+
+char *IPCS_UringBufRingGet(IPCS_UringBufRing *bufRing, unsigned int bid);
+
+/* 把用完的缓冲区还给内核 */
+void IPCS_UringBufRingRecycle(IPCS_UringBufRing *bufRing, unsigned int bid);
+
+/******************************************************************************/
+#endif /* __IPCS_URING_H__ */
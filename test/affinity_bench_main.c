@@ -0,0 +1,313 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  affinity_bench_main.c
+ *
+ *    Description:  CPU affinity benchmark
+ *
+ *                  主线程通过同步客户端逐个调用回显服务端，同时运行若干不绑定CPU的干扰线程
+ *                  （忙等和睡眠交替，促使调度器迁移线程）。先在服务端线程和主线程都不绑定CPU时
+ *                  运行，再用IPCS_ServerAttr.thread把服务端线程绑定到-S指定的CPU、主线程绑定到
+ *                  -C指定的CPU运行，比较往返时延的尾部和服务端线程被迁移的次数。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:31:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+/* pthread_setaffinity_np、CPU_SET */
+#define _GNU_SOURCE
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define AFFINITY_MSG_TYPE       0x4146   /* "AF" */
+#define AFFINITY_SERVER_NAME    "@ipcs_affinity_bench"
+#define AFFINITY_THREAD_NAME    "affb-server"
+#define AFFINITY_MAX_NOISE      64
+#define AFFINITY_NOISE_BUSY_US  200
+#define AFFINITY_NOISE_IDLE_US  50
+
+static double g_DurationSec = 3.0;
+static char g_ServerCpus[IPCS_CPU_LIST_MAX_LEN] = "0";
+static char g_ClientCpus[IPCS_CPU_LIST_MAX_LEN] = "";
+static unsigned int g_NoiseNum = 0;
+static unsigned int g_PayloadLen = 64;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+
+static volatile int g_NoiseStopping = 0;
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+int AffinityServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 忙等和睡眠交替，让调度器不断在CPU之间迁移线程 */
+static void *AffinityNoiseRun(void *arg)
+{
+    uint64_t endNs = 0;
+
+    while (!g_NoiseStopping) {
+        endNs = BENCH_NowNs() + AFFINITY_NOISE_BUSY_US * BENCH_NS_PER_US;
+        while (BENCH_NowNs() < endNs) {
+        }
+        (void)usleep(AFFINITY_NOISE_IDLE_US);
+    }
+
+    return NULL;
+}
+
+/* 按名字找到线程，累加/proc中的se.nr_migrations；没有调度统计时返回-1 */
+static long long AffinityThreadMigrations(const char *threadName)
+{
+    char path[300];
+    char line[256];
+    struct dirent *entry = NULL;
+    long long total = -1;
+    long long num = 0;
+    FILE *file = NULL;
+    DIR *dir = opendir("/proc/self/task");
+
+    if (dir == NULL) {
+        return -1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        (void)snprintf(path, sizeof(path), "/proc/self/task/%s/comm", entry->d_name);
+        file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+        line[0] = '\0';
+        (void)fgets(line, sizeof(line), file);
+        (void)fclose(file);
+        line[strcspn(line, "\n")] = '\0';
+        if (strcmp(line, threadName) != 0) {
+            continue;
+        }
+
+        (void)snprintf(path, sizeof(path), "/proc/self/task/%s/sched", entry->d_name);
+        file = fopen(path, "r");
+        if (file == NULL) {
+            continue;
+        }
+        while (fgets(line, sizeof(line), file) != NULL) {
+            if (sscanf(line, "se.nr_migrations : %lld", &num) == 1) {
+                total = (total < 0) ? num : (total + num);
+                break;
+            }
+        }
+        (void)fclose(file);
+    }
+    (void)closedir(dir);
+
+    return total;
+}
+
+/* 绑定主线程，cpuList为空串时恢复为origSet */
+static int AffinityPinSelf(const char *cpuList, const cpu_set_t *origSet)
+{
+    cpu_set_t cpuSet;
+    char list[IPCS_CPU_LIST_MAX_LEN];
+    char *token = NULL;
+    char *save = NULL;
+    int first = 0;
+    int last = 0;
+    int cpu = 0;
+
+    if (cpuList[0] == '\0') {
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), origSet);
+    }
+
+    CPU_ZERO(&cpuSet);
+    (void)snprintf(list, sizeof(list), "%s", cpuList);
+    for (token = strtok_r(list, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+        if (sscanf(token, "%d-%d", &first, &last) != 2) {
+            last = first = atoi(token);
+        }
+        for (cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); cpu++) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+}
+
+static int AffinityRun(int pinned, const cpu_set_t *origSet)
+{
+    pthread_t noiseThreads[AFFINITY_MAX_NOISE];
+    char payload[IPCS_MESSAGE_MAX_LEN];
+    char recvBuf[IPCS_MESSAGE_MAX_LEN];
+    IPCS_ServerAttr serverAttr;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned long long calls = 0;
+    long long migrations = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t sendNs = 0;
+    unsigned int noise = 0;
+    unsigned int i = 0;
+    int clientFd = -1;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    (void)snprintf(serverAttr.thread.name, sizeof(serverAttr.thread.name), "%s", AFFINITY_THREAD_NAME);
+    if (pinned) {
+        (void)snprintf(serverAttr.thread.cpuList, sizeof(serverAttr.thread.cpuList), "%s", g_ServerCpus);
+    }
+
+    result = IPCS_CreateServerEx(AFFINITY_SERVER_NAME, AffinityServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("affinity create server fail: %d", result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    result = IPCS_CreateSyncClient(NULL, AFFINITY_SERVER_NAME, &clientFd);
+    if (result != IPCS_OK) {
+        TEST_PRINT("affinity create client fail: %d", result);
+        (void)IPCS_DestroyServer(AFFINITY_SERVER_NAME);
+        return result;
+    }
+
+    if (pinned && (AffinityPinSelf(g_ClientCpus, origSet) != 0)) {
+        TEST_PRINT("affinity pin client to %s fail", g_ClientCpus);
+    }
+
+    g_NoiseStopping = 0;
+    for (noise = 0; noise < g_NoiseNum; noise++) {
+        if (pthread_create(&noiseThreads[noise], NULL, AffinityNoiseRun, NULL) != 0) {
+            break;
+        }
+    }
+
+    (void)memset(payload, 0, g_PayloadLen);
+    sendMsg.msgType = AFFINITY_MSG_TYPE;
+    sendMsg.msgLen = g_PayloadLen;
+    sendMsg.msgValue = payload;
+
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    migrations = AffinityThreadMigrations(AFFINITY_THREAD_NAME);
+    while ((result == IPCS_OK) && ((sendNs = BENCH_NowNs()) < endNs)) {
+        recvMsg.msgLen = g_PayloadLen;
+        recvMsg.msgValue = recvBuf;
+        result = IPCS_ClientSyncCall(clientFd, &sendMsg, &recvMsg);
+        BENCH_HistRecord(&g_RttHist, BENCH_NowNs() - sendNs);
+        calls++;
+    }
+    if (migrations >= 0) {
+        migrations = AffinityThreadMigrations(AFFINITY_THREAD_NAME) - migrations;
+    }
+
+    g_NoiseStopping = 1;
+    for (i = 0; i < noise; i++) {
+        (void)pthread_join(noiseThreads[i], NULL);
+    }
+    (void)AffinityPinSelf("", origSet);
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s server_cpus=%s client_cpus=%s noise=%u payload=%u engine=%s",
+                pinned ? "pinned" : "floating", pinned ? g_ServerCpus : "any",
+                (pinned && (g_ClientCpus[0] != '\0')) ? g_ClientCpus : "any", noise, g_PayloadLen,
+                (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f calls/s  server_thread_migrations=%lld",
+                (double)calls * BENCH_NS_PER_SEC / (double)(BENCH_NowNs() - startNs), migrations);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+    } else {
+        TEST_PRINT("affinity sync call fail: %d", result);
+    }
+
+    (void)IPCS_DestroyClient(clientFd);
+    (void)IPCS_DestroyServer(AFFINITY_SERVER_NAME);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    cpu_set_t origSet;
+    long cpuNum = sysconf(_SC_NPROCESSORS_ONLN);
+    int result = IPCS_OK;
+    int opt = 0;
+
+    /* 默认服务端和客户端分别绑定在0号和1号CPU上，每个CPU一个干扰线程 */
+    if (cpuNum > 1) {
+        (void)snprintf(g_ClientCpus, sizeof(g_ClientCpus), "1");
+    }
+    g_NoiseNum = (cpuNum > 0) ? (unsigned int)cpuNum : 1;
+
+    while ((opt = getopt(argc, argv, "d:S:C:n:s:e:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'S':
+                (void)snprintf(g_ServerCpus, sizeof(g_ServerCpus), "%s", optarg);
+                break;
+            case 'C':
+                (void)snprintf(g_ClientCpus, sizeof(g_ClientCpus), "%s", optarg);
+                break;
+            case 'n':
+                g_NoiseNum = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_PayloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-S serverCpuList] [-C clientCpuList] [-n noiseThreads]\n"
+                             "          [-s payload] [-e epoll|uring]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_NoiseNum > AFFINITY_MAX_NOISE) || (g_PayloadLen == 0) ||
+        (g_PayloadLen + offsetof(IPCS_Message, msgValue) > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("noise threads 0..%d, payload 1..%d\n", AFFINITY_MAX_NOISE,
+                (int)(IPCS_MESSAGE_MAX_LEN - offsetof(IPCS_Message, msgValue)));
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+    (void)pthread_getaffinity_np(pthread_self(), sizeof(origSet), &origSet);
+
+    result = AffinityRun(0, &origSet);
+    if (result == IPCS_OK) {
+        result = AffinityRun(1, &origSet);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,207 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bench_common.c
+ *
+ *    Description:  common helpers for benchmark tools: clock, latency histogram
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:12:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+/******************************************************************************/
+uint64_t BENCH_NowNs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * BENCH_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+void BENCH_SleepUntilNs(uint64_t deadlineNs)
+{
+    struct timespec ts;
+    int result = 0;
+
+    ts.tv_sec = deadlineNs / BENCH_NS_PER_SEC;
+    ts.tv_nsec = deadlineNs % BENCH_NS_PER_SEC;
+
+    do {
+        result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    } while (result == EINTR);
+
+    return;
+}
+
+/******************************************************************************/
+static void BENCH_HistIndex(uint64_t value, unsigned int *magnitude, unsigned int *sub)
+{
+    unsigned int msb = 0;
+
+    if (value < BENCH_HIST_SUB_BUCKETS) {
+        *magnitude = 0;
+        *sub = (unsigned int)value;
+        return;
+    }
+
+    msb = 63 - (unsigned int)__builtin_clzll(value);
+    *magnitude = msb - BENCH_HIST_SUB_BITS + 1;
+    *sub = (unsigned int)(value >> *magnitude);
+
+    return;
+}
+
+/* 桶内的最大值，与HdrHistogram的highestEquivalentValue一致 */
+static uint64_t BENCH_HistBucketValue(unsigned int magnitude, unsigned int sub)
+{
+    return (((uint64_t)sub + 1) << magnitude) - 1;
+}
+
+void BENCH_HistReset(BENCH_Histogram *hist)
+{
+    (void)memset(hist, 0, sizeof(BENCH_Histogram));
+    hist->min = UINT64_MAX;
+
+    return;
+}
+
+void BENCH_HistRecord(BENCH_Histogram *hist, uint64_t value)
+{
+    unsigned int magnitude = 0;
+    unsigned int sub = 0;
+
+    BENCH_HistIndex(value, &magnitude, &sub);
+    hist->counts[magnitude][sub]++;
+    hist->total++;
+    hist->sum += value;
+
+    if (value < hist->min) {
+        hist->min = value;
+    }
+
+    if (value > hist->max) {
+        hist->max = value;
+    }
+
+    return;
+}
+
+void BENCH_HistMerge(BENCH_Histogram *dst, const BENCH_Histogram *src)
+{
+    unsigned int m = 0;
+    unsigned int s = 0;
+
+    for (m = 0; m < BENCH_HIST_MAGNITUDES; m++) {
+        for (s = 0; s < BENCH_HIST_SUB_BUCKETS; s++) {
+            dst->counts[m][s] += src->counts[m][s];
+        }
+    }
+
+    dst->total += src->total;
+    dst->sum += src->sum;
+
+    if (src->min < dst->min) {
+        dst->min = src->min;
+    }
+
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+
+    return;
+}
+
+uint64_t BENCH_HistPercentile(const BENCH_Histogram *hist, double percentile)
+{
+    uint64_t target = 0;
+    uint64_t seen = 0;
+    unsigned int m = 0;
+    unsigned int s = 0;
+
+    if (hist->total == 0) {
+        return 0;
+    }
+
+    target = (uint64_t)((percentile / 100.0) * (double)hist->total + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (m = 0; m < BENCH_HIST_MAGNITUDES; m++) {
+        for (s = 0; s < BENCH_HIST_SUB_BUCKETS; s++) {
+            seen += hist->counts[m][s];
+            if (seen >= target) {
+                return (BENCH_HistBucketValue(m, s) < hist->max) ? BENCH_HistBucketValue(m, s) : hist->max;
+            }
+        }
+    }
+
+    return hist->max;
+}
+
+double BENCH_HistMean(const BENCH_Histogram *hist)
+{
+    if (hist->total == 0) {
+        return 0.0;
+    }
+
+    return (double)(hist->sum / hist->total);
+}
+
+void BENCH_HistPrintSummary(const BENCH_Histogram *hist, const char *title)
+{
+    if (hist->total == 0) {
+        BENCH_PRINT("%-16s count=0", title);
+        return;
+    }
+
+    BENCH_PRINT("%-16s count=%llu mean=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus p99.9=%.1fus p99.99=%.1fus max=%.1fus",
+            title, (unsigned long long)hist->total, BENCH_HistMean(hist) / BENCH_NS_PER_US,
+            (double)BENCH_HistPercentile(hist, 50.0) / BENCH_NS_PER_US,
+            (double)BENCH_HistPercentile(hist, 90.0) / BENCH_NS_PER_US,
+            (double)BENCH_HistPercentile(hist, 99.0) / BENCH_NS_PER_US,
+            (double)BENCH_HistPercentile(hist, 99.9) / BENCH_NS_PER_US,
+            (double)BENCH_HistPercentile(hist, 99.99) / BENCH_NS_PER_US,
+            (double)hist->max / BENCH_NS_PER_US);
+
+    return;
+}
+
+void BENCH_HistPrintBuckets(const BENCH_Histogram *hist)
+{
+    uint64_t seen = 0;
+    unsigned int m = 0;
+    unsigned int s = 0;
+
+    BENCH_PRINT("%14s %12s %10s", "value(us)", "count", "percentile");
+
+    for (m = 0; m < BENCH_HIST_MAGNITUDES; m++) {
+        for (s = 0; s < BENCH_HIST_SUB_BUCKETS; s++) {
+            if (hist->counts[m][s] == 0) {
+                continue;
+            }
+
+            seen += hist->counts[m][s];
+            BENCH_PRINT("%14.3f %12llu %9.5f%%", (double)BENCH_HistBucketValue(m, s) / BENCH_NS_PER_US,
+                    (unsigned long long)hist->counts[m][s], 100.0 * (double)seen / (double)hist->total);
+        }
+    }
+
+    return;
+}
+
+/******************************************************************************/
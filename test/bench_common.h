@@ -0,0 +1,71 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bench_common.h
+ *
+ *    Description:  common helpers for benchmark tools: clock, latency histogram
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:12:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#ifndef __BENCH_COMMON_H__
+#define __BENCH_COMMON_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define BENCH_PRINT(format, ...)    (void)printf(format "\n", ##__VA_ARGS__)
+
+#define BENCH_NS_PER_US     1000ULL
+#define BENCH_NS_PER_MS     1000000ULL
+#define BENCH_NS_PER_SEC    1000000000ULL
+
+/******************************************************************************/
+uint64_t BENCH_NowNs(void);
+
+void BENCH_SleepUntilNs(uint64_t deadlineNs);
+
+/******************************************************************************/
+/**
+ * 对数线性直方图（HdrHistogram的简化版）：
+ * 每个2的幂区间再等分为BENCH_HIST_SUB_BUCKETS/2个子桶，相对误差不超过2/BENCH_HIST_SUB_BUCKETS。
+ * 记录的单位由调用者决定，通常为纳秒。
+ **/
+#define BENCH_HIST_SUB_BITS     7
+#define BENCH_HIST_SUB_BUCKETS  (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_MAGNITUDES   (64 - BENCH_HIST_SUB_BITS + 1)
+
+typedef struct {
+    uint64_t counts[BENCH_HIST_MAGNITUDES][BENCH_HIST_SUB_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    long double sum;
+} BENCH_Histogram;
+
+void BENCH_HistReset(BENCH_Histogram *hist);
+
+void BENCH_HistRecord(BENCH_Histogram *hist, uint64_t value);
+
+void BENCH_HistMerge(BENCH_Histogram *dst, const BENCH_Histogram *src);
+
+uint64_t BENCH_HistPercentile(const BENCH_Histogram *hist, double percentile);
+
+double BENCH_HistMean(const BENCH_Histogram *hist);
+
+/* 输出 p50/p90/p99/p99.9/p99.99/max，单位为微秒 */
+void BENCH_HistPrintSummary(const BENCH_Histogram *hist, const char *title);
+
+/* 输出非空桶的分布，单位为微秒 */
+void BENCH_HistPrintBuckets(const BENCH_Histogram *hist);
+
+/******************************************************************************/
+#endif /* __BENCH_COMMON_H__ */
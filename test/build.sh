@@ -1,11 +1,65 @@
 #! /bin/bash
 
-rm -fv libipcs.so server.exe client.exe
+rm -fv libipcs.so server.exe client.exe loadgen.exe replay.exe microbench.exe churn_bench.exe engine_bench.exe pubsub_bench.exe prio_bench.exe reactor_bench.exe affinity_bench.exe busypoll_bench.exe flowctl_bench.exe shed_bench.exe cache_bench.exe pool_bench.exe fanout_bench.exe prefork_bench.exe handoff_bench.exe startup_bench.exe task_bench.exe sendq_bench.exe crc_bench.exe compress_bench.exe deadline_test.exe flowctl_test.exe coalesce_test.exe handoff_test.exe checksum_test.exe compress_test.exe
 
-gcc -Wall -g -fPIC -shared -I../include -I../src ../src/ipcs_server.c ../src/ipcs_common.c ../src/ipcs_client.c -o libipcs.so
+gcc -Wall -g -fPIC -shared -I../include -I../src ../src/ipcs_server.c ../src/ipcs_common.c ../src/ipcs_client.c ../src/ipcs_capture.c ../src/ipcs_timer.c ../src/ipcs_conn.c ../src/ipcs_uring.c ../src/ipcs_thread.c ../src/ipcs_busypoll.c ../src/ipcs_shed.c ../src/ipcs_cache.c ../src/ipcs_pool.c ../src/ipcs_prefork.c ../src/ipcs_handoff.c ../src/ipcs_task.c ../src/ipcs_sendq.c ../src/ipcs_crc.c ../src/ipcs_lz.c -o libipcs.so
 
 gcc -Wall -g -I../include -I. ./server_main.c ./libipcs.so -lpthread -o server.exe
 
 gcc -Wall -g -I../include -I. ./client_main.c ./libipcs.so -lpthread -o client.exe
 
+gcc -Wall -g -I../include -I. ./loadgen_main.c ./bench_common.c ./libipcs.so -lpthread -o loadgen.exe
 
+gcc -Wall -g -I../include -I../src -I. ./replay_main.c ./bench_common.c ./libipcs.so -lpthread -o replay.exe
+
+gcc -Wall -g -I../include -I../src -I. ./microbench_main.c ./bench_common.c ./libipcs.so -lpthread -o microbench.exe
+
+gcc -Wall -g -I../include -I. ./churn_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o churn_bench.exe
+
+gcc -Wall -g -I../include -I. ./engine_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o engine_bench.exe
+
+gcc -Wall -g -I../include -I. ./pubsub_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o pubsub_bench.exe
+
+gcc -Wall -g -I../include -I. ./prio_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o prio_bench.exe
+
+gcc -Wall -g -I../include -I. ./reactor_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o reactor_bench.exe
+
+gcc -Wall -g -I../include -I. ./affinity_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o affinity_bench.exe
+
+gcc -Wall -g -I../include -I. ./busypoll_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o busypoll_bench.exe
+
+gcc -Wall -g -I../include -I. ./flowctl_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o flowctl_bench.exe
+
+gcc -Wall -g -I../include -I. ./shed_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o shed_bench.exe
+
+gcc -Wall -g -I../include -I. ./cache_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o cache_bench.exe
+
+gcc -Wall -g -I../include -I. ./pool_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o pool_bench.exe
+
+gcc -Wall -g -I../include -I. ./fanout_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o fanout_bench.exe
+
+gcc -Wall -g -I../include -I. ./prefork_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o prefork_bench.exe
+
+gcc -Wall -g -I../include -I. ./handoff_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o handoff_bench.exe
+
+gcc -Wall -g -I../include -I. ./startup_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o startup_bench.exe
+
+gcc -Wall -g -I../include -I. ./task_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o task_bench.exe
+
+gcc -Wall -g -I../include -I. ./sendq_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o sendq_bench.exe
+
+gcc -Wall -g -I../include -I../src -I. ./crc_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o crc_bench.exe
+
+gcc -Wall -g -I../include -I../src -I. ./compress_bench_main.c ./bench_common.c ./libipcs.so -lpthread -o compress_bench.exe
+
+gcc -Wall -g -I../include -I. ./deadline_test_main.c ./bench_common.c ./libipcs.so -lpthread -o deadline_test.exe
+
+gcc -Wall -g -I../include -I. ./flowctl_test_main.c ./bench_common.c ./libipcs.so -lpthread -o flowctl_test.exe
+
+gcc -Wall -g -I../include -I. ./coalesce_test_main.c ./bench_common.c ./libipcs.so -lpthread -o coalesce_test.exe
+
+gcc -Wall -g -I../include -I. ./handoff_test_main.c ./bench_common.c ./libipcs.so -lpthread -o handoff_test.exe
+
+gcc -Wall -g -I../include -I../src -I. ./checksum_test_main.c ./bench_common.c ./libipcs.so -lpthread -o checksum_test.exe
+
+gcc -Wall -g -I../include -I../src -I. ./compress_test_main.c ./bench_common.c ./libipcs.so -lpthread -o compress_test.exe
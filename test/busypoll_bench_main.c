@@ -0,0 +1,212 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  busypoll_bench_main.c
+ *
+ *    Description:  busy polling ping-pong benchmark
+ *
+ *                  主线程通过同步客户端逐个调用回显服务端（ping-pong），每次调用之间可以间隔
+ *                  一段时间。依次在阻塞等待（block）、固定忙等（spin）、自适应忙等（adaptive）
+ *                  三种模式下运行，服务端线程和同步客户端使用相同的忙等配置，输出往返时延、
+ *                  每次调用消耗的CPU时间和服务端忙等命中的次数。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:46:02 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define BUSYPOLL_MSG_TYPE       0x4250   /* "BP" */
+#define BUSYPOLL_SERVER_NAME    "@ipcs_busypoll_bench"
+
+typedef struct {
+    const char *name;
+    unsigned int spin;
+    int adaptive;
+} BUSYPOLL_Mode;
+
+static const BUSYPOLL_Mode g_Modes[] = {
+    {"block", 0, 0},
+    {"spin", 1, 0},
+    {"adaptive", 1, 1},
+};
+
+static double g_DurationSec = 3.0;
+static unsigned int g_PayloadLen = 64;
+static unsigned int g_SpinUs = 50;
+static unsigned int g_GapUs = 0;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyMode = NULL;
+
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+int BusyPollServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static uint64_t BusyPollCpuNs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * BENCH_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static int BusyPollRun(const BUSYPOLL_Mode *mode)
+{
+    char payload[IPCS_MESSAGE_MAX_LEN];
+    char recvBuf[IPCS_MESSAGE_MAX_LEN];
+    IPCS_ServerAttr serverAttr;
+    IPCS_ClientAttr clientAttr;
+    IPCS_ServerStats stats;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned long long calls = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t sendNs = 0;
+    uint64_t cpuNs = 0;
+    int clientFd = -1;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.busyPoll.spinUs = mode->spin ? g_SpinUs : 0;
+    serverAttr.busyPoll.adaptive = mode->adaptive;
+
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.busyPoll = serverAttr.busyPoll;
+
+    result = IPCS_CreateServerEx(BUSYPOLL_SERVER_NAME, BusyPollServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("busypoll create server fail: %d", result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    result = IPCS_CreateSyncClientEx(NULL, BUSYPOLL_SERVER_NAME, &clientAttr, &clientFd);
+    if (result != IPCS_OK) {
+        TEST_PRINT("busypoll create client fail: %d", result);
+        (void)IPCS_DestroyServer(BUSYPOLL_SERVER_NAME);
+        return result;
+    }
+
+    (void)memset(payload, 0, g_PayloadLen);
+    sendMsg.msgType = BUSYPOLL_MSG_TYPE;
+    sendMsg.msgLen = g_PayloadLen;
+    sendMsg.msgValue = payload;
+
+    BENCH_HistReset(&g_RttHist);
+    cpuNs = BusyPollCpuNs();
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    while ((result == IPCS_OK) && ((sendNs = BENCH_NowNs()) < endNs)) {
+        recvMsg.msgLen = g_PayloadLen;
+        recvMsg.msgValue = recvBuf;
+        result = IPCS_ClientSyncCall(clientFd, &sendMsg, &recvMsg);
+        BENCH_HistRecord(&g_RttHist, BENCH_NowNs() - sendNs);
+        calls++;
+
+        if (g_GapUs != 0) {
+            BENCH_SleepUntilNs(BENCH_NowNs() + g_GapUs * BENCH_NS_PER_US);
+        }
+    }
+    endNs = BENCH_NowNs();
+    cpuNs = BusyPollCpuNs() - cpuNs;
+
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)IPCS_GetServerStats(BUSYPOLL_SERVER_NAME, &stats);
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s spin=%uus gap=%uus payload=%u engine=%s", mode->name, serverAttr.busyPoll.spinUs,
+                g_GapUs, g_PayloadLen, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f calls/s  cpu/call=%.1fus  cpu=%.0f%%  server_spin_hits/wakeup=%.3f",
+                (double)calls * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                (calls == 0) ? 0.0 : (double)cpuNs / (double)calls / BENCH_NS_PER_US,
+                (double)cpuNs * 100.0 / (double)(endNs - startNs),
+                (stats.wakeups == 0) ? 0.0 : (double)stats.spinHits / (double)stats.wakeups);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+    } else {
+        TEST_PRINT("busypoll sync call fail: %d", result);
+    }
+
+    (void)IPCS_DestroyClient(clientFd);
+    (void)IPCS_DestroyServer(BUSYPOLL_SERVER_NAME);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:s:u:g:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 's':
+                g_PayloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'u':
+                g_SpinUs = (unsigned int)atoi(optarg);
+                break;
+            case 'g':
+                g_GapUs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyMode = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-s payload] [-u spinUs] [-g gapUs] [-e epoll|uring]\n"
+                             "          [-m block|spin|adaptive]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_SpinUs == 0) || (g_PayloadLen == 0) ||
+        (g_PayloadLen + offsetof(IPCS_Message, msgValue) > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("spin > 0, payload 1..%d\n", (int)(IPCS_MESSAGE_MAX_LEN - offsetof(IPCS_Message, msgValue)));
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Modes) / sizeof(g_Modes[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyMode != NULL) && (strcmp(g_OnlyMode, g_Modes[i].name) != 0)) {
+            continue;
+        }
+        result = BusyPollRun(&g_Modes[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
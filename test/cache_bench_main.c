@@ -0,0 +1,304 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  cache_bench_main.c
+ *
+ *    Description:  server response cache benchmark
+ *
+ *                  同步客户端反复查询-k个键中随机的一个，服务端回调函数忙等-w微秒模拟查询的开销，
+ *                  响应中带上键，客户端检查响应与请求是否匹配。分别在不开启缓存（off）、
+ *                  开启缓存（on）、开启缓存且另一个线程每-i毫秒使整个类型失效（churn）、
+ *                  只开启请求合并（coalesce）四种配置下运行，输出调用速率、命中率、缓存占用、
+ *                  合并的请求数和调用时延。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 03:12:27 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define CACHE_MSG_TYPE          0x4348   /* "CH" */
+#define CACHE_SERVER_NAME       "@ipcs_cache_bench"
+#define CACHE_MAX_CLIENTS       16
+#define CACHE_RESP_LEN          256
+
+typedef struct {
+    const char *name;
+    int cached;
+    int churn;
+    int coalesce;
+} CACHE_Config;
+
+static const CACHE_Config g_Configs[] = {
+    {"off", 0, 0, 0},
+    {"on", 1, 0, 0},
+    {"churn", 1, 1, 0},
+    {"coalesce", 0, 0, 1},
+};
+
+typedef struct {
+    pthread_t tid;
+    unsigned int seed;
+    unsigned long long calls;
+    unsigned long long bad;
+    int result;
+    BENCH_Histogram hist;
+} CACHE_Client;
+
+static double g_DurationSec = 3.0;
+static unsigned int g_Clients = 2;
+static unsigned int g_Keys = 1000;
+static unsigned int g_ServiceUs = 20;
+static unsigned int g_TtlMs = 1000;
+static unsigned int g_ChurnMs = 10;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static volatile int g_Stop = 0;
+static CACHE_Client g_ClientArgs[CACHE_MAX_CLIENTS];
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+/* 忙等模拟查询的开销，响应的前4字节为键 */
+int CacheServerHook(int fd, IPCS_Message *msg)
+{
+    char resp[CACHE_RESP_LEN];
+    IPCS_Message respMsg;
+    uint64_t endNs = BENCH_NowNs() + (uint64_t)g_ServiceUs * BENCH_NS_PER_US;
+    unsigned int key = 0;
+
+    while (BENCH_NowNs() < endNs) {
+    }
+
+    if (msg->msgLen >= sizeof(key)) {
+        (void)memcpy(&key, msg->msgValue, sizeof(key));
+    }
+    (void)memset(resp, (int)(key & 0xFF), sizeof(resp));
+    (void)memcpy(resp, &key, sizeof(key));
+
+    respMsg.msgType = msg->msgType;
+    respMsg.msgLen = sizeof(resp);
+    respMsg.msgValue = resp;
+
+    return IPCS_ServerSendMessage(fd, &respMsg);
+}
+
+static void *CacheClientThread(void *arg)
+{
+    CACHE_Client *client = (CACHE_Client *)arg;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned int req[4];
+    char recvBuf[CACHE_RESP_LEN];
+    unsigned int key = 0;
+    uint64_t startNs = 0;
+    int fd = -1;
+
+    client->result = IPCS_CreateSyncClient(NULL, CACHE_SERVER_NAME, &fd);
+    if (client->result != IPCS_OK) {
+        return NULL;
+    }
+
+    (void)memset(req, 0, sizeof(req));
+    sendMsg.msgType = CACHE_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = req;
+
+    while (!g_Stop) {
+        req[0] = (unsigned int)rand_r(&client->seed) % g_Keys;
+        recvMsg.msgLen = sizeof(recvBuf);
+        recvMsg.msgValue = recvBuf;
+
+        startNs = BENCH_NowNs();
+        client->result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+        if (client->result != IPCS_OK) {
+            break;
+        }
+        BENCH_HistRecord(&client->hist, BENCH_NowNs() - startNs);
+        client->calls++;
+
+        (void)memcpy(&key, recvBuf, sizeof(key));
+        if ((recvMsg.msgLen != CACHE_RESP_LEN) || (key != req[0])) {
+            client->bad++;
+        }
+    }
+
+    (void)IPCS_DestroyClient(fd);
+
+    return NULL;
+}
+
+/******************************************************************************/
+static int CacheRun(const CACHE_Config *config)
+{
+    IPCS_ServerAttr attr;
+    IPCS_ServerStats stats;
+    unsigned long long calls = 0;
+    unsigned long long bad = 0;
+    unsigned long long invalidations = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t nextNs = 0;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    result = IPCS_CreateServerEx(CACHE_SERVER_NAME, CacheServerHook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("cache create server fail: %d", result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    if (config->cached) {
+        result = IPCS_ServerSetCache(CACHE_SERVER_NAME, CACHE_MSG_TYPE, g_TtlMs);
+        if (result != IPCS_OK) {
+            TEST_PRINT("cache set cache fail: %d", result);
+            (void)IPCS_DestroyServer(CACHE_SERVER_NAME);
+            return result;
+        }
+    }
+    if (config->coalesce) {
+        result = IPCS_ServerSetCoalesce(CACHE_SERVER_NAME, CACHE_MSG_TYPE, 1);
+        if (result != IPCS_OK) {
+            TEST_PRINT("cache set coalesce fail: %d", result);
+            (void)IPCS_DestroyServer(CACHE_SERVER_NAME);
+            return result;
+        }
+    }
+
+    g_Stop = 0;
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    for (started = 0; started < g_Clients; started++) {
+        (void)memset(&g_ClientArgs[started], 0, sizeof(CACHE_Client));
+        g_ClientArgs[started].seed = started + 1;
+        BENCH_HistReset(&g_ClientArgs[started].hist);
+        if (pthread_create(&g_ClientArgs[started].tid, NULL, CacheClientThread, &g_ClientArgs[started]) != 0) {
+            TEST_PRINT("cache start client %u fail", started);
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (nextNs = startNs + (uint64_t)g_ChurnMs * BENCH_NS_PER_MS; nextNs < endNs;
+         nextNs += (uint64_t)g_ChurnMs * BENCH_NS_PER_MS) {
+        BENCH_SleepUntilNs(nextNs);
+        if (config->churn) {
+            (void)IPCS_ServerInvalidateCache(CACHE_SERVER_NAME, CACHE_MSG_TYPE, NULL);
+            invalidations++;
+        }
+    }
+    BENCH_SleepUntilNs(endNs);
+
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)IPCS_GetServerStats(CACHE_SERVER_NAME, &stats);
+
+    g_Stop = 1;
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_ClientArgs[i].tid, NULL);
+        calls += g_ClientArgs[i].calls;
+        bad += g_ClientArgs[i].bad;
+        BENCH_HistMerge(&g_RttHist, &g_ClientArgs[i].hist);
+        if ((result == IPCS_OK) && (g_ClientArgs[i].result != IPCS_OK)) {
+            TEST_PRINT("cache client %u fail: %d", i, g_ClientArgs[i].result);
+            result = g_ClientArgs[i].result;
+        }
+    }
+    endNs = BENCH_NowNs();
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s clients=%u keys=%u service=%uus ttl=%ums engine=%s", config->name, started, g_Keys,
+                g_ServiceUs, g_TtlMs, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f calls/s  hit_ratio=%.3f  cache_bytes=%llu  invalidations=%llu  coalesced=%llu  bad=%llu",
+                (double)calls * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                (stats.cacheHits + stats.cacheMisses != 0) ?
+                (double)stats.cacheHits / (double)(stats.cacheHits + stats.cacheMisses) : 0.0,
+                stats.cacheBytes, invalidations, stats.coalesced, bad);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+    }
+
+    (void)IPCS_DestroyServer(CACHE_SERVER_NAME);
+
+    return (bad != 0) ? IPCS_STREAM_BUF_BAD : result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:k:w:t:i:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_Clients = (unsigned int)atoi(optarg);
+                break;
+            case 'k':
+                g_Keys = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_ServiceUs = (unsigned int)atoi(optarg);
+                break;
+            case 't':
+                g_TtlMs = (unsigned int)atoi(optarg);
+                break;
+            case 'i':
+                g_ChurnMs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c clients] [-k keys] [-w serviceUs] [-t ttlMs]\n"
+                             "          [-i churnMs] [-e epoll|uring] [-m off|on|churn|coalesce]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_Clients == 0) || (g_Clients > CACHE_MAX_CLIENTS) || (g_Keys == 0) || (g_TtlMs == 0) ||
+        (g_ChurnMs == 0)) {
+        (void)printf("clients 1..%d, keys > 0, ttlMs > 0, churnMs > 0\n", CACHE_MAX_CLIENTS);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = CacheRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
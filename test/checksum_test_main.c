@@ -0,0 +1,339 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  checksum_test_main.c
+ *
+ *    Description:  frame checksum tests
+ *
+ *                  检查：带校验和的帧中msgType、调用ID、负载和校验和的任一位翻转时解析返回
+ *                  IPCS_CHECKSUM_FAIL；服务端收到校验失败的帧时只关闭该连接、不调用回调函数，
+ *                  同一服务端上的其他连接照常调用；同步客户端收到校验失败的响应时返回
+ *                  IPCS_CHECKSUM_FAIL；服务端不同意时连接不带校验和，调用照常。全部通过时返回0。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:47:03 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+#include "ipcs_common.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define CHECKSUM_SERVER_NAME    "@ipcs_checksum_test"
+#define CHECKSUM_PLAIN_NAME     "@ipcs_checksum_test_plain"
+#define CHECKSUM_RAW_NAME       "@ipcs_checksum_test_raw"
+#define CHECKSUM_MSG_TYPE       0x434B   /* "CK" */
+#define CHECKSUM_PAYLOAD_LEN    64
+#define CHECKSUM_FRAME_LEN      (IPCS_MSG_HEADER_LEN + IPCS_FRAME_EXT_MAX_LEN + CHECKSUM_PAYLOAD_LEN)
+#define CHECKSUM_WAIT_MS        1000
+
+typedef struct {
+    const char *name;
+    int (*run)(void);
+} CHECKSUM_Case;
+
+static unsigned long long g_ServerCalls = 0;
+static int g_RawListenFd = -1;
+
+/******************************************************************************/
+int ChecksumServerHook(int fd, IPCS_Message *msg)
+{
+    (void)__atomic_add_fetch(&g_ServerCalls, 1, __ATOMIC_RELAXED);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static int ChecksumCreateClient(const char *serverName, int checksum, int *fd)
+{
+    IPCS_ClientAttr clientAttr;
+
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.checksum = checksum;
+
+    return IPCS_CreateSyncClientEx(NULL, serverName, &clientAttr, fd);
+}
+
+/* 调用一次并检查回显的内容 */
+static int ChecksumCall(int fd)
+{
+    char sendBuf[CHECKSUM_PAYLOAD_LEN];
+    char recvBuf[CHECKSUM_PAYLOAD_LEN];
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    int result = IPCS_OK;
+
+    (void)memset(sendBuf, 0x5A, sizeof(sendBuf));
+    sendMsg.msgType = CHECKSUM_MSG_TYPE;
+    sendMsg.msgLen = sizeof(sendBuf);
+    sendMsg.msgValue = sendBuf;
+    recvMsg.msgLen = sizeof(recvBuf);
+    recvMsg.msgValue = recvBuf;
+    result = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, CHECKSUM_WAIT_MS);
+    if ((result == IPCS_OK) &&
+        ((recvMsg.msgLen != sizeof(sendBuf)) || (memcmp(recvBuf, sendBuf, sizeof(sendBuf)) != 0))) {
+        result = IPCS_FRAME_BAD;
+    }
+
+    return result;
+}
+
+/* 编码一个带调用ID和校验和的帧 */
+static int ChecksumBuildFrame(char *frame, unsigned int *frameLen)
+{
+    char value[CHECKSUM_PAYLOAD_LEN];
+    IPCS_Message msg;
+    int result = IPCS_OK;
+
+    (void)memset(value, 0x33, sizeof(value));
+    msg.msgType = CHECKSUM_MSG_TYPE;
+    msg.msgLen = sizeof(value);
+    msg.msgValue = value;
+    *frameLen = CHECKSUM_FRAME_LEN;
+    result = IPCS_MsgToStreamFlags(&msg, 1, IPCS_PRIO_NORMAL, 0, IPCS_MSG_FLAG_CHECKSUM, frame, frameLen);
+
+    return result;
+}
+
+/******************************************************************************/
+/* msgType、调用ID、负载和校验和的每一位翻转都被发现；msgLen的位翻转会改变帧长，不在此列 */
+static int ChecksumTestParse(void)
+{
+    char frame[CHECKSUM_FRAME_LEN];
+    char recvBuf[CHECKSUM_PAYLOAD_LEN];
+    IPCS_Message recvMsg;
+    unsigned int frameLen = 0;
+    unsigned int pos = 0;
+    unsigned int bit = 0;
+    int result = IPCS_OK;
+
+    result = ChecksumBuildFrame(frame, &frameLen);
+    TEST_CHECK(result == IPCS_OK, "build frame: %d", result);
+
+    recvMsg.msgLen = sizeof(recvBuf);
+    recvMsg.msgValue = recvBuf;
+    result = IPCS_StreamToMsgEx(frame, frameLen, &recvMsg, NULL, NULL);
+    TEST_CHECK(result == IPCS_OK, "intact frame: %d", result);
+
+    for (pos = 0; pos < frameLen; pos++) {
+        if ((pos >= sizeof(unsigned int)) && (pos < IPCS_MSG_HEADER_LEN)) {
+            continue;
+        }
+        for (bit = 0; bit < 8; bit++) {
+            frame[pos] ^= (char)(1 << bit);
+            recvMsg.msgLen = sizeof(recvBuf);
+            result = IPCS_StreamToMsgEx(frame, frameLen, &recvMsg, NULL, NULL);
+            frame[pos] ^= (char)(1 << bit);
+            TEST_CHECK(result == IPCS_CHECKSUM_FAIL, "flip byte %u bit %u of %u: %d", pos, bit, frameLen, result);
+        }
+    }
+
+    return IPCS_OK;
+}
+
+/* 服务端只关闭发来坏帧的连接，不调用回调函数 */
+static int ChecksumTestServer(void)
+{
+    char frame[CHECKSUM_FRAME_LEN];
+    unsigned int frameLen = 0;
+    unsigned long long callsBefore = 0;
+    unsigned long long callsAfter = 0;
+    int badFd = -1;
+    int goodFd = -1;
+    int plainFd = -1;
+    int badResult = IPCS_OK;
+    int goodResult = IPCS_OK;
+    int plainResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    result = ChecksumBuildFrame(frame, &frameLen);
+    TEST_CHECK(result == IPCS_OK, "build frame: %d", result);
+    frame[frameLen - IPCS_CHECKSUM_LEN - 1] ^= 0x01;
+
+    result = ChecksumCreateClient(CHECKSUM_SERVER_NAME, 1, &badFd);
+    if (result == IPCS_OK) {
+        result = ChecksumCreateClient(CHECKSUM_SERVER_NAME, 1, &goodFd);
+    }
+    if (result == IPCS_OK) {
+        result = ChecksumCreateClient(CHECKSUM_SERVER_NAME, 0, &plainFd);
+    }
+    if (result == IPCS_OK) {
+        callsBefore = __atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED);
+        if (write(badFd, frame, frameLen) != (ssize_t)frameLen) {
+            result = IPCS_WRITE_FAIL;
+        }
+        /* 坏帧之后的调用在已关闭的连接上失败 */
+        badResult = ChecksumCall(badFd);
+        callsAfter = __atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED);
+        goodResult = ChecksumCall(goodFd);
+        plainResult = ChecksumCall(plainFd);
+    }
+    (void)IPCS_DestroyClient(badFd);
+    (void)IPCS_DestroyClient(goodFd);
+    (void)IPCS_DestroyClient(plainFd);
+
+    TEST_CHECK(result == IPCS_OK, "setup: %d", result);
+    TEST_CHECK(badResult != IPCS_OK, "call after a corrupt frame succeeded");
+    TEST_CHECK(callsAfter == callsBefore, "server hook called %llu times for a corrupt frame",
+            callsAfter - callsBefore);
+    TEST_CHECK(goodResult == IPCS_OK, "other checksum connection: %d", goodResult);
+    TEST_CHECK(plainResult == IPCS_OK, "other plain connection: %d", plainResult);
+
+    return IPCS_OK;
+}
+
+/* 同意校验和、把回显的响应破坏一位后发出的对端 */
+static void *ChecksumRawServerRun(void *arg)
+{
+    unsigned int ctrl[3];
+    unsigned int reply[3] = {IPCS_CTRL_OPTIONS, sizeof(unsigned int) | IPCS_MSG_FLAG_CONTROL, IPCS_MSG_FLAG_CHECKSUM};
+    char buf[CHECKSUM_FRAME_LEN];
+    char resp[CHECKSUM_FRAME_LEN];
+    char value[CHECKSUM_PAYLOAD_LEN];
+    IPCS_Message msg;
+    unsigned int callId = 0;
+    unsigned int respLen = sizeof(resp);
+    ssize_t n = 0;
+    int fd = -1;
+
+    fd = accept(g_RawListenFd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    msg.msgLen = sizeof(value);
+    msg.msgValue = value;
+    if ((recv(fd, ctrl, sizeof(ctrl), MSG_WAITALL) == (ssize_t)sizeof(ctrl)) && (ctrl[0] == IPCS_CTRL_OPTIONS) &&
+        (send(fd, reply, sizeof(reply), MSG_NOSIGNAL) == (ssize_t)sizeof(reply)) &&
+        ((n = recv(fd, buf, sizeof(buf), 0)) > 0) &&
+        (IPCS_StreamToMsgEx(buf, (unsigned int)n, &msg, &callId, NULL) == IPCS_OK) &&
+        (IPCS_MsgToStreamFlags(&msg, callId, IPCS_PRIO_NORMAL, 0, IPCS_MSG_FLAG_CHECKSUM, resp, &respLen) == IPCS_OK)) {
+        resp[respLen - IPCS_CHECKSUM_LEN - 1] ^= 0x01;
+        (void)send(fd, resp, respLen, MSG_NOSIGNAL);
+    }
+
+    /* 等客户端关闭连接 */
+    (void)recv(fd, buf, sizeof(buf), 0);
+    (void)close(fd);
+
+    return NULL;
+}
+
+/* 同步客户端收到校验失败的响应时返回IPCS_CHECKSUM_FAIL */
+static int ChecksumTestClient(void)
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen = offsetof(struct sockaddr_un, sun_path) + strlen(CHECKSUM_RAW_NAME);
+    pthread_t tid;
+    int fd = -1;
+    int callResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)memcpy(addr.sun_path + 1, CHECKSUM_RAW_NAME + 1, strlen(CHECKSUM_RAW_NAME) - 1);
+    g_RawListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_CHECK(g_RawListenFd >= 0, "raw socket fail");
+    if ((bind(g_RawListenFd, (struct sockaddr *)&addr, addrLen) < 0) || (listen(g_RawListenFd, 4) < 0) ||
+        (pthread_create(&tid, NULL, ChecksumRawServerRun, NULL) != 0)) {
+        (void)close(g_RawListenFd);
+        TEST_CHECK(0, "raw server setup fail");
+    }
+
+    result = ChecksumCreateClient(CHECKSUM_RAW_NAME, 1, &fd);
+    if (result == IPCS_OK) {
+        callResult = ChecksumCall(fd);
+        (void)IPCS_DestroyClient(fd);
+    } else {
+        (void)shutdown(g_RawListenFd, SHUT_RDWR);
+    }
+    (void)pthread_join(tid, NULL);
+    (void)close(g_RawListenFd);
+
+    TEST_CHECK(result == IPCS_OK, "create client to raw server: %d", result);
+    TEST_CHECK(callResult == IPCS_CHECKSUM_FAIL, "call with corrupt response returned %d, expect %d", callResult,
+            IPCS_CHECKSUM_FAIL);
+
+    return IPCS_OK;
+}
+
+/* 服务端不同意时连接不带校验和，调用照常 */
+static int ChecksumTestDeclined(void)
+{
+    IPCS_ServerAttr serverAttr;
+    int fd = -1;
+    int callResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.readyTimeoutMs = CHECKSUM_WAIT_MS;
+    result = IPCS_CreateServerEx(CHECKSUM_PLAIN_NAME, ChecksumServerHook, &serverAttr);
+    TEST_CHECK(result == IPCS_OK, "create plain server: %d", result);
+
+    result = ChecksumCreateClient(CHECKSUM_PLAIN_NAME, 1, &fd);
+    if (result == IPCS_OK) {
+        callResult = ChecksumCall(fd);
+        (void)IPCS_DestroyClient(fd);
+    }
+    (void)IPCS_DestroyServer(CHECKSUM_PLAIN_NAME);
+
+    TEST_CHECK(result == IPCS_OK, "create client: %d", result);
+    TEST_CHECK(callResult == IPCS_OK, "call on declined connection: %d", callResult);
+
+    return IPCS_OK;
+}
+
+static const CHECKSUM_Case g_Cases[] = {
+    {"parse", ChecksumTestParse},
+    {"server", ChecksumTestServer},
+    {"client", ChecksumTestClient},
+    {"declined", ChecksumTestDeclined},
+};
+
+/******************************************************************************/
+int main(void)
+{
+    IPCS_ServerAttr serverAttr;
+    unsigned int failed = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_EnableLog(0);
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.readyTimeoutMs = CHECKSUM_WAIT_MS;
+    serverAttr.checksum = 1;
+    result = IPCS_CreateServerEx(CHECKSUM_SERVER_NAME, ChecksumServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        BENCH_PRINT("checksum test setup fail: %d", result);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++) {
+        result = g_Cases[i].run();
+        BENCH_PRINT("%-20s %s", g_Cases[i].name, (result == IPCS_OK) ? "PASS" : "FAIL");
+        failed += (result != IPCS_OK);
+    }
+    BENCH_PRINT("checksum: %u passed, %u failed", i - failed, failed);
+
+    (void)IPCS_DestroyServer(CHECKSUM_SERVER_NAME);
+    (void)fflush(NULL);
+
+    return (failed == 0) ? 0 : 1;
+}
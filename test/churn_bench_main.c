@@ -0,0 +1,180 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  churn_bench_main.c
+ *
+ *    Description:  connection churn benchmark (connects/sec)
+ *
+ *                  反复创建、销毁同步客户端，比较三种地址方式的建链速率：
+ *                  path      服务端和客户端都使用文件系统路径（unlink + bind）
+ *                  abstract  服务端和客户端都使用抽象命名空间地址
+ *                  autobind  服务端使用抽象地址，客户端由内核自动分配地址
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 02:48:10 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define CHURN_MSG_TYPE      0x4348   /* "CH" */
+
+typedef struct {
+    const char *mode;
+    const char *serverName;
+    const char *clientName;
+} ChurnMode;
+
+static const ChurnMode g_Modes[] = {
+    {"path",     "/tmp/ipcs_churn_server_path", "/tmp/ipcs_churn_client"},
+    {"abstract", "@ipcs_churn_server_abstract", "@ipcs_churn_client"},
+    {"autobind", "@ipcs_churn_server_autobind", NULL},
+};
+
+static double g_DurationSec = 3.0;
+static int g_Ping = 0;
+
+/******************************************************************************/
+int ChurnEchoHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static int ChurnPing(int fd)
+{
+    uint64_t sendValue = 1;
+    uint64_t recvValue = 0;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+
+    sendMsg.msgType = CHURN_MSG_TYPE;
+    sendMsg.msgLen = sizeof(sendValue);
+    sendMsg.msgValue = &sendValue;
+
+    recvMsg.msgType = 0;
+    recvMsg.msgLen = sizeof(recvValue);
+    recvMsg.msgValue = &recvValue;
+
+    return IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+}
+
+static int ChurnRunMode(const ChurnMode *mode, BENCH_Histogram *hist)
+{
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t opStartNs = 0;
+    uint64_t connects = 0;
+    int fd = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_CreateServer(mode->serverName, ChurnEchoHook);
+    if (result != IPCS_OK) {
+        TEST_PRINT("churn create server %s fail: %d", mode->serverName, result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    BENCH_HistReset(hist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+
+    while (BENCH_NowNs() < endNs) {
+        opStartNs = BENCH_NowNs();
+
+        result = IPCS_CreateSyncClient(mode->clientName, mode->serverName, &fd);
+        if (result != IPCS_OK) {
+            TEST_PRINT("churn %s create client fail: %d after %llu connects", mode->mode, result,
+                    (unsigned long long)connects);
+            break;
+        }
+
+        if (g_Ping) {
+            result = ChurnPing(fd);
+        }
+
+        (void)IPCS_DestroyClient(fd);
+        if (result != IPCS_OK) {
+            TEST_PRINT("churn %s ping fail: %d", mode->mode, result);
+            break;
+        }
+
+        BENCH_HistRecord(hist, BENCH_NowNs() - opStartNs);
+        connects++;
+    }
+    endNs = BENCH_NowNs();
+
+    BENCH_PRINT("%-9s %10llu connects %12.0f connects/s", mode->mode, (unsigned long long)connects,
+            (double)connects * BENCH_NS_PER_SEC / (double)(endNs - startNs));
+    BENCH_HistPrintSummary(hist, "  connect+close");
+
+    (void)IPCS_DestroyServer(mode->serverName);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    BENCH_Histogram *hist = NULL;
+    const char *onlyMode = NULL;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:m:ph")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'm':
+                onlyMode = optarg;
+                break;
+            case 'p':
+                g_Ping = 1;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-m path|abstract|autobind] [-p]\n"
+                             "  -p sends one request on every connection before closing it.\n", argv[0]);
+                return -1;
+        }
+    }
+
+    IPCS_EnableLog(0);
+
+    hist = (BENCH_Histogram *)malloc(sizeof(BENCH_Histogram));
+    if (hist == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < sizeof(g_Modes) / sizeof(g_Modes[0]); i++) {
+        if ((onlyMode != NULL) && (strcmp(onlyMode, g_Modes[i].mode) != 0)) {
+            continue;
+        }
+
+        result = ChurnRunMode(&g_Modes[i], hist);
+        if (result != IPCS_OK) {
+            break;
+        }
+    }
+
+    free(hist);
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,282 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  coalesce_test_main.c
+ *
+ *    Description:  request coalescing tests
+ *
+ *                  服务端回调函数处理每个请求时睡眠COALESCE_HOOK_MS毫秒，响应中带上请求的键和回调
+ *                  函数的调用序号。检查：开启合并后同时发出的相同请求只调用一次回调函数、都收到同一个
+ *                  响应，coalesced统计为其余的请求数；负载不同的请求不合并；回调函数返回之后发出的
+ *                  相同请求重新调用回调函数；关闭合并后每个请求都调用回调函数。全部通过时返回0。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:14:36 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define COALESCE_SERVER_NAME    "@ipcs_coalesce_test"
+#define COALESCE_MSG_TYPE       0x434F   /* "CO" */
+#define COALESCE_HOOK_MS        300      /* 远大于线程同时发出请求的时间差 */
+#define COALESCE_CLIENTS        6
+#define COALESCE_WAIT_MS        5000
+
+typedef struct {
+    const char *name;
+    int (*run)(void);
+} COALESCE_Case;
+
+typedef struct {
+    pthread_t tid;
+    int fd;
+    unsigned int key;
+    unsigned int respKey;
+    unsigned int respCall;
+    int result;
+} COALESCE_Client;
+
+static unsigned int g_HookCalls = 0;
+static pthread_barrier_t g_Barrier;
+static COALESCE_Client g_Clients[COALESCE_CLIENTS];
+
+/******************************************************************************/
+/* 响应：请求的键、本次回调函数的调用序号 */
+int CoalesceServerHook(int fd, IPCS_Message *msg)
+{
+    unsigned int resp[2];
+    IPCS_Message respMsg;
+
+    (void)usleep(COALESCE_HOOK_MS * 1000);
+
+    (void)memcpy(&resp[0], msg->msgValue, sizeof(resp[0]));
+    resp[1] = __atomic_add_fetch(&g_HookCalls, 1, __ATOMIC_RELEASE);
+    respMsg.msgType = msg->msgType;
+    respMsg.msgLen = sizeof(resp);
+    respMsg.msgValue = resp;
+
+    return IPCS_ServerSendMessage(fd, &respMsg);
+}
+
+static void *CoalesceClientRun(void *arg)
+{
+    COALESCE_Client *client = (COALESCE_Client *)arg;
+    unsigned int resp[2] = {0, 0};
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+
+    sendMsg.msgType = COALESCE_MSG_TYPE;
+    sendMsg.msgLen = sizeof(client->key);
+    sendMsg.msgValue = &client->key;
+    recvMsg.msgLen = sizeof(resp);
+    recvMsg.msgValue = resp;
+
+    (void)pthread_barrier_wait(&g_Barrier);
+    client->result = IPCS_ClientSyncCallTimeout(client->fd, &sendMsg, &recvMsg, COALESCE_WAIT_MS);
+    if ((client->result == IPCS_OK) && (recvMsg.msgLen != sizeof(resp))) {
+        client->result = IPCS_FRAME_BAD;
+    }
+    client->respKey = resp[0];
+    client->respCall = resp[1];
+
+    return NULL;
+}
+
+/* num个客户端同时发出请求，第i个客户端的键为keys[i % keyNum] */
+static int CoalesceRunClients(unsigned int num, const unsigned int *keys, unsigned int keyNum)
+{
+    unsigned int started = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    (void)pthread_barrier_init(&g_Barrier, NULL, num);
+    for (started = 0; started < num; started++) {
+        g_Clients[started].key = keys[started % keyNum];
+        g_Clients[started].result = IPCS_OK;
+        g_Clients[started].respKey = 0;
+        g_Clients[started].respCall = 0;
+        if (pthread_create(&g_Clients[started].tid, NULL, CoalesceClientRun, &g_Clients[started]) != 0) {
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+    /* 没有全部启动时已启动的线程会一直等在屏障上，只能退出 */
+    if (result != IPCS_OK) {
+        BENCH_PRINT("coalesce start client %u fail", started);
+        _exit(1);
+    }
+
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_Clients[i].tid, NULL);
+        if ((result == IPCS_OK) && (g_Clients[i].result != IPCS_OK)) {
+            result = g_Clients[i].result;
+        }
+    }
+    (void)pthread_barrier_destroy(&g_Barrier);
+
+    return result;
+}
+
+static unsigned long long CoalesceCount(void)
+{
+    IPCS_ServerStats stats;
+
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)IPCS_GetServerStats(COALESCE_SERVER_NAME, &stats);
+
+    return stats.coalesced;
+}
+
+/******************************************************************************/
+/* 同时发出的相同请求只调用一次回调函数，都收到同一个响应 */
+static int CoalesceTestSame(void)
+{
+    unsigned int key = 7;
+    unsigned int callsBefore = __atomic_load_n(&g_HookCalls, __ATOMIC_ACQUIRE);
+    unsigned long long coalescedBefore = CoalesceCount();
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    result = CoalesceRunClients(COALESCE_CLIENTS, &key, 1);
+    TEST_CHECK(result == IPCS_OK, "concurrent calls: %d", result);
+    TEST_CHECK(g_HookCalls == callsBefore + 1, "hook called %u times for identical requests",
+            g_HookCalls - callsBefore);
+    TEST_CHECK(CoalesceCount() == coalescedBefore + COALESCE_CLIENTS - 1, "coalesced %llu of %u requests",
+            CoalesceCount() - coalescedBefore, COALESCE_CLIENTS - 1);
+    for (i = 0; i < COALESCE_CLIENTS; i++) {
+        TEST_CHECK(g_Clients[i].respKey == key, "client %u got key %u, expect %u", i, g_Clients[i].respKey, key);
+        TEST_CHECK(g_Clients[i].respCall == callsBefore + 1, "client %u got response of call %u, expect %u", i,
+                g_Clients[i].respCall, callsBefore + 1);
+    }
+
+    return IPCS_OK;
+}
+
+/* 负载不同的请求各自调用回调函数，不会收到其他请求的响应 */
+static int CoalesceTestDistinct(void)
+{
+    unsigned int keys[2] = {11, 12};
+    unsigned int callsBefore = __atomic_load_n(&g_HookCalls, __ATOMIC_ACQUIRE);
+    unsigned long long coalescedBefore = CoalesceCount();
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    result = CoalesceRunClients(COALESCE_CLIENTS, keys, 2);
+    TEST_CHECK(result == IPCS_OK, "concurrent calls: %d", result);
+    TEST_CHECK(g_HookCalls == callsBefore + 2, "hook called %u times for two distinct requests",
+            g_HookCalls - callsBefore);
+    TEST_CHECK(CoalesceCount() == coalescedBefore + COALESCE_CLIENTS - 2, "coalesced %llu of %u requests",
+            CoalesceCount() - coalescedBefore, COALESCE_CLIENTS - 2);
+    for (i = 0; i < COALESCE_CLIENTS; i++) {
+        TEST_CHECK(g_Clients[i].respKey == g_Clients[i].key, "client %u got key %u, expect %u", i,
+                g_Clients[i].respKey, g_Clients[i].key);
+    }
+
+    return IPCS_OK;
+}
+
+/* 回调函数返回之后发出的相同请求不复用已完成的响应 */
+static int CoalesceTestLater(void)
+{
+    unsigned int key = 7;
+    unsigned int callsBefore = __atomic_load_n(&g_HookCalls, __ATOMIC_ACQUIRE);
+    unsigned long long coalescedBefore = CoalesceCount();
+    int result = IPCS_OK;
+
+    result = CoalesceRunClients(1, &key, 1);
+    TEST_CHECK(result == IPCS_OK, "call: %d", result);
+    TEST_CHECK(g_HookCalls == callsBefore + 1, "later identical request did not call the hook");
+    TEST_CHECK(g_Clients[0].respCall == callsBefore + 1, "later request got response of call %u, expect %u",
+            g_Clients[0].respCall, callsBefore + 1);
+    TEST_CHECK(CoalesceCount() == coalescedBefore, "later request was coalesced");
+
+    return IPCS_OK;
+}
+
+/* 关闭合并后每个请求都调用回调函数 */
+static int CoalesceTestDisabled(void)
+{
+    unsigned int key = 7;
+    unsigned int callsBefore = __atomic_load_n(&g_HookCalls, __ATOMIC_ACQUIRE);
+    unsigned long long coalescedBefore = CoalesceCount();
+    int result = IPCS_OK;
+
+    result = IPCS_ServerSetCoalesce(COALESCE_SERVER_NAME, COALESCE_MSG_TYPE, 0);
+    TEST_CHECK(result == IPCS_OK, "disable coalesce: %d", result);
+
+    result = CoalesceRunClients(COALESCE_CLIENTS, &key, 1);
+    (void)IPCS_ServerSetCoalesce(COALESCE_SERVER_NAME, COALESCE_MSG_TYPE, 1);
+    TEST_CHECK(result == IPCS_OK, "concurrent calls: %d", result);
+    TEST_CHECK(g_HookCalls == callsBefore + COALESCE_CLIENTS, "hook called %u times, expect %u",
+            g_HookCalls - callsBefore, COALESCE_CLIENTS);
+    TEST_CHECK(CoalesceCount() == coalescedBefore, "requests coalesced while disabled");
+
+    return IPCS_OK;
+}
+
+static const COALESCE_Case g_Cases[] = {
+    {"same", CoalesceTestSame},
+    {"distinct", CoalesceTestDistinct},
+    {"later", CoalesceTestLater},
+    {"disabled", CoalesceTestDisabled},
+};
+
+/******************************************************************************/
+int main(void)
+{
+    IPCS_ServerAttr serverAttr;
+    unsigned int failed = 0;
+    unsigned int opened = 0;
+    int setupFailed = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_EnableLog(0);
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.readyTimeoutMs = COALESCE_WAIT_MS;
+    result = IPCS_CreateServerEx(COALESCE_SERVER_NAME, CoalesceServerHook, &serverAttr);
+    if (result == IPCS_OK) {
+        result = IPCS_ServerSetCoalesce(COALESCE_SERVER_NAME, COALESCE_MSG_TYPE, 1);
+    }
+    for (opened = 0; (result == IPCS_OK) && (opened < COALESCE_CLIENTS); opened++) {
+        result = IPCS_CreateSyncClient(NULL, COALESCE_SERVER_NAME, &g_Clients[opened].fd);
+    }
+    if (result != IPCS_OK) {
+        BENCH_PRINT("coalesce test setup fail: %d", result);
+        setupFailed = 1;
+    }
+
+    for (i = 0; !setupFailed && (i < sizeof(g_Cases) / sizeof(g_Cases[0])); i++) {
+        result = g_Cases[i].run();
+        BENCH_PRINT("%-20s %s", g_Cases[i].name, (result == IPCS_OK) ? "PASS" : "FAIL");
+        failed += (result != IPCS_OK);
+    }
+    if (!setupFailed) {
+        BENCH_PRINT("coalesce: %u passed, %u failed", i - failed, failed);
+    }
+
+    for (i = 0; i < opened; i++) {
+        (void)IPCS_DestroyClient(g_Clients[i].fd);
+    }
+    (void)IPCS_DestroyServer(COALESCE_SERVER_NAME);
+    (void)fflush(NULL);
+
+    return (!setupFailed && (failed == 0)) ? 0 : 1;
+}
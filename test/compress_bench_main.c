@@ -0,0 +1,404 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  compress_bench_main.c
+ *
+ *    Description:  payload compression benchmark
+ *
+ *                  按四种熵的负载（zero全0、text类似JSON的记录、mixed四种字符随机、random
+ *                  随机字节）运行：codec输出压缩和解压的吞吐、压缩比，检查解压结果与原数据一致；
+ *                  frame检查小于IPCS_COMPRESS_MIN_LEN的负载和压缩后不变小的负载按原样编码；
+ *                  calls用同步客户端对回显服务端发出-s字节的调用，分off（不协商压缩）和on
+ *                  （协商压缩）两种配置，输出调用速率、每次调用的进程CPU时间和帧长。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:25:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+#include "ipcs_common.h"
+#include "ipcs_lz.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define COMP_MSG_TYPE           0x4C5A   /* "LZ" */
+#define COMP_SPEED_MIN_NS       (200 * BENCH_NS_PER_MS)
+#define COMP_MAX_MSG_LEN        (IPCS_MESSAGE_MAX_LEN - IPCS_MSG_HEADER_LEN)    /* 最大的消息负载 */
+
+typedef enum {
+    COMP_KIND_ZERO,
+    COMP_KIND_TEXT,
+    COMP_KIND_MIXED,
+    COMP_KIND_RANDOM,
+    COMP_KIND_NUM
+} COMP_Kind;
+
+typedef struct {
+    const char *name;
+    int compress;
+} COMP_Config;
+
+static const char *g_KindNames[COMP_KIND_NUM] = {"zero", "text", "mixed", "random"};
+
+static const COMP_Config g_Configs[] = {
+    {"off", 0},
+    {"on", 1},
+};
+
+static double g_DurationSec = 1.0;
+static unsigned int g_MsgLen = 16384;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyKind = NULL;
+
+/******************************************************************************/
+int CompServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static uint64_t CompCpuNs(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * BENCH_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+/* 按kind填充len字节 */
+static void CompFill(COMP_Kind kind, char *buf, unsigned int len)
+{
+    char record[128];
+    unsigned int off = 0;
+    unsigned int recLen = 0;
+    unsigned int i = 0;
+
+    switch (kind) {
+        case COMP_KIND_ZERO:
+            (void)memset(buf, 0, len);
+            break;
+        case COMP_KIND_TEXT:
+            for (i = 0; off < len; i++) {
+                recLen = (unsigned int)snprintf(record, sizeof(record),
+                        "{\"id\":%u,\"name\":\"user%u\",\"score\":%d,\"active\":%s},", 100000 + i,
+                        (unsigned int)rand() % 1000, rand() % 10000, (rand() & 1) ? "true" : "false");
+                recLen = (recLen < len - off) ? recLen : len - off;
+                (void)memcpy(buf + off, record, recLen);
+                off += recLen;
+            }
+            break;
+        case COMP_KIND_MIXED:
+            for (i = 0; i < len; i++) {
+                buf[i] = "ACGT"[rand() & 3];
+            }
+            break;
+        default:
+            for (i = 0; i < len; i++) {
+                buf[i] = (char)rand();
+            }
+            break;
+    }
+
+    return;
+}
+
+/******************************************************************************/
+/* 压缩和解压的吞吐（MB/s，按原数据长度）；压缩不变小时只输出压缩尝试的速度 */
+static int CompRunCodec(COMP_Kind kind, const char *data)
+{
+    char *comp = NULL;
+    char *plain = NULL;
+    unsigned int compLen = 0;
+    uint64_t iters = 0;
+    uint64_t startNs = 0;
+    uint64_t elapsedNs = 0;
+    double compMBps = 0;
+    double decompMBps = 0;
+    int result = IPCS_OK;
+
+    comp = (char *)malloc(g_MsgLen);
+    plain = (char *)malloc(g_MsgLen);
+    if ((comp == NULL) || (plain == NULL)) {
+        free(comp);
+        free(plain);
+        return IPCS_MALLOC_FAIL;
+    }
+
+    startNs = BENCH_NowNs();
+    do {
+        compLen = IPCS_LzCompress(data, g_MsgLen, comp, g_MsgLen - 1);
+        iters++;
+        elapsedNs = BENCH_NowNs() - startNs;
+    } while (elapsedNs < COMP_SPEED_MIN_NS);
+    compMBps = (double)iters * g_MsgLen * BENCH_NS_PER_SEC / (double)elapsedNs / (1024.0 * 1024.0);
+
+    if (compLen != 0) {
+        iters = 0;
+        startNs = BENCH_NowNs();
+        do {
+            if (IPCS_LzDecompress(comp, compLen, plain, g_MsgLen) != (int)g_MsgLen) {
+                result = IPCS_STREAM_BUF_BAD;
+                break;
+            }
+            iters++;
+            elapsedNs = BENCH_NowNs() - startNs;
+        } while (elapsedNs < COMP_SPEED_MIN_NS);
+        decompMBps = (double)iters * g_MsgLen * BENCH_NS_PER_SEC / (double)elapsedNs / (1024.0 * 1024.0);
+        if ((result == IPCS_OK) && (memcmp(plain, data, g_MsgLen) != 0)) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+    }
+
+    if (compLen != 0) {
+        BENCH_PRINT("codec    kind=%-6s size=%u comp=%u ratio=%.3f check=%s", g_KindNames[kind], g_MsgLen, compLen,
+                (double)compLen / g_MsgLen, (result == IPCS_OK) ? "ok" : "FAIL");
+        BENCH_PRINT("  compress %.0f MB/s  decompress %.0f MB/s", compMBps, decompMBps);
+    } else {
+        BENCH_PRINT("codec    kind=%-6s size=%u incompressible", g_KindNames[kind], g_MsgLen);
+        BENCH_PRINT("  compress attempt %.0f MB/s", compMBps);
+    }
+
+    free(comp);
+    free(plain);
+
+    return result;
+}
+
+/* 按压缩选项编码一帧，返回帧长和是否压缩 */
+static int CompEncode(const char *data, unsigned int len, unsigned int *frameLen, int *compressed)
+{
+    IPCS_Message msg;
+    void *frame = NULL;
+    int result = IPCS_OK;
+
+    frame = malloc(IPCS_FRAME_MAX_LEN);
+    if (frame == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    msg.msgType = COMP_MSG_TYPE;
+    msg.msgLen = len;
+    msg.msgValue = (void *)data;
+    *frameLen = IPCS_FRAME_MAX_LEN;
+    result = IPCS_MsgToStreamFlags(&msg, IPCS_NO_CALL_ID, IPCS_PRIO_NORMAL, 0, IPCS_MSG_FLAG_COMPRESSED, frame,
+            frameLen);
+    *compressed = ((((IPCS_Message *)frame)->msgLen & IPCS_MSG_FLAG_COMPRESSED) != 0);
+    free(frame);
+
+    return result;
+}
+
+/* 阈值以下的负载和压缩后不变小的负载（随机数据）按原样编码 */
+static int CompRunFrame(void)
+{
+    char *text = NULL;
+    char *noise = NULL;
+    unsigned int belowLen = 0;
+    unsigned int atLen = 0;
+    unsigned int noiseLen = 0;
+    int below = 0;
+    int at = 0;
+    int noisy = 0;
+    int result = IPCS_OK;
+
+    text = (char *)malloc(IPCS_COMPRESS_MIN_LEN);
+    noise = (char *)malloc(COMP_MAX_MSG_LEN);
+    if ((text == NULL) || (noise == NULL)) {
+        free(text);
+        free(noise);
+        return IPCS_MALLOC_FAIL;
+    }
+    CompFill(COMP_KIND_TEXT, text, IPCS_COMPRESS_MIN_LEN);
+    CompFill(COMP_KIND_RANDOM, noise, COMP_MAX_MSG_LEN);
+
+    result = CompEncode(text, IPCS_COMPRESS_MIN_LEN - 1, &belowLen, &below);
+    if (result == IPCS_OK) {
+        result = CompEncode(text, IPCS_COMPRESS_MIN_LEN, &atLen, &at);
+    }
+    if (result == IPCS_OK) {
+        result = CompEncode(noise, COMP_MAX_MSG_LEN, &noiseLen, &noisy);
+    }
+
+    BENCH_PRINT("frame    below_min=%u/%d at_min=%u/%d random=%u/%d (frame len/compressed)", belowLen, below, atLen,
+            at, noiseLen, noisy);
+    if ((result == IPCS_OK) && (below || !at || noisy || (belowLen != IPCS_MSG_HEADER_LEN + IPCS_COMPRESS_MIN_LEN - 1) ||
+        (noiseLen != IPCS_MSG_HEADER_LEN + COMP_MAX_MSG_LEN))) {
+        result = IPCS_STREAM_BUF_BAD;
+    }
+
+    free(text);
+    free(noise);
+
+    return result;
+}
+
+/******************************************************************************/
+static int CompRunCalls(COMP_Kind kind, const COMP_Config *config, const char *sendBuf, double *callsPerSec,
+        double *cpuUsPerCall)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_ClientAttr clientAttr;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    char serverName[64];
+    char *recvBuf = NULL;
+    unsigned long long calls = 0;
+    unsigned int frameLen = 0;
+    int compressed = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t startCpuNs = 0;
+    uint64_t cpuNs = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    (void)snprintf(serverName, sizeof(serverName), "@ipcs_compress_bench_%s_%s", g_KindNames[kind], config->name);
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.readyTimeoutMs = 1000;
+    serverAttr.compress = 1;
+    result = IPCS_CreateServerEx(serverName, CompServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("compress create server fail: %d", result);
+        return result;
+    }
+
+    recvBuf = (char *)malloc(COMP_MAX_MSG_LEN);
+    result = (recvBuf == NULL) ? IPCS_MALLOC_FAIL : IPCS_OK;
+    if (result == IPCS_OK) {
+        IPCS_InitClientAttr(&clientAttr);
+        clientAttr.compress = config->compress;
+        result = IPCS_CreateSyncClientEx(NULL, serverName, &clientAttr, &fd);
+    }
+
+    sendMsg.msgType = COMP_MSG_TYPE;
+    sendMsg.msgLen = g_MsgLen;
+    sendMsg.msgValue = (void *)sendBuf;
+    startNs = BENCH_NowNs();
+    startCpuNs = CompCpuNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    while ((result == IPCS_OK) && (BENCH_NowNs() < endNs)) {
+        recvMsg.msgLen = COMP_MAX_MSG_LEN;
+        recvMsg.msgValue = recvBuf;
+        result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+        if ((result == IPCS_OK) && ((recvMsg.msgLen != g_MsgLen) || (memcmp(recvBuf, sendBuf, g_MsgLen) != 0))) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+        if (result == IPCS_OK) {
+            calls++;
+        }
+    }
+    cpuNs = CompCpuNs() - startCpuNs;
+    endNs = BENCH_NowNs();
+
+    if (fd >= 0) {
+        (void)IPCS_DestroyClient(fd);
+    }
+    (void)IPCS_DestroyServer(serverName);
+    free(recvBuf);
+
+    /* 线上的帧长：off时为原负载，on时压缩不变小的负载也按原样发送 */
+    frameLen = IPCS_MSG_HEADER_LEN + g_MsgLen;
+    if ((result == IPCS_OK) && config->compress) {
+        result = CompEncode(sendBuf, g_MsgLen, &frameLen, &compressed);
+    }
+
+    *callsPerSec = (double)calls * BENCH_NS_PER_SEC / (double)(endNs - startNs);
+    *cpuUsPerCall = (calls != 0) ? (double)cpuNs / BENCH_NS_PER_US / (double)calls : 0;
+    BENCH_PRINT("calls    kind=%-6s %-3s size=%u frame=%u engine=%s result=%d", g_KindNames[kind], config->name,
+            g_MsgLen, frameLen, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll", result);
+    BENCH_PRINT("  %.0f calls/s  %.1f us cpu/call", *callsPerSec, *cpuUsPerCall);
+
+    return result;
+}
+
+static int CompRunKind(COMP_Kind kind)
+{
+    double callsPerSec[sizeof(g_Configs) / sizeof(g_Configs[0])];
+    double cpuUsPerCall[sizeof(g_Configs) / sizeof(g_Configs[0])];
+    char *data = NULL;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    data = (char *)malloc(g_MsgLen);
+    if (data == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    CompFill(kind, data, g_MsgLen);
+
+    result = CompRunCodec(kind, data);
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        result = CompRunCalls(kind, &g_Configs[i], data, &callsPerSec[i], &cpuUsPerCall[i]);
+    }
+    if ((result == IPCS_OK) && (callsPerSec[0] != 0) && (cpuUsPerCall[0] != 0)) {
+        BENCH_PRINT("  on/off: calls x%.2f  cpu/call x%.2f", callsPerSec[1] / callsPerSec[0],
+                cpuUsPerCall[1] / cpuUsPerCall[0]);
+    }
+
+    free(data);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int kind = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:s:e:k:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 's':
+                g_MsgLen = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'k':
+                g_OnlyKind = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-s msgLen] [-e epoll|uring] [-k zero|text|mixed|random]\n",
+                        argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_MsgLen < 2) || (g_MsgLen > COMP_MAX_MSG_LEN)) {
+        (void)printf("msgLen 2..%u\n", (unsigned int)COMP_MAX_MSG_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+    srand(1);
+
+    result = CompRunFrame();
+    for (kind = 0; (kind < COMP_KIND_NUM) && (result == IPCS_OK); kind++) {
+        if ((g_OnlyKind != NULL) && (strcmp(g_OnlyKind, g_KindNames[kind]) != 0)) {
+            continue;
+        }
+        result = CompRunKind((COMP_Kind)kind);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
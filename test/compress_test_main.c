@@ -0,0 +1,459 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  compress_test_main.c
+ *
+ *    Description:  payload compression tests
+ *
+ *                  检查：压缩的帧解析后与原数据一致；负载不足原始长度字段、原始长度越界或与解压
+ *                  结果不符、压缩数据被截断、匹配距离越界时解析失败；随机破坏压缩数据时解析不会
+ *                  写出原始长度之外；服务端收到无法解压的帧或带没有协商的帧选项的帧时只关闭该连接、
+ *                  不调用回调函数；同步客户端收到这样的响应时返回IPCS_FRAME_BAD。全部通过时返回0。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 10:02:18 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+#include "ipcs_common.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define COMPRESS_SERVER_NAME    "@ipcs_compress_test"
+#define COMPRESS_RAW_NAME       "@ipcs_compress_test_raw"
+#define COMPRESS_MSG_TYPE       0x435A   /* "CZ" */
+#define COMPRESS_TEXT_LEN       4096
+#define COMPRESS_SMALL_LEN      64
+#define COMPRESS_FUZZ_ROUNDS    2000
+#define COMPRESS_CANARY         0xA5
+#define COMPRESS_CANARY_LEN     64
+#define COMPRESS_WAIT_MS        1000
+
+typedef struct {
+    const char *name;
+    int (*run)(void);
+} COMPRESS_Case;
+
+/* 原始对端的响应 */
+typedef enum {
+    COMPRESS_RAW_GARBAGE = 0,   /* 带压缩标志、无法解压的负载 */
+    COMPRESS_RAW_CHECKSUM,      /* 带没有协商的校验和标志 */
+    COMPRESS_RAW_BUTT
+} COMPRESS_RawReply;
+
+static unsigned long long g_ServerCalls = 0;
+static int g_RawListenFd = -1;
+static char g_Text[COMPRESS_TEXT_LEN];
+
+/******************************************************************************/
+int CompressServerHook(int fd, IPCS_Message *msg)
+{
+    (void)__atomic_add_fetch(&g_ServerCalls, 1, __ATOMIC_RELAXED);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 类似JSON的记录，压缩后明显变小 */
+static void CompressFillText(char *buf, unsigned int len)
+{
+    unsigned int off = 0;
+    int n = 0;
+
+    while (off < len) {
+        n = snprintf(buf + off, len - off, "{\"id\":%u,\"name\":\"user%u\",\"active\":true},", off, off % 97);
+        if (n <= 0) {
+            break;
+        }
+        off += (unsigned int)n;
+    }
+
+    return;
+}
+
+static int CompressCreateClient(const char *serverName, int compress, int *fd)
+{
+    IPCS_ClientAttr clientAttr;
+
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.compress = compress;
+
+    return IPCS_CreateSyncClientEx(NULL, serverName, &clientAttr, fd);
+}
+
+/* 调用一次并检查回显的内容 */
+static int CompressCall(int fd, const char *value, unsigned int len)
+{
+    static char recvBuf[COMPRESS_TEXT_LEN];
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    int result = IPCS_OK;
+
+    sendMsg.msgType = COMPRESS_MSG_TYPE;
+    sendMsg.msgLen = len;
+    sendMsg.msgValue = (void *)value;
+    recvMsg.msgLen = sizeof(recvBuf);
+    recvMsg.msgValue = recvBuf;
+    result = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, COMPRESS_WAIT_MS);
+    if ((result == IPCS_OK) && ((recvMsg.msgLen != len) || (memcmp(recvBuf, value, len) != 0))) {
+        result = IPCS_FRAME_BAD;
+    }
+
+    return result;
+}
+
+/* 编码压缩的帧（不带调用ID），返回帧长，负载没有被压缩时返回0 */
+static unsigned int CompressBuildFrame(char *frame, unsigned int frameCap)
+{
+    IPCS_Message msg;
+    unsigned int frameLen = frameCap;
+
+    msg.msgType = COMPRESS_MSG_TYPE;
+    msg.msgLen = sizeof(g_Text);
+    msg.msgValue = g_Text;
+    if ((IPCS_MsgToStreamFlags(&msg, IPCS_NO_CALL_ID, IPCS_PRIO_NORMAL, 0, IPCS_MSG_FLAG_COMPRESSED, frame,
+            &frameLen) != IPCS_OK) || !(((IPCS_Message *)frame)->msgLen & IPCS_MSG_FLAG_COMPRESSED)) {
+        return 0;
+    }
+
+    return frameLen;
+}
+
+/* 解析到带保护字节的缓冲区，canaryOk表示原始长度之后的保护字节没有被改写 */
+static int CompressParse(char *frame, unsigned int frameLen, int *canaryOk)
+{
+    static unsigned char recvBuf[COMPRESS_TEXT_LEN + COMPRESS_CANARY_LEN];
+    IPCS_Message recvMsg;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    (void)memset(recvBuf, COMPRESS_CANARY, sizeof(recvBuf));
+    recvMsg.msgLen = COMPRESS_TEXT_LEN;
+    recvMsg.msgValue = recvBuf;
+    result = IPCS_StreamToMsgEx(frame, frameLen, &recvMsg, NULL, NULL);
+
+    *canaryOk = 1;
+    for (i = COMPRESS_TEXT_LEN; i < sizeof(recvBuf); i++) {
+        *canaryOk &= (recvBuf[i] == COMPRESS_CANARY);
+    }
+    if ((result == IPCS_OK) &&
+        ((recvMsg.msgLen != COMPRESS_TEXT_LEN) || (memcmp(recvBuf, g_Text, COMPRESS_TEXT_LEN) != 0))) {
+        result = IPCS_FRAME_BAD;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+static int CompressTestParse(void)
+{
+    char frame[IPCS_FRAME_MAX_LEN];
+    char bad[IPCS_FRAME_MAX_LEN];
+    IPCS_Message *header = (IPCS_Message *)bad;
+    unsigned int frameLen = 0;
+    unsigned int payloadLen = 0;
+    uint32_t rawLen = 0;
+    int canaryOk = 0;
+    int result = IPCS_OK;
+
+    frameLen = CompressBuildFrame(frame, sizeof(frame));
+    TEST_CHECK(frameLen != 0, "text payload was not compressed");
+    TEST_CHECK(frameLen < IPCS_MSG_HEADER_LEN + COMPRESS_TEXT_LEN / 2, "compressed frame is %u bytes", frameLen);
+    result = CompressParse(frame, frameLen, &canaryOk);
+    TEST_CHECK((result == IPCS_OK) && canaryOk, "intact frame: %d", result);
+    payloadLen = frameLen - IPCS_MSG_HEADER_LEN;
+
+    /* 负载放不下原始长度字段 */
+    (void)memcpy(bad, frame, frameLen);
+    header->msgLen = 2 | IPCS_MSG_FLAG_COMPRESSED;
+    result = CompressParse(bad, IPCS_MSG_HEADER_LEN + 2, &canaryOk);
+    TEST_CHECK(result == IPCS_STREAM_BUF_BAD, "payload shorter than raw length: %d", result);
+
+    /* 原始长度超过最大消息长度 */
+    (void)memcpy(bad, frame, frameLen);
+    rawLen = IPCS_MESSAGE_MAX_LEN + 1;
+    (void)memcpy(bad + IPCS_MSG_HEADER_LEN, &rawLen, sizeof(rawLen));
+    result = CompressParse(bad, frameLen, &canaryOk);
+    TEST_CHECK((result == IPCS_STREAM_BUF_BAD) && canaryOk, "raw length over limit: %d", result);
+
+    /* 原始长度与解压结果不符 */
+    (void)memcpy(bad, frame, frameLen);
+    rawLen = COMPRESS_TEXT_LEN - 1;
+    (void)memcpy(bad + IPCS_MSG_HEADER_LEN, &rawLen, sizeof(rawLen));
+    result = CompressParse(bad, frameLen, &canaryOk);
+    TEST_CHECK((result == IPCS_STREAM_BUF_BAD) && canaryOk, "raw length too small: %d", result);
+    rawLen = COMPRESS_TEXT_LEN + 1;
+    (void)memcpy(bad + IPCS_MSG_HEADER_LEN, &rawLen, sizeof(rawLen));
+    result = CompressParse(bad, frameLen, &canaryOk);
+    TEST_CHECK(((result == IPCS_STREAM_BUF_BAD) || (result == IPCS_BUF_TOO_SMALL)) && canaryOk,
+            "raw length too large: %d", result);
+
+    /* 压缩数据被截断 */
+    (void)memcpy(bad, frame, frameLen);
+    header->msgLen = (payloadLen - 8) | IPCS_MSG_FLAG_COMPRESSED;
+    result = CompressParse(bad, frameLen - 8, &canaryOk);
+    TEST_CHECK((result == IPCS_STREAM_BUF_BAD) && canaryOk, "truncated data: %d", result);
+
+    /* 第一个序列没有字面量，匹配距离指向输出之前 */
+    header->msgType = COMPRESS_MSG_TYPE;
+    header->msgLen = (sizeof(rawLen) + 3) | IPCS_MSG_FLAG_COMPRESSED;
+    rawLen = 8;
+    (void)memcpy(bad + IPCS_MSG_HEADER_LEN, &rawLen, sizeof(rawLen));
+    (void)memcpy(bad + IPCS_MSG_HEADER_LEN + sizeof(rawLen), "\x00\x01\x00", 3);
+    result = CompressParse(bad, IPCS_MSG_HEADER_LEN + sizeof(rawLen) + 3, &canaryOk);
+    TEST_CHECK((result == IPCS_STREAM_BUF_BAD) && canaryOk, "match before output start: %d", result);
+
+    return IPCS_OK;
+}
+
+/* 随机破坏压缩数据：解析成功或者失败，都不能写出原始长度之外 */
+static int CompressTestFuzz(void)
+{
+    char frame[IPCS_FRAME_MAX_LEN];
+    char bad[IPCS_FRAME_MAX_LEN];
+    unsigned int seed = 1;
+    unsigned int frameLen = 0;
+    unsigned int payloadLen = 0;
+    unsigned int flips = 0;
+    unsigned int pos = 0;
+    unsigned int round = 0;
+    unsigned int i = 0;
+    int canaryOk = 0;
+    int result = IPCS_OK;
+
+    frameLen = CompressBuildFrame(frame, sizeof(frame));
+    TEST_CHECK(frameLen != 0, "text payload was not compressed");
+    payloadLen = frameLen - IPCS_MSG_HEADER_LEN;
+
+    for (round = 0; round < COMPRESS_FUZZ_ROUNDS; round++) {
+        (void)memcpy(bad, frame, frameLen);
+        flips = 1 + (unsigned int)rand_r(&seed) % 4;
+        for (i = 0; i < flips; i++) {
+            /* 原始长度字段保持不变，只破坏压缩数据 */
+            pos = IPCS_MSG_HEADER_LEN + sizeof(uint32_t) +
+                (unsigned int)rand_r(&seed) % (payloadLen - sizeof(uint32_t));
+            bad[pos] = (char)rand_r(&seed);
+        }
+        result = CompressParse(bad, frameLen, &canaryOk);
+        TEST_CHECK(canaryOk, "round %u wrote past the raw length, result: %d", round, result);
+        TEST_CHECK((result == IPCS_OK) || (result == IPCS_FRAME_BAD) || (result == IPCS_STREAM_BUF_BAD),
+                "round %u: %d", round, result);
+    }
+
+    return IPCS_OK;
+}
+
+/* 服务端只关闭发来无法解压或带没有协商的选项的帧的连接，不调用回调函数 */
+static int CompressTestServer(void)
+{
+    unsigned int garbage[4] = {COMPRESS_MSG_TYPE, 8 | IPCS_MSG_FLAG_COMPRESSED, 1000, 0xFFFFFFFF};
+    char frame[IPCS_FRAME_MAX_LEN];
+    char small[COMPRESS_SMALL_LEN];
+    unsigned int frameLen = 0;
+    unsigned long long callsBefore = 0;
+    unsigned long long callsAfter = 0;
+    int badFd = -1;
+    int plainBadFd = -1;
+    int goodFd = -1;
+    int plainFd = -1;
+    int badResult = IPCS_OK;
+    int plainBadResult = IPCS_OK;
+    int goodResult = IPCS_OK;
+    int plainResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    frameLen = CompressBuildFrame(frame, sizeof(frame));
+    TEST_CHECK(frameLen != 0, "text payload was not compressed");
+    (void)memset(small, 's', sizeof(small));
+
+    result = CompressCreateClient(COMPRESS_SERVER_NAME, 1, &badFd);
+    if (result == IPCS_OK) {
+        result = CompressCreateClient(COMPRESS_SERVER_NAME, 0, &plainBadFd);
+    }
+    if (result == IPCS_OK) {
+        result = CompressCreateClient(COMPRESS_SERVER_NAME, 1, &goodFd);
+    }
+    if (result == IPCS_OK) {
+        result = CompressCreateClient(COMPRESS_SERVER_NAME, 0, &plainFd);
+    }
+    if (result == IPCS_OK) {
+        callsBefore = __atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED);
+        /* 协商了压缩的连接发来无法解压的帧；没有协商的连接发来正确压缩的帧 */
+        if ((write(badFd, garbage, sizeof(garbage)) != (ssize_t)sizeof(garbage)) ||
+            (write(plainBadFd, frame, frameLen) != (ssize_t)frameLen)) {
+            result = IPCS_WRITE_FAIL;
+        }
+        badResult = CompressCall(badFd, small, sizeof(small));
+        plainBadResult = CompressCall(plainBadFd, small, sizeof(small));
+        callsAfter = __atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED);
+        goodResult = CompressCall(goodFd, g_Text, sizeof(g_Text));
+        plainResult = CompressCall(plainFd, g_Text, sizeof(g_Text));
+    }
+    (void)IPCS_DestroyClient(badFd);
+    (void)IPCS_DestroyClient(plainBadFd);
+    (void)IPCS_DestroyClient(goodFd);
+    (void)IPCS_DestroyClient(plainFd);
+
+    TEST_CHECK(result == IPCS_OK, "setup: %d", result);
+    TEST_CHECK(badResult != IPCS_OK, "call after an undecodable frame succeeded");
+    TEST_CHECK(plainBadResult != IPCS_OK, "call after a frame with options not negotiated succeeded");
+    TEST_CHECK(callsAfter == callsBefore, "server hook called %llu times for bad frames", callsAfter - callsBefore);
+    TEST_CHECK(goodResult == IPCS_OK, "other compress connection: %d", goodResult);
+    TEST_CHECK(plainResult == IPCS_OK, "other plain connection: %d", plainResult);
+
+    return IPCS_OK;
+}
+
+/* 同意压缩后，第i个连接的响应为COMPRESS_RawReply中的第i种坏帧 */
+static void *CompressRawServerRun(void *arg)
+{
+    unsigned int ctrl[3];
+    unsigned int reply[3] = {IPCS_CTRL_OPTIONS, sizeof(unsigned int) | IPCS_MSG_FLAG_CONTROL,
+                             IPCS_MSG_FLAG_COMPRESSED};
+    unsigned int garbage[5] = {COMPRESS_MSG_TYPE, 8 | IPCS_MSG_FLAG_CALL_ID | IPCS_MSG_FLAG_COMPRESSED, 0, 1000,
+                               0xFFFFFFFF};
+    char buf[IPCS_FRAME_MAX_LEN];
+    char resp[IPCS_FRAME_MAX_LEN];
+    char value[COMPRESS_SMALL_LEN];
+    IPCS_Message msg;
+    unsigned int callId = 0;
+    unsigned int respLen = 0;
+    unsigned int i = 0;
+    ssize_t n = 0;
+    int fd = -1;
+
+    for (i = 0; i < COMPRESS_RAW_BUTT; i++) {
+        fd = accept(g_RawListenFd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+
+        msg.msgLen = sizeof(value);
+        msg.msgValue = value;
+        respLen = sizeof(resp);
+        if ((recv(fd, ctrl, sizeof(ctrl), MSG_WAITALL) == (ssize_t)sizeof(ctrl)) && (ctrl[0] == IPCS_CTRL_OPTIONS) &&
+            (send(fd, reply, sizeof(reply), MSG_NOSIGNAL) == (ssize_t)sizeof(reply)) &&
+            ((n = recv(fd, buf, sizeof(buf), 0)) > 0) &&
+            (IPCS_StreamToMsgEx(buf, (unsigned int)n, &msg, &callId, NULL) == IPCS_OK)) {
+            if (i == COMPRESS_RAW_GARBAGE) {
+                garbage[2] = callId;
+                (void)send(fd, garbage, sizeof(garbage), MSG_NOSIGNAL);
+            } else if (IPCS_MsgToStreamFlags(&msg, callId, IPCS_PRIO_NORMAL, 0, IPCS_MSG_FLAG_CHECKSUM, resp,
+                    &respLen) == IPCS_OK) {
+                (void)send(fd, resp, respLen, MSG_NOSIGNAL);
+            }
+        }
+
+        /* 等客户端关闭连接 */
+        (void)recv(fd, buf, sizeof(buf), 0);
+        (void)close(fd);
+    }
+
+    return NULL;
+}
+
+/* 同步客户端收到无法解压或带没有协商的选项的响应时返回IPCS_FRAME_BAD */
+static int CompressTestClient(void)
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen = offsetof(struct sockaddr_un, sun_path) + strlen(COMPRESS_RAW_NAME);
+    char small[COMPRESS_SMALL_LEN];
+    int callResults[COMPRESS_RAW_BUTT];
+    pthread_t tid;
+    unsigned int i = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)memcpy(addr.sun_path + 1, COMPRESS_RAW_NAME + 1, strlen(COMPRESS_RAW_NAME) - 1);
+    g_RawListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_CHECK(g_RawListenFd >= 0, "raw socket fail");
+    if ((bind(g_RawListenFd, (struct sockaddr *)&addr, addrLen) < 0) || (listen(g_RawListenFd, 4) < 0) ||
+        (pthread_create(&tid, NULL, CompressRawServerRun, NULL) != 0)) {
+        (void)close(g_RawListenFd);
+        TEST_CHECK(0, "raw server setup fail");
+    }
+
+    (void)memset(small, 's', sizeof(small));
+    for (i = 0; i < COMPRESS_RAW_BUTT; i++) {
+        callResults[i] = IPCS_OK;
+        result = CompressCreateClient(COMPRESS_RAW_NAME, 1, &fd);
+        if (result != IPCS_OK) {
+            break;
+        }
+        callResults[i] = CompressCall(fd, small, sizeof(small));
+        (void)IPCS_DestroyClient(fd);
+    }
+    if (result != IPCS_OK) {
+        (void)shutdown(g_RawListenFd, SHUT_RDWR);
+    }
+    (void)pthread_join(tid, NULL);
+    (void)close(g_RawListenFd);
+
+    TEST_CHECK(result == IPCS_OK, "create client to raw server: %d", result);
+    TEST_CHECK(callResults[COMPRESS_RAW_GARBAGE] == IPCS_FRAME_BAD, "undecodable response returned %d, expect %d",
+            callResults[COMPRESS_RAW_GARBAGE], IPCS_FRAME_BAD);
+    TEST_CHECK(callResults[COMPRESS_RAW_CHECKSUM] == IPCS_FRAME_BAD,
+            "response with options not negotiated returned %d, expect %d", callResults[COMPRESS_RAW_CHECKSUM],
+            IPCS_FRAME_BAD);
+
+    return IPCS_OK;
+}
+
+static const COMPRESS_Case g_Cases[] = {
+    {"parse", CompressTestParse},
+    {"fuzz", CompressTestFuzz},
+    {"server", CompressTestServer},
+    {"client", CompressTestClient},
+};
+
+/******************************************************************************/
+int main(void)
+{
+    IPCS_ServerAttr serverAttr;
+    unsigned int failed = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_EnableLog(0);
+    CompressFillText(g_Text, sizeof(g_Text));
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.readyTimeoutMs = COMPRESS_WAIT_MS;
+    serverAttr.compress = 1;
+    result = IPCS_CreateServerEx(COMPRESS_SERVER_NAME, CompressServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        BENCH_PRINT("compress test setup fail: %d", result);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++) {
+        result = g_Cases[i].run();
+        BENCH_PRINT("%-20s %s", g_Cases[i].name, (result == IPCS_OK) ? "PASS" : "FAIL");
+        failed += (result != IPCS_OK);
+    }
+    BENCH_PRINT("compress: %u passed, %u failed", i - failed, failed);
+
+    (void)IPCS_DestroyServer(COMPRESS_SERVER_NAME);
+    (void)fflush(NULL);
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,354 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  crc_bench_main.c
+ *
+ *    Description:  frame checksum benchmark
+ *
+ *                  先检查CRC32C的两种实现（查表和crc32指令）与标准测试向量一致、分段计算与
+ *                  一次计算一致，输出两种实现的吞吐；再用同步客户端对回显服务端发出-s字节的
+ *                  调用，分off（不协商校验和）和on（协商校验和）两种配置运行，输出调用速率和
+ *                  on相对off的开销；最后检查被破坏的帧：解析返回IPCS_CHECKSUM_FAIL，服务端
+ *                  关闭发来坏帧的连接且不调用回调函数。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:55:17 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+#include "ipcs_common.h"
+#include "ipcs_crc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define CRC_MSG_TYPE            0x4352   /* "CR" */
+#define CRC_CHECK_VALUE         0xE3069283U     /* CRC32C("123456789") */
+#define CRC_RANDOM_ROUNDS       1000
+#define CRC_SPEED_BUF_LEN       IPCS_MESSAGE_MAX_LEN
+#define CRC_SPEED_MIN_NS        (200 * BENCH_NS_PER_MS)
+#define CRC_MAX_MSG_LEN         (IPCS_MESSAGE_MAX_LEN - IPCS_MSG_HEADER_LEN)    /* 最大的消息负载 */
+
+typedef struct {
+    const char *name;
+    int checksum;
+} CRC_Config;
+
+static const CRC_Config g_Configs[] = {
+    {"off", 0},
+    {"on", 1},
+};
+
+static double g_DurationSec = 2.0;
+static unsigned int g_MsgLen = CRC_MAX_MSG_LEN;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static unsigned long long g_ServerCalls = 0;
+
+/******************************************************************************/
+int CrcServerHook(int fd, IPCS_Message *msg)
+{
+    __atomic_add_fetch(&g_ServerCalls, 1, __ATOMIC_RELAXED);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/******************************************************************************/
+/* 测试向量、随机长度和起始地址下两种实现一致、分两段计算与一次计算一致 */
+static int CrcCheckImpl(void)
+{
+    unsigned char *buf = NULL;
+    unsigned int round = 0;
+    unsigned int off = 0;
+    unsigned int len = 0;
+    unsigned int cut = 0;
+    uint32_t whole = 0;
+    int hw = IPCS_Crc32cHwSupported();
+    int result = IPCS_OK;
+
+    if ((IPCS_Crc32cSw(0, "123456789", 9) != CRC_CHECK_VALUE) || (IPCS_Crc32c(0, "123456789", 9) != CRC_CHECK_VALUE) ||
+        (hw && (IPCS_Crc32cHw(0, "123456789", 9) != CRC_CHECK_VALUE))) {
+        TEST_PRINT("crc check value mismatch: sw %#x, hw %#x", IPCS_Crc32cSw(0, "123456789", 9),
+                hw ? IPCS_Crc32cHw(0, "123456789", 9) : 0);
+        return IPCS_CHECKSUM_FAIL;
+    }
+
+    buf = (unsigned char *)malloc(CRC_SPEED_BUF_LEN + 8);
+    if (buf == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    for (off = 0; off < CRC_SPEED_BUF_LEN + 8; off++) {
+        buf[off] = (unsigned char)rand();
+    }
+
+    for (round = 0; (round < CRC_RANDOM_ROUNDS) && (result == IPCS_OK); round++) {
+        off = (unsigned int)rand() % 8;
+        len = (unsigned int)rand() % CRC_SPEED_BUF_LEN;
+        cut = (len != 0) ? (unsigned int)rand() % len : 0;
+
+        whole = IPCS_Crc32cSw(0, buf + off, len);
+        if ((hw && (IPCS_Crc32cHw(0, buf + off, len) != whole)) ||
+            (IPCS_Crc32c(IPCS_Crc32c(0, buf + off, cut), buf + off + cut, len - cut) != whole)) {
+            TEST_PRINT("crc mismatch: off %u, len %u, cut %u", off, len, cut);
+            result = IPCS_CHECKSUM_FAIL;
+        }
+    }
+
+    free(buf);
+
+    return result;
+}
+
+static double CrcSpeed(uint32_t (*func)(uint32_t, const void *, size_t), const void *buf)
+{
+    volatile uint32_t sink = 0;
+    uint64_t iters = 0;
+    uint64_t startNs = BENCH_NowNs();
+    uint64_t elapsedNs = 0;
+
+    do {
+        sink ^= func(0, buf, CRC_SPEED_BUF_LEN);
+        iters++;
+        elapsedNs = BENCH_NowNs() - startNs;
+    } while (elapsedNs < CRC_SPEED_MIN_NS);
+    (void)sink;
+
+    return (double)iters * CRC_SPEED_BUF_LEN / (double)elapsedNs;
+}
+
+static int CrcRunImpl(void)
+{
+    void *buf = NULL;
+    int result = IPCS_OK;
+
+    result = CrcCheckImpl();
+    BENCH_PRINT("impl     check=%s hw_supported=%d", (result == IPCS_OK) ? "ok" : "FAIL", IPCS_Crc32cHwSupported());
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    buf = calloc(1, CRC_SPEED_BUF_LEN);
+    if (buf == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    BENCH_PRINT("  sw %.2f GB/s", CrcSpeed(IPCS_Crc32cSw, buf));
+    if (IPCS_Crc32cHwSupported()) {
+        BENCH_PRINT("  hw %.2f GB/s", CrcSpeed(IPCS_Crc32cHw, buf));
+    }
+    free(buf);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+static int CrcCreateClient(const char *serverName, int checksum, int *fd)
+{
+    IPCS_ClientAttr clientAttr;
+
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.checksum = checksum;
+
+    return IPCS_CreateSyncClientEx(NULL, serverName, &clientAttr, fd);
+}
+
+static int CrcRunCalls(const CRC_Config *config, double *callsPerSec)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    char serverName[64];
+    char *sendBuf = NULL;
+    char *recvBuf = NULL;
+    unsigned long long calls = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    (void)snprintf(serverName, sizeof(serverName), "@ipcs_crc_bench_%s", config->name);
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.readyTimeoutMs = 1000;
+    serverAttr.checksum = 1;
+    result = IPCS_CreateServerEx(serverName, CrcServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("crc create server fail: %d", result);
+        return result;
+    }
+
+    sendBuf = (char *)malloc(g_MsgLen);
+    recvBuf = (char *)malloc(CRC_MAX_MSG_LEN);
+    result = ((sendBuf == NULL) || (recvBuf == NULL)) ? IPCS_MALLOC_FAIL : IPCS_OK;
+    if (result == IPCS_OK) {
+        (void)memset(sendBuf, 0x5A, g_MsgLen);
+        result = CrcCreateClient(serverName, config->checksum, &fd);
+    }
+
+    sendMsg.msgType = CRC_MSG_TYPE;
+    sendMsg.msgLen = g_MsgLen;
+    sendMsg.msgValue = sendBuf;
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    while ((result == IPCS_OK) && (BENCH_NowNs() < endNs)) {
+        recvMsg.msgLen = CRC_MAX_MSG_LEN;
+        recvMsg.msgValue = recvBuf;
+        result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+        if ((result == IPCS_OK) && ((recvMsg.msgLen != g_MsgLen) || (memcmp(recvBuf, sendBuf, g_MsgLen) != 0))) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+        if (result == IPCS_OK) {
+            calls++;
+        }
+    }
+    endNs = BENCH_NowNs();
+
+    if (fd >= 0) {
+        (void)IPCS_DestroyClient(fd);
+    }
+    (void)IPCS_DestroyServer(serverName);
+    free(sendBuf);
+    free(recvBuf);
+
+    *callsPerSec = (double)calls * BENCH_NS_PER_SEC / (double)(endNs - startNs);
+    BENCH_PRINT("%-8s size=%u engine=%s result=%d", config->name, g_MsgLen,
+            (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll", result);
+    BENCH_PRINT("  %.0f calls/s  %.1f MB/s", *callsPerSec, *callsPerSec * g_MsgLen * 2 / (1024.0 * 1024.0));
+
+    return result;
+}
+
+/******************************************************************************/
+/* 被破坏的帧：解析时发现；协商了校验和的连接上服务端关闭连接，不调用回调函数 */
+static int CrcRunCorrupt(void)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_Message msg;
+    IPCS_Message recvMsg;
+    char frame[IPCS_MSG_HEADER_LEN + IPCS_FRAME_EXT_MAX_LEN + 64];
+    char value[64];
+    char recvBuf[64];
+    unsigned int frameLen = sizeof(frame);
+    unsigned long long serverCalls = 0;
+    int parseResult = IPCS_OK;
+    int sendResult = IPCS_OK;
+    int callResult = IPCS_OK;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    (void)memset(value, 0x33, sizeof(value));
+    msg.msgType = CRC_MSG_TYPE;
+    msg.msgLen = sizeof(value);
+    msg.msgValue = value;
+    result = IPCS_MsgToStreamEx(&msg, 1, frame, &frameLen);
+    if (result != IPCS_OK) {
+        return result;
+    }
+    IPCS_FrameAddChecksum(frame, &frameLen);
+    frame[frameLen - IPCS_CHECKSUM_LEN - 1] ^= 0x01;
+
+    recvMsg.msgLen = sizeof(recvBuf);
+    recvMsg.msgValue = recvBuf;
+    parseResult = IPCS_StreamToMsgEx(frame, frameLen, &recvMsg, NULL, NULL);
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.readyTimeoutMs = 1000;
+    serverAttr.checksum = 1;
+    result = IPCS_CreateServerEx("@ipcs_crc_bench_corrupt", CrcServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    result = CrcCreateClient("@ipcs_crc_bench_corrupt", 1, &fd);
+    if (result == IPCS_OK) {
+        serverCalls = __atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED);
+        sendResult = (write(fd, frame, frameLen) == (ssize_t)frameLen) ? IPCS_OK : IPCS_WRITE_FAIL;
+
+        /* 连接已被服务端关闭，调用失败 */
+        msg.msgLen = sizeof(value);
+        recvMsg.msgLen = sizeof(recvBuf);
+        callResult = IPCS_ClientSyncCallTimeout(fd, &msg, &recvMsg, 1000);
+        (void)IPCS_DestroyClient(fd);
+    }
+    (void)IPCS_DestroyServer("@ipcs_crc_bench_corrupt");
+
+    BENCH_PRINT("corrupt  parse=%d send=%d call=%d server_calls=%llu", parseResult, sendResult, callResult,
+            __atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED) - serverCalls);
+
+    if ((result == IPCS_OK) && ((parseResult != IPCS_CHECKSUM_FAIL) || (sendResult != IPCS_OK) ||
+        (callResult == IPCS_OK) || (__atomic_load_n(&g_ServerCalls, __ATOMIC_RELAXED) != serverCalls))) {
+        result = IPCS_CHECKSUM_FAIL;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    double callsPerSec[sizeof(g_Configs) / sizeof(g_Configs[0])];
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:s:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 's':
+                g_MsgLen = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-s msgLen] [-e epoll|uring] [-m off|on]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_MsgLen == 0) || (g_MsgLen > CRC_MAX_MSG_LEN)) {
+        (void)printf("msgLen 1..%u\n", (unsigned int)CRC_MAX_MSG_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    result = CrcRunImpl();
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        callsPerSec[i] = 0;
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = CrcRunCalls(&g_Configs[i], &callsPerSec[i]);
+    }
+    if ((result == IPCS_OK) && (callsPerSec[0] != 0) && (callsPerSec[1] != 0)) {
+        BENCH_PRINT("checksum overhead: %.1f%%", (1.0 - callsPerSec[1] / callsPerSec[0]) * 100.0);
+    }
+
+    if (result == IPCS_OK) {
+        result = CrcRunCorrupt();
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
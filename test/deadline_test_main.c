@@ -0,0 +1,334 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  deadline_test_main.c
+ *
+ *    Description:  per-call deadline tests
+ *
+ *                  服务端回调函数处理slow类型的请求时睡眠DEADLINE_SLOW_MS毫秒再回显。检查：同步调用
+ *                  超时按时返回IPCS_TIMEOUT，之后同一连接上的调用收到自己的响应而不是迟到的响应；
+ *                  对端只发出帧头和部分负载时同步调用按时返回，连接被关闭；异步调用超时调用超时回调，
+ *                  迟到的响应不交给clientHook；timeoutMs为0的异步调用不记录，callId为0。
+ *                  全部通过时返回0。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:41:27 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define DEADLINE_SERVER_NAME    "@ipcs_deadline_test"
+#define DEADLINE_RAW_NAME       "@ipcs_deadline_raw"
+#define DEADLINE_MSG_FAST       0x4446   /* "DF" */
+#define DEADLINE_MSG_SLOW       0x4453   /* "DS" */
+#define DEADLINE_SLOW_MS        300
+#define DEADLINE_TIMEOUT_MS     100
+#define DEADLINE_SLACK_MS       150      /* 按时返回允许的调度误差 */
+#define DEADLINE_WAIT_MS        2000
+
+typedef struct {
+    const char *name;
+    int (*run)(void);
+} DEADLINE_Case;
+
+static int g_AsynFd = -1;
+static unsigned int g_FastResponses = 0;
+static unsigned int g_SlowResponses = 0;
+static unsigned int g_Timeouts = 0;
+static unsigned int g_TimeoutCallId = 0;
+static int g_RawListenFd = -1;
+
+/******************************************************************************/
+int DeadlineServerHook(int fd, IPCS_Message *msg)
+{
+    if (msg->msgType == DEADLINE_MSG_SLOW) {
+        (void)usleep(DEADLINE_SLOW_MS * 1000);
+    }
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+int DeadlineClientHook(IPCS_Message *msg)
+{
+    if (msg->msgType == DEADLINE_MSG_SLOW) {
+        (void)__atomic_add_fetch(&g_SlowResponses, 1, __ATOMIC_RELAXED);
+    } else {
+        (void)__atomic_add_fetch(&g_FastResponses, 1, __ATOMIC_RELAXED);
+    }
+
+    return IPCS_OK;
+}
+
+int DeadlineTimeoutHook(unsigned int callId)
+{
+    __atomic_store_n(&g_TimeoutCallId, callId, __ATOMIC_RELAXED);
+    (void)__atomic_add_fetch(&g_Timeouts, 1, __ATOMIC_RELEASE);
+
+    return IPCS_OK;
+}
+
+static unsigned int DeadlineElapsedMs(uint64_t startNs)
+{
+    return (unsigned int)((BENCH_NowNs() - startNs) / BENCH_NS_PER_MS);
+}
+
+/* 等待计数达到value，最多DEADLINE_WAIT_MS毫秒 */
+static int DeadlineWaitCount(unsigned int *count, unsigned int value)
+{
+    uint64_t deadlineNs = BENCH_NowNs() + DEADLINE_WAIT_MS * BENCH_NS_PER_MS;
+
+    while (__atomic_load_n(count, __ATOMIC_ACQUIRE) < value) {
+        if (BENCH_NowNs() >= deadlineNs) {
+            return IPCS_TIMEOUT;
+        }
+        (void)usleep(1000);
+    }
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+/* 同步调用超时后，同一连接上的下一次调用要收到自己的响应，迟到的慢响应被丢弃 */
+static int DeadlineTestSync(void)
+{
+    char sendBuf[16] = "deadline";
+    char recvBuf[64];
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    uint64_t startNs = 0;
+    unsigned int elapsedMs = 0;
+    int fd = -1;
+    int slowResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    result = IPCS_CreateSyncClient(NULL, DEADLINE_SERVER_NAME, &fd);
+    TEST_CHECK(result == IPCS_OK, "create sync client: %d", result);
+
+    sendMsg.msgType = DEADLINE_MSG_SLOW;
+    sendMsg.msgLen = sizeof(sendBuf);
+    sendMsg.msgValue = sendBuf;
+    recvMsg.msgLen = sizeof(recvBuf);
+    recvMsg.msgValue = recvBuf;
+    startNs = BENCH_NowNs();
+    slowResult = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, DEADLINE_TIMEOUT_MS);
+    elapsedMs = DeadlineElapsedMs(startNs);
+
+    /* 服务端处理完慢请求后才处理这个请求，慢响应先到达 */
+    sendMsg.msgType = DEADLINE_MSG_FAST;
+    recvMsg.msgType = 0;
+    recvMsg.msgLen = sizeof(recvBuf);
+    result = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, DEADLINE_WAIT_MS);
+    (void)IPCS_DestroyClient(fd);
+
+    TEST_CHECK(slowResult == IPCS_TIMEOUT, "slow call returned %d, expect %d", slowResult, IPCS_TIMEOUT);
+    TEST_CHECK((elapsedMs >= DEADLINE_TIMEOUT_MS) && (elapsedMs <= DEADLINE_TIMEOUT_MS + DEADLINE_SLACK_MS),
+            "slow call returned after %u ms", elapsedMs);
+    TEST_CHECK(result == IPCS_OK, "fast call after timeout returned %d", result);
+    TEST_CHECK(recvMsg.msgType == DEADLINE_MSG_FAST, "fast call got response of type %#x", recvMsg.msgType);
+
+    return IPCS_OK;
+}
+
+/* 只发出帧头和部分负载、之后不再发送的对端 */
+static void *DeadlineRawServerRun(void *arg)
+{
+    unsigned int header[2] = {DEADLINE_MSG_FAST, 100};
+    char buf[256];
+    int fd = -1;
+
+    fd = accept(g_RawListenFd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    (void)recv(fd, buf, sizeof(buf), 0);
+    (void)send(fd, header, sizeof(header), MSG_NOSIGNAL);
+    (void)send(fd, buf, 10, MSG_NOSIGNAL);
+
+    /* 等客户端超时后关闭连接 */
+    (void)recv(fd, buf, sizeof(buf), 0);
+    (void)close(fd);
+
+    return NULL;
+}
+
+/* 负载只到达一部分时也按时返回，之后连接不可再用 */
+static int DeadlineTestPartialBody(void)
+{
+    struct sockaddr_un addr;
+    socklen_t addrLen = offsetof(struct sockaddr_un, sun_path) + strlen(DEADLINE_RAW_NAME);
+    char sendBuf[16] = "partial";
+    char recvBuf[256];
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    pthread_t tid;
+    uint64_t startNs = 0;
+    unsigned int elapsedMs = 0;
+    int fd = -1;
+    int secondResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)memcpy(addr.sun_path + 1, DEADLINE_RAW_NAME + 1, strlen(DEADLINE_RAW_NAME) - 1);
+    g_RawListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_CHECK(g_RawListenFd >= 0, "raw socket fail");
+    if ((bind(g_RawListenFd, (struct sockaddr *)&addr, addrLen) < 0) || (listen(g_RawListenFd, 4) < 0) ||
+        (pthread_create(&tid, NULL, DeadlineRawServerRun, NULL) != 0)) {
+        (void)close(g_RawListenFd);
+        TEST_CHECK(0, "raw server setup fail");
+    }
+
+    result = IPCS_CreateSyncClient(NULL, DEADLINE_RAW_NAME, &fd);
+    if (result == IPCS_OK) {
+        sendMsg.msgType = DEADLINE_MSG_FAST;
+        sendMsg.msgLen = sizeof(sendBuf);
+        sendMsg.msgValue = sendBuf;
+        recvMsg.msgLen = sizeof(recvBuf);
+        recvMsg.msgValue = recvBuf;
+        startNs = BENCH_NowNs();
+        result = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, 2 * DEADLINE_TIMEOUT_MS);
+        elapsedMs = DeadlineElapsedMs(startNs);
+
+        recvMsg.msgLen = sizeof(recvBuf);
+        secondResult = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, 2 * DEADLINE_TIMEOUT_MS);
+        (void)IPCS_DestroyClient(fd);
+    } else {
+        (void)shutdown(g_RawListenFd, SHUT_RDWR);
+    }
+    (void)pthread_join(tid, NULL);
+    (void)close(g_RawListenFd);
+
+    TEST_CHECK(fd >= 0, "create client to raw server fail");
+    TEST_CHECK(result == IPCS_TIMEOUT, "partial body call returned %d, expect %d", result, IPCS_TIMEOUT);
+    TEST_CHECK((elapsedMs >= 2 * DEADLINE_TIMEOUT_MS) && (elapsedMs <= 2 * DEADLINE_TIMEOUT_MS + DEADLINE_SLACK_MS),
+            "partial body call returned after %u ms", elapsedMs);
+    TEST_CHECK(secondResult != IPCS_OK, "call on a connection with a half-read frame succeeded");
+
+    return IPCS_OK;
+}
+
+/* 异步调用超时后调用超时回调，迟到的响应不再交给clientHook；没有超时的调用正常收到响应 */
+static int DeadlineTestAsyn(void)
+{
+    char sendBuf[16] = "asyn";
+    IPCS_Message sendMsg;
+    unsigned int callId = 0;
+    unsigned int fastBefore = __atomic_load_n(&g_FastResponses, __ATOMIC_ACQUIRE);
+    unsigned int timeoutsBefore = __atomic_load_n(&g_Timeouts, __ATOMIC_ACQUIRE);
+    uint64_t startNs = 0;
+    unsigned int elapsedMs = 0;
+    int result = IPCS_OK;
+
+    sendMsg.msgType = DEADLINE_MSG_SLOW;
+    sendMsg.msgLen = sizeof(sendBuf);
+    sendMsg.msgValue = sendBuf;
+    startNs = BENCH_NowNs();
+    result = IPCS_ClientAsynCallTimeout(g_AsynFd, &sendMsg, DEADLINE_TIMEOUT_MS, &callId);
+    TEST_CHECK(result == IPCS_OK, "slow asyn call: %d", result);
+    TEST_CHECK(callId != 0, "slow asyn call got call id 0");
+
+    result = DeadlineWaitCount(&g_Timeouts, timeoutsBefore + 1);
+    elapsedMs = DeadlineElapsedMs(startNs);
+    TEST_CHECK(result == IPCS_OK, "timeout hook not called");
+    TEST_CHECK(g_TimeoutCallId == callId, "timeout hook got call id %u, expect %u", g_TimeoutCallId, callId);
+    TEST_CHECK(elapsedMs <= DEADLINE_TIMEOUT_MS + DEADLINE_SLACK_MS, "timeout hook called after %u ms", elapsedMs);
+
+    /* 服务端处理完慢请求后才处理快的调用，快响应到达时迟到的慢响应已经被丢弃 */
+    sendMsg.msgType = DEADLINE_MSG_FAST;
+    result = IPCS_ClientAsynCallTimeout(g_AsynFd, &sendMsg, DEADLINE_WAIT_MS, &callId);
+    TEST_CHECK(result == IPCS_OK, "fast asyn call: %d", result);
+    result = DeadlineWaitCount(&g_FastResponses, fastBefore + 1);
+    TEST_CHECK(result == IPCS_OK, "fast asyn response not delivered");
+    TEST_CHECK(__atomic_load_n(&g_SlowResponses, __ATOMIC_ACQUIRE) == 0, "late slow response delivered to client hook");
+    TEST_CHECK(__atomic_load_n(&g_Timeouts, __ATOMIC_ACQUIRE) == timeoutsBefore + 1, "fast asyn call timed out");
+
+    return IPCS_OK;
+}
+
+/* timeoutMs为0时与IPCS_ClientAsynCall相同：不记录调用，响应交给clientHook */
+static int DeadlineTestAsynNoDeadline(void)
+{
+    char sendBuf[16] = "nodeadline";
+    IPCS_Message sendMsg;
+    unsigned int callId = 1;
+    unsigned int fastBefore = __atomic_load_n(&g_FastResponses, __ATOMIC_ACQUIRE);
+    int result = IPCS_OK;
+
+    sendMsg.msgType = DEADLINE_MSG_FAST;
+    sendMsg.msgLen = sizeof(sendBuf);
+    sendMsg.msgValue = sendBuf;
+    result = IPCS_ClientAsynCallTimeout(g_AsynFd, &sendMsg, 0, &callId);
+    TEST_CHECK(result == IPCS_OK, "asyn call without deadline: %d", result);
+    TEST_CHECK(callId == 0, "asyn call without deadline got call id %u", callId);
+
+    result = DeadlineWaitCount(&g_FastResponses, fastBefore + 1);
+    TEST_CHECK(result == IPCS_OK, "response of call without deadline not delivered");
+
+    return IPCS_OK;
+}
+
+static const DEADLINE_Case g_Cases[] = {
+    {"sync", DeadlineTestSync},
+    {"partial_body", DeadlineTestPartialBody},
+    {"asyn", DeadlineTestAsyn},
+    {"asyn_no_deadline", DeadlineTestAsynNoDeadline},
+};
+
+/******************************************************************************/
+int main(void)
+{
+    IPCS_ServerAttr serverAttr;
+    unsigned int failed = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_EnableLog(0);
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.readyTimeoutMs = DEADLINE_WAIT_MS;
+    result = IPCS_CreateServerEx(DEADLINE_SERVER_NAME, DeadlineServerHook, &serverAttr);
+    if (result == IPCS_OK) {
+        result = IPCS_CreateAsynClient(NULL, DEADLINE_SERVER_NAME, DeadlineClientHook, &g_AsynFd);
+    }
+    if (result == IPCS_OK) {
+        result = IPCS_SetClientTimeoutHook(g_AsynFd, DeadlineTimeoutHook);
+    }
+    if (result != IPCS_OK) {
+        BENCH_PRINT("deadline test setup fail: %d", result);
+        (void)IPCS_DestroyServer(DEADLINE_SERVER_NAME);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++) {
+        result = g_Cases[i].run();
+        BENCH_PRINT("%-20s %s", g_Cases[i].name, (result == IPCS_OK) ? "PASS" : "FAIL");
+        failed += (result != IPCS_OK);
+    }
+    BENCH_PRINT("deadline: %u passed, %u failed", i - failed, failed);
+
+    (void)IPCS_DestroyClient(g_AsynFd);
+    (void)IPCS_DestroyServer(DEADLINE_SERVER_NAME);
+    (void)fflush(NULL);
+
+    return (failed == 0) ? 0 : 1;
+}
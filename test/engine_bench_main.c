@@ -0,0 +1,234 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  engine_bench_main.c
+ *
+ *    Description:  I/O engine benchmark (epoll vs io_uring)
+ *
+ *                  每种引擎启动一个回显服务端和若干异步客户端，每个客户端保持固定个数的
+ *                  未完成请求（收到一个响应就发出下一个请求），运行指定时间后输出吞吐量，
+ *                  以及服务端每条消息的系统调用次数和事件循环唤醒次数。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 06:20:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define ENGINE_MSG_TYPE         0x454E   /* "EN" */
+#define ENGINE_MAX_CLIENTS      64
+#define ENGINE_SERVER_NAME      "@ipcs_engine_bench"
+
+typedef struct {
+    const char *name;
+    IPCS_Engine engine;
+} EngineMode;
+
+static const EngineMode g_Engines[] = {
+    {"epoll", IPCS_ENGINE_EPOLL},
+    {"uring", IPCS_ENGINE_URING},
+};
+
+static double g_DurationSec = 3.0;
+static unsigned int g_ClientNum = 4;
+static unsigned int g_Window = 16;
+static unsigned int g_PayloadLen = 64;
+static int g_ClientPoll = 0;
+
+static int g_ClientFds[ENGINE_MAX_CLIENTS];
+static volatile int g_Stopping = 0;
+static unsigned long long g_Received = 0;
+static unsigned long long g_SendFail = 0;
+
+/******************************************************************************/
+int EngineEchoHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 负载的前4个字节为客户端序号 */
+static int EngineSend(unsigned int index)
+{
+    char payload[IPCS_MESSAGE_MAX_LEN];
+    IPCS_Message sendMsg;
+
+    (void)memset(payload, 0, g_PayloadLen);
+    (void)memcpy(payload, &index, sizeof(index));
+
+    sendMsg.msgType = ENGINE_MSG_TYPE;
+    sendMsg.msgLen = g_PayloadLen;
+    sendMsg.msgValue = payload;
+
+    return IPCS_ClientAsynCall(g_ClientFds[index], &sendMsg);
+}
+
+int EngineClientHook(IPCS_Message *msg)
+{
+    unsigned int index = 0;
+
+    (void)__atomic_add_fetch(&g_Received, 1, __ATOMIC_RELAXED);
+
+    if (g_Stopping || (msg->msgLen < sizeof(index))) {
+        return IPCS_OK;
+    }
+
+    (void)memcpy(&index, msg->msgValue, sizeof(index));
+    if ((index < g_ClientNum) && (EngineSend(index) != IPCS_OK)) {
+        (void)__atomic_add_fetch(&g_SendFail, 1, __ATOMIC_RELAXED);
+    }
+
+    return IPCS_OK;
+}
+
+static int EngineRun(const EngineMode *mode)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_ClientAttr clientAttr;
+    IPCS_ServerStats startStats;
+    IPCS_ServerStats endStats;
+    unsigned long long messages = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    unsigned int created = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = mode->engine;
+    result = IPCS_CreateServerEx(ENGINE_SERVER_NAME, EngineEchoHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("engine %s create server fail: %d", mode->name, result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.engine = g_ClientPoll ? IPCS_ENGINE_EPOLL : mode->engine;
+
+    g_Stopping = 0;
+    g_Received = 0;
+    g_SendFail = 0;
+    for (created = 0; created < g_ClientNum; created++) {
+        result = IPCS_CreateAsynClientEx(NULL, ENGINE_SERVER_NAME, EngineClientHook, &clientAttr,
+                &g_ClientFds[created]);
+        if (result != IPCS_OK) {
+            TEST_PRINT("engine %s create client %u fail: %d", mode->name, created, result);
+            break;
+        }
+    }
+
+    if (result == IPCS_OK) {
+        (void)IPCS_GetServerStats(ENGINE_SERVER_NAME, &startStats);
+        startNs = BENCH_NowNs();
+
+        for (i = 0; (i < g_ClientNum) && (result == IPCS_OK); i++) {
+            for (j = 0; (j < g_Window) && (result == IPCS_OK); j++) {
+                result = EngineSend(i);
+            }
+        }
+
+        (void)usleep((useconds_t)(g_DurationSec * 1000000.0));
+
+        (void)IPCS_GetServerStats(ENGINE_SERVER_NAME, &endStats);
+        endNs = BENCH_NowNs();
+        g_Stopping = 1;
+
+        /* 等待未完成的请求处理完 */
+        (void)usleep(100 * 1000);
+
+        messages = endStats.messages - startStats.messages;
+        BENCH_PRINT("%-6s clients=%u window=%u payload=%u client_engine=%s", mode->name, g_ClientNum, g_Window,
+                g_PayloadLen, (clientAttr.engine == IPCS_ENGINE_URING) ? "uring" : "poll");
+        BENCH_PRINT("  %12llu msgs %12.0f msgs/s  syscalls/msg=%.3f  wakeups/msg=%.3f  send_fail=%llu",
+                messages, (double)messages * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                (messages == 0) ? 0.0 : (double)(endStats.syscalls - startStats.syscalls) / (double)messages,
+                (messages == 0) ? 0.0 : (double)(endStats.wakeups - startStats.wakeups) / (double)messages,
+                g_SendFail);
+    }
+
+    for (i = 0; i < created; i++) {
+        (void)IPCS_DestroyClient(g_ClientFds[i]);
+    }
+
+    (void)IPCS_DestroyServer(ENGINE_SERVER_NAME);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    const char *onlyEngine = NULL;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:w:s:e:ph")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_ClientNum = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_Window = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_PayloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                onlyEngine = optarg;
+                break;
+            case 'p':
+                g_ClientPoll = 1;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c clients] [-w window] [-s payload] [-e epoll|uring] [-p]\n"
+                             "  -p keeps the asyn clients on poll for both server engines.\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_ClientNum == 0) || (g_ClientNum > ENGINE_MAX_CLIENTS) || (g_Window == 0) ||
+        (g_PayloadLen < sizeof(unsigned int)) || (g_PayloadLen > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("clients must be 1..%d, window > 0, payload %u..%d\n", ENGINE_MAX_CLIENTS,
+                (unsigned int)sizeof(unsigned int), IPCS_MESSAGE_MAX_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; i < sizeof(g_Engines) / sizeof(g_Engines[0]); i++) {
+        if ((onlyEngine != NULL) && (strcmp(onlyEngine, g_Engines[i].name) != 0)) {
+            continue;
+        }
+
+        result = EngineRun(&g_Engines[i]);
+        if (result != IPCS_OK) {
+            break;
+        }
+    }
+
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,293 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  fanout_bench_main.c
+ *
+ *    Description:  scatter-gather call benchmark
+ *
+ *                  进程内创建-n个分片服务端，回调函数等待-w微秒模拟查询（不占用CPU），
+ *                  一个聚合线程对所有分片查询同一个请求。分别在逐个同步调用（seq）、分散-聚合
+ *                  等待所有分片（all）、只等待一半的分片（first）、最后一个分片慢-x倍且超时为
+ *                  -t毫秒（deadline）四种配置下运行，输出聚合调用速率、时延和没有等到的分片数。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:02:14 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define FANOUT_MSG_TYPE         0x464F   /* "FO" */
+
+typedef enum {
+    FANOUT_SEQ = 0,
+    FANOUT_ALL,
+    FANOUT_FIRST,
+    FANOUT_DEADLINE,
+} FANOUT_Mode;
+
+typedef struct {
+    const char *name;
+    FANOUT_Mode mode;
+} FANOUT_Config;
+
+static const FANOUT_Config g_Configs[] = {
+    {"seq", FANOUT_SEQ},
+    {"all", FANOUT_ALL},
+    {"first", FANOUT_FIRST},
+    {"deadline", FANOUT_DEADLINE},
+};
+
+static double g_DurationSec = 2.0;
+static unsigned int g_Shards = 12;
+static unsigned int g_ServiceUs = 200;
+static unsigned int g_SlowFactor = 20;
+static unsigned int g_TimeoutMs = 1;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static char g_ShardNames[IPCS_FANOUT_MAX_CALLS][32];
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+/* 等待模拟分片的查询，原样返回请求 */
+int FanoutShardHook(int fd, IPCS_Message *msg)
+{
+    (void)usleep(g_ServiceUs);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+int FanoutSlowShardHook(int fd, IPCS_Message *msg)
+{
+    (void)usleep(g_ServiceUs * g_SlowFactor);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/******************************************************************************/
+static int FanoutCreateShards(const FANOUT_Config *config, int *fds)
+{
+    IPCS_ServerAttr attr;
+    unsigned int i = 0;
+    int slow = 0;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    for (i = 0; i < g_Shards; i++) {
+        fds[i] = -1;
+        slow = (config->mode == FANOUT_DEADLINE) && (i == g_Shards - 1);
+        result = IPCS_CreateServerEx(g_ShardNames[i], slow ? FanoutSlowShardHook : FanoutShardHook, &attr);
+        if (result != IPCS_OK) {
+            TEST_PRINT("fanout create shard %u fail: %d", i, result);
+            return result;
+        }
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    for (i = 0; i < g_Shards; i++) {
+        result = IPCS_CreateSyncClient(NULL, g_ShardNames[i], &fds[i]);
+        if (result != IPCS_OK) {
+            TEST_PRINT("fanout connect shard %u fail: %d", i, result);
+            return result;
+        }
+    }
+
+    return IPCS_OK;
+}
+
+static void FanoutDestroyShards(int *fds)
+{
+    unsigned int i = 0;
+
+    for (i = 0; i < g_Shards; i++) {
+        if (fds[i] >= 0) {
+            (void)IPCS_DestroyClient(fds[i]);
+        }
+        (void)IPCS_DestroyServer(g_ShardNames[i]);
+    }
+
+    return;
+}
+
+/* 一次聚合查询，*missed为没有等到响应或者因积压没有发出请求的分片数；检查收到的响应与请求一致 */
+static int FanoutQuery(const FANOUT_Config *config, int *fds, unsigned long long seq, unsigned int *missed)
+{
+    IPCS_FanoutCall calls[IPCS_FANOUT_MAX_CALLS];
+    IPCS_Message recvMsgs[IPCS_FANOUT_MAX_CALLS];
+    unsigned long long resps[IPCS_FANOUT_MAX_CALLS][1];
+    IPCS_Message sendMsg;
+    unsigned long long req[1];
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    req[0] = seq;
+    sendMsg.msgType = FANOUT_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = req;
+
+    for (i = 0; i < g_Shards; i++) {
+        recvMsgs[i].msgLen = sizeof(resps[i]);
+        recvMsgs[i].msgValue = resps[i];
+        calls[i].fd = fds[i];
+        calls[i].sendMsg = NULL;
+        calls[i].recvMsg = &recvMsgs[i];
+        calls[i].result = IPCS_TIMEOUT;
+    }
+
+    switch (config->mode) {
+        case FANOUT_SEQ:
+            for (i = 0; (i < g_Shards) && (result == IPCS_OK); i++) {
+                result = IPCS_ClientSyncCall(fds[i], &sendMsg, &recvMsgs[i]);
+                calls[i].result = result;
+            }
+            break;
+        case FANOUT_ALL:
+            result = IPCS_ClientFanoutCall(calls, g_Shards, &sendMsg, 0, IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS);
+            break;
+        case FANOUT_FIRST:
+            result = IPCS_ClientFanoutCall(calls, g_Shards, &sendMsg, (g_Shards + 1) / 2,
+                    IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS);
+            break;
+        default:
+            /* 超时返回部分结果，积压的慢分片不再发出请求 */
+            result = IPCS_ClientFanoutCall(calls, g_Shards, &sendMsg, 0, g_TimeoutMs);
+            if ((result == IPCS_TIMEOUT) || (result == IPCS_OVERLOADED)) {
+                result = IPCS_OK;
+            }
+            break;
+    }
+
+    *missed = 0;
+    for (i = 0; (i < g_Shards) && (result == IPCS_OK); i++) {
+        if ((calls[i].result == IPCS_TIMEOUT) || (calls[i].result == IPCS_OVERLOADED)) {
+            (*missed)++;
+            continue;
+        }
+        if (calls[i].result != IPCS_OK) {
+            result = calls[i].result;
+        } else if ((recvMsgs[i].msgLen != sizeof(resps[i])) || (memcmp(resps[i], req, sizeof(req)) != 0)) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+    }
+
+    return result;
+}
+
+static int FanoutRun(const FANOUT_Config *config)
+{
+    int fds[IPCS_FANOUT_MAX_CALLS];
+    unsigned long long queries = 0;
+    unsigned long long missed = 0;
+    unsigned int queryMissed = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t callNs = 0;
+    int result = IPCS_OK;
+
+    result = FanoutCreateShards(config, fds);
+
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    while ((result == IPCS_OK) && (BENCH_NowNs() < endNs)) {
+        callNs = BENCH_NowNs();
+        result = FanoutQuery(config, fds, queries, &queryMissed);
+        if (result != IPCS_OK) {
+            TEST_PRINT("fanout %s query fail: %d", config->name, result);
+            break;
+        }
+        BENCH_HistRecord(&g_RttHist, BENCH_NowNs() - callNs);
+        queries++;
+        missed += queryMissed;
+    }
+    endNs = BENCH_NowNs();
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s shards=%u service=%uus engine=%s", config->name, g_Shards, g_ServiceUs,
+                (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f queries/s  missed_shards=%.2f/query", (double)queries * BENCH_NS_PER_SEC /
+                (double)(endNs - startNs), (queries != 0) ? (double)missed / (double)queries : 0.0);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+    }
+
+    FanoutDestroyShards(fds);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:n:w:x:t:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'n':
+                g_Shards = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_ServiceUs = (unsigned int)atoi(optarg);
+                break;
+            case 'x':
+                g_SlowFactor = (unsigned int)atoi(optarg);
+                break;
+            case 't':
+                g_TimeoutMs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-n shards] [-w serviceUs] [-x slowFactor] [-t timeoutMs]\n"
+                             "          [-e epoll|uring] [-m seq|all|first|deadline]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_Shards < 2) || (g_Shards > IPCS_FANOUT_MAX_CALLS) || (g_TimeoutMs == 0)) {
+        (void)printf("shards 2..%d, timeoutMs > 0\n", IPCS_FANOUT_MAX_CALLS);
+        return -1;
+    }
+
+    for (i = 0; i < g_Shards; i++) {
+        (void)snprintf(g_ShardNames[i], sizeof(g_ShardNames[i]), "@ipcs_fanout_bench_%u", i);
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = FanoutRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,444 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  flowctl_bench_main.c
+ *
+ *    Description:  flow control and memory budget benchmark
+ *
+ *                  idle：建立大量连接，每个连接发一个大请求并读回响应（接收、发送缓冲区长大），
+ *                  之后不再收发，输出空闲检查前后每个连接占用的内存。
+ *                  flood：若干个灌水连接不停地发送请求、从不读取响应，同时一个同步客户端在
+ *                  同一个服务端上逐个调用，分别在默认connCredit、较小的connCredit和进程内存预算
+ *                  三种配置下运行，输出服务端连接占用内存的峰值、暂停接收的次数和同步调用的时延。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 10:05:31 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define FLOWCTL_MSG_TYPE        0x4643   /* "FC" */
+#define FLOWCTL_SERVER_NAME     "@ipcs_flowctl_bench"
+#define FLOWCTL_MAX_FLOODERS    64
+
+/* 空闲检查两轮之后缓冲区才会收缩 */
+#define FLOWCTL_IDLE_WAIT_US    (1000 * 1000)
+
+typedef struct {
+    const char *name;
+    unsigned int connCredit;
+    size_t memBudget;
+} FLOWCTL_Config;
+
+static const FLOWCTL_Config g_Configs[] = {
+    {"default", 0, 0},
+    {"credit", 64 * 1024, 0},
+    {"budget", 0, 1024 * 1024},
+};
+
+/* 不经过库的帧头：旧格式（标志位全0） */
+typedef struct {
+    unsigned int msgType;
+    unsigned int msgLen;
+} FLOWCTL_Header;
+
+typedef struct {
+    pthread_t tid;
+    int fd;
+    unsigned long long sentBytes;
+} FLOWCTL_Flooder;
+
+static double g_DurationSec = 3.0;
+static unsigned int g_IdleConns = 1000;
+static unsigned int g_BurstLen = 16 * 1024;
+static unsigned int g_Flooders = 4;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyPhase = NULL;
+
+static volatile int g_FloodStop = 0;
+static FLOWCTL_Flooder g_FloodThreads[FLOWCTL_MAX_FLOODERS];
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+int FlowCtlServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static int FlowCtlConnect(void)
+{
+    struct sockaddr_un addr;
+    const char *name = FLOWCTL_SERVER_NAME;
+    socklen_t addrLen = 0;
+    int fd = -1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    /* 抽象地址：sun_path[0]为'\0'，长度精确到名字结尾 */
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)memcpy(addr.sun_path + 1, name + 1, strlen(name) - 1);
+    addrLen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(name));
+
+    if (connect(fd, (struct sockaddr *)&addr, addrLen) != 0) {
+        (void)close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int FlowCtlWriteFull(int fd, const char *buf, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len != 0) {
+        n = write(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+static int FlowCtlReadFull(int fd, char *buf, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len != 0) {
+        n = read(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+static size_t FlowCtlMemUsed(void)
+{
+    IPCS_MemStats stats;
+
+    IPCS_GetMemStats(&stats);
+
+    return stats.used;
+}
+
+static int FlowCtlCreateServer(unsigned int connCredit)
+{
+    IPCS_ServerAttr attr;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    attr.connCredit = connCredit;
+
+    result = IPCS_CreateServerEx(FLOWCTL_SERVER_NAME, FlowCtlServerHook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("flowctl create server fail: %d", result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+static int FlowCtlRunIdle(void)
+{
+    char *frame = NULL;
+    FLOWCTL_Header *header = NULL;
+    size_t frameLen = sizeof(FLOWCTL_Header) + g_BurstLen;
+    size_t baseUsed = 0;
+    size_t burstUsed = 0;
+    size_t idleUsed = 0;
+    unsigned int opened = 0;
+    unsigned int i = 0;
+    int *fds = NULL;
+    int result = IPCS_OK;
+
+    frame = (char *)calloc(1, frameLen);
+    fds = (int *)malloc(g_IdleConns * sizeof(int));
+    if ((frame == NULL) || (fds == NULL)) {
+        free(frame);
+        free(fds);
+        return IPCS_MALLOC_FAIL;
+    }
+    header = (FLOWCTL_Header *)frame;
+    header->msgType = FLOWCTL_MSG_TYPE;
+    header->msgLen = g_BurstLen;
+
+    result = FlowCtlCreateServer(0);
+    if (result != IPCS_OK) {
+        free(frame);
+        free(fds);
+        return result;
+    }
+    baseUsed = FlowCtlMemUsed();
+
+    /* 每个连接一个大请求，读回同样大小的响应 */
+    for (opened = 0; opened < g_IdleConns; opened++) {
+        fds[opened] = FlowCtlConnect();
+        if ((fds[opened] < 0) || (FlowCtlWriteFull(fds[opened], frame, frameLen) != 0) ||
+            (FlowCtlReadFull(fds[opened], frame, frameLen) != 0)) {
+            TEST_PRINT("flowctl idle conn %u fail, errno: %d", opened, errno);
+            if (fds[opened] >= 0) {
+                (void)close(fds[opened]);
+            }
+            result = IPCS_CONNECT_FAIL;
+            break;
+        }
+    }
+    burstUsed = FlowCtlMemUsed();
+
+    (void)usleep(FLOWCTL_IDLE_WAIT_US);
+    idleUsed = FlowCtlMemUsed();
+
+    if (opened != 0) {
+        BENCH_PRINT("idle     conns=%u burst=%u engine=%s", opened, g_BurstLen,
+                (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  after burst: %zu bytes/conn  after idle: %zu bytes/conn  total=%.1fMB -> %.1fMB",
+                (burstUsed - baseUsed) / opened, (idleUsed - baseUsed) / opened,
+                (double)(burstUsed - baseUsed) / (1024.0 * 1024.0), (double)(idleUsed - baseUsed) / (1024.0 * 1024.0));
+    }
+
+    for (i = 0; i < opened; i++) {
+        (void)close(fds[i]);
+    }
+    (void)IPCS_DestroyServer(FLOWCTL_SERVER_NAME);
+    free(frame);
+    free(fds);
+
+    return result;
+}
+
+/* 不停地发送请求，从不读取响应；socket写满时短暂等待 */
+static void *FlowCtlFloodThread(void *arg)
+{
+    FLOWCTL_Flooder *flooder = (FLOWCTL_Flooder *)arg;
+    struct pollfd pfd;
+    FLOWCTL_Header *header = NULL;
+    size_t frameLen = sizeof(FLOWCTL_Header) + g_BurstLen;
+    size_t off = 0;
+    ssize_t n = 0;
+    char *frame = NULL;
+
+    frame = (char *)calloc(1, frameLen);
+    if (frame == NULL) {
+        return NULL;
+    }
+    header = (FLOWCTL_Header *)frame;
+    header->msgType = FLOWCTL_MSG_TYPE;
+    header->msgLen = g_BurstLen;
+
+    pfd.fd = flooder->fd;
+    pfd.events = POLLOUT;
+    while (!g_FloodStop) {
+        n = send(flooder->fd, frame + off, frameLen - off, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            flooder->sentBytes += (unsigned long long)n;
+            off = (off + (size_t)n) % frameLen;
+            continue;
+        }
+        if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+            break;
+        }
+        (void)poll(&pfd, 1, 1);
+    }
+
+    free(frame);
+
+    return NULL;
+}
+
+static int FlowCtlRunFlood(const FLOWCTL_Config *config)
+{
+    char payload[64];
+    char recvBuf[64];
+    IPCS_ServerStats stats;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned long long sentBytes = 0;
+    unsigned long long calls = 0;
+    size_t baseUsed = 0;
+    size_t peakUsed = 0;
+    size_t used = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t sendNs = 0;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    int clientFd = -1;
+    int result = IPCS_OK;
+
+    IPCS_SetMemBudget(config->memBudget);
+    result = FlowCtlCreateServer(config->connCredit);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    result = IPCS_CreateSyncClient(NULL, FLOWCTL_SERVER_NAME, &clientFd);
+    if (result != IPCS_OK) {
+        TEST_PRINT("flowctl create client fail: %d", result);
+        (void)IPCS_DestroyServer(FLOWCTL_SERVER_NAME);
+        return result;
+    }
+    baseUsed = FlowCtlMemUsed();
+
+    g_FloodStop = 0;
+    for (started = 0; started < g_Flooders; started++) {
+        g_FloodThreads[started].sentBytes = 0;
+        g_FloodThreads[started].fd = FlowCtlConnect();
+        if ((g_FloodThreads[started].fd < 0) ||
+            (pthread_create(&g_FloodThreads[started].tid, NULL, FlowCtlFloodThread, &g_FloodThreads[started]) != 0)) {
+            TEST_PRINT("flowctl start flooder %u fail, errno: %d", started, errno);
+            if (g_FloodThreads[started].fd >= 0) {
+                (void)close(g_FloodThreads[started].fd);
+            }
+            result = IPCS_CONNECT_FAIL;
+            break;
+        }
+    }
+
+    (void)memset(payload, 0, sizeof(payload));
+    sendMsg.msgType = FLOWCTL_MSG_TYPE;
+    sendMsg.msgLen = sizeof(payload);
+    sendMsg.msgValue = payload;
+
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    while ((result == IPCS_OK) && ((sendNs = BENCH_NowNs()) < endNs)) {
+        recvMsg.msgLen = sizeof(recvBuf);
+        recvMsg.msgValue = recvBuf;
+        result = IPCS_ClientSyncCall(clientFd, &sendMsg, &recvMsg);
+        BENCH_HistRecord(&g_RttHist, BENCH_NowNs() - sendNs);
+        calls++;
+
+        used = FlowCtlMemUsed();
+        if (used > peakUsed) {
+            peakUsed = used;
+        }
+    }
+    endNs = BENCH_NowNs();
+
+    g_FloodStop = 1;
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_FloodThreads[i].tid, NULL);
+        sentBytes += g_FloodThreads[i].sentBytes;
+    }
+
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)IPCS_GetServerStats(FLOWCTL_SERVER_NAME, &stats);
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s flooders=%u burst=%u credit=%u budget=%zu engine=%s", config->name, started, g_BurstLen,
+                config->connCredit, config->memBudget, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  flood=%.1fMB/s  server_mem_peak=%.2fMB  recv_pauses=%llu  victim=%.0f calls/s",
+                (double)sentBytes / (1024.0 * 1024.0) * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                (peakUsed > baseUsed) ? (double)(peakUsed - baseUsed) / (1024.0 * 1024.0) : 0.0,
+                stats.recvPauses, (double)calls * BENCH_NS_PER_SEC / (double)(endNs - startNs));
+        BENCH_HistPrintSummary(&g_RttHist, "  victim rtt");
+    } else {
+        TEST_PRINT("flowctl sync call fail: %d", result);
+    }
+
+    for (i = 0; i < started; i++) {
+        (void)close(g_FloodThreads[i].fd);
+    }
+    (void)IPCS_DestroyClient(clientFd);
+    (void)IPCS_DestroyServer(FLOWCTL_SERVER_NAME);
+    IPCS_SetMemBudget(0);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:n:s:f:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'n':
+                g_IdleConns = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_BurstLen = (unsigned int)atoi(optarg);
+                break;
+            case 'f':
+                g_Flooders = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyPhase = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-n idleConns] [-s burstPayload] [-f flooders]\n"
+                             "          [-e epoll|uring] [-m idle|default|credit|budget]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_IdleConns == 0) || (g_Flooders == 0) || (g_Flooders > FLOWCTL_MAX_FLOODERS) || (g_BurstLen == 0) ||
+        (g_BurstLen + offsetof(IPCS_Message, msgValue) > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("idleConns > 0, flooders 1..%d, payload 1..%d\n", FLOWCTL_MAX_FLOODERS,
+                (int)(IPCS_MESSAGE_MAX_LEN - offsetof(IPCS_Message, msgValue)));
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    if ((g_OnlyPhase == NULL) || (strcmp(g_OnlyPhase, "idle") == 0)) {
+        result = FlowCtlRunIdle();
+    }
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyPhase != NULL) && (strcmp(g_OnlyPhase, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = FlowCtlRunFlood(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,282 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  flowctl_test_main.c
+ *
+ *    Description:  flow control pause/resume tests
+ *
+ *                  一个原始连接连续发出FLOWCTL_FRAMES个带序号的请求、先不读取响应，检查服务端
+ *                  在积压超过connCredit（或超出内存预算）后暂停接收该连接、发送方被阻塞，暂停期间
+ *                  同一服务端上的其他连接照常调用；之后读取全部响应，检查连接恢复接收、响应
+ *                  一个不少且按序到达。全部通过时返回0。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:58:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define FLOWCTL_SERVER_NAME     "@ipcs_flowctl_test"
+#define FLOWCTL_MSG_TYPE        0x4654   /* "FT" */
+#define FLOWCTL_BODY_LEN        4096
+#define FLOWCTL_FRAMES          1024     /* 共4MB，远超connCredit和两端的socket缓冲区 */
+#define FLOWCTL_STALL_MS        200      /* 暂停后等待这么久，发送方仍应被阻塞 */
+#define FLOWCTL_WAIT_MS         2000
+
+typedef struct {
+    const char *name;
+    IPCS_Engine engine;
+    unsigned int connCredit;
+    size_t memBudget;
+} FLOWCTL_Case;
+
+/* 不经过库的帧头：旧格式（标志位全0） */
+typedef struct {
+    unsigned int msgType;
+    unsigned int msgLen;
+} FLOWCTL_Header;
+
+static int g_RawFd = -1;
+static unsigned int g_SentFrames = 0;
+
+/******************************************************************************/
+int FlowCtlServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static int FlowCtlConnect(void)
+{
+    struct sockaddr_un addr;
+    const char *name = FLOWCTL_SERVER_NAME;
+    socklen_t addrLen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(name));
+    int fd = -1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)memcpy(addr.sun_path + 1, name + 1, strlen(name) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, addrLen) != 0) {
+        (void)close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int FlowCtlReadFull(int fd, char *buf, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len != 0) {
+        n = recv(fd, buf, len, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return 0;
+}
+
+/* 阻塞发送全部请求，负载开头是序号 */
+static void *FlowCtlWriterRun(void *arg)
+{
+    char frame[sizeof(FLOWCTL_Header) + FLOWCTL_BODY_LEN];
+    FLOWCTL_Header *header = (FLOWCTL_Header *)frame;
+    unsigned int seq = 0;
+
+    (void)memset(frame, 'f', sizeof(frame));
+    header->msgType = FLOWCTL_MSG_TYPE;
+    header->msgLen = FLOWCTL_BODY_LEN;
+    for (seq = 0; seq < FLOWCTL_FRAMES; seq++) {
+        (void)memcpy(frame + sizeof(FLOWCTL_Header), &seq, sizeof(seq));
+        if (send(g_RawFd, frame, sizeof(frame), MSG_NOSIGNAL) != (ssize_t)sizeof(frame)) {
+            break;
+        }
+        __atomic_store_n(&g_SentFrames, seq + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+static unsigned long long FlowCtlRecvPauses(void)
+{
+    IPCS_ServerStats stats;
+
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)IPCS_GetServerStats(FLOWCTL_SERVER_NAME, &stats);
+
+    return stats.recvPauses;
+}
+
+/* 等待服务端暂停接收原始连接，最多FLOWCTL_WAIT_MS毫秒 */
+static int FlowCtlWaitPause(void)
+{
+    uint64_t deadlineNs = BENCH_NowNs() + FLOWCTL_WAIT_MS * BENCH_NS_PER_MS;
+
+    while (FlowCtlRecvPauses() == 0) {
+        if (BENCH_NowNs() >= deadlineNs) {
+            return IPCS_TIMEOUT;
+        }
+        (void)usleep(1000);
+    }
+
+    return IPCS_OK;
+}
+
+/* 暂停期间同一服务端上的其他连接不受影响 */
+static int FlowCtlVictimCall(void)
+{
+    char sendBuf[64] = "victim";
+    char recvBuf[64];
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    result = IPCS_CreateSyncClient(NULL, FLOWCTL_SERVER_NAME, &fd);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    sendMsg.msgType = FLOWCTL_MSG_TYPE;
+    sendMsg.msgLen = sizeof(sendBuf);
+    sendMsg.msgValue = sendBuf;
+    recvMsg.msgLen = sizeof(recvBuf);
+    recvMsg.msgValue = recvBuf;
+    result = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, FLOWCTL_WAIT_MS);
+    if ((result == IPCS_OK) && (memcmp(recvBuf, sendBuf, sizeof(sendBuf)) != 0)) {
+        result = IPCS_FRAME_BAD;
+    }
+    (void)IPCS_DestroyClient(fd);
+
+    return result;
+}
+
+/* 读取全部响应，返回按序到达的响应数 */
+static unsigned int FlowCtlDrain(void)
+{
+    char frame[sizeof(FLOWCTL_Header) + FLOWCTL_BODY_LEN];
+    FLOWCTL_Header *header = (FLOWCTL_Header *)frame;
+    unsigned int seq = 0;
+    unsigned int got = 0;
+
+    for (got = 0; got < FLOWCTL_FRAMES; got++) {
+        if (FlowCtlReadFull(g_RawFd, frame, sizeof(frame)) != 0) {
+            break;
+        }
+        (void)memcpy(&seq, frame + sizeof(FLOWCTL_Header), sizeof(seq));
+        if ((header->msgType != FLOWCTL_MSG_TYPE) || (header->msgLen != FLOWCTL_BODY_LEN) || (seq != got)) {
+            break;
+        }
+    }
+
+    return got;
+}
+
+static int FlowCtlTestPauseResume(const FLOWCTL_Case *testCase)
+{
+    IPCS_ServerAttr attr;
+    pthread_t tid;
+    unsigned int stalledFrames = 0;
+    unsigned int drained = 0;
+    int pauseResult = IPCS_OK;
+    int victimResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    IPCS_SetMemBudget(testCase->memBudget);
+    IPCS_InitServerAttr(&attr);
+    attr.engine = testCase->engine;
+    attr.connCredit = testCase->connCredit;
+    attr.readyTimeoutMs = FLOWCTL_WAIT_MS;
+    result = IPCS_CreateServerEx(FLOWCTL_SERVER_NAME, FlowCtlServerHook, &attr);
+    if (result != IPCS_OK) {
+        IPCS_SetMemBudget(0);
+        TEST_CHECK(0, "create server: %d", result);
+    }
+
+    g_SentFrames = 0;
+    g_RawFd = FlowCtlConnect();
+    if ((g_RawFd < 0) || (pthread_create(&tid, NULL, FlowCtlWriterRun, NULL) != 0)) {
+        if (g_RawFd >= 0) {
+            (void)close(g_RawFd);
+        }
+        (void)IPCS_DestroyServer(FLOWCTL_SERVER_NAME);
+        IPCS_SetMemBudget(0);
+        TEST_CHECK(0, "raw connection setup fail");
+    }
+
+    pauseResult = FlowCtlWaitPause();
+    (void)usleep(FLOWCTL_STALL_MS * 1000);
+    stalledFrames = __atomic_load_n(&g_SentFrames, __ATOMIC_ACQUIRE);
+    victimResult = FlowCtlVictimCall();
+
+    /* 读取响应后积压降下来，服务端恢复接收，发送方发完剩下的请求 */
+    drained = FlowCtlDrain();
+    if (drained != FLOWCTL_FRAMES) {
+        (void)shutdown(g_RawFd, SHUT_RDWR);
+    }
+    (void)pthread_join(tid, NULL);
+    (void)close(g_RawFd);
+    (void)IPCS_DestroyServer(FLOWCTL_SERVER_NAME);
+    IPCS_SetMemBudget(0);
+
+    TEST_CHECK(pauseResult == IPCS_OK, "server never paused the unread connection");
+    TEST_CHECK(stalledFrames < FLOWCTL_FRAMES, "writer was not blocked while paused");
+    TEST_CHECK(victimResult == IPCS_OK, "call on another connection while paused: %d", victimResult);
+    TEST_CHECK(drained == FLOWCTL_FRAMES, "got %u of %u responses in order", drained, FLOWCTL_FRAMES);
+    TEST_CHECK(g_SentFrames == FLOWCTL_FRAMES, "sent %u of %u requests", g_SentFrames, FLOWCTL_FRAMES);
+
+    return IPCS_OK;
+}
+
+static const FLOWCTL_Case g_Cases[] = {
+    {"credit_epoll", IPCS_ENGINE_EPOLL, IPCS_CONN_CREDIT_MIN, 0},
+    {"credit_uring", IPCS_ENGINE_URING, IPCS_CONN_CREDIT_MIN, 0},
+    {"budget_epoll", IPCS_ENGINE_EPOLL, 0, 1024 * 1024},
+};
+
+/******************************************************************************/
+int main(void)
+{
+    unsigned int failed = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++) {
+        result = FlowCtlTestPauseResume(&g_Cases[i]);
+        BENCH_PRINT("%-20s %s", g_Cases[i].name, (result == IPCS_OK) ? "PASS" : "FAIL");
+        failed += (result != IPCS_OK);
+    }
+    BENCH_PRINT("flowctl: %u passed, %u failed", i - failed, failed);
+    (void)fflush(NULL);
+
+    return (failed == 0) ? 0 : 1;
+}
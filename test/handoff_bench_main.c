@@ -0,0 +1,435 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  handoff_bench_main.c
+ *
+ *    Description:  server hot restart (listening socket handoff) benchmark
+ *
+ *                  启动时fork出旧服务端进程和新服务端进程，旧进程创建服务端，回调函数忙等-w微秒，
+ *                  响应中带上进程的pid；-c个线程各用一个同步客户端连接调用，另有一个线程反复
+ *                  连接、调用一次、断开。运行到一半时把服务端切换到新进程：restart配置下旧进程销毁
+ *                  服务端退出后新进程重新创建，handoff配置下旧进程调用IPCS_HandoffServer把监听socket
+ *                  和连接交给调用IPCS_TakeoverServer等待的新进程。输出调用速率、失败的调用和连接数、
+ *                  调用时延，以及新旧进程分别处理的调用数。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:58:06 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define HANDOFF_MSG_TYPE        0x4846   /* "HF" */
+#define HANDOFF_MAX_CALLERS     32
+#define HANDOFF_CTRL_NAME       "@ipcs_handoff_bench_ctl"
+#define HANDOFF_TIMEOUT_MS      2000
+
+typedef struct {
+    const char *name;
+    int handoff;
+} HANDOFF_Config;
+
+static const HANDOFF_Config g_Configs[] = {
+    {"restart", 0},
+    {"handoff", 1},
+};
+
+typedef struct {
+    pthread_t tid;
+    unsigned long long calls;
+    unsigned long long fails;
+    unsigned long long connectFails;
+    unsigned long long oldCalls;    /* 旧进程处理的调用 */
+    unsigned long long newCalls;
+    int lastError;
+    BENCH_Histogram hist;
+} HANDOFF_Caller;
+
+static double g_DurationSec = 2.0;
+static unsigned int g_CallerNum = 4;
+static unsigned int g_BusyUs = 20;
+static const char *g_OnlyConfig = NULL;
+
+static volatile int g_Stop = 0;
+static char g_ServerName[64];
+static int g_OldPid = 0;
+static int g_NewPid = 0;
+static HANDOFF_Caller g_CallerArgs[HANDOFF_MAX_CALLERS + 1];
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+/* 在新旧服务端进程中运行：响应[请求, pid] */
+int HandoffServerHook(int fd, IPCS_Message *msg)
+{
+    unsigned int resp[2];
+    IPCS_Message respMsg;
+    uint64_t endNs = BENCH_NowNs() + (uint64_t)g_BusyUs * BENCH_NS_PER_US;
+
+    (void)memset(resp, 0, sizeof(resp));
+    if (msg->msgLen >= sizeof(resp[0])) {
+        (void)memcpy(&resp[0], msg->msgValue, sizeof(resp[0]));
+    }
+    while (BENCH_NowNs() < endNs) {
+    }
+
+    resp[1] = (unsigned int)getpid();
+    respMsg.msgType = msg->msgType;
+    respMsg.msgLen = sizeof(resp);
+    respMsg.msgValue = resp;
+
+    return IPCS_ServerSendMessage(fd, &respMsg);
+}
+
+static char HandoffWaitCmd(int cmdFd)
+{
+    char cmd = 0;
+
+    if (read(cmdFd, &cmd, sizeof(cmd)) != sizeof(cmd)) {
+        return 0;
+    }
+
+    return cmd;
+}
+
+/* 旧进程：创建服务端，收到命令后切换，然后退出 */
+static void HandoffOldServer(const HANDOFF_Config *config, int cmdFd)
+{
+    uint64_t deadlineNs = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_CreateServer(g_ServerName, HandoffServerHook);
+    if (result != IPCS_OK) {
+        TEST_PRINT("handoff old create server fail: %d", result);
+        _exit(1);
+    }
+
+    (void)HandoffWaitCmd(cmdFd);
+    if (!config->handoff) {
+        (void)IPCS_DestroyServer(g_ServerName);
+        _exit(0);
+    }
+
+    /* 新进程还没有开始等待时重试 */
+    deadlineNs = BENCH_NowNs() + (uint64_t)HANDOFF_TIMEOUT_MS * BENCH_NS_PER_MS;
+    do {
+        result = IPCS_HandoffServer(g_ServerName, HANDOFF_CTRL_NAME, HANDOFF_TIMEOUT_MS);
+        if (result != IPCS_CONNECT_FAIL) {
+            break;
+        }
+        (void)usleep(1000);
+    } while (BENCH_NowNs() < deadlineNs);
+
+    if (result != IPCS_OK) {
+        TEST_PRINT("handoff old handoff fail: %d", result);
+        (void)IPCS_DestroyServer(g_ServerName);
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/* 新进程：收到命令后接管或重新创建服务端，再收到命令（或管道关闭）时销毁退出 */
+static void HandoffNewServer(const HANDOFF_Config *config, int cmdFd)
+{
+    IPCS_ServerAttr attr;
+    int result = IPCS_OK;
+
+    (void)HandoffWaitCmd(cmdFd);
+    IPCS_InitServerAttr(&attr);
+    if (config->handoff) {
+        result = IPCS_TakeoverServer(g_ServerName, HandoffServerHook, &attr, HANDOFF_CTRL_NAME, HANDOFF_TIMEOUT_MS);
+    } else {
+        result = IPCS_CreateServerEx(g_ServerName, HandoffServerHook, &attr);
+    }
+    if (result != IPCS_OK) {
+        TEST_PRINT("handoff new %s fail: %d", config->handoff ? "takeover" : "create", result);
+        _exit(1);
+    }
+
+    (void)HandoffWaitCmd(cmdFd);
+    (void)IPCS_DestroyServer(g_ServerName);
+    _exit(0);
+}
+
+static int HandoffSpawn(const HANDOFF_Config *config, int isNew, int *cmdFd)
+{
+    int pipeFd[2];
+    pid_t pid = 0;
+
+    if (pipe(pipeFd) != 0) {
+        return -1;
+    }
+
+    (void)fflush(NULL);
+    pid = fork();
+    if (pid < 0) {
+        (void)close(pipeFd[0]);
+        (void)close(pipeFd[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        (void)close(pipeFd[1]);
+        if (isNew) {
+            HandoffNewServer(config, pipeFd[0]);
+        } else {
+            HandoffOldServer(config, pipeFd[0]);
+        }
+    }
+
+    (void)close(pipeFd[0]);
+    *cmdFd = pipeFd[1];
+
+    return (int)pid;
+}
+
+/******************************************************************************/
+static int HandoffCall(HANDOFF_Caller *caller, int fd)
+{
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned int req = (unsigned int)(caller->calls & 0xFFFF);
+    unsigned int resp[2];
+    uint64_t startNs = 0;
+    int result = IPCS_OK;
+
+    sendMsg.msgType = HANDOFF_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = &req;
+    recvMsg.msgLen = sizeof(resp);
+    recvMsg.msgValue = resp;
+
+    startNs = BENCH_NowNs();
+    result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+    if ((result == IPCS_OK) && ((recvMsg.msgLen != sizeof(resp)) || (resp[0] != req))) {
+        result = IPCS_STREAM_BUF_BAD;
+    }
+    if (result != IPCS_OK) {
+        caller->fails++;
+        caller->lastError = result;
+        return result;
+    }
+
+    BENCH_HistRecord(&caller->hist, BENCH_NowNs() - startNs);
+    caller->calls++;
+    if ((int)resp[1] == g_OldPid) {
+        caller->oldCalls++;
+    } else if ((int)resp[1] == g_NewPid) {
+        caller->newCalls++;
+    }
+
+    return IPCS_OK;
+}
+
+/* 一直用一个连接调用，连接断开时重新连接 */
+static void *HandoffCallerThread(void *arg)
+{
+    HANDOFF_Caller *caller = (HANDOFF_Caller *)arg;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    while (!g_Stop) {
+        if (fd < 0) {
+            result = IPCS_CreateSyncClient(NULL, g_ServerName, &fd);
+            if (result != IPCS_OK) {
+                caller->connectFails++;
+                caller->lastError = result;
+                (void)usleep(1000);
+                continue;
+            }
+        }
+
+        if (HandoffCall(caller, fd) != IPCS_OK) {
+            (void)IPCS_DestroyClient(fd);
+            fd = -1;
+        }
+    }
+
+    if (fd >= 0) {
+        (void)IPCS_DestroyClient(fd);
+    }
+
+    return NULL;
+}
+
+/* 每次调用都新建连接，统计切换期间连接失败的次数 */
+static void *HandoffConnectorThread(void *arg)
+{
+    HANDOFF_Caller *caller = (HANDOFF_Caller *)arg;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    while (!g_Stop) {
+        result = IPCS_CreateSyncClient(NULL, g_ServerName, &fd);
+        if (result != IPCS_OK) {
+            caller->connectFails++;
+            caller->lastError = result;
+            (void)usleep(1000);
+            continue;
+        }
+
+        (void)HandoffCall(caller, fd);
+        (void)IPCS_DestroyClient(fd);
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+static int HandoffRun(const HANDOFF_Config *config)
+{
+    HANDOFF_Caller total;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int oldCmdFd = -1;
+    int newCmdFd = -1;
+    int oldStatus = 0;
+    int newStatus = 0;
+    int result = IPCS_OK;
+
+    /* 每种配置用不同的名字，旧进程退出后内核释放监听地址可能稍有延迟 */
+    (void)snprintf(g_ServerName, sizeof(g_ServerName), "@ipcs_handoff_bench_%s", config->name);
+
+    /* 在创建任何线程之前fork，子进程中只有自己创建的服务端线程 */
+    g_OldPid = HandoffSpawn(config, 0, &oldCmdFd);
+    g_NewPid = HandoffSpawn(config, 1, &newCmdFd);
+    if ((g_OldPid < 0) || (g_NewPid < 0)) {
+        TEST_PRINT("handoff fork fail");
+        return IPCS_PTHREAD_CREATE_FAIL;
+    }
+    (void)usleep(100 * 1000);
+
+    g_Stop = 0;
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (started = 0; started <= g_CallerNum; started++) {
+        (void)memset(&g_CallerArgs[started], 0, sizeof(HANDOFF_Caller));
+        BENCH_HistReset(&g_CallerArgs[started].hist);
+        if (pthread_create(&g_CallerArgs[started].tid, NULL, (started == g_CallerNum) ? HandoffConnectorThread :
+                HandoffCallerThread, &g_CallerArgs[started]) != 0) {
+            TEST_PRINT("handoff start caller %u fail", started);
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+
+    BENCH_SleepUntilNs(startNs + (endNs - startNs) / 2);
+    if (config->handoff) {
+        (void)write(newCmdFd, "s", 1);
+        (void)write(oldCmdFd, "s", 1);
+        (void)waitpid(g_OldPid, &oldStatus, 0);
+    } else {
+        /* 冷重启：旧进程退出之后新进程才创建服务端 */
+        (void)write(oldCmdFd, "s", 1);
+        (void)waitpid(g_OldPid, &oldStatus, 0);
+        (void)write(newCmdFd, "s", 1);
+    }
+    BENCH_SleepUntilNs(endNs);
+
+    g_Stop = 1;
+    (void)memset(&total, 0, sizeof(total));
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_CallerArgs[i].tid, NULL);
+        total.calls += g_CallerArgs[i].calls;
+        total.fails += g_CallerArgs[i].fails;
+        total.connectFails += g_CallerArgs[i].connectFails;
+        total.oldCalls += g_CallerArgs[i].oldCalls;
+        total.newCalls += g_CallerArgs[i].newCalls;
+        if (g_CallerArgs[i].lastError != IPCS_OK) {
+            total.lastError = g_CallerArgs[i].lastError;
+        }
+        BENCH_HistMerge(&g_RttHist, &g_CallerArgs[i].hist);
+    }
+    endNs = BENCH_NowNs();
+
+    (void)write(newCmdFd, "q", 1);
+    (void)close(newCmdFd);
+    (void)close(oldCmdFd);
+    (void)waitpid(g_NewPid, &newStatus, 0);
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s callers=%u+1 busy=%uus", config->name, g_CallerNum, g_BusyUs);
+        BENCH_PRINT("  %.0f calls/s  call_fails=%llu  connect_fails=%llu  last_error=%d", (double)total.calls *
+                BENCH_NS_PER_SEC / (double)(endNs - startNs), total.fails, total.connectFails, total.lastError);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+        BENCH_PRINT("  old pid=%d calls=%llu  new pid=%d calls=%llu", g_OldPid, total.oldCalls, g_NewPid,
+                total.newCalls);
+    }
+
+    if ((result == IPCS_OK) && (!WIFEXITED(oldStatus) || (WEXITSTATUS(oldStatus) != 0) || !WIFEXITED(newStatus) ||
+            (WEXITSTATUS(newStatus) != 0) || (total.newCalls == 0))) {
+        TEST_PRINT("handoff %s: old status=0x%x new status=0x%x", config->name, oldStatus, newStatus);
+        result = IPCS_HANDOFF_FAIL;
+    }
+    /* 交接时连接和未处理的数据都转到新进程，不应有失败 */
+    if ((result == IPCS_OK) && config->handoff && ((total.fails != 0) || (total.connectFails != 0))) {
+        result = total.lastError;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:w:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_CallerNum = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_BusyUs = (unsigned int)atoi(optarg);
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c callers] [-w busyUs] [-m restart|handoff]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_CallerNum == 0) || (g_CallerNum > HANDOFF_MAX_CALLERS)) {
+        (void)printf("callers 1..%d\n", HANDOFF_MAX_CALLERS);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = HandoffRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
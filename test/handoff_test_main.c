@@ -0,0 +1,431 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  handoff_test_main.c
+ *
+ *    Description:  server hot restart (listening socket handoff) tests
+ *
+ *                  启动时fork出旧服务端进程和新服务端进程，回调函数的响应中带上进程的pid。检查：
+ *                  交接前建立的连接交接后由新进程服务，不需要重新连接；旧进程已收到一半的请求由
+ *                  新进程收完并回复；交接后新建的连接由新进程服务。没有新进程等待时交接返回
+ *                  IPCS_CONNECT_FAIL，服务端照常服务。全部通过时返回0。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:31:52 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define HANDOFF_SERVER_NAME     "@ipcs_handoff_test"
+#define HANDOFF_LOCAL_NAME      "@ipcs_handoff_test_local"
+#define HANDOFF_CTRL_NAME       "@ipcs_handoff_test_ctl"
+#define HANDOFF_IDLE_CTRL_NAME  "@ipcs_handoff_test_idle"
+#define HANDOFF_MSG_TYPE        0x4854   /* "HT" */
+#define HANDOFF_PARTIAL_LEN     64       /* 原始连接请求的负载长度，交接前只发出一半 */
+#define HANDOFF_CLIENTS         4
+#define HANDOFF_TIMEOUT_MS      2000
+
+typedef struct {
+    const char *name;
+    int (*run)(void);
+} HANDOFF_Case;
+
+/* 不经过库的帧头：旧格式（标志位全0） */
+typedef struct {
+    unsigned int msgType;
+    unsigned int msgLen;
+} HANDOFF_Header;
+
+static pid_t g_OldPid = 0;
+static pid_t g_NewPid = 0;
+static int g_OldCmdFd = -1;
+static int g_NewCmdFd = -1;
+
+/******************************************************************************/
+/* 在新旧服务端进程中运行：响应[请求的前4字节, pid] */
+int HandoffServerHook(int fd, IPCS_Message *msg)
+{
+    unsigned int resp[2];
+    IPCS_Message respMsg;
+
+    (void)memset(resp, 0, sizeof(resp));
+    if (msg->msgLen >= sizeof(resp[0])) {
+        (void)memcpy(&resp[0], msg->msgValue, sizeof(resp[0]));
+    }
+    resp[1] = (unsigned int)getpid();
+    respMsg.msgType = msg->msgType;
+    respMsg.msgLen = sizeof(resp);
+    respMsg.msgValue = resp;
+
+    return IPCS_ServerSendMessage(fd, &respMsg);
+}
+
+static char HandoffWaitCmd(int cmdFd)
+{
+    char cmd = 0;
+
+    if (read(cmdFd, &cmd, sizeof(cmd)) != sizeof(cmd)) {
+        return 0;
+    }
+
+    return cmd;
+}
+
+/* 旧进程：创建服务端，收到命令后交接，退出码表示交接是否成功 */
+static void HandoffOldServer(int cmdFd)
+{
+    IPCS_ServerAttr attr;
+    uint64_t deadlineNs = 0;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&attr);
+    attr.readyTimeoutMs = HANDOFF_TIMEOUT_MS;
+    result = IPCS_CreateServerEx(HANDOFF_SERVER_NAME, HandoffServerHook, &attr);
+    if ((result != IPCS_OK) || (HandoffWaitCmd(cmdFd) == 0)) {
+        _exit(1);
+    }
+
+    /* 新进程还没有开始等待时重试 */
+    deadlineNs = BENCH_NowNs() + (uint64_t)HANDOFF_TIMEOUT_MS * BENCH_NS_PER_MS;
+    do {
+        result = IPCS_HandoffServer(HANDOFF_SERVER_NAME, HANDOFF_CTRL_NAME, HANDOFF_TIMEOUT_MS);
+        if (result != IPCS_CONNECT_FAIL) {
+            break;
+        }
+        (void)usleep(1000);
+    } while (BENCH_NowNs() < deadlineNs);
+
+    if (result != IPCS_OK) {
+        (void)IPCS_DestroyServer(HANDOFF_SERVER_NAME);
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/* 新进程：收到命令后接管服务端，命令管道关闭时销毁退出 */
+static void HandoffNewServer(int cmdFd)
+{
+    IPCS_ServerAttr attr;
+    int result = IPCS_OK;
+
+    if (HandoffWaitCmd(cmdFd) == 0) {
+        _exit(1);
+    }
+    IPCS_InitServerAttr(&attr);
+    result = IPCS_TakeoverServer(HANDOFF_SERVER_NAME, HandoffServerHook, &attr, HANDOFF_CTRL_NAME,
+            HANDOFF_TIMEOUT_MS);
+    if (result != IPCS_OK) {
+        _exit(1);
+    }
+
+    (void)HandoffWaitCmd(cmdFd);
+    (void)IPCS_DestroyServer(HANDOFF_SERVER_NAME);
+    _exit(0);
+}
+
+static pid_t HandoffSpawn(int isNew, int *cmdFd)
+{
+    int pipeFd[2];
+    pid_t pid = 0;
+
+    if (pipe(pipeFd) != 0) {
+        return -1;
+    }
+
+    (void)fflush(NULL);
+    pid = fork();
+    if (pid < 0) {
+        (void)close(pipeFd[0]);
+        (void)close(pipeFd[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        (void)close(pipeFd[1]);
+        if (isNew) {
+            HandoffNewServer(pipeFd[0]);
+        } else {
+            HandoffOldServer(pipeFd[0]);
+        }
+    }
+
+    (void)close(pipeFd[0]);
+    *cmdFd = pipeFd[1];
+
+    return pid;
+}
+
+static void HandoffSendCmd(int cmdFd)
+{
+    char cmd = 'g';
+
+    (void)write(cmdFd, &cmd, sizeof(cmd));
+
+    return;
+}
+
+/* 子进程的退出码，超时未退出时返回-1 */
+static int HandoffWaitExit(pid_t pid)
+{
+    uint64_t deadlineNs = BENCH_NowNs() + (uint64_t)HANDOFF_TIMEOUT_MS * BENCH_NS_PER_MS;
+    int status = 0;
+
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (BENCH_NowNs() >= deadlineNs) {
+            return -1;
+        }
+        (void)usleep(1000);
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/******************************************************************************/
+/* 返回响应中的pid，失败时返回0 */
+static pid_t HandoffCall(const char *stage, int fd, unsigned int req)
+{
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned int resp[2] = {0, 0};
+    int result = IPCS_OK;
+
+    sendMsg.msgType = HANDOFF_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = &req;
+    recvMsg.msgLen = sizeof(resp);
+    recvMsg.msgValue = resp;
+    result = IPCS_ClientSyncCallTimeout(fd, &sendMsg, &recvMsg, HANDOFF_TIMEOUT_MS);
+    if ((result != IPCS_OK) || (recvMsg.msgLen != sizeof(resp)) || (resp[0] != req)) {
+        TEST_PRINT("handoff call %s fd %d fail: %d", stage, fd, result);
+        return 0;
+    }
+
+    return (pid_t)resp[1];
+}
+
+static int HandoffRawConnect(void)
+{
+    struct sockaddr_un addr;
+    const char *name = HANDOFF_SERVER_NAME;
+    socklen_t addrLen = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + strlen(name));
+    int fd = -1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    (void)memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    (void)memcpy(addr.sun_path + 1, name + 1, strlen(name) - 1);
+    if (connect(fd, (struct sockaddr *)&addr, addrLen) != 0) {
+        (void)close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* 读取原始连接上的响应，返回其中的pid，失败时返回0 */
+static pid_t HandoffRawRecv(int fd, unsigned int req)
+{
+    struct timeval tv = {HANDOFF_TIMEOUT_MS / 1000, 0};
+    char frame[sizeof(HANDOFF_Header) + 2 * sizeof(unsigned int)];
+    HANDOFF_Header *header = (HANDOFF_Header *)frame;
+    unsigned int resp[2];
+    size_t got = 0;
+    ssize_t n = 0;
+
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    while (got < sizeof(frame)) {
+        n = recv(fd, frame + got, sizeof(frame) - got, 0);
+        if (n <= 0) {
+            return 0;
+        }
+        got += (size_t)n;
+    }
+
+    (void)memcpy(resp, frame + sizeof(HANDOFF_Header), sizeof(resp));
+    if ((header->msgType != HANDOFF_MSG_TYPE) || (header->msgLen != sizeof(resp)) || (resp[0] != req)) {
+        return 0;
+    }
+
+    return (pid_t)resp[1];
+}
+
+/******************************************************************************/
+static int HandoffTestTakeover(void)
+{
+    IPCS_ClientAttr clientAttr;
+    char frame[sizeof(HANDOFF_Header) + HANDOFF_PARTIAL_LEN];
+    HANDOFF_Header *header = (HANDOFF_Header *)frame;
+    unsigned int rawReq = 0x5241;   /* "RA" */
+    pid_t beforePids[HANDOFF_CLIENTS];
+    pid_t afterPids[HANDOFF_CLIENTS];
+    pid_t rawPid = 0;
+    pid_t freshPid = 0;
+    unsigned int opened = 0;
+    unsigned int i = 0;
+    int fds[HANDOFF_CLIENTS];
+    int freshFd = -1;
+    int rawFd = -1;
+    int oldExit = -1;
+    int newExit = -1;
+    int result = IPCS_OK;
+
+    /* 旧进程可能还没有开始监听 */
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.connectTimeoutMs = HANDOFF_TIMEOUT_MS;
+    for (opened = 0; (result == IPCS_OK) && (opened < HANDOFF_CLIENTS); opened++) {
+        result = IPCS_CreateSyncClientEx(NULL, HANDOFF_SERVER_NAME, &clientAttr, &fds[opened]);
+        if (result == IPCS_OK) {
+            beforePids[opened] = HandoffCall("old", fds[opened], opened);
+        }
+    }
+    if (result == IPCS_OK) {
+        rawFd = HandoffRawConnect();
+    }
+
+    /* 旧进程收到帧头和一半负载后交接 */
+    (void)memset(frame, 'h', sizeof(frame));
+    header->msgType = HANDOFF_MSG_TYPE;
+    header->msgLen = HANDOFF_PARTIAL_LEN;
+    (void)memcpy(frame + sizeof(HANDOFF_Header), &rawReq, sizeof(rawReq));
+    if (rawFd >= 0) {
+        (void)send(rawFd, frame, sizeof(HANDOFF_Header) + HANDOFF_PARTIAL_LEN / 2, MSG_NOSIGNAL);
+        (void)usleep(50 * 1000);
+    }
+
+    HandoffSendCmd(g_NewCmdFd);
+    HandoffSendCmd(g_OldCmdFd);
+    oldExit = HandoffWaitExit(g_OldPid);
+
+    for (i = 0; i < opened; i++) {
+        afterPids[i] = HandoffCall("new", fds[i], 100 + i);
+    }
+    if (rawFd >= 0) {
+        (void)send(rawFd, frame + sizeof(HANDOFF_Header) + HANDOFF_PARTIAL_LEN / 2, HANDOFF_PARTIAL_LEN / 2,
+                MSG_NOSIGNAL);
+        rawPid = HandoffRawRecv(rawFd, rawReq);
+        (void)close(rawFd);
+    }
+    if (IPCS_CreateSyncClient(NULL, HANDOFF_SERVER_NAME, &freshFd) == IPCS_OK) {
+        freshPid = HandoffCall("fresh", freshFd, 200);
+        (void)IPCS_DestroyClient(freshFd);
+    }
+
+    for (i = 0; i < opened; i++) {
+        (void)IPCS_DestroyClient(fds[i]);
+    }
+    (void)close(g_NewCmdFd);
+    g_NewCmdFd = -1;
+    newExit = HandoffWaitExit(g_NewPid);
+
+    TEST_CHECK((result == IPCS_OK) && (rawFd >= 0), "connect before handoff: %d", result);
+    for (i = 0; i < opened; i++) {
+        TEST_CHECK(beforePids[i] == g_OldPid, "client %u before handoff served by pid %d, expect %d", i,
+                (int)beforePids[i], (int)g_OldPid);
+    }
+    TEST_CHECK(oldExit == 0, "old process handoff exit: %d", oldExit);
+    for (i = 0; i < opened; i++) {
+        TEST_CHECK(afterPids[i] == g_NewPid, "client %u after handoff served by pid %d, expect %d", i,
+                (int)afterPids[i], (int)g_NewPid);
+    }
+    TEST_CHECK(rawPid == g_NewPid, "half-received request answered by pid %d, expect %d", (int)rawPid, (int)g_NewPid);
+    TEST_CHECK(freshPid == g_NewPid, "new connection served by pid %d, expect %d", (int)freshPid, (int)g_NewPid);
+    TEST_CHECK(newExit == 0, "new process exit: %d", newExit);
+
+    return IPCS_OK;
+}
+
+/* 没有新进程等待时交接失败，服务端照常服务 */
+static int HandoffTestNoTaker(void)
+{
+    IPCS_ServerAttr attr;
+    pid_t pid = 0;
+    int fd = -1;
+    int handoffResult = IPCS_OK;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&attr);
+    attr.readyTimeoutMs = HANDOFF_TIMEOUT_MS;
+    result = IPCS_CreateServerEx(HANDOFF_LOCAL_NAME, HandoffServerHook, &attr);
+    TEST_CHECK(result == IPCS_OK, "create server: %d", result);
+
+    result = IPCS_CreateSyncClient(NULL, HANDOFF_LOCAL_NAME, &fd);
+    if (result == IPCS_OK) {
+        handoffResult = IPCS_HandoffServer(HANDOFF_LOCAL_NAME, HANDOFF_IDLE_CTRL_NAME, 100);
+        pid = HandoffCall("local", fd, 300);
+        (void)IPCS_DestroyClient(fd);
+    }
+    (void)IPCS_DestroyServer(HANDOFF_LOCAL_NAME);
+
+    TEST_CHECK(result == IPCS_OK, "create client: %d", result);
+    TEST_CHECK(handoffResult == IPCS_CONNECT_FAIL, "handoff without taker returned %d, expect %d", handoffResult,
+            IPCS_CONNECT_FAIL);
+    TEST_CHECK(pid == getpid(), "server after failed handoff answered with pid %d", (int)pid);
+
+    return IPCS_OK;
+}
+
+static const HANDOFF_Case g_Cases[] = {
+    {"takeover", HandoffTestTakeover},
+    {"no_taker", HandoffTestNoTaker},
+};
+
+/******************************************************************************/
+int main(void)
+{
+    unsigned int failed = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    IPCS_EnableLog(0);
+
+    /* 在创建任何线程之前fork，子进程中只有自己创建的服务端线程 */
+    g_OldPid = HandoffSpawn(0, &g_OldCmdFd);
+    g_NewPid = HandoffSpawn(1, &g_NewCmdFd);
+    if ((g_OldPid < 0) || (g_NewPid < 0)) {
+        BENCH_PRINT("handoff test fork fail");
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++) {
+        result = g_Cases[i].run();
+        BENCH_PRINT("%-20s %s", g_Cases[i].name, (result == IPCS_OK) ? "PASS" : "FAIL");
+        failed += (result != IPCS_OK);
+    }
+    BENCH_PRINT("handoff: %u passed, %u failed", i - failed, failed);
+
+    /* 用例失败时子进程可能还在等待命令 */
+    if (g_NewCmdFd >= 0) {
+        (void)close(g_NewCmdFd);
+    }
+    (void)close(g_OldCmdFd);
+    (void)waitpid(g_OldPid, NULL, 0);
+    (void)waitpid(g_NewPid, NULL, 0);
+    (void)fflush(NULL);
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,558 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  loadgen_main.c
+ *
+ *    Description:  open-loop load generator
+ *
+ *                  按固定速率的发送计划发送请求，延迟从计划发送时间开始计算，
+ *                  因此发送端落后时的排队延迟也会被统计（避免coordinated omission）。
+ *                  可以在多个速率间扫描，找到吞吐不再跟随目标速率或延迟超过SLO的拐点。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:40:02 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define LOADGEN_SERVER_NAME         "/tmp/ipcs_loadgen_server"
+#define LOADGEN_CLIENT_NAME_FMT     "/tmp/ipcs_loadgen_client_%d"
+
+#define LOADGEN_MSG_TYPE            0x4C47   /* "LG" */
+#define LOADGEN_MAX_CONN            64
+#define LOADGEN_DRAIN_TIMEOUT_NS    (2 * BENCH_NS_PER_SEC)
+#define LOADGEN_KNEE_RATIO          0.95
+#define LOADGEN_CAPTURE_SIZE        (256 * 1024 * 1024)
+
+typedef struct {
+    uint32_t step;
+    uint32_t reserved;
+    uint64_t seq;
+    uint64_t intendedNs;
+} LoadgenPayload;
+
+typedef struct {
+    int isSync;
+    double rateStart;
+    double rateStop;
+    double rateStep;
+    unsigned int durationSec;
+    int connNum;
+    unsigned int payloadLen;
+    const char *serverName;
+    double sloUs;
+    int printBuckets;
+    int quiet;
+    const char *captureFile;
+    unsigned int timeoutMs;
+} LoadgenConfig;
+
+typedef struct {
+    int fd;
+    int index;
+    double rate;
+    uint64_t startNs;
+    uint64_t count;
+    void *sendBuf;
+    void *recvBuf;
+    BENCH_Histogram hist;
+    uint64_t received;
+    uint64_t timedOut;
+    uint64_t maxSendLagNs;
+} LoadgenSyncWorker;
+
+/******************************************************************************/
+static LoadgenConfig g_Config;
+static int g_Fds[LOADGEN_MAX_CONN];
+
+/* 异步应答在各客户端的接收线程中统计 */
+static pthread_mutex_t g_StatMutex = PTHREAD_MUTEX_INITIALIZER;
+static BENCH_Histogram g_AsynHist;
+static volatile uint32_t g_CurStep = 0;
+static volatile uint64_t g_AsynReceived = 0;
+static volatile uint64_t g_AsynTimedOut = 0;
+static uint64_t g_TimedOut = 0;
+
+/******************************************************************************/
+int LoadgenEchoHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+int LoadgenAsynHook(IPCS_Message *msg)
+{
+    LoadgenPayload payload;
+    uint64_t nowNs = BENCH_NowNs();
+
+    if ((msg->msgType != LOADGEN_MSG_TYPE) || (msg->msgLen < sizeof(LoadgenPayload))) {
+        return IPCS_OK;
+    }
+
+    (void)memcpy(&payload, msg->msgValue, sizeof(LoadgenPayload));
+    if (payload.step != g_CurStep) {
+        /* 上一轮超时后才到达的应答 */
+        return IPCS_OK;
+    }
+
+    (void)pthread_mutex_lock(&g_StatMutex);
+    BENCH_HistRecord(&g_AsynHist, nowNs - payload.intendedNs);
+    g_AsynReceived++;
+    (void)pthread_mutex_unlock(&g_StatMutex);
+
+    return IPCS_OK;
+}
+
+/* 超时的调用不再等待应答，迟到的应答由库丢弃 */
+int LoadgenTimeoutHook(unsigned int callId)
+{
+    (void)pthread_mutex_lock(&g_StatMutex);
+    g_AsynTimedOut++;
+    (void)pthread_mutex_unlock(&g_StatMutex);
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+static uint64_t LoadgenIntendedNs(uint64_t startNs, double rate, uint64_t seq)
+{
+    return startNs + (uint64_t)((double)seq * (double)BENCH_NS_PER_SEC / rate);
+}
+
+static int LoadgenRunAsynStep(uint32_t step, double rate, BENCH_Histogram *hist, uint64_t *sent,
+                              uint64_t *received, uint64_t *maxSendLagNs)
+{
+    uint64_t count = (uint64_t)(rate * g_Config.durationSec);
+    uint64_t startNs = 0;
+    uint64_t intendedNs = 0;
+    uint64_t nowNs = 0;
+    uint64_t seq = 0;
+    uint64_t drainDeadlineNs = 0;
+    LoadgenPayload *payload = NULL;
+    IPCS_Message sendMsg;
+    int result = IPCS_OK;
+
+    payload = (LoadgenPayload *)malloc(g_Config.payloadLen);
+    if (payload == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    (void)memset(payload, 0, g_Config.payloadLen);
+
+    (void)pthread_mutex_lock(&g_StatMutex);
+    BENCH_HistReset(&g_AsynHist);
+    g_AsynReceived = 0;
+    g_AsynTimedOut = 0;
+    g_CurStep = step;
+    (void)pthread_mutex_unlock(&g_StatMutex);
+
+    *maxSendLagNs = 0;
+    startNs = BENCH_NowNs() + BENCH_NS_PER_MS;
+
+    for (seq = 0; seq < count; seq++) {
+        intendedNs = LoadgenIntendedNs(startNs, rate, seq);
+        nowNs = BENCH_NowNs();
+        if (nowNs < intendedNs) {
+            BENCH_SleepUntilNs(intendedNs);
+        } else if (nowNs - intendedNs > *maxSendLagNs) {
+            *maxSendLagNs = nowNs - intendedNs;
+        }
+
+        payload->step = step;
+        payload->seq = seq;
+        payload->intendedNs = intendedNs;
+
+        sendMsg.msgType = LOADGEN_MSG_TYPE;
+        sendMsg.msgLen = g_Config.payloadLen;
+        sendMsg.msgValue = payload;
+        if (g_Config.timeoutMs != 0) {
+            result = IPCS_ClientAsynCallTimeout(g_Fds[seq % g_Config.connNum], &sendMsg, g_Config.timeoutMs, NULL);
+        } else {
+            result = IPCS_ClientAsynCall(g_Fds[seq % g_Config.connNum], &sendMsg);
+        }
+        if (result != IPCS_OK) {
+            TEST_PRINT("loadgen asyn call fail: %d, seq: %llu", result, (unsigned long long)seq);
+            break;
+        }
+    }
+    *sent = seq;
+
+    drainDeadlineNs = BENCH_NowNs() + LOADGEN_DRAIN_TIMEOUT_NS;
+    while ((g_AsynReceived + g_AsynTimedOut < *sent) && (BENCH_NowNs() < drainDeadlineNs)) {
+        (void)usleep(1000);
+    }
+
+    (void)pthread_mutex_lock(&g_StatMutex);
+    g_CurStep = 0;
+    *received = g_AsynReceived;
+    g_TimedOut = g_AsynTimedOut;
+    (void)memcpy(hist, &g_AsynHist, sizeof(BENCH_Histogram));
+    (void)pthread_mutex_unlock(&g_StatMutex);
+
+    free(payload);
+
+    return result;
+}
+
+/******************************************************************************/
+void *LoadgenSyncWorkerRun(void *arg)
+{
+    LoadgenSyncWorker *worker = (LoadgenSyncWorker *)arg;
+    LoadgenPayload *payload = (LoadgenPayload *)worker->sendBuf;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    uint64_t seq = 0;
+    uint64_t intendedNs = 0;
+    uint64_t nowNs = 0;
+    int result = 0;
+
+    /* 每个连接负责 seq % connNum == index 的请求，整体仍是一个固定速率的发送计划 */
+    for (seq = (uint64_t)worker->index; seq < worker->count; seq += (uint64_t)g_Config.connNum) {
+        intendedNs = LoadgenIntendedNs(worker->startNs, worker->rate, seq);
+        nowNs = BENCH_NowNs();
+        if (nowNs < intendedNs) {
+            BENCH_SleepUntilNs(intendedNs);
+        } else if (nowNs - intendedNs > worker->maxSendLagNs) {
+            worker->maxSendLagNs = nowNs - intendedNs;
+        }
+
+        payload->seq = seq;
+        payload->intendedNs = intendedNs;
+
+        sendMsg.msgType = LOADGEN_MSG_TYPE;
+        sendMsg.msgLen = g_Config.payloadLen;
+        sendMsg.msgValue = payload;
+
+        recvMsg.msgType = 0;
+        recvMsg.msgLen = g_Config.payloadLen;
+        recvMsg.msgValue = worker->recvBuf;
+
+        result = IPCS_ClientSyncCallTimeout(worker->fd, &sendMsg, &recvMsg,
+                (g_Config.timeoutMs != 0) ? g_Config.timeoutMs : IPCS_SYNC_CALL_DEFAULT_TIMEOUT_MS);
+        if (result == IPCS_TIMEOUT) {
+            worker->timedOut++;
+            continue;
+        }
+        if (result != IPCS_OK) {
+            TEST_PRINT("loadgen sync call fail: %d, fd: %d, seq: %llu", result, worker->fd, (unsigned long long)seq);
+            break;
+        }
+
+        BENCH_HistRecord(&worker->hist, BENCH_NowNs() - intendedNs);
+        worker->received++;
+    }
+
+    return NULL;
+}
+
+static int LoadgenRunSyncStep(double rate, BENCH_Histogram *hist, uint64_t *sent,
+                              uint64_t *received, uint64_t *maxSendLagNs)
+{
+    LoadgenSyncWorker *workers = NULL;
+    pthread_t threadIds[LOADGEN_MAX_CONN];
+    uint64_t count = (uint64_t)(rate * g_Config.durationSec);
+    uint64_t startNs = BENCH_NowNs() + BENCH_NS_PER_MS * 10;
+    int created = 0;
+    int i = 0;
+    int result = IPCS_OK;
+
+    workers = (LoadgenSyncWorker *)calloc((size_t)g_Config.connNum, sizeof(LoadgenSyncWorker));
+    if (workers == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    for (i = 0; i < g_Config.connNum; i++) {
+        workers[i].fd = g_Fds[i];
+        workers[i].index = i;
+        workers[i].rate = rate;
+        workers[i].startNs = startNs;
+        workers[i].count = count;
+        workers[i].sendBuf = calloc(1, g_Config.payloadLen);
+        workers[i].recvBuf = calloc(1, g_Config.payloadLen);
+        BENCH_HistReset(&workers[i].hist);
+        if ((workers[i].sendBuf == NULL) || (workers[i].recvBuf == NULL)) {
+            result = IPCS_MALLOC_FAIL;
+            break;
+        }
+
+        if (pthread_create(&threadIds[i], NULL, LoadgenSyncWorkerRun, &workers[i]) != 0) {
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+        created++;
+    }
+
+    BENCH_HistReset(hist);
+    *sent = count;
+    *received = 0;
+    *maxSendLagNs = 0;
+    g_TimedOut = 0;
+
+    for (i = 0; i < created; i++) {
+        (void)pthread_join(threadIds[i], NULL);
+        BENCH_HistMerge(hist, &workers[i].hist);
+        *received += workers[i].received;
+        g_TimedOut += workers[i].timedOut;
+        if (workers[i].maxSendLagNs > *maxSendLagNs) {
+            *maxSendLagNs = workers[i].maxSendLagNs;
+        }
+    }
+
+    for (i = 0; i < g_Config.connNum; i++) {
+        free(workers[i].sendBuf);
+        free(workers[i].recvBuf);
+    }
+    free(workers);
+
+    return result;
+}
+
+/******************************************************************************/
+static int LoadgenCreateClients(void)
+{
+    char clientName[108];
+    int result = IPCS_OK;
+    int i = 0;
+
+    for (i = 0; i < g_Config.connNum; i++) {
+        (void)snprintf(clientName, sizeof(clientName), LOADGEN_CLIENT_NAME_FMT, i);
+        if (g_Config.isSync) {
+            result = IPCS_CreateSyncClient(clientName, g_Config.serverName, &g_Fds[i]);
+        } else {
+            result = IPCS_CreateAsynClient(clientName, g_Config.serverName, LoadgenAsynHook, &g_Fds[i]);
+            if (result == IPCS_OK) {
+                result = IPCS_SetClientTimeoutHook(g_Fds[i], LoadgenTimeoutHook);
+            }
+        }
+
+        if (result != IPCS_OK) {
+            TEST_PRINT("loadgen create client %s fail: %d", clientName, result);
+            return result;
+        }
+    }
+
+    return IPCS_OK;
+}
+
+static void LoadgenDestroyClients(void)
+{
+    int i = 0;
+
+    for (i = 0; i < g_Config.connNum; i++) {
+        (void)IPCS_DestroyClient(g_Fds[i]);
+    }
+
+    return;
+}
+
+static int LoadgenSweep(void)
+{
+    BENCH_Histogram *hist = NULL;
+    double rate = 0.0;
+    double achieved = 0.0;
+    double kneeRate = 0.0;
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t maxSendLagNs = 0;
+    uint64_t stepStartNs = 0;
+    uint64_t p99 = 0;
+    uint32_t step = 0;
+    int result = IPCS_OK;
+
+    hist = (BENCH_Histogram *)malloc(sizeof(BENCH_Histogram));
+    if (hist == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    BENCH_PRINT("mode=%s conns=%d payload=%u duration=%us server=%s",
+            g_Config.isSync ? "sync" : "asyn", g_Config.connNum, g_Config.payloadLen,
+            g_Config.durationSec, g_Config.serverName);
+
+    for (rate = g_Config.rateStart; rate <= g_Config.rateStop; rate += g_Config.rateStep) {
+        step++;
+        stepStartNs = BENCH_NowNs();
+
+        if (g_Config.isSync) {
+            result = LoadgenRunSyncStep(rate, hist, &sent, &received, &maxSendLagNs);
+        } else {
+            result = LoadgenRunAsynStep(step, rate, hist, &sent, &received, &maxSendLagNs);
+        }
+
+        achieved = (double)received * BENCH_NS_PER_SEC / (double)(BENCH_NowNs() - stepStartNs);
+        BENCH_PRINT("\nrate=%.0f/s sent=%llu received=%llu lost=%llu timeout=%llu achieved=%.0f/s max_send_lag=%.1fus",
+                rate, (unsigned long long)sent, (unsigned long long)received,
+                (unsigned long long)(sent - received), (unsigned long long)g_TimedOut, achieved,
+                (double)maxSendLagNs / BENCH_NS_PER_US);
+        BENCH_HistPrintSummary(hist, "latency");
+        if (g_Config.printBuckets) {
+            BENCH_HistPrintBuckets(hist);
+        }
+
+        if (result != IPCS_OK) {
+            break;
+        }
+
+        /* 拐点判断：应答丢失、吞吐跟不上目标速率或p99超过SLO */
+        p99 = BENCH_HistPercentile(hist, 99.0);
+        if ((received < sent) || (achieved < rate * LOADGEN_KNEE_RATIO) ||
+            ((g_Config.sloUs > 0.0) && ((double)p99 / BENCH_NS_PER_US > g_Config.sloUs))) {
+            BENCH_PRINT("\nsaturated at rate=%.0f/s", rate);
+            break;
+        }
+        kneeRate = rate;
+    }
+
+    BENCH_PRINT("\nknee: highest sustainable rate=%.0f/s", kneeRate);
+
+    free(hist);
+
+    return result;
+}
+
+/******************************************************************************/
+static void LoadgenUsage(const char *prog)
+{
+    (void)printf("Usage: %s [-m sync|asyn] [-r rate | -R start:stop:step] [-d seconds] [-c conns]\n"
+                 "          [-s payloadBytes] [-S serverName] [-l sloP99Us] [-t timeoutMs] [-H] [-q] [-w captureFile]\n"
+                 "  Without -S an in-process echo server is started at %s.\n"
+                 "  -H prints the full latency histogram, -q turns off the library log,\n"
+                 "  -w captures all frames to captureFile for replay.exe,\n"
+                 "  -t sets a per-call deadline; timed-out calls are counted and their late responses dropped.\n",
+                 prog, LOADGEN_SERVER_NAME);
+
+    return;
+}
+
+static int LoadgenParseArgs(int argc, char **argv)
+{
+    int opt = 0;
+
+    g_Config.isSync = 0;
+    g_Config.rateStart = 1000.0;
+    g_Config.rateStop = 1000.0;
+    g_Config.rateStep = 1000.0;
+    g_Config.durationSec = 5;
+    g_Config.connNum = 1;
+    g_Config.payloadLen = sizeof(LoadgenPayload);
+    g_Config.serverName = NULL;
+    g_Config.sloUs = 0.0;
+    g_Config.printBuckets = 0;
+    g_Config.quiet = 0;
+    g_Config.captureFile = NULL;
+    g_Config.timeoutMs = 0;
+
+    while ((opt = getopt(argc, argv, "m:r:R:d:c:s:S:l:t:Hqw:h")) != -1) {
+        switch (opt) {
+            case 'm':
+                g_Config.isSync = (strcmp(optarg, "sync") == 0);
+                break;
+            case 'r':
+                g_Config.rateStart = atof(optarg);
+                g_Config.rateStop = g_Config.rateStart;
+                g_Config.rateStep = g_Config.rateStart;
+                break;
+            case 'R':
+                if (sscanf(optarg, "%lf:%lf:%lf", &g_Config.rateStart, &g_Config.rateStop, &g_Config.rateStep) != 3) {
+                    return -1;
+                }
+                break;
+            case 'd':
+                g_Config.durationSec = (unsigned int)atoi(optarg);
+                break;
+            case 'c':
+                g_Config.connNum = atoi(optarg);
+                break;
+            case 's':
+                g_Config.payloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'S':
+                g_Config.serverName = optarg;
+                break;
+            case 'l':
+                g_Config.sloUs = atof(optarg);
+                break;
+            case 't':
+                g_Config.timeoutMs = (unsigned int)atoi(optarg);
+                break;
+            case 'H':
+                g_Config.printBuckets = 1;
+                break;
+            case 'q':
+                g_Config.quiet = 1;
+                break;
+            case 'w':
+                g_Config.captureFile = optarg;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    if ((g_Config.connNum <= 0) || (g_Config.connNum > LOADGEN_MAX_CONN) ||
+        (g_Config.rateStart <= 0.0) || (g_Config.rateStep <= 0.0) || (g_Config.durationSec == 0)) {
+        return -1;
+    }
+
+    if (g_Config.payloadLen < sizeof(LoadgenPayload)) {
+        g_Config.payloadLen = sizeof(LoadgenPayload);
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result = 0;
+
+    if (LoadgenParseArgs(argc, argv) != 0) {
+        LoadgenUsage(argv[0]);
+        return -1;
+    }
+
+    IPCS_EnableLog(!g_Config.quiet);
+
+    if (g_Config.serverName == NULL) {
+        g_Config.serverName = LOADGEN_SERVER_NAME;
+        result = IPCS_CreateServer(g_Config.serverName, LoadgenEchoHook);
+        if (result != IPCS_OK) {
+            TEST_PRINT("loadgen create echo server fail: %d", result);
+            return result;
+        }
+        /* 服务端线程异步完成bind/listen */
+        (void)usleep(100 * 1000);
+    }
+
+    if (g_Config.captureFile != NULL) {
+        result = IPCS_StartCapture(g_Config.captureFile, LOADGEN_CAPTURE_SIZE);
+        if (result != IPCS_OK) {
+            TEST_PRINT("loadgen start capture %s fail: %d", g_Config.captureFile, result);
+            return result;
+        }
+    }
+
+    result = LoadgenCreateClients();
+    if (result == IPCS_OK) {
+        result = LoadgenSweep();
+    }
+
+    LoadgenDestroyClients();
+    (void)IPCS_StopCapture();
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,389 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  microbench_main.c
+ *
+ *    Description:  microbenchmarks for framing and registry primitives
+ *
+ *                  与Google Benchmark的用法和输出类似：每个用例自动增加迭代次数，
+ *                  直到运行时间超过最小测量时间，然后输出每次操作的耗时。
+ *                  多线程用例的每个线程执行相同的迭代次数，输出按墙钟时间计算的总吞吐。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:30:22 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+#include "ipcs_common.h"
+#include "ipcs_server.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define MICROBENCH_MAX_THREADS      8
+#define MICROBENCH_MAX_ITERS        (1ULL << 32)
+#define MICROBENCH_FAKE_FD_BASE     100000
+#define MICROBENCH_HEADER_LEN       offsetof(IPCS_Message, msgValue)
+
+typedef void (*MicrobenchFunc)(uint64_t iters, int arg);
+
+typedef struct {
+    const char *name;
+    MicrobenchFunc func;
+    int arg;                /* 用例参数：消息长度、帧数或注册表条目数 */
+    int threads;
+    unsigned int itemsPerIter;
+} MicrobenchCase;
+
+typedef struct {
+    MicrobenchFunc func;
+    int arg;
+    uint64_t iters;
+    pthread_barrier_t *barrier;
+} MicrobenchThreadArg;
+
+/******************************************************************************/
+static double g_MinTimeSec = 0.5;
+static const char *g_Filter = NULL;
+
+static char g_Payload[IPCS_MESSAGE_MAX_LEN];
+static char g_Stream[IPCS_MESSAGE_MAX_LEN];
+static char g_RecvBuf[IPCS_MESSAGE_MAX_LEN];
+static volatile unsigned int g_HookCount = 0;
+
+/******************************************************************************/
+static int MicrobenchNoopHook(int fd, IPCS_Message *msg)
+{
+    g_HookCount++;
+
+    return IPCS_OK;
+}
+
+static void BM_MsgToStream(uint64_t iters, int msgLen)
+{
+    IPCS_Message msg;
+    unsigned int bufLen = 0;
+    uint64_t i = 0;
+
+    msg.msgType = 1;
+    msg.msgLen = (unsigned int)msgLen;
+    msg.msgValue = g_Payload;
+
+    for (i = 0; i < iters; i++) {
+        bufLen = sizeof(g_Stream);
+        (void)IPCS_MsgToStream(&msg, g_Stream, &bufLen);
+    }
+
+    return;
+}
+
+static void BM_StreamToMsg(uint64_t iters, int msgLen)
+{
+    IPCS_Message msg;
+    unsigned int bufLen = sizeof(g_Stream);
+    uint64_t i = 0;
+
+    msg.msgType = 1;
+    msg.msgLen = (unsigned int)msgLen;
+    msg.msgValue = g_Payload;
+    (void)IPCS_MsgToStream(&msg, g_Stream, &bufLen);
+
+    for (i = 0; i < iters; i++) {
+        msg.msgLen = sizeof(g_RecvBuf);
+        msg.msgValue = g_RecvBuf;
+        (void)IPCS_StreamToMsg(g_Stream, bufLen, &msg);
+    }
+
+    return;
+}
+
+/* 接收缓冲区中连续打包frames个64字节负载的帧，模拟一次read读到多条消息 */
+static void BM_HandleRecvData(uint64_t iters, int frames)
+{
+    IPCS_ServerThreadArg threadArg;
+    IPCS_ServerListener listener;
+    IPCS_Message msg;
+    unsigned int frameLen = 0;
+    size_t dataLen = 0;
+    uint64_t i = 0;
+    int f = 0;
+
+    (void)memset(&threadArg, 0, sizeof(threadArg));
+    (void)memset(&listener, 0, sizeof(listener));
+    listener.serverHook = MicrobenchNoopHook;
+    threadArg.listeners = &listener;
+
+    msg.msgType = 1;
+    msg.msgLen = 64;
+    msg.msgValue = g_Payload;
+    for (f = 0; f < frames; f++) {
+        frameLen = sizeof(g_Stream) - dataLen;
+        if (IPCS_MsgToStream(&msg, g_Stream + dataLen, &frameLen) != IPCS_OK) {
+            break;
+        }
+        dataLen += frameLen;
+    }
+
+    for (i = 0; i < iters; i++) {
+        (void)IPCS_HandleRecvData(g_Stream, dataLen, IPCS_SERVER, 0, &threadArg);
+    }
+
+    return;
+}
+
+static void BM_CheckMessage(uint64_t iters, int msgLen)
+{
+    IPCS_Message msg;
+    uint64_t i = 0;
+
+    msg.msgType = 1;
+    msg.msgLen = (unsigned int)msgLen;
+    msg.msgValue = g_Payload;
+
+    for (i = 0; i < iters; i++) {
+        (void)IPCS_CheckMessage(&msg);
+    }
+
+    return;
+}
+
+/* 查找最后加入的条目，即线性查找的最坏情况 */
+static void BM_FindItemsInfo(uint64_t iters, int fill)
+{
+    IPCS_ItemInfo itemInfo;
+    uint64_t i = 0;
+
+    for (i = 0; i < iters; i++) {
+        (void)IPCS_FindItemsInfo(IPCS_SYNC_CLIENT, NULL, MICROBENCH_FAKE_FD_BASE + fill - 1, &itemInfo);
+    }
+
+    return;
+}
+
+static void BM_IsItemExist(uint64_t iters, int fill)
+{
+    uint64_t i = 0;
+
+    for (i = 0; i < iters; i++) {
+        (void)IPCS_IsItemExist(IPCS_SYNC_CLIENT, NULL, MICROBENCH_FAKE_FD_BASE + fill - 1);
+    }
+
+    return;
+}
+
+/******************************************************************************/
+static int MicrobenchFillRegistry(int fill)
+{
+    IPCS_ItemInfo info;
+    int result = IPCS_OK;
+    int i = 0;
+
+    for (i = 0; i < fill; i++) {
+        (void)memset(&info, 0, sizeof(info));
+        info.type = IPCS_SYNC_CLIENT;
+        (void)snprintf(info.name, sizeof(info.name), "/tmp/ipcs_microbench_%d", i);
+        info.fd = MICROBENCH_FAKE_FD_BASE + i;
+
+        result = IPCS_AddItemsInfo(&info);
+        if (result != IPCS_OK) {
+            TEST_PRINT("microbench fill registry %d fail: %d", i, result);
+            break;
+        }
+    }
+
+    return result;
+}
+
+static void MicrobenchClearRegistry(int fill)
+{
+    int i = 0;
+
+    for (i = 0; i < fill; i++) {
+        (void)IPCS_DelItemsInfo(IPCS_SYNC_CLIENT, NULL, MICROBENCH_FAKE_FD_BASE + i);
+    }
+
+    return;
+}
+
+static int MicrobenchUsesRegistry(const MicrobenchCase *bench)
+{
+    return (bench->func == BM_FindItemsInfo) || (bench->func == BM_IsItemExist);
+}
+
+/******************************************************************************/
+static void *MicrobenchThreadRun(void *arg)
+{
+    MicrobenchThreadArg *threadArg = (MicrobenchThreadArg *)arg;
+
+    (void)pthread_barrier_wait(threadArg->barrier);
+    threadArg->func(threadArg->iters, threadArg->arg);
+
+    return NULL;
+}
+
+/* 返回墙钟时间（纳秒） */
+static uint64_t MicrobenchRunOnce(const MicrobenchCase *bench, uint64_t iters)
+{
+    MicrobenchThreadArg threadArgs[MICROBENCH_MAX_THREADS];
+    pthread_t threadIds[MICROBENCH_MAX_THREADS];
+    pthread_barrier_t barrier;
+    uint64_t startNs = 0;
+    int i = 0;
+
+    if (bench->threads <= 1) {
+        startNs = BENCH_NowNs();
+        bench->func(iters, bench->arg);
+        return BENCH_NowNs() - startNs;
+    }
+
+    (void)pthread_barrier_init(&barrier, NULL, (unsigned int)bench->threads + 1);
+    for (i = 0; i < bench->threads; i++) {
+        threadArgs[i].func = bench->func;
+        threadArgs[i].arg = bench->arg;
+        threadArgs[i].iters = iters;
+        threadArgs[i].barrier = &barrier;
+        (void)pthread_create(&threadIds[i], NULL, MicrobenchThreadRun, &threadArgs[i]);
+    }
+
+    (void)pthread_barrier_wait(&barrier);
+    startNs = BENCH_NowNs();
+    for (i = 0; i < bench->threads; i++) {
+        (void)pthread_join(threadIds[i], NULL);
+    }
+    startNs = BENCH_NowNs() - startNs;
+    (void)pthread_barrier_destroy(&barrier);
+
+    return startNs;
+}
+
+static void MicrobenchRun(const MicrobenchCase *bench)
+{
+    char fullName[128];
+    uint64_t iters = 1;
+    uint64_t elapsedNs = 0;
+    uint64_t minTimeNs = (uint64_t)(g_MinTimeSec * BENCH_NS_PER_SEC);
+    double totalOps = 0.0;
+
+    (void)snprintf(fullName, sizeof(fullName), "%s/%d/threads:%d", bench->name, bench->arg, bench->threads);
+    if ((g_Filter != NULL) && (strstr(fullName, g_Filter) == NULL)) {
+        return;
+    }
+
+    if (MicrobenchUsesRegistry(bench) && (MicrobenchFillRegistry(bench->arg) != IPCS_OK)) {
+        MicrobenchClearRegistry(bench->arg);
+        return;
+    }
+
+    /* 与Google Benchmark相同的迭代次数估算：按上一次的耗时放大，最多放大10倍 */
+    for (; ; ) {
+        elapsedNs = MicrobenchRunOnce(bench, iters);
+        if ((elapsedNs >= minTimeNs) || (iters >= MICROBENCH_MAX_ITERS)) {
+            break;
+        }
+
+        if (elapsedNs * 10 <= minTimeNs) {
+            iters *= 10;
+        } else {
+            iters = (uint64_t)((double)iters * 1.4 * (double)minTimeNs / (double)elapsedNs) + 1;
+        }
+    }
+
+    if (MicrobenchUsesRegistry(bench)) {
+        MicrobenchClearRegistry(bench->arg);
+    }
+
+    totalOps = (double)iters * (double)bench->threads;
+    BENCH_PRINT("%-40s %12.1f ns %14llu %14.3fM items/s", fullName,
+            (double)elapsedNs * (double)bench->threads / totalOps,
+            (unsigned long long)iters,
+            totalOps * bench->itemsPerIter * 1000.0 / (double)elapsedNs);
+
+    return;
+}
+
+/******************************************************************************/
+static const MicrobenchCase g_Cases[] = {
+    {"BM_MsgToStream",      BM_MsgToStream,     0,      1, 1},
+    {"BM_MsgToStream",      BM_MsgToStream,     64,     1, 1},
+    {"BM_MsgToStream",      BM_MsgToStream,     1024,   1, 1},
+    {"BM_MsgToStream",      BM_MsgToStream,     IPCS_MESSAGE_MAX_LEN - MICROBENCH_HEADER_LEN, 1, 1},
+
+    {"BM_StreamToMsg",      BM_StreamToMsg,     0,      1, 1},
+    {"BM_StreamToMsg",      BM_StreamToMsg,     64,     1, 1},
+    {"BM_StreamToMsg",      BM_StreamToMsg,     1024,   1, 1},
+    {"BM_StreamToMsg",      BM_StreamToMsg,     IPCS_MESSAGE_MAX_LEN - MICROBENCH_HEADER_LEN, 1, 1},
+
+    {"BM_HandleRecvData",   BM_HandleRecvData,  1,      1, 1},
+    {"BM_HandleRecvData",   BM_HandleRecvData,  16,     1, 16},
+    {"BM_HandleRecvData",   BM_HandleRecvData,  256,    1, 256},
+    {"BM_HandleRecvData",   BM_HandleRecvData,  256,    4, 256},
+
+    {"BM_CheckMessage",     BM_CheckMessage,    64,     1, 1},
+
+    {"BM_FindItemsInfo",    BM_FindItemsInfo,   1,      1, 1},
+    {"BM_FindItemsInfo",    BM_FindItemsInfo,   64,     1, 1},
+    {"BM_FindItemsInfo",    BM_FindItemsInfo,   255,    1, 1},
+    {"BM_FindItemsInfo",    BM_FindItemsInfo,   255,    2, 1},
+    {"BM_FindItemsInfo",    BM_FindItemsInfo,   255,    4, 1},
+    {"BM_FindItemsInfo",    BM_FindItemsInfo,   255,    8, 1},
+
+    {"BM_IsItemExist",      BM_IsItemExist,     1,      1, 1},
+    {"BM_IsItemExist",      BM_IsItemExist,     64,     1, 1},
+    {"BM_IsItemExist",      BM_IsItemExist,     255,    1, 1},
+    {"BM_IsItemExist",      BM_IsItemExist,     255,    4, 1},
+};
+
+static void MicrobenchUsage(const char *prog)
+{
+    (void)printf("Usage: %s [-f filter] [-t minTimeSec]\n"
+                 "  -f runs only the cases whose full name contains filter, e.g. -f BM_Find or -f threads:4.\n", prog);
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "f:t:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                g_Filter = optarg;
+                break;
+            case 't':
+                g_MinTimeSec = atof(optarg);
+                break;
+            default:
+                MicrobenchUsage(argv[0]);
+                return -1;
+        }
+    }
+
+    IPCS_EnableLog(0);
+    (void)memset(g_Payload, 'x', sizeof(g_Payload));
+
+    BENCH_PRINT("%-40s %15s %14s %23s", "Benchmark", "Time", "Iterations", "Throughput");
+    BENCH_PRINT("----------------------------------------------------------------------------------------------");
+    for (i = 0; i < sizeof(g_Cases) / sizeof(g_Cases[0]); i++) {
+        MicrobenchRun(&g_Cases[i]);
+    }
+    (void)fflush(NULL);
+
+    return 0;
+}
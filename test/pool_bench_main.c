@@ -0,0 +1,351 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pool_bench_main.c
+ *
+ *    Description:  sync client pool benchmark
+ *
+ *                  进程内创建-s个相同的服务端（副本），回调函数忙等-w微秒模拟处理开销，
+ *                  -c个线程共用一个连接池同步调用。分别在只使用一个服务端（one）、使用所有
+ *                  服务端（all）、第一个服务端慢-x倍（skew）、运行到1/3时销毁第一个服务端、
+ *                  到2/3时重新创建（failover）、服务端偶发停顿-l毫秒（stall）、同样停顿但按95
+ *                  百分位对冲（hedge）六种配置下运行，输出调用速率、失败的调用数、调用时延、
+ *                  每个服务端分到的调用数和对冲的统计。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:41:52 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define POOL_MSG_TYPE           0x504C   /* "PL" */
+#define POOL_MAX_CALLERS        32
+#define POOL_STALL_EVERY        100
+
+typedef struct {
+    const char *name;
+    int single;
+    int skew;
+    int failover;
+    int stall;
+    unsigned int hedgePercentile;
+} POOL_Config;
+
+static const POOL_Config g_Configs[] = {
+    {"one", 1, 0, 0, 0, 0},
+    {"all", 0, 0, 0, 0, 0},
+    {"skew", 0, 1, 0, 0, 0},
+    {"failover", 0, 0, 1, 0, 0},
+    {"stall", 0, 0, 0, 1, 0},
+    {"hedge", 0, 0, 0, 1, 95},
+};
+
+typedef struct {
+    pthread_t tid;
+    unsigned long long calls;
+    unsigned long long fails;
+    int lastError;
+    BENCH_Histogram hist;
+} POOL_Caller;
+
+static double g_DurationSec = 3.0;
+static unsigned int g_Servers = 3;
+static unsigned int g_CallerNum = 6;
+static unsigned int g_ServiceUs = 50;
+static unsigned int g_SlowFactor = 4;
+static unsigned int g_StallMs = 5;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static char g_ServerNames[IPCS_POOL_MAX_SERVERS][32];
+static IPCS_ClientPool *g_Pool = NULL;
+static volatile int g_Stop = 0;
+static unsigned int g_StallCount = 0;
+static POOL_Caller g_CallerArgs[POOL_MAX_CALLERS];
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+static void PoolBusyWait(unsigned int us)
+{
+    uint64_t endNs = BENCH_NowNs() + (uint64_t)us * BENCH_NS_PER_US;
+
+    while (BENCH_NowNs() < endNs) {
+    }
+
+    return;
+}
+
+int PoolServerHook(int fd, IPCS_Message *msg)
+{
+    PoolBusyWait(g_ServiceUs);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+int PoolSlowServerHook(int fd, IPCS_Message *msg)
+{
+    PoolBusyWait(g_ServiceUs * g_SlowFactor);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 所有服务端合计每POOL_STALL_EVERY个调用有一个停顿，模拟偶发的调度延迟、缺页等 */
+int PoolStallServerHook(int fd, IPCS_Message *msg)
+{
+    if (__sync_fetch_and_add(&g_StallCount, 1) % POOL_STALL_EVERY == 0) {
+        (void)usleep(g_StallMs * 1000);
+    }
+    PoolBusyWait(g_ServiceUs);
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static int PoolCreateServer(unsigned int index, const POOL_Config *config)
+{
+    IPCS_ServerAttr attr;
+    int (*hook)(int fd, IPCS_Message *msg) = PoolServerHook;
+    int result = IPCS_OK;
+
+    if (config->skew && (index == 0)) {
+        hook = PoolSlowServerHook;
+    } else if (config->stall) {
+        hook = PoolStallServerHook;
+    }
+
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    result = IPCS_CreateServerEx(g_ServerNames[index], hook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("pool create server %u fail: %d", index, result);
+    }
+
+    return result;
+}
+
+/* 负载中是调用者的序号和调用次数，检查响应与请求一致 */
+static void *PoolCallerThread(void *arg)
+{
+    POOL_Caller *caller = (POOL_Caller *)arg;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned long long req[2];
+    unsigned long long resp[2];
+    uint64_t startNs = 0;
+    int result = IPCS_OK;
+
+    req[0] = (unsigned long long)(caller - g_CallerArgs);
+    req[1] = 0;
+    sendMsg.msgType = POOL_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = req;
+
+    while (!g_Stop) {
+        req[1]++;
+        recvMsg.msgLen = sizeof(resp);
+        recvMsg.msgValue = resp;
+
+        startNs = BENCH_NowNs();
+        result = IPCS_PoolSyncCall(g_Pool, &sendMsg, &recvMsg);
+        if ((result == IPCS_OK) && ((recvMsg.msgLen != sizeof(req)) || (memcmp(req, resp, sizeof(req)) != 0))) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+
+        if (result != IPCS_OK) {
+            caller->fails++;
+            caller->lastError = result;
+            continue;
+        }
+        BENCH_HistRecord(&caller->hist, BENCH_NowNs() - startNs);
+        caller->calls++;
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+static int PoolRun(const POOL_Config *config)
+{
+    const char *names[IPCS_POOL_MAX_SERVERS];
+    IPCS_PoolServerStats stats;
+    IPCS_PoolHedgeStats hedgeStats;
+    IPCS_PoolAttr attr;
+    unsigned long long calls = 0;
+    unsigned long long fails = 0;
+    unsigned int serverNum = config->single ? 1 : g_Servers;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int lastError = IPCS_OK;
+    int result = IPCS_OK;
+
+    for (i = 0; (i < serverNum) && (result == IPCS_OK); i++) {
+        names[i] = g_ServerNames[i];
+        result = PoolCreateServer(i, config);
+    }
+    if (result != IPCS_OK) {
+        serverNum = i - 1;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    IPCS_InitPoolAttr(&attr);
+    attr.retryMs = 100;
+    attr.hedgePercentile = config->hedgePercentile;
+    if (result == IPCS_OK) {
+        result = IPCS_CreateClientPool(names, serverNum, &attr, &g_Pool);
+        if (result != IPCS_OK) {
+            TEST_PRINT("pool create fail: %d", result);
+        }
+    }
+
+    g_Stop = 0;
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (started = 0; (started < g_CallerNum) && (result == IPCS_OK); started++) {
+        (void)memset(&g_CallerArgs[started], 0, sizeof(POOL_Caller));
+        BENCH_HistReset(&g_CallerArgs[started].hist);
+        if (pthread_create(&g_CallerArgs[started].tid, NULL, PoolCallerThread, &g_CallerArgs[started]) != 0) {
+            TEST_PRINT("pool start caller %u fail", started);
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+
+    if (config->failover && (result == IPCS_OK)) {
+        BENCH_SleepUntilNs(startNs + (endNs - startNs) / 3);
+        (void)IPCS_DestroyServer(g_ServerNames[0]);
+        BENCH_SleepUntilNs(startNs + (endNs - startNs) * 2 / 3);
+        result = PoolCreateServer(0, config);
+    }
+    BENCH_SleepUntilNs(endNs);
+
+    g_Stop = 1;
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_CallerArgs[i].tid, NULL);
+        calls += g_CallerArgs[i].calls;
+        fails += g_CallerArgs[i].fails;
+        if (g_CallerArgs[i].lastError != IPCS_OK) {
+            lastError = g_CallerArgs[i].lastError;
+        }
+        BENCH_HistMerge(&g_RttHist, &g_CallerArgs[i].hist);
+    }
+    endNs = BENCH_NowNs();
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s servers=%u callers=%u service=%uus engine=%s", config->name, serverNum, started,
+                g_ServiceUs, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f calls/s  fails=%llu  last_error=%d", (double)calls * BENCH_NS_PER_SEC /
+                (double)(endNs - startNs), fails, lastError);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+        for (i = 0; i < serverNum; i++) {
+            (void)memset(&stats, 0, sizeof(stats));
+            (void)IPCS_GetPoolStats(g_Pool, i, &stats);
+            BENCH_PRINT("  server %u%s: calls=%llu failures=%llu conns=%u", i,
+                    (config->skew && (i == 0)) ? " (slow)" : "", stats.calls, stats.failures, stats.conns);
+        }
+        if (config->hedgePercentile != 0) {
+            (void)memset(&hedgeStats, 0, sizeof(hedgeStats));
+            (void)IPCS_GetPoolHedgeStats(g_Pool, &hedgeStats);
+            BENCH_PRINT("  hedge p%u: delay=%lluus hedges=%llu (%.2f%%) wins=%llu", config->hedgePercentile,
+                    hedgeStats.hedgeDelayUs, hedgeStats.hedges, (hedgeStats.calls != 0) ?
+                    100.0 * (double)hedgeStats.hedges / (double)hedgeStats.calls : 0.0, hedgeStats.hedgeWins);
+        }
+    }
+
+    if (g_Pool != NULL) {
+        (void)IPCS_DestroyClientPool(g_Pool);
+        g_Pool = NULL;
+    }
+    for (i = 0; i < serverNum; i++) {
+        (void)IPCS_DestroyServer(g_ServerNames[i]);
+    }
+
+    /* 故障切换时在途的调用会失败，其他配置不应有失败 */
+    if ((result == IPCS_OK) && !config->failover && (fails != 0)) {
+        result = lastError;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:s:c:w:x:l:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 's':
+                g_Servers = (unsigned int)atoi(optarg);
+                break;
+            case 'c':
+                g_CallerNum = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_ServiceUs = (unsigned int)atoi(optarg);
+                break;
+            case 'x':
+                g_SlowFactor = (unsigned int)atoi(optarg);
+                break;
+            case 'l':
+                g_StallMs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-s servers] [-c callers] [-w serviceUs] [-x slowFactor]\n"
+                             "          [-l stallMs] [-e epoll|uring] [-m one|all|skew|failover|stall|hedge]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_Servers < 2) || (g_Servers > IPCS_POOL_MAX_SERVERS) || (g_CallerNum == 0) ||
+        (g_CallerNum > POOL_MAX_CALLERS)) {
+        (void)printf("servers 2..%d, callers 1..%d\n", IPCS_POOL_MAX_SERVERS, POOL_MAX_CALLERS);
+        return -1;
+    }
+
+    for (i = 0; i < g_Servers; i++) {
+        (void)snprintf(g_ServerNames[i], sizeof(g_ServerNames[i]), "@ipcs_pool_bench_%u", i);
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = PoolRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,324 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  prefork_bench_main.c
+ *
+ *    Description:  prefork multi-process server benchmark
+ *
+ *                  创建多进程服务端，回调函数忙等-w微秒、再等待-l微秒（模拟阻塞的I/O），
+ *                  响应中带上工作进程的pid；-c个线程各用一个同步客户端连接调用。分别在单进程
+ *                  （w1，workers为1即普通服务端）、2个和4个工作进程（w2、w4），以及4个工作进程、
+ *                  运行到一半时一个连接发出使工作进程崩溃的请求（crash）四种配置下运行，输出调用
+ *                  速率、调用时延、每个工作进程分到的连接数和调用数，以及工作进程重新创建的次数。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:24:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define PREFORK_MSG_TYPE        0x5046   /* "PF" */
+#define PREFORK_MAX_CALLERS     32
+#define PREFORK_CRASH           0xDEAD
+
+typedef struct {
+    const char *name;
+    unsigned int workers;
+    int crash;
+} PREFORK_Config;
+
+static const PREFORK_Config g_Configs[] = {
+    {"w1", 1, 0},
+    {"w2", 2, 0},
+    {"w4", 4, 0},
+    {"crash", 4, 1},
+};
+
+typedef struct {
+    pthread_t tid;
+    unsigned long long calls;
+    unsigned long long fails;
+    int lastError;
+    int pid;                    /* 最后一个响应的工作进程 */
+    BENCH_Histogram hist;
+} PREFORK_Caller;
+
+static double g_DurationSec = 2.0;
+static unsigned int g_CallerNum = 8;
+static unsigned int g_BusyUs = 20;
+static unsigned int g_SleepUs = 200;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static volatile int g_Stop = 0;
+static volatile int g_Crash = 0;
+static char g_ServerName[64];
+static PREFORK_Caller g_CallerArgs[PREFORK_MAX_CALLERS];
+static BENCH_Histogram g_RttHist;
+
+/******************************************************************************/
+/* 在工作进程中运行：请求为PREFORK_CRASH时被杀死（模拟崩溃，不产生core文件），否则响应[请求, pid] */
+int PreforkServerHook(int fd, IPCS_Message *msg)
+{
+    unsigned int resp[2];
+    IPCS_Message respMsg;
+    uint64_t endNs = BENCH_NowNs() + (uint64_t)g_BusyUs * BENCH_NS_PER_US;
+
+    (void)memset(resp, 0, sizeof(resp));
+    if (msg->msgLen >= sizeof(resp[0])) {
+        (void)memcpy(&resp[0], msg->msgValue, sizeof(resp[0]));
+    }
+    if (resp[0] == PREFORK_CRASH) {
+        (void)kill(getpid(), SIGKILL);
+    }
+
+    while (BENCH_NowNs() < endNs) {
+    }
+    if (g_SleepUs != 0) {
+        (void)usleep(g_SleepUs);
+    }
+
+    resp[1] = (unsigned int)getpid();
+    respMsg.msgType = msg->msgType;
+    respMsg.msgLen = sizeof(resp);
+    respMsg.msgValue = resp;
+
+    return IPCS_ServerSendMessage(fd, &respMsg);
+}
+
+/* 连接断开（工作进程崩溃）时重新连接，由另一个工作进程接受 */
+static void *PreforkCallerThread(void *arg)
+{
+    PREFORK_Caller *caller = (PREFORK_Caller *)arg;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned int req = 0;
+    unsigned int resp[2];
+    uint64_t startNs = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    sendMsg.msgType = PREFORK_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = &req;
+
+    while (!g_Stop) {
+        if (fd < 0) {
+            result = IPCS_CreateSyncClient(NULL, g_ServerName, &fd);
+            if (result != IPCS_OK) {
+                caller->fails++;
+                caller->lastError = result;
+                (void)usleep(1000);
+                continue;
+            }
+        }
+
+        req = (unsigned int)(caller->calls & 0xFFFF);
+        if ((caller == &g_CallerArgs[0]) && g_Crash) {
+            g_Crash = 0;
+            req = PREFORK_CRASH;
+        }
+        recvMsg.msgLen = sizeof(resp);
+        recvMsg.msgValue = resp;
+
+        startNs = BENCH_NowNs();
+        result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+        if ((result == IPCS_OK) && ((recvMsg.msgLen != sizeof(resp)) || (resp[0] != req))) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+
+        if (result != IPCS_OK) {
+            caller->fails++;
+            caller->lastError = result;
+            (void)IPCS_DestroyClient(fd);
+            fd = -1;
+            continue;
+        }
+        BENCH_HistRecord(&caller->hist, BENCH_NowNs() - startNs);
+        caller->calls++;
+        caller->pid = (int)resp[1];
+    }
+
+    if (fd >= 0) {
+        (void)IPCS_DestroyClient(fd);
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+static void PreforkPrintWorkers(const IPCS_WorkerStats *workers)
+{
+    unsigned int conns = 0;
+    unsigned long long calls = 0;
+    unsigned int i = 0;
+    unsigned int j = 0;
+
+    for (i = 0; i < workers->workers; i++) {
+        conns = 0;
+        calls = 0;
+        for (j = 0; j < g_CallerNum; j++) {
+            if (g_CallerArgs[j].pid == workers->pids[i]) {
+                conns++;
+                calls += g_CallerArgs[j].calls;
+            }
+        }
+        BENCH_PRINT("  worker %u pid=%d: conns=%u calls=%llu", i, workers->pids[i], conns, calls);
+    }
+
+    return;
+}
+
+static int PreforkRun(const PREFORK_Config *config)
+{
+    IPCS_ServerAttr attr;
+    IPCS_WorkerStats workers;
+    unsigned long long calls = 0;
+    unsigned long long fails = 0;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int lastError = IPCS_OK;
+    int result = IPCS_OK;
+
+    /* 每种配置用不同的名字，销毁后内核释放监听地址可能稍有延迟 */
+    (void)snprintf(g_ServerName, sizeof(g_ServerName), "@ipcs_prefork_bench_%s", config->name);
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    attr.workers = config->workers;
+    result = IPCS_CreateServerEx(g_ServerName, PreforkServerHook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("prefork create server fail: %d", result);
+        return result;
+    }
+    /* 工作进程由监视线程异步创建 */
+    (void)usleep(100 * 1000);
+
+    g_Stop = 0;
+    g_Crash = 0;
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (started = 0; started < g_CallerNum; started++) {
+        (void)memset(&g_CallerArgs[started], 0, sizeof(PREFORK_Caller));
+        BENCH_HistReset(&g_CallerArgs[started].hist);
+        if (pthread_create(&g_CallerArgs[started].tid, NULL, PreforkCallerThread, &g_CallerArgs[started]) != 0) {
+            TEST_PRINT("prefork start caller %u fail", started);
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+
+    if (config->crash) {
+        BENCH_SleepUntilNs(startNs + (endNs - startNs) / 2);
+        g_Crash = 1;
+    }
+    BENCH_SleepUntilNs(endNs);
+
+    g_Stop = 1;
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_CallerArgs[i].tid, NULL);
+        calls += g_CallerArgs[i].calls;
+        fails += g_CallerArgs[i].fails;
+        if (g_CallerArgs[i].lastError != IPCS_OK) {
+            lastError = g_CallerArgs[i].lastError;
+        }
+        BENCH_HistMerge(&g_RttHist, &g_CallerArgs[i].hist);
+    }
+    endNs = BENCH_NowNs();
+
+    (void)memset(&workers, 0, sizeof(workers));
+    (void)IPCS_GetServerWorkers(g_ServerName, &workers);
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-8s workers=%u callers=%u busy=%uus sleep=%uus engine=%s", config->name, config->workers,
+                started, g_BusyUs, g_SleepUs, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f calls/s  fails=%llu  last_error=%d  restarts=%llu", (double)calls * BENCH_NS_PER_SEC /
+                (double)(endNs - startNs), fails, lastError, workers.restarts);
+        BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+        PreforkPrintWorkers(&workers);
+    }
+
+    (void)IPCS_DestroyServer(g_ServerName);
+
+    /* 崩溃时只有该工作进程上的连接各失败一次，重新连接到其他工作进程，崩溃的工作进程被重新创建 */
+    if ((result == IPCS_OK) && config->crash && ((fails == 0) || (fails > started) || (workers.restarts != 1))) {
+        TEST_PRINT("prefork crash: fails=%llu restarts=%llu", fails, workers.restarts);
+        result = IPCS_PEER_CLOSED;
+    }
+    if ((result == IPCS_OK) && !config->crash && (fails != 0)) {
+        result = lastError;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:w:l:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_CallerNum = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_BusyUs = (unsigned int)atoi(optarg);
+                break;
+            case 'l':
+                g_SleepUs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c callers] [-w busyUs] [-l sleepUs] [-e epoll|uring]\n"
+                             "          [-m w1|w2|w4|crash]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_CallerNum == 0) || (g_CallerNum > PREFORK_MAX_CALLERS)) {
+        (void)printf("callers 1..%d\n", PREFORK_MAX_CALLERS);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = PreforkRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,226 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  prio_bench_main.c
+ *
+ *    Description:  priority lane benchmark
+ *
+ *                  一个异步客户端在同一个连接上保持大量未完成的批量请求，服务端处理每个
+ *                  批量请求时忙等一段时间，使服务端处于饱和状态；主线程每隔一段时间在同一个
+ *                  连接上发送一次健康检查。分别在健康检查为普通优先级和高优先级时运行，
+ *                  比较健康检查的往返时延。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:12:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define PRIO_BULK_TYPE          0x424B   /* "BK" */
+#define PRIO_HEALTH_TYPE        0x4843   /* "HC" */
+#define PRIO_SERVER_NAME        "@ipcs_prio_bench"
+
+static double g_DurationSec = 3.0;
+static unsigned int g_Window = 128;
+static unsigned int g_PayloadLen = 256;
+static unsigned int g_BusyUs = 5;
+static unsigned int g_IntervalMs = 2;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+
+static int g_ClientFd = -1;
+static volatile int g_Stopping = 0;
+static unsigned long long g_BulkReceived = 0;
+static BENCH_Histogram g_HealthHist;
+
+/******************************************************************************/
+int PrioServerHook(int fd, IPCS_Message *msg)
+{
+    uint64_t endNs = 0;
+
+    /* 模拟批量请求的处理耗时 */
+    if (msg->msgType == PRIO_BULK_TYPE) {
+        endNs = BENCH_NowNs() + (uint64_t)g_BusyUs * BENCH_NS_PER_US;
+        while (BENCH_NowNs() < endNs) {
+        }
+    }
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+static int PrioSendBulk(void)
+{
+    char payload[IPCS_MESSAGE_MAX_LEN];
+    IPCS_Message sendMsg;
+
+    (void)memset(payload, 0, g_PayloadLen);
+    sendMsg.msgType = PRIO_BULK_TYPE;
+    sendMsg.msgLen = g_PayloadLen;
+    sendMsg.msgValue = payload;
+
+    return IPCS_ClientAsynCall(g_ClientFd, &sendMsg);
+}
+
+/* 健康检查的负载为发送时间 */
+static int PrioSendHealth(void)
+{
+    uint64_t sendNs = BENCH_NowNs();
+    IPCS_Message sendMsg;
+
+    sendMsg.msgType = PRIO_HEALTH_TYPE;
+    sendMsg.msgLen = sizeof(sendNs);
+    sendMsg.msgValue = &sendNs;
+
+    return IPCS_ClientAsynCall(g_ClientFd, &sendMsg);
+}
+
+int PrioClientHook(IPCS_Message *msg)
+{
+    uint64_t sendNs = 0;
+
+    if ((msg->msgType == PRIO_HEALTH_TYPE) && (msg->msgLen == sizeof(sendNs))) {
+        (void)memcpy(&sendNs, msg->msgValue, sizeof(sendNs));
+        BENCH_HistRecord(&g_HealthHist, BENCH_NowNs() - sendNs);
+        return IPCS_OK;
+    }
+
+    g_BulkReceived++;
+    if (!g_Stopping) {
+        (void)PrioSendBulk();
+    }
+
+    return IPCS_OK;
+}
+
+static int PrioRun(IPCS_Priority healthPrio)
+{
+    IPCS_ServerAttr serverAttr;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t nextNs = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    result = IPCS_SetMsgPriority(PRIO_HEALTH_TYPE, healthPrio);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    result = IPCS_CreateServerEx(PRIO_SERVER_NAME, PrioServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("prio create server fail: %d", result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    g_Stopping = 0;
+    g_BulkReceived = 0;
+    BENCH_HistReset(&g_HealthHist);
+
+    result = IPCS_CreateAsynClient(NULL, PRIO_SERVER_NAME, PrioClientHook, &g_ClientFd);
+    if (result != IPCS_OK) {
+        TEST_PRINT("prio create client fail: %d", result);
+        (void)IPCS_DestroyServer(PRIO_SERVER_NAME);
+        return result;
+    }
+
+    for (i = 0; (i < g_Window) && (result == IPCS_OK); i++) {
+        result = PrioSendBulk();
+    }
+
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    nextNs = startNs;
+    while ((result == IPCS_OK) && (nextNs < endNs)) {
+        nextNs += (uint64_t)g_IntervalMs * BENCH_NS_PER_MS;
+        BENCH_SleepUntilNs(nextNs);
+        result = PrioSendHealth();
+    }
+
+    g_Stopping = 1;
+    /* 等待未完成的请求处理完 */
+    (void)usleep(200 * 1000);
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("health=%s engine=%s window=%u payload=%u busy=%uus",
+                (healthPrio == IPCS_PRIO_HIGH) ? "high" : "normal",
+                (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll", g_Window, g_PayloadLen, g_BusyUs);
+        BENCH_PRINT("  bulk=%.0f msgs/s", (double)g_BulkReceived * BENCH_NS_PER_SEC / (double)(BENCH_NowNs() - startNs));
+        BENCH_HistPrintSummary(&g_HealthHist, "  health rtt");
+    } else {
+        TEST_PRINT("prio send fail: %d", result);
+    }
+
+    (void)IPCS_DestroyClient(g_ClientFd);
+    (void)IPCS_DestroyServer(PRIO_SERVER_NAME);
+    (void)IPCS_SetMsgPriority(PRIO_HEALTH_TYPE, IPCS_PRIO_NORMAL);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:w:s:b:i:e:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'w':
+                g_Window = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_PayloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'b':
+                g_BusyUs = (unsigned int)atoi(optarg);
+                break;
+            case 'i':
+                g_IntervalMs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-w bulkWindow] [-s bulkPayload] [-b busyUsPerBulk]\n"
+                             "          [-i healthIntervalMs] [-e epoll|uring]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_Window == 0) || (g_PayloadLen == 0) || (g_PayloadLen > IPCS_MESSAGE_MAX_LEN) || (g_IntervalMs == 0)) {
+        (void)printf("window > 0, payload 1..%d, interval > 0\n", IPCS_MESSAGE_MAX_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    result = PrioRun(IPCS_PRIO_NORMAL);
+    if (result == IPCS_OK) {
+        result = PrioRun(IPCS_PRIO_HIGH);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
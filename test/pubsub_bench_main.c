@@ -0,0 +1,234 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  pubsub_bench_main.c
+ *
+ *    Description:  publish/subscribe fan-out benchmark
+ *
+ *                  启动一个服务端和若干订阅同一主题的异步客户端，发布线程全速调用
+ *                  IPCS_ServerPublish，输出发布速率、投递速率，以及慢订阅者
+ *                  （回调函数中睡眠）被丢弃或合并的消息数。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 07:05:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define PUBSUB_TOPIC            0x5053   /* "PS" */
+#define PUBSUB_MAX_CLIENTS      200
+#define PUBSUB_SERVER_NAME      "@ipcs_pubsub_bench"
+
+static double g_DurationSec = 3.0;
+static unsigned int g_ClientNum = 100;
+static unsigned int g_SlowNum = 0;
+static unsigned int g_SlowUs = 1000;
+static unsigned int g_PayloadLen = 1024;
+static unsigned int g_Rate = 0;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static IPCS_PubPolicy g_Policy = IPCS_PUB_DROP_NEWEST;
+
+static int g_ClientFds[PUBSUB_MAX_CLIENTS];
+static unsigned long long g_Delivered = 0;
+static unsigned long long g_SlowDelivered = 0;
+
+/******************************************************************************/
+int PubsubServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+int PubsubClientHook(IPCS_Message *msg)
+{
+    (void)__atomic_add_fetch(&g_Delivered, 1, __ATOMIC_RELAXED);
+
+    return IPCS_OK;
+}
+
+int PubsubSlowClientHook(IPCS_Message *msg)
+{
+    (void)__atomic_add_fetch(&g_SlowDelivered, 1, __ATOMIC_RELAXED);
+    (void)usleep(g_SlowUs);
+
+    return IPCS_OK;
+}
+
+static int PubsubRun(void)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_ServerStats stats;
+    IPCS_Message msg;
+    char *payload = NULL;
+    unsigned long long published = 0;
+    unsigned long long missed = 0;
+    unsigned long long slowMissed = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t elapsedNs = 0;
+    unsigned int created = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    payload = (char *)calloc(1, g_PayloadLen);
+    if (payload == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.pubPolicy = g_Policy;
+    result = IPCS_CreateServerEx(PUBSUB_SERVER_NAME, PubsubServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("pubsub create server fail: %d", result);
+        free(payload);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    for (created = 0; created < g_ClientNum; created++) {
+        result = IPCS_CreateAsynClient(NULL, PUBSUB_SERVER_NAME,
+                (created < g_SlowNum) ? PubsubSlowClientHook : PubsubClientHook, &g_ClientFds[created]);
+        if (result == IPCS_OK) {
+            result = IPCS_ClientSubscribe(g_ClientFds[created], PUBSUB_TOPIC);
+        }
+        if (result != IPCS_OK) {
+            TEST_PRINT("pubsub create subscriber %u fail: %d", created, result);
+            break;
+        }
+    }
+    /* 等待服务端处理完订阅 */
+    (void)usleep(100 * 1000);
+
+    if (result == IPCS_OK) {
+        msg.msgType = PUBSUB_TOPIC;
+        msg.msgLen = g_PayloadLen;
+        msg.msgValue = payload;
+
+        startNs = BENCH_NowNs();
+        endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+        while (BENCH_NowNs() < endNs) {
+            result = IPCS_ServerPublish(PUBSUB_SERVER_NAME, &msg);
+            if (result != IPCS_OK) {
+                TEST_PRINT("pubsub publish fail: %d", result);
+                break;
+            }
+            published++;
+
+            /* 限速时按发布速率等待；全速发布时每批发布后让出CPU，避免发布线程把消息全部积压在服务端 */
+            if (g_Rate != 0) {
+                while (BENCH_NowNs() < startNs + published * BENCH_NS_PER_SEC / g_Rate) {
+                    (void)usleep(50);
+                }
+            } else if ((published % 64) == 0) {
+                (void)usleep(0);
+            }
+        }
+
+        /* 等待服务端和订阅者处理完积压的消息 */
+        (void)usleep(500 * 1000);
+        elapsedNs = BENCH_NowNs() - startNs;
+
+        /* 每个订阅者都应收到所有发布的消息，少收的按普通和慢订阅者分开统计；
+         * 服务端的drops不区分订阅者，全速发布超过普通订阅者的处理能力时普通订阅者也会丢弃 */
+        missed = published * (g_ClientNum - g_SlowNum) - g_Delivered;
+        slowMissed = published * g_SlowNum - g_SlowDelivered;
+
+        (void)IPCS_GetServerStats(PUBSUB_SERVER_NAME, &stats);
+        BENCH_PRINT("engine=%s policy=%s subscribers=%u slow=%u payload=%u rate=%u",
+                (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll",
+                (g_Policy == IPCS_PUB_CONFLATE) ? "conflate" : "drop", g_ClientNum, g_SlowNum, g_PayloadLen, g_Rate);
+        BENCH_PRINT("  published=%llu (%.0f/s) fanned_out=%llu delivered=%llu (%.0f/s) slow_delivered=%llu",
+                published, (double)published * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                stats.publishes, g_Delivered, (double)g_Delivered * BENCH_NS_PER_SEC / (double)elapsedNs,
+                g_SlowDelivered);
+        BENCH_PRINT("  missed=%llu (%.2f%%) slow_missed=%llu (%.2f%%) drops=%llu wakeups=%llu "
+                "server_syscalls/delivery=%.3f",
+                missed, (g_ClientNum == g_SlowNum) ? 0.0 :
+                100.0 * (double)missed / (double)(published * (g_ClientNum - g_SlowNum)),
+                slowMissed, (g_SlowNum == 0) ? 0.0 : 100.0 * (double)slowMissed / (double)(published * g_SlowNum),
+                stats.pubDrops, stats.wakeups,
+                (g_Delivered + g_SlowDelivered == 0) ? 0.0 :
+                (double)stats.syscalls / (double)(g_Delivered + g_SlowDelivered));
+    }
+
+    for (i = 0; i < created; i++) {
+        (void)IPCS_DestroyClient(g_ClientFds[i]);
+    }
+
+    (void)IPCS_DestroyServer(PUBSUB_SERVER_NAME);
+    free(payload);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:k:u:s:r:e:p:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_ClientNum = (unsigned int)atoi(optarg);
+                break;
+            case 'k':
+                g_SlowNum = (unsigned int)atoi(optarg);
+                break;
+            case 'u':
+                g_SlowUs = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_PayloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'r':
+                g_Rate = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'p':
+                g_Policy = (strcmp(optarg, "conflate") == 0) ? IPCS_PUB_CONFLATE : IPCS_PUB_DROP_NEWEST;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c subscribers] [-k slowSubscribers] [-u slowHookUs]\n"
+                             "          [-s payload] [-r publishesPerSec] [-e epoll|uring] [-p drop|conflate]\n",
+                             argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_ClientNum == 0) || (g_ClientNum > PUBSUB_MAX_CLIENTS) || (g_SlowNum > g_ClientNum) ||
+        (g_PayloadLen == 0) || (g_PayloadLen > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("subscribers must be 1..%d, slow <= subscribers, payload 1..%d\n", PUBSUB_MAX_CLIENTS,
+                IPCS_MESSAGE_MAX_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    result = PubsubRun();
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,270 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  reactor_bench_main.c
+ *
+ *    Description:  shared reactor benchmark
+ *
+ *                  创建若干服务端，第一个服务端上有若干保持固定窗口的异步客户端（忙），
+ *                  其余服务端各有一个不发送请求的客户端（闲）。分别在每个服务端独立线程
+ *                  和所有服务端共用一个反应器时运行，输出服务端线程数、忙服务端的吞吐量
+ *                  和唤醒次数；运行到一半时销毁闲服务端，验证共用线程的服务端不受影响。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:26:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define REACTOR_MSG_TYPE        0x5243   /* "RC" */
+#define REACTOR_MAX_SERVERS     64
+#define REACTOR_MAX_CLIENTS     64
+#define REACTOR_SHARED_ID       1
+
+static double g_DurationSec = 3.0;
+static unsigned int g_ServerNum = 8;
+static unsigned int g_ClientNum = 4;
+static unsigned int g_Window = 16;
+static unsigned int g_PayloadLen = 64;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+
+static char g_ServerNames[REACTOR_MAX_SERVERS][64];
+static int g_BusyFds[REACTOR_MAX_CLIENTS];
+static int g_IdleFds[REACTOR_MAX_SERVERS];
+static volatile int g_Stopping = 0;
+static unsigned long long g_Received = 0;
+
+/******************************************************************************/
+int ReactorServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 负载的前4个字节为忙客户端序号 */
+static int ReactorSend(unsigned int index)
+{
+    char payload[IPCS_MESSAGE_MAX_LEN];
+    IPCS_Message sendMsg;
+
+    (void)memset(payload, 0, g_PayloadLen);
+    (void)memcpy(payload, &index, sizeof(index));
+
+    sendMsg.msgType = REACTOR_MSG_TYPE;
+    sendMsg.msgLen = g_PayloadLen;
+    sendMsg.msgValue = payload;
+
+    return IPCS_ClientAsynCall(g_BusyFds[index], &sendMsg);
+}
+
+/* 收到响应后在同一个连接上发送下一个请求 */
+int ReactorClientHook(IPCS_Message *msg)
+{
+    unsigned int index = 0;
+
+    (void)__atomic_add_fetch(&g_Received, 1, __ATOMIC_RELAXED);
+
+    if (g_Stopping || (msg->msgLen < sizeof(index))) {
+        return IPCS_OK;
+    }
+
+    (void)memcpy(&index, msg->msgValue, sizeof(index));
+    if (index < g_ClientNum) {
+        (void)ReactorSend(index);
+    }
+
+    return IPCS_OK;
+}
+
+int ReactorIdleHook(IPCS_Message *msg)
+{
+    return IPCS_OK;
+}
+
+/* 进程当前的线程数 */
+static unsigned int ReactorThreadNum(void)
+{
+    char line[256];
+    unsigned int num = 0;
+    FILE *file = fopen("/proc/self/status", "r");
+
+    if (file == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "Threads: %u", &num) == 1) {
+            break;
+        }
+    }
+    (void)fclose(file);
+
+    return num;
+}
+
+static int ReactorRun(unsigned int reactor)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_ServerStats stats;
+    unsigned long long wakeups = 0;
+    unsigned long long received = 0;
+    unsigned int threadsBefore = 0;
+    unsigned int serverThreads = 0;
+    unsigned int servers = 0;
+    unsigned int busy = 0;
+    unsigned int idle = 0;
+    uint64_t startNs = 0;
+    uint64_t midNs = 0;
+    uint64_t endNs = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+
+    g_Stopping = 0;
+    g_Received = 0;
+    threadsBefore = ReactorThreadNum();
+
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.reactor = reactor;
+    for (servers = 0; servers < g_ServerNum; servers++) {
+        (void)snprintf(g_ServerNames[servers], sizeof(g_ServerNames[servers]), "@ipcs_reactor_bench_%u", servers);
+        result = IPCS_CreateServerEx(g_ServerNames[servers], ReactorServerHook, &serverAttr);
+        if (result != IPCS_OK) {
+            TEST_PRINT("reactor create server %u fail: %d", servers, result);
+            break;
+        }
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+    serverThreads = ReactorThreadNum() - threadsBefore;
+
+    for (busy = 0; (result == IPCS_OK) && (busy < g_ClientNum); busy++) {
+        result = IPCS_CreateAsynClient(NULL, g_ServerNames[0], ReactorClientHook, &g_BusyFds[busy]);
+        if (result != IPCS_OK) {
+            TEST_PRINT("reactor create busy client %u fail: %d", busy, result);
+            break;
+        }
+    }
+    for (idle = 1; (result == IPCS_OK) && (idle < g_ServerNum); idle++) {
+        result = IPCS_CreateAsynClient(NULL, g_ServerNames[idle], ReactorIdleHook, &g_IdleFds[idle]);
+        if (result != IPCS_OK) {
+            TEST_PRINT("reactor create idle client %u fail: %d", idle, result);
+            break;
+        }
+    }
+
+    if (result == IPCS_OK) {
+        for (i = 0; (i < g_ClientNum * g_Window) && (result == IPCS_OK); i++) {
+            result = ReactorSend(i % g_ClientNum);
+        }
+
+        startNs = BENCH_NowNs();
+        midNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC / 2);
+        endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+        BENCH_SleepUntilNs(midNs);
+
+        /* 运行中销毁闲服务端，忙服务端的请求不应中断 */
+        received = __atomic_load_n(&g_Received, __ATOMIC_RELAXED);
+        for (i = 1; i < g_ServerNum; i++) {
+            (void)IPCS_DestroyServer(g_ServerNames[i]);
+        }
+
+        BENCH_SleepUntilNs(endNs);
+        g_Stopping = 1;
+        received = __atomic_load_n(&g_Received, __ATOMIC_RELAXED) - received;
+
+        if (IPCS_GetServerStats(g_ServerNames[0], &stats) == IPCS_OK) {
+            wakeups = stats.wakeups;
+        }
+
+        BENCH_PRINT("%-9s servers=%u server_threads=%u clients=%u window=%u payload=%u engine=%s",
+                (reactor == 0) ? "dedicated" : "shared", g_ServerNum, serverThreads, g_ClientNum, g_Window,
+                g_PayloadLen, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  %.0f msgs/s (%.0f msgs/s after idle servers destroyed) wakeups/msg=%.3f",
+                (double)g_Received * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                (double)received * BENCH_NS_PER_SEC / (double)(endNs - midNs),
+                (g_Received == 0) ? 0.0 : (double)wakeups / (double)g_Received);
+
+        /* 等待未完成的请求处理完 */
+        (void)usleep(100 * 1000);
+    }
+
+    for (i = 0; i < busy; i++) {
+        (void)IPCS_DestroyClient(g_BusyFds[i]);
+    }
+    for (i = 1; i < idle; i++) {
+        (void)IPCS_DestroyClient(g_IdleFds[i]);
+    }
+    for (i = 0; i < servers; i++) {
+        (void)IPCS_DestroyServer(g_ServerNames[i]);
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:n:c:w:s:e:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'n':
+                g_ServerNum = (unsigned int)atoi(optarg);
+                break;
+            case 'c':
+                g_ClientNum = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_Window = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_PayloadLen = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-n servers] [-c busyClients] [-w window] [-s payload]\n"
+                             "          [-e epoll|uring]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_ServerNum == 0) || (g_ServerNum > REACTOR_MAX_SERVERS) || (g_ClientNum == 0) ||
+        (g_ClientNum > REACTOR_MAX_CLIENTS) || (g_Window == 0) || (g_PayloadLen < sizeof(unsigned int)) ||
+        (g_PayloadLen > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("servers 1..%d, busy clients 1..%d, window > 0, payload 4..%d\n", REACTOR_MAX_SERVERS,
+                REACTOR_MAX_CLIENTS, IPCS_MESSAGE_MAX_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    result = ReactorRun(0);
+    if (result == IPCS_OK) {
+        result = ReactorRun(REACTOR_SHARED_ID);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,390 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  replay_main.c
+ *
+ *    Description:  replay a capture file (IPCS_StartCapture) against a server
+ *
+ *                  回放抓包文件中发往服务端的请求帧：服务端收到的帧（RX + IPCS_SERVER），
+ *                  没有服务端记录时取客户端发出的帧（TX + 客户端）。原始连接按fd映射到回放连接，
+ *                  可以按原始时间间隔回放，也可以全速回放。
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:02:45 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+#include "ipcs_capture.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define REPLAY_SERVER_NAME          "/tmp/ipcs_replay_server"
+#define REPLAY_CLIENT_NAME_FMT      "/tmp/ipcs_replay_client_%d"
+#define REPLAY_MAX_CONN             64
+#define REPLAY_DRAIN_TIMEOUT_NS     (2 * BENCH_NS_PER_SEC)
+
+typedef struct {
+    const char *fileName;
+    const char *serverName;
+    int maxSpeed;
+    int infoOnly;
+    int quiet;
+    int connNum;
+} ReplayConfig;
+
+typedef struct {
+    const char *base;
+    uint64_t begin;
+    uint64_t end;
+} ReplayCapture;
+
+/******************************************************************************/
+static ReplayConfig g_Config;
+static int g_OrigFds[REPLAY_MAX_CONN];
+static int g_ReplayFds[REPLAY_MAX_CONN];
+static int g_UsedConnNum = 0;
+static volatile uint64_t g_Responses = 0;
+
+/* 抓包文件同时包含服务端和客户端的记录时（同一进程内抓包），只回放服务端收到的帧，避免重复 */
+static int g_ReplayServerRx = 1;
+
+/******************************************************************************/
+int ReplayEchoHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+int ReplayAsynHook(IPCS_Message *msg)
+{
+    (void)__atomic_add_fetch(&g_Responses, 1, __ATOMIC_RELAXED);
+
+    return IPCS_OK;
+}
+
+static int ReplayOpenCapture(const char *fileName, ReplayCapture *capture)
+{
+    const IPCS_CaptureFileHeader *header = NULL;
+    struct stat st;
+    void *base = NULL;
+    int fd = -1;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        perror("open capture file");
+        return -1;
+    }
+
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(IPCS_CaptureFileHeader))) {
+        (void)close(fd);
+        TEST_PRINT("bad capture file: %s", fileName);
+        return -1;
+    }
+
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (void)close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap capture file");
+        return -1;
+    }
+
+    header = (const IPCS_CaptureFileHeader *)base;
+    if ((header->magic != IPCS_CAPTURE_MAGIC) || (header->version != IPCS_CAPTURE_VERSION)) {
+        (void)munmap(base, (size_t)st.st_size);
+        TEST_PRINT("not a capture file: %s", fileName);
+        return -1;
+    }
+
+    capture->base = base;
+    capture->begin = (header->headerLen + IPCS_CAPTURE_ALIGN - 1) & ~((uint64_t)IPCS_CAPTURE_ALIGN - 1);
+    capture->end = ((uint64_t)st.st_size < header->writeOffset) ? (uint64_t)st.st_size : header->writeOffset;
+
+    BENCH_PRINT("capture %s: %llu bytes, %llu frames dropped while capturing",
+            fileName, (unsigned long long)capture->end, (unsigned long long)header->droppedFrames);
+
+    return 0;
+}
+
+/* 返回下一条完整记录，没有则返回NULL */
+static const IPCS_CaptureRecord *ReplayNextRecord(const ReplayCapture *capture, uint64_t *offset)
+{
+    const IPCS_CaptureRecord *record = NULL;
+
+    if (*offset + sizeof(IPCS_CaptureRecord) > capture->end) {
+        return NULL;
+    }
+
+    record = (const IPCS_CaptureRecord *)(capture->base + *offset);
+    if ((record->recordLen < sizeof(IPCS_CaptureRecord)) || (*offset + record->recordLen > capture->end)) {
+        return NULL;
+    }
+
+    *offset += record->recordLen;
+
+    return record;
+}
+
+static int ReplayIsRequest(const IPCS_CaptureRecord *record)
+{
+    if (g_ReplayServerRx) {
+        return (record->direction == IPCS_CAPTURE_RX) && (record->itemType == IPCS_SERVER);
+    }
+
+    return (record->direction == IPCS_CAPTURE_TX) && (record->itemType != IPCS_SERVER);
+}
+
+/******************************************************************************/
+static void ReplayPrintInfo(const ReplayCapture *capture)
+{
+    const IPCS_CaptureRecord *record = NULL;
+    uint64_t offset = capture->begin;
+    uint64_t counts[2][3];
+    uint64_t firstNs = 0;
+    uint64_t lastNs = 0;
+    uint64_t total = 0;
+    const char *itemNames[3] = {"server", "sync client", "asyn client"};
+    int dir = 0;
+    int item = 0;
+
+    (void)memset(counts, 0, sizeof(counts));
+
+    while ((record = ReplayNextRecord(capture, &offset)) != NULL) {
+        if ((record->direction <= IPCS_CAPTURE_TX) && (record->itemType <= IPCS_ASYN_CLIENT)) {
+            counts[record->direction][record->itemType]++;
+        }
+
+        if (total == 0) {
+            firstNs = record->timestampNs;
+        }
+        lastNs = record->timestampNs;
+        total++;
+    }
+
+    BENCH_PRINT("%llu frames over %.3fs", (unsigned long long)total, (double)(lastNs - firstNs) / BENCH_NS_PER_SEC);
+    for (dir = IPCS_CAPTURE_RX; dir <= IPCS_CAPTURE_TX; dir++) {
+        for (item = IPCS_SERVER; item <= IPCS_ASYN_CLIENT; item++) {
+            BENCH_PRINT("  %s %-12s %llu", (dir == IPCS_CAPTURE_RX) ? "RX" : "TX", itemNames[item],
+                    (unsigned long long)counts[dir][item]);
+        }
+    }
+
+    g_ReplayServerRx = (counts[IPCS_CAPTURE_RX][IPCS_SERVER] != 0);
+    BENCH_PRINT("requests are taken from %s", g_ReplayServerRx ? "server RX frames" : "client TX frames");
+
+    return;
+}
+
+/* 原始连接按首次出现的顺序映射到回放连接，超过连接数时取模复用 */
+static int ReplayConnFd(int origFd)
+{
+    char clientName[108];
+    int i = 0;
+    int result = 0;
+
+    for (i = 0; i < g_UsedConnNum; i++) {
+        if (g_OrigFds[i] == origFd) {
+            return g_ReplayFds[i];
+        }
+    }
+
+    if (g_UsedConnNum >= g_Config.connNum) {
+        return g_ReplayFds[(unsigned int)origFd % (unsigned int)g_UsedConnNum];
+    }
+
+    (void)snprintf(clientName, sizeof(clientName), REPLAY_CLIENT_NAME_FMT, g_UsedConnNum);
+    result = IPCS_CreateAsynClient(clientName, g_Config.serverName, ReplayAsynHook, &g_ReplayFds[g_UsedConnNum]);
+    if (result != IPCS_OK) {
+        TEST_PRINT("replay create client %s fail: %d", clientName, result);
+        return -1;
+    }
+
+    g_OrigFds[g_UsedConnNum] = origFd;
+
+    return g_ReplayFds[g_UsedConnNum++];
+}
+
+static int ReplayRun(const ReplayCapture *capture)
+{
+    const IPCS_CaptureRecord *record = NULL;
+    uint64_t offset = capture->begin;
+    uint64_t firstNs = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t maxLagNs = 0;
+    uint64_t nowNs = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t drainDeadlineNs = 0;
+    IPCS_Message msg;
+    int fd = 0;
+    int result = IPCS_OK;
+
+    startNs = BENCH_NowNs();
+
+    while ((record = ReplayNextRecord(capture, &offset)) != NULL) {
+        if (!ReplayIsRequest(record)) {
+            continue;
+        }
+
+        if (frames == 0) {
+            firstNs = record->timestampNs;
+        }
+
+        if (!g_Config.maxSpeed) {
+            nowNs = BENCH_NowNs();
+            if (nowNs < startNs + (record->timestampNs - firstNs)) {
+                BENCH_SleepUntilNs(startNs + (record->timestampNs - firstNs));
+            } else if (nowNs - (startNs + (record->timestampNs - firstNs)) > maxLagNs) {
+                maxLagNs = nowNs - (startNs + (record->timestampNs - firstNs));
+            }
+        }
+
+        fd = ReplayConnFd(record->fd);
+        if (fd < 0) {
+            result = IPCS_CONNECT_FAIL;
+            break;
+        }
+
+        msg.msgType = record->msgType;
+        msg.msgLen = record->msgLen;
+        msg.msgValue = (void *)(record + 1);
+        result = IPCS_ClientAsynCall(fd, &msg);
+        if (result != IPCS_OK) {
+            TEST_PRINT("replay asyn call fail: %d, frame: %llu", result, (unsigned long long)frames);
+            break;
+        }
+
+        frames++;
+        bytes += record->msgLen;
+    }
+
+    endNs = BENCH_NowNs();
+    if (endNs == startNs) {
+        endNs++;
+    }
+
+    drainDeadlineNs = BENCH_NowNs() + REPLAY_DRAIN_TIMEOUT_NS;
+    while ((g_Responses < frames) && (BENCH_NowNs() < drainDeadlineNs)) {
+        (void)usleep(1000);
+    }
+
+    BENCH_PRINT("replayed %llu frames (%llu payload bytes) on %d connections in %.3fs: %.0f frames/s, %.2f MB/s",
+            (unsigned long long)frames, (unsigned long long)bytes, g_UsedConnNum,
+            (double)(endNs - startNs) / BENCH_NS_PER_SEC,
+            (double)frames * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+            (double)bytes * BENCH_NS_PER_SEC / (double)(endNs - startNs) / (1024.0 * 1024.0));
+    BENCH_PRINT("responses received: %llu, max schedule lag: %.1fus%s",
+            (unsigned long long)g_Responses, (double)maxLagNs / BENCH_NS_PER_US,
+            g_Config.maxSpeed ? " (max speed)" : "");
+
+    return result;
+}
+
+/******************************************************************************/
+static void ReplayUsage(const char *prog)
+{
+    (void)printf("Usage: %s -f captureFile [-S serverName] [-x] [-c conns] [-i] [-q]\n"
+                 "  Without -S an in-process echo server is started at %s.\n"
+                 "  -x replays at maximum speed instead of the original timing,\n"
+                 "  -i prints a summary of the capture without replaying it.\n", prog, REPLAY_SERVER_NAME);
+
+    return;
+}
+
+static int ReplayParseArgs(int argc, char **argv)
+{
+    int opt = 0;
+
+    (void)memset(&g_Config, 0, sizeof(g_Config));
+    g_Config.connNum = REPLAY_MAX_CONN;
+
+    while ((opt = getopt(argc, argv, "f:S:xc:iqh")) != -1) {
+        switch (opt) {
+            case 'f':
+                g_Config.fileName = optarg;
+                break;
+            case 'S':
+                g_Config.serverName = optarg;
+                break;
+            case 'x':
+                g_Config.maxSpeed = 1;
+                break;
+            case 'c':
+                g_Config.connNum = atoi(optarg);
+                break;
+            case 'i':
+                g_Config.infoOnly = 1;
+                break;
+            case 'q':
+                g_Config.quiet = 1;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    if ((g_Config.fileName == NULL) || (g_Config.connNum <= 0) || (g_Config.connNum > REPLAY_MAX_CONN)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    ReplayCapture capture;
+    int result = 0;
+    int i = 0;
+
+    if (ReplayParseArgs(argc, argv) != 0) {
+        ReplayUsage(argv[0]);
+        return -1;
+    }
+
+    IPCS_EnableLog(!g_Config.quiet);
+
+    if (ReplayOpenCapture(g_Config.fileName, &capture) != 0) {
+        return -1;
+    }
+
+    ReplayPrintInfo(&capture);
+    if (g_Config.infoOnly) {
+        return 0;
+    }
+
+    if (g_Config.serverName == NULL) {
+        g_Config.serverName = REPLAY_SERVER_NAME;
+        result = IPCS_CreateServer(g_Config.serverName, ReplayEchoHook);
+        if (result != IPCS_OK) {
+            TEST_PRINT("replay create echo server fail: %d", result);
+            return result;
+        }
+        /* 服务端线程异步完成bind/listen */
+        (void)usleep(100 * 1000);
+    }
+
+    result = ReplayRun(&capture);
+
+    for (i = 0; i < g_UsedConnNum; i++) {
+        (void)IPCS_DestroyClient(g_ReplayFds[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
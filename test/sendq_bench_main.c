@@ -0,0 +1,312 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  sendq_bench_main.c
+ *
+ *    Description:  concurrent asyn client send benchmark
+ *
+ *                  -c个线程共用一个异步客户端，各自不停地发出-s字节的异步调用（不需要响应），
+ *                  分两种配置运行：mutex中调用方用一个互斥锁串行化调用（以前多线程共用客户端
+ *                  时的做法），combine中直接并发调用，由客户端合并发送。服务端检查每个消息的
+ *                  长度、内容和每个线程的序号，输出发送速率、服务端收到的消息数和损坏的消息数。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:21:08 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define SENDQ_MSG_TYPE          0x5351   /* "SQ" */
+#define SENDQ_MAX_SENDERS       32
+#define SENDQ_HEAD_LEN          (2 * sizeof(unsigned int))
+#define SENDQ_DRAIN_MS          2000
+
+typedef struct {
+    const char *name;
+    int useMutex;
+} SENDQ_Config;
+
+static const SENDQ_Config g_Configs[] = {
+    {"mutex", 1},
+    {"combine", 0},
+};
+
+typedef struct {
+    pthread_t tid;
+    unsigned int id;
+    unsigned long long sends;
+    int lastError;
+} SENDQ_Sender;
+
+static double g_DurationSec = 2.0;
+static unsigned int g_SenderNum = 4;
+static unsigned int g_MsgLen = 64;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static char g_ServerName[64];
+static int g_ClientFd = -1;
+static int g_UseMutex = 0;
+static pthread_mutex_t g_SendMutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int g_Stop = 0;
+static SENDQ_Sender g_Senders[SENDQ_MAX_SENDERS];
+
+/* 服务端线程写，主线程在发送结束后读 */
+static unsigned long long g_Received = 0;
+static unsigned long long g_BadMsgs = 0;
+static unsigned int g_NextSeq[SENDQ_MAX_SENDERS];
+
+/******************************************************************************/
+/* 消息内容：发送线程id + 序号 + 由二者决定的填充字节 */
+static unsigned char SendqFillByte(unsigned int id, unsigned int seq)
+{
+    return (unsigned char)((id * 31 + seq) & 0xFF);
+}
+
+static int SendqCheckMsg(const IPCS_Message *msg)
+{
+    const unsigned char *value = (const unsigned char *)msg->msgValue;
+    unsigned char fill = 0;
+    unsigned int id = 0;
+    unsigned int seq = 0;
+    unsigned int i = 0;
+
+    if ((msg->msgType != SENDQ_MSG_TYPE) || (msg->msgLen != g_MsgLen)) {
+        return 0;
+    }
+
+    (void)memcpy(&id, value, sizeof(id));
+    (void)memcpy(&seq, value + sizeof(id), sizeof(seq));
+    if ((id >= SENDQ_MAX_SENDERS) || (seq != g_NextSeq[id])) {
+        return 0;
+    }
+    g_NextSeq[id] = seq + 1;
+
+    fill = SendqFillByte(id, seq);
+    for (i = SENDQ_HEAD_LEN; i < msg->msgLen; i++) {
+        if (value[i] != fill) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int SendqServerHook(int fd, IPCS_Message *msg)
+{
+    (void)fd;
+
+    if (!SendqCheckMsg(msg)) {
+        __atomic_add_fetch(&g_BadMsgs, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&g_Received, 1, __ATOMIC_RELAXED);
+
+    return IPCS_OK;
+}
+
+int SendqClientHook(IPCS_Message *msg)
+{
+    (void)msg;
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+static void *SendqSenderThread(void *arg)
+{
+    SENDQ_Sender *sender = (SENDQ_Sender *)arg;
+    IPCS_Message sendMsg;
+    unsigned char *value = NULL;
+    unsigned int seq = 0;
+    int result = IPCS_OK;
+
+    value = (unsigned char *)malloc(g_MsgLen);
+    if (value == NULL) {
+        sender->lastError = IPCS_MALLOC_FAIL;
+        return NULL;
+    }
+
+    sendMsg.msgType = SENDQ_MSG_TYPE;
+    sendMsg.msgLen = g_MsgLen;
+    sendMsg.msgValue = value;
+
+    while (!g_Stop) {
+        (void)memcpy(value, &sender->id, sizeof(sender->id));
+        (void)memcpy(value + sizeof(sender->id), &seq, sizeof(seq));
+        (void)memset(value + SENDQ_HEAD_LEN, SendqFillByte(sender->id, seq), g_MsgLen - SENDQ_HEAD_LEN);
+
+        if (g_UseMutex) {
+            (void)pthread_mutex_lock(&g_SendMutex);
+            result = IPCS_ClientAsynCall(g_ClientFd, &sendMsg);
+            (void)pthread_mutex_unlock(&g_SendMutex);
+        } else {
+            result = IPCS_ClientAsynCall(g_ClientFd, &sendMsg);
+        }
+        if (result != IPCS_OK) {
+            sender->lastError = result;
+            break;
+        }
+        sender->sends++;
+        seq++;
+    }
+
+    free(value);
+
+    return NULL;
+}
+
+/******************************************************************************/
+static int SendqRun(const SENDQ_Config *config)
+{
+    IPCS_ServerAttr serverAttr;
+    IPCS_ClientAttr clientAttr;
+    unsigned long long sends = 0;
+    unsigned long long received = 0;
+    unsigned long long badMsgs = 0;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t drainNs = 0;
+    int lastError = IPCS_OK;
+    int result = IPCS_OK;
+
+    g_UseMutex = config->useMutex;
+    __atomic_store_n(&g_Received, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_BadMsgs, 0, __ATOMIC_RELAXED);
+    (void)memset(g_NextSeq, 0, sizeof(g_NextSeq));
+
+    (void)snprintf(g_ServerName, sizeof(g_ServerName), "@ipcs_sendq_bench_%s", config->name);
+    IPCS_InitServerAttr(&serverAttr);
+    serverAttr.engine = g_Engine;
+    serverAttr.readyTimeoutMs = 1000;
+    result = IPCS_CreateServerEx(g_ServerName, SendqServerHook, &serverAttr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("sendq create server fail: %d", result);
+        return result;
+    }
+
+    IPCS_InitClientAttr(&clientAttr);
+    clientAttr.engine = g_Engine;
+    result = IPCS_CreateAsynClientEx(NULL, g_ServerName, SendqClientHook, &clientAttr, &g_ClientFd);
+    if (result != IPCS_OK) {
+        TEST_PRINT("sendq create client fail: %d", result);
+        (void)IPCS_DestroyServer(g_ServerName);
+        return result;
+    }
+
+    g_Stop = 0;
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (started = 0; started < g_SenderNum; started++) {
+        (void)memset(&g_Senders[started], 0, sizeof(SENDQ_Sender));
+        g_Senders[started].id = started;
+        if (pthread_create(&g_Senders[started].tid, NULL, SendqSenderThread, &g_Senders[started]) != 0) {
+            TEST_PRINT("sendq start sender %u fail", started);
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+
+    BENCH_SleepUntilNs(endNs);
+    g_Stop = 1;
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_Senders[i].tid, NULL);
+        sends += g_Senders[i].sends;
+        if (g_Senders[i].lastError != IPCS_OK) {
+            lastError = g_Senders[i].lastError;
+        }
+    }
+    endNs = BENCH_NowNs();
+
+    /* 等服务端处理完已发出的消息 */
+    drainNs = endNs + SENDQ_DRAIN_MS * BENCH_NS_PER_MS;
+    while ((__atomic_load_n(&g_Received, __ATOMIC_RELAXED) < sends) && (BENCH_NowNs() < drainNs)) {
+        (void)usleep(1000);
+    }
+
+    (void)IPCS_DestroyClient(g_ClientFd);
+    (void)IPCS_DestroyServer(g_ServerName);
+    received = __atomic_load_n(&g_Received, __ATOMIC_RELAXED);
+    badMsgs = __atomic_load_n(&g_BadMsgs, __ATOMIC_RELAXED);
+
+    BENCH_PRINT("%-8s senders=%u size=%u engine=%s", config->name, started, g_MsgLen,
+            (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+    BENCH_PRINT("  %.0f sends/s  sent=%llu received=%llu bad=%llu last_error=%d",
+            (double)sends * BENCH_NS_PER_SEC / (double)(endNs - startNs), sends, received, badMsgs, lastError);
+
+    /* 并发发送时帧不能交错：每个消息完整、每个线程的序号连续 */
+    if ((result == IPCS_OK) && ((lastError != IPCS_OK) || (badMsgs != 0) || (received != sends))) {
+        result = (lastError != IPCS_OK) ? lastError : IPCS_STREAM_BUF_BAD;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:s:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_SenderNum = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_MsgLen = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c senders] [-s msgLen] [-e epoll|uring] [-m mutex|combine]\n",
+                        argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_SenderNum == 0) || (g_SenderNum > SENDQ_MAX_SENDERS) || (g_MsgLen < SENDQ_HEAD_LEN) ||
+        (g_MsgLen > IPCS_MESSAGE_MAX_LEN)) {
+        (void)printf("senders 1..%d, msgLen %u..%d\n", SENDQ_MAX_SENDERS, (unsigned int)SENDQ_HEAD_LEN,
+                IPCS_MESSAGE_MAX_LEN);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = SendqRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
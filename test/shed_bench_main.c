@@ -0,0 +1,256 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  shed_bench_main.c
+ *
+ *    Description:  load shedding benchmark
+ *
+ *                  服务端回调函数忙等固定的服务时间，异步客户端按固定速率（开环）发送请求，
+ *                  请求速率超过服务端的处理能力。分别在不拒绝、CoDel和令牌桶三种过载保护
+ *                  策略下运行，输出实际处理的请求速率、被拒绝的请求速率、平均排队时间和
+ *                  成功响应的时延分布。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 12:18:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define SHED_MSG_TYPE           0x5348   /* "SH" */
+#define SHED_SERVER_NAME        "@ipcs_shed_bench"
+
+/* 发送结束后等待积压的请求处理完的最长时间 */
+#define SHED_DRAIN_WAIT_SEC     10
+
+typedef struct {
+    const char *name;
+    IPCS_ShedPolicy policy;
+} SHED_Config;
+
+static const SHED_Config g_Configs[] = {
+    {"none", IPCS_SHED_NONE},
+    {"codel", IPCS_SHED_CODEL},
+    {"bucket", IPCS_SHED_TOKEN_BUCKET},
+};
+
+static double g_DurationSec = 3.0;
+static unsigned int g_ServiceUs = 200;
+static unsigned int g_Rate = 0;
+static unsigned int g_TargetUs = 0;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+/* 只由异步客户端的接收线程写 */
+static BENCH_Histogram g_RttHist;
+static volatile unsigned long long g_Served = 0;
+static volatile unsigned long long g_Rejected = 0;
+
+/******************************************************************************/
+/* 忙等服务时间，模拟处理请求的CPU开销 */
+int ShedServerHook(int fd, IPCS_Message *msg)
+{
+    uint64_t endNs = BENCH_NowNs() + (uint64_t)g_ServiceUs * BENCH_NS_PER_US;
+
+    while (BENCH_NowNs() < endNs) {
+    }
+
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 负载中是客户端发送请求的时间 */
+int ShedClientHook(IPCS_Message *msg)
+{
+    uint64_t sendNs = 0;
+
+    if (msg->msgLen >= sizeof(sendNs)) {
+        (void)memcpy(&sendNs, msg->msgValue, sizeof(sendNs));
+        BENCH_HistRecord(&g_RttHist, BENCH_NowNs() - sendNs);
+    }
+    g_Served++;
+
+    return IPCS_OK;
+}
+
+int ShedRejectHook(unsigned int callId, unsigned int msgType, int error)
+{
+    g_Rejected++;
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+static int ShedCreateServer(const SHED_Config *config, unsigned int rate)
+{
+    IPCS_ServerAttr attr;
+    int result = IPCS_OK;
+
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    attr.shed.policy = config->policy;
+    attr.shed.targetUs = g_TargetUs;
+    /* 令牌桶限制在处理能力的80%，允许10毫秒的突发 */
+    attr.shed.rate = (unsigned int)(1000000ULL * 8 / 10 / g_ServiceUs);
+    attr.shed.burst = attr.shed.rate / 100 + 1;
+
+    result = IPCS_CreateServerEx(SHED_SERVER_NAME, ShedServerHook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("shed create server fail: %d", result);
+        return result;
+    }
+    /* 服务端线程异步完成bind/listen */
+    (void)usleep(100 * 1000);
+
+    return IPCS_OK;
+}
+
+static int ShedRun(const SHED_Config *config, unsigned int rate)
+{
+    IPCS_ServerStats stats;
+    IPCS_Message sendMsg;
+    uint64_t payload[2];
+    unsigned long long sent = 0;
+    unsigned long long handled = 0;
+    uint64_t intervalNs = BENCH_NS_PER_SEC / rate;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    uint64_t nextNs = 0;
+    uint64_t drainEndNs = 0;
+    double sendSec = 0.0;
+    int clientFd = -1;
+    int result = IPCS_OK;
+
+    result = ShedCreateServer(config, rate);
+    if (result != IPCS_OK) {
+        return result;
+    }
+
+    result = IPCS_CreateAsynClient(NULL, SHED_SERVER_NAME, ShedClientHook, &clientFd);
+    if (result != IPCS_OK) {
+        TEST_PRINT("shed create client fail: %d", result);
+        (void)IPCS_DestroyServer(SHED_SERVER_NAME);
+        return result;
+    }
+    (void)IPCS_SetClientRejectHook(clientFd, ShedRejectHook);
+
+    BENCH_HistReset(&g_RttHist);
+    g_Served = 0;
+    g_Rejected = 0;
+
+    (void)memset(payload, 0, sizeof(payload));
+    sendMsg.msgType = SHED_MSG_TYPE;
+    sendMsg.msgLen = sizeof(payload);
+    sendMsg.msgValue = payload;
+
+    /* 开环：按计划的时间发送，服务端变慢时不减少发送 */
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (nextNs = startNs; nextNs < endNs; nextNs += intervalNs) {
+        BENCH_SleepUntilNs(nextNs);
+        payload[0] = BENCH_NowNs();
+        result = IPCS_ClientAsynCall(clientFd, &sendMsg);
+        if (result != IPCS_OK) {
+            TEST_PRINT("shed asyn call fail: %d", result);
+            break;
+        }
+        sent++;
+    }
+    sendSec = (double)(BENCH_NowNs() - startNs) / BENCH_NS_PER_SEC;
+
+    drainEndNs = BENCH_NowNs() + SHED_DRAIN_WAIT_SEC * BENCH_NS_PER_SEC;
+    while ((g_Served + g_Rejected < sent) && (BENCH_NowNs() < drainEndNs)) {
+        (void)usleep(10 * 1000);
+    }
+    endNs = BENCH_NowNs();
+
+    (void)memset(&stats, 0, sizeof(stats));
+    (void)IPCS_GetServerStats(SHED_SERVER_NAME, &stats);
+    handled = stats.messages + stats.sheds;
+
+    if (result == IPCS_OK) {
+        BENCH_PRINT("%-7s rate=%u/s service=%uus engine=%s", config->name, rate, g_ServiceUs,
+                (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+        BENCH_PRINT("  sent=%llu served=%llu rejected=%llu lost=%llu  goodput=%.0f/s  drain=%.2fs  avg_queue=%.2fms",
+                sent, g_Served, g_Rejected, sent - g_Served - g_Rejected,
+                (double)g_Served * BENCH_NS_PER_SEC / (double)(endNs - startNs),
+                (double)(endNs - startNs) / BENCH_NS_PER_SEC - sendSec,
+                (handled != 0) ? (double)stats.queueNs / (double)handled / BENCH_NS_PER_MS : 0.0);
+        BENCH_HistPrintSummary(&g_RttHist, "  served rtt");
+    }
+
+    (void)IPCS_DestroyClient(clientFd);
+    (void)IPCS_DestroyServer(SHED_SERVER_NAME);
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int rate = 0;
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:r:w:t:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'r':
+                g_Rate = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_ServiceUs = (unsigned int)atoi(optarg);
+                break;
+            case 't':
+                g_TargetUs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-r rate] [-w serviceUs] [-t targetUs]\n"
+                             "          [-e epoll|uring] [-m none|codel|bucket]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_ServiceUs == 0) || (g_DurationSec <= 0)) {
+        (void)printf("serviceUs > 0, seconds > 0\n");
+        return -1;
+    }
+
+    /* 默认按处理能力的1.5倍发送 */
+    rate = (g_Rate != 0) ? g_Rate : (unsigned int)(1000000ULL * 3 / 2 / g_ServiceUs);
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = ShedRun(&g_Configs[i], rate);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
@@ -0,0 +1,232 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  startup_bench_main.c
+ *
+ *    Description:  server startup readiness benchmark
+ *
+ *                  反复创建服务端、连接并调用一次、销毁，统计从创建服务端到第一次调用返回的时间
+ *                  和失败次数：nowait创建后立即连接，sleep创建后等待-s毫秒再连接（原来的做法），
+ *                  ready设置readyTimeoutMs等待服务端开始监听后连接，retry由客户端线程先设置
+ *                  connectTimeoutMs开始连接，-l微秒后再创建服务端。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:14:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define STARTUP_MSG_TYPE        0x5354   /* "ST" */
+#define STARTUP_TIMEOUT_MS      1000
+
+typedef enum {
+    STARTUP_NOWAIT = 0,
+    STARTUP_SLEEP,
+    STARTUP_READY,
+    STARTUP_RETRY
+} STARTUP_Mode;
+
+typedef struct {
+    const char *name;
+    STARTUP_Mode mode;
+} STARTUP_Config;
+
+static const STARTUP_Config g_Configs[] = {
+    {"nowait", STARTUP_NOWAIT},
+    {"sleep", STARTUP_SLEEP},
+    {"ready", STARTUP_READY},
+    {"retry", STARTUP_RETRY},
+};
+
+typedef struct {
+    char serverName[64];
+    unsigned int connectTimeoutMs;
+    uint64_t endNs;
+    int result;
+} STARTUP_Client;
+
+static unsigned int g_Rounds = 50;
+static unsigned int g_SleepMs = 100;
+static unsigned int g_DelayUs = 5000;
+static const char *g_OnlyConfig = NULL;
+
+/******************************************************************************/
+int StartupServerHook(int fd, IPCS_Message *msg)
+{
+    return IPCS_ServerSendMessage(fd, msg);
+}
+
+/* 连接并调用一次，记录返回的时间 */
+static void StartupConnectCall(STARTUP_Client *client)
+{
+    IPCS_ClientAttr attr;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned int req = 0x1234;
+    unsigned int resp = 0;
+    int fd = -1;
+
+    IPCS_InitClientAttr(&attr);
+    attr.connectTimeoutMs = client->connectTimeoutMs;
+    client->result = IPCS_CreateSyncClientEx(NULL, client->serverName, &attr, &fd);
+    if (client->result == IPCS_OK) {
+        sendMsg.msgType = STARTUP_MSG_TYPE;
+        sendMsg.msgLen = sizeof(req);
+        sendMsg.msgValue = &req;
+        recvMsg.msgLen = sizeof(resp);
+        recvMsg.msgValue = &resp;
+        client->result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+        if ((client->result == IPCS_OK) && (resp != req)) {
+            client->result = IPCS_STREAM_BUF_BAD;
+        }
+        (void)IPCS_DestroyClient(fd);
+    }
+    client->endNs = BENCH_NowNs();
+
+    return;
+}
+
+static void *StartupClientThread(void *arg)
+{
+    StartupConnectCall((STARTUP_Client *)arg);
+
+    return NULL;
+}
+
+/******************************************************************************/
+/* 一轮：创建服务端到第一次调用返回的时间记入hist */
+static int StartupRound(const STARTUP_Config *config, unsigned int round, BENCH_Histogram *hist)
+{
+    STARTUP_Client client;
+    IPCS_ServerAttr attr;
+    pthread_t tid;
+    uint64_t startNs = 0;
+    int result = IPCS_OK;
+
+    (void)memset(&client, 0, sizeof(client));
+    (void)snprintf(client.serverName, sizeof(client.serverName), "@ipcs_startup_bench_%s_%u", config->name, round);
+    IPCS_InitServerAttr(&attr);
+
+    if (config->mode == STARTUP_RETRY) {
+        client.connectTimeoutMs = STARTUP_TIMEOUT_MS;
+        if (pthread_create(&tid, NULL, StartupClientThread, &client) != 0) {
+            return IPCS_PTHREAD_CREATE_FAIL;
+        }
+        (void)usleep(g_DelayUs);
+    }
+    if (config->mode == STARTUP_READY) {
+        attr.readyTimeoutMs = STARTUP_TIMEOUT_MS;
+    }
+
+    startNs = BENCH_NowNs();
+    result = IPCS_CreateServerEx(client.serverName, StartupServerHook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("startup create server %s fail: %d", client.serverName, result);
+        if (config->mode == STARTUP_RETRY) {
+            (void)pthread_join(tid, NULL);
+        }
+        return result;
+    }
+
+    if (config->mode == STARTUP_RETRY) {
+        (void)pthread_join(tid, NULL);
+    } else {
+        if (config->mode == STARTUP_SLEEP) {
+            (void)usleep(g_SleepMs * 1000);
+        }
+        StartupConnectCall(&client);
+    }
+
+    (void)IPCS_DestroyServer(client.serverName);
+    if (client.result == IPCS_OK) {
+        BENCH_HistRecord(hist, client.endNs - startNs);
+    }
+
+    return client.result;
+}
+
+static int StartupRun(const STARTUP_Config *config)
+{
+    BENCH_Histogram hist;
+    unsigned int fails = 0;
+    unsigned int i = 0;
+    int lastError = IPCS_OK;
+    int result = IPCS_OK;
+
+    BENCH_HistReset(&hist);
+    for (i = 0; i < g_Rounds; i++) {
+        result = StartupRound(config, i, &hist);
+        if (result != IPCS_OK) {
+            fails++;
+            lastError = result;
+        }
+    }
+
+    BENCH_PRINT("%-8s rounds=%u fails=%u last_error=%d", config->name, g_Rounds, fails, lastError);
+    BENCH_HistPrintSummary(&hist, "  first call");
+
+    /* 等待服务端开始监听或者客户端重试时不应失败 */
+    if (((config->mode == STARTUP_READY) || (config->mode == STARTUP_RETRY)) && (fails != 0)) {
+        return lastError;
+    }
+
+    return IPCS_OK;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:l:m:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                g_Rounds = (unsigned int)atoi(optarg);
+                break;
+            case 's':
+                g_SleepMs = (unsigned int)atoi(optarg);
+                break;
+            case 'l':
+                g_DelayUs = (unsigned int)atoi(optarg);
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-n rounds] [-s sleepMs] [-l delayUs] [-m nowait|sleep|ready|retry]\n",
+                        argv[0]);
+                return -1;
+        }
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = StartupRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
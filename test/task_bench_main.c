@@ -0,0 +1,471 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  task_bench_main.c
+ *
+ *    Description:  server thread tasks and timers benchmark
+ *
+ *                  -c个线程各用一个同步客户端连接调用，分三种配置运行：delay中回调函数保存请求，
+ *                  用定时器在-l毫秒后响应（同时添加并立即取消一个定时器）；offload中回调函数把
+ *                  请求交给-t个工作线程，工作线程忙等-w微秒后提交任务，由服务端线程响应；periodic
+ *                  中回调函数直接响应，同时服务端线程上有一个每-i毫秒执行一次的定时器。输出调用
+ *                  速率、调用时延，以及周期定时器的执行次数和间隔。
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:48:15 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Dercury (Jim), dercury@qq.com
+ *   Organization:  Perfect World
+ *
+ * =====================================================================================
+ */
+
+#include "bench_common.h"
+#include "test_main.h"
+#include "ipcs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/******************************************************************************/
+#define TASK_MSG_TYPE           0x544B   /* "TK" */
+#define TASK_MAX_CALLERS        32
+#define TASK_MAX_WORKERS        8
+
+typedef enum {
+    TASK_DELAY = 0,
+    TASK_OFFLOAD,
+    TASK_PERIODIC
+} TASK_Mode;
+
+typedef struct {
+    const char *name;
+    TASK_Mode mode;
+} TASK_Config;
+
+static const TASK_Config g_Configs[] = {
+    {"delay", TASK_DELAY},
+    {"offload", TASK_OFFLOAD},
+    {"periodic", TASK_PERIODIC},
+};
+
+/* 保存的请求，由服务端线程响应后释放 */
+typedef struct TASK_Pending {
+    IPCS_ServerCall call;
+    unsigned int req;
+    struct TASK_Pending *next;
+} TASK_Pending;
+
+typedef struct {
+    pthread_t tid;
+    unsigned long long calls;
+    unsigned long long fails;
+    int lastError;
+    BENCH_Histogram hist;
+} TASK_Caller;
+
+static double g_DurationSec = 2.0;
+static unsigned int g_CallerNum = 8;
+static unsigned int g_DelayMs = 2;
+static unsigned int g_WorkerNum = 2;
+static unsigned int g_BusyUs = 20;
+static unsigned int g_IntervalMs = 5;
+static IPCS_Engine g_Engine = IPCS_ENGINE_EPOLL;
+static const char *g_OnlyConfig = NULL;
+
+static volatile int g_Stop = 0;
+static TASK_Mode g_Mode = TASK_DELAY;
+static char g_ServerName[64];
+static TASK_Caller g_CallerArgs[TASK_MAX_CALLERS];
+static BENCH_Histogram g_RttHist;
+
+/* 只在服务端线程中访问 */
+static unsigned long long g_ReplyFails = 0;
+static unsigned long long g_CancelFails = 0;
+static unsigned long long g_Ticks = 0;
+static unsigned long long g_TickTimer = 0;
+static uint64_t g_LastTickNs = 0;
+static BENCH_Histogram g_TickHist;
+
+/* 工作线程的队列 */
+static pthread_mutex_t g_QueueMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_QueueCond = PTHREAD_COND_INITIALIZER;
+static TASK_Pending *g_QueueHead = NULL;
+static TASK_Pending *g_QueueTail = NULL;
+static int g_QueueStop = 0;
+
+/******************************************************************************/
+/* 在服务端线程中执行：响应保存的请求 */
+static void TaskReply(void *arg)
+{
+    TASK_Pending *pending = (TASK_Pending *)arg;
+    IPCS_Message respMsg;
+
+    respMsg.msgType = TASK_MSG_TYPE;
+    respMsg.msgLen = sizeof(pending->req);
+    respMsg.msgValue = &pending->req;
+    if (IPCS_ServerReply(&pending->call, &respMsg) != IPCS_OK) {
+        g_ReplyFails++;
+    }
+    free(pending);
+
+    return;
+}
+
+static void TaskNever(void *arg)
+{
+    (void)arg;
+    g_CancelFails++;
+
+    return;
+}
+
+static void TaskTick(void *arg)
+{
+    uint64_t nowNs = BENCH_NowNs();
+
+    (void)arg;
+    if (g_LastTickNs != 0) {
+        BENCH_HistRecord(&g_TickHist, nowNs - g_LastTickNs);
+    }
+    g_LastTickNs = nowNs;
+    g_Ticks++;
+
+    return;
+}
+
+static void TaskStartTick(void *arg)
+{
+    (void)arg;
+    (void)IPCS_ServerAddTimer(g_IntervalMs, g_IntervalMs, TaskTick, NULL, &g_TickTimer);
+
+    return;
+}
+
+static void TaskStopTick(void *arg)
+{
+    (void)arg;
+    if (IPCS_ServerCancelTimer(g_TickTimer) != IPCS_OK) {
+        g_CancelFails++;
+    }
+
+    return;
+}
+
+static void TaskQueuePush(TASK_Pending *pending)
+{
+    (void)pthread_mutex_lock(&g_QueueMutex);
+    pending->next = NULL;
+    if (g_QueueTail == NULL) {
+        g_QueueHead = pending;
+    } else {
+        g_QueueTail->next = pending;
+    }
+    g_QueueTail = pending;
+    (void)pthread_cond_signal(&g_QueueCond);
+    (void)pthread_mutex_unlock(&g_QueueMutex);
+
+    return;
+}
+
+int TaskServerHook(int fd, IPCS_Message *msg)
+{
+    TASK_Pending *pending = NULL;
+    unsigned long long timerId = 0;
+
+    if (g_Mode == TASK_PERIODIC) {
+        return IPCS_ServerSendMessage(fd, msg);
+    }
+
+    pending = (TASK_Pending *)malloc(sizeof(TASK_Pending));
+    if (pending == NULL) {
+        return IPCS_MALLOC_FAIL;
+    }
+    (void)memset(pending, 0, sizeof(TASK_Pending));
+    if (msg->msgLen >= sizeof(pending->req)) {
+        (void)memcpy(&pending->req, msg->msgValue, sizeof(pending->req));
+    }
+    if (IPCS_ServerSaveCall(fd, &pending->call) != IPCS_OK) {
+        free(pending);
+        return IPCS_NOT_FOUND;
+    }
+
+    if (g_Mode == TASK_OFFLOAD) {
+        TaskQueuePush(pending);
+        return IPCS_OK;
+    }
+
+    /* 添加后立即取消的定时器不应执行 */
+    if ((IPCS_ServerAddTimer(g_DelayMs, 0, TaskNever, NULL, &timerId) != IPCS_OK) ||
+        (IPCS_ServerCancelTimer(timerId) != IPCS_OK)) {
+        g_CancelFails++;
+    }
+
+    return IPCS_ServerAddTimer(g_DelayMs, 0, TaskReply, pending, NULL);
+}
+
+/* 工作线程：处理请求后提交任务，由服务端线程响应 */
+static void *TaskWorkerThread(void *arg)
+{
+    TASK_Pending *pending = NULL;
+    uint64_t endNs = 0;
+
+    (void)arg;
+    for (; ; ) {
+        (void)pthread_mutex_lock(&g_QueueMutex);
+        while ((g_QueueHead == NULL) && !g_QueueStop) {
+            (void)pthread_cond_wait(&g_QueueCond, &g_QueueMutex);
+        }
+        pending = g_QueueHead;
+        if (pending != NULL) {
+            g_QueueHead = pending->next;
+            if (g_QueueHead == NULL) {
+                g_QueueTail = NULL;
+            }
+        }
+        (void)pthread_mutex_unlock(&g_QueueMutex);
+
+        if (pending == NULL) {
+            break;
+        }
+
+        endNs = BENCH_NowNs() + (uint64_t)g_BusyUs * BENCH_NS_PER_US;
+        while (BENCH_NowNs() < endNs) {
+        }
+        if (IPCS_ServerPostTask(g_ServerName, TaskReply, pending) != IPCS_OK) {
+            free(pending);
+        }
+    }
+
+    return NULL;
+}
+
+/******************************************************************************/
+static void *TaskCallerThread(void *arg)
+{
+    TASK_Caller *caller = (TASK_Caller *)arg;
+    IPCS_Message sendMsg;
+    IPCS_Message recvMsg;
+    unsigned int req = 0;
+    unsigned int resp = 0;
+    uint64_t startNs = 0;
+    int fd = -1;
+    int result = IPCS_OK;
+
+    result = IPCS_CreateSyncClient(NULL, g_ServerName, &fd);
+    if (result != IPCS_OK) {
+        caller->fails++;
+        caller->lastError = result;
+        return NULL;
+    }
+
+    sendMsg.msgType = TASK_MSG_TYPE;
+    sendMsg.msgLen = sizeof(req);
+    sendMsg.msgValue = &req;
+
+    while (!g_Stop) {
+        req = (unsigned int)caller->calls + 1;
+        recvMsg.msgLen = sizeof(resp);
+        recvMsg.msgValue = &resp;
+
+        startNs = BENCH_NowNs();
+        result = IPCS_ClientSyncCall(fd, &sendMsg, &recvMsg);
+        if ((result == IPCS_OK) && ((recvMsg.msgLen != sizeof(resp)) || (resp != req))) {
+            result = IPCS_STREAM_BUF_BAD;
+        }
+        if (result != IPCS_OK) {
+            caller->fails++;
+            caller->lastError = result;
+            break;
+        }
+        BENCH_HistRecord(&caller->hist, BENCH_NowNs() - startNs);
+        caller->calls++;
+    }
+
+    (void)IPCS_DestroyClient(fd);
+
+    return NULL;
+}
+
+/******************************************************************************/
+static int TaskRun(const TASK_Config *config)
+{
+    IPCS_ServerAttr attr;
+    pthread_t workers[TASK_MAX_WORKERS];
+    unsigned long long calls = 0;
+    unsigned long long fails = 0;
+    unsigned long long expectTicks = 0;
+    unsigned int workerNum = 0;
+    unsigned int started = 0;
+    unsigned int i = 0;
+    uint64_t startNs = 0;
+    uint64_t endNs = 0;
+    int lastError = IPCS_OK;
+    int result = IPCS_OK;
+
+    g_Mode = config->mode;
+    g_ReplyFails = 0;
+    g_CancelFails = 0;
+    g_Ticks = 0;
+    g_LastTickNs = 0;
+    BENCH_HistReset(&g_TickHist);
+    g_QueueStop = 0;
+
+    (void)snprintf(g_ServerName, sizeof(g_ServerName), "@ipcs_task_bench_%s", config->name);
+    IPCS_InitServerAttr(&attr);
+    attr.engine = g_Engine;
+    attr.readyTimeoutMs = 1000;
+    result = IPCS_CreateServerEx(g_ServerName, TaskServerHook, &attr);
+    if (result != IPCS_OK) {
+        TEST_PRINT("task create server fail: %d", result);
+        return result;
+    }
+
+    if (config->mode == TASK_OFFLOAD) {
+        for (workerNum = 0; workerNum < g_WorkerNum; workerNum++) {
+            if (pthread_create(&workers[workerNum], NULL, TaskWorkerThread, NULL) != 0) {
+                break;
+            }
+        }
+    }
+    if (config->mode == TASK_PERIODIC) {
+        (void)IPCS_ServerPostTask(g_ServerName, TaskStartTick, NULL);
+    }
+
+    g_Stop = 0;
+    BENCH_HistReset(&g_RttHist);
+    startNs = BENCH_NowNs();
+    endNs = startNs + (uint64_t)(g_DurationSec * BENCH_NS_PER_SEC);
+    for (started = 0; started < g_CallerNum; started++) {
+        (void)memset(&g_CallerArgs[started], 0, sizeof(TASK_Caller));
+        BENCH_HistReset(&g_CallerArgs[started].hist);
+        if (pthread_create(&g_CallerArgs[started].tid, NULL, TaskCallerThread, &g_CallerArgs[started]) != 0) {
+            TEST_PRINT("task start caller %u fail", started);
+            result = IPCS_PTHREAD_CREATE_FAIL;
+            break;
+        }
+    }
+
+    BENCH_SleepUntilNs(endNs);
+    g_Stop = 1;
+    for (i = 0; i < started; i++) {
+        (void)pthread_join(g_CallerArgs[i].tid, NULL);
+        calls += g_CallerArgs[i].calls;
+        fails += g_CallerArgs[i].fails;
+        if (g_CallerArgs[i].lastError != IPCS_OK) {
+            lastError = g_CallerArgs[i].lastError;
+        }
+        BENCH_HistMerge(&g_RttHist, &g_CallerArgs[i].hist);
+    }
+    endNs = BENCH_NowNs();
+
+    if (config->mode == TASK_PERIODIC) {
+        (void)IPCS_ServerPostTask(g_ServerName, TaskStopTick, NULL);
+        (void)usleep(20 * 1000);
+    }
+
+    (void)pthread_mutex_lock(&g_QueueMutex);
+    g_QueueStop = 1;
+    (void)pthread_cond_broadcast(&g_QueueCond);
+    (void)pthread_mutex_unlock(&g_QueueMutex);
+    for (i = 0; i < workerNum; i++) {
+        (void)pthread_join(workers[i], NULL);
+    }
+
+    /* 服务端销毁后，服务端线程不再访问统计 */
+    (void)IPCS_DestroyServer(g_ServerName);
+
+    BENCH_PRINT("%-8s callers=%u delay=%ums workers=%u busy=%uus interval=%ums engine=%s", config->name, started,
+            g_DelayMs, workerNum, g_BusyUs, g_IntervalMs, (g_Engine == IPCS_ENGINE_URING) ? "uring" : "epoll");
+    BENCH_PRINT("  %.0f calls/s  fails=%llu  last_error=%d  reply_fails=%llu  cancel_fails=%llu", (double)calls *
+            BENCH_NS_PER_SEC / (double)(endNs - startNs), fails, lastError, g_ReplyFails, g_CancelFails);
+    BENCH_HistPrintSummary(&g_RttHist, "  rtt");
+    if (config->mode == TASK_PERIODIC) {
+        expectTicks = (endNs - startNs) / ((uint64_t)g_IntervalMs * BENCH_NS_PER_MS);
+        BENCH_PRINT("  ticks=%llu expect~%llu", g_Ticks, expectTicks);
+        BENCH_HistPrintSummary(&g_TickHist, "  interval");
+    }
+
+    if ((result == IPCS_OK) && ((fails != 0) || (g_ReplyFails != 0) || (g_CancelFails != 0))) {
+        result = (lastError != IPCS_OK) ? lastError : IPCS_SERVER_HOOK_FAIL;
+    }
+    /* 延迟响应不早于定时器的时间 */
+    if ((result == IPCS_OK) && (config->mode == TASK_DELAY) && (calls != 0) &&
+        (BENCH_HistPercentile(&g_RttHist, 0.0) < (uint64_t)g_DelayMs * BENCH_NS_PER_MS)) {
+        TEST_PRINT("task delay: reply earlier than %ums", g_DelayMs);
+        result = IPCS_TIMEOUT;
+    }
+    /* 周期定时器在负载下也按间隔执行 */
+    if ((result == IPCS_OK) && (config->mode == TASK_PERIODIC) &&
+        ((g_Ticks * 2 < expectTicks) || (g_Ticks > expectTicks * 2 + 2))) {
+        TEST_PRINT("task periodic: ticks=%llu expect~%llu", g_Ticks, expectTicks);
+        result = IPCS_TIMEOUT;
+    }
+
+    return result;
+}
+
+/******************************************************************************/
+int main(int argc, char **argv)
+{
+    unsigned int i = 0;
+    int result = IPCS_OK;
+    int opt = 0;
+
+    while ((opt = getopt(argc, argv, "d:c:l:t:w:i:e:m:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                g_DurationSec = atof(optarg);
+                break;
+            case 'c':
+                g_CallerNum = (unsigned int)atoi(optarg);
+                break;
+            case 'l':
+                g_DelayMs = (unsigned int)atoi(optarg);
+                break;
+            case 't':
+                g_WorkerNum = (unsigned int)atoi(optarg);
+                break;
+            case 'w':
+                g_BusyUs = (unsigned int)atoi(optarg);
+                break;
+            case 'i':
+                g_IntervalMs = (unsigned int)atoi(optarg);
+                break;
+            case 'e':
+                g_Engine = (strcmp(optarg, "uring") == 0) ? IPCS_ENGINE_URING : IPCS_ENGINE_EPOLL;
+                break;
+            case 'm':
+                g_OnlyConfig = optarg;
+                break;
+            default:
+                (void)printf("Usage: %s [-d seconds] [-c callers] [-l delayMs] [-t workers] [-w busyUs]\n"
+                             "          [-i intervalMs] [-e epoll|uring] [-m delay|offload|periodic]\n", argv[0]);
+                return -1;
+        }
+    }
+
+    if ((g_CallerNum == 0) || (g_CallerNum > TASK_MAX_CALLERS) || (g_WorkerNum == 0) ||
+        (g_WorkerNum > TASK_MAX_WORKERS) || (g_IntervalMs == 0)) {
+        (void)printf("callers 1..%d, workers 1..%d, interval > 0\n", TASK_MAX_CALLERS, TASK_MAX_WORKERS);
+        return -1;
+    }
+
+    IPCS_EnableLog(0);
+
+    for (i = 0; (i < sizeof(g_Configs) / sizeof(g_Configs[0])) && (result == IPCS_OK); i++) {
+        if ((g_OnlyConfig != NULL) && (strcmp(g_OnlyConfig, g_Configs[i].name) != 0)) {
+            continue;
+        }
+        result = TaskRun(&g_Configs[i]);
+    }
+    (void)fflush(NULL);
+
+    return result;
+}
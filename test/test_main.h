@@ -24,6 +24,16 @@
 
 #define TEST_PRINT(format, ...)     (void)printf("\r\n<%s:%u>" format, __FILE__, __LINE__, ##__VA_ARGS__)
 
+/* *_test.exe的用例：条件不满足时输出位置和原因，用例返回TEST_FAIL */
+#define TEST_FAIL                   (-1)
+#define TEST_CHECK(cond, format, ...) \
+    do { \
+        if (!(cond)) { \
+            (void)printf("<%s:%u>check fail: " format "\n", __FILE__, __LINE__, ##__VA_ARGS__); \
+            return TEST_FAIL; \
+        } \
+    } while (0)
+
 #define SYCN_SERVER_NAME            "/usr/tmp/sync_server"
 #define ASYC_SERVER_NAME            "/usr/tmp/asyn_server"
 